@@ -0,0 +1,179 @@
+"""Measures the overhead of the Python bindings of the decode entry points of `pymatching.Matching`.
+
+The C++ benchmarks (`mwpm_decoding.perf.cc`) only time the decoder itself. A call from Python also converts and
+copies numpy arrays, allocates the arrays it returns and crosses the binding, which this script measures separately
+from the time spent decoding. Each entry point is timed on the shots of each `.b8` file of the `data` directory,
+decoded with the graph of the `.dem` file they were sampled from (the one whose name the name of the `.b8` file starts
+with), and again on the same number of shots with no detection events. The decoder returns from a shot with no
+detection events almost immediately, so the time per shot of the empty shots is the overhead of the entry point, and
+the rest of the time per shot of the recorded shots is the time spent decoding. For reference, the time the decoder itself reports for each shot (see the `return_latencies` argument of
+`Matching.decode_batch`) is also shown.
+
+Usage (with pymatching and numpy installed):
+
+    python benchmarks/python_bindings/binding_overhead.py
+    python benchmarks/python_bindings/binding_overhead.py --data-dir data --repeats 5 --csv out.csv
+"""
+import argparse
+import csv
+import os
+import time
+from typing import Callable, Dict, List, Optional, Tuple
+
+import numpy as np
+import pymatching
+
+DEFAULT_DATA_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "data")
+
+
+def find_datasets(data_dir: str) -> List[Tuple[str, str, str]]:
+    """Pairs each `.b8` file with the `.dem` file whose name is the longest prefix of its name.
+
+    Returns a list of (name, dem_path, b8_path), where the name is that of the `.b8` file without its extension.
+    """
+    files = sorted(os.listdir(data_dir))
+    dem_stems = [f[:-len(".dem")] for f in files if f.endswith(".dem")]
+    datasets = []
+    for f in files:
+        if not f.endswith(".b8"):
+            continue
+        stem = f[:-len(".b8")]
+        matches = [d for d in dem_stems if stem == d or stem.startswith(d + "_")]
+        if not matches:
+            continue
+        dem = max(matches, key=len)
+        datasets.append((stem, os.path.join(data_dir, dem + ".dem"), os.path.join(data_dir, f)))
+    return datasets
+
+
+def read_b8_detection_events(path: str, num_detectors: int, num_observables: int) -> np.ndarray:
+    """Reads the shots of a `.b8` file holding the detection events followed by the observables of each shot.
+
+    Returns a 2D `np.uint8` array with a row of `num_detectors` detection events per shot.
+    """
+    bits_per_shot = num_detectors + num_observables
+    bytes_per_shot = (bits_per_shot + 7) // 8
+    data = np.fromfile(path, dtype=np.uint8)
+    if data.size % bytes_per_shot != 0:
+        raise ValueError(f"The size of {path} is not a multiple of {bytes_per_shot} bytes per shot.")
+    data = data.reshape(-1, bytes_per_shot)
+    shots = np.unpackbits(data, axis=1, count=bits_per_shot, bitorder="little")
+    return np.ascontiguousarray(shots[:, :num_detectors])
+
+
+def seconds_per_run(run: Callable[[], object], repeats: int) -> float:
+    """The shortest time taken by `run` out of `repeats` runs, after one untimed run to warm up."""
+    run()
+    best = float("inf")
+    for _ in range(repeats):
+        t0 = time.perf_counter()
+        run()
+        best = min(best, time.perf_counter() - t0)
+    return best
+
+
+def entry_points(matching: pymatching.Matching) -> Dict[str, Callable[[np.ndarray], Callable[[], object]]]:
+    """For each entry point, a function taking the (unpacked) shots and returning a function that decodes them all.
+
+    The arguments are prepared (e.g. bit-packed) before the decoding function is returned, so that only the call
+    itself is timed.
+    """
+
+    def single_shot(shots: np.ndarray) -> Callable[[], object]:
+        rows = list(shots)
+        return lambda: [matching.decode(row) for row in rows]
+
+    def dense_batch(shots: np.ndarray) -> Callable[[], object]:
+        return lambda: matching.decode_batch(shots)
+
+    def bit_packed_batch(shots: np.ndarray) -> Callable[[], object]:
+        packed = np.packbits(shots, axis=1, bitorder="little")
+        return lambda: matching.decode_batch(packed, bit_packed_shots=True, bit_packed_predictions=True)
+
+    def edges(shots: np.ndarray) -> Callable[[], object]:
+        rows = list(shots)
+        return lambda: [matching.decode_to_edges_array(row) for row in rows]
+
+    def edges_batch(shots: np.ndarray) -> Callable[[], object]:
+        return lambda: matching.decode_batch_to_edges_array(shots)
+
+    return {
+        "decode": single_shot,
+        "decode_batch": dense_batch,
+        "decode_batch_bit_packed": bit_packed_batch,
+        "decode_to_edges_array": edges,
+        "decode_batch_to_edges_array": edges_batch,
+    }
+
+
+def decoder_microseconds_per_shot(matching: pymatching.Matching, shots: np.ndarray) -> float:
+    """The mean time per shot spent in the decoder itself, as reported by the decoder."""
+    _, latencies = matching.decode_batch(shots, return_latencies=True)
+    return float(np.mean(latencies["total"])) / 1e3
+
+
+def benchmark_dataset(name: str, dem_path: str, b8_path: str, repeats: int, max_shots: Optional[int]) -> List[dict]:
+    matching = pymatching.Matching.from_detector_error_model_file(dem_path)
+    shots = read_b8_detection_events(b8_path, matching.num_detectors, matching.num_fault_ids)
+    if max_shots is not None:
+        shots = shots[:max_shots]
+    num_shots = shots.shape[0]
+    empty = np.zeros_like(shots)
+    decoder_us = decoder_microseconds_per_shot(matching, shots)
+
+    rows = []
+    for variant, prepare in entry_points(matching).items():
+        total_us = seconds_per_run(prepare(shots), repeats) * 1e6 / num_shots
+        overhead_us = seconds_per_run(prepare(empty), repeats) * 1e6 / num_shots
+        rows.append({
+            "dataset": name,
+            "variant": variant,
+            "num_shots": num_shots,
+            "total_us_per_shot": total_us,
+            "overhead_us_per_shot": overhead_us,
+            "decode_us_per_shot": max(total_us - overhead_us, 0.0),
+            "overhead_fraction": overhead_us / total_us if total_us > 0 else 0.0,
+            "decoder_reported_us_per_shot": decoder_us,
+        })
+    return rows
+
+
+def print_table(rows: List[dict]) -> None:
+    header = f"{'dataset':<60} {'variant':<28} {'total':>9} {'overhead':>9} {'decode':>9} {'overhead%':>9} " \
+             f"{'decoder':>9}"
+    print(header)
+    print("(microseconds per shot; 'decoder' is the time reported by the decoder itself)")
+    print("-" * len(header))
+    for row in rows:
+        print(f"{row['dataset']:<60} {row['variant']:<28} {row['total_us_per_shot']:>9.2f} "
+              f"{row['overhead_us_per_shot']:>9.2f} {row['decode_us_per_shot']:>9.2f} "
+              f"{100 * row['overhead_fraction']:>8.1f}% {row['decoder_reported_us_per_shot']:>9.2f}")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--data-dir", default=DEFAULT_DATA_DIR,
+                        help="The directory holding the .dem and .b8 files. By default, the data directory of the repo")
+    parser.add_argument("--repeats", type=int, default=3,
+                        help="The number of timed runs of each entry point, of which the fastest is reported")
+    parser.add_argument("--max-shots", type=int, default=None,
+                        help="The most shots of each .b8 file to decode. By default, all of them")
+    parser.add_argument("--filter", default="",
+                        help="Only benchmark the datasets whose name contains this string")
+    parser.add_argument("--csv", default=None, help="Also write the results to this CSV file")
+    args = parser.parse_args()
+
+    rows = []
+    for name, dem_path, b8_path in find_datasets(args.data_dir):
+        if args.filter in name:
+            rows.extend(benchmark_dataset(name, dem_path, b8_path, args.repeats, args.max_shots))
+    print_table(rows)
+    if args.csv is not None:
+        with open(args.csv, "w", newline="") as f:
+            writer = csv.DictWriter(f, fieldnames=list(rows[0].keys()) if rows else [])
+            writer.writeheader()
+            writer.writerows(rows)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+# Copyright 2022 PyMatching Contributors
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#      http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from concurrent.futures import Future
+from typing import Union, List, TYPE_CHECKING, Optional
+
+import numpy as np
+
+if TYPE_CHECKING:
+    import pymatching  # pragma: no cover
+
+import pymatching._cpp_pymatching as _cpp_pm
+
+
+class DecoderService:
+    """
+    Decodes syndromes asynchronously using a pool of worker threads, returning a `concurrent.futures.Future` for
+    each syndrome. Create one using `Matching.decoder_service`.
+
+    Syndromes can be submitted from any thread, and start decoding in the order in which they were submitted. Each
+    worker decodes with its own decoder state, which shares the (frozen) matching graph rather than copying it. The
+    service should be closed with `DecoderService.close` (or used as a context manager) once it is no longer needed.
+    """
+
+    def __init__(self, matching: 'pymatching.Matching', num_workers: int = 1, *,
+                 worker_cpus: Optional[List[int]] = None, huge_pages: str = "none",
+                 replicate_per_numa_node: bool = False):
+        self._matching = matching
+        self._service = _cpp_pm.DecoderService(
+            matching._matching_graph,
+            num_workers,
+            [] if worker_cpus is None else list(worker_cpus),
+            huge_pages=huge_pages,
+            replicate_per_numa_node=replicate_per_numa_node,
+        )
+
+    def submit(self, z: Union[np.ndarray, List[bool], List[int]], *, return_weight: bool = False) -> Future:
+        """
+        Queue a syndrome to be decoded by the next free worker.
+
+        Parameters
+        ----------
+        z : numpy.ndarray
+            A binary syndrome vector, of the same form as for `Matching.decode`.
+        return_weight : bool, optional
+            If `return_weight==True`, the result of the future is a tuple `(correction, weight)`, and otherwise it
+            is just the correction (as returned by `Matching.decode`). By default False
+
+        Returns
+        -------
+        concurrent.futures.Future
+            A future whose result is the correction (and its weight, if `return_weight` is True) once the syndrome
+            has been decoded. Its exception is set instead if the syndrome can't be decoded.
+        """
+        if self.closed:
+            raise ValueError("The decoder service has been closed.")
+        detection_events = self._matching._syndrome_array_to_detection_events(z)
+        return self._service.submit(detection_events, return_weight=return_weight)
+
+    def close(self) -> None:
+        """
+        Wait for the syndromes that have already been submitted to be decoded, and stop the workers.
+        """
+        self._service.close()
+
+    @property
+    def closed(self) -> bool:
+        """
+        Whether the service has been closed
+        """
+        return self._service.closed
+
+    @property
+    def num_workers(self) -> int:
+        """
+        The number of worker threads (zero once the service has been closed)
+        """
+        return self._service.num_workers
+
+    def __enter__(self) -> 'DecoderService':
+        return self
+
+    def __exit__(self, exc_type, exc_value, traceback) -> None:
+        self.close()
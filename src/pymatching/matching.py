@@ -187,6 +187,53 @@ class Matching:
             return None
         return self._matching_graph.add_noise()
 
+    def add_noise_batch(self, num_shots: int, seed: Optional[int] = None) -> Tuple[np.ndarray, np.ndarray]:
+        """Samples a batch of shots, flipping each edge in the matching graph independently in each shot, with a
+        probability given by its ``error_probability`` attribute, which must be set for all edges.
+        All boundary nodes are always given a 0 syndrome.
+
+        The edges are grouped by error probability, and only the flipped edges are visited, so sampling is fast even
+        for large graphs with small error probabilities. A generator private to the call is used, so this does not
+        use or change the random state used by `add_noise`, and the outputs are bit-packed so that they can be passed
+        straight to `decode_batch`.
+
+        Parameters
+        ----------
+        num_shots : int
+            The number of shots to sample.
+        seed : int, optional
+            The seed (between 0 and 2**64 - 1) of the generator. The same seed always gives the same shots. By
+            default, a random seed is used.
+
+        Returns
+        -------
+        numpy.ndarray of dtype uint8
+            The syndromes, with shape `(num_shots, math.ceil(num_nodes / 8))`, bit-packed in little endian order
+            along the last axis. This can be passed to `decode_batch` with `bit_packed_shots=True`.
+        numpy.ndarray of dtype uint8
+            The flipped fault ids, with shape `(num_shots, math.ceil(self.num_fault_ids / 8))`, bit-packed in little
+            endian order along the last axis, the same format as the output of `decode_batch` with
+            `bit_packed_predictions=True`.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> import numpy as np
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, error_probability=0.1)
+        >>> m.add_edge(0, 1, fault_ids={1}, error_probability=0.1)
+        >>> m.add_boundary_edge(1, fault_ids={2}, error_probability=0.1)
+        >>> syndromes, errors = m.add_noise_batch(1000, seed=1)
+        >>> predictions = m.decode_batch(syndromes, bit_packed_shots=True, bit_packed_predictions=True)
+        >>> syndromes.shape, errors.shape, predictions.shape
+        ((1000, 1), (1000, 1), (1000, 1))
+        """
+        if not self._matching_graph.all_edges_have_error_probabilities():
+            raise ValueError("Not all edges have error probabilities, so noise cannot be sampled.")
+        if seed is None:
+            seed = int(np.random.SeedSequence().generate_state(1, dtype=np.uint64)[0])
+        return self._matching_graph.add_noise_batch(num_shots, seed)
+
     def _syndrome_array_to_detection_events(self, z: Union[np.ndarray, List[int]]) -> np.ndarray:
         try:
             z = np.array(z, dtype=np.uint8)
@@ -209,6 +256,8 @@ class Matching:
                _legacy_return_weight: bool = None,
                *,
                return_weight: bool = False,
+               enable_correlations: bool = False,
+               out: Optional[np.ndarray] = None,
                **kwargs
                ) -> Union[np.ndarray, Tuple[np.ndarray, int]]:
         r"""
@@ -227,6 +276,16 @@ class Matching:
         return_weight : bool, optional
             If `return_weight==True`, the sum of the weights of the edges in the
             minimum weight perfect matching is also returned. By default False
+        enable_correlations : bool, optional
+            If `True`, decode with two rounds of matching to account for correlated errors (such as Y errors that
+            decompose into an X and a Z component). After the first round, the weights of the edges that are
+            correlated with the edges in its matching are lowered, and the syndrome is decoded again. The returned
+            weight then uses the lowered weights. Only available if the `Matching` was loaded from a detector error
+            model or stim circuit with `enable_correlations=True`. By default False
+        out : np.ndarray, optional
+            A C-contiguous 1D numpy array with dtype `np.uint8` and `num_fault_ids` elements. If given, the
+            correction is written into `out`, which is returned, instead of into a newly allocated array, which
+            reduces the overhead of decoding one shot at a time. By default None
 
         Returns
         -------
@@ -321,7 +380,118 @@ class Matching:
                           "argument.", DeprecationWarning, stacklevel=2)
             return_weight = _legacy_return_weight
         detection_events = self._syndrome_array_to_detection_events(z)
-        correction, weight = self._matching_graph.decode(detection_events)
+        correction, weight = self._matching_graph.decode(
+            detection_events, enable_correlations=enable_correlations, out=out)
+        if return_weight:
+            return correction, weight
+        else:
+            return correction
+
+    def decode_with_weight_overrides(
+            self,
+            z: Union[np.ndarray, List[bool], List[int]],
+            edges: Union[np.ndarray, List[Tuple[int, int]]],
+            weights: Union[np.ndarray, List[float]],
+            *,
+            return_weight: bool = False
+    ) -> Union[np.ndarray, Tuple[np.ndarray, float]]:
+        """
+        Decode the syndrome `z`, as for `pymatching.Matching.decode`, but with the weights of some edges
+        temporarily replaced for this shot only, e.g. to use soft information from the measurements. The weights
+        are patched in place and restored after decoding, so the cost of the overrides scales with their number
+        rather than with the size of the graph.
+
+        Parameters
+        ----------
+        z : numpy.ndarray
+            A binary syndrome vector to decode, in the same format as for `pymatching.Matching.decode`.
+        edges : np.ndarray
+            A 2D numpy array of shape `(k, 2)`, where row `i` gives the nodes `(u, v)` of the `i`th edge to
+            reweight. A boundary edge `(u, None)` is given as `(u, -1)`.
+        weights : np.ndarray
+            A 1D numpy array of length `k`, where `weights[i]` is the weight of the `i`th edge for this shot. The
+            weights are discretized in the same way as the rest of the graph, so their absolute values must not
+            exceed the largest absolute edge weight in the graph (unless all the edge weights are integers). If an
+            edge is given more than once, the last weight is used.
+        return_weight : bool, optional
+            If `return_weight==True`, the sum of the weights of the edges in the minimum weight perfect matching,
+            using the overriding weights, is also returned. By default False
+
+        Returns
+        -------
+        correction : numpy.ndarray or list[int]
+            The predicted logical observables, as for `pymatching.Matching.decode`.
+        weight : float
+            Present only if `return_weight==True`. The sum of the weights of the edges in the solution.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, weight=2)
+        >>> m.add_edge(0, 1, weight=3)
+        >>> m.add_boundary_edge(1, fault_ids={1}, weight=2)
+        >>> m.decode([1, 1])
+        array([0, 0], dtype=uint8)
+        >>> m.decode_with_weight_overrides([1, 1], [(0, 1)], [5], return_weight=True)
+        (array([1, 1], dtype=uint8), 4.0)
+        >>> m.decode([1, 1])
+        array([0, 0], dtype=uint8)
+        """
+        detection_events = self._syndrome_array_to_detection_events(z)
+        edges = np.array(edges, dtype=np.int64).reshape(-1, 2)
+        weights = np.array(weights, dtype=np.float64).reshape(-1)
+        correction, weight = self._matching_graph.decode_with_weight_overrides(detection_events, edges, weights)
+        if return_weight:
+            return correction, weight
+        else:
+            return correction
+
+    def decode_with_erasures(
+            self,
+            z: Union[np.ndarray, List[bool], List[int]],
+            erased_edges: Union[np.ndarray, List[int]],
+            *,
+            return_weight: bool = False
+    ) -> Union[np.ndarray, Tuple[np.ndarray, float]]:
+        """
+        Decode the syndrome `z`, as for `pymatching.Matching.decode`, where some edges are known to have been
+        erased in this shot (for example, from the erasure flags of a neutral-atom experiment), so are given weight
+        0. The erased edges keep their fault ids. Their weights are patched in place and restored after decoding, so
+        this is much cheaper than building a new `Matching` for each shot.
+
+        Parameters
+        ----------
+        z : numpy.ndarray
+            A binary syndrome vector to decode, in the same format as for `pymatching.Matching.decode`.
+        erased_edges : np.ndarray
+            The indices of the erased edges, in the order of `pymatching.Matching.edges()`.
+        return_weight : bool, optional
+            If `return_weight==True`, the sum of the weights of the edges in the minimum weight perfect matching,
+            in which the erased edges have weight 0, is also returned. By default False
+
+        Returns
+        -------
+        correction : numpy.ndarray or list[int]
+            The predicted logical observables, as for `pymatching.Matching.decode`.
+        weight : float
+            Present only if `return_weight==True`. The sum of the weights of the edges in the solution.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, weight=2)
+        >>> m.add_edge(0, 1, weight=5)
+        >>> m.add_boundary_edge(1, fault_ids={1}, weight=2)
+        >>> m.decode([1, 1])
+        array([1, 1], dtype=uint8)
+        >>> m.decode_with_erasures([1, 1], [1], return_weight=True)
+        (array([0, 0], dtype=uint8), 0.0)
+        """
+        detection_events = self._syndrome_array_to_detection_events(z)
+        erased_edges = np.array(erased_edges, dtype=np.int64).reshape(-1)
+        correction, weight = self._matching_graph.decode_with_erasures(detection_events, erased_edges)
         if return_weight:
             return correction, weight
         else:
@@ -333,7 +503,14 @@ class Matching:
             *,
             return_weights: bool = False,
             bit_packed_shots: bool = False,
-            bit_packed_predictions: bool = False) -> Union[np.ndarray, Tuple[np.ndarray, np.ndarray]]:
+            bit_packed_predictions: bool = False,
+            num_threads: int = 1,
+            return_stats: bool = False,
+            return_latencies: bool = False,
+            enable_correlations: bool = False,
+            largest_shots_first: bool = False,
+            transposed: bool = False
+    ) -> Union[np.ndarray, tuple]:
         """
         Decode from a 2D `shots` array containing a batch of syndrome measurements. A faster
         alternative to using `pymatching.Matching.decode` and iterating over the shots in Python.
@@ -357,13 +534,50 @@ class Matching:
             detection event `m` in shot `s` can be found at ``(dets[s, m // 8] >> (m % 8)) & 1``.
         return_weights : bool
             If True, then also return a numpy array containing the weights of the solutions for all the shots.
-            By default, False.
+            Otherwise no weights array is allocated. By default, False.
         bit_packed_shots : bool
             Set to `True` to provide `shots` as a bit-packed array, such that the bit for
             detection event `m` in shot `s` can be found at ``(dets[s, m // 8] >> (m % 8)) & 1``.
         bit_packed_predictions : bool
             Set to `True` if the returned predictions should be bit-packed, with the bit for fault id `m` in
-            shot `s` in ``(obs[s, m // 8] >> (m % 8)) & 1``
+            shot `s` in ``(obs[s, m // 8] >> (m % 8)) & 1``. If `bit_packed_shots` is also `True` (and none of
+            the weights, stats or latencies are returned), the detection events are read straight from the bit-packed
+            rows and the predictions are written bit-packed as they are found, without unpacking either into a byte
+            per bit.
+        num_threads : int
+            The number of threads to use to decode the batch. Each thread decodes with a separate copy of the
+            decoder, with the GIL released, taking the shots in small ranges until there are none left. The
+            predictions and weights are identical to those obtained using a single thread. By default, 1.
+        return_stats : bool
+            If True, then also return counts of the work done by the decoder for each shot (events processed by
+            type, blossoms created, queue operations, nodes touched and arena high-water marks), which can be used
+            to understand why some shots take much longer to decode than others. Only available if PyMatching was
+            built with the `PYMATCHING_DECODER_STATS` CMake option, otherwise a `ValueError` is raised. By default,
+            False.
+        return_latencies : bool
+            If True, then also return the time taken to decode each shot, in total and broken down into syndrome
+            extraction, flooding and result extraction, for example to find the tail latency (such as the 99.9th
+            percentile) of the decoder. Measuring the latencies adds a small overhead to each shot. By default, False.
+        enable_correlations : bool
+            If True, decode each shot with two rounds of matching to account for correlated errors, as for
+            `pymatching.Matching.decode`. Correlated decoding temporarily modifies the weights of the graph, so
+            `num_threads` is ignored and the shots are decoded by a single thread. The latencies of the phases of
+            decoding are not measured. By default, False.
+        largest_shots_first : bool
+            If True and `num_threads > 1`, the threads start with the shots that have the most detection events,
+            which are usually the slowest to decode, so that a few slow shots aren't left until the end of the
+            batch. The predictions and weights are unaffected. By default, False.
+        transposed : bool
+            Set to `True` to provide `shots` in detector-major (transposed) order, the order in which stim's
+            samplers natively produce them, so that the batch doesn't need to be transposed first. `shots` should
+            then have shape `shots.shape=(syndrome_length, math.ceil(num_shots / 8))`, bit-packed in little endian
+            order on the last axis, so that the bit for detection event `m` in shot `s` can be found at
+            ``(dets[m, s // 8] >> (s % 8)) & 1``. Blocks of 64 shots are read at a time, with the detection events
+            of each shot collected from the set bits of each detector. The predictions are returned transposed in the
+            same way, with shape `(self.num_fault_ids, math.ceil(num_shots / 8))`, and `num_shots` is taken to be
+            `8 * shots.shape[1]` (padding shots have no detection events, so are predicted to have no flipped fault
+            ids). Requires `bit_packed_shots=True` and `bit_packed_predictions=True`, and cannot be used with
+            `return_stats`, `return_latencies` or `enable_correlations`. By default, False.
 
         Returns
         -------
@@ -373,7 +587,14 @@ class Matching:
             fault id `j` was flipped in the shot `i`.
         weights: np.ndarray
             The weights of the MWPM solutions, a numpy array of `dtype=float`. `weights[i]` is the weight of the
-            MWPM solution in shot `i`.
+            MWPM solution in shot `i`. Only returned if `return_weights==True`.
+        stats: Dict[str, np.ndarray]
+            The decoder stats, as a dictionary mapping the name of each stat to a numpy array of `dtype=np.uint64`,
+            with `stats[name][i]` the value of the stat in shot `i`. Only returned if `return_stats==True`.
+        latencies: Dict[str, np.ndarray]
+            The decoding latencies in nanoseconds, as a dictionary mapping each of "total", "syndrome_extraction",
+            "flooding" and "result_extraction" to a numpy array of `dtype=np.uint64`, with `latencies[name][i]` the
+            latency in shot `i`. Only returned if `return_latencies==True`.
 
         Examples
         --------
@@ -416,15 +637,376 @@ class Matching:
         (10000, 1)
         >>> num_errors = np.sum(np.any(predicted_observables != actual_observables, axis=1))
         """
-        predictions, weights = self._matching_graph.decode_batch(
+        if transposed:
+            if not (bit_packed_shots and bit_packed_predictions):
+                raise ValueError("`transposed=True` requires `bit_packed_shots=True` and `bit_packed_predictions=True`.")
+            if return_stats or return_latencies or enable_correlations:
+                raise ValueError("`transposed=True` cannot be used with `return_stats`, `return_latencies` or "
+                                 "`enable_correlations`.")
+            predictions, weights = self._matching_graph.decode_batch_transposed(
+                shots, num_threads=num_threads, return_weights=return_weights
+            )
+            return (predictions, weights) if return_weights else predictions
+        if bit_packed_shots and bit_packed_predictions and not (
+                return_weights or return_stats or return_latencies or enable_correlations or largest_shots_first):
+            return self._matching_graph.decode_batch_bit_packed(shots, num_threads=num_threads)
+        result = self._matching_graph.decode_batch(
             shots,
             bit_packed_predictions=bit_packed_predictions,
-            bit_packed_shots=bit_packed_shots
+            bit_packed_shots=bit_packed_shots,
+            num_threads=num_threads,
+            return_stats=return_stats,
+            return_latencies=return_latencies,
+            enable_correlations=enable_correlations,
+            largest_shots_first=largest_shots_first,
+            return_weights=return_weights
+        )
+        predictions, weights, stats, latencies = result
+        outputs = (predictions,)
+        if return_weights:
+            outputs += (weights,)
+        if return_stats:
+            outputs += ({name: stats[:, k] for k, name in enumerate(_cpp_pm.decoder_stats_field_names)},)
+        if return_latencies:
+            outputs += ({name: latencies[:, k] for k, name in enumerate(_cpp_pm.decode_latency_phase_names)},)
+        return outputs[0] if len(outputs) == 1 else outputs
+
+    def decode_batch_sparse(
+            self,
+            indptr: np.ndarray,
+            indices: np.ndarray,
+            *,
+            return_weights: bool = False,
+            bit_packed_predictions: bool = False,
+            num_threads: int = 1
+    ) -> Union[np.ndarray, Tuple[np.ndarray, np.ndarray]]:
+        """
+        Decode a batch of shots given as lists of detection events in compressed sparse row (CSR) layout, rather
+        than as the dense 2D array taken by `pymatching.Matching.decode_batch`. The detection events of shot `i` are
+        ``indices[indptr[i]:indptr[i+1]]``, the same layout as the rows of a `scipy.sparse.csr_matrix`. Each shot is
+        decoded directly from its slice of `indices`, so the cost of reading a shot is proportional to its number of
+        detection events rather than to the number of detectors, which matters for large graphs at low error rates.
+
+        Parameters
+        ----------
+        indptr : np.ndarray
+            A 1D numpy array of `num_shots + 1` non-decreasing offsets into `indices`, starting at 0 and ending at
+            `len(indices)`.
+        indices : np.ndarray
+            A 1D numpy array of `dtype=np.uint32` or `dtype=np.uint64`, containing the indices of the detection
+            events of each shot in turn. A `np.uint64` array is read without being copied. The detection events of
+            a shot should be distinct. Arrays of other integer dtypes are converted to `np.uint64`.
+        return_weights : bool
+            If True, then also return a numpy array containing the weights of the solutions for all the shots.
+            By default, False.
+        bit_packed_predictions : bool
+            Set to `True` if the returned predictions should be bit-packed, as for `pymatching.Matching.decode_batch`.
+            By default, False.
+        num_threads : int
+            The number of threads to use to decode the batch, as for `pymatching.Matching.decode_batch`. By
+            default, 1.
+
+        Returns
+        -------
+        predictions: np.ndarray
+            The predicted fault ids of each shot, a binary numpy array of `dtype=np.uint8` and shape
+            `(num_shots, self.num_fault_ids)` (or `(num_shots, math.ceil(self.num_fault_ids / 8))` if
+            `bit_packed_predictions==True`).
+        weights: np.ndarray
+            The weights of the MWPM solutions. Only returned if `return_weights==True`.
+
+        Examples
+        --------
+        >>> import numpy as np
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2, fault_ids={2})
+        >>> m.add_boundary_edge(2, fault_ids={3})
+        >>> indptr = np.array([0, 1, 3, 3], dtype=np.uint64)
+        >>> indices = np.array([0, 1, 2], dtype=np.uint32)
+        >>> m.decode_batch_sparse(indptr, indices)
+        array([[1, 0, 0, 0],
+               [0, 0, 1, 0],
+               [0, 0, 0, 0]], dtype=uint8)
+        """
+        indptr = np.ascontiguousarray(indptr, dtype=np.uint64)
+        indices = np.ascontiguousarray(indices)
+        if indices.dtype != np.uint32 and indices.dtype != np.uint64:
+            indices = indices.astype(np.uint64)
+        predictions, weights = self._matching_graph.decode_batch_sparse(
+            indptr,
+            indices,
+            bit_packed_predictions=bit_packed_predictions,
+            num_threads=num_threads,
+            return_weights=return_weights
+        )
+        if return_weights:
+            return predictions, weights
+        return predictions
+
+    def count_logical_errors(
+            self,
+            shots: np.ndarray,
+            actual_observables: np.ndarray,
+            *,
+            bit_packed_shots: bool = False,
+            bit_packed_observables: bool = False,
+            num_threads: int = 1
+    ) -> Tuple[int, np.ndarray]:
+        """
+        Decode a batch of shots, and count the shots whose predicted fault ids differ from `actual_observables`.
+        The predictions are compared with the actual observables as they are decoded, so no array of predictions
+        (or of weights) is returned, which makes this faster than `Matching.decode_batch` for Monte Carlo sampling
+        of the logical error rate, and avoids allocating large output arrays for large batches.
+
+        Parameters
+        ----------
+        shots : np.ndarray
+            A 2D numpy array of shots to decode, of `dtype=np.uint8`, as for `Matching.decode_batch`.
+        actual_observables : np.ndarray
+            A 2D numpy array of `dtype=np.uint8`, with the actual values of the fault ids of each shot, of shape
+            `(num_shots, self.num_fault_ids)`, or of shape `(num_shots, math.ceil(self.num_fault_ids / 8))` if
+            `bit_packed_observables==True`.
+        bit_packed_shots : bool
+            Set to `True` to provide `shots` as a bit-packed array, as for `Matching.decode_batch`. By default, False.
+        bit_packed_observables : bool
+            Set to `True` to provide `actual_observables` as a bit-packed array, in little endian order on the last
+            axis, such that the bit for fault id `m` in shot `s` is ``(obs[s, m // 8] >> (m % 8)) & 1``. By default,
+            False.
+        num_threads : int
+            The number of threads to use, as for `Matching.decode_batch`. By default, 1.
+
+        Returns
+        -------
+        num_errors: int
+            The number of shots in which the prediction of at least one fault id was wrong.
+        errors_per_fault_id: np.ndarray
+            The number of shots in which the prediction of each fault id was wrong, a numpy array of
+            `dtype=np.uint64` with `self.num_fault_ids` elements.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> import stim
+        >>> circuit = stim.Circuit.generated("surface_code:rotated_memory_x",
+        ...                                  distance=5,
+        ...                                  rounds=5,
+        ...                                  after_clifford_depolarization=0.005)
+        >>> model = circuit.detector_error_model(decompose_errors=True)
+        >>> matching = pymatching.Matching.from_detector_error_model(model)
+        >>> sampler = circuit.compile_detector_sampler()
+        >>> syndrome, actual_observables = sampler.sample(shots=1000, separate_observables=True)
+        >>> num_errors, errors_per_fault_id = matching.count_logical_errors(syndrome, actual_observables)
+        >>> predicted_observables = matching.decode_batch(syndrome)
+        >>> num_errors == np.sum(np.any(predicted_observables != actual_observables, axis=1))
+        True
+        """
+        num_errors, errors_per_fault_id = self._matching_graph.count_logical_errors(
+            shots,
+            actual_observables,
+            bit_packed_shots=bit_packed_shots,
+            bit_packed_observables=bit_packed_observables,
+            num_threads=num_threads
+        )
+        return num_errors, errors_per_fault_id
+
+    def decode_batch_with_edge_probabilities(
+            self,
+            shots: np.ndarray,
+            edge_probabilities: np.ndarray,
+            *,
+            return_weights: bool = False,
+            bit_packed_shots: bool = False
+    ) -> Union[np.ndarray, Tuple[np.ndarray, np.ndarray]]:
+        """
+        Decode a batch of shots, as for `pymatching.Matching.decode_batch`, where each shot has its own error
+        probability for every edge. This can be used, for example, to decode with the posterior edge probabilities
+        from a round of belief propagation (as in belief-matching), without returning to Python for every shot.
+
+        The probability `p` of each edge is converted to the weight `log((1-p)/p)`, which is clamped to the largest
+        absolute edge weight in the graph, since the weights are discretized in the same way as the rest of the
+        graph. The weights are patched in place for each shot and restored once the batch is decoded, and the
+        decoding is done without holding the GIL.
+
+        Parameters
+        ----------
+        shots : np.ndarray
+            A 2D numpy array of shots to decode, of `dtype=np.uint8`, as for `pymatching.Matching.decode_batch`.
+        edge_probabilities : np.ndarray
+            A 2D numpy array of shape `(num_shots, num_edges)`, where `edge_probabilities[i, j]` is the probability
+            of an error on edge `j` in shot `i`. The edges are in the order of `pymatching.Matching.edges()`.
+        return_weights : bool
+            If True, then also return a numpy array containing the weights of the solutions for all the shots,
+            using their own edge weights. By default, False.
+        bit_packed_shots : bool
+            Set to `True` to provide `shots` as a bit-packed array, as for `pymatching.Matching.decode_batch`.
+
+        Returns
+        -------
+        predictions: np.ndarray
+            The predicted fault ids of each shot, a binary numpy array of `dtype=np.uint8` and shape
+            `(num_shots, self.num_fault_ids)`.
+        weights: np.ndarray
+            The weights of the MWPM solutions. Only returned if `return_weights==True`.
+
+        Examples
+        --------
+        >>> import numpy as np
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, weight=2.2)
+        >>> m.add_edge(0, 1, weight=1.4)
+        >>> m.add_boundary_edge(1, fault_ids={1}, weight=2.2)
+        >>> shots = np.array([[1, 1], [1, 1]], dtype=np.uint8)
+        >>> probabilities = np.array([[0.1, 0.2, 0.1], [0.4, 0.01, 0.4]])
+        >>> m.decode_batch_with_edge_probabilities(shots, probabilities)
+        array([[0, 0],
+               [1, 1]], dtype=uint8)
+        """
+        shots = np.asarray(shots, dtype=np.uint8)
+        edge_probabilities = np.asarray(edge_probabilities, dtype=np.float64)
+        predictions, weights = self._matching_graph.decode_batch_with_edge_probabilities(
+            shots, edge_probabilities, bit_packed_shots=bit_packed_shots
         )
         if return_weights:
             return predictions, weights
+        return predictions
+
+    def decode_batch_with_erasures(
+            self,
+            shots: np.ndarray,
+            erased_edges: Union[np.ndarray, List[List[int]]],
+            *,
+            return_weights: bool = False,
+            bit_packed_shots: bool = False
+    ) -> Union[np.ndarray, Tuple[np.ndarray, np.ndarray]]:
+        """
+        Decode a batch of shots, as for `pymatching.Matching.decode_batch`, where each shot has its own set of
+        erased edges, which are given weight 0 for that shot only (see `pymatching.Matching.decode_with_erasures`).
+        Only the erased edges of each shot are patched before it is decoded and restored after it, and the decoding
+        is done without holding the GIL.
+
+        Parameters
+        ----------
+        shots : np.ndarray
+            A 2D numpy array of shots to decode, of `dtype=np.uint8`, as for `pymatching.Matching.decode_batch`.
+        erased_edges : np.ndarray or list[list[int]]
+            Either a list containing, for each shot, the indices of its erased edges (in the order of
+            `pymatching.Matching.edges()`), or a 2D boolean numpy array of shape `(num_shots, num_edges)`, where
+            `erased_edges[i, j]` is True if edge `j` was erased in shot `i`.
+        return_weights : bool
+            If True, then also return a numpy array containing the weights of the solutions for all the shots,
+            in which the erased edges have weight 0. By default, False.
+        bit_packed_shots : bool
+            Set to `True` to provide `shots` as a bit-packed array, as for `pymatching.Matching.decode_batch`.
+
+        Returns
+        -------
+        predictions: np.ndarray
+            The predicted fault ids of each shot, a binary numpy array of `dtype=np.uint8` and shape
+            `(num_shots, self.num_fault_ids)`.
+        weights: np.ndarray
+            The weights of the MWPM solutions. Only returned if `return_weights==True`.
+
+        Examples
+        --------
+        >>> import numpy as np
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, weight=2)
+        >>> m.add_edge(0, 1, weight=5)
+        >>> m.add_boundary_edge(1, fault_ids={1}, weight=2)
+        >>> shots = np.array([[1, 1], [1, 1], [1, 0]], dtype=np.uint8)
+        >>> m.decode_batch_with_erasures(shots, [[], [1], [0]])
+        array([[1, 1],
+               [0, 0],
+               [1, 0]], dtype=uint8)
+        """
+        shots = np.asarray(shots, dtype=np.uint8)
+        if isinstance(erased_edges, np.ndarray) and erased_edges.dtype == np.bool_:
+            if erased_edges.ndim != 2 or erased_edges.shape[0] != shots.shape[0]:
+                raise ValueError("A boolean `erased_edges` array should have shape (num_shots, num_edges).")
+            shot_indices, edge_indices = np.nonzero(erased_edges)
+            flat_edges = edge_indices.astype(np.int64)
+            counts = np.bincount(shot_indices, minlength=shots.shape[0])
         else:
-            return predictions
+            if len(erased_edges) != shots.shape[0]:
+                raise ValueError(f"`erased_edges` should have one entry per shot ({shots.shape[0]}), but has "
+                                 f"{len(erased_edges)}.")
+            per_shot = [np.asarray(e, dtype=np.int64).reshape(-1) for e in erased_edges]
+            flat_edges = np.concatenate(per_shot) if per_shot else np.zeros(0, dtype=np.int64)
+            counts = np.array([len(e) for e in per_shot], dtype=np.int64)
+        offsets = np.zeros(shots.shape[0] + 1, dtype=np.int64)
+        np.cumsum(counts, out=offsets[1:])
+        predictions, weights = self._matching_graph.decode_batch_with_erasures(
+            shots, flat_edges, offsets, bit_packed_shots=bit_packed_shots
+        )
+        if return_weights:
+            return predictions, weights
+        return predictions
+
+    def decoder_service(
+            self,
+            num_workers: int = 1,
+            *,
+            worker_cpus: Optional[List[int]] = None,
+            huge_pages: str = "none",
+            replicate_per_numa_node: bool = False
+    ) -> 'pymatching.DecoderService':
+        r"""
+        Start a service that decodes syndromes asynchronously, returning a `concurrent.futures.Future` for each one.
+
+        The matching graph is frozen (see `Matching.freeze`), and each of the `num_workers` worker threads of the
+        service decodes with its own decoder state, which shares the matching graph rather than copying it. Syndromes
+        can be submitted to the service from any thread, and the GIL is only held by a worker to complete a future.
+
+        Parameters
+        ----------
+        num_workers : int
+            The number of worker threads. By default 1
+        worker_cpus : list[int], optional
+            If given, worker `i` is pinned to the CPU `worker_cpus[i % len(worker_cpus)]`. Pinning is only supported
+            on Linux. By default None
+        huge_pages : str
+            How the edges of the matching graph read by the workers are backed by memory pages, for large graphs
+            whose random accesses would otherwise miss the TLB. Either "none", "transparent" (transparent huge
+            pages, requested with `madvise`) or "explicit" (pages from the reserved huge page pool, falling back to
+            transparent huge pages if it is too small). Huge pages are only used on Linux. By default "none"
+        replicate_per_numa_node : bool
+            If True, on a machine with several NUMA nodes, each node gets its own read-only copy of the edges of the
+            matching graph in its local memory, and each worker is assigned to a node (the node of its CPU in
+            `worker_cpus`, or else the nodes in turn, in which case it is pinned to the CPUs of its node) and reads
+            that node's copy. By default False
+
+        Returns
+        -------
+        pymatching.DecoderService
+            The running service, which should be closed once it is no longer needed
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2, fault_ids={2})
+        >>> with m.decoder_service(num_workers=2) as service:
+        ...     futures = [service.submit(z) for z in ([0, 1, 1], [1, 0, 1])]
+        ...     corrections = [f.result() for f in futures]
+        >>> corrections[0]
+        array([0, 0, 1], dtype=uint8)
+        >>> corrections[1]
+        array([0, 1, 1], dtype=uint8)
+        """
+        return pymatching.DecoderService(
+            self,
+            num_workers,
+            worker_cpus=worker_cpus,
+            huge_pages=huge_pages,
+            replicate_per_numa_node=replicate_per_numa_node,
+        )
 
     def decode_to_edges_array(self,
                               syndrome: Union[np.ndarray, List[bool], List[int]]
@@ -572,6 +1154,257 @@ class Matching:
         detection_events = self._syndrome_array_to_detection_events(syndrome)
         return self._matching_graph.decode_to_matched_detection_events_dict(detection_events)
 
+    def decode_batch_to_edges_array(
+            self,
+            shots: np.ndarray,
+            *,
+            bit_packed_shots: bool = False
+    ) -> Tuple[np.ndarray, np.ndarray]:
+        """
+        Decode a batch of shots, returning the edges in the matching solution of every shot in a compressed sparse
+        row (CSR) layout. A faster alternative to calling `pymatching.Matching.decode_to_edges_array` for each shot
+        in Python. The GIL is released while decoding.
+
+        Parameters
+        ----------
+        shots : np.ndarray
+            A 2D numpy array of shots to decode, of `dtype=np.uint8`, in the same format as for
+            `pymatching.Matching.decode_batch`.
+        bit_packed_shots : bool
+            Set to `True` to provide `shots` as a bit-packed array, such that the bit for
+            detection event `m` in shot `s` can be found at ``(dets[s, m // 8] >> (m % 8)) & 1``.
+
+        Returns
+        -------
+        offsets: np.ndarray
+            A 1D numpy array of `dtype=np.int64` and length `num_shots + 1`. The edges in the solution for shot `i`
+            are ``edges[offsets[i]:offsets[i + 1]]``.
+        edges: np.ndarray
+            A 2D numpy array of `dtype=np.int64` and shape `(offsets[-1], 2)`, containing the edges in the solutions
+            of all the shots, in the same format as returned by `pymatching.Matching.decode_to_edges_array`. The
+            boundary is denoted by -1.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> import numpy as np
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0)
+        >>> m.add_edge(0, 1)
+        >>> m.add_edge(1, 2)
+        >>> m.add_edge(2, 3)
+        >>> m.add_edge(3, 4)
+        >>> m.add_edge(4, 5)
+        >>> m.add_edge(5, 6)
+        >>> shots = np.array([[0, 1, 0, 0, 1, 0, 1], [0, 0, 0, 0, 0, 0, 0]], dtype=np.uint8)
+        >>> offsets, edges = m.decode_batch_to_edges_array(shots)
+        >>> print(offsets)
+        [0 4 4]
+        >>> print(edges)
+        [[ 0  1]
+         [ 0 -1]
+         [ 5  4]
+         [ 5  6]]
+        """
+        return self._matching_graph.decode_batch_to_edges_array(shots, bit_packed_shots=bit_packed_shots)
+
+    def decode_batch_to_matched_dets_array(
+            self,
+            shots: np.ndarray,
+            *,
+            bit_packed_shots: bool = False
+    ) -> Tuple[np.ndarray, np.ndarray]:
+        """
+        Decode a batch of shots, returning the pairs of matched detection events (or detection events matched to
+        the boundary) of every shot in a compressed sparse row (CSR) layout. A faster alternative to calling
+        `pymatching.Matching.decode_to_matched_dets_array` for each shot in Python. The GIL is released while
+        decoding. Like `pymatching.Matching.decode_to_matched_dets_array`, this method currently only supports
+        non-negative edge weights.
+
+        Parameters
+        ----------
+        shots : np.ndarray
+            A 2D numpy array of shots to decode, of `dtype=np.uint8`, in the same format as for
+            `pymatching.Matching.decode_batch`.
+        bit_packed_shots : bool
+            Set to `True` to provide `shots` as a bit-packed array, such that the bit for
+            detection event `m` in shot `s` can be found at ``(dets[s, m // 8] >> (m % 8)) & 1``.
+
+        Returns
+        -------
+        offsets: np.ndarray
+            A 1D numpy array of `dtype=np.int64` and length `num_shots + 1`. The pairs of matched detection events
+            for shot `i` are ``pairs[offsets[i]:offsets[i + 1]]``.
+        pairs: np.ndarray
+            A 2D numpy array of `dtype=np.int64` and shape `(offsets[-1], 2)`, containing the matched detection
+            events of all the shots, in the same format as returned by
+            `pymatching.Matching.decode_to_matched_dets_array`. The boundary is denoted by -1.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> import numpy as np
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0)
+        >>> m.add_edge(0, 1)
+        >>> m.add_edge(1, 2)
+        >>> m.add_edge(2, 3)
+        >>> m.add_edge(3, 4)
+        >>> m.add_edge(4, 5)
+        >>> m.add_edge(5, 6)
+        >>> shots = np.array([[0, 1, 0, 0, 1, 0, 1], [0, 0, 0, 0, 0, 0, 0]], dtype=np.uint8)
+        >>> offsets, pairs = m.decode_batch_to_matched_dets_array(shots)
+        >>> print(offsets)
+        [0 2 2]
+        >>> print(pairs)
+        [[ 1 -1]
+         [ 4  6]]
+        """
+        return self._matching_graph.decode_batch_to_matched_detection_events_array(
+            shots, bit_packed_shots=bit_packed_shots)
+
+    def decode_to_outputs(
+            self,
+            syndrome: Union[np.ndarray, List[bool], List[int]],
+            *,
+            prediction: bool = True,
+            weight: bool = False,
+            matched_dets: bool = False,
+            edges: bool = False
+    ) -> Dict[str, Union[np.ndarray, float]]:
+        """
+        Decode the syndrome `syndrome` once, returning any combination of the outputs of `Matching.decode`,
+        `Matching.decode_to_matched_dets_array` and `Matching.decode_to_edges_array`, all from the same matching.
+        This is faster than calling those methods one after the other, which would find the matching again for each
+        of them.
+
+        If `matched_dets` or `edges` is requested, the shot is always decoded with sparse blossom, as for
+        `Matching.decode_to_edges_array`, ignoring any decoder or predecoder set with `Matching.set_decoder` or
+        `Matching.set_predecoder`. Like `Matching.decode_to_matched_dets_array`, requesting `matched_dets` is only
+        supported for graphs with non-negative edge weights.
+
+        Parameters
+        ----------
+        syndrome : numpy.ndarray
+            A binary syndrome vector to decode, in the same format as for `Matching.decode`.
+        prediction : bool
+            If True, return the predicted observables, as returned by `Matching.decode`. By default, True.
+        weight : bool
+            If True, return the weight of the solution. By default, False.
+        matched_dets : bool
+            If True, return the pairs of matched detection events, as returned by
+            `Matching.decode_to_matched_dets_array`. By default, False.
+        edges : bool
+            If True, return the edges in the solution, as returned by `Matching.decode_to_edges_array`. By default,
+            False.
+
+        Returns
+        -------
+        dict
+            A dictionary with an entry for each requested output: "prediction" (a 1D numpy array of `dtype=np.uint8`),
+            "weight" (a float), "matched_dets" and "edges" (2D numpy arrays of `dtype=np.int64` with two columns,
+            with the boundary denoted by -1).
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2)
+        >>> m.add_edge(2, 3)
+        >>> m.add_edge(3, 4)
+        >>> m.add_edge(4, 5)
+        >>> m.add_edge(5, 6)
+        >>> outputs = m.decode_to_outputs([0, 1, 0, 0, 1, 0, 1], weight=True, matched_dets=True, edges=True)
+        >>> print(outputs["prediction"])
+        [1 1]
+        >>> print(outputs["weight"])
+        4.0
+        >>> print(outputs["matched_dets"])
+        [[ 1 -1]
+         [ 4  6]]
+        >>> print(outputs["edges"])
+        [[ 0  1]
+         [ 0 -1]
+         [ 5  4]
+         [ 5  6]]
+        """
+        detection_events = self._syndrome_array_to_detection_events(syndrome)
+        return self._matching_graph.decode_to_outputs(
+            detection_events, prediction=prediction, weight=weight, matched_dets=matched_dets, edges=edges)
+
+    def decode_batch_to_outputs(
+            self,
+            shots: np.ndarray,
+            *,
+            prediction: bool = True,
+            weight: bool = False,
+            matched_dets: bool = False,
+            edges: bool = False,
+            bit_packed_shots: bool = False
+    ) -> Dict[str, Union[np.ndarray, Tuple[np.ndarray, np.ndarray]]]:
+        """
+        Decode a batch of shots, returning any combination of the outputs of `Matching.decode_batch`,
+        `Matching.decode_batch_to_matched_dets_array` and `Matching.decode_batch_to_edges_array`, finding the
+        matching of each shot only once, as `Matching.decode_to_outputs` does. The GIL is released while decoding.
+
+        Parameters
+        ----------
+        shots : np.ndarray
+            A 2D numpy array of shots to decode, of `dtype=np.uint8`, in the same format as for
+            `pymatching.Matching.decode_batch`.
+        prediction : bool
+            If True, return the predicted observables of each shot. By default, True.
+        weight : bool
+            If True, return the weight of the solution of each shot. By default, False.
+        matched_dets : bool
+            If True, return the pairs of matched detection events of each shot. By default, False.
+        edges : bool
+            If True, return the edges in the solution of each shot. By default, False.
+        bit_packed_shots : bool
+            Set to `True` to provide `shots` as a bit-packed array, such that the bit for
+            detection event `m` in shot `s` can be found at ``(dets[s, m // 8] >> (m % 8)) & 1``.
+
+        Returns
+        -------
+        dict
+            A dictionary with an entry for each requested output: "predictions" (a 2D numpy array of
+            `dtype=np.uint8` and shape `(num_shots, self.num_fault_ids)`), "weights" (a 1D numpy array of
+            `dtype=np.float64`), and "matched_dets" and "edges", each an `(offsets, pairs)` tuple in the compressed
+            sparse row layout returned by `Matching.decode_batch_to_matched_dets_array`.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> import numpy as np
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2)
+        >>> m.add_edge(2, 3)
+        >>> shots = np.array([[0, 1, 1, 0], [0, 1, 0, 0]], dtype=np.uint8)
+        >>> outputs = m.decode_batch_to_outputs(shots, weight=True, matched_dets=True)
+        >>> print(outputs["predictions"])
+        [[0 0]
+         [1 1]]
+        >>> print(outputs["weights"])
+        [1. 2.]
+        >>> offsets, pairs = outputs["matched_dets"]
+        >>> print(offsets)
+        [0 1 2]
+        >>> print(pairs)
+        [[ 1  2]
+         [ 1 -1]]
+        """
+        return self._matching_graph.decode_batch_to_outputs(
+            shots,
+            prediction=prediction,
+            weight=weight,
+            matched_dets=matched_dets,
+            edges=edges,
+            bit_packed_shots=bit_packed_shots)
+
     def draw(self) -> None:
         """Draw the matching graph using matplotlib
         Draws the matching graph as a matplotlib graph. Detector nodes are
@@ -668,6 +1501,8 @@ class Matching:
             keeps only the new edge if it has a smaller weight than the existing edge, otherwise the graph is left
             unchanged. The "keep-original" strategy keeps only the existing edge, and ignores the edge being added.
             The "replace" strategy always keeps the edge being added, replacing the existing edge.
+            If the decoder has already been built, replacing or merging an existing edge usually updates it in
+            place, without rebuilding the decoder, as long as the largest absolute edge weight does not change.
             By default, "disallow"
 
         Examples
@@ -751,6 +1586,8 @@ class Matching:
             keeps only the new edge if it has a smaller weight than the existing edge, otherwise the graph is left
             unchanged. The "keep-original" strategy keeps only the existing edge, and ignores the edge being added.
             The "replace" strategy always keeps the edge being added, replacing the existing edge.
+            If the decoder has already been built, replacing or merging an existing edge usually updates it in
+            place, without rebuilding the decoder, as long as the largest absolute edge weight does not change.
             By default, "disallow"
 
         Examples
@@ -786,6 +1623,66 @@ class Matching:
         self._matching_graph.add_boundary_edge(node, fault_ids, weight,
                                                error_probability, merge_strategy)
 
+    def add_edges(
+            self,
+            node1: Union[np.ndarray, List[int]],
+            node2: Union[np.ndarray, List[int]],
+            fault_ids: Union[np.ndarray, List[int], List[List[int]]] = None,
+            weights: Union[np.ndarray, List[float], float] = 1.0,
+            error_probabilities: Union[np.ndarray, List[float], float] = None,
+            *,
+            merge_strategy: str = "disallow"
+    ) -> None:
+        """
+        Add many edges to the matching graph at once
+
+        This is equivalent to calling `Matching.add_edge` (or `Matching.add_boundary_edge`) for each edge in turn,
+        but is much faster when adding a large number of edges.
+
+        Parameters
+        ----------
+        node1: np.ndarray
+            A 1D array of integers, with the index of the first node of each edge
+        node2: np.ndarray
+            A 1D array of integers, with the index of the second node of each edge, or -1 for an edge connecting
+            `node1` to the boundary
+        fault_ids: np.ndarray, optional
+            The fault IDs of each edge. Either a 1D array with a single fault ID for each edge, or a 2D array with one
+            row per edge. Entries of -1 are ignored, so edges can have different numbers of fault IDs. By default None
+        weights: np.ndarray or float, optional
+            The weight of each edge, or a single weight for all the edges. As for `Matching.add_edge`, edges with
+            an absolute weight exceeding 2**24-1=16,777,215 are not added to the graph, and a warning is raised.
+            By default 1.0
+        error_probabilities: np.ndarray or float, optional
+            The error probability of each edge, or a single error probability for all the edges. By default None
+        merge_strategy: str, optional
+            Which strategy to use if an edge is already in the graph (including an edge added earlier in the same
+            call). See `Matching.add_edge` for the available options. By default, "disallow"
+
+        Examples
+        --------
+        >>> import numpy as np
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_edges([0, 1, 2], [1, 2, -1], fault_ids=[[0, -1], [1, 2], [-1, -1]], weights=[1.0, 2.0, 3.0])
+        >>> m.edges()
+        [(0, 1, {'fault_ids': {0}, 'weight': 1.0, 'error_probability': -1.0}), (1, 2, {'fault_ids': {1, 2}, 'weight': 2.0, 'error_probability': -1.0}), (2, None, {'fault_ids': set(), 'weight': 3.0, 'error_probability': -1.0})]
+        """
+        node1 = np.asarray(node1, dtype=np.int64).reshape(-1)
+        node2 = np.asarray(node2, dtype=np.int64).reshape(-1)
+        num_edges = node1.shape[0]
+        if fault_ids is None:
+            fault_ids = np.zeros((num_edges, 0), dtype=np.int64)
+        else:
+            fault_ids = np.asarray(fault_ids, dtype=np.int64)
+            if fault_ids.ndim == 1:
+                fault_ids = fault_ids.reshape(-1, 1)
+        weights = np.broadcast_to(np.asarray(weights, dtype=np.float64), (num_edges,))
+        if error_probabilities is None:
+            error_probabilities = -1.0
+        error_probabilities = np.broadcast_to(np.asarray(error_probabilities, dtype=np.float64), (num_edges,))
+        self._matching_graph.add_edges(node1, node2, fault_ids, weights, error_probabilities, merge_strategy)
+
     def has_edge(self, node1: int, node2: int) -> bool:
         """
         Returns True if edge `(node1, node2)` is in the graph.
@@ -841,24 +1738,150 @@ class Matching:
             A dictionary with keys `fault_ids`, `weight` and `error_probability`, and values giving the respective
             edge attributes
         """
-        return self._matching_graph.get_edge_data(node1, node2)
+        return self._matching_graph.get_edge_data(node1, node2)
+
+    def get_boundary_edge_data(self, node: int) -> Dict[str, Union[Set[int], float]]:
+        """
+        Returns the edge data associated with the boundary edge `(node,)`.
+
+        Parameters
+        ----------
+        node: int
+            The index of the node
+
+        Returns
+        -------
+        dict
+            A dictionary with keys `fault_ids`, `weight` and `error_probability`, and values giving the respective
+            boundary edge attributes
+        """
+        return self._matching_graph.get_boundary_edge_data(node)
+
+    def get_boundary_distances(
+            self,
+            return_fault_ids: bool = False
+    ) -> Union[np.ndarray, Tuple[np.ndarray, np.ndarray]]:
+        """
+        Returns the length of a shortest path from each node to the boundary.
+
+        The distances are computed once (with a single Dijkstra search outwards from the boundary) and cached until
+        the graph is next modified. Once computed, they are also used to speed up decoding of syndromes with very
+        few detection events. The distances are computed using the same discretised edge weights as the decoder,
+        so may differ slightly from the exact distances when the edge weights are not integers.
+
+        Parameters
+        ----------
+        return_fault_ids: bool
+            If True, also return the fault ids flipped along the shortest path found from each node to the
+            boundary. Only supported if the fault ids fit in the decoder's bit packed observable masks (at most
+            64 fault ids, unless PyMatching was built with a larger PYMATCHING_MAX_BIT_PACKED_OBSERVABLES).
+            By default, False
+
+        Returns
+        -------
+        numpy.ndarray or tuple[numpy.ndarray, numpy.ndarray]
+            A float64 array of shape `(num_nodes,)` giving the distance from each node to the boundary, which is
+            `numpy.inf` for nodes that are not connected to the boundary (and 0 for boundary nodes). If
+            `return_fault_ids` is True, also returns a uint8 array of shape `(num_nodes, num_fault_ids)`, where
+            element `[i, j]` is 1 if fault id `j` is flipped by the path from node `i` to the boundary.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, weight=1)
+        >>> m.add_edge(0, 1, weight=2)
+        >>> m.add_edge(1, 2, weight=1)
+        >>> m.add_boundary_edge(2, fault_ids={1}, weight=1)
+        >>> m.get_boundary_distances()
+        array([1., 2., 1.])
+        >>> distances, fault_ids = m.get_boundary_distances(return_fault_ids=True)
+        >>> fault_ids
+        array([[1, 0],
+               [0, 1],
+               [0, 1]], dtype=uint8)
+        """
+        return self._matching_graph.get_boundary_distances(return_observables=return_fault_ids)
+
+    def shortest_paths(
+            self,
+            sources: Union[np.ndarray, List[int]],
+            targets: Union[np.ndarray, List[int]],
+            num_threads: int = 1
+    ) -> Tuple[np.ndarray, np.ndarray, np.ndarray]:
+        """
+        Finds a shortest path between each pair of nodes `(sources[i], targets[i])`.
+
+        Pairs sharing the same source are answered by a single Dijkstra search from that source, which stops once
+        all of its targets have been reached, so querying many paths at once is much faster than querying them one
+        at a time. The searches for different sources can be run in parallel. As for `get_boundary_distances`, the
+        distances use the same discretised edge weights as the decoder.
+
+        Parameters
+        ----------
+        sources: np.ndarray or list[int]
+            The first node of each path. A negative index, or a node in the boundary, denotes the boundary.
+        targets: np.ndarray or list[int]
+            The last node of each path, of the same length as `sources`. A negative index, or a node in the
+            boundary, denotes the boundary. A path cannot both start and end at the boundary.
+        num_threads: int
+            The number of threads used to search from distinct sources. By default, 1
+
+        Returns
+        -------
+        tuple[numpy.ndarray, numpy.ndarray, numpy.ndarray]
+            `(offsets, nodes, distances)`, where the nodes on the path for pair `i` (from its source to its target,
+            excluding the boundary) are `nodes[offsets[i]:offsets[i + 1]]`, and `distances[i]` is its length. If
+            there is no path for pair `i`, its path is empty and `distances[i]` is `numpy.inf`.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, weight=1)
+        >>> m.add_edge(0, 1, weight=2)
+        >>> m.add_edge(1, 2, weight=1)
+        >>> offsets, nodes, distances = m.shortest_paths([0, 2], [2, -1])
+        >>> offsets
+        array([0, 3, 6])
+        >>> nodes
+        array([0, 1, 2, 2, 1, 0])
+        >>> distances
+        array([3., 4.])
+        """
+        sources = np.asarray(sources, dtype=np.int64).ravel()
+        targets = np.asarray(targets, dtype=np.int64).ravel()
+        return self._matching_graph.shortest_paths(sources, targets, num_threads=num_threads)
 
-    def get_boundary_edge_data(self, node: int) -> Dict[str, Union[Set[int], float]]:
+    def distances_from(self, source: int) -> np.ndarray:
         """
-        Returns the edge data associated with the boundary edge `(node,)`.
+        Returns the length of a shortest path from `source` to each node, using a single Dijkstra search.
 
         Parameters
         ----------
-        node: int
-            The index of the node
+        source: int
+            The node to search from. A negative index, or a node in the boundary, denotes the boundary.
 
         Returns
         -------
-        dict
-            A dictionary with keys `fault_ids`, `weight` and `error_probability`, and values giving the respective
-            boundary edge attributes
+        numpy.ndarray
+            A float64 array of shape `(num_nodes,)` giving the distance from `source` to each node, which is
+            `numpy.inf` for nodes that cannot be reached. Boundary nodes are at the distance of the boundary from
+            `source`.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, weight=1)
+        >>> m.add_edge(0, 1, weight=2)
+        >>> m.add_edge(1, 2, weight=1)
+        >>> m.distances_from(2)
+        array([3., 1., 0.])
+        >>> m.distances_from(-1)
+        array([1., 3., 4.])
         """
-        return self._matching_graph.get_boundary_edge_data(node)
+        return self._matching_graph.distances_from(source)
 
     def edges(self) -> List[Tuple[int, Optional[int], Dict]]:
         """Edges of the matching graph
@@ -1112,6 +2135,7 @@ class Matching:
         >>> m
         <pymatching.Matching object with 2 detectors, 1 boundary node, and 3 edges>
         """
+        self._check_not_frozen()
         if check_matrix is None:
             check_matrix = kwargs.get("H", None)
             if check_matrix is None:
@@ -1190,7 +2214,11 @@ class Matching:
                                                                                     faults_matrix)
 
     @staticmethod
-    def from_detector_error_model(model: 'stim.DetectorErrorModel') -> 'pymatching.Matching':
+    def from_detector_error_model(
+            model: 'stim.DetectorErrorModel',
+            *,
+            enable_correlations: bool = False
+    ) -> 'pymatching.Matching':
         """
         Constructs a `pymatching.Matching` object by loading from a `stim.DetectorErrorModel`.
 
@@ -1217,6 +2245,9 @@ class Matching:
         model : stim.DetectorErrorModel
             A stim DetectorErrorModel, with all error mechanisms either graphlike, or decomposed into graphlike
             error mechanisms
+        enable_correlations : bool
+            If True, also record which graphlike error mechanisms come from the same decomposed error mechanism, so
+            that the `Matching` can be decoded with `enable_correlations=True`. By default, False.
 
         Returns
         -------
@@ -1237,11 +2268,13 @@ class Matching:
         <pymatching.Matching object with 120 detectors, 0 boundary nodes, and 502 edges>
         """
         m = Matching()
-        m._load_from_detector_error_model(model)
+        m._load_from_detector_error_model(model, enable_correlations=enable_correlations)
         return m
 
     @staticmethod
-    def from_detector_error_model_file(dem_path: str) -> 'pymatching.Matching':
+    def from_detector_error_model_file(
+        dem_path: str, *, enable_correlations: bool = False, cache_dir: Optional[str] = None
+    ) -> 'pymatching.Matching':
         """
         Construct a `pymatching.Matching` by loading from a stim DetectorErrorModel file path.
 
@@ -1249,6 +2282,15 @@ class Matching:
         ----------
         dem_path : str
             The path of the detector error model file
+        enable_correlations : bool
+            If True, record the correlations between edges needed to decode with `enable_correlations=True`, as for
+            `pymatching.Matching.from_detector_error_model`. By default, False.
+        cache_dir : str, optional
+            A directory in which to cache the built decoding graph, keyed by a hash of the contents of the file. If
+            the graph of a file with the same contents was already cached there, it is loaded (as by
+            `pymatching.Matching.from_graph_file`) instead of being rebuilt. Otherwise, it is built and saved there
+            for later runs. The directory is created if needed, and may be shared by any number of processes. Can't
+            be used with `enable_correlations=True`. By default, None (no cache).
 
         Returns
         -------
@@ -1257,11 +2299,13 @@ class Matching:
             in the file `dem_path`
         """
         m = Matching()
-        m._matching_graph = _cpp_pm.detector_error_model_file_to_matching_graph(dem_path)
+        m._matching_graph = _cpp_pm.detector_error_model_file_to_matching_graph(
+            dem_path, enable_correlations=enable_correlations, cache_dir=cache_dir
+        )
         return m
 
     @staticmethod
-    def from_stim_circuit(circuit: 'stim.Circuit') -> 'pymatching.Matching':
+    def from_stim_circuit(circuit: 'stim.Circuit', *, enable_correlations: bool = False) -> 'pymatching.Matching':
         """
         Constructs a `pymatching.Matching` object by loading from a `stim.Circuit`
 
@@ -1270,6 +2314,9 @@ class Matching:
         circuit : stim.Circuit
             A stim circuit containing error mechanisms that are all either graphlike, or decomposable into
             graphlike error mechanisms
+        enable_correlations : bool
+            If True, record the correlations between edges needed to decode with `enable_correlations=True`, as for
+            `pymatching.Matching.from_detector_error_model`. By default, False.
 
         Returns
         -------
@@ -1303,12 +2350,14 @@ class Matching:
             raise TypeError(f"`circuit` must be a `stim.Circuit`. Instead, got {type(circuit)}")
         m = Matching()
         m._matching_graph = _cpp_pm.detector_error_model_to_matching_graph(
-            str(circuit.detector_error_model(decompose_errors=True))
+            str(circuit.detector_error_model(decompose_errors=True)), enable_correlations=enable_correlations
         )
         return m
 
     @staticmethod
-    def from_stim_circuit_file(stim_circuit_path: str) -> 'pymatching.Matching':
+    def from_stim_circuit_file(
+        stim_circuit_path: str, *, enable_correlations: bool = False, cache_dir: Optional[str] = None
+    ) -> 'pymatching.Matching':
         """
         Construct a `pymatching.Matching` by loading from a stim circuit file path.
 
@@ -1316,6 +2365,13 @@ class Matching:
         ----------
         stim_circuit_path : str
             The path of the stim circuit file
+        enable_correlations : bool
+            If True, record the correlations between edges needed to decode with `enable_correlations=True`, as for
+            `pymatching.Matching.from_detector_error_model`. By default, False.
+        cache_dir : str, optional
+            A directory in which to cache the built decoding graph, as for
+            `pymatching.Matching.from_detector_error_model_file`, so that later runs with the same circuit skip
+            converting it to a detector error model as well as building the graph. By default, None (no cache).
 
         Returns
         -------
@@ -1325,10 +2381,189 @@ class Matching:
             mechanisms. Parallel edges are merged using `merge_strategy="independent"`.
         """
         m = Matching()
-        m._matching_graph = _cpp_pm.stim_circuit_file_to_matching_graph(stim_circuit_path)
+        m._matching_graph = _cpp_pm.stim_circuit_file_to_matching_graph(
+            stim_circuit_path, enable_correlations=enable_correlations, cache_dir=cache_dir
+        )
+        return m
+
+    @staticmethod
+    def from_graph_file(path: str) -> 'pymatching.Matching':
+        """
+        Construct a `pymatching.Matching` by loading a graph file written by `pymatching.Matching.save_graph`.
+
+        Loading a graph file is much faster than constructing the `pymatching.Matching` from the stim
+        DetectorErrorModel or circuit it was built from, since the decoding graph does not need to be rebuilt.
+
+        Parameters
+        ----------
+        path : str
+            The path of the graph file
+
+        Returns
+        -------
+        pymatching.Matching
+            A `pymatching.Matching` object with the same edges and boundary nodes as the one that saved the graph
+            file, and which gives identical solutions
+
+        Examples
+        --------
+        >>> import os
+        >>> import tempfile
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_edge(0, 1, fault_ids={0}, weight=2)
+        >>> m.add_boundary_edge(1, weight=1.5)
+        >>> path = os.path.join(tempfile.mkdtemp(), "graph.pmg")
+        >>> m.save_graph(path)
+        >>> m2 = pymatching.Matching.from_graph_file(path)
+        >>> m2.num_edges
+        2
+        >>> m2.decode([1, 0])
+        array([1], dtype=uint8)
+        """
+        m = Matching()
+        m._matching_graph = _cpp_pm.graph_file_to_matching_graph(path)
+        return m
+
+    @staticmethod
+    def attach_graph_file(path: str) -> 'pymatching.Matching':
+        """
+        Construct a read-only `pymatching.Matching` attached to a graph file written by
+        `pymatching.Matching.save_graph`, without loading it.
+
+        Unlike `pymatching.Matching.from_graph_file`, the file is mapped into memory and the decoding graph
+        is used in place, rather than copied, so attaching is almost instant even for very large graphs, and
+        every process attached to the same file shares a single copy of the decoding graph. Only the state
+        used while decoding is allocated by each process. The edges of the graph are not loaded, so the
+        attached `pymatching.Matching` is frozen (see `pymatching.Matching.freeze`) and can only be used for
+        decoding: methods that read its edges, such as `pymatching.Matching.edges` or
+        `pymatching.Matching.add_noise`, raise a `ValueError`. The file must not be modified while it is
+        attached (to update it, write a new file and rename it over the old one).
+
+        Parameters
+        ----------
+        path : str
+            The path of the graph file
+
+        Returns
+        -------
+        pymatching.Matching
+            A frozen `pymatching.Matching` object which gives identical solutions to the one that saved the
+            graph file
+
+        Examples
+        --------
+        >>> import os
+        >>> import tempfile
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_edge(0, 1, fault_ids={0}, weight=2)
+        >>> m.add_boundary_edge(1, weight=1.5)
+        >>> path = os.path.join(tempfile.mkdtemp(), "graph.pmg")
+        >>> m.save_graph(path)
+        >>> m2 = pymatching.Matching.attach_graph_file(path)
+        >>> m2.frozen
+        True
+        >>> m2.decode([1, 0])
+        array([1], dtype=uint8)
+        """
+        m = Matching()
+        m._matching_graph = _cpp_pm.attach_graph_file_to_matching_graph(path)
+        return m
+
+    def save_to_shared_memory(self, name: str) -> None:
+        """
+        Saves the matching graph to the POSIX shared memory object `name`, in the format of a graph file,
+        so that other processes can attach to it with `pymatching.Matching.attach_shared_memory`.
+
+        Any graph previously saved with the same name is replaced, but processes already attached to it
+        keep using it. The shared memory is not freed when the processes using it exit: it must be removed
+        with `pymatching.Matching.remove_shared_memory`. Shared memory is not supported on Windows.
+
+        Parameters
+        ----------
+        name : str
+            The name of the shared memory object, which is prefixed with a slash if it doesn't start with one
+        """
+        self._matching_graph.save_to_shared_memory(name)
+
+    @staticmethod
+    def attach_shared_memory(name: str) -> 'pymatching.Matching':
+        """
+        Construct a read-only `pymatching.Matching` attached to a graph saved in shared memory with
+        `pymatching.Matching.save_to_shared_memory`, in the same way as `pymatching.Matching.attach_graph_file`.
+
+        Parameters
+        ----------
+        name : str
+            The name the graph was saved with
+
+        Returns
+        -------
+        pymatching.Matching
+            A frozen `pymatching.Matching` object which gives identical solutions to the one that saved the graph
+
+        Examples
+        --------
+        >>> import os
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_edge(0, 1, fault_ids={0}, weight=2)
+        >>> m.add_boundary_edge(1, weight=1.5)
+        >>> name = f"pymatching_example_{os.getpid()}"
+        >>> m.save_to_shared_memory(name)
+        >>> m2 = pymatching.Matching.attach_shared_memory(name)
+        >>> pymatching.Matching.remove_shared_memory(name)
+        True
+        >>> m2.decode([1, 0])
+        array([1], dtype=uint8)
+        """
+        m = Matching()
+        m._matching_graph = _cpp_pm.attach_shared_memory_to_matching_graph(name)
         return m
 
-    def _load_from_detector_error_model(self, model: 'stim.DetectorErrorModel') -> None:
+    @staticmethod
+    def remove_shared_memory(name: str) -> bool:
+        """
+        Removes a graph saved with `pymatching.Matching.save_to_shared_memory`. Processes that are attached
+        to it can keep using it, and its memory is freed once they have all been deleted.
+
+        Parameters
+        ----------
+        name : str
+            The name the graph was saved with
+
+        Returns
+        -------
+        bool
+            True if the graph was removed, or False if there is no graph saved with this name
+        """
+        return _cpp_pm.remove_shared_memory_graph(name)
+
+    def save_graph(self, path: str) -> None:
+        """
+        Saves the matching graph to a binary graph file, which can be loaded with
+        `pymatching.Matching.from_graph_file`.
+
+        The file contains the edges of the graph as well as the decoding graph built from them, so
+        that loading it does not need to rebuild the decoding graph. The file format is specific to
+        the platform and build of PyMatching that wrote it, and an error is raised if it is loaded by
+        an incompatible build.
+
+        Parameters
+        ----------
+        path : str
+            The path of the graph file to write
+        """
+        self._matching_graph.save_graph_file(path)
+
+    def _load_from_detector_error_model(
+            self,
+            model: 'stim.DetectorErrorModel',
+            *,
+            enable_correlations: bool = False
+    ) -> None:
+        self._check_not_frozen()
         try:
             import stim
         except ImportError:  # pragma no cover
@@ -1339,7 +2574,9 @@ class Matching:
             )
         if not isinstance(model, stim.DetectorErrorModel):
             raise TypeError(f"'model' must be `stim.DetectorErrorModel`. Instead, got: {type(model)}")
-        self._matching_graph = _cpp_pm.detector_error_model_to_matching_graph(str(model))
+        self._matching_graph = _cpp_pm.detector_error_model_to_matching_graph(
+            str(model), enable_correlations=enable_correlations
+        )
 
     @staticmethod
     def from_networkx(graph: nx.Graph, *, min_num_fault_ids: int = None) -> 'pymatching.Matching':
@@ -1440,6 +2677,7 @@ class Matching:
         >>> m
         <pymatching.Matching object with 1 detector, 2 boundary nodes, and 2 edges>
         """
+        self._check_not_frozen()
 
         if not isinstance(graph, nx.Graph):
             raise TypeError("G must be a NetworkX graph")
@@ -1529,6 +2767,7 @@ class Matching:
         >>> m
         <pymatching.Matching object with 1 detector, 2 boundary nodes, and 2 edges>
         """
+        self._check_not_frozen()
         try:
             import rustworkx as rx
         except ImportError:  # pragma no cover
@@ -1682,6 +2921,422 @@ class Matching:
         """
         self._matching_graph.set_min_num_observables(min_num_fault_ids)
 
+    def set_syndrome_cache_capacity(self, capacity: int) -> None:
+        """
+        Set the number of syndromes whose solutions are remembered, so that repeated syndromes are decoded without
+        running the blossom algorithm again.
+
+        At low physical error rates, the same few syndromes (for example, pairs of adjacent detection events) recur
+        in a large fraction of shots. With a non-zero capacity, each decoder (including the separate decoder used by
+        each thread of `Matching.decode_batch`) keeps a cache of the solutions of recently decoded syndromes, keyed on
+        their detection events. Syndromes with more than 16 detection events, and graphs with too many fault ids to
+        be decoded with a bit mask, are not cached. The cached solutions are forgotten whenever the graph is modified.
+        The cache must be set up before calling `Matching.freeze`.
+
+        Parameters
+        ----------
+        capacity: int
+            The maximum number of syndromes cached by each decoder (rounded up to a power of two). A capacity of zero
+            (the default) disables the cache.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2, fault_ids={2})
+        >>> m.set_syndrome_cache_capacity(1024)
+        >>> for _ in range(3):
+        ...     correction = m.decode([0, 1, 1])
+        >>> correction
+        array([0, 0, 1], dtype=uint8)
+        >>> m.syndrome_cache_stats
+        {'hits': 2, 'misses': 1}
+        """
+        self._check_not_frozen()
+        if capacity < 0:
+            raise ValueError(f"The syndrome cache capacity must be non-negative, not {capacity}.")
+        self._matching_graph.set_syndrome_cache_capacity(capacity)
+
+    @property
+    def syndrome_cache_stats(self) -> Dict[str, int]:
+        """
+        The number of lookups in the syndrome caches (see `Matching.set_syndrome_cache_capacity`) that found
+        ("hits") and didn't find ("misses") the solution of the syndrome being decoded, since the graph was last
+        modified
+
+        Returns
+        -------
+        dict
+            A dictionary with keys "hits" and "misses"
+        """
+        hits, misses = self._matching_graph.get_syndrome_cache_counts()
+        return {"hits": hits, "misses": misses}
+
+    def set_path_threads(self, num_threads: int) -> None:
+        """
+        Set the number of threads used to find the paths between matched detection events in a shot.
+
+        After the matching is found, each pair of matched detection events (or detection event matched to the
+        boundary) is joined by a shortest path through the graph, found with a separate Dijkstra search. This is
+        needed by `Matching.decode_to_edges_array`, and by the decoding methods when there are too many fault ids
+        to be tracked during matching (more than 64). For shots with hundreds of matches, finding the paths can take
+        longer than finding the matching, so the searches can be split between `num_threads` threads (including the
+        thread decoding the shot), each with its own search state sharing the graph. The solutions are the same for
+        any number of threads. Shots with few matches are still searched by the decoding thread alone. The number of
+        threads must be set before calling `Matching.freeze`.
+
+        Parameters
+        ----------
+        num_threads: int
+            The number of threads used to find the paths of a shot. By default 1
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2, fault_ids={2})
+        >>> m.set_path_threads(4)
+        >>> m.path_threads
+        4
+        >>> m.decode([0, 1, 1])
+        array([0, 0, 1], dtype=uint8)
+        """
+        self._check_not_frozen()
+        if num_threads < 1:
+            raise ValueError(f"The number of path threads must be at least 1, not {num_threads}.")
+        self._matching_graph.set_num_path_threads(num_threads)
+
+    @property
+    def path_threads(self) -> int:
+        """
+        The number of threads used to find the paths between matched detection events in a shot (see
+        `Matching.set_path_threads`)
+
+        Returns
+        -------
+        int
+            The number of threads
+        """
+        return self._matching_graph.get_num_path_threads()
+
+    def set_decoder(self, decoder: str) -> None:
+        """
+        Set the algorithm used to decode shots.
+
+        By default (`"sparse_blossom"`), shots are decoded exactly, by finding a minimum weight perfect matching with
+        the sparse blossom algorithm. With `"union_find"` (or `"uf"`), shots are instead decoded with the weighted
+        Union-Find decoder, over the same graph: clusters grow from the detection events along the edges (at a rate
+        set by their weights) until each has an even number of detection events or reaches the boundary, and a
+        spanning forest of each cluster is then peeled to find a correction. This takes time almost linear in the
+        size of the clusters, so is usually faster, but the correction is not always of minimum weight, which leads
+        to a higher logical error rate. The decoder is used by `Matching.decode`, `Matching.decode_batch` and the
+        other methods returning predicted fault ids, but not by the methods returning matched edges or detection
+        events, which always use sparse blossom. The decoder must be set before calling `Matching.freeze`.
+
+        Parameters
+        ----------
+        decoder: str
+            Either `"sparse_blossom"`, or `"union_find"` (or `"uf"`). By default `"sparse_blossom"`
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2, fault_ids={2})
+        >>> m.set_decoder("uf")
+        >>> m.decoder
+        'union_find'
+        >>> m.decode([0, 1, 1])
+        array([0, 0, 1], dtype=uint8)
+        """
+        self._check_not_frozen()
+        self._matching_graph.set_decoder_engine(decoder)
+
+    @property
+    def decoder(self) -> str:
+        """
+        The algorithm used to decode shots, either `"sparse_blossom"` or `"union_find"` (see
+        `Matching.set_decoder`)
+
+        Returns
+        -------
+        str
+            The name of the decoder
+        """
+        return self._matching_graph.get_decoder_engine()
+
+    def set_predecoder(self, mode: str) -> None:
+        """
+        Set which pairs of adjacent detection events are matched by a predecoder before sparse blossom is run.
+
+        At low physical error rates, most detection events come in pairs joined by a single edge. With a predecoder,
+        such pairs are matched by a quick pass over the detection events of each shot, and only the other
+        detection events are matched by sparse blossom. With `"exact"`, a pair (u, v) joined by an edge of weight w
+        is only matched if every other edge from u (to a node or to the boundary) is longer, by more than w, than an
+        edge from v to the same node (or to the boundary), which guarantees that every minimum weight perfect
+        matching pairs u with v, so the solution weight is unchanged. This is always the case for a node whose only
+        edge is to v. With `"approximate"`, a pair is also matched if their edge is the lightest edge of both u and
+        v, and neither has another neighbour with a detection event. This matches many more pairs, and so is faster,
+        but is not always correct, which can increase the logical error rate. The predecoder is used by
+        `Matching.decode`, `Matching.decode_batch` and the other methods returning predicted fault ids, but is
+        skipped for graphs with negative edge weights or more than 64 fault ids. The predecoder must be set before
+        calling `Matching.freeze`.
+
+        Parameters
+        ----------
+        mode: str
+            Either `"off"`, `"exact"` or `"approximate"`. By default `"off"`
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2, fault_ids={2})
+        >>> m.add_edge(2, 3, fault_ids={3})
+        >>> m.add_boundary_edge(3, fault_ids={4})
+        >>> m.set_predecoder("approximate")
+        >>> m.predecoder
+        'approximate'
+        >>> m.decode([0, 1, 1, 0])
+        array([0, 0, 1, 0, 0], dtype=uint8)
+        """
+        self._check_not_frozen()
+        self._matching_graph.set_predecoder_mode(mode)
+
+    @property
+    def predecoder(self) -> str:
+        """
+        Which pairs of adjacent detection events are matched before sparse blossom is run, either `"off"`,
+        `"exact"` or `"approximate"` (see `Matching.set_predecoder`)
+
+        Returns
+        -------
+        str
+            The predecoder mode
+        """
+        return self._matching_graph.get_predecoder_mode()
+
+    def set_work_budget(self, max_flood_check_events: int = 0, max_microseconds: float = 0) -> None:
+        """
+        Set the most work sparse blossom may do to decode a shot, to bound the worst case decoding latency.
+
+        A shot that runs out of budget is abandoned, and decoded instead with the weighted Union-Find decoder (see
+        `Matching.set_decoder`), which takes time almost linear in the number of detection events but does not
+        always find a minimum weight correction. Such shots are counted in `Matching.num_degraded_shots` (and, when
+        PyMatching is built with decoder stats, in the `"degraded_shots"` stat returned by
+        `Matching.decode_batch`). The budget is checked each time sparse blossom finds regions colliding or
+        reaching the boundary, so a shot may overrun it slightly. A limit of 0 is no limit. The budget applies to
+        `Matching.decode`, `Matching.decode_batch` and the other methods returning predicted fault ids, and must be
+        set before calling `Matching.freeze`.
+
+        Parameters
+        ----------
+        max_flood_check_events: int
+            The most events that may be taken from the flooder's queue while decoding a shot. By default 0 (no
+            limit)
+        max_microseconds: float
+            The most time that may be spent flooding a shot, in microseconds. By default 0 (no limit)
+
+        Examples
+        --------
+        >>> import numpy as np
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> for i in range(11):
+        ...     m.add_edge(i, i + 1, fault_ids={i})
+        >>> m.add_boundary_edge(11, fault_ids={11})
+        >>> m.set_work_budget(max_flood_check_events=1)
+        >>> correction = m.decode(np.ones(12, dtype=np.uint8))
+        >>> m.num_degraded_shots
+        1
+        """
+        self._check_not_frozen()
+        if max_flood_check_events < 0 or max_microseconds < 0:
+            raise ValueError("The work budget must be non-negative.")
+        self._matching_graph.set_work_budget(max_flood_check_events, int(np.ceil(max_microseconds * 1000)))
+
+    @property
+    def num_degraded_shots(self) -> int:
+        """
+        The number of shots that ran out of work budget (see `Matching.set_work_budget`) and were decoded
+        approximately, since the graph was last modified
+
+        Returns
+        -------
+        int
+            The number of degraded shots
+        """
+        return self._matching_graph.get_num_degraded_shots()
+
+    def freeze(self) -> None:
+        """
+        Make the matching graph immutable, so that it can be decoded by several threads at once.
+
+        Once frozen, the graph can no longer be modified (methods such as `Matching.add_edge` or
+        `Matching.set_boundary_nodes` raise a `ValueError`), and methods that temporarily override its edge
+        weights (`Matching.decode_with_weight_overrides`, `Matching.decode_batch_with_edge_probabilities` and
+        correlated decoding) are not available. Each thread calling a decoding method, such as `Matching.decode`
+        or `Matching.decode_batch`, transparently uses its own decoder state from a pool owned by the `Matching`
+        object, and the GIL is released while decoding. A single frozen `Matching` can therefore be shared by
+        threads serving concurrent requests, instead of creating a copy of it per thread. Freezing can't be
+        undone.
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> from concurrent.futures import ThreadPoolExecutor
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0})
+        >>> m.add_edge(0, 1, fault_ids={1})
+        >>> m.add_edge(1, 2, fault_ids={2})
+        >>> m.freeze()
+        >>> m.frozen
+        True
+        >>> with ThreadPoolExecutor(max_workers=2) as pool:
+        ...     corrections = list(pool.map(m.decode, [[0, 1, 1], [1, 0, 1]]))
+        >>> corrections[0]
+        array([0, 0, 1], dtype=uint8)
+        >>> corrections[1]
+        array([0, 1, 1], dtype=uint8)
+        """
+        self._matching_graph.freeze()
+
+    @property
+    def frozen(self) -> bool:
+        """
+        Whether the matching graph has been made immutable with `Matching.freeze`
+
+        Returns
+        -------
+        bool
+            True if the matching graph is frozen
+        """
+        return self._matching_graph.is_frozen()
+
+    def warm_up(
+            self,
+            num_shots: int,
+            *,
+            expected_detection_events: int = 0,
+            num_threads: int = 1,
+            seed: Optional[int] = None
+    ) -> Dict[str, int]:
+        """
+        Allocate the memory used while decoding ahead of time, so that the first shots decoded are not slowed down.
+
+        The decoder grows its memory (for regions, alternating tree nodes, its event queue and scratch buffers) as
+        it needs it, and keeps it for later shots, so the first shots decoded after a `Matching` is created or
+        modified are usually much slower than the rest. This grows the memory of the decoders used by
+        `Matching.decode`, and by each of the `num_threads` threads of `Matching.decode_batch`, by first reserving
+        room for `expected_detection_events` detection events and then decoding `num_shots` shots sampled from the
+        error probabilities of the edges (see `Matching.add_noise_batch`). The shots sampled don't count towards
+        `Matching.syndrome_cache_stats`.
+
+        Parameters
+        ----------
+        num_shots : int
+            The number of sampled shots to decode with each decoder. Must be zero if not all edges have error
+            probabilities
+        expected_detection_events : int
+            The number of detection events to reserve memory for, e.g. a generous estimate of the largest number of
+            detection events in a shot. By default 0
+        num_threads : int
+            The number of decoders to warm up: those of the first `num_threads` threads of a batch, or, if the graph
+            is frozen (see `Matching.freeze`), the first `num_threads` decoders taken from its pool. By default 1
+        seed : int, optional
+            The seed used to sample the shots. By default, a random seed is used
+
+        Returns
+        -------
+        dict
+            The high-water marks reached: the largest number of "regions", "alt_tree_nodes", "queue_events",
+            "match_edges", "reached_nodes" and "shatter_stack" entries that any of the decoders holds memory for
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, error_probability=0.1)
+        >>> for i in range(99):
+        ...     m.add_edge(i, i + 1, fault_ids={i + 1}, error_probability=0.1)
+        >>> capacity = m.warm_up(100, expected_detection_events=50, seed=0)
+        >>> capacity["regions"] >= 100
+        True
+        """
+        if num_shots < 0 or expected_detection_events < 0:
+            raise ValueError("The number of shots and of expected detection events must be non-negative.")
+        if num_threads < 1:
+            raise ValueError(f"num_threads must be at least 1, not {num_threads}.")
+        if seed is None:
+            seed = int(np.random.SeedSequence().generate_state(1, dtype=np.uint64)[0])
+        return self._matching_graph.warm_up(num_threads, num_shots, expected_detection_events, seed)
+
+    def memory_usage(self) -> Dict[str, int]:
+        """
+        The memory held by the matching graph and its decoders, in bytes.
+
+        The memory is broken down by what holds it, so that it can be used to size containers or to choose how many
+        threads to decode with. The structure of the graph is shared by all of its decoders (those of the threads of
+        `Matching.decode_batch`, and the pool of a frozen graph), and is only counted once, while each decoder holds
+        its own per-node state and the state of the blossom algorithm. Decoders are created when first needed, so
+        those that haven't been used yet (e.g. before the first call to `Matching.decode`) are not counted. The state
+        of the blossom algorithm grows with the largest shots decoded so far (see `Matching.warm_up`) and is never
+        released, so it is a high-water mark. Containers are counted by the memory allocated for them, but the
+        overhead of the allocator is not counted, so the memory used by the process is a little larger.
+
+        Returns
+        -------
+        dict
+            The number of bytes held by:
+
+            - "user_graph": the nodes and edges added to the `Matching`
+            - "shared_graph": the edges of the graph used by the decoders, and the structures precomputed from them
+            - "mapped_graph": the edges of a graph attached with `Matching.attach_graph_file` or
+              `Matching.attach_shared_memory`, which are shared by every process attached to it, and are not
+              included in "total"
+            - "matching_graph": the per-node state of the graph flooded by each decoder
+            - "search_graph": the per-node state of the graph searched for the paths of the solution, and the cache
+              of recently found paths
+            - "decoder_state": the regions, alternating tree nodes, event queues and scratch buffers of the blossom
+              algorithm of each decoder
+            - "auxiliary": the syndrome caches, predecoders and Union-Find decoders
+            - "total": the sum of the above, except "mapped_graph"
+
+            along with the number of decoders counted ("num_decoders"), and the largest number of regions, alternating
+            tree nodes and queue events that any of them holds memory for ("max_regions", "max_alt_tree_nodes" and
+            "max_queue_events")
+
+        Examples
+        --------
+        >>> import pymatching
+        >>> m = pymatching.Matching()
+        >>> m.add_boundary_edge(0, fault_ids={0}, error_probability=0.1)
+        >>> for i in range(99):
+        ...     m.add_edge(i, i + 1, fault_ids={i + 1}, error_probability=0.1)
+        >>> before = m.memory_usage()
+        >>> before["num_decoders"]
+        0
+        >>> _ = m.warm_up(0, expected_detection_events=50)
+        >>> after = m.memory_usage()
+        >>> after["num_decoders"]
+        1
+        >>> after["total"] > before["total"] and after["max_regions"] >= 100
+        True
+        """
+        return self._matching_graph.get_memory_usage()
+
+    def _check_not_frozen(self) -> None:
+        if self._matching_graph.is_frozen():
+            raise ValueError("The matching graph is frozen, so it can't be modified.")
+
     @property
     def num_fault_ids(self) -> int:
         """
@@ -0,0 +1,165 @@
+# Copyright 2022 PyMatching Contributors
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#      http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from typing import List, Optional, Sequence, TYPE_CHECKING, Union
+
+import numpy as np
+
+if TYPE_CHECKING:
+    import pymatching  # pragma: no cover
+
+import pymatching._cpp_pymatching as _cpp_pm
+
+
+class MultiMatching:
+    """
+    Decodes several independent `Matching` objects (for example the X and Z sectors of several surface code patches)
+    from one combined batch of shots in a single call, using a pool of threads.
+
+    Each matching is given a range of the detector columns of the combined shots, and the predictions of the
+    matchings are concatenated, in the order of the matchings. The matchings are frozen (see `Matching.freeze`), and
+    the shots are decoded with the GIL released, with each thread taking shots of any of the matchings until there
+    are none left, so that even a single combined shot is decoded in parallel.
+    """
+
+    def __init__(self, matchings: Sequence['pymatching.Matching'], *,
+                 detector_offsets: Optional[Sequence[int]] = None, num_threads: int = 1):
+        """
+        Parameters
+        ----------
+        matchings : Sequence[pymatching.Matching]
+            The matchings to decode. The same matching can be given more than once, e.g. to decode several patches
+            with the same matching graph.
+        detector_offsets : Sequence[int], optional
+            The first detector column of each matching in the combined shots, so that the detection event of
+            detector `d` of `matchings[k]` is in column `detector_offsets[k] + d`. By default the detectors of the
+            matchings are placed one after the other, in the order of the matchings
+        num_threads : int
+            The number of threads used to decode a batch. Each thread decodes with its own decoder state for each
+            matching, which shares its matching graph rather than copying it. By default 1
+
+        Examples
+        --------
+        >>> import numpy as np
+        >>> import pymatching
+        >>> x = pymatching.Matching()
+        >>> x.add_boundary_edge(0, fault_ids={0})
+        >>> x.add_edge(0, 1, fault_ids={1})
+        >>> z = pymatching.Matching()
+        >>> z.add_edge(0, 1, fault_ids={0})
+        >>> z.add_boundary_edge(1, fault_ids={1})
+        >>> multi = pymatching.MultiMatching([x, z], num_threads=2)
+        >>> multi.detector_offsets
+        [0, 2]
+        >>> multi.decode_batch(np.array([[1, 0, 0, 1], [0, 1, 1, 1]], dtype=np.uint8))
+        array([[1, 0, 0, 1],
+               [1, 1, 1, 0]], dtype=uint8)
+        """
+        matchings = list(matchings)
+        if detector_offsets is None:
+            detector_offsets = np.cumsum([0] + [m.num_detectors for m in matchings[:-1]]).tolist()
+        self._matchings = matchings
+        self._detector_offsets = [int(offset) for offset in detector_offsets]
+        self._decoder = _cpp_pm.MultiGraphDecoder(
+            [m._matching_graph for m in matchings], self._detector_offsets, num_threads=num_threads
+        )
+
+    def decode_batch(
+            self,
+            shots: np.ndarray,
+            *,
+            return_weights: bool = False,
+            bit_packed_shots: bool = False,
+            bit_packed_predictions: bool = False
+    ) -> Union[np.ndarray, tuple]:
+        """
+        Decode a batch of combined shots, returning the concatenated predictions of the matchings.
+
+        Parameters
+        ----------
+        shots : np.ndarray
+            A 2D numpy array of combined shots to decode, of `dtype=np.uint8`, with shape
+            `(num_shots, self.num_detectors)`, or with shape `(num_shots, math.ceil(self.num_detectors / 8))` if
+            `bit_packed_shots==True`. Bit packing should be done using little endian order on the last axis (like
+            ``np.packbits(data, bitorder='little', axis=1)``), as for `Matching.decode_batch`.
+        return_weights : bool
+            If True, then also return the total weight of the solutions of the matchings for each shot. By default,
+            False.
+        bit_packed_shots : bool
+            Set to `True` to provide `shots` as a bit-packed array. By default, False.
+        bit_packed_predictions : bool
+            Set to `True` if the returned predictions should be bit-packed, with the bit for fault id `m` (counting
+            the fault ids of the matchings one after the other) in shot `s` in ``(obs[s, m // 8] >> (m % 8)) & 1``.
+            By default, False.
+
+        Returns
+        -------
+        predictions: np.ndarray
+            The predictions, of `dtype=np.uint8` and with shape `(num_shots, self.num_fault_ids)` (or bit-packed).
+            The predictions of `matchings[k]` are in the columns starting at `self.fault_id_offsets[k]`.
+        weights: np.ndarray
+            The total weight of the solutions of the matchings in each shot, of `dtype=float`. Only returned if
+            `return_weights==True`.
+        """
+        predictions, weights = self._decoder.decode_batch(
+            shots,
+            bit_packed_shots=bit_packed_shots,
+            bit_packed_predictions=bit_packed_predictions,
+            return_weights=return_weights,
+        )
+        if return_weights:
+            return predictions, weights
+        return predictions
+
+    @property
+    def matchings(self) -> List['pymatching.Matching']:
+        """
+        The matchings decoded, in the order of their predictions
+        """
+        return list(self._matchings)
+
+    @property
+    def detector_offsets(self) -> List[int]:
+        """
+        The first detector column of each matching in the combined shots
+        """
+        return list(self._detector_offsets)
+
+    @property
+    def fault_id_offsets(self) -> List[int]:
+        """
+        The first column of the (unpacked) predictions of each matching
+        """
+        return list(self._decoder.first_observables)
+
+    @property
+    def num_detectors(self) -> int:
+        """
+        The number of detector columns of a combined shot
+        """
+        return self._decoder.num_detectors
+
+    @property
+    def num_fault_ids(self) -> int:
+        """
+        The total number of fault ids of the matchings, which is the number of columns of the (unpacked) predictions
+        """
+        return self._decoder.num_observables
+
+    @property
+    def num_threads(self) -> int:
+        """
+        The number of threads used to decode a batch
+        """
+        return self._decoder.num_threads
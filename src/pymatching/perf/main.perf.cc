@@ -13,8 +13,11 @@
 // limitations under the License.
 
 #include <cmath>
+#include <fstream>
 #include <iostream>
+#include <stdexcept>
 
+#include "pymatching/perf/surface_code_sweep.perf.h"
 #include "pymatching/perf/util.perf.h"
 #include "stim.h"
 
@@ -73,7 +76,8 @@ std::string si2(double val) {
     return ss.str();
 }
 
-static std::vector<const char *> known_arguments{"--only", "--target_seconds"};
+static std::vector<const char *> known_arguments{
+    "--only", "--target_seconds", "--format", "--repetitions", "--compare", "--regression_threshold", "--perf_counters"};
 
 void find_benchmarks(const std::string &filter, std::vector<RegisteredBenchmark> &out) {
     bool found = false;
@@ -104,12 +108,68 @@ void find_benchmarks(const std::string &filter, std::vector<RegisteredBenchmark>
     }
 }
 
+/// Prints the mean time per rep of `summary' (and its standard deviation, if it was repeated), compared to its goal.
+void print_text_summary(const BenchmarkSummary &summary) {
+    const auto &result = summary.last_result;
+    double actual_seconds_per_rep = summary.mean_seconds();
+    if (result.goal_seconds != -1) {
+        int deviation = (int)round((log(result.goal_seconds) - log(actual_seconds_per_rep)) / (log(10) / 10.0));
+        std::cout << "[";
+        for (int k = -20; k <= 20; k++) {
+            if ((k < deviation && k < 0) || (k > deviation && k > 0)) {
+                std::cout << '.';
+            } else if (k == deviation) {
+                std::cout << '*';
+            } else if (k == 0) {
+                std::cout << '|';
+            } else if (deviation < 0) {
+                std::cout << '<';
+            } else {
+                std::cout << '>';
+            }
+        }
+        std::cout << "] ";
+        std::cout << si2(actual_seconds_per_rep) << "s";
+        std::cout << " (vs " << si2(result.goal_seconds) << "s) ";
+    } else {
+        std::cout << si2(actual_seconds_per_rep) << "s ";
+    }
+    for (const auto &e : result.marginal_rates) {
+        const auto &multiplier = e.second;
+        const auto &unit = e.first;
+        std::cout << "(" << si2(multiplier / actual_seconds_per_rep) << unit << "/s) ";
+    }
+    for (const auto &e : result.values) {
+        std::cout << "(" << si2(e.second) << e.first << ") ";
+    }
+    for (const auto &e : perf_counter_metrics(result)) {
+        std::cout << "(" << si2(e.second) << e.first << ") ";
+    }
+    if (summary.seconds_per_rep.size() > 1) {
+        std::cout << "(stddev " << si2(summary.stddev_seconds()) << "s, min " << si2(summary.min_seconds()) << "s) ";
+    }
+    std::cout << summary.name << "\n";
+}
+
 double BENCHMARK_CONFIG_TARGET_SECONDS = 0.5;
+bool BENCHMARK_CONFIG_PERF_COUNTERS = false;
 
 int main(int argc, const char **argv) {
+    if (stim::find_bool_argument("--sweep", argc, argv)) {
+        return pm::main_surface_code_sweep(argc, argv);
+    }
     stim::check_for_unknown_arguments(known_arguments, {}, nullptr, argc, argv);
     const char *only = stim::find_argument("--only", argc, argv);
     BENCHMARK_CONFIG_TARGET_SECONDS = stim::find_float_argument("--target_seconds", 0.5, 0, 10000, argc, argv);
+    BENCHMARK_CONFIG_PERF_COUNTERS = stim::find_bool_argument("--perf_counters", argc, argv);
+    const char *format_arg = stim::find_argument("--format", argc, argv);
+    std::string format = format_arg == nullptr ? "text" : format_arg;
+    if (format != "text" && format != "json" && format != "csv") {
+        throw std::invalid_argument("--format must be one of text, json or csv.");
+    }
+    auto repetitions = (size_t)stim::find_int64_argument("--repetitions", 1, 1, 1000, argc, argv);
+    const char *compare = stim::find_argument("--compare", argc, argv);
+    double regression_threshold = stim::find_float_argument("--regression_threshold", 0.1, 0, 1000, argc, argv);
 
     std::vector<RegisteredBenchmark> chosen_benchmarks;
     if (only == nullptr) {
@@ -138,44 +198,66 @@ int main(int argc, const char **argv) {
         }
     }
 
+    std::vector<BenchmarkSummary> summaries;
     for (auto &benchmark : chosen_benchmarks) {
         running_benchmark = &benchmark;
-        benchmark.func();
-        for (const auto &result : benchmark.results) {
-            double actual_seconds_per_rep = result.total_seconds / result.total_reps;
-            if (result.goal_seconds != -1) {
-                int deviation = (int)round((log(result.goal_seconds) - log(actual_seconds_per_rep)) / (log(10) / 10.0));
-                std::cout << "[";
-                for (int k = -20; k <= 20; k++) {
-                    if ((k < deviation && k < 0) || (k > deviation && k > 0)) {
-                        std::cout << '.';
-                    } else if (k == deviation) {
-                        std::cout << '*';
-                    } else if (k == 0) {
-                        std::cout << '|';
-                    } else if (deviation < 0) {
-                        std::cout << '<';
-                    } else {
-                        std::cout << '>';
+        size_t first_summary = summaries.size();
+        for (size_t rep = 0; rep < repetitions; rep++) {
+            benchmark.results.clear();
+            benchmark.func();
+            if (benchmark.results.empty()) {
+                std::cerr << "`benchmark_go` was not called from BENCH(" << benchmark.name << ")";
+                exit(EXIT_FAILURE);
+            }
+            for (size_t k = 0; k < benchmark.results.size(); k++) {
+                const auto &result = benchmark.results[k];
+                if (first_summary + k == summaries.size()) {
+                    std::string name = benchmark.name;
+                    if (k > 0) {
+                        name += "#" + std::to_string(k);
                     }
+                    summaries.push_back({name, result, {}});
                 }
-                std::cout << "] ";
-                std::cout << si2(actual_seconds_per_rep) << "s";
-                std::cout << " (vs " << si2(result.goal_seconds) << "s) ";
-            } else {
-                std::cout << si2(actual_seconds_per_rep) << "s ";
+                auto &summary = summaries[first_summary + k];
+                summary.last_result = result;
+                summary.seconds_per_rep.push_back(result.total_seconds / result.total_reps);
             }
-            for (const auto &e : result.marginal_rates) {
-                const auto &multiplier = e.second;
-                const auto &unit = e.first;
-                std::cout << "(" << si2(result.total_reps / result.total_seconds * multiplier) << unit << "/s) ";
+        }
+        if (format == "text") {
+            for (size_t k = first_summary; k < summaries.size(); k++) {
+                print_text_summary(summaries[k]);
             }
-            std::cout << benchmark.name << "\n";
-            if (benchmark.results.empty()) {
-                std::cerr << "`benchmark_go` was not called from BENCH(" << benchmark.name << ")";
-                exit(EXIT_FAILURE);
+        }
+    }
+
+    if (format == "json") {
+        write_benchmark_json(std::cout, summaries);
+    } else if (format == "csv") {
+        write_benchmark_csv(std::cout, summaries);
+    }
+
+    if (compare != nullptr) {
+        std::ifstream baseline_file(compare);
+        if (!baseline_file.is_open()) {
+            throw std::invalid_argument("Failed to open '" + std::string(compare) + "' for reading.");
+        }
+        auto baseline = read_baseline_min_seconds(baseline_file);
+        bool regressed = false;
+        for (const auto &summary : summaries) {
+            auto it = baseline.find(summary.name);
+            if (it == baseline.end() || it->second <= 0) {
+                continue;
+            }
+            double ratio = summary.min_seconds() / it->second;
+            if (ratio > 1 + regression_threshold) {
+                std::cerr << "REGRESSION: " << summary.name << " took " << si2(summary.min_seconds()) << "s (vs "
+                          << si2(it->second) << "s in the baseline, +" << (int)round((ratio - 1) * 100) << "%)\n";
+                regressed = true;
             }
         }
+        if (regressed) {
+            return EXIT_FAILURE;
+        }
     }
     return 0;
 }
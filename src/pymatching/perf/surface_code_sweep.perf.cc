@@ -0,0 +1,233 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/perf/surface_code_sweep.perf.h"
+
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "pymatching/perf/util.perf.h"
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "stim.h"
+
+namespace {
+
+struct SurfaceCodeData {
+    stim::DetectorErrorModel dem;
+    std::vector<std::vector<uint64_t>> detection_events;
+    std::vector<uint64_t> obs_masks;
+};
+
+/// Samples `num_shots' shots from a rotated memory-X surface code circuit, with the noise model used to generate
+/// the circuits in `benchmarks/surface_codes'.
+SurfaceCodeData generate_surface_code_data(size_t distance, size_t rounds, double p, size_t num_shots) {
+    stim::CircuitGenParameters gen(rounds, distance, "rotated_memory_x");
+    gen.after_clifford_depolarization = p;
+    gen.before_round_data_depolarization = p;
+    gen.before_measure_flip_probability = p;
+    gen.after_reset_flip_probability = p;
+    stim::Circuit circuit = stim::generate_surface_code_circuit(gen).circuit;
+    std::mt19937_64 rng(0);  // NOLINT(cert-msc51-cpp)
+    size_t num_detectors = circuit.count_detectors();
+    auto dets_obs = stim::sample_batch_detection_events<stim::MAX_BITWORD_WIDTH>(circuit, num_shots, rng);
+    auto &dets = dets_obs.first;
+    auto &obs = dets_obs.second;
+
+    SurfaceCodeData data;
+    data.detection_events.resize(num_shots);
+    data.obs_masks.resize(num_shots);
+    for (size_t k = 0; k < num_shots; k++) {
+        data.obs_masks[k] = obs[0][k];
+        for (size_t d = 0; d < num_detectors; d++) {
+            if (dets[d][k]) {
+                data.detection_events[k].push_back(d);
+            }
+        }
+    }
+    data.dem = stim::ErrorAnalyzer::circuit_to_detector_error_model(circuit, true, true, false, 0, false, false);
+    return data;
+}
+
+template <typename T>
+std::vector<T> parse_list(const char *name, const char *default_value, int argc, const char **argv) {
+    const char *text = stim::find_argument(name, argc, argv);
+    std::string s = text == nullptr ? default_value : text;
+    std::vector<T> values;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t end = s.find(',', start);
+        if (end == std::string::npos)
+            end = s.size();
+        std::string item = s.substr(start, end - start);
+        size_t used = 0;
+        try {
+            if constexpr (std::is_floating_point_v<T>) {
+                values.push_back((T)std::stod(item, &used));
+            } else {
+                values.push_back((T)std::stoull(item, &used));
+            }
+        } catch (const std::logic_error &) {
+            used = 0;
+        }
+        if (item.empty() || used != item.size())
+            throw std::invalid_argument("Couldn't parse '" + item + "' in the value of " + name + ".");
+        start = end + 1;
+    }
+    return values;
+}
+
+pm::SweepPointResult run_sweep_point(
+    size_t distance, size_t rounds, double error_rate, size_t num_threads, size_t num_shots, double target_seconds) {
+    reset_peak_rss();
+    auto data = generate_surface_code_data(distance, rounds, error_rate, num_shots);
+    auto mwpms = pm::detector_error_model_to_mwpms(data.dem, pm::NUM_DISTINCT_WEIGHTS, num_threads);
+
+    // Each thread decodes its own contiguous chunk of the shots, with its own Mwpm.
+    std::vector<pm::LatencyHistogram> latencies(num_threads);
+    std::vector<size_t> logical_errors(num_threads, 0);
+    auto decode_chunk = [&](size_t t, bool count_errors) {
+        size_t begin = num_shots * t / num_threads;
+        size_t end = num_shots * (t + 1) / num_threads;
+        for (size_t k = begin; k < end; k++) {
+            auto start = std::chrono::steady_clock::now();
+            auto res = pm::decode_detection_events_for_up_to_64_observables(mwpms[t], data.detection_events[k]);
+            latencies[t].record(pm::nanoseconds_since(start));
+            if (count_errors && (res.obs_mask & 1) != data.obs_masks[k])
+                logical_errors[t]++;
+        }
+    };
+
+    // Decode one shot first, so that the Mwpm objects are fully allocated before timing starts.
+    for (auto &mwpm : mwpms)
+        pm::decode_detection_events_for_up_to_64_observables(mwpm, data.detection_events[0]);
+
+    size_t num_passes = 0;
+    double seconds = 0;
+    while (num_passes == 0 || seconds < target_seconds) {
+        bool count_errors = num_passes == 0;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> threads;
+        for (size_t t = 1; t < num_threads; t++)
+            threads.emplace_back(decode_chunk, t, count_errors);
+        decode_chunk(0, count_errors);
+        for (auto &thread : threads)
+            thread.join();
+        seconds += (double)pm::nanoseconds_since(start) / 1e9;
+        num_passes++;
+    }
+
+    pm::LatencyHistogram latency;
+    for (const auto &h : latencies)
+        latency += h;
+    size_t num_logical_errors = 0;
+    for (size_t e : logical_errors)
+        num_logical_errors += e;
+    size_t num_detection_events = 0;
+    for (const auto &events : data.detection_events)
+        num_detection_events += events.size();
+
+    return pm::SweepPointResult{
+        distance,
+        rounds,
+        error_rate,
+        num_threads,
+        num_shots * num_passes,
+        num_detection_events * num_passes,
+        num_logical_errors,
+        seconds,
+        latency.value_at_quantile(0.5),
+        latency.value_at_quantile(0.99),
+        peak_rss_bytes()};
+}
+
+}  // namespace
+
+double pm::SweepPointResult::shots_per_second() const {
+    return seconds == 0 ? 0 : (double)num_shots / seconds;
+}
+
+double pm::SweepPointResult::nanos_per_detection_event() const {
+    return num_detection_events == 0 ? 0 : seconds * 1e9 / (double)num_detection_events;
+}
+
+void pm::write_sweep_json(std::ostream &out, const std::vector<SweepPointResult> &results) {
+    auto old_precision = out.precision(10);
+    out << "[";
+    for (size_t k = 0; k < results.size(); k++) {
+        const auto &r = results[k];
+        out << (k == 0 ? "\n" : ",\n");
+        out << "  {\"distance\": " << r.distance << ", \"rounds\": " << r.rounds << ", \"error_rate\": " << r.error_rate
+            << ", \"threads\": " << r.num_threads << ", \"shots\": " << r.num_shots
+            << ", \"detection_events\": " << r.num_detection_events << ", \"logical_errors\": " << r.num_logical_errors
+            << ", \"seconds\": " << r.seconds << ", \"shots_per_second\": " << r.shots_per_second()
+            << ", \"ns_per_detection_event\": " << r.nanos_per_detection_event()
+            << ", \"p50_latency_ns\": " << r.p50_latency_ns << ", \"p99_latency_ns\": " << r.p99_latency_ns
+            << ", \"peak_rss_bytes\": " << r.peak_rss_bytes << "}";
+    }
+    out << "\n]\n";
+    out.precision(old_precision);
+}
+
+int pm::main_surface_code_sweep(int argc, const char **argv) {
+    std::vector<const char *> known_arguments{
+        "--sweep", "--distances", "--error_rates", "--rounds", "--threads", "--shots", "--out", "--target_seconds"};
+    stim::check_for_unknown_arguments(known_arguments, {}, "--sweep", argc, argv);
+    auto distances = parse_list<size_t>("--distances", "5,7,9", argc, argv);
+    auto error_rates = parse_list<double>("--error_rates", "0.001,0.005", argc, argv);
+    auto rounds_list = parse_list<size_t>("--rounds", "0", argc, argv);
+    auto thread_counts = parse_list<size_t>("--threads", "1", argc, argv);
+    auto num_shots = (size_t)stim::find_int64_argument("--shots", 1000, 1, INT64_MAX, argc, argv);
+    double target_seconds = stim::find_float_argument("--target_seconds", 0.5, 0, 10000, argc, argv);
+    const char *out_path = stim::find_argument("--out", argc, argv);
+    for (size_t t : thread_counts) {
+        if (t == 0 || t > num_shots)
+            throw std::invalid_argument("Each value of --threads must be between 1 and the number of --shots.");
+    }
+    for (double p : error_rates) {
+        if (!(p >= 0 && p <= 1))
+            throw std::invalid_argument("Each value of --error_rates must be between 0 and 1.");
+    }
+
+    std::vector<SweepPointResult> results;
+    for (size_t distance : distances) {
+        for (size_t r : rounds_list) {
+            size_t rounds = r == 0 ? distance : r;
+            for (double p : error_rates) {
+                for (size_t num_threads : thread_counts) {
+                    results.push_back(run_sweep_point(distance, rounds, p, num_threads, num_shots, target_seconds));
+                    const auto &res = results.back();
+                    std::cerr << "d=" << distance << " r=" << rounds << " p=" << p << " threads=" << num_threads
+                              << ": " << res.shots_per_second() << " shots/s, " << res.nanos_per_detection_event()
+                              << " ns/det, p99=" << res.p99_latency_ns << "ns\n";
+                }
+            }
+        }
+    }
+
+    if (out_path == nullptr) {
+        write_sweep_json(std::cout, results);
+    } else {
+        std::ofstream out(out_path);
+        if (!out.is_open())
+            throw std::invalid_argument("Failed to open '" + std::string(out_path) + "' for writing.");
+        write_sweep_json(out, results);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SURFACE_CODE_SWEEP_PERF_H
+#define PYMATCHING2_SURFACE_CODE_SWEEP_PERF_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace pm {
+
+/// The measurements taken at one point of a surface code sweep.
+struct SweepPointResult {
+    size_t distance;
+    size_t rounds;
+    double error_rate;
+    size_t num_threads;
+    size_t num_shots;
+    size_t num_detection_events;
+    size_t num_logical_errors;
+    double seconds;
+    uint64_t p50_latency_ns;
+    uint64_t p99_latency_ns;
+    size_t peak_rss_bytes;
+
+    double shots_per_second() const;
+    double nanos_per_detection_event() const;
+};
+
+/// Writes the sweep results as a JSON array with one object per point.
+void write_sweep_json(std::ostream &out, const std::vector<SweepPointResult> &results);
+
+/// Runs the sweep selected by `--sweep' (see `main.perf.cc'). For every combination of the comma-separated
+/// `--distances', `--error_rates', `--rounds' and `--threads', a rotated memory-X surface code circuit is generated
+/// with the noise model of `benchmarks/surface_codes', `--shots' shots are sampled from it, and the shots are
+/// decoded repeatedly for at least `--target_seconds'. The results are written as JSON to `--out' (or stdout).
+int main_surface_code_sweep(int argc, const char **argv);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SURFACE_CODE_SWEEP_PERF_H
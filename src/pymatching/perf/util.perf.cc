@@ -13,3 +13,297 @@
 // limitations under the License.
 
 #include "pymatching/perf/util.perf.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::atomic<uint64_t> heap_allocation_count{0};
+
+}  // namespace
+
+void *operator new(size_t size) {
+    heap_allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    std::free(p);
+}
+
+uint64_t num_heap_allocations() {
+    return heap_allocation_count.load(std::memory_order_relaxed);
+}
+
+size_t peak_rss_bytes() {
+#if defined(__linux__)
+    // Unlike `ru_maxrss', the high water mark in /proc/self/status is affected by `reset_peak_rss'.
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmHWM:", 0) == 0) {
+            return (size_t)std::stoull(line.substr(6)) * 1024;
+        }
+    }
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+#if defined(__APPLE__)
+        return (size_t)usage.ru_maxrss;
+#else
+        return (size_t)usage.ru_maxrss * 1024;
+#endif
+    }
+#endif
+    return 0;
+}
+
+void reset_peak_rss() {
+#if defined(__linux__)
+    std::ofstream clear_refs("/proc/self/clear_refs");
+    clear_refs << "5";
+#endif
+}
+
+PerfCounterValues::PerfCounterValues() {
+    counts.fill(-1);
+}
+
+bool PerfCounterValues::any() const {
+    for (auto c : counts) {
+        if (c >= 0)
+            return true;
+    }
+    return false;
+}
+
+double PerfCounterValues::ipc() const {
+    if (counts[CYCLES] <= 0 || counts[INSTRUCTIONS] < 0)
+        return -1;
+    return (double)counts[INSTRUCTIONS] / (double)counts[CYCLES];
+}
+
+PerfCounters::PerfCounters(bool enabled) {
+    fds.fill(-1);
+#if defined(__linux__)
+    if (!enabled)
+        return;
+    constexpr uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    std::array<std::pair<uint32_t, uint64_t>, PerfCounterValues::NUM_COUNTERS> events{{
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, l1d_read_miss},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    }};
+    for (size_t k = 0; k < events.size(); k++) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = events[k].first;
+        attr.config = events[k].second;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fds[k] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#else
+    (void)enabled;
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#if defined(__linux__)
+    for (int fd : fds) {
+        if (fd >= 0)
+            close(fd);
+    }
+#endif
+}
+
+void PerfCounters::start() {
+#if defined(__linux__)
+    for (int fd : fds) {
+        if (fd >= 0) {
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+PerfCounterValues PerfCounters::stop() {
+    PerfCounterValues values;
+#if defined(__linux__)
+    for (size_t k = 0; k < fds.size(); k++) {
+        if (fds[k] < 0)
+            continue;
+        ioctl(fds[k], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t count;
+        if (read(fds[k], &count, sizeof(count)) == (ssize_t)sizeof(count))
+            values.counts[k] = (int64_t)count;
+    }
+#endif
+    return values;
+}
+
+std::vector<std::pair<std::string, double>> perf_counter_metrics(const BenchmarkResult &result) {
+    std::vector<std::pair<std::string, double>> metrics;
+    metrics.emplace_back("heap_allocs/rep", result.heap_allocations_per_rep);
+    const auto &c = result.counters;
+    if (!c.any() || result.total_reps == 0)
+        return metrics;
+    double reps = (double)result.total_reps;
+    if (c.ipc() >= 0)
+        metrics.emplace_back("ipc", c.ipc());
+    for (size_t k = 0; k < PerfCounterValues::NUM_COUNTERS; k++) {
+        if (c.counts[k] >= 0)
+            metrics.emplace_back(std::string(PerfCounterValues::NAMES[k]) + "/rep", (double)c.counts[k] / reps);
+    }
+    for (const auto &rate : result.marginal_rates) {
+        for (size_t k = PerfCounterValues::FIRST_MISS_COUNTER; k < PerfCounterValues::NUM_COUNTERS; k++) {
+            if (c.counts[k] >= 0 && rate.second > 0) {
+                metrics.emplace_back(
+                    std::string(PerfCounterValues::NAMES[k]) + "/" + rate.first,
+                    (double)c.counts[k] / reps / rate.second);
+            }
+        }
+    }
+    return metrics;
+}
+
+double BenchmarkSummary::mean_seconds() const {
+    double total = 0;
+    for (double s : seconds_per_rep)
+        total += s;
+    return seconds_per_rep.empty() ? 0 : total / (double)seconds_per_rep.size();
+}
+
+double BenchmarkSummary::stddev_seconds() const {
+    if (seconds_per_rep.size() < 2)
+        return 0;
+    double mean = mean_seconds();
+    double total = 0;
+    for (double s : seconds_per_rep)
+        total += (s - mean) * (s - mean);
+    return std::sqrt(total / (double)(seconds_per_rep.size() - 1));
+}
+
+double BenchmarkSummary::min_seconds() const {
+    return seconds_per_rep.empty() ? 0 : *std::min_element(seconds_per_rep.begin(), seconds_per_rep.end());
+}
+
+namespace {
+
+std::string json_string(const std::string &s) {
+    std::string result = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            result.push_back('\\');
+        result.push_back(c);
+    }
+    result.push_back('"');
+    return result;
+}
+
+void write_json_units(std::ostream &out, const std::vector<std::pair<std::string, double>> &units, double scale) {
+    out << "{";
+    for (size_t k = 0; k < units.size(); k++) {
+        out << (k == 0 ? "" : ", ") << json_string(units[k].first) << ": " << units[k].second * scale;
+    }
+    out << "}";
+}
+
+}  // namespace
+
+void write_benchmark_json(std::ostream &out, const std::vector<BenchmarkSummary> &summaries) {
+    auto old_precision = out.precision(10);
+    out << "{\"benchmarks\": [";
+    for (size_t k = 0; k < summaries.size(); k++) {
+        const auto &s = summaries[k];
+        out << (k == 0 ? "\n" : ",\n");
+        out << "  {\"name\": " << json_string(s.name) << ", \"repetitions\": " << s.seconds_per_rep.size()
+            << ", \"mean_seconds\": " << s.mean_seconds() << ", \"stddev_seconds\": " << s.stddev_seconds()
+            << ", \"min_seconds\": " << s.min_seconds() << ", \"goal_seconds\": ";
+        if (s.last_result.goal_seconds == -1) {
+            out << "null";
+        } else {
+            out << s.last_result.goal_seconds;
+        }
+        // Rates are per second, based on the mean time per rep.
+        out << ", \"rates\": ";
+        write_json_units(out, s.last_result.marginal_rates, s.mean_seconds() == 0 ? 0 : 1 / s.mean_seconds());
+        out << ", \"values\": ";
+        write_json_units(out, s.last_result.values, 1);
+        auto counter_metrics = perf_counter_metrics(s.last_result);
+        if (!counter_metrics.empty()) {
+            out << ", \"counters\": ";
+            write_json_units(out, counter_metrics, 1);
+        }
+        out << "}";
+    }
+    out << "\n]}\n";
+    out.precision(old_precision);
+}
+
+void write_benchmark_csv(std::ostream &out, const std::vector<BenchmarkSummary> &summaries) {
+    auto old_precision = out.precision(10);
+    out << "name,repetitions,mean_seconds,stddev_seconds,min_seconds,goal_seconds\n";
+    for (const auto &s : summaries) {
+        out << s.name << "," << s.seconds_per_rep.size() << "," << s.mean_seconds() << "," << s.stddev_seconds()
+            << "," << s.min_seconds() << ",";
+        if (s.last_result.goal_seconds != -1)
+            out << s.last_result.goal_seconds;
+        out << "\n";
+    }
+    out.precision(old_precision);
+}
+
+std::map<std::string, double> read_baseline_min_seconds(std::istream &in) {
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::map<std::string, double> result;
+    const std::string name_key = "\"name\": \"";
+    const std::string min_key = "\"min_seconds\": ";
+    size_t pos = 0;
+    while ((pos = text.find(name_key, pos)) != std::string::npos) {
+        pos += name_key.size();
+        std::string name;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\')
+                pos++;
+            name.push_back(text[pos++]);
+        }
+        size_t min_pos = text.find(min_key, pos);
+        if (min_pos == std::string::npos)
+            throw std::invalid_argument("Baseline benchmark '" + name + "' has no min_seconds.");
+        result[name] = std::stod(text.substr(min_pos + min_key.size()));
+        pos = min_pos;
+    }
+    return result;
+}
@@ -17,21 +17,84 @@
 #ifndef _PYMATCHING_PERF_UTIL_PERF_H
 #define _PYMATCHING_PERF_UTIL_PERF_H
 
+#include <array>
 #include <chrono>
+#include <cstdint>
 #include <functional>
+#include <iostream>
+#include <map>
 #include <string>
 #include <vector>
 
 extern double BENCHMARK_CONFIG_TARGET_SECONDS;
+extern bool BENCHMARK_CONFIG_PERF_COUNTERS;
+
+/// The peak resident set size of this process in bytes, or 0 if it can't be determined on this platform.
+size_t peak_rss_bytes();
+
+/// Resets the peak resident set size reported by `peak_rss_bytes' to the current resident set size, where the
+/// platform allows it (Linux). Elsewhere the peak is over the whole lifetime of the process.
+void reset_peak_rss();
+
+/// The number of heap allocations made by this process so far. The perf binary replaces the global `operator new'
+/// to count them (over-aligned allocations, which the decoder only makes when building graphs, aren't counted).
+uint64_t num_heap_allocations();
+
+/// Hardware event counts, summed over all the reps of a benchmark.
+struct PerfCounterValues {
+    static constexpr size_t NUM_COUNTERS = 5;
+    static constexpr std::array<const char *, NUM_COUNTERS> NAMES{
+        "cycles", "instructions", "l1d_read_misses", "llc_misses", "branch_misses"};
+    static constexpr size_t CYCLES = 0;
+    static constexpr size_t INSTRUCTIONS = 1;
+    /// The counters from L1D_READ_MISSES on are misses, also reported per unit of the benchmark's rates.
+    static constexpr size_t FIRST_MISS_COUNTER = 2;
+
+    /// The count of each event, or -1 if it wasn't counted (e.g. counters are disabled or unsupported).
+    std::array<int64_t, NUM_COUNTERS> counts;
+
+    PerfCounterValues();
+    bool any() const;
+    /// Instructions per cycle, or -1 if either wasn't counted.
+    double ipc() const;
+};
+
+/// Counts hardware events for the calling thread (excluding the kernel) using Linux's `perf_event_open'. On other
+/// platforms, or when a counter can't be opened (e.g. due to `perf_event_paranoid' or in a VM), that counter is
+/// reported as -1 rather than failing the benchmark.
+class PerfCounters {
+   public:
+    explicit PerfCounters(bool enabled);
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    void start();
+    PerfCounterValues stop();
+
+   private:
+    std::array<int, PerfCounterValues::NUM_COUNTERS> fds;
+};
 
 struct BenchmarkResult {
     double total_seconds;
     size_t total_reps;
     std::vector<std::pair<std::string, double>> marginal_rates;
+    std::vector<std::pair<std::string, double>> values;
     double goal_seconds;
+    PerfCounterValues counters;
+    /// Heap allocations per rep, measured over the last batch of reps, after any buffers kept between reps have
+    /// grown to their steady-state size.
+    double heap_allocations_per_rep;
 
     BenchmarkResult(double total_seconds, size_t total_reps)
-        : total_seconds(total_seconds), total_reps(total_reps), marginal_rates(), goal_seconds(-1) {
+        : total_seconds(total_seconds),
+          total_reps(total_reps),
+          marginal_rates(),
+          values(),
+          goal_seconds(-1),
+          counters(),
+          heap_allocations_per_rep(0) {
     }
 
     BenchmarkResult &show_rate(const std::string &new_unit_name, double new_multiplier) {
@@ -39,6 +102,12 @@ struct BenchmarkResult {
         return *this;
     }
 
+    /// Reports a quantity that doesn't depend on the timing (e.g. a memory footprint) next to the rates.
+    BenchmarkResult &show_value(const std::string &unit_name, double value) {
+        values.emplace_back(unit_name, value);
+        return *this;
+    }
+
     BenchmarkResult &goal_nanos(double nanos) {
         goal_seconds = nanos / 1000 / 1000 / 1000;
         return *this;
@@ -55,6 +124,32 @@ struct BenchmarkResult {
     }
 };
 
+/// The time per rep of one `benchmark_go' call in a benchmark, over each repetition of the benchmark.
+struct BenchmarkSummary {
+    std::string name;
+    /// The rates, values and goal reported by the last repetition.
+    BenchmarkResult last_result;
+    std::vector<double> seconds_per_rep;
+
+    double mean_seconds() const;
+    double stddev_seconds() const;
+    double min_seconds() const;
+};
+
+/// The heap allocations of `result' per rep and, if hardware counters were collected, the counters per rep, its IPC,
+/// and its misses per unit of each of its rates (e.g. "llc_misses/dets").
+std::vector<std::pair<std::string, double>> perf_counter_metrics(const BenchmarkResult &result);
+
+/// Writes the summaries as a JSON object with a "benchmarks" array, which can be read back by
+/// `read_baseline_min_seconds'.
+void write_benchmark_json(std::ostream &out, const std::vector<BenchmarkSummary> &summaries);
+
+/// Writes the summaries as CSV, with a header line followed by one line per summary.
+void write_benchmark_csv(std::ostream &out, const std::vector<BenchmarkSummary> &summaries);
+
+/// Reads the "min_seconds" of each benchmark, keyed by name, from JSON written by `write_benchmark_json'.
+std::map<std::string, double> read_baseline_min_seconds(std::istream &in);
+
 struct RegisteredBenchmark {
     std::string name;
     std::function<void(void)> func;
@@ -77,6 +172,9 @@ BenchmarkResult &benchmark_go(FUNC body) {
     size_t total_reps = 0;
     double total_seconds = 0.0;
     double target_wait_time_seconds = BENCHMARK_CONFIG_TARGET_SECONDS;
+    double heap_allocations_per_rep = 0;
+    PerfCounters counters(BENCHMARK_CONFIG_PERF_COUNTERS);
+    counters.start();
 
     for (size_t rep_limit = 1; total_seconds < target_wait_time_seconds; rep_limit *= 100) {
         double remaining_time = target_wait_time_seconds - total_seconds;
@@ -93,17 +191,23 @@ BenchmarkResult &benchmark_go(FUNC body) {
                 reps = 1;
             }
         }
+        uint64_t allocations_before = num_heap_allocations();
         auto start = std::chrono::steady_clock::now();
         for (size_t rep = 0; rep < reps; rep++) {
             body();
         }
         auto end = std::chrono::steady_clock::now();
+        heap_allocations_per_rep = (double)(num_heap_allocations() - allocations_before) / (double)reps;
         auto micros = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
         total_reps += reps;
         total_seconds += (double)micros / 1000.0 / 1000.0;
     }
 
+    auto counter_values = counters.stop();
+
     running_benchmark->results.push_back({total_seconds, total_reps});
+    running_benchmark->results.back().counters = counter_values;
+    running_benchmark->results.back().heap_allocations_per_rep = heap_allocations_per_rep;
     return running_benchmark->results.back();
 }
 
@@ -14,6 +14,8 @@
 
 #include "pybind11/pybind11.h"
 #include "pymatching/rand/rand_gen.pybind.h"
+#include "pymatching/sparse_blossom/driver/decoder_service.pybind.h"
+#include "pymatching/sparse_blossom/driver/multi_graph_decoding.pybind.h"
 #include "pymatching/sparse_blossom/driver/namespaced_main.h"
 #include "pymatching/sparse_blossom/driver/user_graph.pybind.h"
 
@@ -33,6 +35,8 @@ PYBIND11_MODULE(_cpp_pymatching, m) {
     auto matching_graph = pm_pybind::pybind_user_graph(m);
     pm_pybind::pybind_user_graph_methods(m, matching_graph);
     pm_pybind::pybind_rand_gen_methods(m);
+    pm_pybind::pybind_decoder_service(m);
+    pm_pybind::pybind_multi_graph_decoder(m);
     m.def("main", &pymatching_main, pybind11::kw_only(), pybind11::arg("command_line_args"), R"pbdoc(
 Runs the command line tool version of pymatching with the given arguments.
 )pbdoc");
@@ -34,4 +34,14 @@ double pm::rand_float(double from, double to) {
     static std::uniform_real_distribution<> d{};
     using parm_t = decltype(d)::param_type;
     return d(global_urng(), parm_t{from, to});
-}
\ No newline at end of file
+}
+pm::Xoshiro256PlusPlus::Xoshiro256PlusPlus(uint64_t seed) {
+    // splitmix64 spreads the seed over the whole state, which must not be all zero.
+    for (auto& word : s) {
+        seed += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        word = z ^ (z >> 31);
+    }
+}
@@ -15,6 +15,8 @@
 #ifndef PYMATCHING2_RAND_GEN_H
 #define PYMATCHING2_RAND_GEN_H
 
+#include <cstdint>
+#include <limits>
 #include <random>
 
 namespace pm {
@@ -37,6 +39,49 @@ void set_seed(unsigned seed);
  * @return double
  */
 double rand_float(double from, double to);
+
+/**
+ * @brief A small and fast pseudo-random number generator (xoshiro256++), seeded from a single 64-bit seed using
+ * splitmix64. Unlike `global_urng`, each instance has its own state, so generators can be used concurrently by
+ * different threads. Satisfies the UniformRandomBitGenerator requirements.
+ */
+struct Xoshiro256PlusPlus {
+    using result_type = uint64_t;
+    uint64_t s[4];
+
+    explicit Xoshiro256PlusPlus(uint64_t seed);
+
+    static constexpr result_type min() {
+        return 0;
+    }
+    static constexpr result_type max() {
+        return std::numeric_limits<uint64_t>::max();
+    }
+
+    inline result_type operator()() {
+        uint64_t result = rotl(s[0] + s[3], 23) + s[0];
+        uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    /**
+     * @brief A random double chosen uniformly at random from [0, 1), with 53 random bits
+     */
+    inline double uniform_double() {
+        return (double)((*this)() >> 11) * 0x1.0p-53;
+    }
+
+   private:
+    static inline uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+};
 }  // namespace pm
 
 #endif  // PYMATCHING2_RAND_GEN_H
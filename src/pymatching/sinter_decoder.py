@@ -0,0 +1,133 @@
+# Copyright 2022 PyMatching Contributors
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#      http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import pathlib
+from typing import Optional, TYPE_CHECKING
+
+import numpy as np
+
+if TYPE_CHECKING:
+    import stim  # pragma: no cover
+
+from pymatching.matching import Matching
+
+
+class SinterCompiledDecoder:
+    """
+    A decoder for one detector error model, as returned by `SinterDecoder.compile_decoder_for_dem`. Implements the
+    `sinter.CompiledDecoder` interface.
+    """
+
+    def __init__(self, matching: Matching, num_observables: int, num_threads: int = 1):
+        self._matching = matching
+        self._num_observables = num_observables
+        self._num_threads = num_threads
+
+    def decode_shots_bit_packed(self, *, bit_packed_detection_event_data: np.ndarray) -> np.ndarray:
+        """
+        Predict the observables flipped in each of a batch of shots.
+
+        Parameters
+        ----------
+        bit_packed_detection_event_data : np.ndarray
+            A 2D numpy array of `dtype=np.uint8` with a row per shot of `math.ceil(num_detectors / 8)` bytes, in
+            which the bit for detector `m` of shot `s` is ``(data[s, m // 8] >> (m % 8)) & 1``.
+
+        Returns
+        -------
+        np.ndarray
+            A 2D numpy array of `dtype=np.uint8` with a row per shot of `math.ceil(num_observables / 8)` bytes,
+            bit-packed in the same way, where `num_observables` is the number of observables of the detector error
+            model.
+        """
+        return self._matching._matching_graph.decode_batch_bit_packed(
+            bit_packed_detection_event_data,
+            num_observables=self._num_observables,
+            num_threads=self._num_threads,
+        )
+
+
+class SinterDecoder:
+    """
+    A decoder that sinter can use to decode with PyMatching, implementing the `sinter.Decoder` interface.
+
+    Whether sinter passes a batch of shots in memory (to `SinterCompiledDecoder.decode_shots_bit_packed`) or in files
+    (to `SinterDecoder.decode_via_files`), the bit-packed detection events are decoded straight from the buffer (or
+    from the memory mapped file), by `num_threads` threads with the GIL released, and the bit-packed predictions are
+    written directly, without converting either to or from a byte per bit in Python.
+
+    Examples
+    --------
+    >>> import pymatching
+    >>> import sinter  # doctest: +SKIP
+    >>> decoder = pymatching.SinterDecoder(num_threads=1)
+    >>> stats = sinter.collect(  # doctest: +SKIP
+    ...     tasks=tasks,
+    ...     num_workers=4,
+    ...     decoders=["pymatching_compiled"],
+    ...     custom_decoders={"pymatching_compiled": decoder},
+    ...     max_shots=100_000,
+    ... )
+    """
+
+    def __init__(self, *, num_threads: int = 1, cache_dir: Optional[str] = None):
+        """
+        Parameters
+        ----------
+        num_threads : int
+            The number of threads used to decode each batch of shots. sinter already runs a worker process per CPU,
+            so this is best left as 1 unless sinter is given fewer workers than there are CPUs. By default, 1.
+        cache_dir : str, optional
+            A directory in which to cache the decoding graphs built by `SinterDecoder.decode_via_files`, as for the
+            `cache_dir` argument of `pymatching.Matching.from_detector_error_model_file`. By default, None (no cache).
+        """
+        if num_threads < 1:
+            raise ValueError(f"num_threads must be at least 1, not {num_threads}.")
+        self.num_threads = num_threads
+        self.cache_dir = cache_dir
+
+    def compile_decoder_for_dem(self, *, dem: 'stim.DetectorErrorModel') -> SinterCompiledDecoder:
+        """
+        Build a decoder for the detector error model `dem`, which sinter then calls with batches of shots.
+        """
+        matching = Matching.from_detector_error_model(dem)
+        matching.freeze()
+        return SinterCompiledDecoder(matching, num_observables=dem.num_observables, num_threads=self.num_threads)
+
+    def decode_via_files(
+            self,
+            *,
+            num_shots: int,
+            num_dets: int,
+            num_obs: int,
+            dem_path: pathlib.Path,
+            dets_b8_in_path: pathlib.Path,
+            obs_predictions_b8_out_path: pathlib.Path,
+            tmp_dir: pathlib.Path,
+    ) -> None:
+        """
+        Decode the `num_shots` shots of detection events in the `b8` file `dets_b8_in_path`, writing the predicted
+        observables to the `b8` file `obs_predictions_b8_out_path`, using the detector error model in the file
+        `dem_path`.
+        """
+        matching = Matching.from_detector_error_model_file(str(dem_path), cache_dir=self.cache_dir)
+        matching.freeze()
+        matching._matching_graph.decode_bit_packed_shot_file(
+            num_shots,
+            str(dets_b8_in_path),
+            num_dets,
+            str(obs_predictions_b8_out_path),
+            num_obs,
+            num_threads=self.num_threads,
+        )
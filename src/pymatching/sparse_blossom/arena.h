@@ -16,34 +16,74 @@
 #define PYMATCHING_FILL_MATCH_ARENA_H
 
 #include <algorithm>
-#include <iostream>
+#include <cstddef>
+#include <memory>
 #include <vector>
 
 namespace pm {
 
 /// World's simplest bulk memory owner.
 ///
-/// Memory allocated by the arena is free'd when the arena is destructed.
+/// Objects are carved out of contiguous slabs, each holding many objects, so that objects allocated together
+/// are close together in memory. Slots that are released with `del` are kept on an intrusive free list and
+/// reused by later allocations. Memory allocated by the arena is free'd when the arena is destructed.
 template <typename T>
 struct Arena {
-    std::vector<T *> allocated;
-    std::vector<T *> available;
+    /// A piece of memory that either holds a T or, while unused, a link in the free list.
+    union Slot {
+        Slot *next_free;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
 
-    Arena() : allocated(), available() {
+    /// Number of slots in the first slab. Each following slab is twice as large, up to MAX_SLAB_SIZE.
+    static constexpr size_t MIN_SLAB_SIZE = 32;
+    static constexpr size_t MAX_SLAB_SIZE = 4096;
+
+    std::vector<std::unique_ptr<Slot[]>> slabs;
+    std::vector<size_t> slab_sizes;
+    /// Most recently released slot, or nullptr.
+    Slot *free_list;
+    /// Slots [0, next_slot_in_slab) of slabs[next_slab] and all slots of the slabs before it have been handed out.
+    size_t next_slab;
+    size_t next_slot_in_slab;
+    size_t num_in_use;
+
+    Arena() : free_list(nullptr), next_slab(0), next_slot_in_slab(0), num_in_use(0) {
     }
     Arena(const Arena &) = delete;
-    Arena(Arena &&other) : allocated(std::move(other.allocated)), available(std::move(other.available)) {
+    Arena(Arena &&other) noexcept
+        : slabs(std::move(other.slabs)),
+          slab_sizes(std::move(other.slab_sizes)),
+          free_list(other.free_list),
+          next_slab(other.next_slab),
+          next_slot_in_slab(other.next_slot_in_slab),
+          num_in_use(other.num_in_use) {
+        other.slabs.clear();
+        other.slab_sizes.clear();
+        other.free_list = nullptr;
+        other.next_slab = 0;
+        other.next_slot_in_slab = 0;
+        other.num_in_use = 0;
     }
 
     T *alloc_unconstructed() {
-        if (available.empty()) {
-            T *p = (T *)malloc(sizeof(T));
-            allocated.push_back(p);
-            available.push_back(p);
+        num_in_use++;
+        if (free_list != nullptr) {
+            Slot *result = free_list;
+            free_list = result->next_free;
+            return reinterpret_cast<T *>(result->storage);
         }
-        T *result = available.back();
-        available.pop_back();
-        return result;
+        if (next_slab < slabs.size() && next_slot_in_slab == slab_sizes[next_slab]) {
+            next_slab++;
+            next_slot_in_slab = 0;
+        }
+        if (next_slab == slabs.size()) {
+            size_t slab_size = slab_sizes.empty() ? MIN_SLAB_SIZE : std::min(slab_sizes.back() * 2, MAX_SLAB_SIZE);
+            slabs.emplace_back(new Slot[slab_size]);
+            slab_sizes.push_back(slab_size);
+        }
+        Slot *result = &slabs[next_slab][next_slot_in_slab++];
+        return reinterpret_cast<T *>(result->storage);
     }
 
     T *alloc_default_constructed() {
@@ -53,35 +93,78 @@ struct Arena {
     }
 
     void del(T *p) {
-        available.push_back(p);
         p->~T();
+        Slot *slot = reinterpret_cast<Slot *>(p);
+        slot->next_free = free_list;
+        free_list = slot;
+        num_in_use--;
+    }
+
+    /// Number of objects that have been allocated and not yet deleted.
+    inline size_t size() const {
+        return num_in_use;
+    }
+
+    /// Total number of objects that fit in the memory currently owned by the arena.
+    size_t capacity() const {
+        size_t total = 0;
+        for (size_t s : slab_sizes)
+            total += s;
+        return total;
+    }
+
+    /// The memory currently owned by the arena, in bytes.
+    size_t memory_bytes() const {
+        return capacity() * sizeof(Slot) + slabs.capacity() * sizeof(slabs[0]) + slab_sizes.capacity() * sizeof(size_t);
+    }
+
+    /// Adds slabs (of the sizes the arena would grow by anyway) until at least `n' objects fit in the memory owned
+    /// by the arena, so that allocating them later doesn't need to allocate memory.
+    void reserve(size_t n) {
+        size_t total = capacity();
+        while (total < n) {
+            size_t slab_size = slab_sizes.empty() ? MIN_SLAB_SIZE : std::min(slab_sizes.back() * 2, MAX_SLAB_SIZE);
+            slabs.emplace_back(new Slot[slab_size]);
+            slab_sizes.push_back(slab_size);
+            total += slab_size;
+        }
+    }
+
+    /// Destructs any objects still in use and makes all the memory owned by the arena available again, without
+    /// releasing it. If every object has already been deleted (as is the case after a shot has been decoded
+    /// successfully), this takes constant time.
+    void clear() {
+        destruct_objects_in_use();
+        free_list = nullptr;
+        next_slab = 0;
+        next_slot_in_slab = 0;
+        num_in_use = 0;
     }
 
     ~Arena() {
-        std::vector<T *> to_free = std::move(allocated);
-        std::vector<T *> not_in_use = std::move(available);
+        destruct_objects_in_use();
+    }
 
-        // Destruct the objects that were still in use.
-        std::sort(to_free.begin(), to_free.end());
+   private:
+    void destruct_objects_in_use() {
+        if (num_in_use == 0)
+            return;
+        // Only reached if objects were never deleted (e.g. when decoding failed part way through), so there is
+        // no need for this to be fast.
+        std::vector<Slot *> not_in_use;
+        for (Slot *s = free_list; s != nullptr; s = s->next_free)
+            not_in_use.push_back(s);
         std::sort(not_in_use.begin(), not_in_use.end());
-        size_t kf = 0;
-        size_t kn = 0;
-        while (kf < to_free.size()) {
-            if (kn < not_in_use.size() && not_in_use[kn] == to_free[kf]) {
-                kf++;
-                kn++;
-            } else {
-                to_free[kf]->~T();
-                kf++;
+        for (size_t k = 0; k <= next_slab && k < slabs.size(); k++) {
+            size_t num_handed_out = k == next_slab ? next_slot_in_slab : slab_sizes[k];
+            for (size_t i = 0; i < num_handed_out; i++) {
+                Slot *s = &slabs[k][i];
+                if (!std::binary_search(not_in_use.begin(), not_in_use.end(), s))
+                    reinterpret_cast<T *>(s->storage)->~T();
             }
         }
-
-        // Free all allocated memory.
-        for (T *v : to_free) {
-            free(v);
-        }
     }
 };
 }  // namespace pm
 
-#endif
\ No newline at end of file
+#endif
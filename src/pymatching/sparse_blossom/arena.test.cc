@@ -0,0 +1,114 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/arena.h"
+
+#include <gtest/gtest.h>
+#include <set>
+
+using namespace pm;
+
+struct CountedObject {
+    static int num_alive;
+    std::vector<int> data;
+    CountedObject() : data(10, 1) {
+        num_alive++;
+    }
+    ~CountedObject() {
+        num_alive--;
+    }
+};
+int CountedObject::num_alive = 0;
+
+TEST(Arena, AllocAndReuse) {
+    Arena<CountedObject> arena;
+    std::set<CountedObject *> pointers;
+    std::vector<CountedObject *> objects;
+    for (size_t k = 0; k < 1000; k++) {
+        objects.push_back(arena.alloc_default_constructed());
+        pointers.insert(objects.back());
+    }
+    ASSERT_EQ(pointers.size(), 1000);
+    ASSERT_EQ(arena.size(), 1000);
+    ASSERT_EQ(CountedObject::num_alive, 1000);
+    size_t capacity = arena.capacity();
+    ASSERT_GE(capacity, 1000);
+
+    for (auto *p : objects)
+        arena.del(p);
+    ASSERT_EQ(arena.size(), 0);
+    ASSERT_EQ(CountedObject::num_alive, 0);
+
+    // Released slots are reused rather than allocating more memory.
+    for (size_t k = 0; k < 1000; k++) {
+        auto *p = arena.alloc_default_constructed();
+        ASSERT_TRUE(pointers.count(p));
+        arena.del(p);
+    }
+    for (size_t k = 0; k < 1000; k++)
+        ASSERT_TRUE(pointers.count(arena.alloc_default_constructed()));
+    ASSERT_EQ(arena.capacity(), capacity);
+    ASSERT_EQ(CountedObject::num_alive, 1000);
+}
+
+TEST(Arena, ClearDestructsObjectsInUse) {
+    {
+        Arena<CountedObject> arena;
+        std::vector<CountedObject *> objects;
+        for (size_t k = 0; k < 100; k++)
+            objects.push_back(arena.alloc_default_constructed());
+        for (size_t k = 0; k < 100; k += 3)
+            arena.del(objects[k]);
+        ASSERT_EQ(CountedObject::num_alive, 66);
+        size_t capacity = arena.capacity();
+
+        arena.clear();
+        ASSERT_EQ(CountedObject::num_alive, 0);
+        ASSERT_EQ(arena.size(), 0);
+        ASSERT_EQ(arena.capacity(), capacity);
+
+        // Memory is reused from the start after a clear.
+        ASSERT_EQ(arena.alloc_default_constructed(), objects[0]);
+        ASSERT_EQ(arena.alloc_default_constructed(), objects[1]);
+        objects.clear();
+        for (size_t k = 0; k < 50; k++)
+            objects.push_back(arena.alloc_default_constructed());
+        arena.del(objects[7]);
+        ASSERT_EQ(CountedObject::num_alive, 51);
+
+        Arena<CountedObject> moved(std::move(arena));
+        ASSERT_EQ(arena.size(), 0);
+        ASSERT_EQ(moved.size(), 51);
+    }
+    // Objects that were never deleted are destructed along with the arena.
+    ASSERT_EQ(CountedObject::num_alive, 0);
+}
+
+TEST(Arena, Reserve) {
+    Arena<CountedObject> arena;
+    arena.reserve(100);
+    size_t capacity = arena.capacity();
+    ASSERT_GE(capacity, 100);
+    ASSERT_EQ(arena.size(), 0);
+    arena.reserve(50);
+    ASSERT_EQ(arena.capacity(), capacity);
+
+    // The reserved memory is used before any more is allocated.
+    std::vector<CountedObject *> objects;
+    for (size_t k = 0; k < capacity; k++)
+        objects.push_back(arena.alloc_default_constructed());
+    ASSERT_EQ(arena.capacity(), capacity);
+    for (auto *p : objects)
+        arena.del(p);
+}
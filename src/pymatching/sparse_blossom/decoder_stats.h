@@ -0,0 +1,144 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_DECODER_STATS_H
+#define PYMATCHING2_DECODER_STATS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+/// Whether the decoder counts what it does while decoding each shot (see `DecoderStats'). Every counter update is
+/// compiled out unless this is set, so this is a build option (PYMATCHING_DECODER_STATS in CMakeLists.txt).
+#ifndef PM_DECODER_STATS
+#define PM_DECODER_STATS 0
+#endif
+
+namespace pm {
+
+constexpr bool DECODER_STATS_ENABLED = PM_DECODER_STATS != 0;
+
+/// Counts of the work done by the decoder while decoding a shot. They are only updated when the decoder is built
+/// with `DECODER_STATS_ENABLED', and are otherwise always zero.
+///
+/// Shots decoded without the blossom algorithm (see `SmallSyndromeCache') only count the work done to fill the
+/// cache, if any.
+struct DecoderStats {
+    /// The number of fields, in the order of `FIELD_NAMES' and `values'.
+    static constexpr size_t NUM_FIELDS = 12;
+    static constexpr std::array<const char *, NUM_FIELDS> FIELD_NAMES{
+        "region_hit_region_events",
+        "region_hit_boundary_events",
+        "blossom_shatter_events",
+        "blossoms_created",
+        "max_blossom_depth",
+        "queue_pushes",
+        "queue_pops",
+        "stale_dequeues",
+        "nodes_touched",
+        "max_regions_in_use",
+        "max_alt_tree_nodes_in_use",
+        "degraded_shots",
+    };
+
+    /// The number of events of each type passed from the flooder to the matcher.
+    size_t num_region_hit_region_events = 0;
+    size_t num_region_hit_boundary_events = 0;
+    size_t num_blossom_shatter_events = 0;
+    /// The number of blossoms formed, and the largest number of blossoms any detection event was nested in.
+    size_t num_blossoms_created = 0;
+    size_t max_blossom_depth = 0;
+    /// The number of events added to and taken from the flooder's queue, and how many of the events taken were
+    /// discarded as stale.
+    size_t num_queue_pushes = 0;
+    size_t num_queue_pops = 0;
+    size_t num_stale_dequeues = 0;
+    /// The number of times a region was created at or arrived at a detector node.
+    size_t num_nodes_touched = 0;
+    /// The largest number of regions and alternating tree nodes allocated at once in the arenas.
+    size_t max_regions_in_use = 0;
+    size_t max_alt_tree_nodes_in_use = 0;
+    /// The number of shots that ran out of work budget (see `Mwpm::work_budget'), and were decoded approximately.
+    size_t num_degraded_shots = 0;
+
+    void clear() {
+        *this = DecoderStats();
+    }
+
+    std::array<size_t, NUM_FIELDS> values() const {
+        return {
+            num_region_hit_region_events,
+            num_region_hit_boundary_events,
+            num_blossom_shatter_events,
+            num_blossoms_created,
+            max_blossom_depth,
+            num_queue_pushes,
+            num_queue_pops,
+            num_stale_dequeues,
+            num_nodes_touched,
+            max_regions_in_use,
+            max_alt_tree_nodes_in_use,
+            num_degraded_shots,
+        };
+    }
+
+    /// Accumulates the stats of another shot: counts are added, and maxima are combined with max.
+    DecoderStats &operator+=(const DecoderStats &other) {
+        num_region_hit_region_events += other.num_region_hit_region_events;
+        num_region_hit_boundary_events += other.num_region_hit_boundary_events;
+        num_blossom_shatter_events += other.num_blossom_shatter_events;
+        num_blossoms_created += other.num_blossoms_created;
+        max_blossom_depth = std::max(max_blossom_depth, other.max_blossom_depth);
+        num_queue_pushes += other.num_queue_pushes;
+        num_queue_pops += other.num_queue_pops;
+        num_stale_dequeues += other.num_stale_dequeues;
+        num_nodes_touched += other.num_nodes_touched;
+        max_regions_in_use = std::max(max_regions_in_use, other.max_regions_in_use);
+        max_alt_tree_nodes_in_use = std::max(max_alt_tree_nodes_in_use, other.max_alt_tree_nodes_in_use);
+        num_degraded_shots += other.num_degraded_shots;
+        return *this;
+    }
+
+    bool operator==(const DecoderStats &other) const {
+        return values() == other.values();
+    }
+    bool operator!=(const DecoderStats &other) const {
+        return !(*this == other);
+    }
+
+    std::string str() const {
+        std::stringstream ss;
+        ss << *this;
+        return ss.str();
+    }
+
+    friend std::ostream &operator<<(std::ostream &out, const DecoderStats &stats) {
+        auto vals = stats.values();
+        out << "DecoderStats{";
+        for (size_t k = 0; k < NUM_FIELDS; k++) {
+            if (k)
+                out << ", ";
+            out << FIELD_NAMES[k] << "=" << vals[k];
+        }
+        out << "}";
+        return out;
+    }
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_DECODER_STATS_H
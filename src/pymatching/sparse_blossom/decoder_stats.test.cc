@@ -0,0 +1,58 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/decoder_stats.h"
+
+#include <gtest/gtest.h>
+
+using namespace pm;
+
+TEST(DecoderStats, Accumulate) {
+    DecoderStats a;
+    a.num_region_hit_region_events = 3;
+    a.num_queue_pushes = 10;
+    a.max_blossom_depth = 2;
+    a.max_regions_in_use = 7;
+    DecoderStats b;
+    b.num_region_hit_region_events = 4;
+    b.num_nodes_touched = 5;
+    b.max_blossom_depth = 1;
+    b.max_regions_in_use = 9;
+
+    a += b;
+    ASSERT_EQ(a.num_region_hit_region_events, 7);
+    ASSERT_EQ(a.num_queue_pushes, 10);
+    ASSERT_EQ(a.num_nodes_touched, 5);
+    ASSERT_EQ(a.max_blossom_depth, 2);
+    ASSERT_EQ(a.max_regions_in_use, 9);
+    ASSERT_NE(a, DecoderStats());
+
+    a.clear();
+    ASSERT_EQ(a, DecoderStats());
+}
+
+TEST(DecoderStats, ValuesAndStr) {
+    DecoderStats stats;
+    stats.num_blossom_shatter_events = 2;
+    stats.max_alt_tree_nodes_in_use = 6;
+    auto values = stats.values();
+    ASSERT_EQ(values.size(), DecoderStats::NUM_FIELDS);
+    ASSERT_EQ(values[2], 2);
+    ASSERT_EQ(values[DecoderStats::NUM_FIELDS - 2], 6);
+    ASSERT_EQ(
+        stats.str(),
+        "DecoderStats{region_hit_region_events=0, region_hit_boundary_events=0, blossom_shatter_events=2, "
+        "blossoms_created=0, max_blossom_depth=0, queue_pushes=0, queue_pops=0, stale_dequeues=0, nodes_touched=0, "
+        "max_regions_in_use=0, max_alt_tree_nodes_in_use=6, degraded_shots=0}");
+}
@@ -0,0 +1,139 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/decoder_trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+const char TRACE_FILE_MAGIC[8] = {'P', 'M', 'T', 'R', 'A', 'C', 'E', '\0'};
+const uint32_t TRACE_FILE_VERSION = 1;
+
+template <typename T>
+void write_value(std::ostream &out, const T &value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_value(std::istream &in, T &value) {
+    in.read(reinterpret_cast<char *>(&value), sizeof(T));
+    return (size_t)in.gcount() == sizeof(T);
+}
+
+}  // namespace
+
+void pm::DecoderTrace::set_capacity(size_t capacity) {
+    records.assign(capacity, TraceRecord{});
+    num_records = 0;
+}
+
+void pm::DecoderTrace::begin_shot() {
+    num_records = 0;
+    if (!records.empty())
+        start_cycles = read_cycle_counter();
+}
+
+std::vector<pm::TraceRecord> pm::DecoderTrace::kept_records() const {
+    std::vector<TraceRecord> result;
+    if (records.empty())
+        return result;
+    size_t num_kept = std::min(num_records, records.size());
+    result.reserve(num_kept);
+    for (size_t k = num_records - num_kept; k < num_records; k++)
+        result.push_back(records[k % records.size()]);
+    return result;
+}
+
+void pm::DecoderTrace::write_shot(
+    std::ostream &out, uint64_t shot_index, uint64_t latency_ns, uint64_t num_detection_events) const {
+    auto kept = kept_records();
+    TraceShotHeader header{shot_index, latency_ns, num_detection_events, num_records, kept.size(), start_cycles};
+    write_value(out, header);
+    out.write(reinterpret_cast<const char *>(kept.data()), kept.size() * sizeof(TraceRecord));
+}
+
+void pm::write_trace_file_header(std::ostream &out) {
+    out.write(TRACE_FILE_MAGIC, sizeof(TRACE_FILE_MAGIC));
+    write_value(out, TRACE_FILE_VERSION);
+    write_value(out, (uint32_t)sizeof(TraceRecord));
+}
+
+std::vector<pm::ShotTrace> pm::read_trace_file(std::istream &in) {
+    char magic[sizeof(TRACE_FILE_MAGIC)];
+    uint32_t version, record_size;
+    in.read(magic, sizeof(magic));
+    if ((size_t)in.gcount() != sizeof(magic) || memcmp(magic, TRACE_FILE_MAGIC, sizeof(magic)) != 0)
+        throw std::invalid_argument("Not a decoder trace file.");
+    if (!read_value(in, version) || !read_value(in, record_size) || version != TRACE_FILE_VERSION ||
+        record_size != sizeof(TraceRecord))
+        throw std::invalid_argument("Unsupported decoder trace file version.");
+
+    std::vector<ShotTrace> traces;
+    ShotTrace trace;
+    while (read_value(in, trace.header)) {
+        trace.records.resize(trace.header.num_kept_records);
+        size_t num_bytes = trace.records.size() * sizeof(TraceRecord);
+        in.read(reinterpret_cast<char *>(trace.records.data()), num_bytes);
+        if ((size_t)in.gcount() != num_bytes)
+            throw std::invalid_argument("Decoder trace file ended in the middle of a shot.");
+        traces.push_back(trace);
+    }
+    return traces;
+}
+
+void pm::write_trace_summary(std::ostream &out, const std::vector<ShotTrace> &traces, size_t num_top_nodes) {
+    std::array<uint64_t, NUM_TRACE_EVENT_KINDS> kind_counts{};
+    std::array<uint64_t, NUM_TRACE_EVENT_KINDS> kind_cycles{};
+    std::unordered_map<uint32_t, uint64_t> node_counts;
+
+    out << "shot,latency_ns,detection_events,events,kept_events,cycles\n";
+    for (const auto &trace : traces) {
+        const auto &records = trace.records;
+        uint64_t cycles = records.empty() ? 0 : records.back().cycles - trace.header.start_cycles;
+        out << trace.header.shot_index << "," << trace.header.latency_ns << ","
+            << trace.header.num_detection_events << "," << trace.header.num_records << ","
+            << trace.header.num_kept_records << "," << cycles << "\n";
+        for (size_t k = 0; k < records.size(); k++) {
+            const auto &r = records[k];
+            if (r.kind >= NUM_TRACE_EVENT_KINDS)
+                throw std::invalid_argument("Decoder trace file has an unknown event kind.");
+            kind_counts[r.kind]++;
+            if (k + 1 < records.size())
+                kind_cycles[r.kind] += records[k + 1].cycles - r.cycles;
+            for (uint32_t node : {r.node1, r.node2}) {
+                if (node != TRACE_NO_NODE)
+                    node_counts[node]++;
+            }
+        }
+    }
+
+    out << "\nevent_kind,count,cycles\n";
+    for (size_t k = 0; k < NUM_TRACE_EVENT_KINDS; k++)
+        out << TRACE_EVENT_KIND_NAMES[k] << "," << kind_counts[k] << "," << kind_cycles[k] << "\n";
+
+    std::vector<std::pair<uint64_t, uint32_t>> nodes;
+    for (const auto &[node, count] : node_counts)
+        nodes.push_back({count, node});
+    size_t num_shown = std::min(num_top_nodes, nodes.size());
+    std::partial_sort(nodes.begin(), nodes.begin() + num_shown, nodes.end(), [](const auto &a, const auto &b) {
+        return a.first > b.first || (a.first == b.first && a.second < b.second);
+    });
+    out << "\nnode,events\n";
+    for (size_t k = 0; k < num_shown; k++)
+        out << nodes[k].second << "," << nodes[k].first << "\n";
+}
@@ -0,0 +1,170 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_DECODER_TRACE_H
+#define PYMATCHING2_DECODER_TRACE_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/// Whether the decoder can record a trace of the events of each shot (see `DecoderTrace'). Every record is compiled
+/// out unless this is set, so this is a build option (PYMATCHING_DECODER_TRACE in CMakeLists.txt).
+#ifndef PM_DECODER_TRACE
+#define PM_DECODER_TRACE 0
+#endif
+
+namespace pm {
+
+constexpr bool DECODER_TRACE_ENABLED = PM_DECODER_TRACE != 0;
+
+/// A timestamp in CPU cycles (the time stamp counter on x86, the virtual counter on ARM64), or in nanoseconds of a
+/// steady clock on other platforms. Only differences between timestamps taken on the same core are meaningful.
+inline uint64_t read_cycle_counter() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+#endif
+}
+
+/// What a `TraceRecord' records: a flood check event taken from the flooder's queue, or an event passed from the
+/// flooder to the matcher.
+enum TraceEventKind : uint8_t {
+    /// A LOOK_AT_NODE flood check event. `node1' is the node.
+    TRACE_LOOK_AT_NODE,
+    /// A LOOK_AT_SHRINKING_REGION flood check event. `node1' is the last node of the region's shell, if it has one.
+    TRACE_LOOK_AT_SHRINKING_REGION,
+    /// A flood check event that was discarded as stale. `node1' is its node, as above.
+    TRACE_STALE_EVENT,
+    /// MwpmEvents processed by the matcher. `node1' and `node2' are the ends of the edge of the collision, if any.
+    TRACE_REGION_HIT_REGION,
+    TRACE_REGION_HIT_BOUNDARY,
+    TRACE_BLOSSOM_SHATTER,
+};
+
+constexpr size_t NUM_TRACE_EVENT_KINDS = 6;
+constexpr std::array<const char *, NUM_TRACE_EVENT_KINDS> TRACE_EVENT_KIND_NAMES{
+    "look_at_node",
+    "look_at_shrinking_region",
+    "stale_event",
+    "region_hit_region",
+    "region_hit_boundary",
+    "blossom_shatter",
+};
+
+/// Used for the nodes of a `TraceRecord' that are absent (such as the boundary).
+constexpr uint32_t TRACE_NO_NODE = UINT32_MAX;
+
+/// One event of a trace, as written to trace files.
+struct TraceRecord {
+    /// When the event was recorded (see `read_cycle_counter').
+    uint64_t cycles;
+    /// The flooding time (the current time of the flooder's queue) of the event.
+    int64_t flood_time;
+    uint32_t node1;
+    uint32_t node2;
+    TraceEventKind kind;
+    uint8_t padding[7];
+};
+static_assert(sizeof(TraceRecord) == 32, "Trace records are written to files as they are.");
+
+/// The header of the trace of a shot in a trace file, which is followed by its `num_kept_records' records.
+struct TraceShotHeader {
+    uint64_t shot_index;
+    uint64_t latency_ns;
+    uint64_t num_detection_events;
+    /// The number of events recorded while decoding the shot, and how many of the last of them were kept.
+    uint64_t num_records;
+    uint64_t num_kept_records;
+    /// The timestamp of the start of the shot (see `DecoderTrace::begin_shot').
+    uint64_t start_cycles;
+};
+
+/// Records the events of the shot being decoded in a ring buffer, keeping the last `capacity()' of them, so that the
+/// trace of a shot can be written to a trace file once it is known to have been slow. Events are only recorded when
+/// the decoder is built with `DECODER_TRACE_ENABLED', and the capacity has been set.
+class DecoderTrace {
+   public:
+    /// Discards the recorded events, and keeps at most `capacity' events from now on (none if it is 0).
+    void set_capacity(size_t capacity);
+    inline size_t capacity() const {
+        return records.size();
+    }
+    /// Discards the events recorded for the previous shot.
+    void begin_shot();
+
+    inline void record(TraceEventKind kind, int64_t flood_time, uint32_t node1, uint32_t node2 = TRACE_NO_NODE) {
+        if (records.empty())
+            return;
+        TraceRecord &r = records[num_records % records.size()];
+        r.cycles = read_cycle_counter();
+        r.flood_time = flood_time;
+        r.node1 = node1;
+        r.node2 = node2;
+        r.kind = kind;
+        num_records++;
+    }
+
+    /// The number of events recorded since the start of the shot, including any no longer kept.
+    inline size_t num_recorded() const {
+        return num_records;
+    }
+    /// The kept events of the current shot, oldest first.
+    std::vector<TraceRecord> kept_records() const;
+    /// Appends the trace of the current shot to a trace file started with `write_trace_file_header'.
+    void write_shot(std::ostream &out, uint64_t shot_index, uint64_t latency_ns, uint64_t num_detection_events)
+        const;
+
+   private:
+    std::vector<TraceRecord> records;
+    size_t num_records = 0;
+    uint64_t start_cycles = 0;
+};
+
+/// The trace of a shot read from a trace file.
+struct ShotTrace {
+    TraceShotHeader header;
+    std::vector<TraceRecord> records;
+};
+
+/// Writes the header of a trace file, identifying its format.
+void write_trace_file_header(std::ostream &out);
+/// Reads the shot traces of a trace file. Throws std::invalid_argument if it isn't a valid trace file.
+std::vector<ShotTrace> read_trace_file(std::istream &in);
+/// Writes a summary of `traces': each shot's latency and number of events, the number of events of each kind and
+/// the cycles spent on them (the time from each event to the next one of its shot), and the `num_top_nodes' nodes
+/// that the events looked at most often.
+void write_trace_summary(std::ostream &out, const std::vector<ShotTrace> &traces, size_t num_top_nodes);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_DECODER_TRACE_H
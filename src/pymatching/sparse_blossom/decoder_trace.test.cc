@@ -0,0 +1,87 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/decoder_trace.h"
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace pm;
+
+TEST(DecoderTrace, KeepsTheLastEventsOfTheShot) {
+    DecoderTrace trace;
+    trace.record(TRACE_LOOK_AT_NODE, 0, 1);
+    ASSERT_EQ(trace.num_recorded(), 0);
+
+    trace.set_capacity(3);
+    trace.begin_shot();
+    for (uint32_t k = 0; k < 5; k++)
+        trace.record(TRACE_LOOK_AT_NODE, k, k);
+    ASSERT_EQ(trace.num_recorded(), 5);
+    auto records = trace.kept_records();
+    ASSERT_EQ(records.size(), 3);
+    for (size_t k = 0; k < 3; k++) {
+        ASSERT_EQ(records[k].node1, k + 2);
+        ASSERT_EQ(records[k].flood_time, (int64_t)k + 2);
+        ASSERT_EQ(records[k].node2, TRACE_NO_NODE);
+    }
+    ASSERT_LE(records[0].cycles, records[2].cycles);
+
+    trace.begin_shot();
+    trace.record(TRACE_REGION_HIT_REGION, 7, 3, 4);
+    records = trace.kept_records();
+    ASSERT_EQ(records.size(), 1);
+    ASSERT_EQ(records[0].kind, TRACE_REGION_HIT_REGION);
+    ASSERT_EQ(records[0].node2, 4);
+}
+
+TEST(DecoderTrace, WriteReadAndSummarize) {
+    DecoderTrace trace;
+    trace.set_capacity(2);
+    std::stringstream file;
+    write_trace_file_header(file);
+
+    trace.begin_shot();
+    trace.record(TRACE_LOOK_AT_NODE, 0, 8);
+    trace.record(TRACE_STALE_EVENT, 1, 8);
+    trace.record(TRACE_REGION_HIT_BOUNDARY, 2, 9);
+    trace.write_shot(file, 5, 1200, 2);
+    trace.begin_shot();
+    trace.record(TRACE_BLOSSOM_SHATTER, 3, TRACE_NO_NODE);
+    trace.write_shot(file, 9, 800, 4);
+
+    auto traces = read_trace_file(file);
+    ASSERT_EQ(traces.size(), 2);
+    ASSERT_EQ(traces[0].header.shot_index, 5);
+    ASSERT_EQ(traces[0].header.latency_ns, 1200);
+    ASSERT_EQ(traces[0].header.num_detection_events, 2);
+    ASSERT_EQ(traces[0].header.num_records, 3);
+    ASSERT_EQ(traces[0].header.num_kept_records, 2);
+    ASSERT_EQ(traces[0].records.size(), 2);
+    ASSERT_EQ(traces[0].records[0].kind, TRACE_STALE_EVENT);
+    ASSERT_EQ(traces[0].records[1].node1, 9);
+    ASSERT_EQ(traces[1].header.shot_index, 9);
+    ASSERT_EQ(traces[1].records.size(), 1);
+
+    std::stringstream summary;
+    write_trace_summary(summary, traces, 1);
+    auto text = summary.str();
+    ASSERT_NE(text.find("\n5,1200,2,3,2,"), std::string::npos);
+    ASSERT_NE(text.find("\nstale_event,1,"), std::string::npos);
+    ASSERT_NE(text.find("\nblossom_shatter,1,0\n"), std::string::npos);
+    ASSERT_NE(text.find("\nnode,events\n8,1\n"), std::string::npos);
+
+    std::stringstream not_a_trace("PMGRAPH");
+    ASSERT_THROW(read_trace_file(not_a_trace), std::invalid_argument);
+}
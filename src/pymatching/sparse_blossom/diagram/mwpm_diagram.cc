@@ -140,7 +140,7 @@ struct StateHelper {
                 return;
             }
 
-            for (size_t nk = 0; nk < n->neighbor_weights.size(); nk++) {
+            for (size_t nk = 0; nk < n->neighbors.size(); nk++) {
                 auto w = n->neighbor_weights[nk];
                 auto r = n->compute_stitch_radius_at_time_bounded_by_region_towards_neighbor(t, *region, nk);
                 if (!r.has_value()) {
@@ -429,6 +429,7 @@ void pm::write_animated_decoding_svg_frames(
     size_t max_growth_between_frames) {
     // Set up the decoder.
     mwpm.flooder.queue.cur_time = 0;
+    mwpm.flooder.start_shot();
     for (auto &detection : detection_events) {
         mwpm.create_detection_event(&mwpm.flooder.graph.nodes[detection]);
     }
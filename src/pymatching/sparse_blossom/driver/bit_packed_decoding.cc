@@ -0,0 +1,142 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/bit_packed_decoding.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "pymatching/sparse_blossom/driver/mapped_shot_file.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/shot_scheduler.h"
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+
+namespace {
+
+void decode_bit_packed_shots_of_worker(
+    pm::Mwpm& mwpm,
+    pm::ShotScheduler& scheduler,
+    size_t worker,
+    const uint8_t* shots,
+    size_t num_shot_bytes,
+    uint8_t* predictions,
+    size_t num_prediction_bytes) {
+    size_t num_observables = mwpm.flooder.graph.num_observables;
+    bool fits_obs_mask = num_observables <= sizeof(pm::obs_int) * 8;
+    std::vector<uint64_t> detection_events;
+    // Only used for graphs with more observables than fit in an obs_int.
+    std::vector<uint8_t> obs_crossed(fits_obs_mask ? 0 : num_observables);
+    size_t begin, end;
+    while (scheduler.next_range(worker, begin, end)) {
+        for (size_t i = begin; i < end; i++) {
+            detection_events.clear();
+            pm::append_set_bit_indices(shots + i * num_shot_bytes, num_shot_bytes, detection_events);
+            uint8_t* out = predictions + i * num_prediction_bytes;
+            std::memset(out, 0, num_prediction_bytes);
+            if (fits_obs_mask) {
+                pm::obs_int obs_mask =
+                    pm::decode_detection_events_for_up_to_64_observables(mwpm, detection_events).obs_mask;
+                for (size_t k = 0; k < num_observables; k++)
+                    out[k >> 3] |= (uint8_t)pm::obs_int_bit(obs_mask, k) << (k & 7);
+            } else {
+                std::fill(obs_crossed.begin(), obs_crossed.end(), 0);
+                pm::total_weight_int weight = 0;
+                pm::decode_detection_events(mwpm, detection_events, obs_crossed.data(), weight);
+                for (size_t k = 0; k < num_observables; k++)
+                    out[k >> 3] |= (obs_crossed[k] & 1) << (k & 7);
+            }
+        }
+    }
+}
+
+}  // namespace
+
+void pm::decode_bit_packed_shots(
+    const std::vector<pm::Mwpm*>& mwpms,
+    const uint8_t* shots,
+    size_t num_shots,
+    size_t num_shot_bytes,
+    uint8_t* predictions,
+    size_t num_prediction_bytes) {
+    if (mwpms.empty())
+        throw std::invalid_argument("At least one Mwpm is needed to decode shots.");
+    size_t num_observables = mwpms[0]->flooder.graph.num_observables;
+    if (num_prediction_bytes * 8 < num_observables)
+        throw std::invalid_argument(
+            "The predictions of each shot have " + std::to_string(num_prediction_bytes) +
+            " bytes, which is too few for the " + std::to_string(num_observables) + " observables of the graph.");
+    if (num_shots == 0)
+        return;
+
+    size_t num_workers = std::min(mwpms.size(), num_shots);
+    pm::ShotScheduler scheduler(num_shots, num_workers);
+    if (num_workers == 1) {
+        decode_bit_packed_shots_of_worker(
+            *mwpms[0], scheduler, 0, shots, num_shot_bytes, predictions, num_prediction_bytes);
+        return;
+    }
+    // Each shot is decoded by exactly one worker, which writes to its own bytes of the predictions.
+    std::vector<std::exception_ptr> errors(num_workers);
+    std::vector<std::thread> workers;
+    workers.reserve(num_workers);
+    for (size_t w = 0; w < num_workers; w++) {
+        workers.emplace_back([&, w]() {
+            try {
+                decode_bit_packed_shots_of_worker(
+                    *mwpms[w], scheduler, w, shots, num_shot_bytes, predictions, num_prediction_bytes);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    for (auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+void pm::decode_bit_packed_shot_file(
+    const std::vector<pm::Mwpm*>& mwpms,
+    size_t num_shots,
+    const std::string& dets_b8_path,
+    size_t num_detectors,
+    const std::string& predictions_b8_path,
+    size_t num_observables) {
+    pm::MappedShotFile dets(dets_b8_path, stim::SampleFormat::SAMPLE_FORMAT_B8, num_detectors, 0);
+    size_t num_shot_bytes = (num_detectors + 7) >> 3;
+    size_t num_prediction_bytes = (num_observables + 7) >> 3;
+    if (dets.size_in_bytes() != num_shots * num_shot_bytes)
+        throw std::invalid_argument(
+            "'" + dets_b8_path + "' has " + std::to_string(dets.size_in_bytes()) + " bytes, but " +
+            std::to_string(num_shots) + " shots of " + std::to_string(num_detectors) + " detectors take " +
+            std::to_string(num_shots * num_shot_bytes) + " bytes in the b8 format.");
+
+    std::vector<uint8_t> predictions(num_shots * num_prediction_bytes);
+    decode_bit_packed_shots(
+        mwpms, dets.all().begin, num_shots, num_shot_bytes, predictions.data(), num_prediction_bytes);
+
+    FILE* out = fopen(predictions_b8_path.c_str(), "wb");
+    if (out == nullptr)
+        throw std::invalid_argument("Failed to open '" + predictions_b8_path + "' to write to.");
+    size_t num_written = fwrite(predictions.data(), 1, predictions.size(), out);
+    bool closed = fclose(out) == 0;
+    if (num_written != predictions.size() || !closed)
+        throw std::invalid_argument("Failed to write the predictions to '" + predictions_b8_path + "'.");
+}
@@ -0,0 +1,63 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_BIT_PACKED_DECODING_H
+#define PYMATCHING2_BIT_PACKED_DECODING_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pymatching/sparse_blossom/matcher/mwpm.h"
+
+namespace pm {
+
+/// Decodes `num_shots' shots of bit-packed detection events, as used by sinter and stim's `b8' format, writing the
+/// bit-packed predicted observables of each shot.
+///
+/// Shot i is the `num_shot_bytes' bytes starting at `shots + i * num_shot_bytes', in which detector k is bit
+/// `k % 8' of byte `k / 8'. Its predictions are written to the `num_prediction_bytes' bytes starting at
+/// `predictions + i * num_prediction_bytes' in the same way, overwriting them (bits past the last observable of the
+/// graph are set to 0). The detection events are extracted straight from `shots', and the predictions of graphs with
+/// up to 64 observables are written straight from the observable mask of the solution, so neither is unpacked into a
+/// byte per bit.
+///
+/// The shots are shared out between one thread per Mwpm of `mwpms' (which must all be for the same graph) with a
+/// `ShotScheduler'. Throws std::invalid_argument if `num_prediction_bytes' is too small to hold the observables of
+/// the graph, or rethrows the first error thrown while decoding a shot (e.g. for a detection event that isn't in the
+/// graph).
+void decode_bit_packed_shots(
+    const std::vector<pm::Mwpm*>& mwpms,
+    const uint8_t* shots,
+    size_t num_shots,
+    size_t num_shot_bytes,
+    uint8_t* predictions,
+    size_t num_prediction_bytes);
+
+/// Decodes the `num_shots' shots of a `b8' file of `num_detectors' detection events per shot (with no appended
+/// observables), writing a `b8' file of `num_observables' predicted observables per shot, as sinter's
+/// `decode_via_files' does. The detection events file is memory mapped (see `MappedShotFile') and decoded in place
+/// with `decode_bit_packed_shots'. Throws std::invalid_argument if either file can't be opened, or if the size of
+/// the detection events file doesn't match `num_shots'.
+void decode_bit_packed_shot_file(
+    const std::vector<pm::Mwpm*>& mwpms,
+    size_t num_shots,
+    const std::string& dets_b8_path,
+    size_t num_detectors,
+    const std::string& predictions_b8_path,
+    size_t num_observables);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_BIT_PACKED_DECODING_H
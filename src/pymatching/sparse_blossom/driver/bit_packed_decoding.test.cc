@@ -0,0 +1,145 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/bit_packed_decoding.h"
+
+#include <random>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+
+namespace {
+
+std::vector<uint8_t> random_bit_packed_shots(size_t num_shots, size_t num_detectors, uint32_t seed) {
+    std::mt19937 rng(seed);
+    size_t num_shot_bytes = (num_detectors + 7) >> 3;
+    std::vector<uint8_t> shots(num_shots * num_shot_bytes, 0);
+    for (size_t i = 0; i < num_shots; i++) {
+        for (size_t k = 0; k < num_detectors; k++) {
+            if (rng() % 10 == 0)
+                shots[i * num_shot_bytes + (k >> 3)] |= 1 << (k & 7);
+        }
+    }
+    return shots;
+}
+
+/// The predictions of each shot, decoded one at a time and bit-packed.
+std::vector<uint8_t> expected_predictions(
+    pm::UserGraph& graph, const std::vector<uint8_t>& shots, size_t num_shot_bytes, size_t num_prediction_bytes) {
+    auto& mwpm = graph.get_mwpm();
+    size_t num_shots = shots.size() / num_shot_bytes;
+    std::vector<uint8_t> predictions(num_shots * num_prediction_bytes, 0);
+    for (size_t i = 0; i < num_shots; i++) {
+        std::vector<uint64_t> detection_events;
+        for (size_t k = 0; k < num_shot_bytes * 8; k++) {
+            if ((shots[i * num_shot_bytes + (k >> 3)] >> (k & 7)) & 1)
+                detection_events.push_back(k);
+        }
+        std::vector<uint8_t> obs_crossed(graph.get_num_observables(), 0);
+        pm::total_weight_int weight = 0;
+        pm::decode_detection_events(mwpm, detection_events, obs_crossed.data(), weight);
+        for (size_t k = 0; k < obs_crossed.size(); k++)
+            predictions[i * num_prediction_bytes + (k >> 3)] |= obs_crossed[k] << (k & 7);
+    }
+    return predictions;
+}
+
+}  // namespace
+
+TEST(BitPackedDecoding, MatchesSerialDecoding) {
+    for (size_t num_observables : {3, 64, 70}) {
+        auto graph = pm::repetition_code_graph(100, num_observables);
+        size_t num_shot_bytes = 13;
+        size_t num_prediction_bytes = (num_observables + 7) >> 3;
+        auto shots = random_bit_packed_shots(500, 100, 5);
+        auto expected = expected_predictions(graph, shots, num_shot_bytes, num_prediction_bytes);
+        for (size_t num_threads : {1, 2, 5}) {
+            // Garbage in the predictions buffer must be overwritten.
+            std::vector<uint8_t> predictions(expected.size(), 0xFF);
+            pm::decode_bit_packed_shots(
+                graph.get_mwpms(num_threads), shots.data(), 500, num_shot_bytes, predictions.data(),
+                num_prediction_bytes);
+            ASSERT_EQ(predictions, expected);
+        }
+    }
+}
+
+TEST(BitPackedDecoding, WiderPredictionsArePaddedWithZeros) {
+    auto graph = pm::repetition_code_graph(20, 5);
+    auto shots = random_bit_packed_shots(50, 20, 7);
+    auto expected = expected_predictions(graph, shots, 3, 1);
+    std::vector<uint8_t> predictions(50 * 3, 0xFF);
+    pm::decode_bit_packed_shots(graph.get_mwpms(2), shots.data(), 50, 3, predictions.data(), 3);
+    for (size_t i = 0; i < 50; i++) {
+        ASSERT_EQ(predictions[3 * i], expected[i]);
+        ASSERT_EQ(predictions[3 * i + 1], 0);
+        ASSERT_EQ(predictions[3 * i + 2], 0);
+    }
+}
+
+TEST(BitPackedDecoding, Errors) {
+    auto graph = pm::repetition_code_graph(20, 9);
+    auto shots = random_bit_packed_shots(10, 20, 3);
+    std::vector<uint8_t> predictions(10 * 2);
+    // Too few bytes for 9 observables.
+    ASSERT_THROW(
+        pm::decode_bit_packed_shots(graph.get_mwpms(1), shots.data(), 10, 3, predictions.data(), 1),
+        std::invalid_argument);
+    // A detection event past the last node of the graph, in one of the shots.
+    shots[5 * 3 + 2] |= 0x80;
+    ASSERT_THROW(
+        pm::decode_bit_packed_shots(graph.get_mwpms(3), shots.data(), 10, 3, predictions.data(), 2),
+        std::invalid_argument);
+    // No shots.
+    pm::decode_bit_packed_shots(graph.get_mwpms(3), nullptr, 0, 3, nullptr, 2);
+}
+
+TEST(BitPackedDecoding, DecodeShotFile) {
+    auto graph = pm::repetition_code_graph(30, 4);
+    auto shots = random_bit_packed_shots(200, 30, 11);
+    auto expected = expected_predictions(graph, shots, 4, 1);
+
+    char dets_path[] = "/tmp/pymatching_bit_packed_dets_XXXXXX";
+    int fd = mkstemp(dets_path);
+    ASSERT_NE(fd, -1);
+    FILE* f = fdopen(fd, "wb");
+    fwrite(shots.data(), 1, shots.size(), f);
+    fclose(f);
+    char predictions_path[] = "/tmp/pymatching_bit_packed_predictions_XXXXXX";
+    fd = mkstemp(predictions_path);
+    ASSERT_NE(fd, -1);
+    close(fd);
+
+    pm::decode_bit_packed_shot_file(graph.get_mwpms(3), 200, dets_path, 30, predictions_path, 4);
+    std::vector<uint8_t> predictions(expected.size() + 1);
+    f = fopen(predictions_path, "rb");
+    ASSERT_EQ(fread(predictions.data(), 1, predictions.size(), f), expected.size());
+    fclose(f);
+    predictions.pop_back();
+    ASSERT_EQ(predictions, expected);
+
+    // The number of shots must match the size of the file.
+    ASSERT_THROW(
+        pm::decode_bit_packed_shot_file(graph.get_mwpms(1), 199, dets_path, 30, predictions_path, 4),
+        std::invalid_argument);
+    remove(dets_path);
+    remove(predictions_path);
+    ASSERT_THROW(
+        pm::decode_bit_packed_shot_file(graph.get_mwpms(1), 200, dets_path, 30, predictions_path, 4),
+        std::invalid_argument);
+}
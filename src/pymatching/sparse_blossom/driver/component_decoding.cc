@@ -0,0 +1,173 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/component_decoding.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+
+pm::ComponentDecoder::ComponentDecoder(UserGraph& graph, size_t num_threads)
+    : _num_observables(0), next_active_component(0), generation(0), num_workers_done(0), stopping(false) {
+    if (num_threads == 0)
+        throw std::invalid_argument("The number of threads must be at least 1.");
+    auto& flooder = graph.get_mwpm().flooder;
+    if (flooder.negative_weight_sum != 0 || !flooder.negative_weight_detection_events.empty())
+        throw std::invalid_argument("Component decoding is not supported for graphs with negative edge weights.");
+    auto& matching_graph = flooder.graph;
+    _num_observables = matching_graph.num_observables;
+
+    auto& topology = *matching_graph.topology;
+    size_t num_nodes = matching_graph.nodes.size();
+    component_of_detector.resize(num_nodes);
+    for (size_t node = 0; node < num_nodes; node++)
+        component_of_detector[matching_graph.original_node_index(node)] = topology.component_of_node[node];
+    components.resize(topology.num_components);
+
+    // There is no use for more threads than components.
+    num_threads = std::max<size_t>(1, std::min(num_threads, components.size()));
+    for (auto mwpm : graph.get_mwpms(num_threads))
+        thread_states.push_back({mwpm, std::vector<uint8_t>(_num_observables, 0), 0});
+    for (size_t t = 1; t < num_threads; t++)
+        workers.emplace_back(&ComponentDecoder::run_worker, this, t);
+}
+
+pm::ComponentDecoder::~ComponentDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+size_t pm::ComponentDecoder::num_components() const {
+    return components.size();
+}
+
+size_t pm::ComponentDecoder::num_threads() const {
+    return workers.size() + 1;
+}
+
+size_t pm::ComponentDecoder::num_observables() const {
+    return _num_observables;
+}
+
+size_t pm::ComponentDecoder::num_active_components() const {
+    return active_components.size();
+}
+
+void pm::ComponentDecoder::decode_components_of_thread(size_t thread_index) {
+    auto& state = thread_states[thread_index];
+    std::fill(state.obs_crossed.begin(), state.obs_crossed.end(), 0);
+    state.weight = 0;
+    // Components are taken one at a time, so a thread that gets a large component doesn't hold up the others.
+    while (true) {
+        size_t k = next_active_component.fetch_add(1, std::memory_order_relaxed);
+        if (k >= active_components.size())
+            return;
+        auto& component = components[active_components[k]];
+        // `decode_detection_events' may overwrite, rather than add to, the weight it is given.
+        pm::total_weight_int component_weight = 0;
+        pm::decode_detection_events(
+            *state.mwpm, component.detection_events, state.obs_crossed.data(), component_weight);
+        state.weight += component_weight;
+    }
+}
+
+void pm::ComponentDecoder::run_worker(size_t thread_index) {
+    size_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [&] {
+                return stopping || generation != seen_generation;
+            });
+            if (stopping)
+                return;
+            seen_generation = generation;
+        }
+        std::exception_ptr error;
+        try {
+            decode_components_of_thread(thread_index);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error && !worker_error)
+                worker_error = error;
+            num_workers_done++;
+        }
+        done_cv.notify_one();
+    }
+}
+
+void pm::ComponentDecoder::decode(
+    const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr, total_weight_int& weight) {
+    for (size_t c : active_components)
+        components[c].detection_events.clear();
+    active_components.clear();
+    for (auto d : detection_events) {
+        if (d >= component_of_detector.size()) {
+            throw std::invalid_argument(
+                "Detection event index `" + std::to_string(d) +
+                "` is larger than the number of nodes in the graph.");
+        }
+        size_t c = component_of_detector[d];
+        if (components[c].detection_events.empty())
+            active_components.push_back(c);
+        components[c].detection_events.push_back(d);
+    }
+    next_active_component.store(0, std::memory_order_relaxed);
+
+    // Waking the workers only pays off if there is more than one component to decode.
+    bool use_workers = !workers.empty() && active_components.size() > 1;
+    if (use_workers) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            num_workers_done = 0;
+            worker_error = nullptr;
+            generation++;
+        }
+        start_cv.notify_all();
+    }
+    std::exception_ptr error;
+    try {
+        decode_components_of_thread(0);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (use_workers) {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&] {
+            return num_workers_done == workers.size();
+        });
+        if (!error)
+            error = worker_error;
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    size_t num_used_threads = use_workers ? thread_states.size() : 1;
+    for (size_t t = 0; t < num_used_threads; t++) {
+        auto& state = thread_states[t];
+        for (size_t i = 0; i < _num_observables; i++)
+            obs_begin_ptr[i] ^= state.obs_crossed[i];
+        weight += state.weight;
+    }
+}
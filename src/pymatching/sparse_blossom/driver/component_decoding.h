@@ -0,0 +1,95 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_COMPONENT_DECODING_H
+#define PYMATCHING2_COMPONENT_DECODING_H
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+
+namespace pm {
+
+/// Decodes single shots of a graph with several connected components (e.g. the X and Z detectors of a code, or
+/// independent logical qubits) by decoding the components concurrently.
+///
+/// The connected components are labeled when the graph is built (see `MatchingGraphTopology::component_of_node').
+/// The detection events of a shot are split by component, and each component with detection events is decoded by
+/// one of the threads, using its own Mwpm (one of the replicas of `UserGraph::get_mwpms', which share the topology of
+/// the graph but have their own flooder queue and matcher state). The solution is the sum of the solutions of the
+/// components, so it has the same weight as decoding the whole shot at once.
+///
+/// Graphs with negative edge weights are not supported, since their solutions don't split by component.
+class ComponentDecoder {
+   public:
+    /// Decodes `graph' with `num_threads' threads in total, including the calling thread. The graph must outlive the
+    /// decoder, and must not be modified while the decoder is in use. Throws std::invalid_argument if the graph has
+    /// negative edge weights.
+    explicit ComponentDecoder(UserGraph& graph, size_t num_threads = 1);
+    ~ComponentDecoder();
+    ComponentDecoder(const ComponentDecoder&) = delete;
+    ComponentDecoder& operator=(const ComponentDecoder&) = delete;
+
+    size_t num_components() const;
+    size_t num_threads() const;
+    size_t num_observables() const;
+    /// The number of components with detection events in the most recently decoded shot.
+    size_t num_active_components() const;
+
+    /// Decodes the detection events `detection_events' of a shot, XOR-ing the predicted observables into the array
+    /// starting at `obs_begin_ptr', which has `num_observables()' elements, and adding the weight of the solution to
+    /// `weight'.
+    void decode(const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr, total_weight_int& weight);
+
+   private:
+    struct Component {
+        std::vector<uint64_t> detection_events;
+    };
+    struct ThreadState {
+        Mwpm* mwpm;
+        std::vector<uint8_t> obs_crossed;
+        total_weight_int weight;
+    };
+
+    std::vector<Component> components;
+    /// The component of each (original) detector.
+    std::vector<size_t> component_of_detector;
+    std::vector<size_t> active_components;
+    std::vector<ThreadState> thread_states;
+    size_t _num_observables;
+    /// The position in `active_components' of the next component to be decoded by any thread.
+    std::atomic<size_t> next_active_component;
+
+    /// Worker threads, with thread indices from 1 (the calling thread is thread 0).
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    size_t generation;
+    size_t num_workers_done;
+    bool stopping;
+    std::exception_ptr worker_error;
+
+    void decode_components_of_thread(size_t thread_index);
+    void run_worker(size_t thread_index);
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_COMPONENT_DECODING_H
@@ -0,0 +1,106 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/component_decoding.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+
+namespace {
+
+/// `num_patches' disjoint `width' x `height' grids of nodes with random weights, each with boundary edges on its left
+/// and right sides, and with its own pair of observables.
+void add_grid_patches(pm::UserGraph& graph, size_t num_patches, size_t width, size_t height, std::mt19937& rng) {
+    std::uniform_real_distribution<double> weight(1.0, 3.0);
+    for (size_t p = 0; p < num_patches; p++) {
+        size_t first = p * width * height;
+        for (size_t y = 0; y < height; y++) {
+            for (size_t x = 0; x < width; x++) {
+                size_t node = first + y * width + x;
+                if (x + 1 < width)
+                    graph.add_or_merge_edge(node, node + 1, {}, weight(rng), -1);
+                if (y + 1 < height)
+                    graph.add_or_merge_edge(node, node + width, {}, weight(rng), -1);
+            }
+            graph.add_or_merge_boundary_edge(first + y * width, {2 * p}, weight(rng), -1);
+            graph.add_or_merge_boundary_edge(first + y * width + width - 1, {2 * p + 1}, weight(rng), -1);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(ComponentDecoder, MatchesDecodingWholeShots) {
+    std::mt19937 rng(3);
+    pm::UserGraph graph;
+    add_grid_patches(graph, 5, 4, 6, rng);
+    size_t num_nodes = graph.get_num_nodes();
+    auto& topology = *graph.get_mwpm().flooder.graph.topology;
+    ASSERT_EQ(topology.num_components, 5);
+    ASSERT_EQ(topology.component_of_node.size(), num_nodes);
+
+    for (size_t num_threads : {1, 3, 8}) {
+        pm::ComponentDecoder decoder(graph, num_threads);
+        ASSERT_EQ(decoder.num_components(), 5);
+        ASSERT_EQ(decoder.num_threads(), std::min<size_t>(num_threads, 5));
+        ASSERT_EQ(decoder.num_observables(), 10);
+        for (size_t shot = 0; shot < 200; shot++) {
+            std::vector<uint64_t> detection_events;
+            for (size_t i = 0; i < num_nodes; i++)
+                if (rng() % 8 == 0)
+                    detection_events.push_back(i);
+
+            std::vector<uint8_t> expected_obs(10, 0);
+            pm::total_weight_int expected_weight = 0;
+            pm::decode_detection_events(graph.get_mwpm(), detection_events, expected_obs.data(), expected_weight);
+            std::vector<uint8_t> obs(10, 0);
+            pm::total_weight_int weight = 0;
+            decoder.decode(detection_events, obs.data(), weight);
+            ASSERT_EQ(weight, expected_weight);
+            ASSERT_EQ(obs, expected_obs);
+            ASSERT_LE(decoder.num_active_components(), 5);
+        }
+    }
+}
+
+TEST(ComponentDecoder, OnlyDecodesComponentsWithDetectionEvents) {
+    std::mt19937 rng(5);
+    pm::UserGraph graph;
+    add_grid_patches(graph, 3, 3, 3, rng);
+    pm::ComponentDecoder decoder(graph, 2);
+    std::vector<uint8_t> obs(6, 0);
+    pm::total_weight_int weight = 0;
+    decoder.decode({}, obs.data(), weight);
+    ASSERT_EQ(decoder.num_active_components(), 0);
+    ASSERT_EQ(weight, 0);
+    decoder.decode({1, 2, 19}, obs.data(), weight);
+    ASSERT_EQ(decoder.num_active_components(), 2);
+    ASSERT_GT(weight, 0);
+    ASSERT_THROW(decoder.decode({27}, obs.data(), weight), std::invalid_argument);
+    // The decoder is still usable after an error.
+    pm::total_weight_int weight2 = 0;
+    std::vector<uint8_t> obs2(6, 0);
+    decoder.decode({1, 2, 19}, obs2.data(), weight2);
+    ASSERT_EQ(weight2, weight);
+}
+
+TEST(ComponentDecoder, RejectsNegativeWeights) {
+    pm::UserGraph graph;
+    graph.add_or_merge_edge(0, 1, {0}, -1.0, -1);
+    graph.add_or_merge_boundary_edge(0, {}, 2.0, -1);
+    ASSERT_THROW(pm::ComponentDecoder decoder(graph), std::invalid_argument);
+}
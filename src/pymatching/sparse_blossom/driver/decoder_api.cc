@@ -0,0 +1,153 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/decoder_api.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/graph_file.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/shot_scheduler.h"
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+#include "stim.h"
+
+pm::Decoder::Decoder(std::shared_ptr<UserGraph> graph) : graph(std::move(graph)) {
+    // Freezing the graph lets each DecoderState lease its own Mwpm from any thread, sharing the graph's topology.
+    this->graph->freeze();
+}
+
+pm::Decoder pm::Decoder::from_detector_error_model(const std::string& dem_text) {
+    auto dem = stim::DetectorErrorModel(dem_text.c_str());
+    return Decoder(std::make_shared<UserGraph>(detector_error_model_to_user_graph(dem)));
+}
+
+pm::Decoder pm::Decoder::from_detector_error_model_file(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "r");
+    if (file == nullptr)
+        throw std::invalid_argument("Failed to open '" + path + "'");
+    stim::DetectorErrorModel dem;
+    try {
+        dem = stim::DetectorErrorModel::from_file(file);
+    } catch (...) {
+        fclose(file);
+        throw;
+    }
+    fclose(file);
+    return Decoder(std::make_shared<UserGraph>(detector_error_model_to_user_graph(dem)));
+}
+
+pm::Decoder pm::Decoder::from_graph_file(const std::string& path) {
+    return Decoder(std::make_shared<UserGraph>(load_user_graph_from_graph_file(path)));
+}
+
+size_t pm::Decoder::num_detectors() const {
+    return graph->get_num_nodes();
+}
+
+size_t pm::Decoder::num_observables() const {
+    return graph->get_num_observables();
+}
+
+pm::DecoderState pm::Decoder::create_state() const {
+    return DecoderState(graph);
+}
+
+void pm::Decoder::decode_batch(
+    std::span<const uint8_t> shots,
+    size_t num_shots,
+    std::span<uint8_t> predictions,
+    std::span<double> weights,
+    size_t num_threads,
+    bool bit_packed_shots) const {
+    size_t row_bytes = bit_packed_shots ? (num_detectors() + 7) / 8 : num_detectors();
+    size_t num_obs = num_observables();
+    if (shots.size() < num_shots * row_bytes)
+        throw std::invalid_argument("`shots' is too small for `num_shots' shots.");
+    if (predictions.size() < num_shots * num_obs)
+        throw std::invalid_argument("`predictions' is too small for `num_shots' shots.");
+    if (!weights.empty() && weights.size() < num_shots)
+        throw std::invalid_argument("`weights' must be empty or have an element for each shot.");
+
+    size_t num_workers = std::max<size_t>(1, std::min(num_threads, num_shots));
+    std::vector<DecoderState> states;
+    states.reserve(num_workers);
+    for (size_t w = 0; w < num_workers; w++)
+        states.push_back(create_state());
+    ShotScheduler scheduler(num_shots, num_workers);
+    std::vector<std::exception_ptr> errors(num_workers);
+    auto decode_shots_of_worker = [&](size_t worker) {
+        try {
+            std::vector<uint64_t> detection_events;
+            size_t begin, end;
+            while (scheduler.next_range(worker, begin, end)) {
+                for (size_t i = begin; i < end; i++) {
+                    const uint8_t* row = shots.data() + i * row_bytes;
+                    detection_events.clear();
+                    if (bit_packed_shots) {
+                        append_set_bit_indices(row, row_bytes, detection_events);
+                    } else {
+                        append_nonzero_byte_indices(row, row_bytes, detection_events);
+                    }
+                    double weight = states[worker].decode(detection_events, predictions.subspan(i * num_obs, num_obs));
+                    if (!weights.empty())
+                        weights[i] = weight;
+                }
+            }
+        } catch (...) {
+            errors[worker] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    for (size_t w = 1; w < num_workers; w++)
+        threads.emplace_back(decode_shots_of_worker, w);
+    decode_shots_of_worker(0);
+    for (auto& t : threads)
+        t.join();
+    for (auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+pm::DecoderState::DecoderState(std::shared_ptr<UserGraph> graph)
+    : graph(std::move(graph)),
+      lease(std::make_unique<MwpmLease>(this->graph->acquire_mwpm())),
+      num_observables(this->graph->get_num_observables()),
+      normalising_constant((**lease).flooder.graph.normalising_constant) {
+}
+
+pm::DecoderState::DecoderState(DecoderState&& other) noexcept = default;
+pm::DecoderState& pm::DecoderState::operator=(DecoderState&& other) noexcept = default;
+
+pm::DecoderState::~DecoderState() = default;
+
+void pm::DecoderState::reserve(size_t expected_detection_events) {
+    (**lease).reserve(expected_detection_events);
+}
+
+double pm::DecoderState::decode(std::span<const uint64_t> detection_events, std::span<uint8_t> predictions) {
+    if (predictions.size() < num_observables)
+        throw std::invalid_argument("`predictions' must have an element for each observable.");
+    // With more observables than fit in an obs_int, the predictions are XOR-ed into the buffer.
+    std::fill(predictions.begin(), predictions.begin() + num_observables, 0);
+    total_weight_int weight = 0;
+    decode_detection_events(**lease, detection_events, predictions.data(), weight);
+    return (double)weight / normalising_constant;
+}
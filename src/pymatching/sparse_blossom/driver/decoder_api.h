@@ -0,0 +1,105 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_DECODER_API_H
+#define PYMATCHING2_DECODER_API_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace pm {
+
+class UserGraph;
+class MwpmLease;
+class DecoderState;
+
+/// The API for decoding from C++ programs that link against `libpymatching', without depending on the internals
+/// of the decoder (such as `Mwpm' or `UserGraph'), which may change between releases. This header only includes
+/// standard library headers.
+///
+/// A `Decoder' holds a matching graph, which is frozen when it is loaded, and is only read while decoding. Each
+/// thread decoding shots one at a time uses its own `DecoderState', created with `Decoder::create_state'. All the
+/// states of a decoder share its graph, and each holds the memory used to decode a shot, so that once it has grown
+/// (or been reserved with `DecoderState::reserve'), decoding a shot doesn't allocate.
+///
+/// Errors are reported by throwing std::invalid_argument.
+class Decoder {
+   public:
+    /// Loads the graph of a detector error model, given in the text format of stim.
+    static Decoder from_detector_error_model(const std::string& dem_text);
+    /// Loads the graph of the detector error model in the file at `path'.
+    static Decoder from_detector_error_model_file(const std::string& path);
+    /// Loads a graph from a graph file written from a `pymatching.Matching' (e.g. by `Matching.save_graph'), which
+    /// skips parsing the detector error model and building the decoding graphs.
+    static Decoder from_graph_file(const std::string& path);
+
+    /// The number of nodes of the graph, including any boundary nodes (detection events at which are ignored).
+    size_t num_detectors() const;
+    size_t num_observables() const;
+
+    /// Creates the state used to decode shots on one thread. May be called from any thread.
+    DecoderState create_state() const;
+
+    /// Decodes `num_shots' shots, using `num_threads' threads (including the calling thread). The detection events
+    /// of shot i are in row i of `shots', of `num_detectors()' bytes, each nonzero for a detection event, or, if
+    /// `bit_packed_shots' is true, of (num_detectors() + 7) / 8 bytes, with the bit for detector k in
+    /// `(row[k / 8] >> (k % 8)) & 1'. The predicted observables of shot i are written to
+    /// `predictions[i * num_observables():]', one byte per observable, and the weight of its solution to
+    /// `weights[i]', unless `weights' is empty. The results are the same whatever the number of threads.
+    void decode_batch(
+        std::span<const uint8_t> shots,
+        size_t num_shots,
+        std::span<uint8_t> predictions,
+        std::span<double> weights,
+        size_t num_threads = 1,
+        bool bit_packed_shots = false) const;
+
+   private:
+    explicit Decoder(std::shared_ptr<UserGraph> graph);
+
+    std::shared_ptr<UserGraph> graph;
+};
+
+/// The state used to decode shots with a `Decoder' on one thread. Keeps the graph of its decoder alive.
+class DecoderState {
+   public:
+    DecoderState(DecoderState&& other) noexcept;
+    DecoderState& operator=(DecoderState&& other) noexcept;
+    ~DecoderState();
+
+    /// Grows the memory of the state to decode shots with up to about `expected_detection_events' detection events
+    /// without allocating.
+    void reserve(size_t expected_detection_events);
+
+    /// Decodes a shot with the given `detection_events' (detector indices), writing its predicted
+    /// observables to the first `num_observables()' bytes of `predictions' (as 0 or 1) and returning the weight of
+    /// its solution. Doesn't allocate, once the state has grown to fit the shot.
+    double decode(std::span<const uint64_t> detection_events, std::span<uint8_t> predictions);
+
+   private:
+    friend class Decoder;
+    explicit DecoderState(std::shared_ptr<UserGraph> graph);
+
+    std::shared_ptr<UserGraph> graph;
+    std::unique_ptr<MwpmLease> lease;
+    size_t num_observables;
+    double normalising_constant;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_DECODER_API_H
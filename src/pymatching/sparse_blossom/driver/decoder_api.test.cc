@@ -0,0 +1,135 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/decoder_api.h"
+
+#include <cstdio>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/graph_file.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+
+namespace {
+/// A decoder for a repetition code with 20 detectors and 2 observables, loaded from a graph file.
+
+pm::Decoder repetition_code_decoder() {
+    char path[] = "/tmp/pymatching_decoder_api_XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_NE(fd, -1);
+    close(fd);
+    auto graph = pm::repetition_code_graph(20, 2);
+    pm::save_graph_file(path, graph);
+    auto decoder = pm::Decoder::from_graph_file(path);
+    std::remove(path);
+    return decoder;
+}
+
+}  // namespace
+
+TEST(DecoderApi, DecodeMatchesMwpmDecoding) {
+    auto decoder = repetition_code_decoder();
+    ASSERT_EQ(decoder.num_detectors(), 20);
+    ASSERT_EQ(decoder.num_observables(), 2);
+    auto expected_graph = pm::repetition_code_graph(20, 2);
+    auto& expected_mwpm = expected_graph.get_mwpm();
+    double normalising_constant = expected_mwpm.flooder.graph.normalising_constant;
+
+    auto state = decoder.create_state();
+    state.reserve(20);
+    std::mt19937 rng(1);
+    std::vector<uint8_t> predictions(2);
+    for (size_t shot = 0; shot < 100; shot++) {
+        std::vector<uint64_t> detection_events;
+        for (uint64_t i = 0; i < 20; i++) {
+            if (rng() % 5 == 0)
+                detection_events.push_back(i);
+        }
+        double weight = state.decode(detection_events, predictions);
+        pm::ExtendedMatchingResult expected(2);
+        pm::decode_detection_events(expected_mwpm, detection_events, expected.obs_crossed.data(), expected.weight);
+        ASSERT_EQ(predictions, expected.obs_crossed);
+        ASSERT_EQ(weight, (double)expected.weight / normalising_constant);
+    }
+
+    std::vector<uint8_t> too_small(1);
+    ASSERT_THROW(state.decode(std::vector<uint64_t>{0}, too_small), std::invalid_argument);
+}
+
+TEST(DecoderApi, DecodeBatchIsIndependentOfThreads) {
+    auto decoder = repetition_code_decoder();
+    size_t num_shots = 300;
+    std::mt19937 rng(2);
+    std::vector<uint8_t> shots(num_shots * 20);
+    std::vector<uint8_t> packed_shots(num_shots * 3, 0);
+    for (size_t i = 0; i < shots.size(); i++) {
+        shots[i] = rng() % 6 == 0;
+        size_t shot = i / 20, k = i % 20;
+        packed_shots[shot * 3 + k / 8] |= shots[i] << (k % 8);
+    }
+
+    std::vector<uint8_t> expected_predictions(num_shots * 2);
+    std::vector<double> expected_weights(num_shots);
+    auto state = decoder.create_state();
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        std::vector<uint64_t> detection_events;
+        for (uint64_t k = 0; k < 20; k++) {
+            if (shots[shot * 20 + k])
+                detection_events.push_back(k);
+        }
+        expected_weights[shot] =
+            state.decode(detection_events, std::span<uint8_t>(expected_predictions).subspan(shot * 2, 2));
+    }
+
+    for (size_t num_threads : {1, 4}) {
+        for (bool bit_packed_shots : {false, true}) {
+            std::vector<uint8_t> predictions(num_shots * 2);
+            std::vector<double> weights(num_shots);
+            decoder.decode_batch(
+                bit_packed_shots ? packed_shots : shots, num_shots, predictions, weights, num_threads, bit_packed_shots);
+            ASSERT_EQ(predictions, expected_predictions);
+            ASSERT_EQ(weights, expected_weights);
+        }
+    }
+
+    std::vector<uint8_t> predictions(num_shots * 2);
+    decoder.decode_batch(shots, num_shots, predictions, {}, 2);
+    ASSERT_EQ(predictions, expected_predictions);
+    ASSERT_THROW(decoder.decode_batch(shots, num_shots + 1, predictions, {}), std::invalid_argument);
+}
+
+TEST(DecoderApi, FromDetectorErrorModel) {
+    auto decoder = pm::Decoder::from_detector_error_model(R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1
+        error(0.1) D1 D2
+        error(0.1) D2
+    )DEM");
+    ASSERT_EQ(decoder.num_detectors(), 3);
+    ASSERT_EQ(decoder.num_observables(), 1);
+    auto state = decoder.create_state();
+    std::vector<uint8_t> predictions(1);
+    state.decode(std::vector<uint64_t>{0}, predictions);
+    ASSERT_EQ(predictions, std::vector<uint8_t>{1});
+    state.decode(std::vector<uint64_t>{1}, predictions);
+    ASSERT_EQ(predictions, std::vector<uint8_t>{1});
+    state.decode(std::vector<uint64_t>{2}, predictions);
+    ASSERT_EQ(predictions, std::vector<uint8_t>{0});
+    ASSERT_THROW(pm::Decoder::from_detector_error_model_file("/nonexistent/file.dem"), std::invalid_argument);
+}
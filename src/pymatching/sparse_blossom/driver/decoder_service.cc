@@ -0,0 +1,216 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/decoder_service.h"
+
+#include <algorithm>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "pymatching/sparse_blossom/driver/numa_nodes.h"
+
+pm::DecoderService::DecoderService(
+    UserGraph& graph, size_t num_workers, const std::vector<size_t>& worker_cpus, const MemoryPlacement& placement)
+    : _num_observables(graph.get_num_observables()), stopping(false) {
+    if (num_workers == 0)
+        throw std::invalid_argument("A decoder service needs at least one worker.");
+    graph.freeze();
+    std::vector<std::vector<size_t>> worker_node_cpus(num_workers);
+    acquire_mwpms(graph, num_workers, worker_cpus, placement, worker_node_cpus);
+
+    workers.reserve(num_workers);
+    for (size_t w = 0; w < num_workers; w++) {
+        workers.emplace_back(&DecoderService::run_worker, this, std::ref(*mwpms[w]));
+        if (!worker_cpus.empty()) {
+            size_t cpu = worker_cpus[w % worker_cpus.size()];
+            if (!pin_thread_to_cpus(workers.back(), {cpu})) {
+                shutdown();
+                throw std::invalid_argument(
+                    "Failed to pin a decoder service worker to CPU " + std::to_string(cpu) + ".");
+            }
+        } else if (!worker_node_cpus[w].empty()) {
+            // Keeping a worker on its NUMA node is only an optimization, so a failure to do so is ignored.
+            pin_thread_to_cpus(workers.back(), worker_node_cpus[w]);
+        }
+    }
+}
+
+void pm::DecoderService::acquire_mwpms(
+    UserGraph& graph,
+    size_t num_workers,
+    const std::vector<size_t>& worker_cpus,
+    const MemoryPlacement& placement,
+    std::vector<std::vector<size_t>>& worker_node_cpus) {
+    std::vector<std::vector<size_t>> node_cpus;
+    if (placement.replicate_per_numa_node) {
+        node_cpus = numa_node_cpus();
+        if (node_cpus.size() < 2)
+            node_cpus.clear();
+    }
+    mwpms.reserve(num_workers);
+    if (node_cpus.empty() && placement.huge_pages == HugePagePolicy::NONE) {
+        for (size_t w = 0; w < num_workers; w++)
+            mwpms.push_back(graph.acquire_mwpm());
+        return;
+    }
+
+    // The workers are split into groups, one per NUMA node (or a single group without NUMA replication), each of which
+    // shares a copy of the topology.
+    size_t num_groups = std::max(node_cpus.size(), (size_t)1);
+    std::vector<size_t> group_of_worker(num_workers, 0);
+    std::vector<size_t> group_sizes(num_groups, 0);
+    for (size_t w = 0; w < num_workers; w++) {
+        if (!node_cpus.empty()) {
+            group_of_worker[w] = w % num_groups;
+            if (!worker_cpus.empty()) {
+                size_t cpu = worker_cpus[w % worker_cpus.size()];
+                for (size_t g = 0; g < num_groups; g++) {
+                    if (std::binary_search(node_cpus[g].begin(), node_cpus[g].end(), cpu))
+                        group_of_worker[w] = g;
+                }
+            }
+            worker_node_cpus[w] = node_cpus[group_of_worker[w]];
+        }
+        group_sizes[group_of_worker[w]]++;
+    }
+
+    std::vector<std::vector<MwpmLease>> group_mwpms(num_groups);
+    std::vector<std::exception_ptr> group_errors(num_groups);
+    auto build_group = [&](size_t g) {
+        try {
+            if (!node_cpus.empty())
+                pin_current_thread_to_cpus(node_cpus[g]);
+            if (group_sizes[g] == 0)
+                return;
+            auto topology = graph.copy_frozen_topology(placement.huge_pages);
+            for (size_t k = 0; k < group_sizes[g]; k++) {
+                group_mwpms[g].push_back(graph.acquire_mwpm_on_topology(topology));
+                if (placement.huge_pages != HugePagePolicy::NONE) {
+                    auto& mwpm = *group_mwpms[g].back();
+                    advise_huge_pages(
+                        mwpm.flooder.graph.nodes.data(), mwpm.flooder.graph.nodes.size() * sizeof(DetectorNode));
+                    advise_huge_pages(
+                        mwpm.search_flooder.graph.nodes.data(),
+                        mwpm.search_flooder.graph.nodes.size() * sizeof(SearchDetectorNode));
+                }
+            }
+        } catch (...) {
+            group_errors[g] = std::current_exception();
+        }
+    };
+    if (node_cpus.empty()) {
+        build_group(0);
+    } else {
+        std::vector<std::thread> builders;
+        for (size_t g = 0; g < num_groups; g++)
+            builders.emplace_back(build_group, g);
+        for (auto& builder : builders)
+            builder.join();
+    }
+    for (auto& error : group_errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    std::vector<size_t> num_taken(num_groups, 0);
+    for (size_t w = 0; w < num_workers; w++) {
+        size_t g = group_of_worker[w];
+        mwpms.push_back(std::move(group_mwpms[g][num_taken[g]++]));
+    }
+}
+
+pm::DecoderService::~DecoderService() {
+    shutdown();
+}
+
+std::future<pm::ExtendedMatchingResult> pm::DecoderService::submit(std::vector<uint64_t> detection_events) {
+    auto promise = std::make_shared<std::promise<ExtendedMatchingResult>>();
+    auto future = promise->get_future();
+    submit(std::move(detection_events), [promise](ExtendedMatchingResult result, std::exception_ptr error) {
+        if (error) {
+            promise->set_exception(error);
+        } else {
+            promise->set_value(std::move(result));
+        }
+    });
+    return future;
+}
+
+void pm::DecoderService::submit(std::vector<uint64_t> detection_events, DecodeCallback callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping)
+            throw std::invalid_argument("Can't submit a shot to a decoder service that has been shut down.");
+        queue.push_back({std::move(detection_events), std::move(callback)});
+    }
+    queue_changed.notify_one();
+}
+
+void pm::DecoderService::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queue_changed.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+size_t pm::DecoderService::num_workers() const {
+    return mwpms.size();
+}
+
+size_t pm::DecoderService::num_observables() const {
+    return _num_observables;
+}
+
+double pm::DecoderService::normalising_constant() const {
+    return mwpms[0]->flooder.graph.normalising_constant;
+}
+
+size_t pm::DecoderService::num_queued() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+}
+
+void pm::DecoderService::run_worker(Mwpm& mwpm) {
+    while (true) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queue_changed.wait(lock, [&] {
+                return stopping || !queue.empty();
+            });
+            // Once stopping, the workers keep going until the queue is empty.
+            if (queue.empty())
+                return;
+            request = std::move(queue.front());
+            queue.pop_front();
+        }
+        pm::ExtendedMatchingResult result(_num_observables);
+        std::exception_ptr error;
+        try {
+            pm::decode_detection_events(mwpm, request.detection_events, result.obs_crossed.data(), result.weight);
+        } catch (...) {
+            error = std::current_exception();
+            result = pm::ExtendedMatchingResult(0);
+        }
+        try {
+            request.callback(std::move(result), error);
+        } catch (...) {
+        }
+    }
+}
@@ -0,0 +1,118 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_DECODER_SERVICE_H
+#define PYMATCHING2_DECODER_SERVICE_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+#include "pymatching/sparse_blossom/page_allocator.h"
+
+namespace pm {
+
+/// Called by a worker of a `DecoderService' with the result of decoding a shot, or, if decoding it threw, with an
+/// empty result and the exception.
+typedef std::function<void(ExtendedMatchingResult result, std::exception_ptr error)> DecodeCallback;
+
+/// Where a `DecoderService' places the topology of the matching graph, and the decoder state of its workers, in
+/// memory. By default the workers share the topology of the frozen graph, wherever it was allocated.
+struct MemoryPlacement {
+    /// How the edge arrays of the workers' copy of the topology are backed. Unless it is NONE, the workers read a
+    /// copy of the topology allocated with this policy, and the node arrays of their decoder state are also advised
+    /// to use transparent huge pages.
+    HugePagePolicy huge_pages = HugePagePolicy::NONE;
+    /// Whether to give each NUMA node its own read-only copy of the topology. Each worker is assigned to the NUMA node
+    /// of its CPU in `worker_cpus' (or, without `worker_cpus', to the nodes in turn, and pinned to the CPUs of its
+    /// node), and reads the copy of its node. Each copy is built, along with the decoder state of the node's workers,
+    /// on a thread pinned to the node, so that it is allocated in the node's local memory. Has no effect on machines
+    /// with a single NUMA node, or whose NUMA nodes can't be determined.
+    bool replicate_per_numa_node = false;
+};
+
+/// Decodes shots submitted from any number of threads asynchronously, using a pool of worker threads.
+///
+/// Each worker decodes with its own Mwpm, leased from the (frozen) graph, so the workers share the topology of the
+/// matching graph instead of each copying it. Shots start decoding in the order in which they were submitted, but
+/// with several workers they may finish out of order.
+class DecoderService {
+   public:
+    /// Freezes `graph' (see `UserGraph::freeze') and starts `num_workers' worker threads. If `worker_cpus' is not
+    /// empty, worker i is pinned to the CPU `worker_cpus[i % worker_cpus.size()]'. Pinning is only supported on
+    /// Linux, and throws std::invalid_argument elsewhere, or if a worker can't be pinned. `placement' chooses how the
+    /// topology and the decoder state are allocated.
+    DecoderService(
+        UserGraph& graph,
+        size_t num_workers,
+        const std::vector<size_t>& worker_cpus = {},
+        const MemoryPlacement& placement = {});
+    DecoderService(const DecoderService&) = delete;
+    DecoderService& operator=(const DecoderService&) = delete;
+    /// Calls `shutdown()'.
+    ~DecoderService();
+
+    /// Queues `detection_events' to be decoded by the next free worker, returning a future for the result.
+    std::future<ExtendedMatchingResult> submit(std::vector<uint64_t> detection_events);
+    /// Queues `detection_events' to be decoded by the next free worker, which then calls `callback' with the result.
+    /// Exceptions thrown by `callback' are ignored.
+    void submit(std::vector<uint64_t> detection_events, DecodeCallback callback);
+    /// Waits for the shots that have already been submitted to be decoded, and stops the workers. Submitting a shot
+    /// afterwards throws std::invalid_argument. Calling it again has no effect.
+    void shutdown();
+
+    size_t num_workers() const;
+    size_t num_observables() const;
+    /// The normalising constant of the matching graph, by which the weights of the results must be divided to get the
+    /// weights of the solutions in the units of the edge weights of the graph.
+    double normalising_constant() const;
+    /// The number of submitted shots that no worker has started decoding yet.
+    size_t num_queued();
+
+   private:
+    struct Request {
+        std::vector<uint64_t> detection_events;
+        DecodeCallback callback;
+    };
+
+    size_t _num_observables;
+    std::vector<MwpmLease> mwpms;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable queue_changed;
+    std::deque<Request> queue;
+    bool stopping;
+
+    void run_worker(Mwpm& mwpm);
+    /// Fills `mwpms' with a Mwpm for each worker, reading the topology of `graph' or copies of it placed as chosen by
+    /// `placement', and sets `worker_node_cpus[w]' to the CPUs of the NUMA node of worker w, or to no CPUs if it has
+    /// no node.
+    void acquire_mwpms(
+        UserGraph& graph,
+        size_t num_workers,
+        const std::vector<size_t>& worker_cpus,
+        const MemoryPlacement& placement,
+        std::vector<std::vector<size_t>>& worker_node_cpus);
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_DECODER_SERVICE_H
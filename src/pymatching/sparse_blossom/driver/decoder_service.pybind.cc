@@ -0,0 +1,150 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/decoder_service.pybind.h"
+
+#include <memory>
+#include <string>
+
+#include "pymatching/sparse_blossom/driver/decoder_service.h"
+#include "pymatching/sparse_blossom/driver/user_graph.pybind.h"
+
+using namespace py::literals;
+
+namespace {
+
+/// Owns a `pm::DecoderService'. Its workers acquire the GIL to complete the Python futures, so the GIL is released
+/// while the service is shut down.
+struct PyDecoderService {
+    std::unique_ptr<pm::DecoderService> service;
+
+    PyDecoderService(
+        pm::UserGraph &graph,
+        size_t num_workers,
+        const std::vector<size_t> &worker_cpus,
+        const std::string &huge_pages,
+        bool replicate_per_numa_node) {
+        pm::MemoryPlacement placement;
+        placement.huge_pages = pm::huge_page_policy_from_name(huge_pages);
+        placement.replicate_per_numa_node = replicate_per_numa_node;
+        service = std::make_unique<pm::DecoderService>(graph, num_workers, worker_cpus, placement);
+    }
+    ~PyDecoderService() {
+        close();
+    }
+    void close() {
+        // Other Python threads can run while the GIL is released, and must see that the service is closed.
+        auto closing_service = std::move(service);
+        if (closing_service) {
+            py::gil_scoped_release release;
+            closing_service.reset();
+        }
+    }
+};
+
+/// Completes `future' (a `concurrent.futures.Future') with the result of a shot, or with the exception thrown while
+/// decoding it. Must be called with the GIL held.
+void complete_future(
+    py::object &future,
+    pm::ExtendedMatchingResult &result,
+    std::exception_ptr error,
+    bool return_weight,
+    double normalising_constant) {
+    // Like the executors of `concurrent.futures', skip futures that were cancelled while they were queued.
+    if (!future.attr("set_running_or_notify_cancel")().cast<bool>())
+        return;
+    if (error) {
+        py::object exception;
+        try {
+            std::rethrow_exception(error);
+        } catch (const std::invalid_argument &e) {
+            exception = py::module_::import("builtins").attr("ValueError")(e.what());
+        } catch (const std::exception &e) {
+            exception = py::module_::import("builtins").attr("RuntimeError")(e.what());
+        } catch (...) {
+            exception = py::module_::import("builtins").attr("RuntimeError")("Unknown error while decoding.");
+        }
+        future.attr("set_exception")(exception);
+        return;
+    }
+    auto obs_crossed = new std::vector<uint8_t>(std::move(result.obs_crossed));
+    py::object correction = pm_pybind::vec_to_array<uint8_t>(obs_crossed);
+    if (return_weight) {
+        future.attr("set_result")(py::make_tuple(correction, (double)result.weight / normalising_constant));
+    } else {
+        future.attr("set_result")(correction);
+    }
+}
+
+}  // namespace
+
+void pm_pybind::pybind_decoder_service(py::module &m) {
+    py::class_<PyDecoderService>(m, "DecoderService")
+        .def(
+            py::init<pm::UserGraph &, size_t, const std::vector<size_t> &, const std::string &, bool>(),
+            "graph"_a,
+            "num_workers"_a,
+            "worker_cpus"_a = std::vector<size_t>{},
+            "huge_pages"_a = "none",
+            "replicate_per_numa_node"_a = false)
+        .def(
+            "submit",
+            [](PyDecoderService &self,
+               const pm_pybind::contiguous_array<uint64_t> &detection_events,
+               bool return_weight) {
+                if (!self.service)
+                    throw std::invalid_argument("The decoder service has been closed.");
+                std::vector<uint64_t> detection_events_vec(
+                    detection_events.data(), detection_events.data() + detection_events.size());
+                double normalising_constant = self.service->normalising_constant();
+                py::object future = py::module_::import("concurrent.futures").attr("Future")();
+                // The callback runs on a worker thread, so it holds the future through a pointer, which it deletes
+                // with the GIL held. It is called exactly once for each submitted shot.
+                auto future_ptr = new py::object(future);
+                try {
+                    self.service->submit(
+                        std::move(detection_events_vec),
+                        [future_ptr, return_weight, normalising_constant](
+                            pm::ExtendedMatchingResult result, std::exception_ptr error) {
+                            py::gil_scoped_acquire acquire;
+                            std::unique_ptr<py::object> owned_future(future_ptr);
+                            try {
+                                complete_future(*owned_future, result, error, return_weight, normalising_constant);
+                            } catch (py::error_already_set &e) {
+                                e.discard_as_unraisable("DecoderService callback");
+                            }
+                        });
+                } catch (...) {
+                    delete future_ptr;
+                    throw;
+                }
+                return future;
+            },
+            "detection_events"_a,
+            "return_weight"_a = false)
+        .def("close", &PyDecoderService::close)
+        .def_property_readonly(
+            "closed",
+            [](const PyDecoderService &self) {
+                return self.service == nullptr;
+            })
+        .def_property_readonly(
+            "num_workers",
+            [](const PyDecoderService &self) {
+                return self.service ? self.service->num_workers() : 0;
+            })
+        .def_property_readonly("num_queued", [](PyDecoderService &self) {
+            return self.service ? self.service->num_queued() : 0;
+        });
+}
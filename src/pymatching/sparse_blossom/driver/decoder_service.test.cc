@@ -0,0 +1,103 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/decoder_service.h"
+
+#include <atomic>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "stim.h"
+
+// Defined in mwpm_decoding.test.cc
+std::string find_test_data_file(const char* name);
+
+TEST(DecoderService, MatchesSerialDecoding) {
+    auto dem_file = std::fopen(find_test_data_file("surface_code_rotated_memory_x_13_0.01.dem").c_str(), "r");
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+
+    std::vector<stim::SparseShot> shots;
+    auto shots_in = std::fopen(find_test_data_file("surface_code_rotated_memory_x_13_0.01_1000_shots.b8").c_str(), "r");
+    auto reader = stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(
+        shots_in, stim::SampleFormat::SAMPLE_FORMAT_B8, 0, dem.count_detectors(), dem.count_observables());
+    stim::SparseShot sparse_shot;
+    while (reader->start_and_read_entire_record(sparse_shot)) {
+        shots.push_back(sparse_shot);
+        sparse_shot.clear();
+    }
+    fclose(shots_in);
+
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS);
+    std::vector<pm::ExtendedMatchingResult> expected;
+    for (auto& shot : shots) {
+        pm::ExtendedMatchingResult res(mwpm.flooder.graph.num_observables);
+        pm::decode_detection_events(mwpm, shot.hits, res.obs_crossed.data(), res.weight);
+        expected.push_back(res);
+    }
+
+    // The placement of the topology and decoder state in memory doesn't change the results.
+    std::vector<pm::MemoryPlacement> placements(3);
+    placements[1].huge_pages = pm::HugePagePolicy::TRANSPARENT;
+    placements[2].huge_pages = pm::HugePagePolicy::EXPLICIT;
+    placements[2].replicate_per_numa_node = true;
+    for (size_t num_workers : {1, 3}) {
+        for (auto& placement : placements) {
+            auto graph = pm::detector_error_model_to_user_graph(dem);
+            pm::DecoderService service(graph, num_workers, {}, placement);
+            ASSERT_TRUE(graph.is_frozen());
+            ASSERT_EQ(service.num_workers(), num_workers);
+            ASSERT_EQ(service.num_observables(), dem.count_observables());
+
+            std::vector<std::future<pm::ExtendedMatchingResult>> futures;
+            for (auto& shot : shots)
+                futures.push_back(service.submit(shot.hits));
+            for (size_t k = 0; k < shots.size(); k++)
+                ASSERT_EQ(futures[k].get(), expected[k]);
+
+            std::atomic<size_t> num_correct{0};
+            for (size_t k = 0; k < shots.size(); k++) {
+                service.submit(shots[k].hits, [&, k](pm::ExtendedMatchingResult result, std::exception_ptr error) {
+                    if (!error && result == expected[k])
+                        num_correct++;
+                });
+            }
+            // Shutting down waits for the shots already submitted.
+            service.shutdown();
+            ASSERT_EQ(num_correct, shots.size());
+            ASSERT_EQ(service.num_queued(), 0);
+            ASSERT_THROW(service.submit(shots[0].hits), std::invalid_argument);
+        }
+    }
+}
+
+TEST(DecoderService, ReportsDecodingErrors) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 1.5, -1);
+    graph.add_or_merge_edge(0, 1, {1}, 1.0, -1);
+    pm::DecoderService service(graph, 2);
+    auto bad_future = service.submit({0, 5});
+    auto good_future = service.submit({0, 1});
+    ASSERT_THROW(bad_future.get(), std::invalid_argument);
+    ASSERT_EQ(good_future.get().obs_crossed, std::vector<uint8_t>({0, 1}));
+
+    // A callback that throws doesn't stop the worker.
+    service.submit({0}, [](pm::ExtendedMatchingResult, std::exception_ptr) {
+        throw std::runtime_error("ignored");
+    });
+    ASSERT_EQ(service.submit({0}).get().obs_crossed, std::vector<uint8_t>({1, 0}));
+
+    ASSERT_THROW(pm::DecoderService(graph, 0), std::invalid_argument);
+}
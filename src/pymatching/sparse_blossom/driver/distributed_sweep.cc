@@ -0,0 +1,546 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/distributed_sweep.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "pymatching/sparse_blossom/driver/sample_and_decode.h"
+#include "stim.h"
+
+#if !defined(_WIN32)
+#include <cerrno>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/// Mixes the seed of a sweep with the id of a task, so that every task samples different shots.
+uint64_t task_seed(uint64_t seed, size_t task_id) {
+    // The finalizer of splitmix64.
+    uint64_t z = seed + (uint64_t)(task_id + 1) * UINT64_C(0x9E3779B97F4A7C15);
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+}  // namespace
+
+pm::SweepScheduler::SweepScheduler(std::vector<StoppingRule> stopping_rules, size_t shots_per_task, uint64_t seed)
+    : stopping_rules(std::move(stopping_rules)),
+      point_results(this->stopping_rules.size()),
+      num_shots_in_progress(this->stopping_rules.size(), 0),
+      shots_per_task(shots_per_task),
+      seed(seed),
+      next_task_id(0),
+      next_point(0) {
+    if (shots_per_task == 0)
+        throw std::invalid_argument("The number of shots per task must be at least 1.");
+    for (const auto& rule : this->stopping_rules) {
+        if (rule.max_shots == SIZE_MAX && rule.max_errors == SIZE_MAX && rule.max_relative_error <= 0)
+            throw std::invalid_argument("The stopping rule of every point must limit the number of shots or errors.");
+    }
+}
+
+bool pm::SweepScheduler::is_finished(size_t point) const {
+    const auto& result = point_results[point];
+    return stopping_rules[point].is_satisfied(result.num_shots, result.num_errors);
+}
+
+bool pm::SweepScheduler::next_task(SweepTask& task) {
+    size_t num_points = stopping_rules.size();
+    for (size_t i = 0; i < num_points; i++) {
+        size_t point = (next_point + i) % num_points;
+        if (is_finished(point))
+            continue;
+        size_t num_started = point_results[point].num_shots + num_shots_in_progress[point];
+        size_t max_shots = stopping_rules[point].max_shots;
+        if (num_started >= max_shots)
+            continue;
+        task.task_id = next_task_id++;
+        task.point = point;
+        task.num_shots = std::min(shots_per_task, max_shots - num_started);
+        task.seed = task_seed(seed, task.task_id);
+        num_shots_in_progress[point] += task.num_shots;
+        next_point = point + 1;
+        return true;
+    }
+    return false;
+}
+
+void pm::SweepScheduler::complete(
+    const SweepTask& task, size_t num_shots, size_t num_errors, const DecodeLatencyHistograms* latencies) {
+    num_shots_in_progress[task.point] -= task.num_shots;
+    auto& result = point_results[task.point];
+    result.num_shots += num_shots;
+    result.num_errors += num_errors;
+    if (latencies != nullptr)
+        result.latencies += *latencies;
+}
+
+void pm::SweepScheduler::abandon(const SweepTask& task) {
+    num_shots_in_progress[task.point] -= task.num_shots;
+}
+
+bool pm::SweepScheduler::is_done() const {
+    for (size_t point = 0; point < stopping_rules.size(); point++) {
+        if (num_shots_in_progress[point] > 0 || !is_finished(point))
+            return false;
+    }
+    return true;
+}
+
+const std::vector<pm::SweepPointResult>& pm::SweepScheduler::results() const {
+    return point_results;
+}
+
+void pm::write_latency_histograms(std::ostream& out, const DecodeLatencyHistograms& latencies) {
+    // For each phase: the number of values, the minimum, maximum and sum, and the non-empty buckets as pairs of an
+    // index and a count, preceded by their number.
+    auto precision = out.precision(17);
+    bool first = true;
+    for (const auto* h : latencies.histograms()) {
+        if (!first)
+            out << ' ';
+        first = false;
+        size_t num_buckets = 0;
+        for (uint64_t count : h->counts)
+            num_buckets += count != 0;
+        out << h->num_values << ' ' << h->min_value << ' ' << h->max_value << ' ' << h->sum << ' ' << num_buckets;
+        for (size_t k = 0; k < LatencyHistogram::NUM_BUCKETS; k++) {
+            if (h->counts[k] != 0)
+                out << ' ' << k << ' ' << h->counts[k];
+        }
+    }
+    out.precision(precision);
+}
+
+pm::DecodeLatencyHistograms pm::read_latency_histograms(std::istream& in) {
+    DecodeLatencyHistograms latencies;
+    for (auto* h :
+         {&latencies.total, &latencies.syndrome_extraction, &latencies.flooding, &latencies.result_extraction}) {
+        size_t num_buckets;
+        in >> h->num_values >> h->min_value >> h->max_value >> h->sum >> num_buckets;
+        if (!in || num_buckets > LatencyHistogram::NUM_BUCKETS)
+            throw std::invalid_argument("Malformed latency histograms.");
+        for (size_t i = 0; i < num_buckets; i++) {
+            size_t k;
+            uint64_t count;
+            in >> k >> count;
+            if (!in || k >= LatencyHistogram::NUM_BUCKETS)
+                throw std::invalid_argument("Malformed latency histograms.");
+            h->counts[k] = count;
+        }
+    }
+    return latencies;
+}
+
+#if !defined(_WIN32)
+
+// The coordinator and the workers exchange lines of text:
+//
+//   worker -> coordinator: `READY [<token>]' when it connects, then
+//       `RESULT <task id> <shots> <errors> [<latency histograms>]' when it has finished a task, or `ERROR <message>'
+//       if it failed to.
+//   coordinator -> worker: `TASK <task id> <point> <shots> <seed> <batch size> <record latencies> <circuit bytes>',
+//       followed by the text of the circuit of the point (unless it is 0 bytes long, because the worker was already
+//       sent it), or `DONE' once the sweep is done.
+
+namespace {
+
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+
+/// A TCP connection, read a line at a time.
+class Connection {
+   public:
+    explicit Connection(int fd) : fd(fd), start(0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#ifdef SO_NOSIGPIPE
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    }
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+    ~Connection() {
+        close(fd);
+    }
+
+    /// Reads the next line (without its newline), returning false if the connection was closed first.
+    bool read_line(std::string& line) {
+        while (true) {
+            size_t end = buffer.find('\n', start);
+            if (end != std::string::npos) {
+                line.assign(buffer, start, end - start);
+                start = end + 1;
+                return true;
+            }
+            if (!fill())
+                return false;
+        }
+    }
+
+    /// Reads the next `num_bytes' bytes, returning false if the connection was closed first.
+    bool read_bytes(size_t num_bytes, std::string& bytes) {
+        while (buffer.size() - start < num_bytes) {
+            if (!fill())
+                return false;
+        }
+        bytes.assign(buffer, start, num_bytes);
+        start += num_bytes;
+        return true;
+    }
+
+    /// Sends `message', returning false if the connection was closed.
+    bool write(const std::string& message) {
+        size_t sent = 0;
+        while (sent < message.size()) {
+            ssize_t n = send(fd, message.data() + sent, message.size() - sent, SEND_FLAGS);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            sent += (size_t)n;
+        }
+        return true;
+    }
+
+   private:
+    int fd;
+    std::string buffer;
+    size_t start;
+
+    bool fill() {
+        buffer.erase(0, start);
+        start = 0;
+        char chunk[1 << 16];
+        while (true) {
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            buffer.append(chunk, (size_t)n);
+            return true;
+        }
+    }
+};
+
+int connect_to(const std::string& host, uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+        throw std::invalid_argument("Failed to resolve '" + host + "'.");
+    int fd = -1;
+    for (addrinfo* a = addresses; a != nullptr && fd == -1; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd != -1 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd == -1)
+        throw std::invalid_argument("Failed to connect to " + host + ":" + std::to_string(port) + ".");
+    return fd;
+}
+
+}  // namespace
+
+pm::SweepCoordinator::SweepCoordinator(std::vector<SweepPoint> points, SweepOptions options)
+    : points(std::move(points)),
+      options(options),
+      scheduler(
+          [&]() {
+              std::vector<StoppingRule> rules;
+              for (const auto& point : this->points)
+                  rules.push_back(point.stopping_rule);
+              return rules;
+          }(),
+          options.shots_per_task,
+          options.seed),
+      listen_fd(-1),
+      stopping(false) {
+    if (options.batch_size == 0)
+        throw std::invalid_argument("The batch size must be at least 1.");
+    if (std::any_of(options.token.begin(), options.token.end(), [](char c) {
+            return std::isspace((unsigned char)c);
+        }))
+        throw std::invalid_argument("The token of a sweep can't contain whitespace.");
+}
+
+pm::SweepCoordinator::~SweepCoordinator() {
+    if (listen_fd != -1)
+        close(listen_fd);
+}
+
+uint16_t pm::SweepCoordinator::listen(uint16_t port, const std::string& bind_address) {
+    if (listen_fd != -1)
+        throw std::invalid_argument("The coordinator is already listening.");
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+    addrinfo* addresses;
+    if (getaddrinfo(bind_address.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+        throw std::invalid_argument("Failed to resolve '" + bind_address + "'.");
+    int fd = -1;
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    for (addrinfo* a = addresses; a != nullptr && fd == -1; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (fd == -1)
+            continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, a->ai_addr, a->ai_addrlen) != 0 || ::listen(fd, 128) != 0 ||
+            getsockname(fd, (sockaddr*)&address, &length) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (fd == -1)
+        throw std::invalid_argument("Failed to listen on " + bind_address + ":" + std::to_string(port) + ".");
+    listen_fd = fd;
+    if (address.ss_family == AF_INET6)
+        return ntohs(((sockaddr_in6*)&address)->sin6_port);
+    return ntohs(((sockaddr_in*)&address)->sin_port);
+}
+
+std::vector<pm::SweepPointResult> pm::SweepCoordinator::run() {
+    if (listen_fd == -1)
+        throw std::invalid_argument("The coordinator must listen before running the sweep.");
+    std::vector<std::thread> threads;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping || scheduler.is_done())
+                break;
+        }
+        pollfd listener{listen_fd, POLLIN, 0};
+        if (poll(&listener, 1, 100) <= 0)
+            continue;
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd == -1)
+            continue;
+        std::lock_guard<std::mutex> lock(mutex);
+        worker_fds.insert(fd);
+        threads.emplace_back(&SweepCoordinator::serve_worker, this, fd);
+    }
+    {
+        // Wakes the threads waiting for a task or for a message, so that they tell their workers the sweep is done.
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        for (int fd : worker_fds)
+            shutdown(fd, SHUT_RD);
+    }
+    scheduler_changed.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+    if (!error.empty())
+        throw std::invalid_argument(error);
+    return scheduler.results();
+}
+
+void pm::SweepCoordinator::serve_worker(int fd) {
+    Connection connection(fd);
+    std::vector<bool> sent_circuit(points.size(), false);
+    SweepTask task;
+    bool has_task = false;
+    bool is_ready = false;
+    std::string line;
+    // A worker that sends a malformed message is disconnected, and its task handed out again.
+    try {
+        while (connection.read_line(line)) {
+            std::istringstream message(line);
+            std::string kind;
+            message >> kind;
+            if (kind == "READY") {
+                std::string token;
+                message >> token;
+                if (is_ready || token != options.token)
+                    break;
+                is_ready = true;
+            } else if (!is_ready) {
+                break;
+            } else if (kind == "RESULT") {
+                size_t task_id, num_shots, num_errors;
+                message >> task_id >> num_shots >> num_errors;
+                if (!message || !has_task || task_id != task.task_id || num_shots > task.num_shots ||
+                    num_errors > num_shots)
+                    break;
+                DecodeLatencyHistograms latencies;
+                if (options.record_latencies)
+                    latencies = read_latency_histograms(message);
+                std::lock_guard<std::mutex> lock(mutex);
+                scheduler.complete(task, num_shots, num_errors, options.record_latencies ? &latencies : nullptr);
+                has_task = false;
+                scheduler_changed.notify_all();
+            } else if (kind == "ERROR") {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (error.empty()) {
+                    std::string what;
+                    std::getline(message >> std::ws, what);
+                    error = "A worker failed: " + what;
+                }
+                stopping = true;
+                scheduler_changed.notify_all();
+                break;
+            } else {
+                break;
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!stopping && !scheduler.is_done() && !(has_task = scheduler.next_task(task)))
+                    scheduler_changed.wait(lock);
+            }
+            if (!has_task)
+                break;
+            const std::string& circuit_text = points[task.point].circuit_text;
+            size_t circuit_bytes = sent_circuit[task.point] ? 0 : circuit_text.size();
+            std::ostringstream out;
+            out << "TASK " << task.task_id << ' ' << task.point << ' ' << task.num_shots << ' ' << task.seed << ' '
+                << options.batch_size << ' ' << (int)options.record_latencies << ' ' << circuit_bytes << '\n';
+            if (!connection.write(out.str()) || !connection.write(circuit_text.substr(0, circuit_bytes)))
+                break;
+            sent_circuit[task.point] = true;
+        }
+    } catch (const std::invalid_argument&) {
+    }
+
+    bool done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (has_task)
+            scheduler.abandon(task);
+        worker_fds.erase(fd);
+        done = stopping || scheduler.is_done();
+    }
+    scheduler_changed.notify_all();
+    if (done)
+        connection.write("DONE\n");
+}
+
+void pm::run_sweep_worker(const std::string& host, uint16_t port, size_t num_threads, const std::string& token) {
+    if (num_threads == 0)
+        throw std::invalid_argument("A worker needs at least one thread.");
+    Connection connection(connect_to(host, port));
+    if (!connection.write(token.empty() ? "READY\n" : "READY " + token + "\n"))
+        throw std::invalid_argument("The coordinator closed the connection.");
+
+    std::map<size_t, stim::Circuit> circuits;
+    // The decoders are kept for the point of the last task, since a worker is often given several tasks in a row for
+    // the same point when the others are finished.
+    std::vector<Mwpm> mwpms;
+    size_t mwpms_point = SIZE_MAX;
+    std::string line;
+    while (true) {
+        if (!connection.read_line(line))
+            throw std::invalid_argument("The coordinator closed the connection before the sweep was done.");
+        std::istringstream message(line);
+        std::string kind;
+        message >> kind;
+        if (kind == "DONE")
+            return;
+        SweepTask task;
+        size_t batch_size, circuit_bytes;
+        int record_latencies;
+        message >> task.task_id >> task.point >> task.num_shots >> task.seed >> batch_size >> record_latencies >>
+            circuit_bytes;
+        if (kind != "TASK" || !message)
+            throw std::invalid_argument("Unexpected message from the coordinator: " + line);
+        std::string circuit_text;
+        if (!connection.read_bytes(circuit_bytes, circuit_text))
+            throw std::invalid_argument("The coordinator closed the connection before the sweep was done.");
+
+        try {
+            if (circuit_bytes > 0)
+                circuits.insert_or_assign(task.point, stim::Circuit(circuit_text.c_str()));
+            auto circuit = circuits.find(task.point);
+            if (circuit == circuits.end())
+                throw std::invalid_argument("The coordinator didn't send the circuit of a task.");
+            if (mwpms_point != task.point) {
+                auto dem = stim::ErrorAnalyzer::circuit_to_detector_error_model(
+                    circuit->second, true, true, false, 0, false, false);
+                mwpms = pm::detector_error_model_to_mwpms(dem, pm::NUM_DISTINCT_WEIGHTS, num_threads);
+                mwpms_point = task.point;
+            }
+            StoppingRule stopping_rule;
+            stopping_rule.max_shots = task.num_shots;
+            DecodeLatencyHistograms latencies;
+            auto result = sample_and_count_mistakes(
+                circuit->second, mwpms, stopping_rule, batch_size, task.seed, record_latencies ? &latencies : nullptr);
+
+            std::ostringstream out;
+            out << "RESULT " << task.task_id << ' ' << result.num_shots << ' ' << result.num_errors;
+            if (record_latencies) {
+                out << ' ';
+                write_latency_histograms(out, latencies);
+            }
+            out << '\n';
+            if (!connection.write(out.str()))
+                throw std::invalid_argument("The coordinator closed the connection before the sweep was done.");
+        } catch (const std::exception& ex) {
+            std::string what = ex.what();
+            std::replace(what.begin(), what.end(), '\n', ' ');
+            connection.write("ERROR " + what + "\n");
+            throw;
+        }
+    }
+}
+
+#else
+
+pm::SweepCoordinator::SweepCoordinator(std::vector<SweepPoint> points, SweepOptions options)
+    : points(std::move(points)), options(options), scheduler({}, 1, 0), listen_fd(-1), stopping(false) {
+    throw std::invalid_argument("Distributed sweeps are not supported on this platform.");
+}
+
+pm::SweepCoordinator::~SweepCoordinator() {
+}
+
+uint16_t pm::SweepCoordinator::listen(uint16_t, const std::string&) {
+    throw std::invalid_argument("Distributed sweeps are not supported on this platform.");
+}
+
+std::vector<pm::SweepPointResult> pm::SweepCoordinator::run() {
+    throw std::invalid_argument("Distributed sweeps are not supported on this platform.");
+}
+
+void pm::SweepCoordinator::serve_worker(int) {
+}
+
+void pm::run_sweep_worker(const std::string&, uint16_t, size_t, const std::string&) {
+    throw std::invalid_argument("Distributed sweeps are not supported on this platform.");
+}
+
+#endif
@@ -0,0 +1,158 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_DISTRIBUTED_SWEEP_H
+#define PYMATCHING2_DISTRIBUTED_SWEEP_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
+#include "pymatching/sparse_blossom/driver/stopping_rule.h"
+
+namespace pm {
+
+/// A point of a sweep (e.g. a distance and a noise strength), whose shots are sampled from a circuit and decoded
+/// until its stopping rule is satisfied.
+struct SweepPoint {
+    std::string name;
+    /// The circuit, in the text format of stim.
+    std::string circuit_text;
+    /// At least one of its limits must be set.
+    StoppingRule stopping_rule;
+};
+
+struct SweepOptions {
+    /// The number of shots of a point given to a worker at a time. Smaller tasks balance the load better, and
+    /// overshoot the `max_errors' of a point by less, but each task is sent over the network and started separately.
+    size_t shots_per_task = 100000;
+    /// The batch size with which the workers sample and decode the shots of a task.
+    size_t batch_size = 256;
+    uint64_t seed = 0;
+    /// Whether the workers record the latency of decoding each shot.
+    bool record_latencies = false;
+    /// If not empty, a secret (without whitespace) that each worker must send when it connects (see
+    /// `run_sweep_worker'). Workers that send a different token are disconnected before they are given any task.
+    std::string token;
+};
+
+/// Shots of a point to be sampled and decoded by a worker, seeded with `seed'.
+struct SweepTask {
+    size_t task_id;
+    size_t point;
+    size_t num_shots;
+    uint64_t seed;
+};
+
+struct SweepPointResult {
+    size_t num_shots = 0;
+    size_t num_errors = 0;
+    /// Only recorded if `SweepOptions::record_latencies' is set.
+    DecodeLatencyHistograms latencies;
+};
+
+/// Shares out the shots of the points of a sweep as tasks, and adds up their results. Not thread-safe.
+///
+/// Each task handed out is for the next point (in turn) that isn't finished and whose `max_shots' haven't all been
+/// handed out yet, so every point makes progress, and a worker that finishes its task is given another, whichever
+/// point it is for. A point is finished once its stopping rule is satisfied by the results of its completed tasks,
+/// or once all its shots have been completed. Tasks that were already handed out are still counted, so slightly more
+/// shots and errors may be counted than the stopping rule needs. The shots of an abandoned task (e.g. whose worker
+/// disconnected) are handed out again, with a different seed.
+class SweepScheduler {
+   public:
+    SweepScheduler(std::vector<StoppingRule> stopping_rules, size_t shots_per_task, uint64_t seed);
+
+    /// Sets `task' to the next task, returning false if there is no task to hand out for now (either because the
+    /// sweep is done, or because the remaining shots are all in tasks that haven't completed yet).
+    bool next_task(SweepTask& task);
+    /// Adds the result of `task' to its point. `latencies' may be null.
+    void complete(const SweepTask& task, size_t num_shots, size_t num_errors, const DecodeLatencyHistograms* latencies);
+    /// Returns the shots of `task' to its point, to be handed out again.
+    void abandon(const SweepTask& task);
+    /// Whether every point is finished, and no tasks are in progress.
+    bool is_done() const;
+    const std::vector<SweepPointResult>& results() const;
+
+   private:
+    std::vector<StoppingRule> stopping_rules;
+    std::vector<SweepPointResult> point_results;
+    /// The number of shots of each point in tasks that have been handed out but not completed or abandoned.
+    std::vector<size_t> num_shots_in_progress;
+    size_t shots_per_task;
+    uint64_t seed;
+    size_t next_task_id;
+    size_t next_point;
+
+    bool is_finished(size_t point) const;
+};
+
+/// Writes `latencies' on one line, as text that can be read back exactly by `read_latency_histograms'.
+void write_latency_histograms(std::ostream& out, const DecodeLatencyHistograms& latencies);
+/// Reads histograms written by `write_latency_histograms', throwing std::invalid_argument if they are malformed.
+DecodeLatencyHistograms read_latency_histograms(std::istream& in);
+
+/// Runs a sweep, sharing out its shots between the workers (`run_sweep_worker') that connect to it over TCP, and
+/// adding up their results.
+///
+/// Workers may connect and disconnect at any time while the sweep is running; the shots of the task of a worker
+/// that disconnects are handed out again. Each worker is sent the circuit of a point along with its first task for
+/// the point. If a worker reports an error (e.g. because a circuit is invalid), the sweep is stopped, and `run'
+/// throws it. A worker that reports more shots than its task had, or more errors than shots, is disconnected and its
+/// task handed out again. The connections aren't encrypted, so the coordinator should only listen on a trusted
+/// network, with `SweepOptions::token' set when other hosts can reach it. Only supported on POSIX platforms.
+class SweepCoordinator {
+   public:
+    SweepCoordinator(std::vector<SweepPoint> points, SweepOptions options);
+    SweepCoordinator(const SweepCoordinator&) = delete;
+    SweepCoordinator& operator=(const SweepCoordinator&) = delete;
+    ~SweepCoordinator();
+
+    /// Listens for workers on `port' (or on a free port, if `port' is 0) of the interface with address
+    /// `bind_address', returning the port. By default, only workers on the same host can connect; "0.0.0.0" (or
+    /// "::") listens on every interface.
+    uint16_t listen(uint16_t port, const std::string& bind_address = "127.0.0.1");
+    /// Hands out the tasks of the sweep to the connected workers until it is done, returning the result of each point.
+    /// When it returns, every connected worker has been told that the sweep is done.
+    std::vector<SweepPointResult> run();
+
+   private:
+    std::vector<SweepPoint> points;
+    SweepOptions options;
+    SweepScheduler scheduler;
+    int listen_fd;
+    std::mutex mutex;
+    std::condition_variable scheduler_changed;
+    std::set<int> worker_fds;
+    bool stopping;
+    std::string error;
+
+    void serve_worker(int fd);
+};
+
+/// Connects to the `SweepCoordinator' listening on `port' of `host', and samples and decodes the shots of the tasks
+/// that it hands out, using `num_threads' threads, until it says the sweep is done. `token' must match the
+/// `SweepOptions::token' of the coordinator.
+void run_sweep_worker(
+    const std::string& host, uint16_t port, size_t num_threads = 1, const std::string& token = std::string());
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_DISTRIBUTED_SWEEP_H
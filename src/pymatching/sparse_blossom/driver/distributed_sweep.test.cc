@@ -0,0 +1,277 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/distributed_sweep.h"
+
+#include <future>
+#include <sstream>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "stim.h"
+
+namespace {
+
+pm::StoppingRule stopping_rule(size_t max_shots, size_t max_errors = SIZE_MAX) {
+    pm::StoppingRule rule;
+    rule.max_shots = max_shots;
+    rule.max_errors = max_errors;
+    return rule;
+}
+
+}  // namespace
+
+TEST(SweepScheduler, SharesOutEveryShotOfEachPointInTurn) {
+    pm::SweepScheduler scheduler({stopping_rule(250), stopping_rule(100)}, 100, 3);
+    std::vector<pm::SweepTask> tasks;
+    pm::SweepTask task;
+    while (scheduler.next_task(task))
+        tasks.push_back(task);
+    ASSERT_EQ(tasks.size(), 4);
+    std::vector<size_t> points, num_shots;
+    for (const auto& t : tasks) {
+        points.push_back(t.point);
+        num_shots.push_back(t.num_shots);
+    }
+    ASSERT_EQ(points, (std::vector<size_t>{0, 1, 0, 0}));
+    ASSERT_EQ(num_shots, (std::vector<size_t>{100, 100, 100, 50}));
+    ASSERT_NE(tasks[0].seed, tasks[2].seed);
+
+    // The shots of an abandoned task are handed out again, as a new task.
+    scheduler.abandon(tasks[2]);
+    ASSERT_TRUE(scheduler.next_task(task));
+    ASSERT_EQ(task.point, 0);
+    ASSERT_EQ(task.num_shots, 100);
+    ASSERT_EQ(task.task_id, 4);
+    ASSERT_FALSE(scheduler.next_task(task));
+
+    for (const auto& t : {tasks[0], tasks[1], tasks[3], task}) {
+        ASSERT_FALSE(scheduler.is_done());
+        scheduler.complete(t, t.num_shots, 1, nullptr);
+    }
+    ASSERT_TRUE(scheduler.is_done());
+    ASSERT_EQ(scheduler.results()[0].num_shots, 250);
+    ASSERT_EQ(scheduler.results()[0].num_errors, 3);
+    ASSERT_EQ(scheduler.results()[1].num_shots, 100);
+    ASSERT_EQ(scheduler.results()[1].num_errors, 1);
+}
+
+TEST(SweepScheduler, StopsHandingOutShotsOncePointIsFinished) {
+    pm::SweepScheduler scheduler({stopping_rule(SIZE_MAX, 5), stopping_rule(1000)}, 100, 0);
+    pm::SweepTask a, b, c;
+    ASSERT_TRUE(scheduler.next_task(a));
+    ASSERT_TRUE(scheduler.next_task(b));
+    ASSERT_TRUE(scheduler.next_task(c));
+    ASSERT_EQ(a.point, 0);
+    ASSERT_EQ(c.point, 0);
+    pm::DecodeLatencyHistograms latencies;
+    latencies.record(100, pm::DecodePhaseTimes{10, 80, 10});
+    scheduler.complete(a, 100, 7, &latencies);
+    scheduler.complete(b, 100, 0, &latencies);
+
+    // Point 0 has enough errors, so only point 1 is given more shots, but the task in progress is still counted.
+    pm::SweepTask task;
+    for (size_t k = 0; k < 9; k++) {
+        ASSERT_TRUE(scheduler.next_task(task));
+        ASSERT_EQ(task.point, 1);
+        scheduler.complete(task, task.num_shots, 0, nullptr);
+    }
+    ASSERT_FALSE(scheduler.next_task(task));
+    ASSERT_FALSE(scheduler.is_done());
+    scheduler.complete(c, 100, 2, nullptr);
+    ASSERT_TRUE(scheduler.is_done());
+    ASSERT_EQ(scheduler.results()[0].num_shots, 200);
+    ASSERT_EQ(scheduler.results()[0].num_errors, 9);
+    ASSERT_EQ(scheduler.results()[0].latencies.total.num_values, 1);
+    ASSERT_EQ(scheduler.results()[1].num_shots, 1000);
+    ASSERT_EQ(scheduler.results()[1].latencies.total.num_values, 1);
+
+    ASSERT_THROW(pm::SweepScheduler({pm::StoppingRule()}, 100, 0), std::invalid_argument);
+    ASSERT_THROW(pm::SweepScheduler({stopping_rule(10)}, 0, 0), std::invalid_argument);
+}
+
+TEST(DistributedSweep, LatencyHistogramsRoundTrip) {
+    pm::DecodeLatencyHistograms latencies;
+    for (uint64_t v = 1; v < 100000; v = v * 3 + 1)
+        latencies.record(v * 7, pm::DecodePhaseTimes{v, v * 5, v});
+    latencies.record(1, pm::DecodePhaseTimes{0, 1, 0});
+    std::stringstream ss;
+    pm::write_latency_histograms(ss, latencies);
+    ss << " trailing";
+    auto read = pm::read_latency_histograms(ss);
+    auto expected = latencies.histograms();
+    auto actual = read.histograms();
+    for (size_t p = 0; p < expected.size(); p++) {
+        ASSERT_EQ(actual[p]->counts, expected[p]->counts);
+        ASSERT_EQ(actual[p]->num_values, expected[p]->num_values);
+        ASSERT_EQ(actual[p]->min_value, expected[p]->min_value);
+        ASSERT_EQ(actual[p]->max_value, expected[p]->max_value);
+        ASSERT_EQ(actual[p]->sum, expected[p]->sum);
+    }
+    std::string rest;
+    ss >> rest;
+    ASSERT_EQ(rest, "trailing");
+
+    std::stringstream malformed("3 1 2 3.5 1 100000 3");
+    ASSERT_THROW(pm::read_latency_histograms(malformed), std::invalid_argument);
+}
+
+#if !defined(_WIN32)
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+std::string repetition_code_circuit(size_t distance, double p) {
+    stim::CircuitGenParameters gen(distance, distance, "memory");
+    gen.before_round_data_depolarization = p;
+    gen.before_measure_flip_probability = p;
+    return stim::generate_rep_code_circuit(gen).circuit.str();
+}
+
+/// Connects to a coordinator listening on the loopback interface, returning the socket.
+int connect_to_loopback(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(port);
+    if (fd == -1 || connect(fd, (sockaddr*)&address, sizeof(address)) != 0)
+        throw std::runtime_error("Failed to connect to the coordinator.");
+    return fd;
+}
+
+/// Reads everything sent on `fd' until the other end closes the connection.
+std::string read_until_closed(int fd) {
+    std::string received;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        received.append(buffer, (size_t)n);
+    return received;
+}
+
+}  // namespace
+
+TEST(DistributedSweep, WorkersShareTheShotsOfEveryPoint) {
+    std::vector<pm::SweepPoint> points;
+    points.push_back({"d3", repetition_code_circuit(3, 0.1), stopping_rule(3000)});
+    points.push_back({"d5", repetition_code_circuit(5, 0.1), stopping_rule(2000)});
+    points.push_back({"d5_max_errors", repetition_code_circuit(5, 0.2), stopping_rule(1000000, 10)});
+    pm::SweepOptions options;
+    options.shots_per_task = 500;
+    options.batch_size = 128;
+    options.seed = 5;
+    options.record_latencies = true;
+    pm::SweepCoordinator coordinator(points, options);
+    uint16_t port = coordinator.listen(0);
+
+    std::vector<std::thread> workers;
+    for (size_t num_threads : {1, 2})
+        workers.emplace_back(pm::run_sweep_worker, "localhost", port, num_threads, std::string());
+    auto results = coordinator.run();
+    for (auto& worker : workers)
+        worker.join();
+
+    ASSERT_EQ(results.size(), 3);
+    ASSERT_EQ(results[0].num_shots, 3000);
+    ASSERT_EQ(results[1].num_shots, 2000);
+    ASSERT_GT(results[0].num_errors, 0);
+    ASSERT_LT(results[1].num_errors, results[0].num_errors);
+    ASSERT_GE(results[2].num_errors, 10);
+    ASSERT_EQ(results[2].num_shots % 500, 0);
+    for (const auto& result : results)
+        ASSERT_EQ(result.latencies.total.num_values, result.num_shots);
+}
+
+TEST(DistributedSweep, WorkerErrorsStopTheSweep) {
+    std::vector<pm::SweepPoint> points;
+    points.push_back({"invalid", "NOT_A_GATE 0\n", stopping_rule(100)});
+    pm::SweepCoordinator coordinator(points, pm::SweepOptions());
+    uint16_t port = coordinator.listen(0);
+    bool worker_failed = false;
+    std::thread worker([&]() {
+        try {
+            pm::run_sweep_worker("localhost", port);
+        } catch (const std::exception&) {
+            worker_failed = true;
+        }
+    });
+    ASSERT_THROW(coordinator.run(), std::invalid_argument);
+    worker.join();
+    ASSERT_TRUE(worker_failed);
+}
+
+TEST(DistributedSweep, WorkersWithoutTheTokenAreDisconnected) {
+    std::vector<pm::SweepPoint> points;
+    points.push_back({"d3", repetition_code_circuit(3, 0.1), stopping_rule(1000)});
+    pm::SweepOptions options;
+    options.token = "secret";
+    pm::SweepCoordinator coordinator(points, options);
+    uint16_t port = coordinator.listen(0);
+    auto results = std::async(std::launch::async, &pm::SweepCoordinator::run, &coordinator);
+
+    for (std::string ready : {"READY\n", "READY wrong\n", "RESULT 0 1000 0\n"}) {
+        int fd = connect_to_loopback(port);
+        ASSERT_EQ(write(fd, ready.data(), ready.size()), (ssize_t)ready.size());
+        ASSERT_EQ(read_until_closed(fd), "");
+        close(fd);
+    }
+    ASSERT_THROW(pm::run_sweep_worker("localhost", port, 1, "wrong"), std::invalid_argument);
+
+    pm::run_sweep_worker("localhost", port, 1, "secret");
+    ASSERT_EQ(results.get()[0].num_shots, 1000);
+
+    options.token = "two words";
+    ASSERT_THROW(pm::SweepCoordinator(points, options), std::invalid_argument);
+}
+
+TEST(DistributedSweep, ImplausibleResultsAreDiscarded) {
+    std::vector<pm::SweepPoint> points;
+    points.push_back({"d3", repetition_code_circuit(3, 0.1), stopping_rule(1000)});
+    pm::SweepOptions options;
+    options.shots_per_task = 1000;
+    pm::SweepCoordinator coordinator(points, options);
+    uint16_t port = coordinator.listen(0);
+    auto results = std::async(std::launch::async, &pm::SweepCoordinator::run, &coordinator);
+
+    // Each of these workers is disconnected without its result being counted, so the task is handed out again.
+    for (std::string result : {"RESULT 0 1001 0\n", "RESULT 1 10 11\n"}) {
+        int fd = connect_to_loopback(port);
+        std::string ready = "READY\n";
+        ASSERT_EQ(write(fd, ready.data(), ready.size()), (ssize_t)ready.size());
+        char c = 0;
+        while (c != '\n')
+            ASSERT_EQ(read(fd, &c, 1), 1);
+        ASSERT_EQ(write(fd, result.data(), result.size()), (ssize_t)result.size());
+        read_until_closed(fd);
+        close(fd);
+    }
+
+    pm::run_sweep_worker("localhost", port);
+    auto result = results.get()[0];
+    ASSERT_EQ(result.num_shots, 1000);
+    ASSERT_LT(result.num_errors, 1000);
+}
+
+TEST(DistributedSweep, ListensOnTheBindAddress) {
+    pm::SweepCoordinator coordinator({{"d3", repetition_code_circuit(3, 0.1), stopping_rule(10)}}, pm::SweepOptions());
+    ASSERT_THROW(coordinator.listen(0, "not an address"), std::invalid_argument);
+    ASSERT_GT(coordinator.listen(0, "127.0.0.1"), 0);
+    ASSERT_THROW(coordinator.listen(0), std::invalid_argument);
+}
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/edge_correlations.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "pymatching/sparse_blossom/driver/io.h"
+#include "pymatching/sparse_blossom/memory_bytes.h"
+
+namespace {
+
+/// The probability that exactly one of two independent mechanisms with probabilities `a' and `b' occurs.
+double xor_probability(double a, double b) {
+    return a * (1 - b) + b * (1 - a);
+}
+
+std::pair<size_t, size_t> edge_key(size_t u, size_t v) {
+    return v != SIZE_MAX && v < u ? std::pair<size_t, size_t>{v, u} : std::pair<size_t, size_t>{u, v};
+}
+
+}  // namespace
+
+void pm::EdgeCorrelationTable::add_error(double p, const std::vector<std::pair<size_t, size_t>> &components) {
+    for (size_t i = 0; i < components.size(); i++) {
+        auto a = edge_key(components[i].first, components[i].second);
+        auto &entry = entries[a];
+        entry.marginal_probability = xor_probability(entry.marginal_probability, p);
+        for (size_t j = 0; j < components.size(); j++) {
+            auto b = edge_key(components[j].first, components[j].second);
+            if (b == a)
+                continue;
+            auto it = std::find_if(entry.partners.begin(), entry.partners.end(), [&](const Partner &partner) {
+                return partner.edge == b;
+            });
+            if (it == entry.partners.end()) {
+                entry.partners.push_back({b, p});
+                num_correlations++;
+            } else {
+                it->joint_probability = xor_probability(it->joint_probability, p);
+            }
+        }
+    }
+}
+
+double pm::EdgeCorrelationTable::marginal_probability(size_t u, size_t v) const {
+    auto it = entries.find(edge_key(u, v));
+    return it == entries.end() ? 0 : it->second.marginal_probability;
+}
+
+void pm::EdgeCorrelationTable::append_partner_weights(
+    const std::vector<int64_t> &matched_edges,
+    std::vector<std::pair<size_t, size_t>> &partner_edges,
+    std::vector<double> &partner_weights) const {
+    size_t first_partner = partner_edges.size();
+    for (size_t k = 0; k + 1 < matched_edges.size(); k += 2) {
+        size_t u = (size_t)matched_edges[k];
+        size_t v = matched_edges[k + 1] < 0 ? SIZE_MAX : (size_t)matched_edges[k + 1];
+        auto it = entries.find(edge_key(u, v));
+        if (it == entries.end() || it->second.marginal_probability <= 0)
+            continue;
+        for (const auto &partner : it->second.partners) {
+            double q = std::min(partner.joint_probability / it->second.marginal_probability, 0.5);
+            double weight = std::log((1 - q) / q);
+            // If several matched edges share a partner, the most likely explanation sets its weight.
+            auto existing = std::find(partner_edges.begin() + first_partner, partner_edges.end(), partner.edge);
+            if (existing == partner_edges.end()) {
+                partner_edges.push_back(partner.edge);
+                partner_weights.push_back(weight);
+            } else {
+                auto &w = partner_weights[existing - partner_edges.begin()];
+                w = std::min(w, weight);
+            }
+        }
+    }
+}
+
+bool pm::EdgeCorrelationTable::empty() const {
+    return num_correlations == 0;
+}
+
+size_t pm::EdgeCorrelationTable::memory_bytes() const {
+    size_t total = pm::memory_bytes(entries);
+    for (const auto &entry : entries)
+        total += pm::memory_bytes(entry.second.partners);
+    return total;
+}
+
+pm::EdgeCorrelationTable pm::detector_error_model_to_edge_correlation_table(
+    const stim::DetectorErrorModel &detector_error_model) {
+    pm::EdgeCorrelationTable table;
+    std::vector<std::pair<size_t, size_t>> components;
+    detector_error_model.iter_flatten_error_instructions([&](const stim::DemInstruction &instruction) {
+        double p = instruction.arg_data[0];
+        components.clear();
+        pm::iter_error_instruction_edges(
+            p, instruction.target_data, [&](double, const std::vector<size_t> &detectors, std::vector<size_t> &) {
+                if (detectors.size() == 1) {
+                    components.push_back({detectors[0], SIZE_MAX});
+                } else if (detectors.size() == 2) {
+                    components.push_back({detectors[0], detectors[1]});
+                }
+            });
+        if (!components.empty())
+            table.add_error(p, components);
+    });
+    return table;
+}
@@ -0,0 +1,85 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_EDGE_CORRELATIONS_H
+#define PYMATCHING2_EDGE_CORRELATIONS_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "stim.h"
+
+namespace pm {
+
+/// The correlations between the graphlike edges of a detector error model, which arise from error instructions
+/// that are decomposed (with `^') into more than one edge, such as a Y error decomposing into its X and Z parts.
+/// These are lost when the edges are merged into a matching graph, but can be used by a second round of matching:
+/// once an edge is known to be in the matching, the error it came from makes its partner edges much more likely.
+///
+/// An edge (u, v) is identified by (min(u, v), max(u, v)), with v equal to SIZE_MAX for a boundary edge.
+class EdgeCorrelationTable {
+   public:
+    /// Records an error instruction with probability `p' whose graphlike components are the edges `components'.
+    /// Every component contributes to the marginal probability of its edge, and every pair of distinct components
+    /// is recorded as correlated.
+    void add_error(double p, const std::vector<std::pair<size_t, size_t>> &components);
+
+    /// The probability that the edge (u, v) is flipped, combining all the error instructions containing it as
+    /// independent mechanisms, or 0 if no error instruction contains it.
+    double marginal_probability(size_t u, size_t v) const;
+
+    /// For every edge correlated with one of the edges in `matched_edges' (flattened pairs of nodes, with -1 for the
+    /// boundary, as produced by `decode_detection_events_to_edges'), appends it to `partner_edges' and appends to
+    /// `partner_weights' the weight log((1 - q) / q), where q is the largest probability of it being flipped given
+    /// that one of the matched edges is flipped. q is capped at 1/2, so that the weights are not negative.
+    void append_partner_weights(
+        const std::vector<int64_t> &matched_edges,
+        std::vector<std::pair<size_t, size_t>> &partner_edges,
+        std::vector<double> &partner_weights) const;
+
+    /// Whether any correlations were recorded.
+    bool empty() const;
+    /// The memory held by the table, in bytes.
+    size_t memory_bytes() const;
+
+   private:
+    struct EdgeKeyHash {
+        size_t operator()(const std::pair<size_t, size_t> &key) const {
+            return std::hash<size_t>{}(key.first * 0x9E3779B97F4A7C15ULL ^ key.second);
+        }
+    };
+    struct Partner {
+        std::pair<size_t, size_t> edge;
+        /// The probability that both edges are flipped by the same error instruction.
+        double joint_probability;
+    };
+    struct EdgeEntry {
+        double marginal_probability = 0;
+        std::vector<Partner> partners;
+    };
+    std::unordered_map<std::pair<size_t, size_t>, EdgeEntry, EdgeKeyHash> entries;
+    size_t num_correlations = 0;
+};
+
+/// Builds the correlation table of the error instructions of `detector_error_model' (see EdgeCorrelationTable).
+/// Components with no detectors or with more than two detectors are not edges of the matching graph, and are
+/// ignored.
+EdgeCorrelationTable detector_error_model_to_edge_correlation_table(
+    const stim::DetectorErrorModel &detector_error_model);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_EDGE_CORRELATIONS_H
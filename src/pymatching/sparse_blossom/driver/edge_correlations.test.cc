@@ -0,0 +1,72 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/edge_correlations.h"
+
+#include <cmath>
+#include <gtest/gtest.h>
+
+TEST(EdgeCorrelationTable, FromDetectorErrorModel) {
+    stim::DetectorErrorModel dem(R"DEM(
+        error(0.1) D0 D1 ^ D2 L0
+        error(0.05) D1 D0
+        error(0.2) D3
+        error(0.01) D0 D1 D4 ^ D3
+        error(0.02) D5 ^ D6
+        error(0.1) D5
+    )DEM");
+    auto table = pm::detector_error_model_to_edge_correlation_table(dem);
+    ASSERT_FALSE(table.empty());
+    ASSERT_DOUBLE_EQ(table.marginal_probability(1, 0), 0.1 * 0.95 + 0.05 * 0.9);
+    ASSERT_DOUBLE_EQ(table.marginal_probability(2, SIZE_MAX), 0.1);
+    // The component with three detectors is not an edge, so it is ignored.
+    ASSERT_DOUBLE_EQ(table.marginal_probability(3, SIZE_MAX), 0.2 * 0.99 + 0.01 * 0.8);
+    ASSERT_EQ(table.marginal_probability(0, 4), 0);
+
+    std::vector<std::pair<size_t, size_t>> edges;
+    std::vector<double> weights;
+    table.append_partner_weights({0, 1}, edges, weights);
+    ASSERT_EQ(edges, (std::vector<std::pair<size_t, size_t>>{{2, SIZE_MAX}}));
+    double q = 0.1 / (0.1 * 0.95 + 0.05 * 0.9);
+    ASSERT_EQ(weights.size(), 1);
+    // q exceeds 1/2, so the weight is capped at 0.
+    ASSERT_GT(q, 0.5);
+    ASSERT_DOUBLE_EQ(weights[0], 0);
+
+    edges.clear();
+    weights.clear();
+    table.append_partner_weights({2, -1}, edges, weights);
+    ASSERT_EQ(edges, (std::vector<std::pair<size_t, size_t>>{{0, 1}}));
+    ASSERT_DOUBLE_EQ(weights[0], 0);
+
+    edges.clear();
+    weights.clear();
+    table.append_partner_weights({5, -1}, edges, weights);
+    ASSERT_EQ(edges, (std::vector<std::pair<size_t, size_t>>{{6, SIZE_MAX}}));
+    q = 0.02 / (0.02 * 0.9 + 0.1 * 0.98);
+    ASSERT_DOUBLE_EQ(weights[0], std::log((1 - q) / q));
+
+    edges.clear();
+    weights.clear();
+    table.append_partner_weights({3, -1}, edges, weights);
+    ASSERT_TRUE(edges.empty());
+}
+
+TEST(EdgeCorrelationTable, NoCorrelations) {
+    stim::DetectorErrorModel dem(R"DEM(
+        error(0.1) D0 D1
+        error(0.1) D1
+    )DEM");
+    ASSERT_TRUE(pm::detector_error_model_to_edge_correlation_table(dem).empty());
+}
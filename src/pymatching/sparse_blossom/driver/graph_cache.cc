@@ -0,0 +1,144 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/graph_cache.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+
+#include "pymatching/sparse_blossom/driver/graph_file.h"
+#include "stim.h"
+
+namespace {
+
+/// A 128 bit hash of a sequence of bytes, from two independent 64 bit lanes. It is only used to name the files of a
+/// graph cache, so it need not resist deliberate collisions.
+class ContentHash {
+   public:
+    ContentHash() : fnv(UINT64_C(0xcbf29ce484222325)), mix(UINT64_C(0x243F6A8885A308D3)), num_bytes(0) {
+    }
+
+    void add(const void* data, size_t size) {
+        auto bytes = (const uint8_t*)data;
+        for (size_t k = 0; k < size; k++) {
+            fnv = (fnv ^ bytes[k]) * UINT64_C(0x100000001b3);
+            mix = (mix ^ bytes[k]) * UINT64_C(0x9E3779B97F4A7C15);
+            mix ^= mix >> 29;
+        }
+        num_bytes += size;
+    }
+
+    void add(const std::string& text) {
+        // The length is included so that the boundaries between the strings are part of the hash.
+        uint64_t size = text.size();
+        add(&size, sizeof(size));
+        add(text.data(), text.size());
+    }
+
+    std::string hex() const {
+        char buffer[33];
+        snprintf(
+            buffer,
+            sizeof(buffer),
+            "%016llx%016llx",
+            (unsigned long long)finalize(fnv ^ num_bytes),
+            (unsigned long long)finalize(mix));
+        return buffer;
+    }
+
+   private:
+    uint64_t fnv;
+    uint64_t mix;
+    uint64_t num_bytes;
+
+    /// The finalizer of splitmix64.
+    static uint64_t finalize(uint64_t z) {
+        z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+        z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+        return z ^ (z >> 31);
+    }
+};
+
+}  // namespace
+
+std::string pm::graph_cache_file_name(const std::string& source_kind, const std::string& source_text) {
+    ContentHash hash;
+    hash.add(std::string("pymatching graph cache"));
+    hash.add(source_kind);
+    // The parameters the cached graphs are built with. Graph files saved from a UserGraph always include the search
+    // graph.
+    uint64_t parameters[] = {
+        (uint64_t)pm::NUM_DISTINCT_WEIGHTS,
+        (uint64_t)pm::GRAPH_FILE_VERSION,
+        sizeof(pm::weight_int),
+        sizeof(pm::obs_int),
+        sizeof(pm::node_index_int)};
+    hash.add(parameters, sizeof(parameters));
+    hash.add(source_text);
+    return hash.hex() + ".pmg";
+}
+
+pm::UserGraph pm::load_or_build_cached_user_graph(
+    const std::string& cache_dir,
+    const std::string& source_kind,
+    const std::string& source_text,
+    const std::function<UserGraph()>& build) {
+    std::filesystem::path path = std::filesystem::path(cache_dir) / graph_cache_file_name(source_kind, source_text);
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec)) {
+        try {
+            return load_user_graph_from_graph_file(path.string());
+        } catch (const std::invalid_argument&) {
+            // Rebuilt below, replacing the file.
+        }
+    }
+
+    UserGraph graph = build();
+    std::filesystem::create_directories(cache_dir, ec);
+    if (ec)
+        throw std::invalid_argument("Failed to create the graph cache directory '" + cache_dir + "'.");
+    // Each process writes to its own temporary file, so that concurrent writers never write to the same file.
+    std::random_device rd;
+    std::filesystem::path temporary_path = path;
+    temporary_path += ".tmp" + std::to_string(((uint64_t)rd() << 32) ^ (uint64_t)rd());
+    try {
+        save_graph_file(temporary_path.string(), graph);
+    } catch (...) {
+        std::filesystem::remove(temporary_path, ec);
+        throw;
+    }
+    std::filesystem::rename(temporary_path, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary_path, ec);
+        throw std::invalid_argument("Failed to save a graph to the graph cache '" + cache_dir + "'.");
+    }
+    return graph;
+}
+
+pm::UserGraph pm::cached_detector_error_model_to_user_graph(const std::string& cache_dir, const std::string& dem_text) {
+    return load_or_build_cached_user_graph(cache_dir, "dem", dem_text, [&]() {
+        return detector_error_model_to_user_graph(stim::DetectorErrorModel(dem_text.c_str()));
+    });
+}
+
+pm::UserGraph pm::cached_stim_circuit_to_user_graph(const std::string& cache_dir, const std::string& circuit_text) {
+    return load_or_build_cached_user_graph(cache_dir, "circuit", circuit_text, [&]() {
+        auto circuit = stim::Circuit(circuit_text.c_str());
+        auto dem = stim::ErrorAnalyzer::circuit_to_detector_error_model(circuit, true, true, false, 0, false, false);
+        return detector_error_model_to_user_graph(dem);
+    });
+}
@@ -0,0 +1,57 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_GRAPH_CACHE_H
+#define PYMATCHING2_GRAPH_CACHE_H
+
+#include <functional>
+#include <string>
+
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+
+namespace pm {
+
+/// A graph cache is a directory of graph files (see `save_graph_file'), each holding the UserGraph built from a
+/// stim circuit or detector error model, and its Mwpm (including its search graph). A graph is stored under a hash
+/// of the text it was built from, the kind of text (`source_kind', e.g. "circuit" or "dem"), and the parameters the
+/// graph is built with (the number of distinct weights and the graph file format). Loading a cached graph skips
+/// parsing the text, converting a circuit to a detector error model, merging parallel edges and building the
+/// decoding graphs.
+///
+/// Any number of processes may share a cache directory. A graph is written to a temporary file in the directory,
+/// which is then renamed to its place in the cache, so that a process never loads a partially written graph, and
+/// processes building the same graph at the same time each install a complete copy. A cached file that can't be
+/// loaded (e.g. because it was written by an incompatible build) is rebuilt and replaced.
+
+/// The name of the file of a cache directory holding the graph built from `source_text'.
+std::string graph_cache_file_name(const std::string& source_kind, const std::string& source_text);
+
+/// Loads the graph built from `source_text' from the cache directory `cache_dir' if it is there. Otherwise, builds
+/// it with `build', saves it to the cache (creating `cache_dir' if needed) and returns it. Throws
+/// std::invalid_argument if the graph isn't cached and can't be saved.
+UserGraph load_or_build_cached_user_graph(
+    const std::string& cache_dir,
+    const std::string& source_kind,
+    const std::string& source_text,
+    const std::function<UserGraph()>& build);
+
+/// `detector_error_model_to_user_graph' for the detector error model `dem_text', using the graph cache `cache_dir'.
+UserGraph cached_detector_error_model_to_user_graph(const std::string& cache_dir, const std::string& dem_text);
+/// Builds the graph of the detector error model of the stim circuit `circuit_text' (with its errors decomposed),
+/// using the graph cache `cache_dir'.
+UserGraph cached_stim_circuit_to_user_graph(const std::string& cache_dir, const std::string& circuit_text);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_GRAPH_CACHE_H
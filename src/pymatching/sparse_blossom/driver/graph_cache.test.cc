@@ -0,0 +1,107 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/graph_cache.h"
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <thread>
+
+#include "gtest/gtest.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+
+namespace {
+
+std::string make_temp_cache_dir() {
+    auto name = "pymatching_graph_cache_" + std::to_string(std::random_device()());
+    auto dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    return (dir / "cache").string();
+}
+
+}  // namespace
+
+TEST(GraphCache, FileNameDependsOnKindAndText) {
+    auto a = pm::graph_cache_file_name("dem", "error(0.1) D0 D1");
+    ASSERT_EQ(a, pm::graph_cache_file_name("dem", "error(0.1) D0 D1"));
+    ASSERT_NE(a, pm::graph_cache_file_name("dem", "error(0.1) D0 D2"));
+    ASSERT_NE(a, pm::graph_cache_file_name("circuit", "error(0.1) D0 D1"));
+    ASSERT_EQ(a.size(), 32 + 4);
+}
+
+TEST(GraphCache, BuildsOnceThenLoads) {
+    auto cache_dir = make_temp_cache_dir();
+    size_t num_builds = 0;
+    auto build = [&]() {
+        num_builds++;
+        return pm::repetition_code_graph(10, 11);
+    };
+    auto built = pm::load_or_build_cached_user_graph(cache_dir, "test", "line 10", build);
+    ASSERT_EQ(num_builds, 1);
+    auto loaded = pm::load_or_build_cached_user_graph(cache_dir, "test", "line 10", build);
+    ASSERT_EQ(num_builds, 1);
+    ASSERT_EQ(loaded.get_num_nodes(), built.get_num_nodes());
+    ASSERT_EQ(loaded.get_num_edges(), built.get_num_edges());
+    std::vector<uint64_t> detection_events{2, 7};
+    auto expected = pm::decode_detection_events_for_up_to_64_observables(built.get_mwpm(), detection_events);
+    auto actual = pm::decode_detection_events_for_up_to_64_observables(loaded.get_mwpm(), detection_events);
+    ASSERT_EQ(actual.obs_mask, expected.obs_mask);
+    ASSERT_EQ(actual.weight, expected.weight);
+
+    // A different source is built separately, and a corrupted cache file is rebuilt and replaced.
+    pm::load_or_build_cached_user_graph(cache_dir, "test", "line 12", [&]() {
+        num_builds++;
+        return pm::repetition_code_graph(12, 13);
+    });
+    ASSERT_EQ(num_builds, 2);
+    std::ofstream(std::filesystem::path(cache_dir) / pm::graph_cache_file_name("test", "line 10")) << "not a graph";
+    pm::load_or_build_cached_user_graph(cache_dir, "test", "line 10", build);
+    ASSERT_EQ(num_builds, 3);
+    pm::load_or_build_cached_user_graph(cache_dir, "test", "line 10", build);
+    ASSERT_EQ(num_builds, 3);
+
+    // No temporary files are left behind.
+    size_t num_files = 0;
+    for (auto& entry : std::filesystem::directory_iterator(cache_dir)) {
+        ASSERT_EQ(entry.path().extension(), ".pmg");
+        num_files++;
+    }
+    ASSERT_EQ(num_files, 2);
+    std::filesystem::remove_all(std::filesystem::path(cache_dir).parent_path());
+}
+
+TEST(GraphCache, ConcurrentWritersEachGetTheGraph) {
+    auto cache_dir = make_temp_cache_dir();
+    std::vector<std::thread> threads;
+    std::vector<size_t> num_nodes(8, 0);
+    for (size_t t = 0; t < num_nodes.size(); t++) {
+        threads.emplace_back([&, t]() {
+            auto graph = pm::load_or_build_cached_user_graph(cache_dir, "test", "line 50", []() {
+                return pm::repetition_code_graph(50, 51);
+            });
+            num_nodes[t] = graph.get_num_nodes();
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (size_t n : num_nodes)
+        ASSERT_EQ(n, 50);
+    auto loaded = pm::load_or_build_cached_user_graph(cache_dir, "test", "line 50", []() -> pm::UserGraph {
+        throw std::invalid_argument("Should have been cached.");
+    });
+    ASSERT_EQ(loaded.get_num_nodes(), 50);
+    std::filesystem::remove_all(std::filesystem::path(cache_dir).parent_path());
+}
@@ -0,0 +1,760 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pymatching/sparse_blossom/driver/graph_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char GRAPH_FILE_MAGIC[8] = {'P', 'M', 'G', 'R', 'A', 'P', 'H', '\0'};
+/// Written in the native byte order, so that a file written on a machine with a different byte order is detected.
+const uint32_t GRAPH_FILE_BYTE_ORDER_MARK = 0x01020304;
+const uint32_t HAS_SEARCH_GRAPH = 1;
+const uint32_t HAS_USER_GRAPH = 2;
+const uint32_t HAS_NODE_RELABELING = 4;
+const uint32_t KNOWN_FLAGS = HAS_SEARCH_GRAPH | HAS_USER_GRAPH | HAS_NODE_RELABELING;
+
+/// Writes the header fields and arrays of a graph file, to a file or to a buffer in memory, padding each array to a
+/// multiple of 8 bytes.
+class GraphFileWriter {
+   public:
+    explicit GraphFileWriter(const std::string& path)
+        : label("'" + path + "'"), file(fopen(path.c_str(), "wb")), buffer(nullptr), num_bytes(0) {
+        if (file == nullptr)
+            throw std::invalid_argument("Failed to open '" + path + "' for writing.");
+    }
+
+    explicit GraphFileWriter(std::vector<uint8_t>& buffer)
+        : label("memory"), file(nullptr), buffer(&buffer), num_bytes(0) {
+    }
+
+    ~GraphFileWriter() {
+        if (file != nullptr)
+            fclose(file);
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        write_bytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    void write_array(const T* data, size_t n) {
+        write_bytes(data, n * sizeof(T));
+        static const uint8_t zeros[8] = {};
+        write_bytes(zeros, (8 - num_bytes % 8) % 8);
+    }
+
+    /// Writes the values of a std::vector or PackedArray.
+    template <typename Array>
+    void write_array(const Array& values) {
+        write_array(values.data(), values.size());
+    }
+
+    /// Writes node or edge indices as 64-bit integers, with SIZE_MAX (the boundary) written as UINT64_MAX.
+    void write_indices(const size_t* data, size_t n) {
+        if constexpr (sizeof(size_t) == sizeof(uint64_t)) {
+            write_array(data, n);
+        } else {
+            std::vector<uint64_t> wide(n);
+            for (size_t k = 0; k < n; k++)
+                wide[k] = data[k] == SIZE_MAX ? UINT64_MAX : data[k];
+            write_array(wide);
+        }
+    }
+
+    template <typename Array>
+    void write_indices(const Array& indices) {
+        write_indices(indices.data(), indices.size());
+    }
+
+    void close() {
+        if (file == nullptr)
+            return;
+        int err = fclose(file);
+        file = nullptr;
+        if (err != 0)
+            throw std::invalid_argument("Failed to write to " + label + ".");
+    }
+
+   private:
+    std::string label;
+    FILE* file;
+    std::vector<uint8_t>* buffer;
+    size_t num_bytes;
+
+    void write_bytes(const void* data, size_t n) {
+        if (buffer != nullptr) {
+            buffer->insert(buffer->end(), (const uint8_t*)data, (const uint8_t*)data + n);
+        } else if (n > 0 && fwrite(data, 1, n, file) != n) {
+            throw std::invalid_argument("Failed to write to " + label + ".");
+        }
+        num_bytes += n;
+    }
+};
+
+/// Prefixes `name' with a slash if it doesn't already start with one, as POSIX shared memory object names must.
+std::string shared_memory_object_name(const std::string& name) {
+    return (!name.empty() && name[0] == '/') ? name : "/" + name;
+}
+
+/// A graph file (or a graph saved to shared memory) mapped into memory read-only, or read into a buffer where mmap is
+/// unavailable. The arrays of an attached graph are views of the mapping, which hold a reference to it, so that it
+/// stays mapped for as long as any of them is in use.
+class GraphFileMapping {
+   public:
+    /// Describes the mapped graph in error messages, e.g. "graph file '/tmp/g.pmg'".
+    std::string label;
+    const uint8_t* data;
+    size_t num_bytes;
+
+    /// Maps the file at `path'. A mapping with `shared' set (for attaching to the file) is MAP_SHARED, so that it
+    /// always reads the pages of the file in the page cache, which are shared by every process that maps it.
+    static std::shared_ptr<GraphFileMapping> map_file(const std::string& path, bool shared) {
+        auto mapping = std::shared_ptr<GraphFileMapping>(new GraphFileMapping("graph file '" + path + "'"));
+#if !defined(_WIN32)
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd == -1)
+            throw std::invalid_argument("Failed to open '" + path + "'.");
+        mapping->map_fd(fd, shared);
+        if (mapping->data != nullptr && !shared)
+            madvise((void*)mapping->data, mapping->num_bytes, MADV_SEQUENTIAL);
+#else
+        FILE* f = fopen(path.c_str(), "rb");
+        if (f == nullptr)
+            throw std::invalid_argument("Failed to open '" + path + "'.");
+        uint8_t buf[1 << 16];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            mapping->fallback_buffer.insert(mapping->fallback_buffer.end(), buf, buf + n);
+        fclose(f);
+        mapping->num_bytes = mapping->fallback_buffer.size();
+        mapping->data = mapping->fallback_buffer.data();
+#endif
+        return mapping;
+    }
+
+    /// Maps the POSIX shared memory object `name' written by `save_graph_to_shared_memory'.
+    static std::shared_ptr<GraphFileMapping> map_shared_memory(const std::string& name) {
+#if !defined(_WIN32)
+        auto mapping = std::shared_ptr<GraphFileMapping>(new GraphFileMapping("shared memory graph '" + name + "'"));
+        int fd = shm_open(shared_memory_object_name(name).c_str(), O_RDONLY, 0);
+        if (fd == -1)
+            throw std::invalid_argument("Failed to open the shared memory graph '" + name + "'.");
+        mapping->map_fd(fd, true);
+        return mapping;
+#else
+        throw std::invalid_argument("Graphs in shared memory are not supported on this platform.");
+#endif
+    }
+
+    ~GraphFileMapping() {
+#if !defined(_WIN32)
+        if (data != nullptr)
+            munmap((void*)data, num_bytes);
+#endif
+    }
+
+    GraphFileMapping(const GraphFileMapping&) = delete;
+    GraphFileMapping& operator=(const GraphFileMapping&) = delete;
+
+   private:
+    std::vector<uint8_t> fallback_buffer;
+
+    explicit GraphFileMapping(std::string label) : label(std::move(label)), data(nullptr), num_bytes(0) {
+    }
+
+#if !defined(_WIN32)
+    /// Maps the whole of the open file `fd', and closes it.
+    void map_fd(int fd, bool shared) {
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::invalid_argument("Failed to get the size of the " + label + ".");
+        }
+        num_bytes = (size_t)st.st_size;
+        if (num_bytes > 0) {
+            void* mapped = mmap(nullptr, num_bytes, PROT_READ, shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                close(fd);
+                num_bytes = 0;
+                throw std::invalid_argument("Failed to memory map the " + label + ".");
+            }
+            data = (const uint8_t*)mapped;
+        }
+        close(fd);
+    }
+#endif
+};
+
+/// Reads the header fields and arrays of a mapped graph file in order, checking that the file is long enough to
+/// contain them. The packed arrays of the matching graph topology are copied when a file is loaded, and are views of
+/// the mapping when it is attached.
+class GraphFileReader {
+   public:
+    GraphFileReader(std::shared_ptr<const GraphFileMapping> mapping, bool attach)
+        : mapping(std::move(mapping)), attach(attach), cursor(0) {
+    }
+
+    bool is_attaching() const {
+        return attach;
+    }
+
+    template <typename T>
+    T read() {
+        T value;
+        read_bytes(&value, 1, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    std::vector<T> read_array(size_t n) {
+        // Checked before allocating, so that a corrupted count fails rather than allocating a huge array.
+        check_available(n, sizeof(T));
+        std::vector<T> values(n);
+        read_bytes(values.data(), n, sizeof(T));
+        skip_padding();
+        return values;
+    }
+
+    std::vector<size_t> read_indices(size_t n) {
+        if constexpr (sizeof(size_t) == sizeof(uint64_t)) {
+            return read_array<size_t>(n);
+        } else {
+            auto wide = read_array<uint64_t>(n);
+            std::vector<size_t> indices(n);
+            for (size_t k = 0; k < n; k++) {
+                if (wide[k] != UINT64_MAX && wide[k] >= SIZE_MAX)
+                    fail("contains an index that is too large for this platform");
+                indices[k] = wide[k] == UINT64_MAX ? SIZE_MAX : (size_t)wide[k];
+            }
+            return indices;
+        }
+    }
+
+    /// Reads an array of the topology: a view of the mapping when attaching, and a copy otherwise.
+    template <typename T>
+    pm::PackedArray<T> read_packed_array(size_t n) {
+        pm::PackedArray<T> values;
+        if (attach) {
+            check_available(n, sizeof(T));
+            values = pm::PackedArray<T>::view((const T*)(mapping->data + cursor), n, mapping);
+            cursor += n * sizeof(T);
+        } else {
+            check_available(n, sizeof(T));
+            values.resize(n);
+            read_bytes(values.mutable_data(), n, sizeof(T));
+        }
+        skip_padding();
+        return values;
+    }
+
+    pm::PackedArray<size_t> read_packed_indices(size_t n) {
+        if constexpr (sizeof(size_t) == sizeof(uint64_t)) {
+            return read_packed_array<size_t>(n);
+        } else {
+            auto indices = read_indices(n);
+            pm::PackedArray<size_t> values;
+            values.assign(indices.begin(), indices.end());
+            return values;
+        }
+    }
+
+    /// Skips over an array that is not needed.
+    template <typename T>
+    void skip_array(size_t n) {
+        check_available(n, sizeof(T));
+        cursor += n * sizeof(T);
+        skip_padding();
+    }
+
+    [[noreturn]] void fail(const std::string& problem) const {
+        throw std::invalid_argument("The " + mapping->label + " " + problem + ".");
+    }
+
+   private:
+    std::shared_ptr<const GraphFileMapping> mapping;
+    bool attach;
+    size_t cursor;
+
+    void check_available(size_t n, size_t item_size) const {
+        if (n > (mapping->num_bytes - cursor) / item_size)
+            fail("is truncated");
+    }
+
+    void read_bytes(void* out, size_t n, size_t item_size) {
+        check_available(n, item_size);
+        if (n > 0)
+            memcpy(out, mapping->data + cursor, n * item_size);
+        cursor += n * item_size;
+    }
+
+    void skip_padding() {
+        cursor = std::min(mapping->num_bytes, cursor + (8 - cursor % 8) % 8);
+    }
+};
+
+/// Checks that `offsets' is a valid CSR offsets array for `num_items' items over `num_entries' entries.
+template <typename Array>
+void check_offsets(const GraphFileReader& reader, const Array& offsets, size_t num_entries) {
+    if (offsets.front() != 0 || offsets.back() != num_entries)
+        reader.fail("has inconsistent edge offsets");
+    for (size_t k = 1; k < offsets.size(); k++) {
+        if (offsets[k] < offsets[k - 1])
+            reader.fail("has inconsistent edge offsets");
+    }
+}
+
+template <typename Array>
+void check_node_indices(const GraphFileReader& reader, const Array& indices, size_t num_nodes, bool allow_boundary) {
+    for (auto i : indices) {
+        if (i >= num_nodes && !(allow_boundary && i == SIZE_MAX))
+            reader.fail("refers to a node that is not in the graph");
+    }
+}
+
+/// The search graph section. The search graph shares the topology of the matching graph, so only its edges with
+/// negative weights are stored, as (u, v) pairs with v equal to SIZE_MAX for a boundary edge.
+struct SearchGraphSection {
+    std::vector<size_t> negative_weight_edges;
+
+    std::vector<std::pair<size_t, size_t>> negative_weight_edge_pairs() const {
+        std::vector<std::pair<size_t, size_t>> pairs;
+        for (size_t k = 0; k + 1 < negative_weight_edges.size(); k += 2)
+            pairs.emplace_back(negative_weight_edges[k], negative_weight_edges[k + 1]);
+        return pairs;
+    }
+};
+
+/// The user graph section. When a graph file is attached, only the number of edges is read, not the edges themselves.
+struct UserGraphSection {
+    size_t num_nodes = 0;
+    size_t num_observables = 0;
+    size_t num_edges = 0;
+    std::vector<size_t> node1;
+    std::vector<size_t> node2;
+    std::vector<double> weights;
+    std::vector<double> error_probabilities;
+    std::vector<size_t> observables_offsets;
+    std::vector<size_t> observables;
+    std::vector<size_t> boundary_nodes;
+};
+
+struct GraphFileContents {
+    uint32_t flags = 0;
+    pm::MatchingGraph graph;
+    SearchGraphSection search_graph;
+    UserGraphSection user_graph;
+};
+
+void write_graph_file(GraphFileWriter& writer, const pm::Mwpm& mwpm, pm::UserGraph* user_graph) {
+    auto& graph = mwpm.flooder.graph;
+    auto& search_graph = mwpm.search_flooder.graph;
+    bool has_search_graph = !search_graph.nodes.empty();
+
+    // Saved graphs are always in the ordinary compact layout, so pack (or expand) the edges first if they are not.
+    const pm::MatchingGraphTopology* topology = graph.topology.get();
+    pm::MatchingGraphTopology packed;
+    if (!topology->is_compact()) {
+        packed = topology->packed();
+        topology = &packed;
+    } else if (topology->is_periodic()) {
+        packed = topology->expanded();
+        topology = &packed;
+    }
+    if (topology->component_of_node.size() != topology->num_compact_nodes()) {
+        if (topology != &packed)
+            packed = *topology;
+        packed.label_components();
+        topology = &packed;
+    }
+
+    writer.write_array(GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC));
+    writer.write(pm::GRAPH_FILE_VERSION);
+    writer.write(GRAPH_FILE_BYTE_ORDER_MARK);
+    writer.write((uint32_t)sizeof(pm::weight_int));
+    writer.write((uint32_t)sizeof(pm::obs_int));
+    writer.write(
+        (uint32_t)((has_search_graph ? HAS_SEARCH_GRAPH : 0) | (user_graph != nullptr ? HAS_USER_GRAPH : 0) |
+                   (graph.node_relabeling ? HAS_NODE_RELABELING : 0)));
+    writer.write((uint32_t)sizeof(pm::node_index_int));
+
+    // The matching graph.
+    std::vector<size_t> negative_weight_detection_events(
+        graph.negative_weight_detection_events_set.begin(), graph.negative_weight_detection_events_set.end());
+    std::vector<size_t> negative_weight_observables(
+        graph.negative_weight_observables_set.begin(), graph.negative_weight_observables_set.end());
+    std::vector<uint8_t> is_user_graph_boundary_node(
+        graph.is_user_graph_boundary_node.begin(), graph.is_user_graph_boundary_node.end());
+    writer.write((uint64_t)graph.num_nodes);
+    writer.write((uint64_t)graph.num_observables);
+    writer.write(graph.normalising_constant);
+    writer.write((int64_t)graph.negative_weight_sum);
+    writer.write((uint64_t)topology->neighbors.size());
+    writer.write((uint64_t)negative_weight_detection_events.size());
+    writer.write((uint64_t)negative_weight_observables.size());
+    writer.write((uint64_t)is_user_graph_boundary_node.size());
+    writer.write((uint64_t)topology->observable_indices.size());
+    writer.write((uint64_t)topology->num_components);
+    // Unlike every other index, the neighbors are written as node_index_int, with BOUNDARY_NEIGHBOR_INDEX for the
+    // boundary, so that like the weights and observables they can be attached in place.
+    writer.write_indices(topology->offsets);
+    writer.write_array(topology->neighbors);
+    writer.write_array(topology->neighbor_weights);
+    writer.write_array(topology->neighbor_observables);
+    // The observable indices of each edge end are only stored for graphs with too many observables for obs_int.
+    if (topology->has_observable_indices) {
+        writer.write_indices(topology->observable_offsets);
+        writer.write_indices(topology->observable_indices);
+    }
+    writer.write_indices(topology->component_of_node);
+    writer.write_indices(negative_weight_detection_events);
+    writer.write_indices(negative_weight_observables);
+    writer.write_array(is_user_graph_boundary_node);
+
+    if (has_search_graph) {
+        SearchGraphSection section;
+        for (auto& e : search_graph.negative_weight_edges) {
+            section.negative_weight_edges.push_back(e.first);
+            section.negative_weight_edges.push_back(e.second);
+        }
+        writer.write((uint64_t)search_graph.negative_weight_edges.size());
+        writer.write_indices(section.negative_weight_edges);
+    }
+
+    if (user_graph != nullptr) {
+        UserGraphSection section;
+        section.observables_offsets.push_back(0);
+        for (auto& e : user_graph->edges) {
+            section.node1.push_back(e.node1);
+            section.node2.push_back(e.node2);
+            section.weights.push_back(e.weight);
+            section.error_probabilities.push_back(e.error_probability);
+            section.observables.insert(
+                section.observables.end(), e.observable_indices.begin(), e.observable_indices.end());
+            section.observables_offsets.push_back(section.observables.size());
+        }
+        section.boundary_nodes.assign(user_graph->boundary_nodes.begin(), user_graph->boundary_nodes.end());
+        writer.write((uint64_t)user_graph->nodes.size());
+        writer.write((uint64_t)user_graph->get_num_observables());
+        writer.write((uint64_t)section.node1.size());
+        writer.write((uint64_t)section.observables.size());
+        writer.write((uint64_t)section.boundary_nodes.size());
+        writer.write_indices(section.node1);
+        writer.write_indices(section.node2);
+        writer.write_array(section.weights);
+        writer.write_array(section.error_probabilities);
+        writer.write_indices(section.observables_offsets);
+        writer.write_indices(section.observables);
+        writer.write_indices(section.boundary_nodes);
+    }
+
+    // The original index of each node of the graphs, if they were relabeled.
+    if (graph.node_relabeling)
+        writer.write_indices(graph.node_relabeling->original_index);
+    writer.close();
+}
+
+GraphFileContents read_graph_file(GraphFileReader& reader) {
+    auto magic = reader.read_array<char>(sizeof(GRAPH_FILE_MAGIC));
+    if (memcmp(magic.data(), GRAPH_FILE_MAGIC, sizeof(GRAPH_FILE_MAGIC)) != 0)
+        reader.fail("is not a PyMatching graph file");
+    auto version = reader.read<uint32_t>();
+    if (version != pm::GRAPH_FILE_VERSION)
+        reader.fail(
+            "has format version " + std::to_string(version) + ", but only version " +
+            std::to_string(pm::GRAPH_FILE_VERSION) + " is supported");
+    if (reader.read<uint32_t>() != GRAPH_FILE_BYTE_ORDER_MARK)
+        reader.fail("was written on a machine with a different byte order");
+    if (reader.read<uint32_t>() != sizeof(pm::weight_int) || reader.read<uint32_t>() != sizeof(pm::obs_int))
+        reader.fail("was written by a build of PyMatching with a different edge weight or observable integer size");
+    uint32_t flags = reader.read<uint32_t>();
+    if (flags & ~KNOWN_FLAGS)
+        reader.fail("contains sections that are not supported by this build of PyMatching");
+    if (reader.read<uint32_t>() != sizeof(pm::node_index_int))
+        reader.fail("was written by a build of PyMatching with a different node index integer size");
+
+    size_t num_nodes = reader.read<uint64_t>();
+    size_t num_observables = reader.read<uint64_t>();
+    double normalising_constant = reader.read<double>();
+    auto negative_weight_sum = (pm::total_weight_int)reader.read<int64_t>();
+    size_t num_edge_ends = reader.read<uint64_t>();
+    size_t num_negative_weight_detection_events = reader.read<uint64_t>();
+    size_t num_negative_weight_observables = reader.read<uint64_t>();
+    size_t num_boundary_flags = reader.read<uint64_t>();
+    size_t num_observable_indices = reader.read<uint64_t>();
+    size_t num_components = reader.read<uint64_t>();
+
+    // The arrays of the topology are checked even when they are attached, since decoding a corrupted graph could
+    // read outside of them.
+    if (num_nodes > pm::MAX_MATCHING_GRAPH_NODES)
+        reader.fail("has more nodes than a graph can have");
+    auto topology = std::make_shared<pm::MatchingGraphTopology>();
+    topology->offsets = reader.read_packed_indices(num_nodes + 1);
+    check_offsets(reader, topology->offsets, num_edge_ends);
+    topology->neighbors = reader.read_packed_array<pm::node_index_int>(num_edge_ends);
+    for (auto v : topology->neighbors) {
+        if (v >= num_nodes && v != pm::BOUNDARY_NEIGHBOR_INDEX)
+            reader.fail("refers to a node that is not in the graph");
+    }
+    topology->neighbor_weights = reader.read_packed_array<pm::weight_int>(num_edge_ends);
+    topology->neighbor_observables = reader.read_packed_array<pm::obs_int>(num_edge_ends);
+    topology->has_observable_indices = num_observables > sizeof(pm::obs_int) * 8;
+    if (topology->has_observable_indices) {
+        topology->observable_offsets = reader.read_indices(num_edge_ends + 1);
+        check_offsets(reader, topology->observable_offsets, num_observable_indices);
+        topology->observable_indices = reader.read_indices(num_observable_indices);
+        for (auto obs : topology->observable_indices) {
+            if (obs >= num_observables)
+                reader.fail("refers to an observable that is not in the graph");
+        }
+    } else if (num_observable_indices != 0) {
+        reader.fail("has observable indices for a graph whose observables are stored as bit masks");
+    }
+    topology->component_of_node = reader.read_packed_indices(num_nodes);
+    topology->num_components = num_components;
+    for (auto c : topology->component_of_node) {
+        if (c >= num_components)
+            reader.fail("has inconsistent connected components");
+    }
+    auto negative_weight_detection_events = reader.read_indices(num_negative_weight_detection_events);
+    check_node_indices(reader, negative_weight_detection_events, num_nodes, false);
+    auto negative_weight_observables = reader.read_indices(num_negative_weight_observables);
+    for (auto obs : negative_weight_observables) {
+        if (obs >= num_observables)
+            reader.fail("refers to an observable that is not in the graph");
+    }
+    auto is_user_graph_boundary_node = reader.read_array<uint8_t>(num_boundary_flags);
+
+    pm::MatchingGraph graph(num_nodes, num_observables, normalising_constant);
+    graph.set_topology(std::move(topology));
+    graph.negative_weight_detection_events_set.insert(
+        negative_weight_detection_events.begin(), negative_weight_detection_events.end());
+    graph.negative_weight_observables_set.insert(
+        negative_weight_observables.begin(), negative_weight_observables.end());
+    graph.negative_weight_sum = negative_weight_sum;
+    graph.is_user_graph_boundary_node.assign(is_user_graph_boundary_node.begin(), is_user_graph_boundary_node.end());
+
+    SearchGraphSection search_graph;
+    if (flags & HAS_SEARCH_GRAPH) {
+        auto& section = search_graph;
+        size_t num_negative_weight_edges = reader.read<uint64_t>();
+        section.negative_weight_edges = reader.read_indices(2 * num_negative_weight_edges);
+        check_node_indices(reader, section.negative_weight_edges, num_nodes, true);
+    }
+
+    UserGraphSection user_graph;
+    if (flags & HAS_USER_GRAPH) {
+        auto& section = user_graph;
+        section.num_nodes = reader.read<uint64_t>();
+        section.num_observables = reader.read<uint64_t>();
+        section.num_edges = reader.read<uint64_t>();
+        size_t num_edges = section.num_edges;
+        size_t num_observable_indices = reader.read<uint64_t>();
+        size_t num_boundary_nodes = reader.read<uint64_t>();
+        if (reader.is_attaching()) {
+            reader.skip_array<uint64_t>(num_edges);
+            reader.skip_array<uint64_t>(num_edges);
+            reader.skip_array<double>(num_edges);
+            reader.skip_array<double>(num_edges);
+            reader.skip_array<uint64_t>(num_edges + 1);
+            reader.skip_array<uint64_t>(num_observable_indices);
+        } else {
+            section.node1 = reader.read_indices(num_edges);
+            check_node_indices(reader, section.node1, section.num_nodes, false);
+            section.node2 = reader.read_indices(num_edges);
+            check_node_indices(reader, section.node2, section.num_nodes, true);
+            section.weights = reader.read_array<double>(num_edges);
+            section.error_probabilities = reader.read_array<double>(num_edges);
+            section.observables_offsets = reader.read_indices(num_edges + 1);
+            check_offsets(reader, section.observables_offsets, num_observable_indices);
+            section.observables = reader.read_indices(num_observable_indices);
+        }
+        section.boundary_nodes = reader.read_indices(num_boundary_nodes);
+        check_node_indices(reader, section.boundary_nodes, section.num_nodes, false);
+    }
+
+    if (flags & HAS_NODE_RELABELING) {
+        auto original_index = reader.read_indices(num_nodes);
+        try {
+            graph.node_relabeling = std::make_shared<pm::NodeRelabeling>(std::move(original_index));
+        } catch (const std::invalid_argument&) {
+            reader.fail("has a node relabeling that is not a permutation of its nodes");
+        }
+    }
+    return GraphFileContents{flags, std::move(graph), std::move(search_graph), std::move(user_graph)};
+}
+
+pm::Mwpm make_mwpm(pm::MatchingGraph graph, const SearchGraphSection* search_graph) {
+    if (search_graph == nullptr) {
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(graph)));
+        mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+        return mwpm;
+    }
+    pm::SearchGraph shared_search_graph(graph, search_graph->negative_weight_edge_pairs());
+    auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(graph)), pm::SearchFlooder(std::move(shared_search_graph)));
+    mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+    return mwpm;
+}
+
+GraphFileContents read_graph_file(const std::string& path, bool attach) {
+    GraphFileReader reader(GraphFileMapping::map_file(path, attach), attach);
+    return read_graph_file(reader);
+}
+
+pm::UserGraph attach_user_graph(std::shared_ptr<const GraphFileMapping> mapping) {
+    GraphFileReader reader(std::move(mapping), true);
+    auto contents = read_graph_file(reader);
+    if (!(contents.flags & HAS_USER_GRAPH))
+        reader.fail("does not contain a user graph, since it was not saved from a UserGraph");
+    // Without its edges, an attached UserGraph couldn't build the search graph if it were missing.
+    if (!(contents.flags & HAS_SEARCH_GRAPH))
+        reader.fail("has no search graph, which is needed to attach a UserGraph to it");
+    auto& section = contents.user_graph;
+    pm::UserGraph user_graph(section.num_nodes, section.num_observables);
+    user_graph.set_boundary(std::set<size_t>(section.boundary_nodes.begin(), section.boundary_nodes.end()));
+    user_graph.attach_mwpm(make_mwpm(std::move(contents.graph), &contents.search_graph), section.num_edges);
+    return user_graph;
+}
+
+}  // namespace
+
+void pm::save_graph_file(const std::string& path, const pm::Mwpm& mwpm) {
+    GraphFileWriter writer(path);
+    write_graph_file(writer, mwpm, nullptr);
+    writer.close();
+}
+
+void pm::save_graph_file(const std::string& path, pm::UserGraph& user_graph) {
+    user_graph.check_edges_loaded();
+    GraphFileWriter writer(path);
+    write_graph_file(writer, user_graph.get_mwpm_with_search_graph(), &user_graph);
+    writer.close();
+}
+
+pm::Mwpm pm::load_mwpm_from_graph_file(const std::string& path) {
+    auto contents = read_graph_file(path, false);
+    bool has_search_graph = contents.flags & HAS_SEARCH_GRAPH;
+    return make_mwpm(std::move(contents.graph), has_search_graph ? &contents.search_graph : nullptr);
+}
+
+std::vector<pm::Mwpm> pm::load_mwpms_from_graph_file(const std::string& path, size_t num_mwpms) {
+    std::vector<pm::Mwpm> mwpms;
+    if (num_mwpms == 0)
+        return mwpms;
+    auto contents = read_graph_file(path, false);
+    const SearchGraphSection* search_graph = (contents.flags & HAS_SEARCH_GRAPH) ? &contents.search_graph : nullptr;
+    mwpms.reserve(num_mwpms);
+    mwpms.push_back(make_mwpm(std::move(contents.graph), search_graph));
+    mwpms[0].small_syndrome_cache.precompute_boundary_distances(mwpms[0].flooder.graph);
+    mwpms[0].small_syndrome_cache.precompute_all_pairs_paths(mwpms[0].flooder.graph);
+    while (mwpms.size() < num_mwpms) {
+        mwpms.push_back(make_mwpm(mwpms[0].flooder.graph.clone_sharing_topology(), search_graph));
+        mwpms.back().small_syndrome_cache.boundary_distances = mwpms[0].small_syndrome_cache.boundary_distances;
+        mwpms.back().small_syndrome_cache.all_pairs_paths = mwpms[0].small_syndrome_cache.all_pairs_paths;
+    }
+    return mwpms;
+}
+
+pm::UserGraph pm::load_user_graph_from_graph_file(const std::string& path) {
+    auto contents = read_graph_file(path, false);
+    if (!(contents.flags & HAS_USER_GRAPH))
+        throw std::invalid_argument(
+            "The graph file '" + path + "' does not contain a user graph, since it was not saved from a UserGraph.");
+    auto& section = contents.user_graph;
+    pm::UserGraph user_graph(section.num_nodes, section.num_observables);
+    for (size_t k = 0; k < section.node1.size(); k++) {
+        std::vector<size_t> observables(
+            section.observables.begin() + section.observables_offsets[k],
+            section.observables.begin() + section.observables_offsets[k + 1]);
+        if (section.node2[k] == SIZE_MAX) {
+            user_graph.add_or_merge_boundary_edge(
+                section.node1[k], observables, section.weights[k], section.error_probabilities[k]);
+        } else {
+            user_graph.add_or_merge_edge(
+                section.node1[k], section.node2[k], observables, section.weights[k], section.error_probabilities[k]);
+        }
+    }
+    user_graph.set_boundary(std::set<size_t>(section.boundary_nodes.begin(), section.boundary_nodes.end()));
+    bool has_search_graph = contents.flags & HAS_SEARCH_GRAPH;
+    user_graph.set_mwpm(make_mwpm(std::move(contents.graph), has_search_graph ? &contents.search_graph : nullptr));
+    return user_graph;
+}
+
+pm::Mwpm pm::attach_mwpm_to_graph_file(const std::string& path) {
+    auto contents = read_graph_file(path, true);
+    bool has_search_graph = contents.flags & HAS_SEARCH_GRAPH;
+    return make_mwpm(std::move(contents.graph), has_search_graph ? &contents.search_graph : nullptr);
+}
+
+pm::UserGraph pm::attach_user_graph_to_graph_file(const std::string& path) {
+    return attach_user_graph(GraphFileMapping::map_file(path, true));
+}
+
+void pm::save_graph_to_shared_memory(const std::string& name, pm::UserGraph& user_graph) {
+#if !defined(_WIN32)
+    user_graph.check_edges_loaded();
+    std::vector<uint8_t> buffer;
+    GraphFileWriter writer(buffer);
+    write_graph_file(writer, user_graph.get_mwpm_with_search_graph(), &user_graph);
+    // A graph previously saved under the same name is unlinked rather than overwritten, so that the processes still
+    // attached to it are unaffected.
+    std::string object_name = shared_memory_object_name(name);
+    shm_unlink(object_name.c_str());
+    int fd = shm_open(object_name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd == -1)
+        throw std::invalid_argument("Failed to create the shared memory graph '" + name + "'.");
+    bool written = ftruncate(fd, (off_t)buffer.size()) == 0;
+    if (written) {
+        void* mapped = mmap(nullptr, buffer.size(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        written = mapped != MAP_FAILED;
+        if (written) {
+            memcpy(mapped, buffer.data(), buffer.size());
+            munmap(mapped, buffer.size());
+        }
+    }
+    close(fd);
+    if (!written) {
+        shm_unlink(object_name.c_str());
+        throw std::invalid_argument("Failed to write the shared memory graph '" + name + "'.");
+    }
+#else
+    throw std::invalid_argument("Graphs in shared memory are not supported on this platform.");
+#endif
+}
+
+pm::UserGraph pm::attach_user_graph_to_shared_memory(const std::string& name) {
+    return attach_user_graph(GraphFileMapping::map_shared_memory(name));
+}
+
+bool pm::remove_graph_from_shared_memory(const std::string& name) {
+#if !defined(_WIN32)
+    return shm_unlink(shared_memory_object_name(name).c_str()) == 0;
+#else
+    return false;
+#endif
+}
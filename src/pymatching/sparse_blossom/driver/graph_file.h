@@ -0,0 +1,92 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PYMATCHING2_GRAPH_FILE_H
+#define PYMATCHING2_GRAPH_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+#include "pymatching/sparse_blossom/matcher/mwpm.h"
+
+namespace pm {
+
+/// The version of the binary graph file format written by `save_graph_file'. Files written with any other version
+/// are rejected when loaded, rather than being misinterpreted.
+const uint32_t GRAPH_FILE_VERSION = 3;
+
+/// A graph file holds the decoding graphs of an Mwpm that has already been built: the compact matching graph (with
+/// the observable indices of its edges if there are too many observables for `obs_int'), the negative weight edges
+/// of the search graph (if present), which shares the topology of the matching graph, the normalising constant,
+/// the negative weight metadata and the boundary nodes of the UserGraph it was built from. Loading it skips parsing the detector error model, merging parallel edges and
+/// discretizing the weights, which dominate the startup time for large graphs.
+///
+/// The file starts with a fixed header (a magic string, the format version, a byte order mark and the sizes of
+/// `weight_int', `obs_int' and `node_index_int'), followed by the raw arrays of each section, each padded to a
+/// multiple of 8 bytes. The arrays are written in the native byte order and layout of the integer types, so that the
+/// file can be memory mapped and copied straight into place, or attached (see `attach_mwpm_to_graph_file'). A file is
+/// therefore only portable between builds with the same byte order and the same integer types; any mismatch is
+/// detected when the file is loaded.
+///
+/// Optionally, the file also holds the edges of the UserGraph itself, so that a UserGraph (and hence a
+/// `pymatching.Matching') can be restored without rebuilding its Mwpm.
+/// If the nodes of the graphs were relabeled when they were built (see `DemEdgeList::reorder_nodes'), the
+/// relabeling is saved too, so that the loaded Mwpm still takes detection events in the original node indices.
+
+/// Writes the graphs of `mwpm' to a graph file at `path'.
+void save_graph_file(const std::string& path, const Mwpm& mwpm);
+/// Writes the edges of `user_graph' and the graphs of its Mwpm, including its search graph (each of which is built
+/// first if necessary), to a graph file.
+void save_graph_file(const std::string& path, UserGraph& user_graph);
+
+/// Loads an Mwpm from a graph file written by `save_graph_file'. Throws std::invalid_argument if the file cannot
+/// be read, is not a graph file or was written by an incompatible build.
+Mwpm load_mwpm_from_graph_file(const std::string& path);
+/// Loads `num_mwpms' independent Mwpm objects from a graph file, for use by different threads. As with
+/// `detector_error_model_to_mwpms', they share a single copy of the matching graph topology.
+std::vector<Mwpm> load_mwpms_from_graph_file(const std::string& path, size_t num_mwpms);
+/// Loads a UserGraph from a graph file written by `save_graph_file' from a UserGraph. The Mwpm stored in the file
+/// is installed in the UserGraph, so it is not rebuilt until the graph is modified.
+UserGraph load_user_graph_from_graph_file(const std::string& path);
+
+/// Attaches an Mwpm to a graph file written by `save_graph_file', without loading it. The file is mapped into memory
+/// read-only and shared, and the packed arrays of the topology of the matching graph (see `MatchingGraphTopology')
+/// are views of the mapping, so every process attached to the same file reads a single copy of them in the page
+/// cache. Only the state of the decoder (the nodes, regions and queues of the flooders) and the small metadata
+/// arrays (the negative weight edges, the boundary nodes, the node relabeling and, for graphs with more observables
+/// than fit in an obs_int, the observable indices) are allocated by each process. The file is checked as when it is
+/// loaded, and must not be modified while attached: to update it, write a new file and rename it over the old one.
+Mwpm attach_mwpm_to_graph_file(const std::string& path);
+/// Attaches a UserGraph to a graph file written by `save_graph_file' from a UserGraph, sharing its Mwpm as
+/// `attach_mwpm_to_graph_file' does. The edges of the UserGraph are not loaded: the attached graph is frozen (see
+/// `UserGraph::freeze'), since it can only be used for decoding and for finding shortest paths, and its methods that
+/// read its edges throw std::invalid_argument (see `UserGraph::attach_mwpm').
+UserGraph attach_user_graph_to_graph_file(const std::string& path);
+/// Writes the edges of `user_graph' and the graphs of its Mwpm to the POSIX shared memory object `name' (prefixed
+/// with a slash if it doesn't start with one), in the format of a graph file, replacing any graph saved with the same
+/// name. The object stays in memory until it is removed with `remove_graph_from_shared_memory', even after every
+/// process using it has exited. Throws std::invalid_argument if shared memory is unavailable, as on Windows.
+void save_graph_to_shared_memory(const std::string& name, UserGraph& user_graph);
+/// Attaches a UserGraph to the graph saved in shared memory as `name', like `attach_user_graph_to_graph_file'.
+UserGraph attach_user_graph_to_shared_memory(const std::string& name);
+/// Removes the graph saved in shared memory as `name', returning false if there is none. Processes attached to it
+/// keep using it until they detach.
+bool remove_graph_from_shared_memory(const std::string& name);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_GRAPH_FILE_H
@@ -0,0 +1,370 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pymatching/sparse_blossom/driver/graph_file.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+#include "stim.h"
+
+// Defined in mwpm_decoding.test.cc
+std::string find_test_data_file(const char* name);
+
+namespace {
+
+std::string make_temp_graph_file_path() {
+    char path[] = "/tmp/pymatching_graph_file_XXXXXX";
+    int fd = mkstemp(path);
+    EXPECT_NE(fd, -1);
+    close(fd);
+    return path;
+}
+
+stim::DetectorErrorModel load_dem(const char* name) {
+    FILE* dem_file = fopen(find_test_data_file(name).c_str(), "r");
+    auto dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    return dem;
+}
+
+/// Checks that `actual' decodes the shots in `b8_name' exactly as `expected' does, both to observables and to edges.
+void assert_mwpms_decode_identically(pm::Mwpm& expected, pm::Mwpm& actual, const char* b8_name, size_t max_shots) {
+    ASSERT_EQ(expected.flooder.graph.num_observables, actual.flooder.graph.num_observables);
+    FILE* shots_in = fopen(find_test_data_file(b8_name).c_str(), "rb");
+    auto reader = stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(
+        shots_in, stim::SampleFormat::SAMPLE_FORMAT_B8, 0, expected.flooder.graph.num_nodes, 1);
+    stim::SparseShot shot;
+    size_t num_shots = 0;
+    while (num_shots < max_shots && reader->start_and_read_entire_record(shot)) {
+        pm::ExtendedMatchingResult res_expected(expected.flooder.graph.num_observables);
+        pm::ExtendedMatchingResult res_actual(actual.flooder.graph.num_observables);
+        pm::decode_detection_events(expected, shot.hits, res_expected.obs_crossed.data(), res_expected.weight);
+        pm::decode_detection_events(actual, shot.hits, res_actual.obs_crossed.data(), res_actual.weight);
+        ASSERT_EQ(res_expected.obs_crossed, res_actual.obs_crossed);
+        ASSERT_EQ(res_expected.weight, res_actual.weight);
+        if (!expected.search_flooder.graph.nodes.empty()) {
+            std::vector<int64_t> edges_expected, edges_actual;
+            pm::decode_detection_events_to_edges(expected, shot.hits, edges_expected);
+            pm::decode_detection_events_to_edges(actual, shot.hits, edges_actual);
+            ASSERT_EQ(edges_expected, edges_actual);
+        }
+        shot.clear();
+        num_shots++;
+    }
+    fclose(shots_in);
+    ASSERT_GT(num_shots, 0);
+}
+
+}  // namespace
+
+TEST(GraphFile, MwpmRoundTrip) {
+    auto dem = load_dem("surface_code_rotated_memory_x_13_0.01_prob_0.2_negative.dem");
+    for (bool include_search_graph : {false, true}) {
+        auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS, include_search_graph);
+        std::string path = make_temp_graph_file_path();
+        pm::save_graph_file(path, mwpm);
+        auto loaded = pm::load_mwpm_from_graph_file(path);
+        remove(path.c_str());
+
+        auto& g = mwpm.flooder.graph;
+        auto& h = loaded.flooder.graph;
+        ASSERT_EQ(h.num_nodes, g.num_nodes);
+        ASSERT_EQ(h.normalising_constant, g.normalising_constant);
+        ASSERT_EQ(h.negative_weight_sum, g.negative_weight_sum);
+        ASSERT_FALSE(g.negative_weight_detection_events_set.empty());
+        ASSERT_EQ(h.negative_weight_detection_events_set, g.negative_weight_detection_events_set);
+        ASSERT_EQ(h.negative_weight_observables_set, g.negative_weight_observables_set);
+        ASSERT_TRUE(h.topology->is_compact());
+        ASSERT_EQ(h.topology->offsets, g.topology->offsets);
+        ASSERT_EQ(h.topology->neighbors, g.topology->neighbors);
+        ASSERT_EQ(h.topology->neighbor_weights, g.topology->neighbor_weights);
+        ASSERT_EQ(h.topology->neighbor_observables, g.topology->neighbor_observables);
+        ASSERT_EQ(h.topology->observable_offsets, g.topology->observable_offsets);
+        ASSERT_EQ(h.topology->observable_indices, g.topology->observable_indices);
+        ASSERT_EQ(loaded.search_flooder.graph.nodes.size(), mwpm.search_flooder.graph.nodes.size());
+        if (include_search_graph) {
+            ASSERT_EQ(loaded.search_flooder.graph.topology, h.topology);
+        }
+        ASSERT_EQ(loaded.search_flooder.graph.negative_weight_edges, mwpm.search_flooder.graph.negative_weight_edges);
+        assert_mwpms_decode_identically(
+            mwpm, loaded, "surface_code_rotated_memory_x_13_0.01_prob_0.2_negative_1000_shots.b8", 200);
+    }
+}
+
+TEST(GraphFile, LoadMultipleMwpms) {
+    auto dem = load_dem("surface_code_rotated_memory_x_13_0.01.dem");
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS);
+    std::string path = make_temp_graph_file_path();
+    pm::save_graph_file(path, mwpm);
+    auto mwpms = pm::load_mwpms_from_graph_file(path, 3);
+    remove(path.c_str());
+    ASSERT_EQ(mwpms.size(), 3);
+    for (auto& replica : mwpms) {
+        ASSERT_EQ(replica.flooder.graph.topology, mwpms[0].flooder.graph.topology);
+        assert_mwpms_decode_identically(mwpm, replica, "surface_code_rotated_memory_x_13_0.01_1000_shots.b8", 100);
+    }
+}
+
+TEST(GraphFile, ReorderedMwpmRoundTrip) {
+    auto dem = load_dem("surface_code_rotated_memory_x_13_0.01_prob_0.2_negative.dem");
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS, true, true);
+    ASSERT_NE(mwpm.flooder.graph.node_relabeling, nullptr);
+    std::string path = make_temp_graph_file_path();
+    pm::save_graph_file(path, mwpm);
+    auto mwpms = pm::load_mwpms_from_graph_file(path, 2);
+    remove(path.c_str());
+    for (auto& loaded : mwpms) {
+        ASSERT_NE(loaded.flooder.graph.node_relabeling, nullptr);
+        ASSERT_EQ(
+            loaded.flooder.graph.node_relabeling->original_index, mwpm.flooder.graph.node_relabeling->original_index);
+        assert_mwpms_decode_identically(
+            mwpm, loaded, "surface_code_rotated_memory_x_13_0.01_prob_0.2_negative_1000_shots.b8", 100);
+    }
+}
+
+TEST(GraphFile, UserGraphRoundTrip) {
+    // More observables than fit in an obs_int, so that the search graph is needed, as well as a negative weight.
+    size_t num_observables = sizeof(pm::obs_int) * 8 + 2;
+    pm::UserGraph graph(6, num_observables);
+    graph.add_or_merge_boundary_edge(0, {0}, 2.5, 0.1);
+    graph.add_or_merge_edge(0, 1, {num_observables - 1}, 1.5, 0.2);
+    graph.add_or_merge_edge(1, 2, {}, -0.5, 0.6);
+    graph.add_or_merge_edge(2, 3, {3, 4}, 2, -1);
+    graph.add_or_merge_edge(3, 4, {}, 1, 0.3);
+    graph.add_or_merge_edge(4, 5, {1}, 3.25, 0.05);
+    graph.set_boundary({5});
+    std::string path = make_temp_graph_file_path();
+    pm::save_graph_file(path, graph);
+    auto loaded = pm::load_user_graph_from_graph_file(path);
+    remove(path.c_str());
+
+    ASSERT_EQ(loaded.get_num_nodes(), graph.get_num_nodes());
+    ASSERT_EQ(loaded.get_num_observables(), graph.get_num_observables());
+    ASSERT_EQ(loaded.get_boundary(), graph.get_boundary());
+    ASSERT_EQ(loaded.all_edges_have_error_probabilities(), graph.all_edges_have_error_probabilities());
+    ASSERT_EQ(loaded.edges.size(), graph.edges.size());
+    for (auto it = loaded.edges.begin(), jt = graph.edges.begin(); it != loaded.edges.end(); ++it, ++jt) {
+        ASSERT_EQ(it->node1, jt->node1);
+        ASSERT_EQ(it->node2, jt->node2);
+        ASSERT_EQ(it->observable_indices, jt->observable_indices);
+        ASSERT_EQ(it->weight, jt->weight);
+        ASSERT_EQ(it->error_probability, jt->error_probability);
+    }
+
+    auto& expected = graph.get_mwpm();
+    auto& actual = loaded.get_mwpm();
+    ASSERT_EQ(actual.search_flooder.graph.nodes.size(), 6);
+    for (std::vector<uint64_t> dets : std::vector<std::vector<uint64_t>>{{0}, {1, 3}, {0, 4}, {2}, {0, 1, 2, 4}}) {
+        pm::ExtendedMatchingResult res_expected(num_observables);
+        pm::ExtendedMatchingResult res_actual(num_observables);
+        pm::decode_detection_events(expected, dets, res_expected.obs_crossed.data(), res_expected.weight);
+        pm::decode_detection_events(actual, dets, res_actual.obs_crossed.data(), res_actual.weight);
+        ASSERT_EQ(res_expected.obs_crossed, res_actual.obs_crossed);
+        ASSERT_EQ(res_expected.weight, res_actual.weight);
+    }
+    // Detection events on a boundary node of the UserGraph are still ignored by the loaded graph.
+    ASSERT_EQ(actual.flooder.graph.is_user_graph_boundary_node, expected.flooder.graph.is_user_graph_boundary_node);
+    pm::ExtendedMatchingResult res_with_boundary(num_observables);
+    pm::ExtendedMatchingResult res_without_boundary(num_observables);
+    pm::decode_detection_events(actual, {0, 5}, res_with_boundary.obs_crossed.data(), res_with_boundary.weight);
+    pm::decode_detection_events(actual, {0}, res_without_boundary.obs_crossed.data(), res_without_boundary.weight);
+    ASSERT_EQ(res_with_boundary.obs_crossed, res_without_boundary.obs_crossed);
+    ASSERT_EQ(res_with_boundary.weight, res_without_boundary.weight);
+
+    // The loaded graph can still be modified, after which its Mwpm is rebuilt.
+    loaded.update_edge(3, 4, {}, 10, 0.3);
+    graph.update_edge(3, 4, {}, 10, 0.3);
+    pm::ExtendedMatchingResult res_expected(num_observables);
+    pm::ExtendedMatchingResult res_actual(num_observables);
+    pm::decode_detection_events(graph.get_mwpm(), {3, 4}, res_expected.obs_crossed.data(), res_expected.weight);
+    pm::decode_detection_events(loaded.get_mwpm(), {3, 4}, res_actual.obs_crossed.data(), res_actual.weight);
+    ASSERT_EQ(res_expected.obs_crossed, res_actual.obs_crossed);
+    ASSERT_EQ(res_expected.weight, res_actual.weight);
+}
+
+TEST(GraphFile, AttachMwpmSharesTopology) {
+    auto dem = load_dem("surface_code_rotated_memory_x_13_0.01_prob_0.2_negative.dem");
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS, true);
+    std::string path = make_temp_graph_file_path();
+    pm::save_graph_file(path, mwpm);
+    auto attached = pm::attach_mwpm_to_graph_file(path);
+    auto loaded = pm::load_mwpm_from_graph_file(path);
+    auto& topology = *attached.flooder.graph.topology;
+    ASSERT_TRUE(topology.offsets.is_view());
+    ASSERT_TRUE(topology.neighbors.is_view());
+    ASSERT_TRUE(topology.neighbor_weights.is_view());
+    ASSERT_TRUE(topology.neighbor_observables.is_view());
+    ASSERT_TRUE(topology.component_of_node.is_view());
+    ASSERT_FALSE(loaded.flooder.graph.topology->neighbors.is_view());
+    ASSERT_EQ(topology.neighbors, mwpm.flooder.graph.topology->neighbors);
+    ASSERT_EQ(topology.component_of_node, mwpm.flooder.graph.topology->component_of_node);
+    ASSERT_EQ(attached.search_flooder.graph.topology, attached.flooder.graph.topology);
+    // The file can be removed while attached, since the mapping keeps it alive.
+    remove(path.c_str());
+    assert_mwpms_decode_identically(
+        mwpm, attached, "surface_code_rotated_memory_x_13_0.01_prob_0.2_negative_1000_shots.b8", 200);
+}
+
+TEST(GraphFile, AttachUserGraph) {
+    size_t num_observables = sizeof(pm::obs_int) * 8 + 2;
+    pm::UserGraph graph(6, num_observables);
+    graph.add_or_merge_boundary_edge(0, {0}, 2.5, 0.1);
+    graph.add_or_merge_edge(0, 1, {num_observables - 1}, 1.5, 0.2);
+    graph.add_or_merge_edge(1, 2, {}, -0.5, 0.6);
+    graph.add_or_merge_edge(2, 3, {3, 4}, 2, 0.1);
+    graph.add_or_merge_edge(3, 4, {}, 1, 0.3);
+    graph.add_or_merge_edge(4, 5, {1}, 3.25, 0.05);
+    graph.set_boundary({5});
+    std::string path = make_temp_graph_file_path();
+    pm::save_graph_file(path, graph);
+    std::string shm_name = "pymatching_test_graph_" + std::to_string(getpid());
+    pm::save_graph_to_shared_memory(shm_name, graph);
+    std::vector<pm::UserGraph> attached_graphs;
+    attached_graphs.push_back(pm::attach_user_graph_to_graph_file(path));
+    attached_graphs.push_back(pm::attach_user_graph_to_shared_memory(shm_name));
+    remove(path.c_str());
+    ASSERT_TRUE(pm::remove_graph_from_shared_memory(shm_name));
+    ASSERT_FALSE(pm::remove_graph_from_shared_memory(shm_name));
+    ASSERT_THROW(pm::attach_user_graph_to_shared_memory(shm_name), std::invalid_argument);
+
+    for (auto& attached : attached_graphs) {
+        ASSERT_TRUE(attached.is_attached());
+        ASSERT_TRUE(attached.is_frozen());
+        ASSERT_EQ(attached.get_num_nodes(), graph.get_num_nodes());
+        ASSERT_EQ(attached.get_num_observables(), graph.get_num_observables());
+        ASSERT_EQ(attached.get_boundary(), graph.get_boundary());
+        ASSERT_EQ(attached.get_num_edges(), graph.get_num_edges());
+        ASSERT_TRUE(attached.edges.empty());
+        ASSERT_THROW(attached.has_edge(0, 1), std::invalid_argument);
+        ASSERT_THROW(attached.all_edges_have_error_probabilities(), std::invalid_argument);
+        ASSERT_THROW(attached.add_or_merge_edge(0, 2, {}, 1, 0.1), std::invalid_argument);
+        ASSERT_THROW(pm::save_graph_file(path, attached), std::invalid_argument);
+        auto lease = attached.acquire_mwpm();
+        ASSERT_TRUE(lease->flooder.graph.topology->neighbors.is_view());
+        for (std::vector<uint64_t> dets :
+             std::vector<std::vector<uint64_t>>{{0}, {1, 3}, {0, 4}, {2}, {0, 1, 2, 4}, {0, 5}}) {
+            pm::ExtendedMatchingResult res_expected(num_observables);
+            pm::ExtendedMatchingResult res_actual(num_observables);
+            pm::decode_detection_events(graph.get_mwpm(), dets, res_expected.obs_crossed.data(), res_expected.weight);
+            pm::decode_detection_events(*lease, dets, res_actual.obs_crossed.data(), res_actual.weight);
+            ASSERT_EQ(res_expected.obs_crossed, res_actual.obs_crossed);
+            ASSERT_EQ(res_expected.weight, res_actual.weight);
+        }
+    }
+}
+
+TEST(GraphFile, RejectsInvalidFiles) {
+    ASSERT_THROW(
+        pm::load_mwpm_from_graph_file("/tmp/pymatching_graph_file_that_does_not_exist"), std::invalid_argument);
+
+    auto dem = load_dem("surface_code_rotated_memory_x_13_0.01.dem");
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS);
+    std::string path = make_temp_graph_file_path();
+    pm::save_graph_file(path, mwpm);
+    std::vector<char> bytes;
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        int c;
+        while ((c = fgetc(f)) != EOF)
+            bytes.push_back((char)c);
+        fclose(f);
+    }
+    auto write_bytes = [&](const std::vector<char>& data) {
+        FILE* f = fopen(path.c_str(), "wb");
+        fwrite(data.data(), 1, data.size(), f);
+        fclose(f);
+    };
+
+    // Not saved from a UserGraph.
+    ASSERT_THROW(pm::load_user_graph_from_graph_file(path), std::invalid_argument);
+
+    // Truncated.
+    write_bytes(std::vector<char>(bytes.begin(), bytes.begin() + bytes.size() / 2));
+    ASSERT_THROW(pm::load_mwpm_from_graph_file(path), std::invalid_argument);
+
+    // Wrong magic string.
+    auto corrupted = bytes;
+    corrupted[0] = 'X';
+    write_bytes(corrupted);
+    ASSERT_THROW(pm::load_mwpm_from_graph_file(path), std::invalid_argument);
+
+    // Unsupported version.
+    corrupted = bytes;
+    corrupted[8] = (char)(pm::GRAPH_FILE_VERSION + 1);
+    write_bytes(corrupted);
+    ASSERT_THROW(pm::load_mwpm_from_graph_file(path), std::invalid_argument);
+
+    write_bytes(bytes);
+    ASSERT_EQ(pm::load_mwpm_from_graph_file(path).flooder.graph.num_nodes, mwpm.flooder.graph.num_nodes);
+    remove(path.c_str());
+}
+
+TEST(GraphFile, RejectsOutOfRangeNegativeWeightIndices) {
+    // A graph with a negative edge weight, so that its file lists negative weight detection events and observables.
+    pm::UserGraph user_graph(3, 2);
+    user_graph.add_or_merge_boundary_edge(0, {}, 2.0, 0.1);
+    user_graph.add_or_merge_edge(0, 1, {1}, -1.0, 0.7);
+    user_graph.add_or_merge_edge(1, 2, {}, 2.0, 0.1);
+    user_graph.add_or_merge_boundary_edge(2, {}, 2.0, 0.1);
+    auto& mwpm = user_graph.get_mwpm();
+    auto& graph = mwpm.flooder.graph;
+    ASSERT_EQ(graph.negative_weight_detection_events_set.size(), 2);
+    ASSERT_EQ(graph.negative_weight_observables_set.size(), 1);
+    std::string path = make_temp_graph_file_path();
+    pm::save_graph_file(path, mwpm);
+    std::vector<char> bytes;
+    {
+        FILE* f = fopen(path.c_str(), "rb");
+        int c;
+        while ((c = fgetc(f)) != EOF)
+            bytes.push_back((char)c);
+        fclose(f);
+    }
+    auto load_corrupted = [&](size_t offset, uint64_t value) {
+        auto corrupted = bytes;
+        memcpy(corrupted.data() + offset, &value, sizeof(value));
+        FILE* f = fopen(path.c_str(), "wb");
+        fwrite(corrupted.data(), 1, corrupted.size(), f);
+        fclose(f);
+        return pm::load_mwpm_from_graph_file(path);
+    };
+
+    // Without a search graph, user graph or relabeling, the file ends with the two negative weight detection
+    // events, the negative weight observable, and the boundary flags (padded to a multiple of 8 bytes).
+    size_t flags_bytes = (graph.is_user_graph_boundary_node.size() + 7) / 8 * 8;
+    size_t observable_offset = bytes.size() - flags_bytes - 8;
+    size_t detection_event_offset = observable_offset - 8;
+    ASSERT_THROW(load_corrupted(detection_event_offset, 3), std::invalid_argument);
+    ASSERT_THROW(load_corrupted(observable_offset, 2), std::invalid_argument);
+
+    // A corrupted count is reported as a truncated file rather than allocating a huge array. The counts follow
+    // the number of nodes and observables, the normalising constant, the negative weight sum and the number of
+    // edge ends.
+    uint64_t header[2] = {3, 2};
+    auto it = std::search(bytes.begin(), bytes.end(), (const char*)header, (const char*)header + sizeof(header));
+    ASSERT_NE(it, bytes.end());
+    size_t num_detection_events_offset = (it - bytes.begin()) + 5 * sizeof(uint64_t);
+    ASSERT_THROW(load_corrupted(num_detection_events_offset, UINT64_MAX / 16), std::invalid_argument);
+
+    ASSERT_EQ(load_corrupted(detection_event_offset, 0).flooder.graph.num_nodes, 3);
+    remove(path.c_str());
+}
@@ -0,0 +1,277 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/incremental_decoding.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr pm::total_weight_int UNREACHABLE = pm::BoundaryDistances::UNREACHABLE;
+
+}  // namespace
+
+pm::IncrementalDecoder::IncrementalDecoder(Mwpm& mwpm)
+    : mwpm(mwpm), max_boundary_distance(0), num_active_clusters(0), last_num_resolved(0) {
+    auto& graph = mwpm.flooder.graph;
+    if (graph.num_observables > sizeof(pm::obs_int) * 8)
+        throw std::invalid_argument(
+            "Incremental decoding is only supported for graphs with at most " +
+            std::to_string(sizeof(pm::obs_int) * 8) + " observables.");
+    if (mwpm.flooder.negative_weight_sum != 0 || !mwpm.flooder.negative_weight_detection_events.empty())
+        throw std::invalid_argument("Incremental decoding is not supported for graphs with negative edge weights.");
+    mwpm.small_syndrome_cache.precompute_boundary_distances(graph);
+    boundary_distances = mwpm.small_syndrome_cache.boundary_distances;
+    // A node that can reach the boundary is only connected to nodes that can too, so the nodes that can't are left
+    // out of the bound.
+    for (auto d : boundary_distances->distances)
+        if (d != UNREACHABLE)
+            max_boundary_distance = std::max(max_boundary_distance, d);
+
+    size_t num_nodes = graph.nodes.size();
+    is_detection_event.assign(num_nodes, 0);
+    links.resize(num_nodes);
+    cluster_of_node.assign(num_nodes, SIZE_MAX);
+    is_pending.assign(num_nodes, 0);
+    is_in_new_syndrome.assign(num_nodes, 0);
+    distances.assign(num_nodes, UNREACHABLE);
+}
+
+size_t pm::IncrementalDecoder::node_of_detector(uint64_t detector) {
+    auto& graph = mwpm.flooder.graph;
+    if (detector >= graph.nodes.size())
+        throw std::invalid_argument(
+            "Detection event index `" + std::to_string(detector) + "` is larger than the number of nodes in the graph.");
+    size_t node = graph.node_relabeling ? graph.node_relabeling->graph_index[detector] : detector;
+    if (node < graph.is_user_graph_boundary_node.size() && graph.is_user_graph_boundary_node[node])
+        return SIZE_MAX;
+    return node;
+}
+
+void pm::IncrementalDecoder::dissolve_cluster(size_t cluster_index) {
+    auto& cluster = clusters[cluster_index];
+    cluster.active = false;
+    total.obs_mask ^= cluster.result.obs_mask;
+    total.weight -= cluster.result.weight;
+    num_active_clusters--;
+    free_clusters.push_back(cluster_index);
+    for (size_t node : cluster.nodes) {
+        cluster_of_node[node] = SIZE_MAX;
+        mark_pending(node);
+    }
+    cluster.nodes.clear();
+}
+
+void pm::IncrementalDecoder::mark_pending(size_t node) {
+    if (is_pending[node])
+        return;
+    is_pending[node] = 1;
+    pending_nodes.push_back(node);
+    if (cluster_of_node[node] != SIZE_MAX)
+        dissolve_cluster(cluster_of_node[node]);
+}
+
+void pm::IncrementalDecoder::add_detection_event(size_t node) {
+    auto& graph = mwpm.flooder.graph;
+    const auto& boundary = boundary_distances->distances;
+    is_detection_event[node] = 1;
+    mark_pending(node);
+
+    // A detection event v can only be linked to `node' if d(node, v) < b(node) + b(v) <= b(node) + max b.
+    total_weight_int max_distance = UNREACHABLE;
+    if (boundary[node] != UNREACHABLE)
+        max_distance = boundary[node] + max_boundary_distance;
+
+    const DetectorNode* first_node = graph.nodes.data();
+    auto later = std::greater<std::pair<total_weight_int, size_t>>();
+    distances[node] = 0;
+    touched_nodes.push_back(node);
+    heap.emplace_back(0, node);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto [dist, node_index] = heap.back();
+        heap.pop_back();
+        if (dist != distances[node_index])
+            continue;
+        if (node_index != node && is_detection_event[node_index] &&
+            (boundary[node] == UNREACHABLE || boundary[node_index] == UNREACHABLE ||
+             dist < boundary[node] + boundary[node_index])) {
+            links[node].push_back(node_index);
+            links[node_index].push_back(node);
+            mark_pending(node_index);
+        }
+        const DetectorNode& detector_node = graph.nodes[node_index];
+        for (size_t i = 0; i < detector_node.neighbors.size(); i++) {
+            const DetectorNode* neighbor = detector_node.neighbors[i];
+            if (neighbor == nullptr)
+                continue;
+            total_weight_int neighbor_dist = dist + detector_node.neighbor_weights[i];
+            if (neighbor_dist >= max_distance)
+                continue;
+            size_t neighbor_index = neighbor - first_node;
+            if (neighbor_dist < distances[neighbor_index]) {
+                if (distances[neighbor_index] == UNREACHABLE)
+                    touched_nodes.push_back(neighbor_index);
+                distances[neighbor_index] = neighbor_dist;
+                heap.emplace_back(neighbor_dist, neighbor_index);
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+    }
+    for (size_t node_index : touched_nodes)
+        distances[node_index] = UNREACHABLE;
+    touched_nodes.clear();
+    heap.clear();
+}
+
+void pm::IncrementalDecoder::remove_detection_event(size_t node) {
+    // Removing the detection event may split its cluster, so all of it is re-clustered.
+    mark_pending(node);
+    is_detection_event[node] = 0;
+    for (size_t linked_node : links[node]) {
+        auto& linked_links = links[linked_node];
+        linked_links.erase(std::find(linked_links.begin(), linked_links.end(), node));
+    }
+    links[node].clear();
+}
+
+void pm::IncrementalDecoder::resolve_pending() {
+    last_num_resolved = 0;
+    // Every detection event linked to a pending detection event is itself pending, since adding a link or dissolving
+    // a cluster marks the detection events involved as pending.
+    for (size_t p = 0; p < pending_nodes.size(); p++) {
+        size_t start = pending_nodes[p];
+        if (!is_detection_event[start] || cluster_of_node[start] != SIZE_MAX)
+            continue;
+        size_t cluster_index;
+        if (free_clusters.empty()) {
+            cluster_index = clusters.size();
+            clusters.emplace_back();
+        } else {
+            cluster_index = free_clusters.back();
+            free_clusters.pop_back();
+        }
+        auto& cluster = clusters[cluster_index];
+        cluster.nodes.push_back(start);
+        cluster_of_node[start] = cluster_index;
+        for (size_t k = 0; k < cluster.nodes.size(); k++) {
+            for (size_t linked_node : links[cluster.nodes[k]]) {
+                if (cluster_of_node[linked_node] == SIZE_MAX) {
+                    cluster_of_node[linked_node] = cluster_index;
+                    cluster.nodes.push_back(linked_node);
+                }
+            }
+        }
+
+        cluster_detection_events.clear();
+        for (size_t node : cluster.nodes)
+            cluster_detection_events.push_back(mwpm.flooder.graph.original_node_index(node));
+        std::sort(cluster_detection_events.begin(), cluster_detection_events.end());
+        cluster.result = pm::decode_detection_events_for_up_to_64_observables(mwpm, cluster_detection_events);
+        cluster.active = true;
+        num_active_clusters++;
+        total.obs_mask ^= cluster.result.obs_mask;
+        total.weight += cluster.result.weight;
+        last_num_resolved += cluster.nodes.size();
+    }
+    for (size_t node : pending_nodes)
+        is_pending[node] = 0;
+    pending_nodes.clear();
+}
+
+pm::MatchingResult pm::IncrementalDecoder::flip_detectors(const std::vector<uint64_t>& flipped_detectors) {
+    try {
+        for (auto detector : flipped_detectors) {
+            size_t node = node_of_detector(detector);
+            if (node == SIZE_MAX)
+                continue;
+            if (is_detection_event[node]) {
+                remove_detection_event(node);
+            } else {
+                add_detection_event(node);
+            }
+        }
+        resolve_pending();
+    } catch (...) {
+        reset();
+        throw;
+    }
+    return total;
+}
+
+pm::MatchingResult pm::IncrementalDecoder::decode(const std::vector<uint64_t>& new_detection_events) {
+    // The detectors to flip are those in one syndrome but not the other. Every current detection event is in a
+    // cluster, so they are found without scanning the whole graph.
+    flips.clear();
+    for (auto detector : new_detection_events) {
+        size_t node = node_of_detector(detector);
+        if (node == SIZE_MAX || is_in_new_syndrome[node])
+            continue;
+        is_in_new_syndrome[node] = 1;
+        if (!is_detection_event[node])
+            flips.push_back(detector);
+    }
+    for (auto& cluster : clusters) {
+        for (size_t node : cluster.nodes) {
+            if (!is_in_new_syndrome[node])
+                flips.push_back(mwpm.flooder.graph.original_node_index(node));
+        }
+    }
+    for (auto detector : new_detection_events) {
+        size_t node = node_of_detector(detector);
+        if (node != SIZE_MAX)
+            is_in_new_syndrome[node] = 0;
+    }
+    return flip_detectors(flips);
+}
+
+void pm::IncrementalDecoder::reset() {
+    for (size_t node = 0; node < is_detection_event.size(); node++) {
+        is_detection_event[node] = 0;
+        links[node].clear();
+        cluster_of_node[node] = SIZE_MAX;
+        is_pending[node] = 0;
+    }
+    clusters.clear();
+    free_clusters.clear();
+    pending_nodes.clear();
+    num_active_clusters = 0;
+    total = MatchingResult();
+    last_num_resolved = 0;
+}
+
+pm::MatchingResult pm::IncrementalDecoder::result() const {
+    return total;
+}
+
+std::vector<uint64_t> pm::IncrementalDecoder::detection_events() const {
+    std::vector<uint64_t> events;
+    for (auto& cluster : clusters) {
+        for (size_t node : cluster.nodes)
+            events.push_back(mwpm.flooder.graph.original_node_index(node));
+    }
+    std::sort(events.begin(), events.end());
+    return events;
+}
+
+size_t pm::IncrementalDecoder::num_clusters() const {
+    return num_active_clusters;
+}
+
+size_t pm::IncrementalDecoder::num_detection_events_resolved() const {
+    return last_num_resolved;
+}
@@ -0,0 +1,115 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_INCREMENTAL_DECODING_H
+#define PYMATCHING2_INCREMENTAL_DECODING_H
+
+#include <memory>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+
+namespace pm {
+
+/// Decodes a sequence of syndromes that each differ from the previous one by only a few detection events, such as
+/// consecutive windows of a streaming experiment, by only re-solving the parts of the matching affected by the change.
+///
+/// The detection events are grouped into clusters: two detection events u and v are linked if d(u, v) < b(u) + b(v),
+/// where d is the distance between them and b(u) the distance from u to the boundary, and a cluster is a connected
+/// component of these links. A minimum-weight matching never needs to match two detection events that aren't linked
+/// (matching both to the boundary instead is no heavier), so each cluster is matched independently, and the solution
+/// is the sum of the solutions of the clusters. When detection events are added or removed, only the clusters
+/// containing or linked to them are re-clustered and decoded again with the Mwpm, while the solutions of the other
+/// clusters are kept. The weight of the solution is always that of a minimum-weight matching, but when several
+/// matchings have the same weight, the predicted observables may differ from those of decoding the whole syndrome.
+///
+/// Only graphs without negative edge weights, and with at most 64 (=sizeof(pm::obs_int)*8) observables, are
+/// supported. Detection events that cannot reach the boundary are linked to every detection event connected to them.
+class IncrementalDecoder {
+   public:
+    /// Decodes using `mwpm', which must outlive the decoder. The Mwpm may be used for other decoding in between calls,
+    /// but the graph must not be modified while the decoder is in use. Throws std::invalid_argument if the graph is
+    /// not supported.
+    explicit IncrementalDecoder(Mwpm& mwpm);
+
+    /// Flips the detectors `flipped_detectors' (adding those that aren't detection events of the current syndrome,
+    /// and removing those that are), and returns the solution for the new syndrome. A detector flipped twice is left
+    /// unchanged. If a cluster can't be matched, std::invalid_argument is thrown and the syndrome is reset to empty.
+    MatchingResult flip_detectors(const std::vector<uint64_t>& flipped_detectors);
+    /// Returns the solution for the syndrome with detection events `detection_events', by flipping the detectors
+    /// that differ from the current syndrome.
+    MatchingResult decode(const std::vector<uint64_t>& detection_events);
+    /// Forgets the current syndrome, as if it had no detection events.
+    void reset();
+
+    /// The solution for the current syndrome.
+    MatchingResult result() const;
+    /// The detection events of the current syndrome, in increasing order.
+    std::vector<uint64_t> detection_events() const;
+    size_t num_clusters() const;
+    /// The number of detection events in the clusters decoded by the most recent call to `flip_detectors'.
+    size_t num_detection_events_resolved() const;
+
+   private:
+    struct Cluster {
+        /// The (graph) node indices of the detection events of the cluster.
+        std::vector<size_t> nodes;
+        MatchingResult result;
+        bool active = false;
+    };
+
+    Mwpm& mwpm;
+    std::shared_ptr<const BoundaryDistances> boundary_distances;
+    /// The largest boundary distance of any node that can reach the boundary, which bounds the distance at which a
+    /// detection event that can reach the boundary can be linked.
+    total_weight_int max_boundary_distance;
+
+    /// Indexed by graph node: whether the node is a detection event, the detection events it is linked to, and the
+    /// cluster it belongs to (or SIZE_MAX).
+    std::vector<uint8_t> is_detection_event;
+    std::vector<std::vector<size_t>> links;
+    std::vector<size_t> cluster_of_node;
+    std::vector<Cluster> clusters;
+    std::vector<size_t> free_clusters;
+    size_t num_active_clusters;
+    MatchingResult total;
+    size_t last_num_resolved;
+
+    /// Scratch space, kept between calls to avoid reallocating it.
+    std::vector<uint8_t> is_pending;
+    std::vector<uint8_t> is_in_new_syndrome;
+    std::vector<size_t> pending_nodes;
+    std::vector<uint64_t> cluster_detection_events;
+    std::vector<uint64_t> flips;
+    std::vector<total_weight_int> distances;
+    std::vector<size_t> touched_nodes;
+    std::vector<std::pair<total_weight_int, size_t>> heap;
+
+    /// Returns the graph node index of detector `detector', or SIZE_MAX if it is a boundary node.
+    size_t node_of_detector(uint64_t detector);
+    /// Adds the detection event at `node', linking it to the detection events within reach, and marking their
+    /// clusters as pending.
+    void add_detection_event(size_t node);
+    void remove_detection_event(size_t node);
+    /// Marks `node' as needing to be re-clustered, dissolving its cluster (and the clusters of the detection events
+    /// linked to it) if it was in one.
+    void mark_pending(size_t node);
+    void dissolve_cluster(size_t cluster_index);
+    /// Re-clusters and decodes the pending detection events.
+    void resolve_pending();
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_INCREMENTAL_DECODING_H
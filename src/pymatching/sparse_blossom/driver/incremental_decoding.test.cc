@@ -0,0 +1,97 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/incremental_decoding.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+
+TEST(IncrementalDecoder, MatchesDecodingWholeSyndromes) {
+    std::mt19937 rng(7);
+    auto graph = pm::grid_graph(6, 100, rng);
+    auto& mwpm = graph.get_mwpm();
+    size_t num_nodes = graph.get_num_nodes();
+    pm::IncrementalDecoder decoder(mwpm);
+
+    std::vector<uint8_t> syndrome(num_nodes, 0);
+    size_t num_resolved = 0, num_events = 0;
+    std::vector<uint64_t> current_events;
+    for (size_t step = 0; step < 300; step++) {
+        // Flip a random detector, and remove a random detection event once there are enough of them, sometimes
+        // flipping the same detector twice.
+        std::vector<uint64_t> flips{rng() % num_nodes};
+        if (current_events.size() > 8)
+            flips.push_back(current_events[rng() % current_events.size()]);
+        if (step % 10 == 0)
+            flips.push_back(flips[0]);
+        for (auto f : flips)
+            syndrome[f] ^= 1;
+        std::vector<uint64_t> detection_events;
+        for (size_t i = 0; i < num_nodes; i++)
+            if (syndrome[i])
+                detection_events.push_back(i);
+
+        auto res = step % 2 ? decoder.flip_detectors(flips) : decoder.decode(detection_events);
+        ASSERT_EQ(res, pm::decode_detection_events_for_up_to_64_observables(mwpm, detection_events));
+        ASSERT_EQ(decoder.result(), res);
+        ASSERT_EQ(decoder.detection_events(), detection_events);
+        num_resolved += decoder.num_detection_events_resolved();
+        num_events += detection_events.size();
+        current_events = detection_events;
+    }
+    // Most detection events are in clusters that the flips didn't touch.
+    ASSERT_LT(num_resolved, num_events / 2);
+    ASSERT_GT(decoder.num_clusters(), 1);
+
+    decoder.reset();
+    ASSERT_EQ(decoder.result(), pm::MatchingResult());
+    ASSERT_EQ(decoder.num_clusters(), 0);
+    ASSERT_EQ(decoder.decode({5, 6}), pm::decode_detection_events_for_up_to_64_observables(mwpm, {5, 6}));
+    ASSERT_THROW(decoder.flip_detectors({num_nodes}), std::invalid_argument);
+    ASSERT_TRUE(decoder.detection_events().empty());
+}
+
+TEST(IncrementalDecoder, WithoutBoundary) {
+    pm::UserGraph graph;
+    graph.add_or_merge_edge(0, 1, {0}, 1.0, -1);
+    graph.add_or_merge_edge(1, 2, {1}, 1.0, -1);
+    graph.add_or_merge_edge(3, 4, {1}, 1.0, -1);
+    pm::IncrementalDecoder decoder(graph.get_mwpm());
+    // Detection events that can't reach the boundary are clustered with every connected detection event.
+    decoder.flip_detectors({0, 2, 3, 4});
+    ASSERT_EQ(decoder.num_clusters(), 2);
+    ASSERT_EQ(decoder.result().obs_mask, 0b01);
+    ASSERT_THROW(decoder.flip_detectors({2}), std::invalid_argument);
+    ASSERT_EQ(decoder.num_clusters(), 0);
+
+    // A graph with a component that can reach the boundary and one that can't.
+    std::mt19937 rng(2);
+    auto mixed_graph = pm::grid_graph(4, 10, rng);
+    mixed_graph.add_or_merge_edge(40, 41, {0}, 1.0, -1);
+    mixed_graph.add_or_merge_edge(41, 42, {1}, 2.0, -1);
+    pm::IncrementalDecoder mixed_decoder(mixed_graph.get_mwpm());
+    std::vector<uint64_t> detection_events{1, 17, 18, 35, 40, 42};
+    ASSERT_EQ(
+        mixed_decoder.decode(detection_events),
+        pm::decode_detection_events_for_up_to_64_observables(mixed_graph.get_mwpm(), detection_events));
+    ASSERT_EQ(mixed_decoder.num_clusters(), 4);
+
+    pm::UserGraph negative_graph;
+    negative_graph.add_or_merge_edge(0, 1, {0}, -1.0, -1);
+    ASSERT_THROW(pm::IncrementalDecoder(negative_graph.get_mwpm()), std::invalid_argument);
+}
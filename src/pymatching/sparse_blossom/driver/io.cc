@@ -15,8 +15,11 @@
 #include "pymatching/sparse_blossom/driver/io.h"
 
 #include <algorithm>
+#include <exception>
+#include <thread>
 #include <utility>
 
+#include "pymatching/sparse_blossom/driver/node_ordering.h"
 #include "pymatching/sparse_blossom/flooder/graph.h"
 
 double pm::merge_weights(double a, double b) {
@@ -102,33 +105,28 @@ pm::MatchingGraph pm::IntermediateWeightedGraph::to_matching_graph(pm::weight_in
             matching_graph.add_boundary_edge(u, weight, observables);
         });
     matching_graph.normalising_constant = normalising_constant;
+    matching_graph.compact_topology();
     return matching_graph;
 }
 
-pm::SearchGraph pm::IntermediateWeightedGraph::to_search_graph(pm::weight_int num_distinct_weights) {
-    /// Identical to pm::IntermediateWeightedGraph::to_matching_graph but for constructing a pm::SearchGraph
-    pm::SearchGraph search_graph(nodes.size());
-    iter_discretized_edges(
-        num_distinct_weights,
-        [&](size_t u, size_t v, pm::signed_weight_int weight, const std::vector<size_t>& observables) {
-            search_graph.add_edge(u, v, weight, observables);
-        },
-        [&](size_t u, pm::signed_weight_int weight, const std::vector<size_t>& observables) {
-            search_graph.add_boundary_edge(u, weight, observables);
+pm::SearchGraph pm::IntermediateWeightedGraph::to_search_graph(
+    const pm::MatchingGraph& matching_graph, pm::weight_int num_distinct_weights) {
+    return pm::search_graph_sharing_edges(
+        matching_graph, [&](const auto& handle_edge, const auto& handle_boundary_edge) {
+            iter_discretized_edges(num_distinct_weights, handle_edge, handle_boundary_edge);
         });
-    return search_graph;
 }
 
 pm::Mwpm pm::IntermediateWeightedGraph::to_mwpm(
     pm::weight_int num_distinct_weights, bool ensure_search_flooder_included) {
+    auto matching_graph = to_matching_graph(num_distinct_weights);
     if (num_observables > sizeof(pm::obs_int) * 8 || ensure_search_flooder_included) {
-        auto mwpm = pm::Mwpm(
-            pm::GraphFlooder(to_matching_graph(num_distinct_weights)),
-            pm::SearchFlooder(to_search_graph(num_distinct_weights)));
+        auto search_graph = to_search_graph(matching_graph, num_distinct_weights);
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(matching_graph)), pm::SearchFlooder(std::move(search_graph)));
         mwpm.flooder.sync_negative_weight_observables_and_detection_events();
         return mwpm;
     } else {
-        auto mwpm = pm::Mwpm(pm::GraphFlooder(to_matching_graph(num_distinct_weights)));
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(matching_graph)));
         mwpm.flooder.sync_negative_weight_observables_and_detection_events();
         return mwpm;
     }
@@ -147,9 +145,377 @@ pm::IntermediateWeightedGraph pm::detector_error_model_to_weighted_graph(
 
 pm::MatchingGraph pm::detector_error_model_to_matching_graph(
     const stim::DetectorErrorModel& detector_error_model, pm::weight_int num_distinct_weights) {
-    auto weighted_graph = pm::detector_error_model_to_weighted_graph(detector_error_model);
-    return weighted_graph.to_matching_graph(num_distinct_weights);
+    return pm::detector_error_model_to_edge_list(detector_error_model).to_matching_graph(num_distinct_weights);
+}
+pm::DemEdgeList::DemEdgeList(size_t num_nodes, size_t num_observables)
+    : num_nodes(num_nodes), num_observables(num_observables) {
+}
+
+void pm::DemEdgeList::handle_dem_instruction(
+    double p, const std::vector<size_t>& detectors, const std::vector<size_t>& observables) {
+    if (detectors.empty() || detectors.size() > 2)
+        return;
+    size_t u = detectors[0];
+    size_t v = detectors.size() == 2 ? detectors[1] : SIZE_MAX;
+    if (v != SIZE_MAX && v < u)
+        std::swap(u, v);
+    size_t larger_node = v == SIZE_MAX ? u : v;
+    if (larger_node >= num_nodes) {
+        throw std::invalid_argument(
+            "Node " + std::to_string(larger_node) + " exceeds number of nodes in graph (" + std::to_string(num_nodes) +
+            ")");
+    }
+    size_t observables_begin = this->observables.size();
+    this->observables.insert(this->observables.end(), observables.begin(), observables.end());
+    edges.push_back({u, v, std::log((1 - p) / p), observables_begin, this->observables.size()});
+}
+
+void pm::DemEdgeList::merge_parallel_edges() {
+    std::stable_sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+        return a.u < b.u || (a.u == b.u && a.v < b.v);
+    });
+    std::vector<size_t> merged_observables;
+    size_t num_merged = 0;
+    for (auto& e : edges) {
+        if (num_merged > 0 && edges[num_merged - 1].u == e.u && edges[num_merged - 1].v == e.v) {
+            edges[num_merged - 1].weight = merge_weights(edges[num_merged - 1].weight, e.weight);
+            continue;
+        }
+        size_t observables_begin = merged_observables.size();
+        merged_observables.insert(
+            merged_observables.end(),
+            observables.begin() + e.observables_begin,
+            observables.begin() + e.observables_end);
+        edges[num_merged++] = {e.u, e.v, e.weight, observables_begin, merged_observables.size()};
+    }
+    edges.resize(num_merged);
+    edges.shrink_to_fit();
+    observables = std::move(merged_observables);
+}
+
+void pm::DemEdgeList::reorder_nodes() {
+    std::vector<size_t> offsets(num_nodes + 1, 0);
+    for (auto& e : edges) {
+        if (e.v == SIZE_MAX || e.v == e.u)
+            continue;
+        offsets[e.u + 1]++;
+        offsets[e.v + 1]++;
+    }
+    for (size_t i = 0; i < num_nodes; i++)
+        offsets[i + 1] += offsets[i];
+    std::vector<size_t> neighbors(offsets.back());
+    std::vector<size_t> next_position(offsets.begin(), offsets.end() - 1);
+    for (auto& e : edges) {
+        if (e.v == SIZE_MAX || e.v == e.u)
+            continue;
+        neighbors[next_position[e.u]++] = e.v;
+        neighbors[next_position[e.v]++] = e.u;
+    }
+    auto order = pm::reverse_cuthill_mckee_order(offsets, neighbors);
+    // If the nodes were already relabeled, compose the two relabelings.
+    if (node_relabeling) {
+        for (auto& i : order)
+            i = node_relabeling->original_index[i];
+    }
+    auto relabeling = std::make_shared<pm::NodeRelabeling>(std::move(order));
+    std::vector<size_t> new_index(num_nodes);
+    for (size_t i = 0; i < num_nodes; i++) {
+        size_t original = node_relabeling ? node_relabeling->original_index[i] : i;
+        new_index[i] = relabeling->graph_index[original];
+    }
+    for (auto& e : edges) {
+        e.u = new_index[e.u];
+        if (e.v != SIZE_MAX) {
+            e.v = new_index[e.v];
+            if (e.v < e.u)
+                std::swap(e.u, e.v);
+        }
+    }
+    // The parallel edges have already been merged, so the edges are distinct and need not be sorted stably.
+    std::sort(edges.begin(), edges.end(), [](const Edge& a, const Edge& b) {
+        return a.u < b.u || (a.u == b.u && a.v < b.v);
+    });
+    node_relabeling = std::move(relabeling);
+}
+
+double pm::DemEdgeList::max_abs_weight() const {
+    double max_abs_weight = 0;
+    for (auto& e : edges)
+        max_abs_weight = std::max(max_abs_weight, std::abs(e.weight));
+    return max_abs_weight;
+}
+
+pm::MatchingGraph pm::DemEdgeList::to_matching_graph(pm::weight_int num_distinct_weights) const {
+    pm::MatchingGraph matching_graph(num_nodes, num_observables);
+    auto topology = std::make_shared<pm::MatchingGraphTopology>();
+    topology->offsets.assign(num_nodes + 1, 0);
+    size_t* offsets = topology->offsets.mutable_data();
+    for (auto& e : edges) {
+        if (e.v == e.u)
+            continue;
+        offsets[e.u + 1]++;
+        if (e.v != SIZE_MAX)
+            offsets[e.v + 1]++;
+    }
+    for (size_t i = 0; i < num_nodes; i++)
+        offsets[i + 1] += offsets[i];
+    size_t num_edge_ends = topology->offsets.back();
+    topology->neighbors.resize(num_edge_ends);
+    topology->neighbor_weights.resize(num_edge_ends);
+    topology->neighbor_observables.resize(num_edge_ends);
+    pm::node_index_int* neighbors = topology->neighbors.mutable_data();
+    pm::weight_int* neighbor_weights = topology->neighbor_weights.mutable_data();
+    pm::obs_int* neighbor_observables = topology->neighbor_observables.mutable_data();
+    std::vector<size_t> next_position(topology->offsets.begin(), topology->offsets.end() - 1);
+    // The observables of each position are only known once the edges have been placed, so they are flattened after.
+    topology->has_observable_indices = num_observables > sizeof(pm::obs_int) * 8;
+    std::vector<std::vector<size_t>> position_observables(topology->has_observable_indices ? num_edge_ends : 0);
+
+    auto obs_mask_of = [&](const std::vector<size_t>& edge_observables) {
+        pm::obs_int obs_mask = 0;
+        if (num_observables <= sizeof(pm::obs_int) * 8) {
+            for (auto obs : edge_observables)
+                obs_mask ^= (pm::obs_int)1 << obs;
+        }
+        return obs_mask;
+    };
+    auto add_half_edge = [&](size_t u,
+                             size_t v,
+                             pm::signed_weight_int weight,
+                             pm::obs_int obs_mask,
+                             const std::vector<size_t>& edge_observables) {
+        size_t position = next_position[u]++;
+        neighbors[position] = (pm::node_index_int)v;
+        neighbor_weights[position] = std::abs(weight);
+        neighbor_observables[position] = obs_mask;
+        if (topology->has_observable_indices)
+            position_observables[position] = edge_observables;
+    };
+    auto handle_negative_weight = [&](size_t u, size_t v, pm::signed_weight_int weight,
+                                      const std::vector<size_t>& obs) {
+        if (weight < 0) {
+            matching_graph.update_negative_weight_observables(obs);
+            matching_graph.update_negative_weight_detection_events(u);
+            if (v != SIZE_MAX)
+                matching_graph.update_negative_weight_detection_events(v);
+            matching_graph.negative_weight_sum += weight;
+        }
+    };
+
+    // The boundary edge of each node comes first, so the boundary edges are placed in a first pass. The edges are
+    // sorted, so the remaining neighbors of each node are then placed in increasing order.
+    iter_discretized_edges(
+        num_distinct_weights,
+        [&](size_t, size_t, pm::signed_weight_int, const std::vector<size_t>&) {},
+        [&](size_t u, pm::signed_weight_int weight, const std::vector<size_t>& edge_observables) {
+            handle_negative_weight(u, SIZE_MAX, weight, edge_observables);
+            add_half_edge(u, pm::BOUNDARY_NEIGHBOR_INDEX, weight, obs_mask_of(edge_observables), edge_observables);
+        });
+    double normalising_constant = iter_discretized_edges(
+        num_distinct_weights,
+        [&](size_t u, size_t v, pm::signed_weight_int weight, const std::vector<size_t>& edge_observables) {
+            handle_negative_weight(u, v, weight, edge_observables);
+            auto obs_mask = obs_mask_of(edge_observables);
+            add_half_edge(u, v, weight, obs_mask, edge_observables);
+            add_half_edge(v, u, weight, obs_mask, edge_observables);
+        },
+        [&](size_t, pm::signed_weight_int, const std::vector<size_t>&) {});
+    if (topology->has_observable_indices) {
+        topology->observable_offsets.reserve(num_edge_ends + 1);
+        topology->observable_offsets.push_back(0);
+        for (auto& obs : position_observables) {
+            topology->observable_indices.insert(topology->observable_indices.end(), obs.begin(), obs.end());
+            topology->observable_offsets.push_back(topology->observable_indices.size());
+        }
+    }
+
+    matching_graph.normalising_constant = normalising_constant;
+    matching_graph.node_relabeling = node_relabeling;
+    matching_graph.set_topology(std::move(topology));
+    return matching_graph;
+}
+
+pm::SearchGraph pm::DemEdgeList::to_search_graph(
+    const pm::MatchingGraph& matching_graph, pm::weight_int num_distinct_weights) const {
+    return pm::search_graph_sharing_edges(
+        matching_graph, [&](const auto& handle_edge, const auto& handle_boundary_edge) {
+            iter_discretized_edges(num_distinct_weights, handle_edge, handle_boundary_edge);
+        });
 }
+
+pm::Mwpm pm::DemEdgeList::to_mwpm(pm::weight_int num_distinct_weights, bool ensure_search_flooder_included) const {
+    auto matching_graph = to_matching_graph(num_distinct_weights);
+    if (num_observables > sizeof(pm::obs_int) * 8 || ensure_search_flooder_included) {
+        auto search_graph = to_search_graph(matching_graph, num_distinct_weights);
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(matching_graph)), pm::SearchFlooder(std::move(search_graph)));
+        mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+        return mwpm;
+    } else {
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(matching_graph)));
+        mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+        return mwpm;
+    }
+}
+
+namespace {
+
+/// A flattened error instruction, whose targets are `targets[targets_begin:targets_end]' of the buffer they were
+/// copied into.
+struct FlatErrorInstruction {
+    double probability;
+    size_t targets_begin;
+    size_t targets_end;
+};
+
+/// The targets of a FlatErrorInstruction.
+struct FlatTargets {
+    const stim::DemTarget* first;
+    const stim::DemTarget* last;
+
+    const stim::DemTarget* begin() const {
+        return first;
+    }
+    const stim::DemTarget* end() const {
+        return last;
+    }
+};
+
+/// Calls `func(k)' for each k in [0, num_tasks), each on its own thread, and then rethrows the exception thrown by
+/// the task with the smallest k, if any.
+template <typename Func>
+void run_tasks_in_parallel(size_t num_tasks, const Func& func) {
+    std::vector<std::exception_ptr> errors(num_tasks);
+    auto run_task = [&](size_t k) {
+        try {
+            func(k);
+        } catch (...) {
+            errors[k] = std::current_exception();
+        }
+    };
+    std::vector<std::thread> threads;
+    threads.reserve(num_tasks);
+    for (size_t k = 1; k < num_tasks; k++)
+        threads.emplace_back(run_task, k);
+    run_task(0);
+    for (auto& t : threads)
+        t.join();
+    for (auto& error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+pm::DemEdgeList detector_error_model_to_edge_list_in_parallel(
+    const stim::DetectorErrorModel& detector_error_model, size_t num_nodes, size_t num_observables, size_t num_threads) {
+
+    // Flattening the repeat blocks and detector shifts is inherently serial, so it is done first, copying the
+    // targets of each error instruction into a single buffer.
+    std::vector<FlatErrorInstruction> instructions;
+    std::vector<stim::DemTarget> targets;
+    detector_error_model.iter_flatten_error_instructions([&](const stim::DemInstruction& instruction) {
+        size_t targets_begin = targets.size();
+        targets.insert(targets.end(), instruction.target_data.begin(), instruction.target_data.end());
+        instructions.push_back({instruction.arg_data[0], targets_begin, targets.size()});
+    });
+
+    // Each thread decomposes a contiguous shard of the instructions into edges, and then partitions its edges by the
+    // range of nodes their first node `u' falls in. Node range b is [b * nodes_per_range, (b + 1) * nodes_per_range).
+    size_t nodes_per_range = (num_nodes + num_threads - 1) / num_threads;
+    auto range_of_node = [&](size_t u) {
+        return u / nodes_per_range;
+    };
+    std::vector<pm::DemEdgeList> shards(num_threads, pm::DemEdgeList(num_nodes, num_observables));
+    std::vector<std::vector<size_t>> shard_range_offsets(num_threads);
+    run_tasks_in_parallel(num_threads, [&](size_t t) {
+        auto& shard = shards[t];
+        size_t begin = instructions.size() * t / num_threads;
+        size_t end = instructions.size() * (t + 1) / num_threads;
+        for (size_t i = begin; i < end; i++) {
+            auto& instruction = instructions[i];
+            pm::iter_error_instruction_edges(
+                instruction.probability,
+                FlatTargets{targets.data() + instruction.targets_begin, targets.data() + instruction.targets_end},
+                [&](double p, const std::vector<size_t>& detectors, const std::vector<size_t>& observables) {
+                    shard.handle_dem_instruction(p, detectors, observables);
+                });
+        }
+        // A stable counting sort by node range, which keeps the edges of each range in the order they were added.
+        auto& offsets = shard_range_offsets[t];
+        offsets.assign(num_threads + 1, 0);
+        for (auto& e : shard.edges)
+            offsets[range_of_node(e.u) + 1]++;
+        for (size_t b = 0; b < num_threads; b++)
+            offsets[b + 1] += offsets[b];
+        std::vector<size_t> next_position(offsets.begin(), offsets.end() - 1);
+        std::vector<pm::DemEdgeList::Edge> partitioned(shard.edges.size());
+        for (auto& e : shard.edges)
+            partitioned[next_position[range_of_node(e.u)]++] = e;
+        shard.edges = std::move(partitioned);
+    });
+
+    // Each thread then gathers the edges in its node range from every shard, in shard order (and hence in the order
+    // of the serial build), before sorting them and merging their parallel edges.
+    std::vector<pm::DemEdgeList> ranges(num_threads, pm::DemEdgeList(num_nodes, num_observables));
+    run_tasks_in_parallel(num_threads, [&](size_t b) {
+        auto& range = ranges[b];
+        for (size_t t = 0; t < num_threads; t++) {
+            auto& shard = shards[t];
+            for (size_t k = shard_range_offsets[t][b]; k < shard_range_offsets[t][b + 1]; k++) {
+                auto e = shard.edges[k];
+                size_t observables_begin = range.observables.size();
+                range.observables.insert(
+                    range.observables.end(),
+                    shard.observables.begin() + e.observables_begin,
+                    shard.observables.begin() + e.observables_end);
+                range.edges.push_back({e.u, e.v, e.weight, observables_begin, range.observables.size()});
+            }
+        }
+        range.merge_parallel_edges();
+    });
+    shards.clear();
+
+    // Finally, the node ranges are concatenated in order.
+    pm::DemEdgeList edge_list(num_nodes, num_observables);
+    std::vector<size_t> edge_offsets(num_threads + 1, 0);
+    std::vector<size_t> observables_offsets(num_threads + 1, 0);
+    for (size_t b = 0; b < num_threads; b++) {
+        edge_offsets[b + 1] = edge_offsets[b] + ranges[b].edges.size();
+        observables_offsets[b + 1] = observables_offsets[b] + ranges[b].observables.size();
+    }
+    edge_list.edges.resize(edge_offsets.back());
+    edge_list.observables.resize(observables_offsets.back());
+    run_tasks_in_parallel(num_threads, [&](size_t b) {
+        auto& range = ranges[b];
+        std::copy(
+            range.observables.begin(), range.observables.end(), edge_list.observables.begin() + observables_offsets[b]);
+        for (size_t k = 0; k < range.edges.size(); k++) {
+            auto e = range.edges[k];
+            e.observables_begin += observables_offsets[b];
+            e.observables_end += observables_offsets[b];
+            edge_list.edges[edge_offsets[b] + k] = e;
+        }
+    });
+    return edge_list;
+}
+
+}  // namespace
+
+pm::DemEdgeList pm::detector_error_model_to_edge_list(
+    const stim::DetectorErrorModel& detector_error_model, size_t num_threads) {
+    size_t num_nodes = detector_error_model.count_detectors();
+    size_t num_observables = detector_error_model.count_observables();
+    if (num_threads > 1 && num_nodes > 0)
+        return detector_error_model_to_edge_list_in_parallel(
+            detector_error_model, num_nodes, num_observables, num_threads);
+    pm::DemEdgeList edge_list(num_nodes, num_observables);
+    pm::iter_detector_error_model_edges(
+        detector_error_model, [&](double p, const std::vector<size_t>& detectors, std::vector<size_t>& observables) {
+            edge_list.handle_dem_instruction(p, detectors, observables);
+        });
+    edge_list.merge_parallel_edges();
+    return edge_list;
+}
+
 bool pm::Neighbor::operator==(const pm::Neighbor& rhs) const {
     return node == rhs.node && weight == rhs.weight && observables == rhs.observables;
 }
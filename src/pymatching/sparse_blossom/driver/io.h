@@ -42,29 +42,55 @@ const pm::weight_int NUM_DISTINCT_WEIGHTS = 1 << (sizeof(pm::weight_int) * 8 - 8
 /// details.
 double merge_weights(double a, double b);
 
+/// Splits the targets of a single error instruction with probability `p' into its components (separated by `^'),
+/// calling `handle_dem_error(p, detectors, observables)' for each of them.
+template <typename Targets, typename Handler>
+void iter_error_instruction_edges(double p, const Targets &targets, const Handler &handle_dem_error) {
+    std::vector<size_t> dets;
+    std::vector<size_t> observables;
+    for (auto &target : targets) {
+        if (target.is_relative_detector_id()) {
+            dets.push_back(target.val());
+        } else if (target.is_observable_id()) {
+            observables.push_back(target.val());
+        } else if (target.is_separator()) {
+            if (p > 0) {
+                handle_dem_error(p, dets, observables);
+                observables.clear();
+                dets.clear();
+            }
+        }
+    }
+    if (p > 0) {
+        handle_dem_error(p, dets, observables);
+    }
+}
+
+/// Builds a search graph that shares its edges with `matching_graph', which was built from the same edges.
+/// `iter_edges(handle_edge, handle_boundary_edge)' must call `handle_edge(u, v, weight, observables)' for each
+/// discretized edge and `handle_boundary_edge(u, weight, observables)' for each discretized boundary edge (e.g. by
+/// passing them on to `iter_discretized_edges').
+template <typename EdgeIterator>
+SearchGraph search_graph_sharing_edges(const MatchingGraph &matching_graph, const EdgeIterator &iter_edges) {
+    // The edges are shared with the matching graph, so only the edges with negative weights need to be found.
+    std::vector<std::pair<size_t, size_t>> negative_weight_edges;
+    iter_edges(
+        [&](size_t u, size_t v, signed_weight_int weight, const std::vector<size_t> &) {
+            if (weight < 0 && u != v)
+                negative_weight_edges.push_back({u, v});
+        },
+        [&](size_t u, signed_weight_int weight, const std::vector<size_t> &) {
+            if (weight < 0)
+                negative_weight_edges.push_back({u, SIZE_MAX});
+        });
+    return SearchGraph(matching_graph, std::move(negative_weight_edges));
+}
+
 template <typename Handler>
 void iter_detector_error_model_edges(
     const stim::DetectorErrorModel &detector_error_model, const Handler &handle_dem_error) {
     detector_error_model.iter_flatten_error_instructions([&](const stim::DemInstruction &instruction) {
-        std::vector<size_t> dets;
-        std::vector<size_t> observables;
-        double p = instruction.arg_data[0];
-        for (auto &target : instruction.target_data) {
-            if (target.is_relative_detector_id()) {
-                dets.push_back(target.val());
-            } else if (target.is_observable_id()) {
-                observables.push_back(target.val());
-            } else if (target.is_separator()) {
-                if (p > 0) {
-                    handle_dem_error(p, dets, observables);
-                    observables.clear();
-                    dets.clear();
-                }
-            }
-        }
-        if (p > 0) {
-            handle_dem_error(p, dets, observables);
-        }
+        iter_error_instruction_edges(instruction.arg_data[0], instruction.target_data, handle_dem_error);
     });
 }
 
@@ -101,7 +127,9 @@ class IntermediateWeightedGraph {
 
     pm::MatchingGraph to_matching_graph(pm::weight_int num_distinct_weights);
 
-    pm::SearchGraph to_search_graph(pm::weight_int num_distinct_weights);
+    /// Creates the search graph for `matching_graph', which must have been built by `to_matching_graph' with the same
+    /// `num_distinct_weights', sharing its topology.
+    pm::SearchGraph to_search_graph(const pm::MatchingGraph &matching_graph, pm::weight_int num_distinct_weights);
 
     pm::Mwpm to_mwpm(pm::weight_int num_distinct_weights, bool ensure_search_flooder_included = false);
 
@@ -142,6 +170,93 @@ IntermediateWeightedGraph detector_error_model_to_weighted_graph(const stim::Det
 MatchingGraph detector_error_model_to_matching_graph(
     const stim::DetectorErrorModel &detector_error_model, pm::weight_int num_distinct_weights);
 
+/// The edges of a detector error model, collected into a flat list without building a per-node graph. Parallel
+/// edges are merged by sorting the list and reducing runs of equal edges, after which `to_matching_graph' emits the
+/// compact (CSR) topology of a MatchingGraph directly. The resulting graphs are the same as those built by
+/// IntermediateWeightedGraph, except that the neighbors of each node are sorted by index.
+class DemEdgeList {
+   public:
+    struct Edge {
+        size_t u;
+        /// The other node, which is not smaller than `u', or SIZE_MAX for a boundary edge. Self-loops (with v equal
+        /// to u) are kept only because, as for IntermediateWeightedGraph, they contribute to `max_abs_weight'.
+        size_t v;
+        double weight;
+        /// The observables of the edge are `observables[observables_begin:observables_end]'.
+        size_t observables_begin;
+        size_t observables_end;
+    };
+    std::vector<Edge> edges;
+    std::vector<size_t> observables;
+    size_t num_nodes;
+    size_t num_observables;
+    /// Set by `reorder_nodes', and attached to the matching graphs built from the list.
+    std::shared_ptr<const NodeRelabeling> node_relabeling;
+
+    DemEdgeList(size_t num_nodes, size_t num_observables);
+
+    void handle_dem_instruction(double p, const std::vector<size_t> &detectors, const std::vector<size_t> &observables);
+
+    /// Merges parallel edges, in the order in which they were added, keeping the observables of the first. Must be
+    /// called before the graphs are built.
+    void merge_parallel_edges();
+
+    /// Relabels the nodes in reverse Cuthill-McKee order (see `reverse_cuthill_mckee_order'), so that the nodes of
+    /// the graphs built from the list are laid out in memory roughly in the order the flooder visits them. The
+    /// matching graph records the relabeling, and the decoding functions in mwpm_decoding.h translate detection
+    /// events and the nodes they report, so callers keep using the original detector indices. Must be called after
+    /// `merge_parallel_edges'.
+    void reorder_nodes();
+
+    double max_abs_weight() const;
+
+    template <typename EdgeCallable, typename BoundaryEdgeCallable>
+    double iter_discretized_edges(
+        pm::weight_int num_distinct_weights,
+        const EdgeCallable &edge_func,
+        const BoundaryEdgeCallable &boundary_edge_func) const;
+
+    pm::MatchingGraph to_matching_graph(pm::weight_int num_distinct_weights) const;
+
+    /// Creates the search graph for `matching_graph', which must have been built by `to_matching_graph' with the same
+    /// `num_distinct_weights', sharing its topology.
+    pm::SearchGraph to_search_graph(const pm::MatchingGraph &matching_graph, pm::weight_int num_distinct_weights) const;
+
+    pm::Mwpm to_mwpm(pm::weight_int num_distinct_weights, bool ensure_search_flooder_included = false) const;
+};
+
+template <typename EdgeCallable, typename BoundaryEdgeCallable>
+inline double DemEdgeList::iter_discretized_edges(
+    pm::weight_int num_distinct_weights,
+    const EdgeCallable &edge_func,
+    const BoundaryEdgeCallable &boundary_edge_func) const {
+    pm::weight_int max_half_edge_weight = num_distinct_weights - 1;
+    double normalising_constant = (double)max_half_edge_weight / max_abs_weight();
+    std::vector<size_t> edge_observables;
+    for (auto &e : edges) {
+        // As for IntermediateWeightedGraph, the weights are doubled so that all collision events occur at integer
+        // times.
+        pm::signed_weight_int w = 2 * (pm::signed_weight_int)round(e.weight * normalising_constant);
+        edge_observables.assign(observables.begin() + e.observables_begin, observables.begin() + e.observables_end);
+        if (e.v == SIZE_MAX) {
+            boundary_edge_func(e.u, w, edge_observables);
+        } else if (e.v != e.u) {
+            edge_func(e.u, e.v, w, edge_observables);
+        }
+    }
+    return normalising_constant * 2;
+}
+
+/// Collects the edges of `detector_error_model' into a DemEdgeList, with its parallel edges merged.
+///
+/// If `num_threads' is greater than one, the flattened error instructions are split into contiguous shards, each of
+/// which is decomposed into edges by its own thread. The edges are then partitioned by node range, and each range is
+/// sorted and has its parallel edges merged by its own thread. Since the shards and ranges are recombined in order,
+/// and the sorts are stable, parallel edges are merged in the same order as by the serial build, and the result is
+/// identical to it.
+DemEdgeList detector_error_model_to_edge_list(
+    const stim::DetectorErrorModel &detector_error_model, size_t num_threads = 1);
+
 }  // namespace pm
 
 #endif  // PYMATCHING2_IO_H
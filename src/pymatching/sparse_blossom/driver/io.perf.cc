@@ -53,3 +53,17 @@ BENCHMARK(Load_dem_r21_d21_p100) {
         .goal_millis(280)
         .show_rate("loads", (double)num_loads);
 }
+
+BENCHMARK(Load_dem_via_weighted_graph_r21_d21_p100) {
+    auto dem = generate_dem(21, 21, 0.01);
+    size_t num_buckets = 1024;
+    size_t num_loads = 10;
+    benchmark_go([&]() {
+        for (size_t i = 0; i < num_loads; i++) {
+            auto weighted_graph = pm::detector_error_model_to_weighted_graph(dem);
+            auto mwpm = weighted_graph.to_mwpm(num_buckets);
+        }
+    })
+        .goal_millis(280)
+        .show_rate("loads", (double)num_loads);
+}
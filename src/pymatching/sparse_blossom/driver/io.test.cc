@@ -15,6 +15,7 @@
 #include "pymatching/sparse_blossom/driver/io.h"
 
 #include "gtest/gtest.h"
+#include <tuple>
 
 TEST(StimIO, IntermediateWeightedGraph) {
     pm::IntermediateWeightedGraph g(10, 64);
@@ -50,3 +51,99 @@ TEST(StimIO, MergeWeights) {
     ASSERT_FLOAT_EQ(merge_weights_via_probabilities(-1, -2), pm::merge_weights(-1, -2));
     ASSERT_FLOAT_EQ(pm::merge_weights(1000, 0), 0);
 }
+
+// Defined in mwpm_decoding.test.cc
+std::string find_test_data_file(const char* name);
+
+void assert_matching_graphs_have_same_edges(pm::MatchingGraph& a, pm::MatchingGraph& b) {
+    ASSERT_EQ(a.nodes.size(), b.nodes.size());
+    ASSERT_EQ(a.normalising_constant, b.normalising_constant);
+    ASSERT_EQ(a.negative_weight_sum, b.negative_weight_sum);
+    ASSERT_EQ(a.negative_weight_detection_events_set, b.negative_weight_detection_events_set);
+    ASSERT_EQ(a.negative_weight_observables_set, b.negative_weight_observables_set);
+    auto edges_of = [](pm::MatchingGraph& g, size_t i) {
+        std::vector<std::tuple<int64_t, pm::weight_int, pm::obs_int>> edges;
+        auto& node = g.nodes[i];
+        for (size_t k = 0; k < node.neighbors.size(); k++) {
+            int64_t neighbor = node.neighbors[k] ? node.neighbors[k] - &g.nodes[0] : -1;
+            edges.push_back({neighbor, node.neighbor_weights[k], node.neighbor_observables[k]});
+        }
+        return edges;
+    };
+    for (size_t i = 0; i < a.nodes.size(); i++) {
+        auto edges_a = edges_of(a, i);
+        auto edges_b = edges_of(b, i);
+        // The boundary edge, if any, comes first.
+        if (!edges_a.empty()) {
+            ASSERT_EQ(std::get<0>(edges_a[0]) == -1, std::get<0>(edges_b[0]) == -1);
+        }
+        // Parallel edges are merged, so the neighbors of a node are distinct. Sort by neighbor only, since
+        // obs_int need not be ordered.
+        auto by_neighbor = [](const auto& e1, const auto& e2) {
+            return std::get<0>(e1) < std::get<0>(e2);
+        };
+        std::sort(edges_a.begin(), edges_a.end(), by_neighbor);
+        std::sort(edges_b.begin(), edges_b.end(), by_neighbor);
+        ASSERT_EQ(edges_a, edges_b);
+    }
+}
+
+TEST(StimIO, DemEdgeListMatchesIntermediateWeightedGraph) {
+    auto dem = stim::DetectorErrorModel(R"DEM(
+        error(0.1) D0 D1 L0
+        error(0.2) D1 D0
+        error(0.05) D1 D2 L1
+        error(0.7) D2 L0
+        error(0.1) D2 L1
+        error(0.15) D0
+        error(0.01) D3 D3
+        error(0.3) D3 D1 ^ D2
+    )DEM");
+    auto edge_list = pm::detector_error_model_to_edge_list(dem);
+    ASSERT_EQ(edge_list.edges.size(), 6);
+    ASSERT_EQ(edge_list.edges[0].u, 0);
+    ASSERT_EQ(edge_list.edges[0].v, 1);
+    ASSERT_EQ(edge_list.edges[0].weight, pm::merge_weights(std::log(0.9 / 0.1), std::log(0.8 / 0.2)));
+    std::vector<size_t> obs_0_1(
+        edge_list.observables.begin() + edge_list.edges[0].observables_begin,
+        edge_list.observables.begin() + edge_list.edges[0].observables_end);
+    ASSERT_EQ(obs_0_1, std::vector<size_t>({0}));
+    auto g1 = edge_list.to_matching_graph(pm::NUM_DISTINCT_WEIGHTS);
+    auto g2 = pm::detector_error_model_to_weighted_graph(dem).to_matching_graph(pm::NUM_DISTINCT_WEIGHTS);
+    assert_matching_graphs_have_same_edges(g1, g2);
+    ASSERT_TRUE(g1.topology->is_compact());
+
+    auto dem_file = std::fopen(find_test_data_file("surface_code_rotated_memory_x_13_0.01.dem").c_str(), "r");
+    stim::DetectorErrorModel surface_code_dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    auto g3 = pm::detector_error_model_to_edge_list(surface_code_dem).to_matching_graph(pm::NUM_DISTINCT_WEIGHTS);
+    auto g4 =
+        pm::detector_error_model_to_weighted_graph(surface_code_dem).to_matching_graph(pm::NUM_DISTINCT_WEIGHTS);
+    assert_matching_graphs_have_same_edges(g3, g4);
+}
+
+TEST(StimIO, ParallelDemEdgeListMatchesSerial) {
+    auto dem_file = std::fopen(find_test_data_file("surface_code_rotated_memory_x_13_0.01.dem").c_str(), "r");
+    stim::DetectorErrorModel surface_code_dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    auto serial = pm::detector_error_model_to_edge_list(surface_code_dem);
+    for (size_t num_threads : {2, 3, 7, 64}) {
+        auto parallel = pm::detector_error_model_to_edge_list(surface_code_dem, num_threads);
+        ASSERT_EQ(parallel.edges.size(), serial.edges.size());
+        ASSERT_EQ(parallel.observables, serial.observables);
+        for (size_t k = 0; k < serial.edges.size(); k++) {
+            ASSERT_EQ(parallel.edges[k].u, serial.edges[k].u);
+            ASSERT_EQ(parallel.edges[k].v, serial.edges[k].v);
+            ASSERT_EQ(parallel.edges[k].weight, serial.edges[k].weight);
+            ASSERT_EQ(parallel.edges[k].observables_begin, serial.edges[k].observables_begin);
+            ASSERT_EQ(parallel.edges[k].observables_end, serial.edges[k].observables_end);
+        }
+    }
+
+    auto small_dem = stim::DetectorErrorModel(R"DEM(
+        error(0.1) D0 D1
+        detector D2
+    )DEM");
+    auto small = pm::detector_error_model_to_edge_list(small_dem, 8);
+    ASSERT_EQ(small.edges.size(), 1);
+}
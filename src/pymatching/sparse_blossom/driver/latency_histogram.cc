@@ -0,0 +1,131 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+pm::LatencyHistogram::LatencyHistogram() : counts(NUM_BUCKETS, 0), num_values(0), min_value(0), max_value(0), sum(0) {
+}
+
+size_t pm::LatencyHistogram::bucket_index(uint64_t value) {
+    if (value < 2 * SUB_BUCKETS)
+        return (size_t)value;
+    // The top 5 bits of `value' (i.e. 16 to 31) select the bucket within the power of two.
+    size_t width = std::bit_width(value);
+    size_t shift = width - 5;
+    return 2 * SUB_BUCKETS + (width - 6) * SUB_BUCKETS + (size_t)((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t pm::LatencyHistogram::bucket_lower_bound(size_t index) {
+    if (index < 2 * SUB_BUCKETS)
+        return index;
+    size_t shift = (index - 2 * SUB_BUCKETS) / SUB_BUCKETS + 1;
+    uint64_t top = SUB_BUCKETS + (index - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+    return top << shift;
+}
+
+uint64_t pm::LatencyHistogram::bucket_upper_bound(size_t index) {
+    if (index + 1 == NUM_BUCKETS)
+        return UINT64_MAX;
+    return bucket_lower_bound(index + 1) - 1;
+}
+
+uint64_t pm::LatencyHistogram::value_at_quantile(double quantile) const {
+    if (num_values == 0)
+        return 0;
+    quantile = std::min(std::max(quantile, 0.0), 1.0);
+    auto rank = std::max<uint64_t>(1, (uint64_t)std::ceil(quantile * (double)num_values));
+    uint64_t seen = 0;
+    for (size_t k = 0; k < NUM_BUCKETS; k++) {
+        seen += counts[k];
+        if (seen >= rank)
+            return std::min(bucket_upper_bound(k), max_value);
+    }
+    return max_value;
+}
+
+double pm::LatencyHistogram::mean() const {
+    return num_values == 0 ? 0 : sum / (double)num_values;
+}
+
+pm::LatencyHistogram& pm::LatencyHistogram::operator+=(const LatencyHistogram& other) {
+    if (other.num_values == 0)
+        return *this;
+    for (size_t k = 0; k < NUM_BUCKETS; k++)
+        counts[k] += other.counts[k];
+    min_value = num_values == 0 ? other.min_value : std::min(min_value, other.min_value);
+    max_value = std::max(max_value, other.max_value);
+    num_values += other.num_values;
+    sum += other.sum;
+    return *this;
+}
+
+void pm::LatencyHistogram::clear() {
+    std::fill(counts.begin(), counts.end(), 0);
+    num_values = 0;
+    min_value = 0;
+    max_value = 0;
+    sum = 0;
+}
+
+void pm::DecodeLatencyHistograms::record(uint64_t total_ns, const DecodePhaseTimes& phase_times) {
+    total.record(total_ns);
+    syndrome_extraction.record(phase_times.syndrome_extraction_ns);
+    flooding.record(phase_times.flooding_ns);
+    result_extraction.record(phase_times.result_extraction_ns);
+}
+
+pm::DecodeLatencyHistograms& pm::DecodeLatencyHistograms::operator+=(const DecodeLatencyHistograms& other) {
+    total += other.total;
+    syndrome_extraction += other.syndrome_extraction;
+    flooding += other.flooding;
+    result_extraction += other.result_extraction;
+    return *this;
+}
+
+std::array<const pm::LatencyHistogram*, 4> pm::DecodeLatencyHistograms::histograms() const {
+    return {&total, &syndrome_extraction, &flooding, &result_extraction};
+}
+
+void pm::DecodeLatencyHistograms::write_csv(std::ostream& out) const {
+    out << "phase,lower_ns,upper_ns,count,cumulative_fraction\n";
+    auto hists = histograms();
+    for (size_t p = 0; p < hists.size(); p++) {
+        const auto& h = *hists[p];
+        uint64_t seen = 0;
+        for (size_t k = 0; k < LatencyHistogram::NUM_BUCKETS; k++) {
+            if (h.counts[k] == 0)
+                continue;
+            seen += h.counts[k];
+            out << PHASE_NAMES[p] << "," << LatencyHistogram::bucket_lower_bound(k) << ","
+                << LatencyHistogram::bucket_upper_bound(k) << "," << h.counts[k] << ","
+                << (double)seen / (double)h.num_values << "\n";
+        }
+    }
+}
+
+void pm::DecodeLatencyHistograms::write_summary(std::ostream& out) const {
+    auto hists = histograms();
+    for (size_t p = 0; p < hists.size(); p++) {
+        const auto& h = *hists[p];
+        out << "Decoding latency (" << PHASE_NAMES[p] << "): mean=" << h.mean() / 1000
+            << "us p50=" << (double)h.value_at_quantile(0.5) / 1000
+            << "us p99=" << (double)h.value_at_quantile(0.99) / 1000
+            << "us p99.9=" << (double)h.value_at_quantile(0.999) / 1000
+            << "us max=" << (double)h.max_value / 1000 << "us\n";
+    }
+}
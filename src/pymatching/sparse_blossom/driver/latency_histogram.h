@@ -0,0 +1,115 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_LATENCY_HISTOGRAM_H
+#define PYMATCHING2_LATENCY_HISTOGRAM_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+namespace pm {
+
+/// The number of nanoseconds since `start'.
+inline uint64_t nanoseconds_since(std::chrono::steady_clock::time_point start) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+/// A histogram of latencies (in nanoseconds) with logarithmically sized buckets, in the style of an HDR histogram.
+///
+/// Values below 2 * SUB_BUCKETS are counted exactly. Above that, each power of two is split into SUB_BUCKETS
+/// equally sized buckets, so that every value is counted in a bucket whose width is at most 1/SUB_BUCKETS of its
+/// lower bound (about 6%). Recording a value takes constant time and the histogram has a fixed size, so it can be
+/// used to find tail latencies (e.g. p99.9) of any number of shots.
+struct LatencyHistogram {
+    static constexpr size_t SUB_BUCKETS = 16;
+    static constexpr size_t NUM_BUCKETS = 2 * SUB_BUCKETS + (64 - 5) * SUB_BUCKETS;
+
+    std::vector<uint64_t> counts;
+    uint64_t num_values;
+    uint64_t min_value;
+    uint64_t max_value;
+    /// The sum of the recorded values, as a double so that it cannot overflow.
+    double sum;
+
+    LatencyHistogram();
+
+    /// The index of the bucket that `value' is counted in.
+    static size_t bucket_index(uint64_t value);
+    /// The smallest and largest values counted in the bucket with index `index'.
+    static uint64_t bucket_lower_bound(size_t index);
+    static uint64_t bucket_upper_bound(size_t index);
+
+    inline void record(uint64_t value) {
+        counts[bucket_index(value)]++;
+        if (num_values == 0 || value < min_value)
+            min_value = value;
+        if (value > max_value)
+            max_value = value;
+        num_values++;
+        sum += (double)value;
+    }
+
+    /// The smallest value such that at least a fraction `quantile' of the recorded values are at most it, up to the
+    /// resolution of the buckets (the upper bound of the bucket containing it, but at most `max_value'). Returns 0
+    /// if no values have been recorded.
+    uint64_t value_at_quantile(double quantile) const;
+    double mean() const;
+
+    LatencyHistogram& operator+=(const LatencyHistogram& other);
+    void clear();
+};
+
+/// The time (in nanoseconds) spent in each phase of decoding a shot. `decode_detection_events' adds to these when it
+/// is given a `DecodePhaseTimes', and a caller can add the time it spent extracting the detection events of the shot
+/// to `syndrome_extraction_ns'.
+struct DecodePhaseTimes {
+    /// Finding the detection events of the shot, and translating them to nodes of the matching graph.
+    uint64_t syndrome_extraction_ns = 0;
+    /// Finding the matching, by growing regions until every detection event is matched.
+    uint64_t flooding_ns = 0;
+    /// Shattering the blossoms and extracting the predicted observables and the weight from the matching.
+    uint64_t result_extraction_ns = 0;
+};
+
+/// Latency histograms of decoding shots, in total and for each phase of `DecodePhaseTimes'.
+struct DecodeLatencyHistograms {
+    static constexpr std::array<const char*, 4> PHASE_NAMES{
+        "total", "syndrome_extraction", "flooding", "result_extraction"};
+
+    LatencyHistogram total;
+    LatencyHistogram syndrome_extraction;
+    LatencyHistogram flooding;
+    LatencyHistogram result_extraction;
+
+    void record(uint64_t total_ns, const DecodePhaseTimes& phase_times);
+    /// Adds the latencies recorded in `other', e.g. by another thread, to the histograms of each phase.
+    DecodeLatencyHistograms& operator+=(const DecodeLatencyHistograms& other);
+    /// The histograms in the order of `PHASE_NAMES'.
+    std::array<const LatencyHistogram*, 4> histograms() const;
+
+    /// Writes the non-empty buckets of every histogram as CSV, with columns
+    /// `phase,lower_ns,upper_ns,count,cumulative_fraction'.
+    void write_csv(std::ostream& out) const;
+    /// Writes the p50, p99, p99.9 and maximum latency of every phase, in microseconds.
+    void write_summary(std::ostream& out) const;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_LATENCY_HISTOGRAM_H
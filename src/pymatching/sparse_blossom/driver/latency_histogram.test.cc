@@ -0,0 +1,104 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+using namespace pm;
+
+TEST(LatencyHistogram, Buckets) {
+    for (uint64_t v = 0; v < 32; v++) {
+        ASSERT_EQ(LatencyHistogram::bucket_index(v), v);
+        ASSERT_EQ(LatencyHistogram::bucket_lower_bound(v), v);
+        ASSERT_EQ(LatencyHistogram::bucket_upper_bound(v), v);
+    }
+    ASSERT_EQ(LatencyHistogram::bucket_index(32), 32);
+    ASSERT_EQ(LatencyHistogram::bucket_index(33), 32);
+    ASSERT_EQ(LatencyHistogram::bucket_index(34), 33);
+    ASSERT_EQ(LatencyHistogram::bucket_index(UINT64_MAX), LatencyHistogram::NUM_BUCKETS - 1);
+    ASSERT_EQ(LatencyHistogram::bucket_upper_bound(LatencyHistogram::NUM_BUCKETS - 1), UINT64_MAX);
+
+    // Consecutive buckets tile the values, and each is at most 1/16 of its lower bound wide.
+    for (size_t k = 0; k + 1 < LatencyHistogram::NUM_BUCKETS; k++) {
+        uint64_t lower = LatencyHistogram::bucket_lower_bound(k);
+        uint64_t upper = LatencyHistogram::bucket_upper_bound(k);
+        ASSERT_EQ(upper + 1, LatencyHistogram::bucket_lower_bound(k + 1));
+        ASSERT_EQ(LatencyHistogram::bucket_index(lower), k);
+        ASSERT_EQ(LatencyHistogram::bucket_index(upper), k);
+        ASSERT_LE(upper - lower, lower / LatencyHistogram::SUB_BUCKETS);
+    }
+}
+
+TEST(LatencyHistogram, Quantiles) {
+    LatencyHistogram h;
+    ASSERT_EQ(h.value_at_quantile(0.5), 0);
+    for (uint64_t v = 1; v <= 1000; v++)
+        h.record(v * 1000);
+    ASSERT_EQ(h.num_values, 1000);
+    ASSERT_EQ(h.min_value, 1000);
+    ASSERT_EQ(h.max_value, 1000000);
+    ASSERT_DOUBLE_EQ(h.mean(), 500500);
+    auto near = [](uint64_t actual, uint64_t expected) {
+        return actual >= expected && actual <= expected + expected / LatencyHistogram::SUB_BUCKETS;
+    };
+    ASSERT_TRUE(near(h.value_at_quantile(0.5), 500000));
+    ASSERT_TRUE(near(h.value_at_quantile(0.99), 990000));
+    ASSERT_EQ(h.value_at_quantile(0.999999), 1000000);
+    ASSERT_EQ(h.value_at_quantile(1), 1000000);
+    ASSERT_TRUE(near(h.value_at_quantile(0), 1000));
+
+    LatencyHistogram h2;
+    h2.record(5);
+    h2.record(2000000);
+    h += h2;
+    ASSERT_EQ(h.num_values, 1002);
+    ASSERT_EQ(h.min_value, 5);
+    ASSERT_EQ(h.max_value, 2000000);
+    h.clear();
+    ASSERT_EQ(h.num_values, 0);
+    ASSERT_EQ(h.value_at_quantile(0.99), 0);
+}
+
+TEST(DecodeLatencyHistograms, WriteCsv) {
+    DecodeLatencyHistograms latencies;
+    latencies.record(100, DecodePhaseTimes{10, 80, 10});
+    latencies.record(40, DecodePhaseTimes{10, 20, 10});
+    std::stringstream ss;
+    latencies.write_csv(ss);
+    ASSERT_EQ(
+        ss.str(),
+        "phase,lower_ns,upper_ns,count,cumulative_fraction\n"
+        "total,40,41,1,0.5\n"
+        "total,100,103,1,1\n"
+        "syndrome_extraction,10,10,2,1\n"
+        "flooding,20,20,1,0.5\n"
+        "flooding,80,83,1,1\n"
+        "result_extraction,10,10,2,1\n");
+}
+
+TEST(DecodeLatencyHistograms, Add) {
+    DecodeLatencyHistograms a, b;
+    a.record(100, DecodePhaseTimes{10, 80, 10});
+    b.record(40, DecodePhaseTimes{10, 20, 10});
+    b.record(50, DecodePhaseTimes{5, 40, 5});
+    a += b;
+    ASSERT_EQ(a.total.num_values, 3);
+    ASSERT_EQ(a.total.min_value, 40);
+    ASSERT_EQ(a.total.max_value, 100);
+    ASSERT_EQ(a.syndrome_extraction.min_value, 5);
+    ASSERT_EQ(a.flooding.sum, 140);
+    ASSERT_EQ(a.result_extraction.counts[10], 2);
+}
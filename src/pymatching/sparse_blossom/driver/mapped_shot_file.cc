@@ -0,0 +1,196 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/mapped_shot_file.h"
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+pm::MappedShotFile::MappedShotFile(
+    const std::string& path, stim::SampleFormat format, size_t num_detectors, size_t num_appended_observables)
+    : format(format),
+      num_detectors(num_detectors),
+      num_appended_observables(num_appended_observables),
+      num_bits_per_record(num_detectors + num_appended_observables),
+      data(nullptr),
+      num_bytes(0),
+      cursor{nullptr, nullptr} {
+    if (!supports_format(format))
+        throw std::invalid_argument("Only the b8 and r8 formats can be memory mapped.");
+#if !defined(_WIN32)
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::invalid_argument("Failed to open '" + path + "'.");
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw std::invalid_argument("Failed to get the size of '" + path + "'.");
+    }
+    num_bytes = (size_t)st.st_size;
+    if (num_bytes > 0) {
+        void* mapped = mmap(nullptr, num_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::invalid_argument("Failed to memory map '" + path + "'.");
+        }
+        madvise(mapped, num_bytes, MADV_SEQUENTIAL);
+        data = (const uint8_t*)mapped;
+    }
+    close(fd);
+#else
+    FILE* f = fopen(path.c_str(), "rb");
+    if (f == nullptr)
+        throw std::invalid_argument("Failed to open '" + path + "'.");
+    uint8_t buf[1 << 16];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        fallback_buffer.insert(fallback_buffer.end(), buf, buf + n);
+    fclose(f);
+    num_bytes = fallback_buffer.size();
+    data = fallback_buffer.data();
+#endif
+    cursor = all();
+}
+
+pm::MappedShotFile::~MappedShotFile() {
+#if !defined(_WIN32)
+    if (data != nullptr)
+        munmap((void*)data, num_bytes);
+#endif
+}
+
+bool pm::MappedShotFile::supports_format(stim::SampleFormat format) {
+    return format == stim::SampleFormat::SAMPLE_FORMAT_B8 || format == stim::SampleFormat::SAMPLE_FORMAT_R8;
+}
+
+size_t pm::MappedShotFile::size_in_bytes() const {
+    return num_bytes;
+}
+
+pm::ShotByteRange pm::MappedShotFile::all() const {
+    return {data, data + num_bytes};
+}
+
+const uint8_t* pm::MappedShotFile::find_end_of_record(const uint8_t* p, const uint8_t* end) const {
+    if (format == stim::SampleFormat::SAMPLE_FORMAT_B8) {
+        size_t record_bytes = (num_bits_per_record + 7) >> 3;
+        if ((size_t)(end - p) < record_bytes)
+            throw std::invalid_argument("b8 data ended in the middle of a record.");
+        return p + record_bytes;
+    }
+    // r8: each byte is the number of 0 bits before the next 1 bit, except 255 which means 255 0 bits and no 1 bit.
+    // A record is terminated by the (implicit) 1 bit just past its end.
+    size_t bit = 0;
+    while (true) {
+        if (p == end)
+            throw std::invalid_argument("r8 data ended in the middle of a record.");
+        uint8_t b = *p++;
+        bit += b;
+        if (b != 255) {
+            if (bit == num_bits_per_record)
+                return p;
+            if (bit > num_bits_per_record)
+                throw std::invalid_argument("r8 data jumped past the end of a record.");
+            bit++;
+        }
+    }
+}
+
+std::vector<pm::ShotByteRange> pm::MappedShotFile::split(size_t num_ranges) const {
+    std::vector<ShotByteRange> ranges;
+    if (num_bytes == 0 || num_ranges == 0)
+        return ranges;
+    if (format == stim::SampleFormat::SAMPLE_FORMAT_B8) {
+        size_t record_bytes = (num_bits_per_record + 7) >> 3;
+        size_t num_shots = num_bytes / record_bytes;
+        if (num_shots * record_bytes != num_bytes)
+            throw std::invalid_argument("b8 data ended in the middle of a record.");
+        for (size_t i = 0; i < num_ranges; i++) {
+            size_t begin = num_shots * i / num_ranges;
+            size_t end = num_shots * (i + 1) / num_ranges;
+            if (end > begin)
+                ranges.push_back({data + begin * record_bytes, data + end * record_bytes});
+        }
+        return ranges;
+    }
+    // Records have variable length in r8, so walk the records, cutting once each target size has been reached.
+    const uint8_t* p = data;
+    const uint8_t* end = data + num_bytes;
+    const uint8_t* range_begin = p;
+    for (size_t i = 1; i < num_ranges && p != end; i++) {
+        const uint8_t* target = data + num_bytes * i / num_ranges;
+        while (p < target)
+            p = find_end_of_record(p, end);
+        if (p != range_begin) {
+            ranges.push_back({range_begin, p});
+            range_begin = p;
+        }
+    }
+    if (range_begin != end)
+        ranges.push_back({range_begin, end});
+    return ranges;
+}
+
+void pm::MappedShotFile::set_bit(size_t k, stim::SparseShot& shot) const {
+    if (k < num_detectors) {
+        shot.hits.push_back(k);
+    } else {
+        shot.obs_mask[k - num_detectors] = true;
+    }
+}
+
+bool pm::MappedShotFile::read_shot(ShotByteRange& range, stim::SparseShot& shot) const {
+    if (range.empty())
+        return false;
+    const uint8_t* p = range.begin;
+    const uint8_t* record_end = find_end_of_record(p, range.end);
+    if (num_appended_observables > shot.obs_mask.num_bits_padded())
+        shot.obs_mask = stim::simd_bits<stim::MAX_BITWORD_WIDTH>(num_appended_observables);
+    if (format == stim::SampleFormat::SAMPLE_FORMAT_B8) {
+        // The set bits are appended in increasing order, so any observables (and padding bits) are at the end.
+        size_t first_new_hit = shot.hits.size();
+        pm::append_set_bit_indices(p, record_end - p, shot.hits);
+        while (shot.hits.size() > first_new_hit && shot.hits.back() >= num_detectors) {
+            if (shot.hits.back() < num_bits_per_record)
+                set_bit(shot.hits.back(), shot);
+            shot.hits.pop_back();
+        }
+    } else {
+        size_t bit = 0;
+        for (; p != record_end; p++) {
+            bit += *p;
+            if (*p != 255) {
+                if (bit == num_bits_per_record)
+                    break;
+                set_bit(bit, shot);
+                bit++;
+            }
+        }
+    }
+    range.begin = record_end;
+    return true;
+}
+
+bool pm::MappedShotFile::read_next_shot(stim::SparseShot& shot) {
+    return read_shot(cursor, shot);
+}
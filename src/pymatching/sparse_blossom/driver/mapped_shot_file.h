@@ -0,0 +1,87 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_MAPPED_SHOT_FILE_H
+#define PYMATCHING2_MAPPED_SHOT_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stim.h"
+
+namespace pm {
+
+/// A section of a MappedShotFile containing a whole number of shot records. Reading a shot from the range
+/// advances `begin' past that shot's record.
+struct ShotByteRange {
+    const uint8_t* begin;
+    const uint8_t* end;
+
+    inline bool empty() const {
+        return begin == end;
+    }
+};
+
+/// A shot data file in the `b8' or `r8' format that is memory mapped, so that detection events can be
+/// extracted directly from the mapped pages, without copying the data through stdio buffers.
+///
+/// As well as reading the shots in order, the file can be split into disjoint ranges of whole shot records,
+/// so that different threads can read (and decode) different sections of the file concurrently.
+class MappedShotFile {
+   public:
+    /// Maps the file at `path' into memory. Each record contains `num_detectors' detector bits followed by
+    /// `num_appended_observables' observable bits.
+    MappedShotFile(
+        const std::string& path, stim::SampleFormat format, size_t num_detectors, size_t num_appended_observables);
+    ~MappedShotFile();
+    MappedShotFile(const MappedShotFile&) = delete;
+    MappedShotFile& operator=(const MappedShotFile&) = delete;
+
+    /// Returns true if files in the given format can be read by a MappedShotFile.
+    static bool supports_format(stim::SampleFormat format);
+
+    /// The range containing every shot in the file.
+    ShotByteRange all() const;
+    /// Splits the file into at most `num_ranges' non-empty ranges of whole shot records, in file order,
+    /// containing roughly equal numbers of bytes.
+    std::vector<ShotByteRange> split(size_t num_ranges) const;
+    /// Reads the next shot in `range' into `shot', which should already have been cleared. The detection events
+    /// are appended to `shot.hits' and the appended observables (if any) are set in `shot.obs_mask'.
+    /// Returns false if `range' is empty.
+    bool read_shot(ShotByteRange& range, stim::SparseShot& shot) const;
+    /// Reads the next shot in the whole file, in order.
+    bool read_next_shot(stim::SparseShot& shot);
+
+    size_t size_in_bytes() const;
+
+   private:
+    /// Returns a pointer to the end of the record starting at `p'.
+    const uint8_t* find_end_of_record(const uint8_t* p, const uint8_t* end) const;
+    void set_bit(size_t k, stim::SparseShot& shot) const;
+
+    stim::SampleFormat format;
+    size_t num_detectors;
+    size_t num_appended_observables;
+    size_t num_bits_per_record;
+    const uint8_t* data;
+    size_t num_bytes;
+    ShotByteRange cursor;
+    /// Only used on platforms without mmap, where the file is read into memory instead.
+    std::vector<uint8_t> fallback_buffer;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_MAPPED_SHOT_FILE_H
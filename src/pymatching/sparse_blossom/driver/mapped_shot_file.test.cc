@@ -0,0 +1,151 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/mapped_shot_file.h"
+
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+#include "stim.h"
+
+// Defined in mwpm_decoding.test.cc
+std::string find_test_data_file(const char* name);
+
+namespace {
+
+struct ExpectedShot {
+    std::vector<uint64_t> hits;
+    uint64_t obs_mask;
+    bool operator==(const ExpectedShot& other) const {
+        return hits == other.hits && obs_mask == other.obs_mask;
+    }
+};
+
+std::vector<ExpectedShot> read_with_stim(const std::string& path, stim::SampleFormat format, size_t dets, size_t obs) {
+    FILE* f = fopen(path.c_str(), "rb");
+    auto reader = stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(f, format, 0, dets, obs);
+    std::vector<ExpectedShot> shots;
+    stim::SparseShot shot;
+    while (reader->start_and_read_entire_record(shot)) {
+        shots.push_back({shot.hits, shot.obs_mask_as_u64()});
+        shot.clear();
+    }
+    fclose(f);
+    return shots;
+}
+
+std::vector<ExpectedShot> read_range(const pm::MappedShotFile& file, pm::ShotByteRange range) {
+    std::vector<ExpectedShot> shots;
+    stim::SparseShot shot;
+    while (file.read_shot(range, shot)) {
+        shots.push_back({shot.hits, shot.obs_mask_as_u64()});
+        shot.clear();
+    }
+    return shots;
+}
+
+void check_mapped_file_matches_stim(const std::string& path, stim::SampleFormat format, size_t dets, size_t obs) {
+    auto expected = read_with_stim(path, format, dets, obs);
+    ASSERT_FALSE(expected.empty());
+    pm::MappedShotFile file(path, format, dets, obs);
+
+    std::vector<ExpectedShot> in_order;
+    stim::SparseShot shot;
+    while (file.read_next_shot(shot)) {
+        in_order.push_back({shot.hits, shot.obs_mask_as_u64()});
+        shot.clear();
+    }
+    ASSERT_EQ(in_order, expected);
+    ASSERT_EQ(read_range(file, file.all()), expected);
+
+    for (size_t num_ranges : {1, 2, 3, 17, 5000}) {
+        auto ranges = file.split(num_ranges);
+        ASSERT_LE(ranges.size(), num_ranges);
+        ASSERT_EQ(ranges.front().begin, file.all().begin);
+        ASSERT_EQ(ranges.back().end, file.all().end);
+        std::vector<ExpectedShot> concatenated;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            ASSERT_FALSE(ranges[i].empty());
+            if (i > 0) {
+                ASSERT_EQ(ranges[i].begin, ranges[i - 1].end);
+            }
+            auto shots = read_range(file, ranges[i]);
+            concatenated.insert(concatenated.end(), shots.begin(), shots.end());
+        }
+        ASSERT_EQ(concatenated, expected);
+    }
+}
+
+}  // namespace
+
+TEST(MappedShotFile, ReadB8) {
+    auto dem_file = std::fopen(find_test_data_file("negative_weight_circuit.dem").c_str(), "r");
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    check_mapped_file_matches_stim(
+        find_test_data_file("negative_weight_circuit_1000.b8"),
+        stim::SampleFormat::SAMPLE_FORMAT_B8,
+        dem.count_detectors(),
+        dem.count_observables());
+}
+
+TEST(MappedShotFile, ReadR8) {
+    char path[] = "/tmp/pymatching_mapped_shot_file_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    FILE* f = fdopen(fd, "wb");
+    auto writer = stim::MeasureRecordWriter::make(f, stim::SampleFormat::SAMPLE_FORMAT_R8);
+    // 600 detectors followed by 2 observables, including long runs of zeros and set bits at both ends.
+    size_t num_bits = 602;
+    for (size_t shot = 0; shot < 300; shot++) {
+        for (size_t k = 0; k < num_bits; k++) {
+            bool bit = (k * 7 + shot * 13) % 257 == 0 || (shot % 5 == 0 && k == 0) || (shot % 3 == 0 && k == 601);
+            writer->write_bit(bit);
+        }
+        writer->write_end();
+    }
+    fclose(f);
+    check_mapped_file_matches_stim(path, stim::SampleFormat::SAMPLE_FORMAT_R8, 600, 2);
+    remove(path);
+}
+
+TEST(MappedShotFile, EmptyFileAndErrors) {
+    char path[] = "/tmp/pymatching_mapped_shot_file_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_NE(fd, -1);
+    close(fd);
+    {
+        pm::MappedShotFile file(path, stim::SampleFormat::SAMPLE_FORMAT_B8, 10, 0);
+        stim::SparseShot shot;
+        ASSERT_FALSE(file.read_next_shot(shot));
+        ASSERT_TRUE(file.split(4).empty());
+    }
+    FILE* f = fopen(path, "wb");
+    uint8_t truncated[3] = {1, 2, 3};
+    fwrite(truncated, 1, 3, f);
+    fclose(f);
+    {
+        pm::MappedShotFile file(path, stim::SampleFormat::SAMPLE_FORMAT_B8, 16, 0);
+        stim::SparseShot shot;
+        ASSERT_TRUE(file.read_next_shot(shot));
+        ASSERT_EQ(shot.hits, std::vector<uint64_t>({0, 9}));
+        shot.clear();
+        ASSERT_THROW(file.read_next_shot(shot), std::invalid_argument);
+    }
+    ASSERT_THROW(
+        pm::MappedShotFile(path, stim::SampleFormat::SAMPLE_FORMAT_01, 16, 0), std::invalid_argument);
+    remove(path);
+    ASSERT_THROW(pm::MappedShotFile(path, stim::SampleFormat::SAMPLE_FORMAT_B8, 16, 0), std::invalid_argument);
+}
@@ -0,0 +1,178 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/multi_graph_decoding.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/shot_scheduler.h"
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+
+pm::MultiGraphDecoder::MultiGraphDecoder(
+    const std::vector<UserGraph*>& graphs, const std::vector<size_t>& first_detectors, size_t num_threads)
+    : graphs(graphs), first_detectors(first_detectors), _num_detectors(0), _num_observables(0) {
+    if (graphs.empty())
+        throw std::invalid_argument("A multi-graph decoder needs at least one graph.");
+    if (first_detectors.size() != graphs.size())
+        throw std::invalid_argument(
+            "Expected the first detector of each of the " + std::to_string(graphs.size()) + " graphs, but got " +
+            std::to_string(first_detectors.size()) + ".");
+    if (num_threads == 0)
+        throw std::invalid_argument("A multi-graph decoder needs at least one thread.");
+
+    for (size_t g = 0; g < graphs.size(); g++) {
+        graphs[g]->freeze();
+        graph_num_detectors.push_back(graphs[g]->get_num_detectors());
+        graph_num_observables.push_back(graphs[g]->get_num_observables());
+        first_observables.push_back(_num_observables);
+        _num_observables += graph_num_observables.back();
+        _num_detectors = std::max(_num_detectors, first_detectors[g] + graph_num_detectors.back());
+    }
+    mwpms.resize(num_threads);
+    for (auto& thread_mwpms : mwpms) {
+        for (auto graph : graphs)
+            thread_mwpms.push_back(graph->acquire_mwpm());
+    }
+}
+
+size_t pm::MultiGraphDecoder::num_graphs() const {
+    return graphs.size();
+}
+
+size_t pm::MultiGraphDecoder::num_threads() const {
+    return mwpms.size();
+}
+
+size_t pm::MultiGraphDecoder::num_detectors() const {
+    return _num_detectors;
+}
+
+size_t pm::MultiGraphDecoder::num_observables() const {
+    return _num_observables;
+}
+
+size_t pm::MultiGraphDecoder::first_detector(size_t g) const {
+    return first_detectors[g];
+}
+
+size_t pm::MultiGraphDecoder::first_observable(size_t g) const {
+    return first_observables[g];
+}
+
+size_t pm::MultiGraphDecoder::num_prediction_bytes(bool bit_packed_predictions) const {
+    return bit_packed_predictions ? (_num_observables + 7) >> 3 : _num_observables;
+}
+
+void pm::MultiGraphDecoder::decode_batch(
+    const uint8_t* shots,
+    size_t num_shots,
+    size_t row_stride,
+    bool bit_packed_shots,
+    uint8_t* predictions,
+    bool bit_packed_predictions,
+    double* weights) {
+    size_t num_graphs = graphs.size();
+    size_t prediction_bytes = num_prediction_bytes(bit_packed_predictions);
+    if (num_shots == 0)
+        return;
+
+    // Each (graph, shot) pair is decoded separately, taken from the scheduler in the order of the graphs so that a
+    // thread mostly keeps to the Mwpm of one graph. Every graph writes its own bytes of the unpacked predictions, so
+    // the threads never write to the same byte. Bit-packed predictions are packed afterwards, since the observables
+    // of different graphs can share a byte.
+    size_t num_items = num_graphs * num_shots;
+    size_t num_workers = std::min(mwpms.size(), num_items);
+    std::vector<uint8_t> unpacked_predictions;
+    uint8_t* obs_rows = predictions;
+    if (bit_packed_predictions) {
+        unpacked_predictions.assign(num_shots * _num_observables, 0);
+        obs_rows = unpacked_predictions.data();
+    } else {
+        std::fill(predictions, predictions + num_shots * prediction_bytes, 0);
+    }
+    std::vector<total_weight_int> item_weights(weights == nullptr ? 0 : num_items, 0);
+
+    ShotScheduler scheduler(num_items, num_workers);
+    auto decode_items_of_worker = [&](size_t worker) {
+        std::vector<uint64_t> detection_events;
+        size_t begin, end;
+        while (scheduler.next_range(worker, begin, end)) {
+            for (size_t item = begin; item < end; item++) {
+                size_t g = item / num_shots;
+                size_t i = item % num_shots;
+                const uint8_t* row = shots + i * row_stride;
+                size_t d = first_detectors[g];
+                detection_events.clear();
+                if (bit_packed_shots) {
+                    append_set_bit_indices_in_range(row, d, d + graph_num_detectors[g], detection_events);
+                } else {
+                    append_nonzero_byte_indices(row + d, graph_num_detectors[g], detection_events);
+                }
+                total_weight_int weight = 0;
+                decode_detection_events(
+                    *mwpms[worker][g],
+                    detection_events,
+                    obs_rows + i * _num_observables + first_observables[g],
+                    weight);
+                if (weights != nullptr)
+                    item_weights[item] = weight;
+            }
+        }
+    };
+
+    if (num_workers == 1) {
+        decode_items_of_worker(0);
+    } else {
+        std::vector<std::exception_ptr> errors(num_workers);
+        std::vector<std::thread> workers;
+        workers.reserve(num_workers);
+        for (size_t w = 0; w < num_workers; w++) {
+            workers.emplace_back([&, w]() {
+                try {
+                    decode_items_of_worker(w);
+                } catch (...) {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        for (auto& error : errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+    if (bit_packed_predictions) {
+        std::fill(predictions, predictions + num_shots * prediction_bytes, 0);
+        for (size_t i = 0; i < num_shots; i++) {
+            const uint8_t* obs = obs_rows + i * _num_observables;
+            uint8_t* packed = predictions + i * prediction_bytes;
+            for (size_t k = 0; k < _num_observables; k++)
+                packed[k >> 3] |= (obs[k] & 1) << (k & 7);
+        }
+    }
+    if (weights != nullptr) {
+        for (size_t i = 0; i < num_shots; i++) {
+            double total = 0;
+            for (size_t g = 0; g < num_graphs; g++)
+                total += (double)item_weights[g * num_shots + i] / mwpms[0][g]->flooder.graph.normalising_constant;
+            weights[i] = total;
+        }
+    }
+}
@@ -0,0 +1,81 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_MULTI_GRAPH_DECODING_H
+#define PYMATCHING2_MULTI_GRAPH_DECODING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+
+namespace pm {
+
+/// Decodes several independent matching graphs (e.g. the X and Z sectors of several surface code patches) from one
+/// combined batch of shots, in which each graph is given a range of the detector columns, and writes the predictions
+/// of every graph side by side, in the order of the graphs.
+///
+/// The graphs are frozen (see `UserGraph::freeze'), and each of the `num_threads' threads decodes with its own Mwpm
+/// of each graph, leased when the decoder is created. Decoding a batch splits the shots of every graph among the
+/// threads, so a batch of a single shot of many graphs is decoded in parallel too.
+class MultiGraphDecoder {
+   public:
+    /// Decodes the detectors [first_detectors[g], first_detectors[g] + graphs[g]->get_num_detectors()) of each shot
+    /// with `graphs[g]'. The ranges of different graphs may overlap. Throws std::invalid_argument if there are no
+    /// graphs, or `first_detectors' doesn't have an entry for each graph.
+    MultiGraphDecoder(
+        const std::vector<UserGraph*>& graphs, const std::vector<size_t>& first_detectors, size_t num_threads);
+
+    size_t num_graphs() const;
+    size_t num_threads() const;
+    /// The number of detector columns of a combined shot: the end of the last range of detectors of a graph.
+    size_t num_detectors() const;
+    /// The number of observables of all of the graphs.
+    size_t num_observables() const;
+    /// The first detector column of graph `g' in a combined shot, and the first column of its observables in the
+    /// predictions.
+    size_t first_detector(size_t g) const;
+    size_t first_observable(size_t g) const;
+
+    /// Decodes the `num_shots' shots in `shots', whose rows are `row_stride' bytes apart and hold `num_detectors()'
+    /// detector columns, as bits (in little-endian order) if `bit_packed_shots' or else as bytes. Row i of
+    /// `predictions' (`num_prediction_bytes(bit_packed_predictions)' bytes) is overwritten with the predicted
+    /// observables of shot i, bit packed if `bit_packed_predictions'. If `weights' isn't null, weights[i] is set to
+    /// the total weight of the solutions of shot i, in the units of the edge weights of each graph.
+    void decode_batch(
+        const uint8_t* shots,
+        size_t num_shots,
+        size_t row_stride,
+        bool bit_packed_shots,
+        uint8_t* predictions,
+        bool bit_packed_predictions,
+        double* weights);
+    size_t num_prediction_bytes(bool bit_packed_predictions) const;
+
+   private:
+    std::vector<UserGraph*> graphs;
+    std::vector<size_t> first_detectors;
+    std::vector<size_t> first_observables;
+    /// The Mwpm of each graph used by each thread, indexed by thread and then by graph.
+    std::vector<std::vector<MwpmLease>> mwpms;
+    std::vector<size_t> graph_num_detectors;
+    std::vector<size_t> graph_num_observables;
+    size_t _num_detectors;
+    size_t _num_observables;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_MULTI_GRAPH_DECODING_H
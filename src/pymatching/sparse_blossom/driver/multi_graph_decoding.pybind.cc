@@ -0,0 +1,116 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/multi_graph_decoding.pybind.h"
+
+#include <memory>
+#include <string>
+
+#include "pymatching/sparse_blossom/driver/multi_graph_decoding.h"
+#include "pymatching/sparse_blossom/driver/user_graph.pybind.h"
+
+using namespace py::literals;
+
+namespace {
+
+/// Owns a `pm::MultiGraphDecoder', and keeps the Python objects of its graphs alive for as long as it is.
+struct PyMultiGraphDecoder {
+    std::vector<py::object> graph_objects;
+    std::unique_ptr<pm::MultiGraphDecoder> decoder;
+
+    PyMultiGraphDecoder(const py::sequence &graphs, const std::vector<size_t> &first_detectors, size_t num_threads) {
+        std::vector<pm::UserGraph *> graph_ptrs;
+        for (auto graph : graphs) {
+            graph_objects.push_back(py::reinterpret_borrow<py::object>(graph));
+            graph_ptrs.push_back(&graph.cast<pm::UserGraph &>());
+        }
+        decoder = std::make_unique<pm::MultiGraphDecoder>(graph_ptrs, first_detectors, num_threads);
+    }
+};
+
+}  // namespace
+
+void pm_pybind::pybind_multi_graph_decoder(py::module &m) {
+    py::class_<PyMultiGraphDecoder>(m, "MultiGraphDecoder")
+        .def(
+            py::init<const py::sequence &, const std::vector<size_t> &, size_t>(),
+            "graphs"_a,
+            "first_detectors"_a,
+            "num_threads"_a = 1)
+        .def(
+            "decode_batch",
+            [](PyMultiGraphDecoder &self,
+               const pm_pybind::contiguous_array<uint8_t> &shots,
+               bool bit_packed_shots,
+               bool bit_packed_predictions,
+               bool return_weights) {
+                auto &decoder = *self.decoder;
+                if (shots.ndim() != 2)
+                    throw std::invalid_argument(
+                        "`shots` array should have two dimensions, not " + std::to_string(shots.ndim()));
+                size_t num_columns = bit_packed_shots ? (decoder.num_detectors() + 7) >> 3 : decoder.num_detectors();
+                if ((size_t)shots.shape(1) < num_columns)
+                    throw std::invalid_argument(
+                        "`shots` array should have at least " + std::to_string(num_columns) + " columns" +
+                        (bit_packed_shots ? " (ceil(num_detectors/8))" : " (the number of detectors)") +
+                        ", but instead has " + std::to_string(shots.shape(1)) + " columns.");
+
+                size_t num_shots = shots.shape(0);
+                size_t num_prediction_bytes = decoder.num_prediction_bytes(bit_packed_predictions);
+                py::array_t<uint8_t> predictions(
+                    std::vector<py::ssize_t>{(py::ssize_t)num_shots, (py::ssize_t)num_prediction_bytes});
+                py::array_t<double> weights((py::ssize_t)(return_weights ? num_shots : 0));
+                const uint8_t *shots_ptr = shots.data();
+                uint8_t *predictions_ptr = predictions.mutable_data();
+                double *weights_ptr = return_weights ? weights.mutable_data() : nullptr;
+                {
+                    // The graphs are frozen, so no other Python thread can change them while they are decoded.
+                    py::gil_scoped_release release;
+                    decoder.decode_batch(
+                        shots_ptr,
+                        num_shots,
+                        shots.shape(1),
+                        bit_packed_shots,
+                        predictions_ptr,
+                        bit_packed_predictions,
+                        weights_ptr);
+                }
+                return py::make_tuple(predictions, return_weights ? py::object(weights) : py::none());
+            },
+            "shots"_a,
+            "bit_packed_shots"_a = false,
+            "bit_packed_predictions"_a = false,
+            "return_weights"_a = false)
+        .def_property_readonly(
+            "num_detectors",
+            [](const PyMultiGraphDecoder &self) {
+                return self.decoder->num_detectors();
+            })
+        .def_property_readonly(
+            "num_observables",
+            [](const PyMultiGraphDecoder &self) {
+                return self.decoder->num_observables();
+            })
+        .def_property_readonly(
+            "num_threads",
+            [](const PyMultiGraphDecoder &self) {
+                return self.decoder->num_threads();
+            })
+        .def_property_readonly("first_observables", [](const PyMultiGraphDecoder &self) {
+            std::vector<size_t> result;
+            for (size_t g = 0; g < self.decoder->num_graphs(); g++)
+                result.push_back(self.decoder->first_observable(g));
+            return result;
+        });
+}
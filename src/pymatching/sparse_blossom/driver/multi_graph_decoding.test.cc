@@ -0,0 +1,99 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/multi_graph_decoding.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+
+TEST(MultiGraphDecoder, MatchesDecodingEachGraph) {
+    // Graphs of 5, 9 and 5 detectors and 6, 10 and 6 observables, so that neither their detectors nor their
+    // observables are aligned to bytes. The third graph is given the same detectors as the first.
+    std::vector<pm::UserGraph> graphs;
+    graphs.push_back(pm::repetition_code_graph(5, 6, 0.1));
+    graphs.push_back(pm::repetition_code_graph(9, 10, 0.2));
+    graphs.push_back(pm::repetition_code_graph(5, 6, -0.1));
+    std::vector<size_t> first_detectors = {0, 5, 0};
+
+    std::mt19937 rng(3);
+    size_t num_shots = 101;
+    size_t num_detectors = 14;
+    std::vector<uint8_t> shots(num_shots * num_detectors);
+    std::vector<uint8_t> packed_shots(num_shots * 2, 0);
+    for (size_t i = 0; i < num_shots; i++) {
+        for (size_t d = 0; d < num_detectors; d++) {
+            shots[i * num_detectors + d] = (rng() % 4) == 0;
+            packed_shots[i * 2 + (d >> 3)] |= shots[i * num_detectors + d] << (d & 7);
+        }
+    }
+
+    // The predictions and weights of decoding each graph on its own.
+    size_t num_observables = 22;
+    std::vector<uint8_t> expected(num_shots * num_observables, 0);
+    std::vector<double> expected_weights(num_shots, 0);
+    size_t first_observable = 0;
+    for (size_t g = 0; g < graphs.size(); g++) {
+        auto& mwpm = graphs[g].get_mwpm();
+        for (size_t i = 0; i < num_shots; i++) {
+            std::vector<uint64_t> detection_events;
+            for (size_t d = 0; d < graphs[g].get_num_detectors(); d++) {
+                if (shots[i * num_detectors + first_detectors[g] + d])
+                    detection_events.push_back(d);
+            }
+            pm::total_weight_int weight = 0;
+            pm::decode_detection_events(
+                mwpm, detection_events, expected.data() + i * num_observables + first_observable, weight);
+            expected_weights[i] += (double)weight / mwpm.flooder.graph.normalising_constant;
+        }
+        first_observable += graphs[g].get_num_observables();
+    }
+
+    std::vector<pm::UserGraph*> graph_ptrs = {&graphs[0], &graphs[1], &graphs[2]};
+    for (size_t num_threads : {1, 4}) {
+        pm::MultiGraphDecoder decoder(graph_ptrs, first_detectors, num_threads);
+        ASSERT_TRUE(graphs[1].is_frozen());
+        ASSERT_EQ(decoder.num_graphs(), 3);
+        ASSERT_EQ(decoder.num_threads(), num_threads);
+        ASSERT_EQ(decoder.num_detectors(), num_detectors);
+        ASSERT_EQ(decoder.num_observables(), num_observables);
+        ASSERT_EQ(decoder.first_detector(1), 5);
+        ASSERT_EQ(decoder.first_observable(2), 16);
+        ASSERT_EQ(decoder.num_prediction_bytes(true), 3);
+
+        std::vector<uint8_t> predictions(num_shots * num_observables, 7);
+        std::vector<double> weights(num_shots);
+        decoder.decode_batch(shots.data(), num_shots, num_detectors, false, predictions.data(), false, weights.data());
+        ASSERT_EQ(predictions, expected);
+        for (size_t i = 0; i < num_shots; i++)
+            ASSERT_NEAR(weights[i], expected_weights[i], 1e-6);
+
+        std::vector<uint8_t> packed_predictions(num_shots * 3, 7);
+        decoder.decode_batch(packed_shots.data(), num_shots, 2, true, packed_predictions.data(), true, nullptr);
+        for (size_t i = 0; i < num_shots; i++) {
+            for (size_t k = 0; k < num_observables; k++)
+                ASSERT_EQ((packed_predictions[i * 3 + (k >> 3)] >> (k & 7)) & 1, expected[i * num_observables + k]);
+        }
+    }
+}
+
+TEST(MultiGraphDecoder, InvalidArguments) {
+    auto graph = pm::repetition_code_graph(3, 4, 0);
+    ASSERT_THROW(pm::MultiGraphDecoder({}, {}, 1), std::invalid_argument);
+    ASSERT_THROW(pm::MultiGraphDecoder({&graph}, {0, 3}, 1), std::invalid_argument);
+    ASSERT_THROW(pm::MultiGraphDecoder({&graph}, {0}, 0), std::invalid_argument);
+}
@@ -14,6 +14,10 @@
 
 #include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
 
+#include <algorithm>
+#include <chrono>
+#include <span>
+
 pm::ExtendedMatchingResult::ExtendedMatchingResult() : obs_crossed(), weight(0) {
 }
 
@@ -53,7 +57,7 @@ void pm::fill_bit_vector_from_obs_mask(pm::obs_int obs_mask, uint8_t* obs_begin_
     if (num_observables > max_obs)
         throw std::invalid_argument("Too many observables");
     for (size_t i = 0; i < num_observables; i++)
-        *(obs_begin_ptr + i) ^= (obs_mask & ((pm::obs_int)1 << i)) >> i;
+        *(obs_begin_ptr + i) ^= pm::obs_int_bit(obs_mask, i);
 }
 
 pm::obs_int pm::bit_vector_to_obs_mask(const std::vector<uint8_t>& bit_vector) {
@@ -62,87 +66,245 @@ pm::obs_int pm::bit_vector_to_obs_mask(const std::vector<uint8_t>& bit_vector) {
     if (num_observables > max_obs)
         throw std::invalid_argument("Too many observables");
     pm::obs_int obs_mask = 0;
-    for (size_t i = 0; i < num_observables; i++)
-        obs_mask ^= bit_vector[i] << i;
+    for (size_t i = 0; i < num_observables; i++) {
+        if (bit_vector[i])
+            obs_mask ^= (pm::obs_int)1 << i;
+    }
     return obs_mask;
 }
 
 pm::Mwpm pm::detector_error_model_to_mwpm(
     const stim::DetectorErrorModel& detector_error_model,
     pm::weight_int num_distinct_weights,
-    bool ensure_search_flooder_included) {
-    auto weighted_graph = pm::detector_error_model_to_weighted_graph(detector_error_model);
-    return weighted_graph.to_mwpm(num_distinct_weights, ensure_search_flooder_included);
+    bool ensure_search_flooder_included,
+    bool reorder_nodes) {
+    auto edge_list = pm::detector_error_model_to_edge_list(detector_error_model);
+    if (reorder_nodes)
+        edge_list.reorder_nodes();
+    return edge_list.to_mwpm(num_distinct_weights, ensure_search_flooder_included);
+}
+
+std::vector<pm::Mwpm> pm::detector_error_model_to_mwpms(
+    const stim::DetectorErrorModel& detector_error_model,
+    pm::weight_int num_distinct_weights,
+    size_t num_mwpms,
+    bool reorder_nodes,
+    bool periodic_topology) {
+    std::vector<pm::Mwpm> mwpms;
+    if (reorder_nodes && periodic_topology)
+        throw std::invalid_argument("Reordering the nodes would break up the rounds of a periodic topology.");
+    if (num_mwpms == 0)
+        return mwpms;
+    auto edge_list = pm::detector_error_model_to_edge_list(detector_error_model, num_mwpms);
+    if (reorder_nodes)
+        edge_list.reorder_nodes();
+    mwpms.reserve(num_mwpms);
+    mwpms.push_back(edge_list.to_mwpm(num_distinct_weights, false));
+    if (periodic_topology)
+        mwpms[0].flooder.graph.compress_periodic_topology();
+    bool needs_search_graph = edge_list.num_observables > sizeof(pm::obs_int) * 8;
+    if (needs_search_graph && periodic_topology)
+        mwpms[0].search_flooder.graph.set_topology(mwpms[0].flooder.graph.topology);
+    mwpms[0].small_syndrome_cache.precompute_boundary_distances(mwpms[0].flooder.graph);
+    mwpms[0].small_syndrome_cache.precompute_all_pairs_paths(mwpms[0].flooder.graph);
+    while (mwpms.size() < num_mwpms) {
+        pm::GraphFlooder flooder(mwpms[0].flooder.graph.clone_sharing_topology());
+        if (needs_search_graph) {
+            mwpms.emplace_back(
+                std::move(flooder), pm::SearchFlooder(mwpms[0].search_flooder.graph.clone_sharing_topology()));
+        } else {
+            mwpms.emplace_back(std::move(flooder));
+        }
+        mwpms.back().flooder.sync_negative_weight_observables_and_detection_events();
+        mwpms.back().small_syndrome_cache.boundary_distances = mwpms[0].small_syndrome_cache.boundary_distances;
+        mwpms.back().small_syndrome_cache.all_pairs_paths = mwpms[0].small_syndrome_cache.all_pairs_paths;
+    }
+    return mwpms;
+}
+
+/// Throws std::invalid_argument (after clearing anything already added to `mwpm', so that it can still be used) if
+/// `detection' is not the index of a node of the graph.
+void check_detection_event_in_graph(pm::Mwpm& mwpm, uint64_t detection) {
+    if (detection >= mwpm.flooder.graph.nodes.size()) {
+        mwpm.reset();
+        throw std::invalid_argument(
+            "The detection event with index " + std::to_string(detection) +
+            " does not correspond to a node in the graph, which only has " +
+            std::to_string(mwpm.flooder.graph.nodes.size()) + " nodes.");
+    }
+}
+
+bool is_user_graph_boundary_node(const pm::MatchingGraph& graph, uint64_t detection) {
+    return detection < graph.is_user_graph_boundary_node.size() && graph.is_user_graph_boundary_node[detection];
+}
+
+/// Sets `mwpm.flooder.flooded_detection_events' to the detection events flooded for a shot on a graph with negative
+/// edge weights: the symmetric difference of the shot's detection events and the negative weight detection events,
+/// leaving out those of the shot alone that are on boundary nodes. Both are walked once, in sorted order, so the
+/// nodes in the result are the only ones visited again while decoding the shot.
+void merge_negative_weight_detection_events(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
+    auto& flooder = mwpm.flooder;
+    auto& sorted = flooder.sorted_shot_detection_events;
+    sorted.clear();
+    for (auto detection : detection_events) {
+        check_detection_event_in_graph(mwpm, detection);
+        sorted.push_back(detection);
+    }
+    // Detection events are usually extracted in increasing order already.
+    if (!std::is_sorted(sorted.begin(), sorted.end()))
+        std::sort(sorted.begin(), sorted.end());
+
+    auto& merged = flooder.flooded_detection_events;
+    const auto& negative = flooder.negative_weight_detection_events;
+    merged.clear();
+    size_t i = 0;
+    size_t j = 0;
+    while (i < sorted.size() || j < negative.size()) {
+        if (j == negative.size() || (i < sorted.size() && sorted[i] < negative[j])) {
+            // A detection event repeated within the shot cancels itself out.
+            if (i + 1 < sorted.size() && sorted[i + 1] == sorted[i]) {
+                i += 2;
+            } else {
+                if (!is_user_graph_boundary_node(flooder.graph, sorted[i]))
+                    merged.push_back(sorted[i]);
+                i++;
+            }
+        } else if (i == sorted.size() || negative[j] < sorted[i]) {
+            merged.push_back(negative[j++]);
+        } else {
+            i++;
+            j++;
+        }
+    }
+}
+
+/// The detection events whose regions were flooded for the current shot of `mwpm', whose detection events are
+/// `detection_events'.
+std::span<const uint64_t> flooded_detection_events(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
+    if (mwpm.flooder.negative_weight_detection_events.empty())
+        return detection_events;
+    return mwpm.flooder.flooded_detection_events;
+}
+
+/// Decodes a shot with `decoder', a Union-Find decoder of `mwpm' (see `Mwpm::set_decoder_engine' and
+/// `Mwpm::work_budget'), leaving its correction in `decoder'. The negative weight edges are accounted for in the same
+/// way as for the blossom algorithm.
+void decode_with_union_find(
+    pm::Mwpm& mwpm, pm::UnionFindDecoder& decoder, std::span<const uint64_t> detection_events) {
+    if (!mwpm.flooder.negative_weight_detection_events.empty()) {
+        merge_negative_weight_detection_events(mwpm, detection_events);
+        detection_events = mwpm.flooder.flooded_detection_events;
+    }
+    decoder.decode(mwpm.flooder.graph, detection_events);
 }
 
-void process_timeline_until_completion(pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events) {
+/// Decodes a shot that ran out of work budget with `mwpm.degraded_shot_decoder', and counts it as degraded.
+pm::UnionFindDecoder& decode_degraded_shot(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
+    if (mwpm.degraded_shot_decoder == nullptr)
+        mwpm.degraded_shot_decoder = std::make_unique<pm::UnionFindDecoder>();
+    mwpm.num_degraded_shots++;
+    if constexpr (pm::DECODER_STATS_ENABLED)
+        mwpm.flooder.stats.num_degraded_shots++;
+    decode_with_union_find(mwpm, *mwpm.degraded_shot_decoder, detection_events);
+    return *mwpm.degraded_shot_decoder;
+}
+
+/// Matches pairs of adjacent detection events with the predecoder of `mwpm' (see `Mwpm::predecoder'), adding their
+/// solution to `res', and returns the detection events left to the full algorithm. Returns `detection_events'
+/// unchanged if the predecoder is off, or can't be used because the graph has negative weight edges or too many
+/// observables for an obs_int.
+std::span<const uint64_t> predecode(
+    pm::Mwpm& mwpm, std::span<const uint64_t> detection_events, pm::MatchingResult& res) {
+    auto& predecoder = mwpm.predecoder;
+    if (predecoder.mode == pm::PREDECODER_OFF || detection_events.size() < 2 ||
+        !mwpm.flooder.negative_weight_detection_events.empty() ||
+        mwpm.flooder.graph.num_observables > sizeof(pm::obs_int) * 8)
+        return detection_events;
+    predecoder.predecode(mwpm.flooder.graph, detection_events);
+    res.obs_mask ^= predecoder.obs_mask;
+    res.weight += predecoder.weight;
+    return predecoder.residual_detection_events;
+}
+
+/// Creates the regions of the detection events at the start of a shot, before any flooding.
+void start_timeline(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
     if (!mwpm.flooder.queue.empty()) {
         throw std::invalid_argument("!mwpm.flooder.queue.empty()");
     }
     mwpm.flooder.queue.cur_time = 0;
+    mwpm.flooder.start_shot();
 
     if (mwpm.flooder.negative_weight_detection_events.empty()) {
         // Just add detection events if graph has no negative weights
         for (auto& detection : detection_events) {
-            if (detection >= mwpm.flooder.graph.nodes.size())
-                throw std::invalid_argument(
-                    "The detection event with index " + std::to_string(detection) +
-                    " does not correspond to a node in the graph, which only has " +
-                    std::to_string(mwpm.flooder.graph.nodes.size()) + " nodes.");
-            if (detection + 1 > mwpm.flooder.graph.is_user_graph_boundary_node.size() ||
-                !mwpm.flooder.graph.is_user_graph_boundary_node[detection])
+            check_detection_event_in_graph(mwpm, detection);
+            if (!is_user_graph_boundary_node(mwpm.flooder.graph, detection))
                 mwpm.create_detection_event(&mwpm.flooder.graph.nodes[detection]);
         }
-
     } else {
-        // First mark nodes with negative weight detection events
-        for (auto& det : mwpm.flooder.negative_weight_detection_events) {
-            mwpm.flooder.graph.nodes[det].radius_of_arrival = 1;
-        }
-
-        // Now add detection events for unmarked nodes
-        for (auto& detection : detection_events) {
-            if (detection >= mwpm.flooder.graph.nodes.size())
-                throw std::invalid_argument(
-                    "Detection event index `" + std::to_string(detection) +
-                    "` is larger than any detector node index in the graph.");
-            if (!mwpm.flooder.graph.nodes[detection].radius_of_arrival) {
-                if (detection + 1 > mwpm.flooder.graph.is_user_graph_boundary_node.size() ||
-                    !mwpm.flooder.graph.is_user_graph_boundary_node[detection])
-                    mwpm.create_detection_event(&mwpm.flooder.graph.nodes[detection]);
-            } else {
-                // Unmark node
-                mwpm.flooder.graph.nodes[detection].radius_of_arrival = 0;
-            }
-        }
+        merge_negative_weight_detection_events(mwpm, detection_events);
+        for (auto detection : mwpm.flooder.flooded_detection_events)
+            mwpm.create_detection_event(&mwpm.flooder.graph.nodes[detection]);
+    }
+}
 
-        for (auto& det : mwpm.flooder.negative_weight_detection_events) {
-            if (mwpm.flooder.graph.nodes[det].radius_of_arrival) {
-                // Add a detection event if the node is still marked
-                mwpm.flooder.graph.nodes[det].radius_of_arrival = 0;
-                mwpm.create_detection_event(&mwpm.flooder.graph.nodes[det]);
-            }
-        }
+/// Checks that a perfect matching was found once the flooder has run out of events.
+void finish_timeline(pm::Mwpm& mwpm) {
+    // If some alternating tree nodes remain, a perfect matching cannot be found
+    if (mwpm.node_arena.size() != 0) {
+        mwpm.reset();
+        throw std::invalid_argument(
+            "No perfect matching could be found. This likely means that the syndrome has odd "
+            "parity in the support of a connected component without a boundary.");
     }
+}
 
+void process_timeline_until_completion(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
+    start_timeline(mwpm, detection_events);
     while (true) {
         auto event = mwpm.flooder.run_until_next_mwpm_notification();
         if (event.event_type == pm::NO_EVENT)
             break;
         mwpm.process_event(event);
     }
+    finish_timeline(mwpm);
+}
 
-    // If some alternating tree nodes remain, a perfect matching cannot be found
-    if (mwpm.node_arena.allocated.size() != mwpm.node_arena.available.size()) {
-        mwpm.reset();
-        throw std::invalid_argument(
-            "No perfect matching could be found. This likely means that the syndrome has odd "
-            "parity in the support of a connected component without a boundary.");
+/// Runs `process_timeline_until_completion', unless the work budget of `mwpm' (see `Mwpm::work_budget') runs out
+/// first, in which case `mwpm' is reset and false is returned. The budget is checked after each event passed to the
+/// matcher.
+bool process_timeline_within_budget(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
+    const auto& budget = mwpm.work_budget;
+    if (!budget.is_limited()) {
+        process_timeline_until_completion(mwpm, detection_events);
+        return true;
     }
+    auto start_time = std::chrono::steady_clock::time_point();
+    if (budget.max_nanoseconds != 0)
+        start_time = std::chrono::steady_clock::now();
+    size_t start_dequeues = mwpm.flooder.num_valid_dequeues + mwpm.flooder.num_stale_dequeues;
+    start_timeline(mwpm, detection_events);
+    while (true) {
+        auto event = mwpm.flooder.run_until_next_mwpm_notification();
+        if (event.event_type == pm::NO_EVENT)
+            break;
+        mwpm.process_event(event);
+        size_t num_dequeues = mwpm.flooder.num_valid_dequeues + mwpm.flooder.num_stale_dequeues - start_dequeues;
+        if ((budget.max_flood_check_events != 0 && num_dequeues >= budget.max_flood_check_events) ||
+            (budget.max_nanoseconds != 0 &&
+             (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - start_time)
+                     .count() >= budget.max_nanoseconds)) {
+            mwpm.reset();
+            return false;
+        }
+    }
+    finish_timeline(mwpm);
+    return true;
 }
 
 pm::MatchingResult shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(
-    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events) {
+    pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
     pm::MatchingResult res;
     for (auto& i : detection_events) {
         if (mwpm.flooder.graph.nodes[i].region_that_arrived)
@@ -151,41 +313,340 @@ pm::MatchingResult shatter_blossoms_for_all_detection_events_and_extract_obs_mas
     return res;
 }
 
-void shatter_blossoms_for_all_detection_events_and_extract_match_edges(
-    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events) {
+pm::MatchingResult shatter_blossoms_for_all_detection_events_and_extract_match_edges(
+    pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
+    pm::MatchingResult res;
     for (auto& i : detection_events) {
         if (mwpm.flooder.graph.nodes[i].region_that_arrived)
-            mwpm.shatter_blossom_and_extract_match_edges(
+            res += mwpm.shatter_blossom_and_extract_match_edges(
                 mwpm.flooder.graph.nodes[i].region_that_arrived_top, mwpm.flooder.match_edges);
     }
+    return res;
+}
+
+/// Looks up (computing it with the full algorithm if necessary) the solution for a lone detection event at
+/// `node_index'. Returns false if a lone detection event there cannot be matched.
+bool lookup_boundary_match(pm::Mwpm& mwpm, size_t node_index, pm::MatchingResult& res) {
+    auto& cache = mwpm.small_syndrome_cache;
+    if (cache.state(node_index) == pm::BOUNDARY_MATCH_UNKNOWN) {
+        uint64_t lone_event_storage = node_index;
+        std::span<const uint64_t> lone_event(&lone_event_storage, 1);
+        try {
+            process_timeline_until_completion(mwpm, lone_event);
+        } catch (const std::invalid_argument&) {
+            cache.set_boundary_unreachable(node_index);
+            return false;
+        }
+        auto lone_res = shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(mwpm, lone_event);
+        cache.set_boundary_match(node_index, lone_res.obs_mask, lone_res.weight);
+    }
+    if (cache.state(node_index) == pm::BOUNDARY_MATCH_UNREACHABLE)
+        return false;
+    res.obs_mask = cache.boundary_match_obs_masks[node_index];
+    res.weight = cache.boundary_match_weights[node_index];
+    return true;
+}
+
+/// Fast path for syndromes with at most two detection events, which are common at low physical error rates, or (for
+/// small graphs) with at most SmallSyndromeCache::MAX_LOOKUP_DETECTION_EVENTS detection events.
+/// Sets `res' to the solution the full algorithm would find and returns true, or returns false if the syndrome
+/// must be decoded with the full algorithm. The negative edge weight corrections are not included in `res'.
+bool try_decode_small_syndrome(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events, pm::MatchingResult& res) {
+    auto& graph = mwpm.flooder.graph;
+    if (!mwpm.small_syndrome_cache.enabled ||
+        detection_events.size() > pm::SmallSyndromeCache::MAX_LOOKUP_DETECTION_EVENTS ||
+        !mwpm.flooder.negative_weight_detection_events.empty() ||
+        graph.num_observables > sizeof(pm::obs_int) * 8)
+        return false;
+    auto& cache = mwpm.small_syndrome_cache;
+    if (cache.boundary_match_states.size() != graph.nodes.size())
+        cache.reset(graph.nodes.size());
+    // Small graphs are decoded with a lookup table of all shortest paths, which is built on first use.
+    const pm::AllPairsPaths* all_pairs_paths = cache.precompute_all_pairs_paths(graph);
+    if (detection_events.size() > 2 && all_pairs_paths == nullptr)
+        return false;
+
+    // Drop detection events on boundary nodes of a UserGraph, as process_timeline_until_completion does.
+    size_t events[pm::SmallSyndromeCache::MAX_LOOKUP_DETECTION_EVENTS];
+    size_t num_events = 0;
+    for (auto detection : detection_events) {
+        if (detection >= graph.nodes.size())
+            return false;
+        if (detection + 1 > graph.is_user_graph_boundary_node.size() || !graph.is_user_graph_boundary_node[detection])
+            events[num_events++] = detection;
+    }
+
+    if (num_events == 0) {
+        res = pm::MatchingResult();
+        return true;
+    }
+    if (all_pairs_paths != nullptr && cache.match_with_all_pairs_paths(events, num_events, res.obs_mask, res.weight))
+        return true;
+    if (num_events > 2)
+        return false;
+    // The lookup table can't predict the choice between equally good solutions, so the lone solutions found by the
+    // full algorithm are used instead.
+    const pm::BoundaryDistances* boundary_distances = cache.boundary_distances.get();
+    if (boundary_distances != nullptr) {
+        for (size_t k = 0; k < num_events; k++) {
+            if (!boundary_distances->reaches_boundary(events[k]))
+                return false;
+        }
+    }
+    if (num_events == 1)
+        return lookup_boundary_match(mwpm, events[0], res);
+    if (events[0] == events[1])
+        return false;
+
+    // If the regions grown from the two events could touch before both reach the boundary, they may be matched
+    // to each other instead. With precomputed boundary distances, this is checked before computing any lone
+    // solutions that would not be used.
+    if (boundary_distances != nullptr) {
+        pm::total_weight_int max_distance =
+            boundary_distances->distances[events[0]] + boundary_distances->distances[events[1]];
+        if (cache.is_within_distance(graph, events[0], events[1], max_distance))
+            return false;
+    }
+    pm::MatchingResult res_u, res_v;
+    if (!lookup_boundary_match(mwpm, events[0], res_u) || !lookup_boundary_match(mwpm, events[1], res_v))
+        return false;
+    if (boundary_distances == nullptr &&
+        cache.is_within_distance(graph, events[0], events[1], res_u.weight + res_v.weight))
+        return false;
+    res = res_u + res_v;
+    return true;
+}
+
+/// Shatters the regions left by flooding into the solution (without the negative edge weight corrections), which is
+/// stored in the syndrome cache.
+pm::MatchingResult extract_flooded_solution(pm::Mwpm& mwpm, std::span<const uint64_t> detection_events) {
+    auto res = shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(
+        mwpm, flooded_detection_events(mwpm, detection_events));
+    mwpm.syndrome_cache.insert_last_found(res.obs_mask, res.weight);
+    return res;
 }
 
+namespace {
+
+/// Adds the time since the previous lap to a phase of a `DecodePhaseTimes', if there is one.
+struct PhaseTimer {
+    pm::DecodePhaseTimes* phase_times;
+    std::chrono::steady_clock::time_point last;
+
+    explicit PhaseTimer(pm::DecodePhaseTimes* phase_times) : phase_times(phase_times) {
+        if (phase_times != nullptr)
+            last = std::chrono::steady_clock::now();
+    }
+
+    inline void lap(uint64_t pm::DecodePhaseTimes::*phase) {
+        if (phase_times == nullptr)
+            return;
+        auto now = std::chrono::steady_clock::now();
+        phase_times->*phase += (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
+        last = now;
+    }
+};
+
+}  // namespace
+
 pm::MatchingResult pm::decode_detection_events_for_up_to_64_observables(
-    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events) {
-    process_timeline_until_completion(mwpm, detection_events);
-    auto res = shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(mwpm, detection_events);
-    if (!mwpm.flooder.negative_weight_detection_events.empty())
-        res += shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(
-            mwpm, mwpm.flooder.negative_weight_detection_events);
+    pm::Mwpm& mwpm, std::span<const uint64_t> original_detection_events, DecodePhaseTimes* phase_times) {
+    PhaseTimer timer(phase_times);
+    auto detection_events = mwpm.flooder.graph.to_graph_node_indices(original_detection_events);
+    timer.lap(&DecodePhaseTimes::syndrome_extraction_ns);
+    pm::MatchingResult res;
+    if (mwpm.union_find != nullptr) {
+        decode_with_union_find(mwpm, *mwpm.union_find, detection_events);
+        timer.lap(&DecodePhaseTimes::flooding_ns);
+        res.obs_mask = mwpm.union_find->correction_obs_mask(mwpm.flooder.graph);
+        res.weight = mwpm.union_find->correction_weight;
+    } else {
+        auto residual_detection_events = predecode(mwpm, detection_events, res);
+        pm::MatchingResult residual_res;
+        if (!try_decode_small_syndrome(mwpm, residual_detection_events, residual_res) &&
+            !mwpm.syndrome_cache.find(residual_detection_events, residual_res.obs_mask, residual_res.weight)) {
+            if (process_timeline_within_budget(mwpm, residual_detection_events)) {
+                timer.lap(&DecodePhaseTimes::flooding_ns);
+                residual_res = extract_flooded_solution(mwpm, residual_detection_events);
+            } else {
+                auto& decoder = decode_degraded_shot(mwpm, residual_detection_events);
+                timer.lap(&DecodePhaseTimes::flooding_ns);
+                residual_res.obs_mask = decoder.correction_obs_mask(mwpm.flooder.graph);
+                residual_res.weight = decoder.correction_weight;
+            }
+        } else {
+            timer.lap(&DecodePhaseTimes::flooding_ns);
+        }
+        res += residual_res;
+    }
     res.obs_mask ^= mwpm.flooder.negative_weight_obs_mask;
     res.weight += mwpm.flooder.negative_weight_sum;
+    timer.lap(&DecodePhaseTimes::result_extraction_ns);
     return res;
 }
 
+void pm::decode_detection_events_interleaved(
+    const std::vector<pm::Mwpm*>& mwpms,
+    const std::vector<std::vector<uint64_t>>& shots,
+    std::vector<pm::MatchingResult>& results) {
+    for (auto* mwpm : mwpms) {
+        if (mwpm->flooder.graph.num_observables > sizeof(pm::obs_int) * 8)
+            throw std::invalid_argument(
+                "Interleaved decoding only supports graphs with at most " + std::to_string(sizeof(pm::obs_int) * 8) +
+                " observables.");
+        // Degrading a shot that runs out of budget would stall the other shots in flight.
+        if (mwpm->work_budget.is_limited())
+            throw std::invalid_argument("Interleaved decoding doesn't support a work budget.");
+    }
+    results.resize(shots.size());
+    if (mwpms.empty() && !shots.empty())
+        throw std::invalid_argument("At least one Mwpm is needed to decode the shots.");
+
+    // Each slot floods one shot with its own Mwpm. The slots take turns to run until their next notification, so
+    // that the node or region prefetched for one slot's next event has arrived by the time its turn comes again.
+    struct Slot {
+        pm::Mwpm* mwpm;
+        size_t shot;
+        std::span<const uint64_t> detection_events;
+        /// The solution of the pairs matched by the predecoder, which is added to that of the flooded shot.
+        pm::MatchingResult predecoded_res;
+    };
+    std::vector<Slot> active;
+    active.reserve(mwpms.size());
+    size_t next_shot = 0;
+    // Gives the slot of `mwpm' the next shot that needs flooding, solving the shots that don't on the way (those
+    // decoded by the Union-Find decoder of `mwpm', or found by its caches after predecoding), as
+    // `decode_detection_events' does. Returns false once there are no shots left.
+    auto start_next_shot = [&](pm::Mwpm* mwpm, Slot& slot) {
+        while (next_shot < shots.size()) {
+            size_t shot = next_shot++;
+            auto detection_events = mwpm->flooder.graph.to_graph_node_indices(shots[shot]);
+            pm::MatchingResult res;
+            if (mwpm->union_find != nullptr) {
+                decode_with_union_find(*mwpm, *mwpm->union_find, detection_events);
+                res.obs_mask = mwpm->union_find->correction_obs_mask(mwpm->flooder.graph);
+                res.weight = mwpm->union_find->correction_weight;
+                res.obs_mask ^= mwpm->flooder.negative_weight_obs_mask;
+                res.weight += mwpm->flooder.negative_weight_sum;
+                results[shot] = res;
+                continue;
+            }
+            pm::MatchingResult predecoded_res;
+            detection_events = predecode(*mwpm, detection_events, predecoded_res);
+            if (try_decode_small_syndrome(*mwpm, detection_events, res) ||
+                mwpm->syndrome_cache.find(detection_events, res.obs_mask, res.weight)) {
+                res += predecoded_res;
+                res.obs_mask ^= mwpm->flooder.negative_weight_obs_mask;
+                res.weight += mwpm->flooder.negative_weight_sum;
+                results[shot] = res;
+                continue;
+            }
+            start_timeline(*mwpm, detection_events);
+            slot = {mwpm, shot, detection_events, predecoded_res};
+            return true;
+        }
+        return false;
+    };
+
+    try {
+        for (auto* mwpm : mwpms) {
+            Slot slot;
+            if (!start_next_shot(mwpm, slot))
+                break;
+            active.push_back(slot);
+        }
+        while (!active.empty()) {
+            for (size_t k = 0; k < active.size();) {
+                Slot& slot = active[k];
+                pm::Mwpm& mwpm = *slot.mwpm;
+                auto event = mwpm.flooder.run_until_next_mwpm_notification();
+                if (event.event_type != pm::NO_EVENT) {
+                    mwpm.process_event(event);
+                    mwpm.flooder.prefetch_next_event();
+                    k++;
+                    continue;
+                }
+                finish_timeline(mwpm);
+                auto res = extract_flooded_solution(mwpm, slot.detection_events);
+                res += slot.predecoded_res;
+                res.obs_mask ^= mwpm.flooder.negative_weight_obs_mask;
+                res.weight += mwpm.flooder.negative_weight_sum;
+                results[slot.shot] = res;
+                if (start_next_shot(&mwpm, slot)) {
+                    k++;
+                } else {
+                    active[k] = active.back();
+                    active.pop_back();
+                }
+            }
+        }
+    } catch (...) {
+        // Leave every Mwpm ready for the next shot, as decoding a single shot does when it fails.
+        for (auto& slot : active)
+            slot.mwpm->reset();
+        throw;
+    }
+}
+
 void pm::decode_detection_events(
     pm::Mwpm& mwpm,
-    const std::vector<uint64_t>& detection_events,
+    std::span<const uint64_t> original_detection_events,
     uint8_t* obs_begin_ptr,
-    pm::total_weight_int& weight) {
+    pm::total_weight_int& weight,
+    DecodePhaseTimes* phase_times) {
+    PhaseTimer timer(phase_times);
+    auto detection_events = mwpm.flooder.graph.to_graph_node_indices(original_detection_events);
+    timer.lap(&DecodePhaseTimes::syndrome_extraction_ns);
     size_t num_observables = mwpm.flooder.graph.num_observables;
-    process_timeline_until_completion(mwpm, detection_events);
+    // Writes the solution of a Union-Find decoder, and of any pairs matched by the predecoder.
+    auto extract_union_find_solution = [&](const pm::UnionFindDecoder& decoder, const pm::MatchingResult& predecoded) {
+        if (num_observables > sizeof(pm::obs_int) * 8) {
+            decoder.xor_correction_observables(mwpm.flooder.graph, obs_begin_ptr);
+            for (auto& obs : mwpm.flooder.negative_weight_observables)
+                *(obs_begin_ptr + obs) ^= 1;
+        } else {
+            pm::obs_int obs_mask = decoder.correction_obs_mask(mwpm.flooder.graph) ^ predecoded.obs_mask;
+            fill_bit_vector_from_obs_mask(
+                obs_mask ^ mwpm.flooder.negative_weight_obs_mask, obs_begin_ptr, num_observables);
+        }
+        weight = decoder.correction_weight + predecoded.weight + mwpm.flooder.negative_weight_sum;
+        timer.lap(&DecodePhaseTimes::result_extraction_ns);
+    };
+    if (mwpm.union_find != nullptr) {
+        decode_with_union_find(mwpm, *mwpm.union_find, detection_events);
+        timer.lap(&DecodePhaseTimes::flooding_ns);
+        extract_union_find_solution(*mwpm.union_find, pm::MatchingResult());
+        return;
+    }
+    // The pairs matched by the predecoder (only ever with at most 64 observables) are added to the solution of the
+    // other detection events.
+    pm::MatchingResult predecoded_res;
+    detection_events = predecode(mwpm, detection_events, predecoded_res);
+    pm::MatchingResult small_res;
+    if (try_decode_small_syndrome(mwpm, detection_events, small_res) ||
+        (num_observables <= sizeof(pm::obs_int) * 8 &&
+         mwpm.syndrome_cache.find(detection_events, small_res.obs_mask, small_res.weight))) {
+        // The caches find the solution without flooding, so looking it up counts as flooding.
+        timer.lap(&DecodePhaseTimes::flooding_ns);
+        small_res += predecoded_res;
+        small_res.obs_mask ^= mwpm.flooder.negative_weight_obs_mask;
+        fill_bit_vector_from_obs_mask(small_res.obs_mask, obs_begin_ptr, num_observables);
+        weight = small_res.weight + mwpm.flooder.negative_weight_sum;
+        timer.lap(&DecodePhaseTimes::result_extraction_ns);
+        return;
+    }
+    if (!process_timeline_within_budget(mwpm, detection_events)) {
+        auto& decoder = decode_degraded_shot(mwpm, detection_events);
+        timer.lap(&DecodePhaseTimes::flooding_ns);
+        extract_union_find_solution(decoder, predecoded_res);
+        return;
+    }
+    timer.lap(&DecodePhaseTimes::flooding_ns);
 
     if (num_observables > sizeof(pm::obs_int) * 8) {
         mwpm.flooder.match_edges.clear();
-        shatter_blossoms_for_all_detection_events_and_extract_match_edges(mwpm, detection_events);
-        if (!mwpm.flooder.negative_weight_detection_events.empty())
-            shatter_blossoms_for_all_detection_events_and_extract_match_edges(
-                mwpm, mwpm.flooder.negative_weight_detection_events);
+        shatter_blossoms_for_all_detection_events_and_extract_match_edges(
+            mwpm, flooded_detection_events(mwpm, detection_events));
         mwpm.extract_paths_from_match_edges(mwpm.flooder.match_edges, obs_begin_ptr, weight);
 
         // XOR negative weight observables
@@ -195,11 +656,10 @@ void pm::decode_detection_events(
         weight += mwpm.flooder.negative_weight_sum;
 
     } else {
-        pm::MatchingResult bit_packed_res =
-            shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(mwpm, detection_events);
-        if (!mwpm.flooder.negative_weight_detection_events.empty())
-            bit_packed_res += shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(
-                mwpm, mwpm.flooder.negative_weight_detection_events);
+        pm::MatchingResult bit_packed_res = shatter_blossoms_for_all_detection_events_and_extract_obs_mask_and_weight(
+            mwpm, flooded_detection_events(mwpm, detection_events));
+        mwpm.syndrome_cache.insert_last_found(bit_packed_res.obs_mask, bit_packed_res.weight);
+        bit_packed_res += predecoded_res;
         // XOR in negative weight observable mask
         bit_packed_res.obs_mask ^= mwpm.flooder.negative_weight_obs_mask;
         // Translate observable mask into bit vector
@@ -207,82 +667,220 @@ void pm::decode_detection_events(
         // Add negative weight sum to blossom solution weight
         weight = bit_packed_res.weight + mwpm.flooder.negative_weight_sum;
     }
+    timer.lap(&DecodePhaseTimes::result_extraction_ns);
+}
+
+void check_has_search_flooder(const pm::Mwpm& mwpm) {
+    if (mwpm.flooder.graph.nodes.size() != mwpm.search_flooder.graph.nodes.size()) {
+        throw std::invalid_argument(
+            "Mwpm object does not contain search flooder, which is required to decode to edges.");
+    }
 }
 
-void pm::decode_detection_events_to_match_edges(pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events) {
+void check_no_negative_weights_for_match_edges(const pm::Mwpm& mwpm) {
     if (mwpm.flooder.negative_weight_sum != 0)
         throw std::invalid_argument(
             "Decoding to matched detection events not supported for graphs containing edges with negative weights.");
+}
+
+void pm::decode_detection_events_to_match_edges(
+    pm::Mwpm& mwpm, const std::vector<uint64_t>& original_detection_events) {
+    auto detection_events = mwpm.flooder.graph.to_graph_node_indices(original_detection_events);
+    check_no_negative_weights_for_match_edges(mwpm);
     process_timeline_until_completion(mwpm, detection_events);
     mwpm.flooder.match_edges.clear();
     shatter_blossoms_for_all_detection_events_and_extract_match_edges(mwpm, detection_events);
 }
 
-void flip_edge(const pm::SearchGraphEdge& edge) {
-    edge.detector_node->neighbor_markers[edge.neighbor_index] ^= pm::FLIPPED;
-    auto neighbor = edge.detector_node->neighbors[edge.neighbor_index];
-    if (neighbor) {
-        auto idx_from_neighbor = neighbor->index_of_neighbor(edge.detector_node);
-        neighbor->neighbor_markers[idx_from_neighbor] ^= pm::FLIPPED;
+/// Finds the edges of the matching given by `mwpm.flooder.match_edges', leaving the id of each edge (see
+/// `SearchEdgeIds') in `mwpm.search_flooder.touched_edge_ids', in the order they were first flipped. If `edges' is
+/// not null, the two nodes of each edge are appended to it, in the direction the edge was first flipped.
+void flip_edges_of_match_edges(pm::Mwpm& mwpm, std::vector<int64_t>* edges) {
+    auto& search_graph = mwpm.search_flooder.graph;
+    size_t num_edges = search_graph.get_edge_ids().num_edges();
+    auto& parity = mwpm.search_flooder.edge_flip_parity;
+    if (parity.size() != num_edges)
+        parity.assign(num_edges, 0);
+    auto& touched = mwpm.search_flooder.touched_edge_ids;
+    touched.clear();
+
+    size_t first_edge = edges ? edges->size() / 2 : 0;
+    auto flip_edge_id = [&](size_t id, int64_t node1, int64_t node2) {
+        parity[id] ^= 1;
+        touched.push_back(id);
+        if (edges) {
+            edges->push_back(node1);
+            edges->push_back(node2);
+        }
+    };
+    auto flip_edge = [&](const pm::SearchGraphEdge& e) {
+        auto node2_ptr = e.detector_node->neighbors[e.neighbor_index];
+        flip_edge_id(
+            search_graph.edge_id(e),
+            e.detector_node - &search_graph.nodes[0],
+            node2_ptr ? node2_ptr - &search_graph.nodes[0] : -1);
+    };
+    // Flip edges with negative weights.
+    for (const auto& neg_node_pair : search_graph.negative_weight_edges) {
+        auto node1_ptr = &search_graph.nodes[neg_node_pair.first];
+        auto node2_ptr = neg_node_pair.second != SIZE_MAX ? &search_graph.nodes[neg_node_pair.second] : nullptr;
+        flip_edge({node1_ptr, node1_ptr->index_of_neighbor(node2_ptr)});
+    }
+    // Flip edges along a shortest path between matched detection events.
+    auto& match_edges = mwpm.flooder.match_edges;
+    size_t num_workers = mwpm.num_path_workers_for(match_edges.size());
+    if (num_workers > 1) {
+        // Each worker finds the edges of a contiguous range of the paths, which are then flipped in order, exactly as
+        // if the paths had been found one after the other.
+        mwpm.run_path_workers(
+            num_workers,
+            match_edges.size(),
+            [&](pm::PathSearchWorker& worker, pm::SearchFlooder& search_flooder, size_t begin, size_t end) {
+                auto& worker_graph = search_flooder.graph;
+                worker.edge_ids.clear();
+                worker.edge_nodes.clear();
+                for (size_t k = begin; k < end; k++) {
+                    size_t node_from = match_edges[k].loc_from - &mwpm.flooder.graph.nodes[0];
+                    size_t node_to =
+                        match_edges[k].loc_to ? match_edges[k].loc_to - &mwpm.flooder.graph.nodes[0] : SIZE_MAX;
+                    search_flooder.iter_edges_on_shortest_path_from_middle(
+                        node_from, node_to, [&](const pm::SearchGraphEdge& e) {
+                            worker.edge_ids.push_back(worker_graph.edge_id(e));
+                            auto node2_ptr = e.detector_node->neighbors[e.neighbor_index];
+                            worker.edge_nodes.push_back(e.detector_node - &worker_graph.nodes[0]);
+                            worker.edge_nodes.push_back(node2_ptr ? node2_ptr - &worker_graph.nodes[0] : -1);
+                        });
+                }
+            });
+        for (size_t w = 0; w < num_workers; w++) {
+            auto& worker = mwpm.path_workers[w];
+            for (size_t k = 0; k < worker.edge_ids.size(); k++)
+                flip_edge_id(worker.edge_ids[k], worker.edge_nodes[2 * k], worker.edge_nodes[2 * k + 1]);
+        }
+    } else {
+        for (const auto& match_edge : match_edges) {
+            size_t node_from = match_edge.loc_from - &mwpm.flooder.graph.nodes[0];
+            size_t node_to = match_edge.loc_to ? match_edge.loc_to - &mwpm.flooder.graph.nodes[0] : SIZE_MAX;
+            mwpm.search_flooder.iter_edges_on_shortest_path_from_middle(node_from, node_to, flip_edge);
+        }
+    }
+    // Remove any edges that are no longer flipped, and clear the parity of the others.
+    for (size_t i = 0; i < touched.size();) {
+        size_t id = touched[i];
+        if (!parity[id]) {
+            touched[i] = touched.back();
+            touched.pop_back();
+            if (edges) {
+                size_t k = 2 * (first_edge + i);
+                (*edges)[k] = (*edges)[edges->size() - 2];
+                (*edges)[k + 1] = (*edges)[edges->size() - 1];
+                edges->resize(edges->size() - 2);
+            }
+        } else {
+            parity[id] = 0;
+            i++;
+        }
+    }
+}
+
+/// Decodes `original_detection_events' into the edges of the matching, as `flip_edges_of_match_edges' does.
+void decode_detection_events_to_flipped_edge_ids(
+    pm::Mwpm& mwpm, const std::vector<uint64_t>& original_detection_events, std::vector<int64_t>* edges) {
+    check_has_search_flooder(mwpm);
+    auto detection_events = mwpm.flooder.graph.to_graph_node_indices(original_detection_events);
+    process_timeline_until_completion(mwpm, detection_events);
+    mwpm.flooder.match_edges.clear();
+    shatter_blossoms_for_all_detection_events_and_extract_match_edges(
+        mwpm, flooded_detection_events(mwpm, detection_events));
+    flip_edges_of_match_edges(mwpm, edges);
+}
+
+/// Translates the nodes in [`begin', `end') from the labels of the matching graph to the original detector indices.
+void relabel_nodes_to_original_indices(const pm::MatchingGraph& graph, int64_t* begin, int64_t* end) {
+    if (!graph.node_relabeling)
+        return;
+    for (int64_t* node = begin; node != end; node++) {
+        if (*node != -1)
+            *node = (int64_t)graph.original_node_index((size_t)*node);
     }
 }
 
 void pm::decode_detection_events_to_edges(
-    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events, std::vector<int64_t>& edges) {
-    if (mwpm.flooder.graph.nodes.size() != mwpm.search_flooder.graph.nodes.size()) {
-        throw std::invalid_argument(
-            "Mwpm object does not contain search flooder, which is required to decode to edges.");
+    pm::Mwpm& mwpm, const std::vector<uint64_t>& original_detection_events, std::vector<int64_t>& edges) {
+    decode_detection_events_to_flipped_edge_ids(mwpm, original_detection_events, &edges);
+    relabel_nodes_to_original_indices(mwpm.flooder.graph, edges.data(), edges.data() + edges.size());
+}
+
+void pm::decode_detection_events_to_edge_ids(
+    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events, std::vector<size_t>& edge_ids) {
+    decode_detection_events_to_flipped_edge_ids(mwpm, detection_events, nullptr);
+    auto& touched = mwpm.search_flooder.touched_edge_ids;
+    edge_ids.insert(edge_ids.end(), touched.begin(), touched.end());
+}
+
+void pm::decode_detection_events_to_outputs(
+    pm::Mwpm& mwpm,
+    const std::vector<uint64_t>& original_detection_events,
+    uint8_t* obs_begin_ptr,
+    pm::total_weight_int* weight,
+    std::vector<int64_t>* matched_detection_events,
+    std::vector<int64_t>* edges) {
+    size_t num_observables = mwpm.flooder.graph.num_observables;
+    std::vector<uint8_t> unused_obs;
+    if (obs_begin_ptr == nullptr && (weight != nullptr || num_observables > sizeof(pm::obs_int) * 8)) {
+        unused_obs.assign(num_observables, 0);
+        obs_begin_ptr = unused_obs.data();
+    }
+    if (matched_detection_events == nullptr && edges == nullptr) {
+        // Without the matching itself, this is an ordinary decode, which can use the caches and the predecoder.
+        if (obs_begin_ptr != nullptr) {
+            pm::total_weight_int solution_weight = 0;
+            decode_detection_events(mwpm, original_detection_events, obs_begin_ptr, solution_weight);
+            if (weight)
+                *weight = solution_weight;
+        }
+        return;
     }
+    if (matched_detection_events)
+        check_no_negative_weights_for_match_edges(mwpm);
+    if (edges)
+        check_has_search_flooder(mwpm);
+
+    auto detection_events = mwpm.flooder.graph.to_graph_node_indices(original_detection_events);
     process_timeline_until_completion(mwpm, detection_events);
-    mwpm.flooder.match_edges.clear();
-    shatter_blossoms_for_all_detection_events_and_extract_match_edges(mwpm, detection_events);
-    if (!mwpm.flooder.negative_weight_detection_events.empty())
-        shatter_blossoms_for_all_detection_events_and_extract_match_edges(
-            mwpm, mwpm.flooder.negative_weight_detection_events);
-    // Flip edges with negative weights and add to edges vector.
-    for (const auto& neg_node_pair : mwpm.search_flooder.graph.negative_weight_edges) {
-        auto node1_ptr = &mwpm.search_flooder.graph.nodes[neg_node_pair.first];
-        auto node2_ptr =
-            neg_node_pair.second != SIZE_MAX ? &mwpm.search_flooder.graph.nodes[neg_node_pair.second] : nullptr;
-        SearchGraphEdge neg_edge = {node1_ptr, node1_ptr->index_of_neighbor(node2_ptr)};
-        flip_edge(neg_edge);
-        int64_t node1 = neg_edge.detector_node - &mwpm.search_flooder.graph.nodes[0];
-        int64_t node2 = node2_ptr ? node2_ptr - &mwpm.search_flooder.graph.nodes[0] : -1;
-        edges.push_back(node1);
-        edges.push_back(node2);
-    }
-    // Flip edges along a shortest path between matched detection events and add to edges vector
-    for (const auto& match_edge : mwpm.flooder.match_edges) {
-        size_t node_from = match_edge.loc_from - &mwpm.flooder.graph.nodes[0];
-        size_t node_to = match_edge.loc_to ? match_edge.loc_to - &mwpm.flooder.graph.nodes[0] : SIZE_MAX;
-        mwpm.search_flooder.iter_edges_on_shortest_path_from_middle(node_from, node_to, [&](const SearchGraphEdge& e) {
-            flip_edge(e);
-            int64_t node1 = e.detector_node - &mwpm.search_flooder.graph.nodes[0];
-            auto node2_ptr = e.detector_node->neighbors[e.neighbor_index];
-            int64_t node2 = node2_ptr ? node2_ptr - &mwpm.search_flooder.graph.nodes[0] : -1;
-            edges.push_back(node1);
-            edges.push_back(node2);
-        });
-    }
-    // Remove any edges in the edges vector that are no longer flipped. Also unflip edges.
-    for (size_t i = 0; i < edges.size() / 2;) {
-        int64_t u = edges[2 * i];
-        int64_t v = edges[2 * i + 1];
-        auto& u_node = mwpm.search_flooder.graph.nodes[u];
-        size_t idx;
-        if (v == -1) {
-            idx = 0;
+    auto& match_edges = mwpm.flooder.match_edges;
+    match_edges.clear();
+    pm::MatchingResult res = shatter_blossoms_for_all_detection_events_and_extract_match_edges(
+        mwpm, flooded_detection_events(mwpm, detection_events));
+
+    if (obs_begin_ptr != nullptr) {
+        if (num_observables > sizeof(pm::obs_int) * 8) {
+            pm::total_weight_int paths_weight = 0;
+            mwpm.extract_paths_from_match_edges(match_edges, obs_begin_ptr, paths_weight);
+            for (auto& obs : mwpm.flooder.negative_weight_observables)
+                *(obs_begin_ptr + obs) ^= 1;
+            res.weight = paths_weight;
         } else {
-            auto v_ptr = &mwpm.search_flooder.graph.nodes[v];
-            idx = u_node.index_of_neighbor(v_ptr);
+            fill_bit_vector_from_obs_mask(
+                res.obs_mask ^ mwpm.flooder.negative_weight_obs_mask, obs_begin_ptr, num_observables);
         }
-        if (!(u_node.neighbor_markers[idx] & pm::FLIPPED)) {
-            edges[2 * i] = edges[edges.size() - 2];
-            edges[2 * i + 1] = edges[edges.size() - 1];
-            edges.resize(edges.size() - 2);
-        } else {
-            flip_edge({&u_node, idx});
-            i++;
+        if (weight)
+            *weight = res.weight + mwpm.flooder.negative_weight_sum;
+    }
+    if (matched_detection_events) {
+        size_t first = matched_detection_events->size();
+        for (auto& e : match_edges) {
+            matched_detection_events->push_back(e.loc_from - &mwpm.flooder.graph.nodes[0]);
+            matched_detection_events->push_back(e.loc_to ? e.loc_to - &mwpm.flooder.graph.nodes[0] : -1);
         }
+        relabel_nodes_to_original_indices(
+            mwpm.flooder.graph,
+            matched_detection_events->data() + first,
+            matched_detection_events->data() + matched_detection_events->size());
+    }
+    if (edges) {
+        size_t first = edges->size();
+        flip_edges_of_match_edges(mwpm, edges);
+        relabel_nodes_to_original_indices(mwpm.flooder.graph, edges->data() + first, edges->data() + edges->size());
     }
 }
@@ -15,7 +15,10 @@
 #ifndef PYMATCHING2_MWPM_DECODING_H
 #define PYMATCHING2_MWPM_DECODING_H
 
+#include <span>
+
 #include "pymatching/sparse_blossom/driver/io.h"
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
 #include "pymatching/sparse_blossom/matcher/mwpm.h"
 #include "stim.h"
 
@@ -47,28 +50,78 @@ inline void ExtendedMatchingResult::reset() {
 void fill_bit_vector_from_obs_mask(pm::obs_int obs_mask, uint8_t* obs_begin_ptr, size_t num_observables);
 obs_int bit_vector_to_obs_mask(const std::vector<uint8_t>& bit_vector);
 
+/// Creates an Mwpm for `detector_error_model'. If `reorder_nodes' is true, the nodes are relabeled in reverse
+/// Cuthill-McKee order to improve memory locality (see `DemEdgeList::reorder_nodes'). The decoding functions below
+/// translate between the detector indices and the relabeled nodes, so this does not change how the Mwpm is used.
 Mwpm detector_error_model_to_mwpm(
     const stim::DetectorErrorModel& detector_error_model,
     pm::weight_int num_distinct_weights,
-    bool ensure_search_flooder_included = false);
+    bool ensure_search_flooder_included = false,
+    bool reorder_nodes = false);
+
+/// Creates `num_mwpms' Mwpm objects for the same detector error model, for example one for each decoding thread.
+/// The matching graph topology and the boundary distances of its nodes are only computed once, and are shared by
+/// all of them. The edges of the detector error model are collected using `num_mwpms' threads. If
+/// `periodic_topology' is true, the edges of rounds that repeat are only stored once (see
+/// `MatchingGraph::compress_periodic_topology'), which can't be combined with `reorder_nodes'.
+std::vector<Mwpm> detector_error_model_to_mwpms(
+    const stim::DetectorErrorModel& detector_error_model,
+    pm::weight_int num_distinct_weights,
+    size_t num_mwpms,
+    bool reorder_nodes = false,
+    bool periodic_topology = false);
 
+/// Decodes `detection_events' as `decode_detection_events' does, returning the observables as a bit mask. If
+/// `phase_times' is given, the time spent in each phase of decoding is added to it.
 MatchingResult decode_detection_events_for_up_to_64_observables(
-    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events);
+    pm::Mwpm& mwpm, std::span<const uint64_t> detection_events, DecodePhaseTimes* phase_times = nullptr);
+inline MatchingResult decode_detection_events_for_up_to_64_observables(
+    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events, DecodePhaseTimes* phase_times = nullptr) {
+    return decode_detection_events_for_up_to_64_observables(
+        mwpm, std::span<const uint64_t>(detection_events), phase_times);
+}
+
+/// Experimental: decodes each shot of `shots' (a list of detection events) as
+/// `decode_detection_events_for_up_to_64_observables' does, setting `results[i]' to the solution of `shots[i]'. Each
+/// Mwpm of `mwpms' (which must all be for the same graph, e.g. from `detector_error_model_to_mwpms') floods one shot
+/// at a time, and the shots in flight take turns on the calling thread to run until their next notification. After
+/// each turn, the node or region the next event of that shot will look at is prefetched, so that on large graphs the
+/// memory latency of one shot is hidden behind the work on the others. The results are the same as decoding the
+/// shots one at a time, including with the Union-Find decoder or the predecoder of each Mwpm. Throws
+/// std::invalid_argument if any of `mwpms' has a work budget (see `Mwpm::work_budget'), which isn't supported.
+void decode_detection_events_interleaved(
+    const std::vector<pm::Mwpm*>& mwpms,
+    const std::vector<std::vector<uint64_t>>& shots,
+    std::vector<MatchingResult>& results);
 
 /// Used to decode detection events for an existing Mwpm object `mwpm', and a vector of
 /// detection event indices `detection_events'. The predicted observables are XOR-ed into an
 /// existing uint8_t array with at least `mwpm.flooder.graph.num_observables' elements,
 /// the pointer to the first element of which is passed as the `obs_begin_ptr' argument.
-/// The weight of the MWPM solution is added to the `weight' argument.
+/// The weight of the MWPM solution is added to the `weight' argument. If `phase_times' is given, the time spent
+/// in each phase of decoding is added to it.
+///
+/// The detection events are only read, so they can be passed as a span over a caller's buffer (such as a numpy
+/// array) without copying them into a vector. Decoding with a warmed-up Mwpm then doesn't allocate.
 void decode_detection_events(
+    pm::Mwpm& mwpm,
+    std::span<const uint64_t> detection_events,
+    uint8_t* obs_begin_ptr,
+    pm::total_weight_int& weight,
+    DecodePhaseTimes* phase_times = nullptr);
+inline void decode_detection_events(
     pm::Mwpm& mwpm,
     const std::vector<uint64_t>& detection_events,
     uint8_t* obs_begin_ptr,
-    pm::total_weight_int& weight);
+    pm::total_weight_int& weight,
+    DecodePhaseTimes* phase_times = nullptr) {
+    decode_detection_events(mwpm, std::span<const uint64_t>(detection_events), obs_begin_ptr, weight, phase_times);
+}
 
 /// Decode detection events using a Mwpm object and vector of detection event indices
 /// Returns the compressed edges in the matching: the pairs of detection events that are
-/// matched to each other via paths.
+/// matched to each other via paths. These are stored in `mwpm.flooder.match_edges' as pointers to
+/// nodes of the graph, whose original indices are given by `MatchingGraph::original_node_index'.
 void decode_detection_events_to_match_edges(pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events);
 
 /// Decode detection events using a Mwpm object and vector of detection event indices.
@@ -81,6 +134,34 @@ void decode_detection_events_to_edges(
     std::vector<int64_t>& edges
     );
 
+/// Like `decode_detection_events_to_edges', but appends the id of each edge in the matching to `edge_ids' instead
+/// of its two detectors. The nodes of edge `e' are given by `mwpm.search_flooder.graph.get_edge_ids().endpoints'
+/// (at 2e and 2e + 1, with SIZE_MAX for the boundary), in the labels of the matching graph (see
+/// `MatchingGraph::original_node_index'). Avoids building and relabeling the pairs of nodes for callers that only
+/// need to index per-edge data.
+void decode_detection_events_to_edge_ids(
+    pm::Mwpm& mwpm, const std::vector<uint64_t>& detection_events, std::vector<size_t>& edge_ids);
+
+/// Decodes `detection_events' once, returning any subset of the outputs of `decode_detection_events',
+/// `decode_detection_events_to_match_edges' and `decode_detection_events_to_edges' from the same matching. Each
+/// output is skipped if its pointer is null:
+///  - `obs_begin_ptr': the predicted observables, as for `decode_detection_events'.
+///  - `weight': set to the weight of the solution.
+///  - `matched_detection_events': the pairs of matched detection events are appended, with -1 for the boundary.
+///  - `edges': the pairs of detectors of the edges in the matching are appended, with -1 for the boundary.
+/// The weight and observables are found from the match edges, rather than by flooding the graph again. If neither
+/// `matched_detection_events' nor `edges' is requested, this is the same as `decode_detection_events' (and may use
+/// the caches, predecoder or decoder engine set on `mwpm'); otherwise the shot is always flooded with the blossom
+/// algorithm. Throws std::invalid_argument if `matched_detection_events' is requested for a graph with negative
+/// edge weights, or if `edges' is requested and `mwpm' has no search flooder.
+void decode_detection_events_to_outputs(
+    pm::Mwpm& mwpm,
+    const std::vector<uint64_t>& detection_events,
+    uint8_t* obs_begin_ptr,
+    pm::total_weight_int* weight,
+    std::vector<int64_t>* matched_detection_events,
+    std::vector<int64_t>* edges);
+
 }  // namespace pm
 
 #endif  // PYMATCHING2_MWPM_DECODING_H
@@ -46,6 +46,13 @@ std::pair<stim::DetectorErrorModel, std::vector<stim::SparseShot>> generate_data
     return {dem, shots};
 }
 
+/// The percentage of the events dequeued by the flooder of `mwpm' that were discarded as stale. With
+/// PYMATCHING_QUEUE_HANDLES, events are rescheduled in place and this is zero.
+double stale_dequeue_percentage(const pm::Mwpm &mwpm) {
+    size_t total = mwpm.flooder.num_valid_dequeues + mwpm.flooder.num_stale_dequeues;
+    return total == 0 ? 0 : 100.0 * (double)mwpm.flooder.num_stale_dequeues / (double)total;
+}
+
 BENCHMARK(Decode_surface_r5_d5_p1000) {
     size_t rounds = 5;
     auto data = generate_data(5, rounds, 0.001, 1024);
@@ -110,6 +117,44 @@ BENCHMARK(Decode_surface_r11_d11_p100) {
     }
 }
 
+BENCHMARK(Decode_surface_r11_d11_p100_interleaved_4) {
+    size_t rounds = 11;
+    auto data = generate_data(11, rounds, 0.01, 128);
+    const auto &dem = data.first;
+    const auto &shots = data.second;
+
+    size_t num_buckets = pm::NUM_DISTINCT_WEIGHTS;
+    auto mwpms = pm::detector_error_model_to_mwpms(dem, num_buckets, 4);
+    std::vector<pm::Mwpm *> mwpm_ptrs;
+    for (auto &mwpm : mwpms)
+        mwpm_ptrs.push_back(&mwpm);
+
+    size_t num_dets = 0;
+    std::vector<std::vector<uint64_t>> hits;
+    for (const auto &shot : shots) {
+        num_dets += shot.hits.size();
+        hits.push_back(shot.hits);
+    }
+
+    size_t num_mistakes = 0;
+    std::vector<pm::MatchingResult> results;
+    benchmark_go([&]() {
+        pm::decode_detection_events_interleaved(mwpm_ptrs, hits, results);
+        for (size_t k = 0; k < shots.size(); k++) {
+            if (shots[k].obs_mask_as_u64() != results[k].obs_mask) {
+                num_mistakes++;
+            }
+        }
+    })
+        .goal_millis(10)
+        .show_rate("dets", (double)num_dets)
+        .show_rate("layers", (double)rounds * (double)shots.size())
+        .show_rate("shots", (double)shots.size());
+    if (num_mistakes == shots.size()) {
+        std::cerr << "data dependence";
+    }
+}
+
 BENCHMARK(Decode_surface_r11_d11_p1000) {
     size_t rounds = 11;
     auto data = generate_data(11, rounds, 0.001, 512);
@@ -232,7 +277,9 @@ BENCHMARK(Decode_surface_r21_d21_p100) {
         .goal_millis(7.5)
         .show_rate("dets", (double)num_dets)
         .show_rate("layers", (double)rounds * (double)shots.size())
-        .show_rate("shots", (double)shots.size());
+        .show_rate("shots", (double)shots.size())
+        .show_value("% stale dequeues", stale_dequeue_percentage(mwpm))
+        .show_value("prefetch distance", (double)pm::FLOOD_PREFETCH_DISTANCE);
     if (num_mistakes == 0) {
         std::cerr << "data dependence";
     }
@@ -331,6 +378,130 @@ BENCHMARK(Decode_surface_r21_d21_p1000) {
     }
 }
 
+BENCHMARK(Decode_surface_r21_d21_p1000_union_find) {
+    // Compare with Decode_surface_r21_d21_p1000. The mistakes of each engine on the same shots are shown, since the
+    // Union-Find decoder trades accuracy for speed.
+    size_t rounds = 21;
+    auto data = generate_data(21, rounds, 0.001, 256);
+    const auto &dem = data.first;
+    const auto &shots = data.second;
+
+    size_t num_buckets = pm::NUM_DISTINCT_WEIGHTS;
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, num_buckets);
+
+    size_t num_dets = 0;
+    for (const auto &shot : shots) {
+        num_dets += shot.hits.size();
+    }
+
+    auto count_mistakes = [&]() {
+        size_t num_mistakes = 0;
+        for (const auto &shot : shots) {
+            auto res = pm::decode_detection_events_for_up_to_64_observables(mwpm, shot.hits);
+            if (shot.obs_mask_as_u64() != res.obs_mask) {
+                num_mistakes++;
+            }
+        }
+        return num_mistakes;
+    };
+    size_t blossom_mistakes = count_mistakes();
+    mwpm.set_decoder_engine(pm::UNION_FIND);
+    size_t union_find_mistakes = count_mistakes();
+
+    size_t num_mistakes = 0;
+    benchmark_go([&]() {
+        num_mistakes += count_mistakes();
+    })
+        .goal_millis(6.3)
+        .show_rate("dets", (double)num_dets)
+        .show_rate("layers", (double)rounds * (double)shots.size())
+        .show_rate("shots", (double)shots.size())
+        .show_value("blossom mistakes", (double)blossom_mistakes)
+        .show_value("union find mistakes", (double)union_find_mistakes);
+    if (num_mistakes == shots.size()) {
+        std::cerr << "data dependence";
+    }
+}
+
+BENCHMARK(Decode_surface_r21_d21_p1000_approximate_predecoder) {
+    // Compare with Decode_surface_r21_d21_p1000. The surface code has no pairs the exact predecoder can match, so
+    // only the approximate predecoder is benchmarked, next to the mistakes with and without it on the same shots.
+    size_t rounds = 21;
+    auto data = generate_data(21, rounds, 0.001, 256);
+    const auto &dem = data.first;
+    const auto &shots = data.second;
+
+    size_t num_buckets = pm::NUM_DISTINCT_WEIGHTS;
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, num_buckets);
+
+    size_t num_dets = 0;
+    for (const auto &shot : shots) {
+        num_dets += shot.hits.size();
+    }
+
+    auto count_mistakes = [&]() {
+        size_t num_mistakes = 0;
+        for (const auto &shot : shots) {
+            auto res = pm::decode_detection_events_for_up_to_64_observables(mwpm, shot.hits);
+            if (shot.obs_mask_as_u64() != res.obs_mask) {
+                num_mistakes++;
+            }
+        }
+        return num_mistakes;
+    };
+    size_t blossom_mistakes = count_mistakes();
+    mwpm.predecoder.mode = pm::PREDECODER_APPROXIMATE;
+    size_t predecoder_mistakes = count_mistakes();
+
+    size_t num_mistakes = 0;
+    benchmark_go([&]() {
+        num_mistakes += count_mistakes();
+    })
+        .goal_millis(5)
+        .show_rate("dets", (double)num_dets)
+        .show_rate("layers", (double)rounds * (double)shots.size())
+        .show_rate("shots", (double)shots.size())
+        .show_value("blossom mistakes", (double)blossom_mistakes)
+        .show_value("predecoder mistakes", (double)predecoder_mistakes);
+    if (num_mistakes == shots.size()) {
+        std::cerr << "data dependence";
+    }
+}
+
+BENCHMARK(Decode_surface_r21_d21_p1000_node_layout) {
+    size_t rounds = 21;
+    auto data = generate_data(21, rounds, 0.001, 256);
+    const auto &dem = data.first;
+    const auto &shots = data.second;
+
+    size_t num_buckets = pm::NUM_DISTINCT_WEIGHTS;
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, num_buckets);
+
+    // The per-decoder state of each node, and its share of the (shareable) edges of the graph.
+    auto &graph = mwpm.flooder.graph;
+    const auto &topology = *graph.topology;
+    double edge_bytes = (double)(topology.offsets.size() * sizeof(size_t) + topology.neighbors.size() * sizeof(pm::node_index_int) +
+                                 topology.neighbor_weights.size() * sizeof(pm::weight_int) +
+                                 topology.neighbor_observables.size() * sizeof(pm::obs_int));
+
+    size_t num_mistakes = 0;
+    benchmark_go([&]() {
+        for (const auto &shot : shots) {
+            auto res = pm::decode_detection_events_for_up_to_64_observables(mwpm, shot.hits);
+            if (shot.obs_mask_as_u64() != res.obs_mask) {
+                num_mistakes++;
+            }
+        }
+    })
+        .goal_millis(6.3)
+        .show_rate("shots", (double)shots.size())
+        .show_value("B/node state", (double)sizeof(pm::DetectorNode))
+        .show_value("B/node edges", edge_bytes / (double)graph.nodes.size());
+    if (num_mistakes == shots.size()) {
+        std::cerr << "data dependence";
+    }
+}
+
 BENCHMARK(Decode_surface_r21_d21_p1000_with_dijkstra) {
     size_t rounds = 21;
     auto data = generate_data(21, rounds, 0.001, 256);
@@ -419,7 +590,8 @@ BENCHMARK(Decode_surface_r21_d21_p10000) {
         .goal_millis(0.980)
         .show_rate("dets", (double)num_dets)
         .show_rate("layers", (double)rounds * (double)shots.size())
-        .show_rate("shots", (double)shots.size());
+        .show_rate("shots", (double)shots.size())
+        .show_value("% stale dequeues", stale_dequeue_percentage(mwpm));
     if (num_mistakes == shots.size()) {
         std::cerr << "data dependence";
     }
@@ -579,4 +751,37 @@ BENCHMARK(Decode_surface_r21_d21_p100000_to_edges) {
         .show_rate("dets", (double)num_dets)
         .show_rate("layers", (double)rounds * (double)shots.size())
         .show_rate("shots", (double)shots.size());
-}
\ No newline at end of file
+}
+BENCHMARK(Decode_surface_r50_d50_p1000) {
+    // A graph far larger than the caches, for tuning PYMATCHING_FLOOD_PREFETCH_DISTANCE.
+    size_t rounds = 50;
+    auto data = generate_data(50, rounds, 0.001, 4);
+    const auto &dem = data.first;
+    const auto &shots = data.second;
+
+    size_t num_buckets = pm::NUM_DISTINCT_WEIGHTS;
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, num_buckets);
+
+    size_t num_dets = 0;
+    for (const auto &shot : shots) {
+        num_dets += shot.hits.size();
+    }
+
+    size_t num_mistakes = 0;
+    benchmark_go([&]() {
+        for (const auto &shot : shots) {
+            auto res = pm::decode_detection_events_for_up_to_64_observables(mwpm, shot.hits);
+            if (shot.obs_mask_as_u64() != res.obs_mask) {
+                num_mistakes++;
+            }
+        }
+    })
+        .goal_millis(20)
+        .show_rate("dets", (double)num_dets)
+        .show_rate("layers", (double)rounds * (double)shots.size())
+        .show_rate("shots", (double)shots.size())
+        .show_value("prefetch distance", (double)pm::FLOOD_PREFETCH_DISTANCE);
+    if (num_mistakes == shots.size()) {
+        std::cerr << "data dependence";
+    }
+}
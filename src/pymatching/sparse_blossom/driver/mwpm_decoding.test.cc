@@ -14,10 +14,14 @@
 
 #include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
 
+#include <algorithm>
 #include <fstream>
+#include <random>
+#include <set>
 
 #include "gtest/gtest.h"
 
+#include "pymatching/sparse_blossom/driver/user_graph.h"
 #include "pymatching/sparse_blossom/flooder/graph.h"
 #include "stim.h"
 
@@ -119,6 +123,91 @@ TEST(MwpmDecoding, CompareSolutionWeights) {
     }
 }
 
+TEST(MwpmDecoding, InterleavedDecodingMatchesExpectedSolutions) {
+    for (bool negative_weights : {false, true}) {
+        auto test_case = negative_weights ? load_surface_code_d13_p100_some_negative_weights_test_case()
+                                          : load_surface_code_d13_p100_test_case();
+        std::vector<std::vector<uint64_t>> shots;
+        stim::SparseShot sparse_shot;
+        while (shots.size() < 200 && test_case.reader->start_and_read_entire_record(sparse_shot)) {
+            shots.push_back(sparse_shot.hits);
+            sparse_shot.clear();
+        }
+        // Repeat some shots, so that they are also found in the syndrome cache.
+        shots.insert(shots.end(), shots.begin(), shots.begin() + 20);
+
+        for (size_t num_mwpms : {1, 4}) {
+            auto mwpms = pm::detector_error_model_to_mwpms(test_case.detector_error_model, 10001, num_mwpms);
+            std::vector<pm::Mwpm*> mwpm_ptrs;
+            for (auto& mwpm : mwpms) {
+                mwpm.syndrome_cache.set_capacity(64);
+                mwpm_ptrs.push_back(&mwpm);
+            }
+            std::vector<pm::MatchingResult> results;
+            pm::decode_detection_events_interleaved(mwpm_ptrs, shots, results);
+            ASSERT_EQ(results.size(), shots.size());
+            for (size_t i = 0; i < shots.size(); i++) {
+                size_t k = i < 200 ? i : i - 200;
+                ASSERT_EQ(results[i].weight, test_case.expected_weights[k]);
+                ASSERT_EQ(results[i].obs_mask, (pm::obs_int)test_case.expected_obs_masks[k]);
+            }
+        }
+    }
+}
+
+TEST(MwpmDecoding, InterleavedDecodingLeavesMwpmsUsableAfterError) {
+    auto dem_file = std::fopen(find_test_data_file("toric_code_unrotated_memory_x_5_0.005.dem").c_str(), "r");
+    assert(dem_file);
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    auto mwpms = pm::detector_error_model_to_mwpms(dem, 1000, 2);
+    std::vector<pm::Mwpm*> mwpm_ptrs = {&mwpms[0], &mwpms[1]};
+    for (auto& mwpm : mwpms)
+        mwpm.small_syndrome_cache.enabled = false;
+    std::vector<pm::MatchingResult> results;
+    // The toric code has no boundary, so a syndrome with an odd number of detection events can't be matched.
+    std::vector<std::vector<uint64_t>> shots = {{0, 1, 2, 3, 40, 41, 80, 90}, {3}, {5, 6, 7, 8}};
+    ASSERT_THROW(pm::decode_detection_events_interleaved(mwpm_ptrs, shots, results), std::invalid_argument);
+    shots.erase(shots.begin() + 1);
+    pm::decode_detection_events_interleaved(mwpm_ptrs, shots, results);
+    for (size_t i = 0; i < shots.size(); i++)
+        ASSERT_EQ(results[i], pm::decode_detection_events_for_up_to_64_observables(mwpms[0], shots[i]));
+}
+
+TEST(MwpmDecoding, InterleavedDecodingHonoursDecoderConfiguration) {
+    // A chain of detectors with a boundary at each end, with some detection events next to each other so that the
+    // predecoder has pairs to match.
+    pm::UserGraph graph(40, 3);
+    graph.add_or_merge_boundary_edge(0, {0}, 2.0, 0.1);
+    for (size_t k = 1; k < 40; k++)
+        graph.add_or_merge_edge(k - 1, k, {k % 3}, 1.0 + (double)(k % 4), 0.1);
+    graph.add_or_merge_boundary_edge(39, {1}, 2.0, 0.1);
+    std::vector<std::vector<uint64_t>> shots = {
+        {}, {3}, {3, 4}, {0, 1, 10, 11, 20}, {5, 17, 30, 31}, {1, 2, 3, 4, 5, 6, 7}, {38, 39}, {12, 25, 26, 33}};
+
+    auto check_matches_decode_detection_events = [&]() {
+        auto mwpms = graph.get_mwpms(3);
+        std::vector<pm::MatchingResult> results;
+        pm::decode_detection_events_interleaved(mwpms, shots, results);
+        for (size_t i = 0; i < shots.size(); i++)
+            ASSERT_EQ(results[i], pm::decode_detection_events_for_up_to_64_observables(graph.get_mwpm(), shots[i]));
+    };
+    graph.set_predecoder_mode(pm::PREDECODER_APPROXIMATE);
+    check_matches_decode_detection_events();
+    graph.set_predecoder_mode(pm::PREDECODER_OFF);
+    graph.set_decoder_engine(pm::UNION_FIND);
+    check_matches_decode_detection_events();
+    graph.set_decoder_engine(pm::SPARSE_BLOSSOM);
+
+    // A shot that runs out of budget can't be degraded without stalling the others, so a budget isn't allowed.
+    auto mwpms = graph.get_mwpms(2);
+    mwpms[1]->work_budget.max_flood_check_events = 100;
+    std::vector<pm::MatchingResult> results;
+    ASSERT_THROW(pm::decode_detection_events_interleaved(mwpms, shots, results), std::invalid_argument);
+    mwpms[1]->work_budget = pm::WorkBudget();
+    pm::decode_detection_events_interleaved(mwpms, shots, results);
+}
+
 TEST(MwpmDecoding, CompareSolutionWeightsWithNoLimitOnNumObservables) {
     DecodingTestCase test_case;
     for (int q : {0, 1}) {
@@ -172,7 +261,7 @@ TEST(MwpmDecoding, DecodeToMatchEdges) {
             break;
         pm::decode_detection_events_to_match_edges(mwpm, sparse_shot.hits);
         auto& match_edges = mwpm.flooder.match_edges;
-        uint64_t obs_mask = 0;
+        pm::obs_int obs_mask = 0;
         std::vector<uint64_t> dets;
         for (auto& e : match_edges) {
             obs_mask ^= e.obs_mask;
@@ -234,8 +323,9 @@ uint64_t get_observables_from_edges(const std::vector<int64_t>& edges, pm::Mwpm&
             auto v_ptr = &mwpm.search_flooder.graph.nodes[v];
             idx = u_node.index_of_neighbor(v_ptr);
         }
-        for (auto& obs : u_node.neighbor_observable_indices[idx])
+        mwpm.search_flooder.graph.iter_observables_of_edge({&u_node, idx}, [&](size_t obs) {
             obs_mask ^= 1 << obs;
+        });
     }
     return obs_mask;
 }
@@ -274,13 +364,19 @@ TEST(MwpmDecoding, DecodeToEdges) {
                     auto v_ptr = &mwpm.search_flooder.graph.nodes[v];
                     idx = u_node.index_of_neighbor(v_ptr);
                 }
-                if (u_node.neighbor_markers[idx] & pm::WEIGHT_SIGN) {
+                bool is_negative = false;
+                for (auto& e : mwpm.search_flooder.graph.negative_weight_edges) {
+                    int64_t e_v = e.second == SIZE_MAX ? -1 : (int64_t)e.second;
+                    is_negative |= ((int64_t)e.first == u && e_v == v) || ((int64_t)e.first == v && e_v == u);
+                }
+                if (is_negative) {
                     tot_weight -= u_node.neighbor_weights[idx];
                 } else {
                     tot_weight += u_node.neighbor_weights[idx];
                 }
-                for (auto& obs : u_node.neighbor_observable_indices[idx])
+                mwpm.search_flooder.graph.iter_observables_of_edge({&u_node, idx}, [&](size_t obs) {
                     obs_mask ^= 1 << obs;
+                });
             }
 
             auto sorted_sol_synd = get_syndrome_from_edges(solution_edges);
@@ -296,6 +392,34 @@ TEST(MwpmDecoding, DecodeToEdges) {
     }
 }
 
+TEST(MwpmDecoding, DecodeToEdgeIdsMatchesDecodeToEdges) {
+    auto test_case = load_surface_code_d13_p100_some_negative_weights_test_case();
+    auto mwpm = pm::detector_error_model_to_mwpm(test_case.detector_error_model, 10001, true);
+    stim::SparseShot sparse_shot;
+    size_t num_shots = 0;
+    std::vector<int64_t> edges;
+    std::vector<size_t> edge_ids;
+    while (test_case.reader->start_and_read_entire_record(sparse_shot) && num_shots < 20) {
+        edges.clear();
+        edge_ids.clear();
+        pm::decode_detection_events_to_edges(mwpm, sparse_shot.hits, edges);
+        pm::decode_detection_events_to_edge_ids(mwpm, sparse_shot.hits, edge_ids);
+        ASSERT_EQ(edge_ids.size() * 2, edges.size());
+        auto& endpoints = mwpm.search_flooder.graph.get_edge_ids().endpoints;
+        for (size_t i = 0; i < edge_ids.size(); i++) {
+            int64_t u = endpoints[2 * edge_ids[i]];
+            int64_t v = endpoints[2 * edge_ids[i] + 1] == SIZE_MAX ? -1 : (int64_t)endpoints[2 * edge_ids[i] + 1];
+            ASSERT_TRUE((edges[2 * i] == u && edges[2 * i + 1] == v) || (edges[2 * i] == v && edges[2 * i + 1] == u));
+        }
+        // The flip parities are cleared after each shot.
+        for (auto p : mwpm.search_flooder.edge_flip_parity)
+            ASSERT_EQ(p, 0);
+        sparse_shot.clear();
+        num_shots++;
+    }
+    ASSERT_EQ(num_shots, 20);
+}
+
 TEST(MwpmDecoding, CompareSolutionObsWithMaxNumBuckets) {
     for (size_t i : {0, 1}) {
         auto test_case = load_surface_code_d13_p100_test_case();
@@ -509,6 +633,35 @@ TEST(MwpmDecoding, NoValidSolutionForLineGraph) {
                  , std::invalid_argument);
 }
 
+TEST(MwpmDecoding, MwpmIsResetAfterFailedDecode) {
+    size_t num_nodes = 5;
+    auto mwpm = pm::Mwpm(pm::GraphFlooder(pm::MatchingGraph(num_nodes, num_nodes)));
+    auto& g = mwpm.flooder.graph;
+    for (size_t i = 0; i < num_nodes; i++)
+        g.add_edge(i, (i + 1) % num_nodes, 2, {i});
+    auto expected = pm::decode_detection_events_for_up_to_64_observables(mwpm, {0, 2});
+
+    auto assert_reset = [&]() {
+        ASSERT_TRUE(mwpm.flooder.reached_nodes.empty());
+        ASSERT_TRUE(mwpm.flooder.queue.empty());
+        for (auto& n : g.nodes) {
+            ASSERT_EQ(n.region_that_arrived, nullptr);
+            ASSERT_EQ(n.region_that_arrived_top, nullptr);
+            ASSERT_EQ(n.reached_from_source, nullptr);
+            ASSERT_EQ(n.radius_of_arrival, 0);
+            ASSERT_FALSE(n.node_event_tracker.has_queued_time);
+        }
+    };
+    // No perfect matching.
+    EXPECT_THROW(pm::decode_detection_events_for_up_to_64_observables(mwpm, {0, 2, 3});, std::invalid_argument);
+    assert_reset();
+    ASSERT_EQ(pm::decode_detection_events_for_up_to_64_observables(mwpm, {0, 2}), expected);
+    // A detection event that is not in the graph, after others have been added.
+    EXPECT_THROW(pm::decode_detection_events_for_up_to_64_observables(mwpm, {0, 2, 7});, std::invalid_argument);
+    assert_reset();
+    ASSERT_EQ(pm::decode_detection_events_for_up_to_64_observables(mwpm, {0, 2}), expected);
+}
+
 TEST(MwpmDecoding, InvalidSyndromeForToricCode) {
     auto shots_in = std::fopen(find_test_data_file("toric_code_unrotated_memory_x_5_0.005_1000.b8").c_str(), "r");
     auto dem_file = std::fopen(find_test_data_file("toric_code_unrotated_memory_x_5_0.005.dem").c_str(), "r");
@@ -541,3 +694,427 @@ TEST(MwpmDecoding, InvalidSyndromeForToricCode) {
         num_shots++;
     }
 }
+
+TEST(MwpmDecoding, SmallSyndromesMatchFullAlgorithm) {
+    for (bool precompute_boundary_distances : {false, true}) {
+        auto test_case = load_surface_code_d13_p100_test_case();
+        pm::weight_int num_distinct_weights = 1000;
+        auto mwpm = pm::detector_error_model_to_mwpm(test_case.detector_error_model, num_distinct_weights);
+        if (precompute_boundary_distances)
+            mwpm.small_syndrome_cache.precompute_boundary_distances(mwpm.flooder.graph);
+        auto mwpm_full = pm::detector_error_model_to_mwpm(test_case.detector_error_model, num_distinct_weights);
+        mwpm_full.small_syndrome_cache.enabled = false;
+        size_t num_nodes = mwpm.flooder.graph.nodes.size();
+
+        std::vector<std::vector<uint64_t>> syndromes = {{}};
+        for (size_t i = 0; i < num_nodes; i++) {
+            syndromes.push_back({i});
+            // Nearby pairs, which are usually matched to each other.
+            for (size_t j : {i + 1, i + 7, i + 90})
+                if (j < num_nodes)
+                    syndromes.push_back({i, j});
+        }
+        std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+        while (syndromes.size() < 4 * num_nodes + 5000) {
+            size_t i = rng() % num_nodes;
+            size_t j = rng() % num_nodes;
+            if (i != j)
+                syndromes.push_back({i, j});
+        }
+
+        for (auto& syndrome : syndromes) {
+            auto res = pm::decode_detection_events_for_up_to_64_observables(mwpm, syndrome);
+            auto expected = pm::decode_detection_events_for_up_to_64_observables(mwpm_full, syndrome);
+            ASSERT_EQ(res, expected);
+
+            pm::ExtendedMatchingResult ext_res(mwpm.flooder.graph.num_observables);
+            pm::ExtendedMatchingResult ext_expected(mwpm.flooder.graph.num_observables);
+            pm::decode_detection_events(mwpm, syndrome, ext_res.obs_crossed.data(), ext_res.weight);
+            pm::decode_detection_events(mwpm_full, syndrome, ext_expected.obs_crossed.data(), ext_expected.weight);
+            ASSERT_EQ(ext_res, ext_expected);
+        }
+        for (size_t i = 0; i < num_nodes; i++) {
+            ASSERT_EQ(mwpm.small_syndrome_cache.state(i), pm::BOUNDARY_MATCH_KNOWN);
+            if (precompute_boundary_distances) {
+                ASSERT_EQ(
+                    mwpm.small_syndrome_cache.boundary_match_weights[i],
+                    mwpm.small_syndrome_cache.boundary_distances->distances[i]);
+            }
+        }
+    }
+}
+
+TEST(MwpmDecoding, SmallSyndromesWithoutBoundary) {
+    auto dem_file = std::fopen(find_test_data_file("toric_code_unrotated_memory_x_5_0.005.dem").c_str(), "r");
+    assert(dem_file);
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, 1000);
+    auto mwpm_full = pm::detector_error_model_to_mwpm(dem, 1000);
+    mwpm_full.small_syndrome_cache.enabled = false;
+
+    EXPECT_THROW(pm::decode_detection_events_for_up_to_64_observables(mwpm, {3});, std::invalid_argument);
+    ASSERT_EQ(mwpm.small_syndrome_cache.state(3), pm::BOUNDARY_MATCH_UNREACHABLE);
+    // The same detection event can still be matched to another one.
+    ASSERT_EQ(
+        pm::decode_detection_events_for_up_to_64_observables(mwpm, {3, 4}),
+        pm::decode_detection_events_for_up_to_64_observables(mwpm_full, {3, 4}));
+    ASSERT_EQ(pm::decode_detection_events_for_up_to_64_observables(mwpm, {}), pm::MatchingResult());
+}
+
+TEST(MwpmDecoding, LookupTableMatchesFullAlgorithmOnSmallGraph) {
+    auto dem_file = std::fopen(find_test_data_file("toric_code_unrotated_memory_x_5_0.005.dem").c_str(), "r");
+    assert(dem_file);
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, 1000);
+    auto mwpm_full = pm::detector_error_model_to_mwpm(dem, 1000);
+    mwpm_full.small_syndrome_cache.enabled = false;
+    size_t num_nodes = mwpm.flooder.graph.nodes.size();
+    ASSERT_LE(num_nodes, pm::AllPairsPaths::MAX_NODES);
+    ASSERT_NE(mwpm.small_syndrome_cache.precompute_all_pairs_paths(mwpm.flooder.graph), nullptr);
+
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+    size_t num_looked_up = 0;
+    for (size_t shot = 0; shot < 2000; shot++) {
+        // The toric code has no boundary, so only syndromes with an even number of detection events can be matched.
+        // Nearby detection events are more likely to have a unique solution.
+        size_t num_events = 2 * (1 + rng() % (pm::SmallSyndromeCache::MAX_LOOKUP_DETECTION_EVENTS / 2));
+        size_t first = rng() % num_nodes;
+        std::set<uint64_t> events;
+        while (events.size() < num_events)
+            events.insert((first + rng() % 20) % num_nodes);
+        std::vector<uint64_t> syndrome(events.begin(), events.end());
+
+        std::vector<size_t> event_nodes(syndrome.begin(), syndrome.end());
+        pm::MatchingResult looked_up;
+        if (mwpm.small_syndrome_cache.match_with_all_pairs_paths(
+                event_nodes.data(), event_nodes.size(), looked_up.obs_mask, looked_up.weight)) {
+            num_looked_up++;
+            ASSERT_EQ(looked_up, pm::decode_detection_events_for_up_to_64_observables(mwpm_full, syndrome));
+        }
+        ASSERT_EQ(
+            pm::decode_detection_events_for_up_to_64_observables(mwpm, syndrome),
+            pm::decode_detection_events_for_up_to_64_observables(mwpm_full, syndrome));
+    }
+    ASSERT_GT(num_looked_up, 0);
+
+    // Changing an edge weight (as `UserGraph::set_edge_weight' does) forgets the table.
+    mwpm.small_syndrome_cache.clear();
+    ASSERT_EQ(mwpm.small_syndrome_cache.all_pairs_paths, nullptr);
+}
+
+TEST(MwpmDecoding, ReorderedNodesGiveSameSolutionWeights) {
+    auto shots_in = std::fopen(find_test_data_file("negative_weight_circuit_1000.b8").c_str(), "r");
+    auto dem_file = std::fopen(find_test_data_file("negative_weight_circuit.dem").c_str(), "r");
+
+    assert(shots_in);
+    assert(dem_file);
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, 1000, true);
+    auto reordered = pm::detector_error_model_to_mwpm(dem, 1000, true, true);
+    ASSERT_EQ(mwpm.flooder.graph.node_relabeling, nullptr);
+    ASSERT_NE(reordered.flooder.graph.node_relabeling, nullptr);
+    auto reader = stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(
+        shots_in, stim::SampleFormat::SAMPLE_FORMAT_B8, 0, dem.count_detectors(), dem.count_observables());
+
+    stim::SparseShot sparse_shot;
+    size_t num_shots = 0;
+    std::vector<int64_t> edges;
+    while (reader->start_and_read_entire_record(sparse_shot) && num_shots < 200) {
+        auto expected = pm::decode_detection_events_for_up_to_64_observables(mwpm, sparse_shot.hits);
+        auto res = pm::decode_detection_events_for_up_to_64_observables(reordered, sparse_shot.hits);
+        ASSERT_EQ(res.weight, expected.weight);
+
+        // The edges are reported using the original detector indices.
+        edges.clear();
+        pm::decode_detection_events_to_edges(reordered, sparse_shot.hits, edges);
+        ASSERT_EQ(get_syndrome_from_edges(edges), sparse_shot.hits);
+        sparse_shot.clear();
+        num_shots++;
+    }
+    fclose(shots_in);
+    ASSERT_EQ(num_shots, 200);
+
+    // Detection events that are not nodes of the graph are still rejected.
+    EXPECT_THROW(
+        pm::decode_detection_events_for_up_to_64_observables(reordered, {dem.count_detectors()});
+        , std::invalid_argument);
+}
+
+TEST(MwpmDecoding, NegativeWeightEdgesMatchFlippedPositiveEdges) {
+    // Decoding with a negative weight edge is equivalent to decoding with the edge's absolute weight, with the edge
+    // flipped in the syndrome and in the solution.
+    size_t num_nodes = 12;
+    std::set<size_t> negative_edges = {2, 7};
+    pm::UserGraph negative;
+    pm::UserGraph positive;
+    std::vector<uint64_t> flipped_nodes;
+    double negative_weight_sum = 0;
+    for (size_t i = 0; i + 1 < num_nodes; i++) {
+        double w = 1 + 0.1 * i + 0.013 * i * i;
+        bool is_negative = negative_edges.count(i);
+        negative.add_or_merge_edge(i, i + 1, {i}, is_negative ? -w : w, -1);
+        positive.add_or_merge_edge(i, i + 1, {i}, w, -1);
+        if (is_negative) {
+            flipped_nodes.push_back(i);
+            flipped_nodes.push_back(i + 1);
+            negative_weight_sum -= w;
+        }
+    }
+    for (auto* g : {&negative, &positive}) {
+        g->add_or_merge_boundary_edge(0, {num_nodes}, 2.05, -1);
+        g->add_or_merge_boundary_edge(num_nodes - 1, {num_nodes + 1}, 2.35, -1);
+    }
+    auto& negative_mwpm = negative.get_mwpm();
+    auto& positive_mwpm = positive.get_mwpm();
+    ASSERT_EQ(negative_mwpm.flooder.negative_weight_detection_events, flipped_nodes);
+    size_t num_observables = negative.get_num_observables();
+
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+    for (size_t shot = 0; shot < 500; shot++) {
+        std::vector<uint8_t> syndrome(num_nodes, 0);
+        std::vector<uint64_t> detection_events;
+        for (size_t i = 0; i < num_nodes; i++) {
+            if (rng() % 3 == 0) {
+                syndrome[i] ^= 1;
+                detection_events.push_back(i);
+            }
+        }
+        // A repeated detection event cancels itself out, and the order of the detection events doesn't matter.
+        if (shot % 4 == 1) {
+            detection_events.push_back(flipped_nodes[shot % flipped_nodes.size()]);
+            detection_events.push_back(flipped_nodes[shot % flipped_nodes.size()]);
+        }
+        if (shot % 2 == 1)
+            std::shuffle(detection_events.begin(), detection_events.end(), rng);
+        for (auto n : flipped_nodes)
+            syndrome[n] ^= 1;
+        std::vector<uint64_t> positive_detection_events;
+        for (size_t i = 0; i < num_nodes; i++) {
+            if (syndrome[i])
+                positive_detection_events.push_back(i);
+        }
+
+        std::vector<uint8_t> obs(num_observables, 0);
+        std::vector<uint8_t> expected_obs(num_observables, 0);
+        pm::total_weight_int weight = 0;
+        pm::total_weight_int expected_weight = 0;
+        pm::decode_detection_events(negative_mwpm, detection_events, obs.data(), weight);
+        pm::decode_detection_events(positive_mwpm, positive_detection_events, expected_obs.data(), expected_weight);
+        for (auto i : negative_edges)
+            expected_obs[i] ^= 1;
+        ASSERT_EQ(obs, expected_obs);
+        ASSERT_EQ(weight, expected_weight + negative_mwpm.flooder.negative_weight_sum);
+        ASSERT_NEAR(
+            (double)weight / negative_mwpm.flooder.graph.normalising_constant,
+            (double)expected_weight / positive_mwpm.flooder.graph.normalising_constant + negative_weight_sum,
+            1e-2);
+    }
+
+    // An invalid detection event leaves the Mwpm ready for the next shot.
+    std::vector<uint8_t> obs(num_observables, 0);
+    pm::total_weight_int weight = 0;
+    std::vector<uint64_t> invalid_detection_events = {3, 100};
+    ASSERT_THROW(
+        pm::decode_detection_events(negative_mwpm, invalid_detection_events, obs.data(), weight), std::invalid_argument);
+    pm::decode_detection_events(negative_mwpm, std::vector<uint64_t>{}, obs.data(), weight);
+    ASSERT_EQ(weight, 0);
+    ASSERT_EQ(obs, std::vector<uint8_t>(num_observables, 0));
+}
+
+TEST(MwpmDecoding, ParallelPathsMatchSequentialPaths) {
+    // A grid with an observable for each edge, so that the observables don't fit in a bit mask and the paths of the
+    // match edges are found with the search flooder.
+    size_t width = 40;
+    auto make_graph = [&]() {
+        pm::UserGraph graph;
+        size_t num_edges = 0;
+        for (size_t r = 0; r < width; r++) {
+            for (size_t c = 0; c < width; c++) {
+                size_t n = r * width + c;
+                if (c + 1 < width)
+                    graph.add_or_merge_edge(n, n + 1, {num_edges++}, 1 + (n % 7) * 0.1, -1);
+                if (r + 1 < width)
+                    graph.add_or_merge_edge(n, n + width, {num_edges++}, 1 + (n % 5) * 0.1, -1);
+                if (c == 0)
+                    graph.add_or_merge_boundary_edge(n, {num_edges++}, 1.5, -1);
+            }
+        }
+        return graph;
+    };
+    auto sequential = make_graph();
+    auto parallel = make_graph();
+    parallel.set_num_path_threads(4);
+    ASSERT_EQ(parallel.get_num_path_threads(), 4);
+    ASSERT_EQ(parallel.get_mwpm().num_path_threads(), 4);
+    ASSERT_THROW(parallel.set_num_path_threads(0), std::invalid_argument);
+    size_t num_observables = sequential.get_num_observables();
+
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+    for (size_t shot = 0; shot < 20; shot++) {
+        std::vector<uint64_t> detection_events;
+        for (size_t n = 0; n < width * width; n++) {
+            if (rng() % 8 == 0)
+                detection_events.push_back(n);
+        }
+        std::vector<uint8_t> obs(num_observables, 0);
+        std::vector<uint8_t> expected_obs(num_observables, 0);
+        pm::total_weight_int weight = 0;
+        pm::total_weight_int expected_weight = 0;
+        pm::decode_detection_events(parallel.get_mwpm(), detection_events, obs.data(), weight);
+        pm::decode_detection_events(sequential.get_mwpm(), detection_events, expected_obs.data(), expected_weight);
+        ASSERT_GE(parallel.get_mwpm().flooder.match_edges.size(), 64);
+        ASSERT_EQ(obs, expected_obs);
+        ASSERT_EQ(weight, expected_weight);
+
+        std::vector<int64_t> edges;
+        std::vector<int64_t> expected_edges;
+        pm::decode_detection_events_to_edges(parallel.get_mwpm_with_search_graph(), detection_events, edges);
+        pm::decode_detection_events_to_edges(sequential.get_mwpm_with_search_graph(), detection_events, expected_edges);
+        ASSERT_EQ(edges, expected_edges);
+    }
+}
+
+TEST(MwpmDecoding, UnionFindEngineHandlesNegativeWeights) {
+    size_t num_nodes = 8;
+    for (size_t max_obs : {40, 100}) {
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(pm::MatchingGraph(num_nodes, max_obs + 1)));
+        mwpm.set_decoder_engine(pm::UNION_FIND);
+
+        auto& g = mwpm.flooder.graph;
+        g.add_boundary_edge(0, -4, {max_obs});
+        for (size_t i = 0; i < 7; i += 2)
+            g.add_edge(i, i + 1, 2, {i + 1});
+        for (size_t i = 1; i < 7; i += 2)
+            g.add_edge(i, i + 1, -4, {i + 1});
+        g.add_boundary_edge(7, 2, {num_nodes});
+        mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+
+        pm::ExtendedMatchingResult res(max_obs + 1);
+        pm::decode_detection_events(mwpm, {0, 1, 2, 5, 6, 7}, res.obs_crossed.data(), res.weight);
+
+        pm::ExtendedMatchingResult res_expected(max_obs + 1);
+        res_expected.obs_crossed[max_obs] ^= 1;
+        res_expected.obs_crossed[2] ^= 1;
+        res_expected.obs_crossed[6] ^= 1;
+        res_expected.obs_crossed[num_nodes] ^= 1;
+        res_expected.weight = -10;
+        ASSERT_EQ(res, res_expected);
+
+        if (max_obs + 1 <= sizeof(pm::obs_int) * 8) {
+            auto res2 = pm::decode_detection_events_for_up_to_64_observables(mwpm, {0, 1, 2, 5, 6, 7});
+            ASSERT_EQ(res2.weight, res_expected.weight);
+            ASSERT_EQ(
+                res2.obs_mask,
+                (pm::obs_int)1 << max_obs | (pm::obs_int)1 << 2 | (pm::obs_int)1 << 6 | (pm::obs_int)1 << num_nodes);
+        }
+    }
+}
+
+TEST(MwpmDecoding, ShotsOverWorkBudgetAreDecodedWithUnionFind) {
+    size_t num_nodes = 40;
+    auto make_graph = [&]() {
+        pm::UserGraph graph;
+        graph.add_or_merge_boundary_edge(0, {0}, 2.0, -1);
+        for (size_t i = 0; i + 1 < num_nodes; i++)
+            graph.add_or_merge_edge(i, i + 1, {i % 6}, 1.0 + (i % 3) * 0.5, -1);
+        graph.add_or_merge_boundary_edge(num_nodes - 1, {1}, 2.0, -1);
+        return graph;
+    };
+    auto graph = make_graph();
+    auto union_find_graph = make_graph();
+    union_find_graph.set_decoder_engine(pm::UNION_FIND);
+    auto budget_graph = make_graph();
+    budget_graph.set_work_budget(pm::WorkBudget{1, 0});
+    ASSERT_EQ(budget_graph.get_mwpms(2)[1]->work_budget, (pm::WorkBudget{1, 0}));
+    auto generous_budget_graph = make_graph();
+    generous_budget_graph.set_work_budget(pm::WorkBudget{1000000, 0});
+
+    std::mt19937 rng(7);
+    size_t num_shots = 0;
+    for (size_t k = 0; k < 30; k++) {
+        std::vector<uint64_t> syndrome;
+        for (size_t i = 0; i < num_nodes; i++)
+            if (rng() % 3 == 0)
+                syndrome.push_back(i);
+        if (syndrome.size() <= pm::SmallSyndromeCache::MAX_LOOKUP_DETECTION_EVENTS)
+            continue;
+        num_shots++;
+        auto expected = pm::decode_detection_events_for_up_to_64_observables(graph.get_mwpm(), syndrome);
+        auto union_find = pm::decode_detection_events_for_up_to_64_observables(union_find_graph.get_mwpm(), syndrome);
+        ASSERT_EQ(
+            pm::decode_detection_events_for_up_to_64_observables(budget_graph.get_mwpm(), syndrome), union_find);
+        ASSERT_EQ(
+            pm::decode_detection_events_for_up_to_64_observables(generous_budget_graph.get_mwpm(), syndrome),
+            expected);
+
+        pm::ExtendedMatchingResult res(6), union_find_res(6);
+        pm::decode_detection_events(budget_graph.get_mwpm(), syndrome, res.obs_crossed.data(), res.weight);
+        pm::decode_detection_events(
+            union_find_graph.get_mwpm(), syndrome, union_find_res.obs_crossed.data(), union_find_res.weight);
+        ASSERT_EQ(res, union_find_res);
+    }
+    ASSERT_GT(num_shots, 10);
+    ASSERT_EQ(budget_graph.get_num_degraded_shots(), 2 * num_shots);
+    ASSERT_EQ(generous_budget_graph.get_num_degraded_shots(), 0);
+
+    // The Mwpm is left usable after a shot is abandoned.
+    budget_graph.set_work_budget(pm::WorkBudget());
+    ASSERT_EQ(
+        pm::decode_detection_events_for_up_to_64_observables(budget_graph.get_mwpm(), {3, 9}),
+        pm::decode_detection_events_for_up_to_64_observables(graph.get_mwpm(), {3, 9}));
+}
+
+TEST(MwpmDecoding, OutputsFromOneDecodeMatchSeparateDecodes) {
+    for (size_t num_observables : {10, 100}) {
+        std::mt19937 rng(7);
+        pm::UserGraph graph;
+        size_t num_nodes = 40;
+        for (size_t i = 0; i < num_nodes; i++) {
+            for (size_t k = 0; k < 3; k++) {
+                size_t j = rng() % num_nodes;
+                if (j != i)
+                    graph.add_or_merge_edge(i, j, {rng() % num_observables}, 1.0 + rng() % 5, -1, pm::SMALLEST_WEIGHT);
+            }
+        }
+        graph.add_or_merge_boundary_edge(0, {num_observables - 1}, 3.0, -1);
+        auto& mwpm = graph.get_mwpm_with_search_graph();
+        for (size_t shot = 0; shot < 50; shot++) {
+            std::vector<uint64_t> detection_events;
+            for (size_t i = 0; i < num_nodes; i++) {
+                if (rng() % 4 == 0)
+                    detection_events.push_back(i);
+            }
+
+            std::vector<uint8_t> obs(num_observables, 0);
+            pm::total_weight_int weight = 0;
+            std::vector<int64_t> matched, edges;
+            pm::decode_detection_events_to_outputs(mwpm, detection_events, obs.data(), &weight, &matched, &edges);
+
+            pm::ExtendedMatchingResult expected(num_observables);
+            pm::decode_detection_events(mwpm, detection_events, expected.obs_crossed.data(), expected.weight);
+            ASSERT_EQ(obs, expected.obs_crossed);
+            ASSERT_EQ(weight, expected.weight);
+            pm::decode_detection_events_to_match_edges(mwpm, detection_events);
+            std::vector<int64_t> expected_matched;
+            for (auto& e : mwpm.flooder.match_edges) {
+                expected_matched.push_back(e.loc_from - &mwpm.flooder.graph.nodes[0]);
+                expected_matched.push_back(e.loc_to ? e.loc_to - &mwpm.flooder.graph.nodes[0] : -1);
+            }
+            ASSERT_EQ(matched, expected_matched);
+            std::vector<int64_t> expected_edges;
+            pm::decode_detection_events_to_edges(mwpm, detection_events, expected_edges);
+            ASSERT_EQ(edges, expected_edges);
+
+            // Any subset of the outputs can be requested.
+            pm::total_weight_int weight_only = 0;
+            pm::decode_detection_events_to_outputs(mwpm, detection_events, nullptr, &weight_only, nullptr, nullptr);
+            ASSERT_EQ(weight_only, expected.weight);
+            std::vector<int64_t> edges_only;
+            pm::decode_detection_events_to_outputs(mwpm, detection_events, nullptr, nullptr, nullptr, &edges_only);
+            ASSERT_EQ(edges_only, expected_edges);
+        }
+    }
+}
@@ -14,16 +14,142 @@
 
 #include "pymatching/sparse_blossom/driver/namespaced_main.h"
 
+#include <atomic>
 #include <chrono>
 #include <cstring>
+#include <fstream>
 #include <iostream>
+#include <random>
 #include <vector>
 
+#include "pymatching/sparse_blossom/decoder_trace.h"
 #include "pymatching/sparse_blossom/diagram/animation_main.h"
+#include "pymatching/sparse_blossom/driver/distributed_sweep.h"
+#include "pymatching/sparse_blossom/driver/graph_file.h"
 #include "pymatching/sparse_blossom/driver/io.h"
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
 #include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/mapped_shot_file.h"
+#include "pymatching/sparse_blossom/driver/prediction_writer.h"
+#include "pymatching/sparse_blossom/driver/sample_and_decode.h"
+#include "pymatching/sparse_blossom/driver/shot_pipeline.h"
+#include "pymatching/sparse_blossom/driver/stopping_rule.h"
+#include "pymatching/sparse_blossom/driver/transposed_shots.h"
 #include "stim.h"
 
+namespace {
+
+/// The shot data given by the `--in` argument (or stdin). A `b8` or `r8` file is memory mapped, so that detection
+/// events are read directly from the mapped pages. `ptb64` data is read a block of 64 shots at a time, and scattered
+/// into the shots without transposing it bit by bit. Any other input is read using a stim::MeasureRecordReader.
+struct ShotInput {
+    FILE *file;
+    std::unique_ptr<stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>> reader;
+    std::unique_ptr<pm::MappedShotFile> mapped_file;
+    std::unique_ptr<pm::Ptb64ShotReader> ptb64_reader;
+
+    ShotInput(
+        int argc,
+        const char **argv,
+        stim::SampleFormat format,
+        size_t num_detectors,
+        size_t num_appended_observables)
+        : file(nullptr) {
+        const char *path = stim::find_argument("--in", argc, argv);
+        if (path != nullptr && pm::MappedShotFile::supports_format(format)) {
+            mapped_file = std::make_unique<pm::MappedShotFile>(path, format, num_detectors, num_appended_observables);
+        } else if (format == stim::SampleFormat::SAMPLE_FORMAT_PTB64) {
+            file = stim::find_open_file_argument("--in", stdin, "rb", argc, argv);
+            ptb64_reader = std::make_unique<pm::Ptb64ShotReader>(file, num_detectors, num_appended_observables);
+        } else {
+            file = stim::find_open_file_argument("--in", stdin, "rb", argc, argv);
+            reader = stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(
+                file, format, 0, num_detectors, num_appended_observables);
+        }
+    }
+
+    ~ShotInput() {
+        if (file != nullptr && file != stdin) {
+            fclose(file);
+        }
+    }
+
+    bool read_shot(stim::SparseShot &shot) {
+        if (mapped_file != nullptr)
+            return mapped_file->read_next_shot(shot);
+        if (ptb64_reader != nullptr)
+            return ptb64_reader->read_shot(shot);
+        return reader->start_and_read_entire_record(shot);
+    }
+};
+
+/// The decoder given by the `--decoder' argument: `sparse_blossom' (the default), or `union_find' (or `uf').
+pm::DecoderEngine decoder_engine_from_arguments(int argc, const char **argv) {
+    const char *decoder = stim::find_argument("--decoder", argc, argv);
+    return decoder == nullptr ? pm::SPARSE_BLOSSOM : pm::decoder_engine_from_string(decoder);
+}
+
+/// Builds `num_mwpms' Mwpm objects for the decoding graph given either by a detector error model (`--dem') or by a
+/// graph file previously written by `pymatching save_graph' (`--graph_in'). With `--reorder_nodes', the nodes of a
+/// detector error model are relabeled to improve memory locality (a graph file keeps the ordering it was saved with).
+/// With `--periodic_topology', the edges of the repeated rounds of a detector error model are only stored once.
+/// With `--syndrome_cache_size #', each Mwpm caches the solutions of up to that many recently decoded syndromes.
+/// With `--decoder uf', shots are decoded with the Union-Find decoder instead of sparse blossom.
+std::vector<pm::Mwpm> load_mwpms_from_arguments(int argc, const char **argv, size_t num_mwpms) {
+    const char *graph_in = stim::find_argument("--graph_in", argc, argv);
+    bool has_dem = stim::find_argument("--dem", argc, argv) != nullptr;
+    if ((graph_in != nullptr) == has_dem)
+        throw std::invalid_argument("Must specify exactly one of --dem or --graph_in.");
+    size_t syndrome_cache_size =
+        (size_t)stim::find_int64_argument("--syndrome_cache_size", 0, 0, INT64_C(1) << 32, argc, argv);
+    std::vector<pm::Mwpm> mwpms;
+    if (graph_in != nullptr) {
+        mwpms = pm::load_mwpms_from_graph_file(graph_in, num_mwpms);
+    } else {
+        bool reorder_nodes = stim::find_bool_argument("--reorder_nodes", argc, argv);
+        bool periodic_topology = stim::find_bool_argument("--periodic_topology", argc, argv);
+        FILE *dem_file = stim::find_open_file_argument("--dem", nullptr, "r", argc, argv);
+        stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+        fclose(dem_file);
+        mwpms = pm::detector_error_model_to_mwpms(
+            dem, pm::NUM_DISTINCT_WEIGHTS, num_mwpms, reorder_nodes, periodic_topology);
+    }
+    pm::DecoderEngine engine = decoder_engine_from_arguments(argc, argv);
+    for (auto &mwpm : mwpms) {
+        mwpm.syndrome_cache.set_capacity(syndrome_cache_size);
+        mwpm.set_decoder_engine(engine);
+    }
+    return mwpms;
+}
+
+/// The stopping rule given by the `--max_shots', `--max_errors' and `--max_relative_error' arguments, each of which
+/// is unlimited if not given.
+pm::StoppingRule stopping_rule_from_arguments(int argc, const char **argv) {
+    pm::StoppingRule rule;
+    if (stim::find_argument("--max_shots", argc, argv) != nullptr)
+        rule.max_shots = (size_t)stim::find_int64_argument("--max_shots", 0, 0, INT64_MAX, argc, argv);
+    if (stim::find_argument("--max_errors", argc, argv) != nullptr)
+        rule.max_errors = (size_t)stim::find_int64_argument("--max_errors", 0, 0, INT64_MAX, argc, argv);
+    rule.max_relative_error = stim::find_float_argument("--max_relative_error", 0, 0, 1000, argc, argv);
+    return rule;
+}
+
+/// Prints the decoder stats accumulated over `num_shots' shots, as totals and per shot (or, for the maxima, as the
+/// largest value seen in any shot).
+void print_decoder_stats(const pm::DecoderStats &stats, size_t num_shots) {
+    auto values = stats.values();
+    std::cerr << "Decoder stats (total, per shot):\n";
+    for (size_t k = 0; k < pm::DecoderStats::NUM_FIELDS; k++) {
+        std::string name = pm::DecoderStats::FIELD_NAMES[k];
+        std::cerr << "    " << name << ": " << values[k];
+        if (name.rfind("max_", 0) != 0 && num_shots > 0)
+            std::cerr << ", " << (double)values[k] / (double)num_shots;
+        std::cerr << "\n";
+    }
+}
+
+}  // namespace
+
 int main_predict(int argc, const char **argv) {
     stim::check_for_unknown_arguments(
         {
@@ -33,51 +159,83 @@ int main_predict(int argc, const char **argv) {
             "--out",
             "--out_format",
             "--dem",
+            "--graph_in",
+            "--threads",
+            "--largest_shots_first",
+            "--reorder_nodes",
+            "--periodic_topology",
+            "--syndrome_cache_size",
+            "--decoder",
         },
         {},
         "predict",
         argc,
         argv);
 
-    FILE *shots_in = stim::find_open_file_argument("--in", stdin, "rb", argc, argv);
     FILE *predictions_out = stim::find_open_file_argument("--out", stdout, "wb", argc, argv);
-    FILE *dem_file = stim::find_open_file_argument("--dem", nullptr, "r", argc, argv);
     stim::FileFormatData shots_in_format =
         stim::find_enum_argument("--in_format", "b8", stim::format_name_to_enum_map(), argc, argv);
     stim::FileFormatData predictions_out_format =
         stim::find_enum_argument("--out_format", "01", stim::format_name_to_enum_map(), argc, argv);
     bool append_obs = stim::find_bool_argument("--in_includes_appended_observables", argc, argv);
+    size_t num_threads = (size_t)stim::find_int64_argument("--threads", 1, 1, 1024, argc, argv);
+    bool largest_shots_first = stim::find_bool_argument("--largest_shots_first", argc, argv);
 
-    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
-    fclose(dem_file);
-
-    size_t num_obs = dem.count_observables();
-    auto reader =
-        stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(shots_in, shots_in_format.id, 0, dem.count_detectors(), append_obs * num_obs);
-    auto writer = stim::MeasureRecordWriter::make(predictions_out, predictions_out_format.id);
-    writer->begin_result_type('L');
-
-    pm::weight_int num_buckets = pm::NUM_DISTINCT_WEIGHTS;
-    auto mwpm = pm::detector_error_model_to_mwpm(dem, num_buckets);
-
-    stim::SparseShot sparse_shot;
-    sparse_shot.clear();
-    pm::ExtendedMatchingResult res(mwpm.flooder.graph.num_observables);
-    while (reader->start_and_read_entire_record(sparse_shot)) {
-        pm::decode_detection_events(mwpm, sparse_shot.hits, res.obs_crossed.data(), res.weight);
+    auto mwpms = load_mwpms_from_arguments(argc, argv, num_threads);
+    size_t num_obs = mwpms[0].flooder.graph.num_observables;
+    ShotInput shots_in(argc, argv, shots_in_format.id, mwpms[0].flooder.graph.num_nodes, append_obs * num_obs);
+    // Predictions in the `01', `b8', `r8' and `ptb64' formats are encoded a whole shot at a time by a
+    // PredictionWriter (stim's writers don't support `ptb64'). Other formats are written bit by bit by stim.
+    std::unique_ptr<pm::PredictionWriter> prediction_writer;
+    std::unique_ptr<stim::MeasureRecordWriter> writer;
+    if (pm::PredictionWriter::supports_format(predictions_out_format.id)) {
+        prediction_writer =
+            std::make_unique<pm::PredictionWriter>(predictions_out, predictions_out_format.id, num_obs);
+    } else {
+        writer = stim::MeasureRecordWriter::make(predictions_out, predictions_out_format.id);
+        writer->begin_result_type('L');
+    }
+    auto write_prediction = [&](const pm::ExtendedMatchingResult &res) {
+        if (prediction_writer != nullptr) {
+            prediction_writer->write_shot(res.obs_crossed.data());
+            return;
+        }
         for (size_t k = 0; k < num_obs; k++) {
             writer->write_bit(res.obs_crossed[k]);
         }
         writer->write_end();
+    };
+
+    if (num_threads == 1) {
+        auto &mwpm = mwpms[0];
+        stim::SparseShot sparse_shot;
         sparse_shot.clear();
-        res.reset();
+        pm::ExtendedMatchingResult res(mwpm.flooder.graph.num_observables);
+        while (shots_in.read_shot(sparse_shot)) {
+            pm::decode_detection_events(mwpm, sparse_shot.hits, res.obs_crossed.data(), res.weight);
+            write_prediction(res);
+            sparse_shot.clear();
+            res.reset();
+        }
+    } else {
+        // Read, decode and write concurrently, with one decoder thread per Mwpm.
+        pm::decode_shots_pipelined(
+            [&](stim::SparseShot &shot) {
+                return shots_in.read_shot(shot);
+            },
+            mwpms,
+            mwpms[0].flooder.graph.num_observables,
+            [&](const stim::SparseShot &, const pm::ExtendedMatchingResult &res) {
+                write_prediction(res);
+            },
+            1024,
+            largest_shots_first);
     }
+    if (prediction_writer != nullptr)
+        prediction_writer->finish();
     if (predictions_out != stdout) {
         fclose(predictions_out);
     }
-    if (shots_in != stdin) {
-        fclose(shots_in);
-    }
 
     return EXIT_SUCCESS;
 }
@@ -92,77 +250,413 @@ int main_count_mistakes(int argc, const char **argv) {
             "--obs_in_format",
             "--out",
             "--dem",
+            "--graph_in",
             "--time",
+            "--latency_histogram",
+            "--trace_out",
+            "--trace_quantile",
+            "--trace_capacity",
+            "--reorder_nodes",
+            "--periodic_topology",
+            "--syndrome_cache_size",
+            "--decoder",
+            "--threads",
+            "--max_shots",
+            "--max_errors",
+            "--max_relative_error",
         },
         {},
         "count_mistakes",
         argc,
         argv);
 
-    FILE *shots_in = stim::find_open_file_argument("--in", stdin, "rb", argc, argv);
     FILE *obs_in = stim::find_open_file_argument("--obs_in", stdin, "rb", argc, argv);
     FILE *stats_out = stim::find_open_file_argument("--out", stdout, "wb", argc, argv);
-    FILE *dem_file = stim::find_open_file_argument("--dem", nullptr, "r", argc, argv);
     stim::FileFormatData shots_in_format =
         stim::find_enum_argument("--in_format", "01", stim::format_name_to_enum_map(), argc, argv);
     stim::FileFormatData obs_in_format =
         stim::find_enum_argument("--obs_in_format", "01", stim::format_name_to_enum_map(), argc, argv);
     bool append_obs = stim::find_bool_argument("--in_includes_appended_observables", argc, argv);
     bool time = stim::find_bool_argument("--time", argc, argv);
+    const char *latency_histogram_path = stim::find_argument("--latency_histogram", argc, argv);
+    const char *trace_path = stim::find_argument("--trace_out", argc, argv);
+    double trace_quantile = stim::find_float_argument("--trace_quantile", 0.999, 0, 1, argc, argv);
+    size_t trace_capacity =
+        (size_t)stim::find_int64_argument("--trace_capacity", 1 << 16, 1, INT64_C(1) << 28, argc, argv);
+    size_t num_threads = (size_t)stim::find_int64_argument("--threads", 1, 1, 1024, argc, argv);
+    pm::StoppingRule stopping_rule = stopping_rule_from_arguments(argc, argv);
     if (!append_obs && obs_in == nullptr) {
         throw std::invalid_argument("Must specify --in_includes_appended_observables or --obs_in.");
     }
+    if (num_threads > 1 && latency_histogram_path != nullptr) {
+        throw std::invalid_argument("--latency_histogram can only be used with a single thread.");
+    }
+    if (trace_path != nullptr && num_threads > 1) {
+        throw std::invalid_argument("--trace_out can only be used with a single thread.");
+    }
+    if (trace_path != nullptr && !pm::DECODER_TRACE_ENABLED) {
+        throw std::invalid_argument("--trace_out needs pymatching to be built with PYMATCHING_DECODER_TRACE.");
+    }
 
-    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
-    fclose(dem_file);
-
-    size_t num_obs = dem.count_observables();
+    auto mwpms = load_mwpms_from_arguments(argc, argv, num_threads);
+    auto &mwpm = mwpms[0];
+    size_t num_obs = mwpm.flooder.graph.num_observables;
     std::unique_ptr<stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>> obs_reader;
     if (obs_in != stdin) {
         obs_reader = stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(obs_in, obs_in_format.id, 0, 0, num_obs);
     }
-    auto reader =
-        stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(shots_in, shots_in_format.id, 0, dem.count_detectors(), append_obs * num_obs);
+    ShotInput shots_in(argc, argv, shots_in_format.id, mwpm.flooder.graph.num_nodes, append_obs * num_obs);
 
-    pm::weight_int num_buckets = pm::NUM_DISTINCT_WEIGHTS;
-    auto mwpm = pm::detector_error_model_to_mwpm(dem, num_buckets);
-
-    stim::SparseShot sparse_shot;
     stim::SparseShot obs_shot;
     size_t num_mistakes = 0;
     size_t num_shots = 0;
+    // Returns the actual observables of the shot `sparse_shot', which was the next shot read.
+    auto read_actual_obs_mask = [&](const stim::SparseShot &sparse_shot) {
+        if (obs_reader == nullptr)
+            return sparse_shot.obs_mask_as_u64();
+        obs_shot.clear();
+        if (!obs_reader->start_and_read_entire_record(obs_shot)) {
+            throw std::invalid_argument("Obs data ended before shot data ended.");
+        }
+        return obs_shot.obs_mask_as_u64();
+    };
+
+    // The latency of each shot is only measured if it is reported, since reading the clock takes time too.
+    bool record_latencies = num_threads == 1 && (time || latency_histogram_path != nullptr || trace_path != nullptr);
+    pm::DecodeLatencyHistograms latencies;
+    // With `--trace_out', the events of every shot are recorded, and the trace of a shot is kept if its latency is
+    // above the `trace_quantile' quantile of the latencies so far. The quantile is recomputed every
+    // TRACE_THRESHOLD_INTERVAL shots, and no shots are kept until it has first been computed.
+    constexpr size_t TRACE_THRESHOLD_INTERVAL = 1024;
+    std::ofstream trace_out;
+    uint64_t trace_threshold_ns = UINT64_MAX;
+    size_t num_traced_shots = 0;
+    if (trace_path != nullptr) {
+        trace_out.open(trace_path, std::ios::binary);
+        if (!trace_out)
+            throw std::invalid_argument("Failed to open '" + std::string(trace_path) + "' for writing.");
+        pm::write_trace_file_header(trace_out);
+        mwpm.flooder.trace.set_capacity(trace_capacity);
+    }
     auto start = std::chrono::steady_clock::now();
-    while (reader->start_and_read_entire_record(sparse_shot)) {
-        if (obs_reader == nullptr) {
-            obs_shot.obs_mask = sparse_shot.obs_mask;
-        } else {
-            if (!obs_reader->start_and_read_entire_record(obs_shot)) {
-                throw std::invalid_argument("Obs data ended before shot data ended.");
+    if (num_threads == 1) {
+        stim::SparseShot sparse_shot;
+        while (!stopping_rule.is_satisfied(num_shots, num_mistakes)) {
+            std::chrono::steady_clock::time_point shot_start;
+            if (record_latencies)
+                shot_start = std::chrono::steady_clock::now();
+            sparse_shot.clear();
+            if (!shots_in.read_shot(sparse_shot))
+                break;
+            pm::DecodePhaseTimes phase_times;
+            if (record_latencies) {
+                phase_times.syndrome_extraction_ns = pm::nanoseconds_since(shot_start);
             }
+            if (trace_path != nullptr)
+                mwpm.flooder.trace.begin_shot();
+            auto res = pm::decode_detection_events_for_up_to_64_observables(
+                mwpm, sparse_shot.hits, record_latencies ? &phase_times : nullptr);
+            if (record_latencies) {
+                uint64_t latency_ns = pm::nanoseconds_since(shot_start);
+                latencies.record(latency_ns, phase_times);
+                if (trace_path != nullptr) {
+                    if (latency_ns > trace_threshold_ns) {
+                        mwpm.flooder.trace.write_shot(trace_out, num_shots, latency_ns, sparse_shot.hits.size());
+                        num_traced_shots++;
+                    }
+                    if ((num_shots + 1) % TRACE_THRESHOLD_INTERVAL == 0)
+                        trace_threshold_ns = latencies.total.value_at_quantile(trace_quantile);
+                }
+            }
+            if (read_actual_obs_mask(sparse_shot) != res.obs_mask) {
+                num_mistakes++;
+            }
+            num_shots++;
         }
-        auto res = pm::decode_detection_events_for_up_to_64_observables(mwpm, sparse_shot.hits);
-        if (obs_shot.obs_mask_as_u64() != res.obs_mask) {
-            num_mistakes++;
-        }
-        sparse_shot.clear();
-        obs_shot.clear();
-        num_shots++;
+    } else {
+        // The results are handled one at a time in the order the shots were read, so the shots counted, and where
+        // counting stops, are exactly the same as with a single thread. Once the stopping rule is satisfied, no more
+        // shots are read, and the results of those already read are ignored.
+        std::atomic<bool> stopped(stopping_rule.is_satisfied(0, 0));
+        pm::decode_shots_pipelined(
+            [&](stim::SparseShot &shot) {
+                return !stopped.load(std::memory_order_relaxed) && shots_in.read_shot(shot);
+            },
+            mwpms,
+            num_obs,
+            [&](const stim::SparseShot &shot, const pm::ExtendedMatchingResult &res) {
+                if (stopped.load(std::memory_order_relaxed))
+                    return;
+                uint64_t predicted_obs_mask = 0;
+                for (size_t k = 0; k < num_obs && k < 64; k++)
+                    predicted_obs_mask ^= (uint64_t)(res.obs_crossed[k] & 1) << k;
+                if (read_actual_obs_mask(shot) != predicted_obs_mask) {
+                    num_mistakes++;
+                }
+                num_shots++;
+                if (stopping_rule.is_satisfied(num_shots, num_mistakes))
+                    stopped = true;
+            },
+            1024);
     }
     fprintf(stats_out, "%zu / %zu\n", num_mistakes, num_shots);
     if (stats_out != stdout) {
         fclose(stats_out);
     }
-    if (shots_in != stdin) {
-        fclose(shots_in);
-    }
 
     auto end = std::chrono::steady_clock::now();
     auto microseconds = (double)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
     if (time) {
         std::cerr << "Total decoding time: " << (int)microseconds << "us\n";
         std::cerr << "Decoding time per shot: " << (microseconds / num_shots) << "us\n";
+        if (record_latencies)
+            latencies.write_summary(std::cerr);
+        if (num_threads == 1 && mwpm.syndrome_cache.capacity())
+            std::cerr << "Syndrome cache hits: " << mwpm.syndrome_cache.num_hits
+                      << ", misses: " << mwpm.syndrome_cache.num_misses << "\n";
+        if (num_threads == 1 && pm::DECODER_STATS_ENABLED)
+            print_decoder_stats(mwpm.flooder.stats, num_shots);
+        if (trace_path != nullptr)
+            std::cerr << "Traced shots: " << num_traced_shots << "\n";
+    }
+    if (trace_path != nullptr) {
+        trace_out.close();
+        if (!trace_out)
+            throw std::invalid_argument("Failed to write '" + std::string(trace_path) + "'.");
+    }
+    if (latency_histogram_path != nullptr) {
+        std::ofstream latency_out(latency_histogram_path);
+        if (!latency_out)
+            throw std::invalid_argument("Failed to open '" + std::string(latency_histogram_path) + "' for writing.");
+        latencies.write_csv(latency_out);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main_sample_and_count(int argc, const char **argv) {
+    stim::check_for_unknown_arguments(
+        {
+            "--circuit",
+            "--out",
+            "--max_shots",
+            "--max_errors",
+            "--max_relative_error",
+            "--batch_size",
+            "--threads",
+            "--seed",
+            "--time",
+            "--reorder_nodes",
+            "--periodic_topology",
+            "--syndrome_cache_size",
+            "--decoder",
+        },
+        {},
+        "sample_and_count",
+        argc,
+        argv);
+
+    FILE *circuit_file = stim::find_open_file_argument("--circuit", nullptr, "r", argc, argv);
+    stim::Circuit circuit = stim::Circuit::from_file(circuit_file);
+    fclose(circuit_file);
+    pm::StoppingRule stopping_rule = stopping_rule_from_arguments(argc, argv);
+    if (stopping_rule.max_shots == SIZE_MAX)
+        throw std::invalid_argument("Must specify --max_shots.");
+    size_t batch_size = (size_t)stim::find_int64_argument("--batch_size", 256, 1, INT64_C(1) << 20, argc, argv);
+    size_t num_threads = (size_t)stim::find_int64_argument("--threads", 1, 1, 1024, argc, argv);
+    int64_t seed_argument = stim::find_int64_argument("--seed", -1, -1, INT64_MAX, argc, argv);
+    uint64_t seed = (uint64_t)seed_argument;
+    if (seed_argument < 0) {
+        std::random_device rd;
+        seed = ((uint64_t)rd() << 32) ^ (uint64_t)rd();
+    }
+    bool time = stim::find_bool_argument("--time", argc, argv);
+    bool reorder_nodes = stim::find_bool_argument("--reorder_nodes", argc, argv);
+    bool periodic_topology = stim::find_bool_argument("--periodic_topology", argc, argv);
+    size_t syndrome_cache_size =
+        (size_t)stim::find_int64_argument("--syndrome_cache_size", 0, 0, INT64_C(1) << 32, argc, argv);
+    FILE *stats_out = stim::find_open_file_argument("--out", stdout, "wb", argc, argv);
+
+    auto dem = stim::ErrorAnalyzer::circuit_to_detector_error_model(circuit, true, true, false, 0, false, false);
+    auto mwpms = pm::detector_error_model_to_mwpms(
+        dem, pm::NUM_DISTINCT_WEIGHTS, num_threads, reorder_nodes, periodic_topology);
+    pm::DecoderEngine engine = decoder_engine_from_arguments(argc, argv);
+    for (auto &mwpm : mwpms) {
+        mwpm.syndrome_cache.set_capacity(syndrome_cache_size);
+        mwpm.set_decoder_engine(engine);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = pm::sample_and_count_mistakes(circuit, mwpms, stopping_rule, batch_size, seed);
+    auto microseconds = (double)pm::nanoseconds_since(start) / 1000.0;
+    fprintf(stats_out, "%zu / %zu\n", result.num_errors, result.num_shots);
+    if (stats_out != stdout) {
+        fclose(stats_out);
+    }
+    if (time) {
+        std::cerr << "Total sampling and decoding time: " << (int)microseconds << "us\n";
+        std::cerr << "Sampling and decoding time per shot: " << (microseconds / result.num_shots) << "us\n";
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main_sweep_coordinator(int argc, const char **argv) {
+    stim::check_for_unknown_arguments(
+        {
+            "--sweep",
+            "--port",
+            "--bind",
+            "--token",
+            "--out",
+            "--latency_histogram",
+            "--max_shots",
+            "--max_errors",
+            "--max_relative_error",
+            "--shots_per_task",
+            "--batch_size",
+            "--seed",
+        },
+        {},
+        "sweep_coordinator",
+        argc,
+        argv);
+
+    pm::StoppingRule stopping_rule = stopping_rule_from_arguments(argc, argv);
+    if (stopping_rule.max_shots == SIZE_MAX)
+        throw std::invalid_argument("Must specify --max_shots.");
+    const char *port_argument = stim::find_argument("--port", argc, argv);
+    if (port_argument == nullptr)
+        throw std::invalid_argument("Must specify --port.");
+    uint16_t port = (uint16_t)stim::find_int64_argument("--port", 0, 0, 65535, argc, argv);
+    pm::SweepOptions options;
+    options.shots_per_task =
+        (size_t)stim::find_int64_argument("--shots_per_task", 100000, 1, INT64_C(1) << 40, argc, argv);
+    options.batch_size = (size_t)stim::find_int64_argument("--batch_size", 256, 1, INT64_C(1) << 20, argc, argv);
+    int64_t seed_argument = stim::find_int64_argument("--seed", -1, -1, INT64_MAX, argc, argv);
+    options.seed = (uint64_t)seed_argument;
+    if (seed_argument < 0) {
+        std::random_device rd;
+        options.seed = ((uint64_t)rd() << 32) ^ (uint64_t)rd();
     }
+    const char *latency_histogram_path = stim::find_argument("--latency_histogram", argc, argv);
+    options.record_latencies = latency_histogram_path != nullptr;
+    const char *token = stim::find_argument("--token", argc, argv);
+    if (token != nullptr)
+        options.token = token;
+    const char *bind_address = stim::find_argument("--bind", argc, argv);
 
+    // Each line of the sweep file names a point and gives the path of its circuit.
+    const char *sweep_path = stim::find_argument("--sweep", argc, argv);
+    if (sweep_path == nullptr)
+        throw std::invalid_argument("Must specify --sweep.");
+    std::ifstream sweep_in(sweep_path);
+    if (!sweep_in)
+        throw std::invalid_argument("Failed to open '" + std::string(sweep_path) + "'.");
+    std::vector<pm::SweepPoint> points;
+    std::string line;
+    while (std::getline(sweep_in, line)) {
+        std::istringstream fields(line);
+        std::string name, circuit_path;
+        if (!(fields >> name) || name[0] == '#')
+            continue;
+        if (!(fields >> circuit_path))
+            throw std::invalid_argument("Expected a name and a circuit path on the line '" + line + "' of the sweep.");
+        FILE *circuit_file = fopen(circuit_path.c_str(), "r");
+        if (circuit_file == nullptr)
+            throw std::invalid_argument("Failed to open '" + circuit_path + "'.");
+        stim::Circuit circuit = stim::Circuit::from_file(circuit_file);
+        fclose(circuit_file);
+        points.push_back({name, circuit.str(), stopping_rule});
+    }
+
+    pm::SweepCoordinator coordinator(points, options);
+    port = coordinator.listen(port, bind_address == nullptr ? "127.0.0.1" : bind_address);
+    std::cerr << "Listening for sweep workers on port " << port << "\n";
+    auto results = coordinator.run();
+
+    FILE *stats_out = stim::find_open_file_argument("--out", stdout, "wb", argc, argv);
+    fprintf(stats_out, "name,shots,errors\n");
+    for (size_t k = 0; k < points.size(); k++)
+        fprintf(stats_out, "%s,%zu,%zu\n", points[k].name.c_str(), results[k].num_shots, results[k].num_errors);
+    if (stats_out != stdout) {
+        fclose(stats_out);
+    }
+    if (latency_histogram_path != nullptr) {
+        std::ofstream latency_out(latency_histogram_path);
+        if (!latency_out)
+            throw std::invalid_argument("Failed to open '" + std::string(latency_histogram_path) + "' for writing.");
+        // The CSV of each point's histograms, with its name in an extra first column.
+        latency_out << "point,phase,lower_ns,upper_ns,count,cumulative_fraction\n";
+        for (size_t k = 0; k < points.size(); k++) {
+            std::stringstream csv;
+            results[k].latencies.write_csv(csv);
+            std::getline(csv, line);
+            while (std::getline(csv, line))
+                latency_out << points[k].name << "," << line << "\n";
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+int main_sweep_worker(int argc, const char **argv) {
+    stim::check_for_unknown_arguments({"--coordinator", "--threads", "--token"}, {}, "sweep_worker", argc, argv);
+    const char *coordinator = stim::find_argument("--coordinator", argc, argv);
+    if (coordinator == nullptr)
+        throw std::invalid_argument("Must specify --coordinator.");
+    std::string address = coordinator;
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos)
+        throw std::invalid_argument("--coordinator must be given as host:port.");
+    int64_t port = -1;
+    try {
+        port = std::stoll(address.substr(colon + 1));
+    } catch (const std::exception &) {
+    }
+    if (port < 0 || port > 65535)
+        throw std::invalid_argument("--coordinator must be given as host:port.");
+    size_t num_threads = (size_t)stim::find_int64_argument("--threads", 1, 1, 1024, argc, argv);
+    const char *token = stim::find_argument("--token", argc, argv);
+    pm::run_sweep_worker(
+        address.substr(0, colon), (uint16_t)port, num_threads, token == nullptr ? std::string() : std::string(token));
+    return EXIT_SUCCESS;
+}
+
+int main_save_graph(int argc, const char **argv) {
+    stim::check_for_unknown_arguments({"--dem", "--out", "--reorder_nodes"}, {}, "save_graph", argc, argv);
+    const char *out_path = stim::find_argument("--out", argc, argv);
+    if (out_path == nullptr)
+        throw std::invalid_argument("Must specify --out.");
+    FILE *dem_file = stim::find_open_file_argument("--dem", nullptr, "r", argc, argv);
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+    bool reorder_nodes = stim::find_bool_argument("--reorder_nodes", argc, argv);
+    pm::save_graph_file(
+        out_path, pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS, false, reorder_nodes));
+    return EXIT_SUCCESS;
+}
+
+int main_summarize_trace(int argc, const char **argv) {
+    stim::check_for_unknown_arguments({"--in", "--out", "--top_nodes"}, {}, "summarize_trace", argc, argv);
+    const char *in_path = stim::find_argument("--in", argc, argv);
+    if (in_path == nullptr)
+        throw std::invalid_argument("Must specify --in.");
+    size_t num_top_nodes = (size_t)stim::find_int64_argument("--top_nodes", 20, 0, INT64_MAX, argc, argv);
+    std::ifstream trace_in(in_path, std::ios::binary);
+    if (!trace_in)
+        throw std::invalid_argument("Failed to open '" + std::string(in_path) + "' for reading.");
+    auto traces = pm::read_trace_file(trace_in);
+
+    const char *out_path = stim::find_argument("--out", argc, argv);
+    if (out_path == nullptr) {
+        pm::write_trace_summary(std::cout, traces, num_top_nodes);
+        return EXIT_SUCCESS;
+    }
+    std::ofstream out(out_path);
+    if (!out)
+        throw std::invalid_argument("Failed to open '" + std::string(out_path) + "' for writing.");
+    pm::write_trace_summary(out, traces, num_top_nodes);
     return EXIT_SUCCESS;
 }
 
@@ -178,6 +672,21 @@ int pm::main(int argc, const char **argv) {
         if (strcmp(command, "count_mistakes") == 0) {
             return main_count_mistakes(argc, argv);
         }
+        if (strcmp(command, "sample_and_count") == 0) {
+            return main_sample_and_count(argc, argv);
+        }
+        if (strcmp(command, "sweep_coordinator") == 0) {
+            return main_sweep_coordinator(argc, argv);
+        }
+        if (strcmp(command, "sweep_worker") == 0) {
+            return main_sweep_worker(argc, argv);
+        }
+        if (strcmp(command, "save_graph") == 0) {
+            return main_save_graph(argc, argv);
+        }
+        if (strcmp(command, "summarize_trace") == 0) {
+            return main_summarize_trace(argc, argv);
+        }
         if (strcmp(command, "animate") == 0) {
             return pm::main_animation(argc, argv);
         }
@@ -188,10 +697,23 @@ int pm::main(int argc, const char **argv) {
 
     std::stringstream ss;
     ss << "Unrecognized command. Available commands are:\n";
-    ss << "    pymatching predict --dem file [--in file] [--out file] [--in_format 01|b8|...] [--out_format 01|b8|...] "
-          "[--in_includes_appended_observables]\n";
-    ss << "    pymatching count_mistakes --dem file [--in file] [--out file] [--in_format 01|b8|...] [--out_format "
-          "01|B8|...] [--in_includes_appended_observables] [--obs_in] [--obs_in_format]\n";
+    ss << "    pymatching predict --dem file|--graph_in file [--in file] [--out file] [--in_format 01|b8|...] "
+          "[--out_format 01|b8|...] [--in_includes_appended_observables] [--threads #] [--largest_shots_first] "
+          "[--reorder_nodes] [--periodic_topology] [--syndrome_cache_size #] [--decoder sparse_blossom|uf]\n";
+    ss << "    pymatching count_mistakes --dem file|--graph_in file [--in file] [--out file] [--in_format 01|b8|...] "
+          "[--out_format 01|B8|...] [--in_includes_appended_observables] [--obs_in] [--obs_in_format] "
+          "[--time] [--latency_histogram file] [--trace_out file] [--trace_quantile #] [--trace_capacity #] "
+          "[--reorder_nodes] [--periodic_topology] [--syndrome_cache_size #] [--decoder sparse_blossom|uf] "
+          "[--threads #] [--max_shots #] [--max_errors #] [--max_relative_error #]\n";
+    ss << "    pymatching sample_and_count --circuit file --max_shots # [--max_errors #] [--max_relative_error #] "
+          "[--out file] [--batch_size #] [--threads #] [--seed #] [--time] [--reorder_nodes] [--periodic_topology] "
+          "[--syndrome_cache_size #] [--decoder sparse_blossom|uf]\n";
+    ss << "    pymatching sweep_coordinator --sweep file --port # --max_shots # [--max_errors #] "
+          "[--max_relative_error #] [--out file] [--latency_histogram file] [--shots_per_task #] [--batch_size #] "
+          "[--seed #] [--bind address] [--token secret]\n";
+    ss << "    pymatching sweep_worker --coordinator host:port [--threads #] [--token secret]\n";
+    ss << "    pymatching save_graph --dem file --out file [--reorder_nodes]\n";
+    ss << "    pymatching summarize_trace --in file [--out file] [--top_nodes #]\n";
     ss << "    pymatching animate "
           "--dets_in <file> "
           "--dets_in_format 01|b8|... "
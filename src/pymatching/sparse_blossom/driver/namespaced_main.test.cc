@@ -14,6 +14,10 @@
 
 #include "pymatching/sparse_blossom/driver/namespaced_main.h"
 
+#include <fstream>
+#include <map>
+#include <sstream>
+
 #include "gtest/gtest.h"
 
 struct RaiiTempNamedFile {
@@ -96,6 +100,78 @@ shot L1
 )stdout");
 }
 
+TEST(Main, predict_with_threads) {
+    RaiiTempNamedFile dem;
+    FILE *f = fopen(dem.path.c_str(), "w");
+    fprintf(f, "%s", R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1 L1
+        error(0.1) D1 L2
+    )DEM");
+    fclose(f);
+    std::string input;
+    std::string expected;
+    for (size_t k = 0; k < 3000; k++) {
+        input += "shot\nshot D0\nshot D1\nshot D0 D1\n";
+        expected += "shot\nshot L0\nshot L2\nshot L1\n";
+    }
+    for (auto threads : {"1", "2", "7"}) {
+        auto stdout = result_of_running_main(
+            {"predict", "--dem", dem.path, "--in_format", "dets", "--out_format", "dets", "--threads", threads},
+            input);
+        ASSERT_EQ(stdout, expected);
+    }
+}
+
+TEST(Main, predict_b8) {
+    RaiiTempNamedFile dem;
+    FILE *f = fopen(dem.path.c_str(), "w");
+    fprintf(f, "%s", R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1 L1
+        error(0.1) D1 L2
+    )DEM");
+    fclose(f);
+    std::string input = {0, 1, 2, 3};
+    for (auto threads : {"1", "3"}) {
+        auto stdout = result_of_running_main(
+            {"predict", "--dem", dem.path, "--in_format", "b8", "--out_format", "dets", "--threads", threads}, input);
+        ASSERT_EQ(stdout, "shot\nshot L0\nshot L2\nshot L1\n");
+    }
+}
+
+TEST(Main, predict_ptb64) {
+    RaiiTempNamedFile dem;
+    FILE *f = fopen(dem.path.c_str(), "w");
+    fprintf(f, "%s", R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1 L1
+        error(0.1) D1 L2
+    )DEM");
+    fclose(f);
+    // 64 shots cycling through no detection events, D0, D1 and D0 D1, as one word per detector.
+    std::string input(16, '\0');
+    std::string expected(24, '\0');
+    for (size_t k = 0; k < 64; k++) {
+        size_t dets = k % 4;
+        for (size_t d = 0; d < 2; d++) {
+            if ((dets >> d) & 1)
+                input[d * 8 + k / 8] |= (char)(1 << (k % 8));
+        }
+        // D0 predicts L0, D1 predicts L2 and D0 D1 predicts L1.
+        if (dets != 0) {
+            size_t obs = dets == 1 ? 0 : dets == 2 ? 2 : 1;
+            expected[obs * 8 + k / 8] |= (char)(1 << (k % 8));
+        }
+    }
+    for (auto threads : {"1", "3"}) {
+        auto stdout = result_of_running_main(
+            {"predict", "--dem", dem.path, "--in_format", "ptb64", "--out_format", "ptb64", "--threads", threads},
+            input);
+        ASSERT_EQ(stdout, expected);
+    }
+}
+
 TEST(Main, count_mistakes) {
     RaiiTempNamedFile dem;
     FILE *f = fopen(dem.path.c_str(), "w");
@@ -120,3 +196,112 @@ shot D1 L2
 shot D0 D1 L1)stdin");
     ASSERT_EQ(stdout_text, "1 / 4\n");
 }
+
+TEST(Main, count_mistakes_with_threads_and_stopping_rule) {
+    RaiiTempNamedFile dem;
+    FILE *f = fopen(dem.path.c_str(), "w");
+    fprintf(f, "%s", R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1 L1
+        error(0.1) D1 L2
+    )DEM");
+    fclose(f);
+    // Only the first shot of each group of four is mispredicted.
+    std::string input;
+    for (size_t k = 0; k < 3000; k++)
+        input += "shot L0\nshot D0 L0\nshot D1 L2\nshot D0 D1 L1\n";
+    for (auto threads : {"1", "3"}) {
+        std::vector<std::string> args = {
+            "count_mistakes", "--dem", dem.path, "--in_format", "dets", "--in_includes_appended_observables",
+            "--threads", threads};
+        ASSERT_EQ(result_of_running_main(args, input), "3000 / 12000\n");
+
+        auto max_errors_args = args;
+        max_errors_args.insert(max_errors_args.end(), {"--max_errors", "2"});
+        ASSERT_EQ(result_of_running_main(max_errors_args, input), "2 / 5\n");
+
+        auto max_shots_args = args;
+        max_shots_args.insert(max_shots_args.end(), {"--max_shots", "7"});
+        ASSERT_EQ(result_of_running_main(max_shots_args, input), "2 / 7\n");
+
+        // At an error rate of about 1/4, the half-width 1.96 * sqrt(p * (1 - p) / n) first falls below 0.2 * p after
+        // 72 errors.
+        auto relative_error_args = args;
+        relative_error_args.insert(relative_error_args.end(), {"--max_relative_error", "0.2"});
+        ASSERT_EQ(result_of_running_main(relative_error_args, input), "72 / 285\n");
+    }
+}
+
+TEST(Main, count_mistakes_latency_histogram) {
+    RaiiTempNamedFile dem;
+    FILE *f = fopen(dem.path.c_str(), "w");
+    fprintf(f, "%s", R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1 L1
+        error(0.1) D1 L2
+    )DEM");
+    fclose(f);
+    RaiiTempNamedFile histogram;
+    auto stdout_text = result_of_running_main(
+        {
+            "count_mistakes",
+            "--dem",
+            dem.path,
+            "--in_format",
+            "dets",
+            "--in_includes_appended_observables",
+            "--latency_histogram",
+            histogram.path,
+        },
+        "shot L0\nshot D0 L0\nshot D1 L2\nshot D0 D1 L1\n");
+    ASSERT_EQ(stdout_text, "1 / 4\n");
+
+    std::ifstream in(histogram.path);
+    std::string line;
+    std::getline(in, line);
+    ASSERT_EQ(line, "phase,lower_ns,upper_ns,count,cumulative_fraction");
+    std::map<std::string, size_t> counts;
+    while (std::getline(in, line)) {
+        std::string phase = line.substr(0, line.find(','));
+        std::stringstream fields(line.substr(phase.size() + 1));
+        std::string lower, upper, count;
+        std::getline(fields, lower, ',');
+        std::getline(fields, upper, ',');
+        std::getline(fields, count, ',');
+        counts[phase] += std::stoul(count);
+    }
+    ASSERT_EQ(
+        counts,
+        (std::map<std::string, size_t>{
+            {"total", 4}, {"syndrome_extraction", 4}, {"flooding", 4}, {"result_extraction", 4}}));
+}
+
+TEST(Main, predict_with_graph_in) {
+    RaiiTempNamedFile dem;
+    FILE *f = fopen(dem.path.c_str(), "w");
+    fprintf(f, "%s", R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1 L1
+        error(0.1) D1 L2
+    )DEM");
+    fclose(f);
+    RaiiTempNamedFile graph;
+    std::vector<const char *> argv{
+        "TEST_PROCESS", "save_graph", "--dem", dem.path.c_str(), "--out", graph.path.c_str()};
+    ASSERT_EQ(pm::main((int)argv.size(), argv.data()), EXIT_SUCCESS);
+    for (auto threads : {"1", "3"}) {
+        auto stdout = result_of_running_main(
+            {"predict", "--graph_in", graph.path, "--in_format", "dets", "--out_format", "dets", "--threads", threads},
+            "shot\nshot D0\nshot D1\nshot D0 D1\n");
+        ASSERT_EQ(stdout, "shot\nshot L0\nshot L2\nshot L1\n");
+    }
+    auto stdout_text = result_of_running_main(
+        {"count_mistakes", "--graph_in", graph.path, "--in_format", "dets", "--in_includes_appended_observables"},
+        "shot L0\nshot D0 L0\nshot D1 L2\nshot D0 D1 L1\n");
+    ASSERT_EQ(stdout_text, "1 / 4\n");
+    ASSERT_THROW(
+        result_of_running_main(
+            {"predict", "--dem", dem.path, "--graph_in", graph.path, "--in_format", "dets", "--out_format", "dets"},
+            "shot\n"),
+        std::invalid_argument);
+}
@@ -0,0 +1,148 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/node_ordering.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+/// Breadth first search over the nodes of a graph that have not yet been `placed'.
+class LevelStructure {
+   public:
+    LevelStructure(const std::vector<size_t>& offsets, const std::vector<size_t>& neighbors)
+        : offsets(offsets), neighbors(neighbors), depth(offsets.size() - 1, SIZE_MAX) {
+    }
+
+    /// Searches from `root', after which `visited' holds the reached nodes in the order they were reached, and
+    /// `depth[i]' is the distance of each of them from `root'. Returns the depth of the last level.
+    size_t search(size_t root, const std::vector<uint8_t>& placed) {
+        clear();
+        depth[root] = 0;
+        visited.push_back(root);
+        for (size_t head = 0; head < visited.size(); head++) {
+            size_t u = visited[head];
+            for (size_t k = offsets[u]; k < offsets[u + 1]; k++) {
+                size_t v = neighbors[k];
+                if (!placed[v] && depth[v] == SIZE_MAX) {
+                    depth[v] = depth[u] + 1;
+                    visited.push_back(v);
+                }
+            }
+        }
+        return depth[visited.back()];
+    }
+
+    void clear() {
+        for (auto i : visited)
+            depth[i] = SIZE_MAX;
+        visited.clear();
+    }
+
+    size_t degree(size_t i) const {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    /// Finds a pseudo-peripheral node of the component containing `start', i.e. one whose furthest node is
+    /// (approximately) as far away as possible, using the algorithm of Gibbs, Poole and Stockmeyer as modified by
+    /// George and Liu.
+    size_t find_pseudo_peripheral_node(size_t start, const std::vector<uint8_t>& placed) {
+        size_t root = start;
+        size_t eccentricity = search(root, placed);
+        while (true) {
+            size_t candidate = visited.back();
+            for (size_t k = visited.size(); k-- > 0 && depth[visited[k]] == eccentricity;) {
+                if (degree(visited[k]) < degree(candidate))
+                    candidate = visited[k];
+            }
+            size_t candidate_eccentricity = search(candidate, placed);
+            if (candidate_eccentricity <= eccentricity)
+                break;
+            root = candidate;
+            eccentricity = candidate_eccentricity;
+        }
+        clear();
+        return root;
+    }
+
+   private:
+    const std::vector<size_t>& offsets;
+    const std::vector<size_t>& neighbors;
+    std::vector<size_t> depth;
+    std::vector<size_t> visited;
+};
+
+}  // namespace
+
+std::vector<size_t> pm::reverse_cuthill_mckee_order(
+    const std::vector<size_t>& offsets, const std::vector<size_t>& neighbors) {
+    if (offsets.empty() || offsets.back() != neighbors.size())
+        throw std::invalid_argument("The offsets of the graph are inconsistent with its neighbors.");
+    size_t num_nodes = offsets.size() - 1;
+    for (auto v : neighbors) {
+        if (v >= num_nodes)
+            throw std::invalid_argument(
+                "Node " + std::to_string(v) + " exceeds number of nodes in graph (" + std::to_string(num_nodes) +
+                ")");
+    }
+
+    LevelStructure levels(offsets, neighbors);
+    std::vector<size_t> order;
+    order.reserve(num_nodes);
+    std::vector<uint8_t> placed(num_nodes, 0);
+    std::vector<size_t> children;
+    for (size_t start = 0; start < num_nodes; start++) {
+        if (placed[start])
+            continue;
+        size_t root = levels.find_pseudo_peripheral_node(start, placed);
+        placed[root] = 1;
+        order.push_back(root);
+        for (size_t head = order.size() - 1; head < order.size(); head++) {
+            size_t u = order[head];
+            children.clear();
+            for (size_t k = offsets[u]; k < offsets[u + 1]; k++) {
+                size_t v = neighbors[k];
+                if (!placed[v]) {
+                    placed[v] = 1;
+                    children.push_back(v);
+                }
+            }
+            std::stable_sort(children.begin(), children.end(), [&](size_t a, size_t b) {
+                return levels.degree(a) < levels.degree(b);
+            });
+            order.insert(order.end(), children.begin(), children.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+size_t pm::ordering_bandwidth(
+    const std::vector<size_t>& offsets, const std::vector<size_t>& neighbors, const std::vector<size_t>& order) {
+    std::vector<size_t> position(order.size());
+    for (size_t k = 0; k < order.size(); k++)
+        position[order[k]] = k;
+    size_t bandwidth = 0;
+    for (size_t u = 0; u + 1 < offsets.size(); u++) {
+        for (size_t k = offsets[u]; k < offsets[u + 1]; k++) {
+            size_t v = neighbors[k];
+            size_t distance = position[u] > position[v] ? position[u] - position[v] : position[v] - position[u];
+            bandwidth = std::max(bandwidth, distance);
+        }
+    }
+    return bandwidth;
+}
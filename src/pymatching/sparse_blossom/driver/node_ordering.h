@@ -0,0 +1,42 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_NODE_ORDERING_H
+#define PYMATCHING2_NODE_ORDERING_H
+
+#include <cstddef>
+#include <vector>
+
+namespace pm {
+
+/// Computes a reverse Cuthill-McKee ordering of the nodes of an undirected graph, given in compressed sparse row
+/// form: the neighbors of node i are `neighbors[offsets[i]:offsets[i + 1]]', and each edge must appear in the
+/// neighbors of both of its nodes. Returns `order', where `order[k]' is the node placed at position k.
+///
+/// Each connected component is numbered by a breadth first search from a pseudo-peripheral node, visiting the
+/// neighbors of each node in order of increasing degree, and the whole numbering is then reversed. This keeps the
+/// neighbors of each node within a narrow band of positions, so that the flooder, which repeatedly scans the
+/// neighbors of the nodes it is growing regions over, mostly touches nodes that are already in cache. Detector
+/// indices in a detector error model usually jump between time steps and distant parts of the lattice instead.
+std::vector<size_t> reverse_cuthill_mckee_order(
+    const std::vector<size_t> &offsets, const std::vector<size_t> &neighbors);
+
+/// The bandwidth of a graph under the node ordering `order' (as returned by `reverse_cuthill_mckee_order'): the
+/// largest distance between the positions of the two nodes of any edge.
+size_t ordering_bandwidth(
+    const std::vector<size_t> &offsets, const std::vector<size_t> &neighbors, const std::vector<size_t> &order);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_NODE_ORDERING_H
@@ -0,0 +1,133 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/node_ordering.h"
+
+#include <algorithm>
+#include <random>
+
+#include "gtest/gtest.h"
+#include "pymatching/sparse_blossom/driver/io.h"
+
+namespace {
+
+/// Builds the CSR adjacency of an undirected graph from a list of edges.
+void edges_to_csr(
+    size_t num_nodes,
+    const std::vector<std::pair<size_t, size_t>>& edges,
+    std::vector<size_t>& offsets,
+    std::vector<size_t>& neighbors) {
+    std::vector<std::vector<size_t>> adjacency(num_nodes);
+    for (auto& e : edges) {
+        adjacency[e.first].push_back(e.second);
+        adjacency[e.second].push_back(e.first);
+    }
+    offsets.assign(1, 0);
+    neighbors.clear();
+    for (auto& a : adjacency) {
+        neighbors.insert(neighbors.end(), a.begin(), a.end());
+        offsets.push_back(neighbors.size());
+    }
+}
+
+}  // namespace
+
+TEST(NodeOrdering, ReverseCuthillMcKeeOfPath) {
+    // A path 0 - 4 - 2 - 1 - 3, whose nodes are numbered out of order.
+    std::vector<size_t> offsets, neighbors;
+    edges_to_csr(5, {{0, 4}, {4, 2}, {2, 1}, {1, 3}}, offsets, neighbors);
+    ASSERT_EQ(pm::ordering_bandwidth(offsets, neighbors, {0, 1, 2, 3, 4}), 4);
+    auto order = pm::reverse_cuthill_mckee_order(offsets, neighbors);
+    ASSERT_EQ(order, std::vector<size_t>({3, 1, 2, 4, 0}));
+    ASSERT_EQ(pm::ordering_bandwidth(offsets, neighbors, order), 1);
+}
+
+TEST(NodeOrdering, ReverseCuthillMcKeeOfShuffledGrid) {
+    // A 20x20 grid with randomly permuted node indices, in several components along with some isolated nodes.
+    size_t width = 20;
+    size_t num_nodes = 2 * width * width + 3;
+    std::vector<size_t> label(num_nodes);
+    for (size_t i = 0; i < num_nodes; i++)
+        label[i] = i;
+    std::mt19937 rng(0);
+    std::shuffle(label.begin(), label.end(), rng);
+    std::vector<std::pair<size_t, size_t>> edges;
+    for (size_t c = 0; c < 2; c++) {
+        size_t first = c * width * width;
+        for (size_t r = 0; r < width; r++) {
+            for (size_t k = 0; k < width; k++) {
+                size_t i = first + r * width + k;
+                if (k + 1 < width)
+                    edges.emplace_back(label[i], label[i + 1]);
+                if (r + 1 < width)
+                    edges.emplace_back(label[i], label[i + width]);
+            }
+        }
+    }
+    std::vector<size_t> offsets, neighbors;
+    edges_to_csr(num_nodes, edges, offsets, neighbors);
+    auto order = pm::reverse_cuthill_mckee_order(offsets, neighbors);
+
+    auto sorted = order;
+    std::sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < num_nodes; i++)
+        ASSERT_EQ(sorted[i], i);
+    ASSERT_LE(pm::ordering_bandwidth(offsets, neighbors, order), 2 * width);
+    std::vector<size_t> identity(sorted);
+    ASSERT_GT(pm::ordering_bandwidth(offsets, neighbors, identity), 10 * width);
+}
+
+TEST(NodeOrdering, ReverseCuthillMcKeeRejectsInvalidGraph) {
+    ASSERT_THROW(pm::reverse_cuthill_mckee_order({}, {}), std::invalid_argument);
+    ASSERT_THROW(pm::reverse_cuthill_mckee_order({0, 1, 2}, {1}), std::invalid_argument);
+    ASSERT_THROW(pm::reverse_cuthill_mckee_order({0, 1, 2}, {1, 2}), std::invalid_argument);
+    ASSERT_EQ(pm::reverse_cuthill_mckee_order({0}, {}), std::vector<size_t>());
+}
+
+TEST(NodeOrdering, DemEdgeListReorderNodes) {
+    stim::DetectorErrorModel dem(R"DEM(
+        error(0.1) D0 D3 L0
+        error(0.2) D3 D1
+        error(0.1) D1 D4
+        error(0.3) D4 D2
+        error(0.1) D2
+        error(0.15) D0
+    )DEM");
+    auto edge_list = pm::detector_error_model_to_edge_list(dem);
+    edge_list.reorder_nodes();
+    ASSERT_NE(edge_list.node_relabeling, nullptr);
+    auto& relabeling = *edge_list.node_relabeling;
+    // The path 0 - 3 - 1 - 4 - 2 is laid out contiguously.
+    for (auto& e : edge_list.edges) {
+        ASSERT_TRUE(e.v == SIZE_MAX || (e.u < e.v && e.v - e.u == 1));
+        if (e.v != SIZE_MAX && relabeling.original_index[e.u] + relabeling.original_index[e.v] == 3) {
+            ASSERT_EQ(edge_list.observables[e.observables_begin], 0);
+        }
+    }
+    for (size_t k = 1; k < edge_list.edges.size(); k++) {
+        auto& a = edge_list.edges[k - 1];
+        auto& b = edge_list.edges[k];
+        ASSERT_TRUE(a.u < b.u || (a.u == b.u && a.v < b.v));
+    }
+    for (size_t i = 0; i < 5; i++)
+        ASSERT_EQ(relabeling.graph_index[relabeling.original_index[i]], i);
+
+    auto graph = edge_list.to_matching_graph(pm::NUM_DISTINCT_WEIGHTS);
+    ASSERT_EQ(graph.node_relabeling, edge_list.node_relabeling);
+    ASSERT_EQ(graph.clone_sharing_topology().node_relabeling, edge_list.node_relabeling);
+    std::vector<uint64_t> events{0, 4, 7};
+    auto mapped = graph.to_graph_node_indices(events);
+    ASSERT_EQ(std::vector<uint64_t>(mapped.begin(), mapped.end()), std::vector<uint64_t>({relabeling.graph_index[0], relabeling.graph_index[4], 7}));
+    ASSERT_EQ(graph.original_node_index(relabeling.graph_index[4]), 4);
+}
@@ -0,0 +1,131 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/numa_nodes.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+/// Parses the decimal number in text[begin, end), throwing std::invalid_argument if it isn't one.
+size_t parse_cpu(const std::string& text, size_t begin, size_t end) {
+    if (begin == end || end - begin > 9)
+        throw std::invalid_argument("'" + text + "' is not a CPU list.");
+    size_t result = 0;
+    for (size_t k = begin; k < end; k++) {
+        if (text[k] < '0' || text[k] > '9')
+            throw std::invalid_argument("'" + text + "' is not a CPU list.");
+        result = result * 10 + (size_t)(text[k] - '0');
+    }
+    return result;
+}
+
+#ifdef __linux__
+/// Reads the first line of `path', returning false if it can't be read.
+bool read_first_line(const std::string& path, std::string& line) {
+    std::ifstream in(path);
+    return (bool)std::getline(in, line);
+}
+
+bool pin_pthread_to_cpus(pthread_t thread, const std::vector<size_t>& cpus) {
+    if (cpus.empty())
+        return false;
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (auto cpu : cpus) {
+        if (cpu >= CPU_SETSIZE)
+            return false;
+        CPU_SET(cpu, &cpu_set);
+    }
+    return pthread_setaffinity_np(thread, sizeof(cpu_set_t), &cpu_set) == 0;
+}
+#endif
+
+}  // namespace
+
+std::vector<size_t> pm::parse_cpu_list(const std::string& text) {
+    std::vector<size_t> cpus;
+    // Trailing whitespace, such as the newline at the end of a sysfs file, is ignored.
+    size_t end = text.find_last_not_of(" \t\n");
+    end = end == std::string::npos ? 0 : end + 1;
+    size_t begin = 0;
+    while (begin < end) {
+        size_t comma = std::min(text.find(',', begin), end);
+        size_t dash = text.find('-', begin);
+        if (dash < comma) {
+            size_t first = parse_cpu(text, begin, dash);
+            size_t last = parse_cpu(text, dash + 1, comma);
+            if (last < first)
+                throw std::invalid_argument("'" + text + "' is not a CPU list.");
+            for (size_t cpu = first; cpu <= last; cpu++)
+                cpus.push_back(cpu);
+        } else {
+            cpus.push_back(parse_cpu(text, begin, comma));
+        }
+        begin = comma + 1;
+        if (begin == end)
+            throw std::invalid_argument("'" + text + "' is not a CPU list.");
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+std::vector<std::vector<size_t>> pm::numa_node_cpus() {
+    std::vector<std::vector<size_t>> result;
+#ifdef __linux__
+    const std::string node_dir = "/sys/devices/system/node/";
+    std::string line;
+    if (!read_first_line(node_dir + "online", line))
+        return result;
+    try {
+        for (auto node : parse_cpu_list(line)) {
+            if (!read_first_line(node_dir + "node" + std::to_string(node) + "/cpulist", line))
+                return {};
+            auto cpus = parse_cpu_list(line);
+            if (!cpus.empty())
+                result.push_back(std::move(cpus));
+        }
+    } catch (const std::invalid_argument&) {
+        return {};
+    }
+#endif
+    return result;
+}
+
+bool pm::pin_thread_to_cpus(std::thread& thread, const std::vector<size_t>& cpus) {
+#ifdef __linux__
+    return pin_pthread_to_cpus(thread.native_handle(), cpus);
+#else
+    (void)thread;
+    (void)cpus;
+    return false;
+#endif
+}
+
+bool pm::pin_current_thread_to_cpus(const std::vector<size_t>& cpus) {
+#ifdef __linux__
+    return pin_pthread_to_cpus(pthread_self(), cpus);
+#else
+    (void)cpus;
+    return false;
+#endif
+}
@@ -0,0 +1,40 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_NUMA_NODES_H
+#define PYMATCHING2_NUMA_NODES_H
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace pm {
+
+/// Parses a Linux CPU list, such as "0-3,8,10-11" (the format of /sys/devices/system/node/node0/cpulist), into the
+/// CPUs it lists in increasing order. Throws std::invalid_argument if `text' is not a CPU list.
+std::vector<size_t> parse_cpu_list(const std::string& text);
+
+/// The CPUs of each NUMA node of the machine with at least one CPU, read from /sys/devices/system/node. Empty if the
+/// NUMA nodes can't be determined, which is always the case on platforms other than Linux.
+std::vector<std::vector<size_t>> numa_node_cpus();
+
+/// Restricts `thread' to run on the CPUs `cpus', returning false if it couldn't be. Pinning is only supported on Linux,
+/// and always fails elsewhere.
+bool pin_thread_to_cpus(std::thread& thread, const std::vector<size_t>& cpus);
+/// Restricts the calling thread to run on the CPUs `cpus', like `pin_thread_to_cpus'.
+bool pin_current_thread_to_cpus(const std::vector<size_t>& cpus);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_NUMA_NODES_H
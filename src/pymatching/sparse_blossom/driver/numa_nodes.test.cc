@@ -0,0 +1,53 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/numa_nodes.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+TEST(NumaNodes, ParseCpuList) {
+    ASSERT_EQ(pm::parse_cpu_list("0-3,8,10-11\n"), std::vector<size_t>({0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_EQ(pm::parse_cpu_list("5"), std::vector<size_t>({5}));
+    ASSERT_EQ(pm::parse_cpu_list("4,2-3,3"), std::vector<size_t>({2, 3, 4}));
+    ASSERT_EQ(pm::parse_cpu_list("\n"), std::vector<size_t>());
+    ASSERT_EQ(pm::parse_cpu_list(""), std::vector<size_t>());
+    for (auto bad : {"a", "1,", ",1", "1,,2", "3-1", "1-", "-1", "1 2"})
+        ASSERT_THROW(pm::parse_cpu_list(bad), std::invalid_argument) << bad;
+}
+
+TEST(NumaNodes, NodesHaveDistinctCpus) {
+    auto nodes = pm::numa_node_cpus();
+    std::vector<size_t> all_cpus;
+    for (auto& cpus : nodes) {
+        ASSERT_FALSE(cpus.empty());
+        all_cpus.insert(all_cpus.end(), cpus.begin(), cpus.end());
+    }
+    std::sort(all_cpus.begin(), all_cpus.end());
+    ASSERT_EQ(std::adjacent_find(all_cpus.begin(), all_cpus.end()), all_cpus.end());
+}
+
+TEST(NumaNodes, PinCurrentThread) {
+    ASSERT_FALSE(pm::pin_current_thread_to_cpus({}));
+#ifdef __linux__
+    auto nodes = pm::numa_node_cpus();
+    if (!nodes.empty()) {
+        std::thread thread([&]() {
+            ASSERT_TRUE(pm::pin_current_thread_to_cpus(nodes[0]));
+        });
+        thread.join();
+    }
+#endif
+}
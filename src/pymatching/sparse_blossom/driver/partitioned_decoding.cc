@@ -0,0 +1,294 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pymatching/sparse_blossom/driver/partitioned_decoding.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "pymatching/sparse_blossom/driver/io.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+
+pm::SpatiallyPartitionedDecoder::SpatiallyPartitionedDecoder(
+    const stim::DetectorErrorModel& detector_error_model,
+    size_t num_blocks,
+    double buffer_width,
+    size_t coordinate_index,
+    size_t num_threads)
+    : _num_detectors(detector_error_model.count_detectors()),
+      _num_observables(detector_error_model.count_observables()),
+      full_graph(detector_error_model_to_user_graph(detector_error_model)),
+      blocks(num_blocks),
+      syndrome(_num_detectors, 0),
+      generation(0),
+      num_workers_done(0),
+      stopping(false) {
+    if (num_blocks == 0)
+        throw std::invalid_argument("The number of blocks must be at least 1.");
+    if (num_threads == 0)
+        throw std::invalid_argument("The number of threads must be at least 1.");
+    if (buffer_width < 0)
+        throw std::invalid_argument("The buffer width must not be negative.");
+
+    std::set<uint64_t> all_detectors;
+    for (size_t d = 0; d < _num_detectors; d++)
+        all_detectors.insert(all_detectors.end(), d);
+    auto coordinates = detector_error_model.get_detector_coordinates(all_detectors);
+    std::vector<double> positions(_num_detectors);
+    for (size_t d = 0; d < _num_detectors; d++) {
+        if (coordinates[d].size() <= coordinate_index) {
+            throw std::invalid_argument(
+                "Detector D" + std::to_string(d) + " does not have a coordinate with index " +
+                std::to_string(coordinate_index) + ".");
+        }
+        positions[d] = coordinates[d][coordinate_index];
+    }
+
+    // Split the detectors, sorted by position, into cores with equal numbers of detectors, and add the buffers.
+    std::vector<size_t> order(_num_detectors);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return positions[a] < positions[b];
+    });
+    std::vector<size_t> core_block(_num_detectors);
+    std::vector<std::vector<std::pair<size_t, size_t>>> blocks_of_detector(_num_detectors);
+    for (size_t b = 0; b < num_blocks; b++) {
+        size_t core_begin = b * _num_detectors / num_blocks;
+        size_t core_end = (b + 1) * _num_detectors / num_blocks;
+        for (size_t k = core_begin; k < core_end; k++)
+            core_block[order[k]] = b;
+        if (core_begin == core_end)
+            continue;
+        double min_position = positions[order[core_begin]] - buffer_width;
+        double max_position = positions[order[core_end - 1]] + buffer_width;
+        auto first = std::lower_bound(order.begin(), order.end(), min_position, [&](size_t d, double x) {
+            return positions[d] < x;
+        });
+        auto last = std::upper_bound(order.begin(), order.end(), max_position, [&](double x, size_t d) {
+            return x < positions[d];
+        });
+        auto& block = blocks[b];
+        block.global_detectors.assign(first, last);
+        std::sort(block.global_detectors.begin(), block.global_detectors.end());
+        for (size_t i = 0; i < block.global_detectors.size(); i++)
+            blocks_of_detector[block.global_detectors[i]].push_back({b, i});
+    }
+    detector_block_offsets.push_back(0);
+    for (auto& v : blocks_of_detector) {
+        detector_blocks.insert(detector_blocks.end(), v.begin(), v.end());
+        detector_block_offsets.push_back(detector_blocks.size());
+    }
+
+    for (size_t b = 0; b < num_blocks; b++) {
+        auto& block = blocks[b];
+        size_t n = block.global_detectors.size();
+        block.graph = UserGraph(n + 1, _num_observables);
+        block.graph.set_boundary({n});
+        block.is_core.resize(n);
+        for (size_t i = 0; i < n; i++)
+            block.is_core[i] = core_block[block.global_detectors[i]] == b;
+        block.has_cut_edge.assign(n, 0);
+        block.obs_crossed.assign(_num_observables, 0);
+    }
+    std::vector<size_t> local_detectors;
+    std::vector<size_t> error_blocks;
+    pm::iter_detector_error_model_edges(
+        detector_error_model, [&](double p, const std::vector<size_t>& detectors, std::vector<size_t>& observables) {
+            if (detectors.empty() || detectors.size() > 2)
+                return;
+            error_blocks.clear();
+            for (auto d : detectors) {
+                for (size_t k = detector_block_offsets[d]; k < detector_block_offsets[d + 1]; k++)
+                    error_blocks.push_back(detector_blocks[k].first);
+            }
+            std::sort(error_blocks.begin(), error_blocks.end());
+            error_blocks.erase(std::unique(error_blocks.begin(), error_blocks.end()), error_blocks.end());
+            for (auto b : error_blocks) {
+                auto& block = blocks[b];
+                size_t cut_node = block.global_detectors.size();
+                local_detectors.clear();
+                for (auto d : detectors) {
+                    auto it = std::lower_bound(block.global_detectors.begin(), block.global_detectors.end(), d);
+                    bool in_block = it != block.global_detectors.end() && *it == d;
+                    local_detectors.push_back(in_block ? it - block.global_detectors.begin() : cut_node);
+                }
+                for (size_t i = 0; i < local_detectors.size(); i++) {
+                    if (local_detectors[i] == cut_node)
+                        block.has_cut_edge[local_detectors[1 - i]] = 1;
+                }
+                block.graph.handle_dem_instruction(p, local_detectors, observables);
+            }
+        });
+
+    // Build the Mwpms up front, so that they are not built lazily (and concurrently) while decoding.
+    full_graph.get_mwpm();
+    for (auto& block : blocks)
+        block.graph.get_mwpm_with_search_graph();
+
+    size_t num_workers = std::min(num_threads, num_blocks) - 1;
+    for (size_t t = 0; t < num_workers; t++)
+        workers.emplace_back(&SpatiallyPartitionedDecoder::run_worker, this, t + 1);
+}
+
+pm::SpatiallyPartitionedDecoder::~SpatiallyPartitionedDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+size_t pm::SpatiallyPartitionedDecoder::num_blocks() const {
+    return blocks.size();
+}
+
+size_t pm::SpatiallyPartitionedDecoder::num_detectors() const {
+    return _num_detectors;
+}
+
+size_t pm::SpatiallyPartitionedDecoder::num_observables() const {
+    return _num_observables;
+}
+
+size_t pm::SpatiallyPartitionedDecoder::num_fused_detection_events() const {
+    return fused_detection_events.size();
+}
+
+void pm::SpatiallyPartitionedDecoder::decode_block(Block& block) {
+    std::fill(block.obs_crossed.begin(), block.obs_crossed.end(), 0);
+    block.flipped_detectors.clear();
+    block.edges.clear();
+    if (block.detection_events.empty())
+        return;
+    pm::decode_detection_events_to_edges(
+        block.graph.get_mwpm_with_search_graph(), block.detection_events, block.edges);
+    for (size_t i = 0; i < block.edges.size(); i += 2) {
+        size_t u = (size_t)block.edges[i];
+        size_t v = block.edges[i + 1] < 0 ? SIZE_MAX : (size_t)block.edges[i + 1];
+        // A boundary edge of a detector with a cut edge may be a cut edge rather than a real boundary edge.
+        bool commit = v == SIZE_MAX ? block.is_core[u] && !block.has_cut_edge[u] : block.is_core[u] && block.is_core[v];
+        if (!commit)
+            continue;
+        auto& edge = block.graph.edges[block.graph.index_of_edge(u, v)];
+        for (auto obs : edge.observable_indices)
+            block.obs_crossed[obs] ^= 1;
+        block.flipped_detectors.push_back(block.global_detectors[u]);
+        if (v != SIZE_MAX)
+            block.flipped_detectors.push_back(block.global_detectors[v]);
+    }
+}
+
+void pm::SpatiallyPartitionedDecoder::decode_blocks_of_thread(size_t thread_index) {
+    for (size_t b = thread_index; b < blocks.size(); b += workers.size() + 1)
+        decode_block(blocks[b]);
+}
+
+void pm::SpatiallyPartitionedDecoder::run_worker(size_t thread_index) {
+    size_t seen_generation = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            start_cv.wait(lock, [&] {
+                return stopping || generation != seen_generation;
+            });
+            if (stopping)
+                return;
+            seen_generation = generation;
+        }
+        std::exception_ptr error;
+        try {
+            decode_blocks_of_thread(thread_index);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error && !worker_error)
+                worker_error = error;
+            num_workers_done++;
+        }
+        done_cv.notify_one();
+    }
+}
+
+void pm::SpatiallyPartitionedDecoder::decode(const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr) {
+    for (auto& block : blocks)
+        block.detection_events.clear();
+    for (auto d : detection_events) {
+        if (d >= _num_detectors) {
+            throw std::invalid_argument(
+                "Detection event index " + std::to_string(d) + " is too large. The detector error model has " +
+                std::to_string(_num_detectors) + " detectors.");
+        }
+        for (size_t k = detector_block_offsets[d]; k < detector_block_offsets[d + 1]; k++)
+            blocks[detector_blocks[k].first].detection_events.push_back(detector_blocks[k].second);
+    }
+
+    if (!workers.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        num_workers_done = 0;
+        worker_error = nullptr;
+        generation++;
+    }
+    start_cv.notify_all();
+    std::exception_ptr error;
+    try {
+        decode_blocks_of_thread(0);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    if (!workers.empty()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&] {
+            return num_workers_done == workers.size();
+        });
+        if (!error)
+            error = worker_error;
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    // Fusion: decode the detection events left by the committed edges with the whole graph.
+    // The low bit of `syndrome[d]' is the parity of detector d, and the second bit marks it as touched.
+    auto flip = [&](uint64_t d) {
+        if (!(syndrome[d] & 2)) {
+            touched_detectors.push_back(d);
+            syndrome[d] |= 2;
+        }
+        syndrome[d] ^= 1;
+    };
+    for (auto d : detection_events)
+        flip(d);
+    for (auto& block : blocks) {
+        for (auto d : block.flipped_detectors)
+            flip(d);
+        for (size_t i = 0; i < _num_observables; i++)
+            obs_begin_ptr[i] ^= block.obs_crossed[i];
+    }
+    fused_detection_events.clear();
+    for (auto d : touched_detectors) {
+        if (syndrome[d] & 1)
+            fused_detection_events.push_back(d);
+        syndrome[d] = 0;
+    }
+    touched_detectors.clear();
+    std::sort(fused_detection_events.begin(), fused_detection_events.end());
+    if (!fused_detection_events.empty()) {
+        pm::total_weight_int weight = 0;
+        pm::decode_detection_events(full_graph.get_mwpm(), fused_detection_events, obs_begin_ptr, weight);
+    }
+}
@@ -0,0 +1,108 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PYMATCHING2_PARTITIONED_DECODING_H
+#define PYMATCHING2_PARTITIONED_DECODING_H
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+#include "stim.h"
+
+namespace pm {
+
+/// Decodes single shots of a large detector error model by splitting the detectors into spatial blocks, which are
+/// decoded concurrently, followed by a fusion step that resolves the matching across the seams between blocks.
+///
+/// The detectors are sorted by one of their coordinates and split into `num_blocks' slabs with equal numbers of
+/// detectors, the cores of the blocks. Each block also contains the detectors within `buffer_width' (in units of
+/// that coordinate) of its core, and the errors between its detectors. Errors leaving the block are cut to edges to
+/// an extra boundary node, so that detection events near the edge of the block can leave it. Each block is decoded
+/// to edges, and the edges between two core detectors of the block, as well as the boundary edges of core detectors
+/// with no cut edges, are committed: their observables are added to the prediction and their endpoints are flipped.
+/// In the fusion step, the remaining detection events (which are close to the seams, provided the buffers are wide
+/// enough) are decoded with a Mwpm for the whole graph, so the prediction is always consistent with the syndrome.
+/// This trades a little accuracy near the seams for latency, like a spatial version of `SlidingWindowDecoder'.
+class SpatiallyPartitionedDecoder {
+   public:
+    /// The blocks are decoded by `num_threads' threads in total, including the calling thread.
+    SpatiallyPartitionedDecoder(
+        const stim::DetectorErrorModel& detector_error_model,
+        size_t num_blocks,
+        double buffer_width,
+        size_t coordinate_index = 0,
+        size_t num_threads = 1);
+    ~SpatiallyPartitionedDecoder();
+    SpatiallyPartitionedDecoder(const SpatiallyPartitionedDecoder&) = delete;
+    SpatiallyPartitionedDecoder& operator=(const SpatiallyPartitionedDecoder&) = delete;
+
+    size_t num_blocks() const;
+    size_t num_detectors() const;
+    size_t num_observables() const;
+    /// The number of detection events that were left for the fusion step in the most recently decoded shot.
+    size_t num_fused_detection_events() const;
+
+    /// Decodes the detection events `detection_events' of a shot, XOR-ing the predicted observables into the array
+    /// starting at `obs_begin_ptr', which has `num_observables()' elements.
+    void decode(const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr);
+
+   private:
+    struct Block {
+        /// The detectors of the block, followed by the boundary node that errors leaving the block are cut to.
+        UserGraph graph;
+        std::vector<uint64_t> global_detectors;
+        std::vector<uint8_t> is_core;
+        std::vector<uint8_t> has_cut_edge;
+        std::vector<uint64_t> detection_events;
+        std::vector<int64_t> edges;
+        /// The observables and (global) detectors flipped by the committed edges of the current shot.
+        std::vector<uint8_t> obs_crossed;
+        std::vector<uint64_t> flipped_detectors;
+    };
+
+    size_t _num_detectors;
+    size_t _num_observables;
+    UserGraph full_graph;
+    std::vector<Block> blocks;
+    /// `detector_blocks[detector_block_offsets[d]:detector_block_offsets[d + 1]]' are the (block, local detector)
+    /// pairs of detector d.
+    std::vector<size_t> detector_block_offsets;
+    std::vector<std::pair<size_t, size_t>> detector_blocks;
+    std::vector<uint8_t> syndrome;
+    std::vector<uint64_t> touched_detectors;
+    std::vector<uint64_t> fused_detection_events;
+
+    /// Worker threads, each decoding every `num_threads'-th block (the calling thread decodes those from block 0).
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    size_t generation;
+    size_t num_workers_done;
+    bool stopping;
+    std::exception_ptr worker_error;
+
+    void decode_block(Block& block);
+    void decode_blocks_of_thread(size_t thread_index);
+    void run_worker(size_t thread_index);
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_PARTITIONED_DECODING_H
@@ -0,0 +1,104 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pymatching/sparse_blossom/driver/partitioned_decoding.h"
+
+#include <gtest/gtest.h>
+
+#include "pymatching/rand/rand_gen.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+#include "stim.h"
+
+namespace {
+
+std::vector<uint64_t> random_detection_events(size_t num_detectors, double p) {
+    std::vector<uint64_t> detection_events;
+    for (size_t d = 0; d < num_detectors; d++) {
+        if (pm::rand_float(0, 1) < p)
+            detection_events.push_back(d);
+    }
+    return detection_events;
+}
+
+}  // namespace
+
+TEST(SpatiallyPartitionedDecoder, SingleBlockMatchesFullDecoding) {
+    auto dem = pm::repetition_code_memory_dem(11, 5);
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS);
+    pm::SpatiallyPartitionedDecoder decoder(dem, 1, 0);
+    pm::set_seed(0);
+    for (size_t shot = 0; shot < 100; shot++) {
+        auto detection_events = random_detection_events(decoder.num_detectors(), 0.1);
+        std::vector<uint8_t> obs(1, 0);
+        decoder.decode(detection_events, obs.data());
+        ASSERT_EQ(decoder.num_fused_detection_events(), 0);
+        ASSERT_EQ(obs[0], pm::decode_detection_events_for_up_to_64_observables(mwpm, detection_events).obs_mask);
+    }
+}
+
+TEST(SpatiallyPartitionedDecoder, CorrectsIsolatedErrors) {
+    size_t distance = 31;
+    size_t num_rounds = 4;
+    auto dem = pm::repetition_code_memory_dem(distance, num_rounds);
+    pm::SpatiallyPartitionedDecoder decoder(dem, 3, 3);
+    ASSERT_EQ(decoder.num_blocks(), 3);
+
+    std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>> errors;
+    pm::iter_detector_error_model_edges(
+        dem, [&](double, const std::vector<size_t>& detectors, std::vector<size_t>& observables) {
+            errors.push_back({detectors, observables});
+        });
+    for (auto& error : errors) {
+        std::vector<uint64_t> detection_events(error.first.begin(), error.first.end());
+        std::vector<uint8_t> obs(1, 0);
+        decoder.decode(detection_events, obs.data());
+        ASSERT_EQ(obs[0], error.second.size());
+    }
+
+    // An error deep inside the core of a block is resolved without the fusion step, but one on a seam is not.
+    std::vector<uint8_t> obs(1, 0);
+    decoder.decode({3, 4}, obs.data());
+    ASSERT_EQ(decoder.num_fused_detection_events(), 0);
+    size_t seam = (distance - 1) / 3;
+    decoder.decode({seam - 1, seam}, obs.data());
+    ASSERT_EQ(decoder.num_fused_detection_events(), 2);
+    ASSERT_EQ(obs[0], 0);
+}
+
+TEST(SpatiallyPartitionedDecoder, ThreadsMatchSingleThread) {
+    auto dem = pm::repetition_code_memory_dem(41, 6);
+    pm::SpatiallyPartitionedDecoder serial(dem, 4, 2);
+    pm::SpatiallyPartitionedDecoder threaded(dem, 4, 2, 0, 3);
+    pm::set_seed(1);
+    for (size_t shot = 0; shot < 200; shot++) {
+        auto detection_events = random_detection_events(serial.num_detectors(), 0.05);
+        std::vector<uint8_t> obs1(1, 0), obs2(1, 0);
+        serial.decode(detection_events, obs1.data());
+        threaded.decode(detection_events, obs2.data());
+        ASSERT_EQ(obs1, obs2);
+        ASSERT_EQ(serial.num_fused_detection_events(), threaded.num_fused_detection_events());
+    }
+}
+
+TEST(SpatiallyPartitionedDecoder, InvalidArguments) {
+    auto dem = pm::repetition_code_memory_dem(5, 3);
+    ASSERT_THROW(pm::SpatiallyPartitionedDecoder(dem, 0, 1), std::invalid_argument);
+    ASSERT_THROW(pm::SpatiallyPartitionedDecoder(dem, 2, -1), std::invalid_argument);
+    ASSERT_THROW(pm::SpatiallyPartitionedDecoder(dem, 2, 1, 2), std::invalid_argument);
+    pm::SpatiallyPartitionedDecoder decoder(dem, 2, 1, 0, 2);
+    std::vector<uint8_t> obs(1, 0);
+    ASSERT_THROW(decoder.decode({12}, obs.data()), std::invalid_argument);
+}
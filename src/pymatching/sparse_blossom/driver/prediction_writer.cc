@@ -0,0 +1,85 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/prediction_writer.h"
+
+#include <stdexcept>
+
+pm::PredictionWriter::PredictionWriter(FILE* file, stim::SampleFormat format, size_t num_observables)
+    : file(file), format(format), num_observables(num_observables) {
+    if (!supports_format(format))
+        throw std::invalid_argument("Predictions can only be buffered in the 01, b8, r8 and ptb64 formats.");
+    if (format == stim::SampleFormat::SAMPLE_FORMAT_PTB64)
+        ptb64_writer = std::make_unique<Ptb64PredictionWriter>(file, num_observables);
+    else
+        buffer.reserve(FLUSH_THRESHOLD + num_observables + 1);
+}
+
+bool pm::PredictionWriter::supports_format(stim::SampleFormat format) {
+    return format == stim::SampleFormat::SAMPLE_FORMAT_01 || format == stim::SampleFormat::SAMPLE_FORMAT_B8 ||
+           format == stim::SampleFormat::SAMPLE_FORMAT_R8 || format == stim::SampleFormat::SAMPLE_FORMAT_PTB64;
+}
+
+void pm::PredictionWriter::write_shot(const uint8_t* obs_crossed) {
+    switch (format) {
+        case stim::SampleFormat::SAMPLE_FORMAT_PTB64:
+            ptb64_writer->write_shot(obs_crossed);
+            return;
+        case stim::SampleFormat::SAMPLE_FORMAT_01:
+            for (size_t k = 0; k < num_observables; k++)
+                buffer.push_back(obs_crossed[k] ? '1' : '0');
+            buffer.push_back('\n');
+            break;
+        case stim::SampleFormat::SAMPLE_FORMAT_B8:
+            for (size_t k = 0; k < num_observables; k += 8) {
+                uint8_t byte = 0;
+                for (size_t j = k; j < num_observables && j < k + 8; j++)
+                    byte |= (uint8_t)((obs_crossed[j] & 1) << (j - k));
+                buffer.push_back(byte);
+            }
+            break;
+        case stim::SampleFormat::SAMPLE_FORMAT_R8: {
+            // In `r8', each byte is the number of zeros before the next one, with 255 meaning 255 zeros and no one,
+            // and the record is terminated by an implicit one just past its end.
+            size_t run = 0;
+            for (size_t k = 0; k <= num_observables; k++) {
+                if (k < num_observables && !obs_crossed[k]) {
+                    run++;
+                    continue;
+                }
+                for (; run >= 255; run -= 255)
+                    buffer.push_back(255);
+                buffer.push_back((uint8_t)run);
+                run = 0;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+    if (buffer.size() >= FLUSH_THRESHOLD)
+        flush();
+}
+
+void pm::PredictionWriter::flush() {
+    if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+        throw std::invalid_argument("Failed to write predictions.");
+    buffer.clear();
+}
+
+void pm::PredictionWriter::finish() {
+    if (ptb64_writer != nullptr)
+        ptb64_writer->finish();
+    flush();
+}
@@ -0,0 +1,61 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_PREDICTION_WRITER_H
+#define PYMATCHING2_PREDICTION_WRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/transposed_shots.h"
+#include "stim.h"
+
+namespace pm {
+
+/// Writes the predicted observables of each shot to a file in the `01', `b8', `r8' or `ptb64' format.
+///
+/// Rather than passing each bit through a stim::MeasureRecordWriter, the whole record of a shot is encoded at once
+/// into an output buffer, which is written with a single fwrite each time it fills up (and by `finish'). `ptb64'
+/// output is written a block of 64 shots at a time by a Ptb64PredictionWriter.
+class PredictionWriter {
+   public:
+    /// The number of buffered bytes at which the buffer is written to the file.
+    static constexpr size_t FLUSH_THRESHOLD = 1 << 16;
+
+    PredictionWriter(FILE* file, stim::SampleFormat format, size_t num_observables);
+
+    /// Returns true if predictions can be written in the given format by a PredictionWriter.
+    static bool supports_format(stim::SampleFormat format);
+
+    /// Adds the predictions of the next shot, where `obs_crossed[k]' is 1 if observable k was flipped.
+    void write_shot(const uint8_t* obs_crossed);
+    /// Writes out any buffered predictions. Throws std::invalid_argument if the output is `ptb64' and the number of
+    /// shots isn't a multiple of 64.
+    void finish();
+
+   private:
+    void flush();
+
+    FILE* file;
+    stim::SampleFormat format;
+    size_t num_observables;
+    std::vector<uint8_t> buffer;
+    std::unique_ptr<Ptb64PredictionWriter> ptb64_writer;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_PREDICTION_WRITER_H
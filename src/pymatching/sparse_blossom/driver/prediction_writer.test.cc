@@ -0,0 +1,82 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/prediction_writer.h"
+
+#include <gtest/gtest.h>
+
+namespace {
+
+std::string write_predictions(
+    stim::SampleFormat format, size_t num_observables, const std::vector<std::vector<uint8_t>>& shots) {
+    FILE* f = tmpfile();
+    pm::PredictionWriter writer(f, format, num_observables);
+    for (const auto& obs_crossed : shots)
+        writer.write_shot(obs_crossed.data());
+    writer.finish();
+    rewind(f);
+    std::string result;
+    int c;
+    while ((c = getc(f)) != EOF)
+        result.push_back((char)c);
+    fclose(f);
+    return result;
+}
+
+}  // namespace
+
+TEST(PredictionWriter, Formats) {
+    std::vector<std::vector<uint8_t>> shots = {
+        {0, 0, 0, 0, 0, 0, 0, 0, 0, 0}, {1, 0, 0, 0, 0, 0, 0, 0, 0, 1}, {0, 1, 1, 0, 0, 0, 0, 0, 1, 0}};
+    ASSERT_EQ(
+        write_predictions(stim::SampleFormat::SAMPLE_FORMAT_01, 10, shots),
+        "0000000000\n1000000001\n0110000010\n");
+    ASSERT_EQ(
+        write_predictions(stim::SampleFormat::SAMPLE_FORMAT_B8, 10, shots),
+        std::string({'\x00', '\x00', '\x01', '\x02', '\x06', '\x01'}));
+    ASSERT_EQ(
+        write_predictions(stim::SampleFormat::SAMPLE_FORMAT_R8, 10, shots),
+        std::string({'\x0A', '\x00', '\x08', '\x00', '\x01', '\x00', '\x05', '\x01'}));
+
+    // Runs of at least 255 zeros are split, and a record without observables is just its terminator.
+    std::vector<uint8_t> long_run(300, 0);
+    long_run[299] = 1;
+    ASSERT_EQ(
+        write_predictions(stim::SampleFormat::SAMPLE_FORMAT_R8, 300, {long_run}),
+        std::string({'\xFF', '\x2C', '\x00'}));
+    ASSERT_EQ(write_predictions(stim::SampleFormat::SAMPLE_FORMAT_R8, 0, {{}, {}}), std::string(2, '\0'));
+    ASSERT_EQ(write_predictions(stim::SampleFormat::SAMPLE_FORMAT_01, 0, {{}, {}}), "\n\n");
+}
+
+TEST(PredictionWriter, FlushesLargeOutputsInOrder) {
+    std::vector<std::vector<uint8_t>> shots;
+    std::string expected;
+    for (size_t k = 0; k < 20000; k++) {
+        shots.push_back({(uint8_t)(k % 2), (uint8_t)(k % 3 == 0), 0, 1});
+        expected += std::string(k % 2 ? "1" : "0") + (k % 3 == 0 ? "1" : "0") + "01\n";
+    }
+    ASSERT_EQ(write_predictions(stim::SampleFormat::SAMPLE_FORMAT_01, 4, shots), expected);
+}
+
+TEST(PredictionWriter, Ptb64) {
+    std::vector<std::vector<uint8_t>> shots(64, std::vector<uint8_t>{0, 1});
+    shots[9][0] = 1;
+    std::string expected(16, '\0');
+    expected[1] = 2;
+    for (size_t j = 8; j < 16; j++)
+        expected[j] = '\xFF';
+    ASSERT_EQ(write_predictions(stim::SampleFormat::SAMPLE_FORMAT_PTB64, 2, shots), expected);
+    shots.pop_back();
+    ASSERT_THROW(write_predictions(stim::SampleFormat::SAMPLE_FORMAT_PTB64, 2, shots), std::invalid_argument);
+}
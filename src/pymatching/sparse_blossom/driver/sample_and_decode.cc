@@ -0,0 +1,150 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/sample_and_decode.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <exception>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+pm::SampleAndDecodeResult pm::sample_and_count_mistakes(
+    const stim::Circuit& circuit,
+    std::vector<Mwpm>& mwpms,
+    const StoppingRule& stopping_rule,
+    size_t batch_size,
+    uint64_t seed,
+    DecodeLatencyHistograms* latencies) {
+    if (mwpms.empty())
+        throw std::invalid_argument("At least one Mwpm is needed to decode shots.");
+    if (batch_size == 0)
+        throw std::invalid_argument("The batch size must be at least 1.");
+    if (stopping_rule.max_shots == SIZE_MAX && stopping_rule.max_errors == SIZE_MAX &&
+        stopping_rule.max_relative_error <= 0)
+        throw std::invalid_argument("The stopping rule must limit the number of shots or errors.");
+    size_t max_shots = stopping_rule.max_shots;
+    size_t num_detectors = circuit.count_detectors();
+    size_t num_circuit_observables = circuit.count_observables();
+
+    std::atomic<size_t> next_shot(0);
+    std::atomic<size_t> num_shots(0);
+    std::atomic<size_t> num_errors(0);
+    std::atomic<bool> failed(false);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    std::mutex latencies_mutex;
+
+    auto sample_and_decode_batches = [&](pm::Mwpm& mwpm, size_t worker) {
+        try {
+            std::seed_seq seeds{(uint32_t)seed, (uint32_t)(seed >> 32), (uint32_t)worker};
+            std::mt19937_64 rng(seeds);
+            size_t num_observables = mwpm.flooder.graph.num_observables;
+            pm::ExtendedMatchingResult res(num_observables);
+            // The detection events of each shot of the batch, gathered from the detector-major sample table.
+            std::vector<std::vector<uint64_t>> hits(batch_size);
+            // Each worker records into its own histograms, which are added to `latencies' once it has finished.
+            DecodeLatencyHistograms worker_latencies;
+            while (!failed.load(std::memory_order_relaxed) &&
+                   !stopping_rule.is_satisfied(num_shots.load(), num_errors.load())) {
+                size_t begin = next_shot.fetch_add(batch_size);
+                if (begin >= max_shots)
+                    break;
+                size_t n = std::min(batch_size, max_shots - begin);
+
+                auto dets_obs = stim::sample_batch_detection_events<stim::MAX_BITWORD_WIDTH>(circuit, n, rng);
+                auto& dets = dets_obs.first;
+                auto& obs = dets_obs.second;
+                std::chrono::steady_clock::time_point extraction_start;
+                if (latencies != nullptr)
+                    extraction_start = std::chrono::steady_clock::now();
+                for (size_t k = 0; k < n; k++)
+                    hits[k].clear();
+                size_t num_words = (n + 63) / 64;
+                for (size_t d = 0; d < num_detectors; d++) {
+                    auto row = dets[d];
+                    for (size_t w = 0; w < num_words; w++) {
+                        uint64_t bits = row.u64[w];
+                        while (bits) {
+                            size_t k = w * 64 + std::countr_zero(bits);
+                            if (k >= n)
+                                break;
+                            hits[k].push_back(d);
+                            bits &= bits - 1;
+                        }
+                    }
+                }
+
+                uint64_t extraction_ns_per_shot = 0;
+                if (latencies != nullptr)
+                    extraction_ns_per_shot = nanoseconds_since(extraction_start) / n;
+
+                size_t batch_errors = 0;
+                for (size_t k = 0; k < n; k++) {
+                    res.reset();
+                    if (latencies != nullptr) {
+                        pm::DecodePhaseTimes phase_times;
+                        phase_times.syndrome_extraction_ns = extraction_ns_per_shot;
+                        auto shot_start = std::chrono::steady_clock::now();
+                        pm::decode_detection_events(mwpm, hits[k], res.obs_crossed.data(), res.weight, &phase_times);
+                        worker_latencies.record(extraction_ns_per_shot + nanoseconds_since(shot_start), phase_times);
+                    } else {
+                        pm::decode_detection_events(mwpm, hits[k], res.obs_crossed.data(), res.weight);
+                    }
+                    for (size_t o = 0; o < num_circuit_observables; o++) {
+                        bool predicted = o < num_observables && res.obs_crossed[o];
+                        if (predicted != (bool)obs[o][k]) {
+                            batch_errors++;
+                            break;
+                        }
+                    }
+                }
+                num_shots += n;
+                num_errors += batch_errors;
+            }
+            if (latencies != nullptr) {
+                std::lock_guard<std::mutex> lock(latencies_mutex);
+                *latencies += worker_latencies;
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!failed) {
+                failed = true;
+                error = std::current_exception();
+            }
+        }
+    };
+
+    if (mwpms.size() == 1) {
+        sample_and_decode_batches(mwpms[0], 0);
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(mwpms.size());
+        for (size_t w = 0; w < mwpms.size(); w++)
+            threads.emplace_back(sample_and_decode_batches, std::ref(mwpms[w]), w);
+        for (auto& thread : threads)
+            thread.join();
+    }
+    if (error)
+        std::rethrow_exception(error);
+
+    SampleAndDecodeResult result;
+    result.num_shots = num_shots;
+    result.num_errors = num_errors;
+    return result;
+}
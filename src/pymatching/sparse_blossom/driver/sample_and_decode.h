@@ -0,0 +1,60 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SAMPLE_AND_DECODE_H
+#define PYMATCHING2_SAMPLE_AND_DECODE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/stopping_rule.h"
+#include "stim.h"
+
+namespace pm {
+
+struct SampleAndDecodeResult {
+    size_t num_shots = 0;
+    /// The number of shots for which at least one predicted observable was wrong.
+    size_t num_errors = 0;
+};
+
+/// Samples shots from `circuit' and decodes them as they are sampled, counting the shots with a logical error,
+/// without ever writing the shots out.
+///
+/// Each Mwpm in `mwpms', which must all be for the detector error model of `circuit', is used by its own worker
+/// thread. Each worker repeatedly samples a batch of `batch_size' shots (fewer for the last batch) with stim's frame
+/// simulator, seeding its generator from `seed' and its index, and decodes them straight from the sampled detection
+/// event table. No more batches are started once the `max_shots' of `stopping_rule' have been sampled, or once it is
+/// satisfied by the shots decoded so far, but the batches already started are still finished, so slightly more
+/// shots and errors may be counted. With one worker the result only depends on `seed', but with several it also
+/// depends on how the batches were shared out. At least one of the limits of `stopping_rule' must be set.
+///
+/// If `latencies' is not null, the latency of decoding each shot is added to it. The time taken to gather the
+/// detection events of a batch from the sample table is shared equally between its shots, as their syndrome
+/// extraction time. Sampling the batch is not included.
+///
+/// If sampling or decoding throws, the workers are stopped and the first exception is rethrown on the calling thread.
+SampleAndDecodeResult sample_and_count_mistakes(
+    const stim::Circuit& circuit,
+    std::vector<Mwpm>& mwpms,
+    const StoppingRule& stopping_rule,
+    size_t batch_size = 256,
+    uint64_t seed = 0,
+    DecodeLatencyHistograms* latencies = nullptr);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SAMPLE_AND_DECODE_H
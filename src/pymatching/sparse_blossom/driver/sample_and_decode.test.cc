@@ -0,0 +1,93 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/sample_and_decode.h"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+stim::Circuit surface_code_circuit(size_t distance, double p) {
+    stim::CircuitGenParameters gen(distance, distance, "rotated_memory_x");
+    gen.after_clifford_depolarization = p;
+    gen.before_measure_flip_probability = p;
+    gen.after_reset_flip_probability = p;
+    return stim::generate_surface_code_circuit(gen).circuit;
+}
+
+std::vector<pm::Mwpm> mwpms_for_circuit(const stim::Circuit& circuit, size_t num_mwpms) {
+    auto dem = stim::ErrorAnalyzer::circuit_to_detector_error_model(circuit, true, true, false, 0, false, false);
+    return pm::detector_error_model_to_mwpms(dem, pm::NUM_DISTINCT_WEIGHTS, num_mwpms);
+}
+
+pm::StoppingRule stopping_rule(size_t max_shots, size_t max_errors = SIZE_MAX) {
+    pm::StoppingRule rule;
+    rule.max_shots = max_shots;
+    rule.max_errors = max_errors;
+    return rule;
+}
+
+}  // namespace
+
+TEST(SampleAndDecode, CountsEveryShotUpToMaxShots) {
+    auto circuit = surface_code_circuit(3, 0.001);
+    for (size_t num_threads : {1, 3}) {
+        auto mwpms = mwpms_for_circuit(circuit, num_threads);
+        auto result = pm::sample_and_count_mistakes(circuit, mwpms, stopping_rule(1000), 256, 5);
+        ASSERT_EQ(result.num_shots, 1000);
+        ASSERT_LT(result.num_errors, 50);
+    }
+}
+
+TEST(SampleAndDecode, IsDeterministicForOneWorker) {
+    auto circuit = surface_code_circuit(3, 0.02);
+    auto mwpms = mwpms_for_circuit(circuit, 1);
+    auto a = pm::sample_and_count_mistakes(circuit, mwpms, stopping_rule(2000), 300, 7);
+    auto b = pm::sample_and_count_mistakes(circuit, mwpms, stopping_rule(2000), 300, 7);
+    ASSERT_EQ(a.num_shots, b.num_shots);
+    ASSERT_EQ(a.num_errors, b.num_errors);
+    ASSERT_GT(a.num_errors, 0);
+}
+
+TEST(SampleAndDecode, StopsEarlyOnceMaxErrorsAreFound) {
+    auto circuit = surface_code_circuit(3, 0.05);
+    for (size_t num_threads : {1, 2}) {
+        auto mwpms = mwpms_for_circuit(circuit, num_threads);
+        auto result = pm::sample_and_count_mistakes(circuit, mwpms, stopping_rule(1000000, 20), 256, 11);
+        ASSERT_GE(result.num_errors, 20);
+        ASSERT_LT(result.num_shots, 1000000);
+        ASSERT_EQ(result.num_shots % 256, 0);
+    }
+}
+
+TEST(SampleAndDecode, RejectsInvalidArguments) {
+    auto circuit = surface_code_circuit(3, 0.001);
+    std::vector<pm::Mwpm> no_mwpms;
+    ASSERT_THROW(pm::sample_and_count_mistakes(circuit, no_mwpms, stopping_rule(10)), std::invalid_argument);
+    auto mwpms = mwpms_for_circuit(circuit, 1);
+    ASSERT_THROW(pm::sample_and_count_mistakes(circuit, mwpms, stopping_rule(10), 0), std::invalid_argument);
+    ASSERT_THROW(pm::sample_and_count_mistakes(circuit, mwpms, pm::StoppingRule()), std::invalid_argument);
+}
+
+TEST(SampleAndDecode, RecordsTheLatencyOfEveryShot) {
+    auto circuit = surface_code_circuit(3, 0.01);
+    for (size_t num_threads : {1, 3}) {
+        auto mwpms = mwpms_for_circuit(circuit, num_threads);
+        pm::DecodeLatencyHistograms latencies;
+        auto result = pm::sample_and_count_mistakes(circuit, mwpms, stopping_rule(1000), 128, 3, &latencies);
+        ASSERT_EQ(latencies.total.num_values, result.num_shots);
+        ASSERT_EQ(latencies.flooding.num_values, result.num_shots);
+        ASSERT_GE(latencies.total.max_value, latencies.flooding.max_value);
+    }
+}
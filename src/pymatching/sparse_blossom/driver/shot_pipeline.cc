@@ -0,0 +1,217 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/shot_pipeline.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#include "pymatching/sparse_blossom/driver/shot_scheduler.h"
+
+namespace {
+
+struct ShotChunk {
+    std::vector<stim::SparseShot> shots;
+    std::vector<pm::ExtendedMatchingResult> results;
+    size_t num_shots = 0;
+    size_t sequence_number = 0;
+    /// Hands out the shots of the chunk to the decoders, which share the oldest chunk that has shots left.
+    std::optional<pm::ShotScheduler> scheduler;
+    size_t num_active_decoders = 0;
+};
+
+}  // namespace
+
+void pm::decode_shots_pipelined(
+    const ShotReader& read_shot,
+    std::vector<Mwpm>& mwpms,
+    size_t num_observables,
+    const ShotResultHandler& handle_result,
+    size_t chunk_size,
+    bool largest_shots_first) {
+    if (mwpms.empty())
+        throw std::invalid_argument("At least one Mwpm is needed to decode shots.");
+    if (chunk_size == 0)
+        throw std::invalid_argument("The chunk size must be at least 1.");
+
+    // Two chunks per decoder lets the reader and writer work on other chunks while every decoder is busy.
+    std::vector<ShotChunk> chunks(2 * mwpms.size() + 2);
+    for (auto& chunk : chunks) {
+        chunk.shots.resize(chunk_size);
+        chunk.results.resize(chunk_size, pm::ExtendedMatchingResult(num_observables));
+    }
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<size_t> free_chunks;
+    for (size_t i = 0; i < chunks.size(); i++)
+        free_chunks.push_back(i);
+    std::deque<size_t> chunks_to_decode;
+    std::map<size_t, size_t> decoded_chunks;  // Sequence number -> chunk index
+    size_t num_chunks_read = 0;
+    bool done_reading = false;
+    bool failed = false;
+    std::exception_ptr error;
+
+    auto fail = [&](std::exception_ptr e) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!failed) {
+            failed = true;
+            error = e;
+        }
+        changed.notify_all();
+    };
+
+    auto decode_chunks = [&](pm::Mwpm& mwpm, size_t worker) {
+        while (true) {
+            size_t c;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] {
+                    return failed || done_reading || !chunks_to_decode.empty();
+                });
+                if (failed || chunks_to_decode.empty())
+                    return;
+                c = chunks_to_decode.front();
+                chunks[c].num_active_decoders++;
+            }
+            auto& chunk = chunks[c];
+            size_t begin, end;
+            try {
+                while (chunk.scheduler->next_range(worker, begin, end)) {
+                    for (size_t p = begin; p < end; p++) {
+                        size_t k = chunk.scheduler->shot_at(p);
+                        auto& res = chunk.results[k];
+                        res.reset();
+                        pm::decode_detection_events(mwpm, chunk.shots[k].hits, res.obs_crossed.data(), res.weight);
+                    }
+                }
+            } catch (...) {
+                fail(std::current_exception());
+                return;
+            }
+            // Every shot of the chunk has been taken, so no other decoder will start on it. Once the last decoder
+            // working on it is done, every shot has been decoded and the chunk can be written.
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!chunks_to_decode.empty() && chunks_to_decode.front() == c)
+                chunks_to_decode.pop_front();
+            if (--chunk.num_active_decoders == 0) {
+                decoded_chunks[chunk.sequence_number] = c;
+                changed.notify_all();
+            }
+        }
+    };
+
+    auto write_chunks = [&]() {
+        size_t next_sequence_number = 0;
+        while (true) {
+            size_t c;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] {
+                    return failed || decoded_chunks.count(next_sequence_number) ||
+                           (done_reading && next_sequence_number == num_chunks_read);
+                });
+                if (failed)
+                    return;
+                auto it = decoded_chunks.find(next_sequence_number);
+                if (it == decoded_chunks.end())
+                    return;
+                c = it->second;
+                decoded_chunks.erase(it);
+            }
+            auto& chunk = chunks[c];
+            try {
+                for (size_t k = 0; k < chunk.num_shots; k++)
+                    handle_result(chunk.shots[k], chunk.results[k]);
+            } catch (...) {
+                fail(std::current_exception());
+                return;
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            free_chunks.push_back(c);
+            next_sequence_number++;
+            changed.notify_all();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(mwpms.size() + 1);
+    for (size_t w = 0; w < mwpms.size(); w++)
+        threads.emplace_back(decode_chunks, std::ref(mwpms[w]), w);
+    threads.emplace_back(write_chunks);
+
+    // The calling thread is the reader.
+    try {
+        while (true) {
+            size_t c;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] {
+                    return failed || !free_chunks.empty();
+                });
+                if (failed)
+                    break;
+                c = free_chunks.front();
+                free_chunks.pop_front();
+            }
+            auto& chunk = chunks[c];
+            size_t k = 0;
+            while (k < chunk_size) {
+                chunk.shots[k].clear();
+                if (!read_shot(chunk.shots[k]))
+                    break;
+                k++;
+            }
+            chunk.num_shots = k;
+            chunk.scheduler.emplace(k, mwpms.size());
+            if (largest_shots_first && mwpms.size() > 1) {
+                std::vector<size_t> costs(k);
+                for (size_t j = 0; j < k; j++)
+                    costs[j] = chunk.shots[j].hits.size();
+                chunk.scheduler->order_by_decreasing_cost(costs);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (k > 0) {
+                chunk.sequence_number = num_chunks_read++;
+                chunks_to_decode.push_back(c);
+            } else {
+                free_chunks.push_back(c);
+            }
+            if (k < chunk_size)
+                done_reading = true;
+            changed.notify_all();
+            if (done_reading)
+                break;
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    {
+        // Make sure the other threads exit even if reading stopped early.
+        std::lock_guard<std::mutex> lock(mutex);
+        done_reading = true;
+        changed.notify_all();
+    }
+
+    for (auto& t : threads)
+        t.join();
+    if (error)
+        std::rethrow_exception(error);
+}
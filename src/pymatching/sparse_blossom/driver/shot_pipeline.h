@@ -0,0 +1,54 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SHOT_PIPELINE_H
+#define PYMATCHING2_SHOT_PIPELINE_H
+
+#include <functional>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "stim.h"
+
+namespace pm {
+
+/// Reads the next shot into `shot' (which has already been cleared), returning false once there are no more shots.
+typedef std::function<bool(stim::SparseShot& shot)> ShotReader;
+
+/// Receives a shot together with the result of decoding it.
+typedef std::function<void(const stim::SparseShot& shot, const ExtendedMatchingResult& result)> ShotResultHandler;
+
+/// Decodes a stream of shots using several threads, while preserving the order of the shots.
+///
+/// The calling thread reads shots using `read_shot' in chunks of `chunk_size' shots into a bounded ring of
+/// chunk buffers. Each Mwpm in `mwpms' is used by its own decoder thread. The decoders share the oldest chunk
+/// that still has shots left to decode, taking small ranges of its shots with a `ShotScheduler' (stealing from
+/// each other once their own range is empty), so that a chunk with a few slow shots doesn't hold up the writer.
+/// If `largest_shots_first' is true, the decoders start with the shots of a chunk with the most detection events.
+/// A single writer thread then passes each shot and its result to `handle_result', strictly in the order in which
+/// the shots were read, before returning the chunk buffer to the ring.
+///
+/// If reading, decoding or handling a result throws, the pipeline is stopped and the first exception is
+/// rethrown on the calling thread once all threads have finished.
+void decode_shots_pipelined(
+    const ShotReader& read_shot,
+    std::vector<Mwpm>& mwpms,
+    size_t num_observables,
+    const ShotResultHandler& handle_result,
+    size_t chunk_size = 1024,
+    bool largest_shots_first = false);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SHOT_PIPELINE_H
@@ -0,0 +1,128 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/shot_pipeline.h"
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "stim.h"
+
+// Defined in mwpm_decoding.test.cc
+std::string find_test_data_file(const char* name);
+
+TEST(ShotPipeline, MatchesSerialDecoding) {
+    auto dem_file = std::fopen(find_test_data_file("surface_code_rotated_memory_x_13_0.01.dem").c_str(), "r");
+    stim::DetectorErrorModel dem = stim::DetectorErrorModel::from_file(dem_file);
+    fclose(dem_file);
+
+    std::vector<stim::SparseShot> shots;
+    auto shots_in = std::fopen(find_test_data_file("surface_code_rotated_memory_x_13_0.01_1000_shots.b8").c_str(), "r");
+    auto reader = stim::MeasureRecordReader<stim::MAX_BITWORD_WIDTH>::make(
+        shots_in, stim::SampleFormat::SAMPLE_FORMAT_B8, 0, dem.count_detectors(), dem.count_observables());
+    stim::SparseShot sparse_shot;
+    while (reader->start_and_read_entire_record(sparse_shot)) {
+        shots.push_back(sparse_shot);
+        sparse_shot.clear();
+    }
+    fclose(shots_in);
+    ASSERT_EQ(shots.size(), 1000);
+
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS);
+    std::vector<pm::ExtendedMatchingResult> expected;
+    for (auto& shot : shots) {
+        pm::ExtendedMatchingResult res(mwpm.flooder.graph.num_observables);
+        pm::decode_detection_events(mwpm, shot.hits, res.obs_crossed.data(), res.weight);
+        expected.push_back(res);
+    }
+
+    for (size_t num_threads : {1, 2, 5}) {
+        for (size_t chunk_size : {1, 7, 1000, 4096}) {
+            for (bool largest_shots_first : {false, true}) {
+                auto mwpms = pm::detector_error_model_to_mwpms(dem, pm::NUM_DISTINCT_WEIGHTS, num_threads);
+                ASSERT_EQ(mwpms.size(), num_threads);
+                size_t next_shot = 0;
+                std::vector<pm::ExtendedMatchingResult> results;
+                std::vector<std::vector<uint64_t>> hits;
+                pm::decode_shots_pipelined(
+                    [&](stim::SparseShot& shot) {
+                        if (next_shot == shots.size())
+                            return false;
+                        shot.hits = shots[next_shot++].hits;
+                        return true;
+                    },
+                    mwpms,
+                    dem.count_observables(),
+                    [&](const stim::SparseShot& shot, const pm::ExtendedMatchingResult& res) {
+                        hits.push_back(shot.hits);
+                        results.push_back(res);
+                    },
+                    chunk_size,
+                    largest_shots_first);
+                ASSERT_EQ(results, expected);
+                for (size_t i = 0; i < shots.size(); i++)
+                    ASSERT_EQ(hits[i], shots[i].hits);
+            }
+        }
+    }
+}
+
+TEST(ShotPipeline, EmptyInput) {
+    auto dem = stim::DetectorErrorModel(R"DEM(
+        error(0.1) D0 L0
+        error(0.1) D0 D1
+    )DEM");
+    auto mwpms = pm::detector_error_model_to_mwpms(dem, pm::NUM_DISTINCT_WEIGHTS, 3);
+    size_t num_results = 0;
+    pm::decode_shots_pipelined(
+        [&](stim::SparseShot&) {
+            return false;
+        },
+        mwpms,
+        1,
+        [&](const stim::SparseShot&, const pm::ExtendedMatchingResult&) {
+            num_results++;
+        });
+    ASSERT_EQ(num_results, 0);
+}
+
+TEST(ShotPipeline, ErrorsArePropagated) {
+    auto dem = stim::DetectorErrorModel(R"DEM(
+        error(0.1) D0 D1 L0
+        error(0.1) D1 D2
+    )DEM");
+    auto mwpms = pm::detector_error_model_to_mwpms(dem, pm::NUM_DISTINCT_WEIGHTS, 2);
+    size_t num_shots_read = 0;
+    auto read_shot = [&](stim::SparseShot& shot) {
+        num_shots_read++;
+        // Shot 500 has a single detection event in a component without a boundary, so cannot be decoded.
+        if (num_shots_read == 500)
+            shot.hits = {1};
+        else
+            shot.hits = {0, 2};
+        return num_shots_read < 10000;
+    };
+    auto ignore_result = [](const stim::SparseShot&, const pm::ExtendedMatchingResult&) {
+    };
+    ASSERT_THROW(pm::decode_shots_pipelined(read_shot, mwpms, 1, ignore_result, 16), std::invalid_argument);
+
+    num_shots_read = 0;
+    auto throwing_read_shot = [&](stim::SparseShot& shot) {
+        if (++num_shots_read == 100)
+            throw std::invalid_argument("bad shot");
+        shot.hits = {0, 2};
+        return true;
+    };
+    ASSERT_THROW(pm::decode_shots_pipelined(throwing_read_shot, mwpms, 1, ignore_result, 16), std::invalid_argument);
+}
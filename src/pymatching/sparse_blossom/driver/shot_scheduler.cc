@@ -0,0 +1,113 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/shot_scheduler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+
+pm::ShotScheduler::ShotScheduler(size_t num_shots, size_t num_workers, size_t max_grain_size)
+    : _num_shots(num_shots), max_grain_size(max_grain_size), ranges(num_workers) {
+    if (num_workers == 0)
+        throw std::invalid_argument("A shot scheduler needs at least one worker.");
+    if (max_grain_size == 0)
+        throw std::invalid_argument("The maximum grain size must be at least 1.");
+    // Worker w gets the positions of the shots w, w + num_workers, w + 2 * num_workers, ... when they are dealt out
+    // in turn, which is what `order_by_decreasing_cost' relies on.
+    size_t begin = 0;
+    for (size_t w = 0; w < num_workers; w++) {
+        size_t num_worker_shots = (num_shots + num_workers - 1 - w) / num_workers;
+        ranges[w].begin = begin;
+        ranges[w].end = begin + num_worker_shots;
+        begin += num_worker_shots;
+    }
+}
+
+void pm::ShotScheduler::order_by_decreasing_cost(const std::vector<size_t>& costs) {
+    if (costs.size() != _num_shots)
+        throw std::invalid_argument("There must be one cost per shot.");
+    std::vector<size_t> sorted_shots(_num_shots);
+    std::iota(sorted_shots.begin(), sorted_shots.end(), 0);
+    std::stable_sort(sorted_shots.begin(), sorted_shots.end(), [&](size_t a, size_t b) {
+        return costs[a] > costs[b];
+    });
+    size_t num_workers = ranges.size();
+    order.resize(_num_shots);
+    for (size_t k = 0; k < _num_shots; k++)
+        order[ranges[k % num_workers].begin + k / num_workers] = sorted_shots[k];
+}
+
+bool pm::ShotScheduler::next_range(size_t worker, size_t& begin, size_t& end) {
+    auto& range = ranges[worker];
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(range.mutex);
+            size_t remaining = range.end - range.begin;
+            if (remaining > 0) {
+                size_t grain = std::max<size_t>(1, std::min(max_grain_size, remaining / 8));
+                begin = range.begin;
+                end = begin + grain;
+                range.begin = end;
+                return true;
+            }
+        }
+        if (!steal(worker))
+            return false;
+    }
+}
+
+bool pm::ShotScheduler::steal(size_t worker) {
+    // Only one lock is held at a time, so the sizes may change before the victim is locked again, and are rechecked.
+    while (true) {
+        size_t victim = SIZE_MAX;
+        size_t victim_remaining = 0;
+        for (size_t w = 0; w < ranges.size(); w++) {
+            if (w == worker)
+                continue;
+            std::lock_guard<std::mutex> lock(ranges[w].mutex);
+            size_t remaining = ranges[w].end - ranges[w].begin;
+            if (remaining > victim_remaining) {
+                victim = w;
+                victim_remaining = remaining;
+            }
+        }
+        if (victim == SIZE_MAX)
+            return false;
+
+        size_t stolen_begin, stolen_end;
+        {
+            std::lock_guard<std::mutex> lock(ranges[victim].mutex);
+            size_t remaining = ranges[victim].end - ranges[victim].begin;
+            if (remaining == 0)
+                continue;
+            stolen_end = ranges[victim].end;
+            stolen_begin = stolen_end - (remaining + 1) / 2;
+            ranges[victim].end = stolen_begin;
+        }
+        std::lock_guard<std::mutex> lock(ranges[worker].mutex);
+        ranges[worker].begin = stolen_begin;
+        ranges[worker].end = stolen_end;
+        return true;
+    }
+}
+
+size_t pm::ShotScheduler::num_shots() const {
+    return _num_shots;
+}
+
+size_t pm::ShotScheduler::num_workers() const {
+    return ranges.size();
+}
@@ -0,0 +1,69 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SHOT_SCHEDULER_H
+#define PYMATCHING2_SHOT_SCHEDULER_H
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace pm {
+
+/// Hands out the shots of a batch to several worker threads in small ranges, with work stealing, so that all the
+/// workers stay busy until the end of the batch even when a few shots take far longer to decode than the rest.
+///
+/// The positions 0, 1, ..., num_shots - 1 start out split into one contiguous range per worker. A worker takes a
+/// grain of positions from the front of its own range, whose size is a fraction of what remains in the range (at most
+/// `max_grain_size'), so grains shrink as the range empties. Once its own range is empty, a worker steals the back
+/// half of the largest range left to another worker. The shot at each position is `shot_at(position)', which is the
+/// position itself unless the shots have been ordered with `order_by_decreasing_cost'.
+class ShotScheduler {
+   public:
+    ShotScheduler(size_t num_shots, size_t num_workers, size_t max_grain_size = 64);
+
+    /// Orders the shots so that each worker starts with the most costly shots of its range, e.g. using the number of
+    /// detection events of each shot as its cost. The shots are sorted by decreasing `costs[shot]', and dealt out to
+    /// the workers in turn. Must be called before any range is taken.
+    void order_by_decreasing_cost(const std::vector<size_t>& costs);
+    /// Sets [begin, end) to the next range of positions for worker `worker', returning false once there are none left.
+    /// May be called by each worker concurrently.
+    bool next_range(size_t worker, size_t& begin, size_t& end);
+    inline size_t shot_at(size_t position) const {
+        return order.empty() ? position : order[position];
+    }
+    size_t num_shots() const;
+    size_t num_workers() const;
+
+   private:
+    /// The positions [begin, end) not yet taken from a worker's range. Aligned to avoid false sharing.
+    struct alignas(64) WorkerRange {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    size_t _num_shots;
+    size_t max_grain_size;
+    std::vector<WorkerRange> ranges;
+    std::vector<size_t> order;
+
+    /// Moves the back half of the largest range of another worker into the (empty) range of `worker', returning false
+    /// if every other range is empty.
+    bool steal(size_t worker);
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SHOT_SCHEDULER_H
@@ -0,0 +1,107 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/shot_scheduler.h"
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <thread>
+
+using namespace pm;
+
+TEST(ShotScheduler, SingleWorkerTakesShotsInOrder) {
+    ShotScheduler scheduler(1000, 1, 16);
+    std::vector<size_t> shots;
+    size_t begin, end;
+    while (scheduler.next_range(0, begin, end)) {
+        ASSERT_LT(begin, end);
+        ASSERT_LE(end - begin, 16);
+        ASSERT_EQ(begin, shots.size());
+        for (size_t p = begin; p < end; p++)
+            shots.push_back(scheduler.shot_at(p));
+    }
+    ASSERT_EQ(shots.size(), 1000);
+    for (size_t k = 0; k < shots.size(); k++)
+        ASSERT_EQ(shots[k], k);
+    // The grains shrink as the range empties.
+    ShotScheduler small(10, 1);
+    ASSERT_TRUE(small.next_range(0, begin, end));
+    ASSERT_EQ(end - begin, 1);
+
+    ASSERT_THROW(ShotScheduler(10, 0), std::invalid_argument);
+    ASSERT_THROW(ShotScheduler(10, 1, 0), std::invalid_argument);
+}
+
+TEST(ShotScheduler, IdleWorkerStealsFromOthers) {
+    ShotScheduler scheduler(100, 2);
+    size_t begin, end;
+    // Worker 1 takes all the shots, first from its own range and then by stealing from worker 0.
+    std::vector<uint8_t> taken(100, 0);
+    while (scheduler.next_range(1, begin, end)) {
+        for (size_t p = begin; p < end; p++)
+            taken[scheduler.shot_at(p)]++;
+    }
+    for (auto t : taken)
+        ASSERT_EQ(t, 1);
+    ASSERT_FALSE(scheduler.next_range(0, begin, end));
+}
+
+TEST(ShotScheduler, ConcurrentWorkersTakeEachShotOnce) {
+    for (size_t num_workers : {2, 3, 8}) {
+        ShotScheduler scheduler(10007, num_workers);
+        std::vector<uint8_t> taken(scheduler.num_shots(), 0);
+        std::vector<std::thread> threads;
+        for (size_t w = 0; w < num_workers; w++) {
+            threads.emplace_back([&, w]() {
+                size_t begin, end;
+                while (scheduler.next_range(w, begin, end)) {
+                    // Workers are given disjoint positions, so no synchronisation is needed.
+                    for (size_t p = begin; p < end; p++)
+                        taken[scheduler.shot_at(p)]++;
+                    // Make the workers uneven, so that some of them steal.
+                    if (w == 0)
+                        std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        for (auto t : taken)
+            ASSERT_EQ(t, 1);
+    }
+}
+
+TEST(ShotScheduler, OrderByDecreasingCost) {
+    std::vector<size_t> costs{3, 9, 0, 5, 7, 1, 8};
+    ShotScheduler scheduler(costs.size(), 2);
+    scheduler.order_by_decreasing_cost(costs);
+    // The shots sorted by decreasing cost are 1, 6, 4, 3, 0, 5, 2, and are dealt out to the workers in turn. Worker 0
+    // takes its own shots 1, 4, 0, 2, then steals the back half 3, 5 of the shots 6, 3, 5 of worker 1, and then 6.
+    std::vector<size_t> worker_shots[2];
+    size_t begin, end;
+    for (size_t w = 0; w < 2; w++) {
+        while (scheduler.next_range(w, begin, end)) {
+            for (size_t p = begin; p < end; p++)
+                worker_shots[w].push_back(scheduler.shot_at(p));
+        }
+    }
+    ASSERT_EQ(worker_shots[0], (std::vector<size_t>{1, 4, 0, 2, 3, 5, 6}));
+    ASSERT_EQ(worker_shots[1], (std::vector<size_t>{}));
+
+    ShotScheduler scheduler2(costs.size(), 2);
+    scheduler2.order_by_decreasing_cost(costs);
+    ASSERT_TRUE(scheduler2.next_range(1, begin, end));
+    ASSERT_EQ(scheduler2.shot_at(begin), 6);
+    ASSERT_THROW(scheduler2.order_by_decreasing_cost({1, 2}), std::invalid_argument);
+}
@@ -0,0 +1,275 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pymatching/sparse_blossom/driver/sliding_window.h"
+
+#include <algorithm>
+
+#include "pymatching/sparse_blossom/driver/io.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+
+bool pm::RoundErrors::Error::operator==(const Error& rhs) const {
+    return probability == rhs.probability && detectors == rhs.detectors && observables == rhs.observables;
+}
+
+bool pm::RoundErrors::operator==(const RoundErrors& rhs) const {
+    return num_detectors == rhs.num_detectors && errors == rhs.errors;
+}
+
+pm::SlidingWindowDecoder::SlidingWindowDecoder(
+    const stim::DetectorErrorModel& detector_error_model,
+    const std::vector<size_t>& round_sizes,
+    size_t window_rounds,
+    size_t commit_rounds)
+    : _window_rounds(window_rounds),
+      _commit_rounds(commit_rounds),
+      _num_observables(detector_error_model.count_observables()),
+      window_start(0),
+      num_rounds_added(0),
+      _num_window_graphs_built(0) {
+    if (commit_rounds == 0 || commit_rounds > window_rounds)
+        throw std::invalid_argument("The number of committed rounds must be between 1 and the window size.");
+    round_first_detector.push_back(0);
+    for (auto round_size : round_sizes)
+        round_first_detector.push_back(round_first_detector.back() + round_size);
+    size_t num_detectors = detector_error_model.count_detectors();
+    if (round_first_detector.back() != num_detectors) {
+        throw std::invalid_argument(
+            "The rounds contain " + std::to_string(round_first_detector.back()) + " detectors, but the detector " +
+            "error model has " + std::to_string(num_detectors) + " detectors.");
+    }
+
+    // Group the errors by the round of their smallest detector.
+    std::vector<RoundErrors> rounds(round_sizes.size());
+    for (size_t r = 0; r < rounds.size(); r++)
+        rounds[r].num_detectors = round_sizes[r];
+    size_t max_round_span = 0;
+    pm::iter_detector_error_model_edges(
+        detector_error_model, [&](double p, const std::vector<size_t>& detectors, std::vector<size_t>& observables) {
+            if (detectors.empty() || detectors.size() > 2)
+                return;
+            auto round_of = [&](size_t detector) {
+                return (size_t)(std::upper_bound(round_first_detector.begin(), round_first_detector.end(), detector) -
+                                round_first_detector.begin()) -
+                       1;
+            };
+            size_t min_detector = *std::min_element(detectors.begin(), detectors.end());
+            size_t max_detector = *std::max_element(detectors.begin(), detectors.end());
+            size_t round = round_of(min_detector);
+            max_round_span = std::max(max_round_span, round_of(max_detector) - round);
+            RoundErrors::Error error{p, detectors, observables};
+            for (auto& d : error.detectors)
+                d -= round_first_detector[round];
+            rounds[round].errors.push_back(std::move(error));
+        });
+    if (window_rounds < rounds.size() && max_round_span > window_rounds - commit_rounds) {
+        throw std::invalid_argument(
+            "An error spans " + std::to_string(max_round_span) + " rounds, which is more than the " +
+            std::to_string(window_rounds - commit_rounds) + " uncommitted rounds of the window.");
+    }
+
+    for (auto& round : rounds) {
+        auto it = std::find(distinct_rounds.rbegin(), distinct_rounds.rend(), round);
+        if (it == distinct_rounds.rend()) {
+            round_errors_index.push_back(distinct_rounds.size());
+            distinct_rounds.push_back(std::move(round));
+        } else {
+            round_errors_index.push_back(distinct_rounds.rend() - it - 1);
+        }
+    }
+}
+
+pm::SlidingWindowDecoder::SlidingWindowDecoder(
+    const stim::DetectorErrorModel& detector_error_model, size_t window_rounds, size_t commit_rounds)
+    : SlidingWindowDecoder(
+          detector_error_model,
+          detector_round_sizes_from_coordinates(detector_error_model),
+          window_rounds,
+          commit_rounds) {
+}
+
+size_t pm::SlidingWindowDecoder::num_rounds() const {
+    return round_errors_index.size();
+}
+
+size_t pm::SlidingWindowDecoder::num_detectors() const {
+    return round_first_detector.back();
+}
+
+size_t pm::SlidingWindowDecoder::num_observables() const {
+    return _num_observables;
+}
+
+size_t pm::SlidingWindowDecoder::num_distinct_rounds() const {
+    return distinct_rounds.size();
+}
+
+size_t pm::SlidingWindowDecoder::num_window_graphs_built() const {
+    return _num_window_graphs_built;
+}
+
+void pm::SlidingWindowDecoder::start_shot() {
+    window_start = 0;
+    num_rounds_added = 0;
+    syndrome.clear();
+    predictions.assign(_num_observables, 0);
+}
+
+void pm::SlidingWindowDecoder::add_round(const std::vector<uint64_t>& detection_events) {
+    size_t round = num_rounds_added;
+    if (round >= num_rounds())
+        throw std::invalid_argument("All " + std::to_string(num_rounds()) + " rounds have already been added.");
+    size_t offset = round_first_detector[window_start];
+    syndrome.resize(round_first_detector[round + 1] - offset, 0);
+    for (auto d : detection_events) {
+        if (d < round_first_detector[round] || d >= round_first_detector[round + 1]) {
+            throw std::invalid_argument(
+                "Detection event " + std::to_string(d) + " is not in round " + std::to_string(round) + ".");
+        }
+        syndrome[d - offset] ^= 1;
+    }
+    num_rounds_added++;
+    while (window_start + _window_rounds < num_rounds() && window_start + _window_rounds <= num_rounds_added)
+        decode_window(window_start + _window_rounds, false);
+}
+
+void pm::SlidingWindowDecoder::finish_shot(uint8_t* obs_begin_ptr) {
+    if (num_rounds_added != num_rounds()) {
+        throw std::invalid_argument(
+            "Only " + std::to_string(num_rounds_added) + " of the " + std::to_string(num_rounds()) +
+            " rounds have been added.");
+    }
+    if (window_start < num_rounds())
+        decode_window(num_rounds(), true);
+    for (size_t i = 0; i < _num_observables; i++)
+        obs_begin_ptr[i] ^= predictions[i];
+}
+
+void pm::SlidingWindowDecoder::decode(const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr) {
+    std::vector<uint64_t> sorted_detection_events = detection_events;
+    std::sort(sorted_detection_events.begin(), sorted_detection_events.end());
+    if (!sorted_detection_events.empty() && sorted_detection_events.back() >= num_detectors()) {
+        throw std::invalid_argument(
+            "Detection event index " + std::to_string(sorted_detection_events.back()) +
+            " is too large. The detector error model has " + std::to_string(num_detectors()) + " detectors.");
+    }
+    start_shot();
+    std::vector<uint64_t> round_detection_events;
+    auto it = sorted_detection_events.begin();
+    for (size_t r = 0; r < num_rounds(); r++) {
+        auto round_end = std::lower_bound(it, sorted_detection_events.end(), round_first_detector[r + 1]);
+        round_detection_events.assign(it, round_end);
+        add_round(round_detection_events);
+        it = round_end;
+    }
+    finish_shot(obs_begin_ptr);
+}
+
+pm::UserGraph& pm::SlidingWindowDecoder::get_window_graph(size_t end_round) {
+    auto key_begin = round_errors_index.begin() + window_start;
+    auto key_end = round_errors_index.begin() + end_round;
+    for (auto& [key, graph] : window_graphs) {
+        if (std::equal(key.begin(), key.end(), key_begin, key_end))
+            return *graph;
+    }
+
+    if (window_graphs.size() == MAX_CACHED_WINDOW_GRAPHS)
+        window_graphs.erase(window_graphs.begin());
+    // Errors crossing the end of the window are cut to edges to an extra boundary node.
+    size_t first_detector = round_first_detector[window_start];
+    size_t num_window_detectors = round_first_detector[end_round] - first_detector;
+    window_graphs.push_back(
+        {std::vector<size_t>(key_begin, key_end),
+         std::make_unique<UserGraph>(num_window_detectors + 1, _num_observables)});
+    auto& window_graph = *window_graphs.back().second;
+    window_graph.set_boundary({num_window_detectors});
+    std::vector<size_t> detectors;
+    for (size_t r = window_start; r < end_round; r++) {
+        size_t offset = round_first_detector[r] - first_detector;
+        for (auto& error : distinct_rounds[round_errors_index[r]].errors) {
+            detectors.clear();
+            for (auto d : error.detectors)
+                detectors.push_back(std::min(d + offset, num_window_detectors));
+            window_graph.handle_dem_instruction(error.probability, detectors, error.observables);
+        }
+    }
+    _num_window_graphs_built++;
+    return window_graph;
+}
+
+void pm::SlidingWindowDecoder::decode_window(size_t end_round, bool is_final_window) {
+    auto& graph = get_window_graph(end_round);
+    size_t first_detector = round_first_detector[window_start];
+    size_t num_window_detectors = round_first_detector[end_round] - first_detector;
+    size_t commit_end_round = is_final_window ? end_round : window_start + _commit_rounds;
+    size_t num_committed_detectors = round_first_detector[commit_end_round] - first_detector;
+
+    window_detection_events.clear();
+    for (size_t i = 0; i < num_window_detectors; i++) {
+        if (syndrome[i])
+            window_detection_events.push_back(i);
+    }
+    window_edges.clear();
+    if (!window_detection_events.empty())
+        pm::decode_detection_events_to_edges(
+            graph.get_mwpm_with_search_graph(), window_detection_events, window_edges);
+
+    for (size_t i = 0; i < window_edges.size(); i += 2) {
+        size_t u = (size_t)window_edges[i];
+        size_t v = window_edges[i + 1] < 0 ? SIZE_MAX : (size_t)window_edges[i + 1];
+        if (v != SIZE_MAX && v < u)
+            std::swap(u, v);
+        if (u >= num_committed_detectors)
+            continue;
+        // No error spans past the end of the window from the committed rounds, so the only boundary edge of `u'
+        // is to the real boundary.
+        auto& edge = graph.edges[graph.index_of_edge(u, v)];
+        for (auto obs : edge.observable_indices)
+            predictions[obs] ^= 1;
+        syndrome[u] ^= 1;
+        if (v != SIZE_MAX)
+            syndrome[v] ^= 1;
+    }
+
+    syndrome.erase(syndrome.begin(), syndrome.begin() + num_committed_detectors);
+    window_start = commit_end_round;
+}
+
+std::vector<size_t> pm::detector_round_sizes_from_coordinates(const stim::DetectorErrorModel& detector_error_model) {
+    size_t num_detectors = detector_error_model.count_detectors();
+    std::set<uint64_t> all_detectors;
+    for (size_t d = 0; d < num_detectors; d++)
+        all_detectors.insert(all_detectors.end(), d);
+    auto coordinates = detector_error_model.get_detector_coordinates(all_detectors);
+
+    std::vector<size_t> round_sizes;
+    double round_time = 0;
+    for (size_t d = 0; d < num_detectors; d++) {
+        auto& coords = coordinates[d];
+        if (coords.empty())
+            throw std::invalid_argument("Detector D" + std::to_string(d) + " has no coordinates.");
+        double time = coords.back();
+        if (round_sizes.empty() || time > round_time) {
+            round_sizes.push_back(0);
+            round_time = time;
+        } else if (time < round_time) {
+            throw std::invalid_argument(
+                "The time coordinate of detector D" + std::to_string(d) + " is smaller than that of D" +
+                std::to_string(d - 1) + ".");
+        }
+        round_sizes.back()++;
+    }
+    return round_sizes;
+}
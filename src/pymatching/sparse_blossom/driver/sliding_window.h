@@ -0,0 +1,129 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PYMATCHING2_SLIDING_WINDOW_H
+#define PYMATCHING2_SLIDING_WINDOW_H
+
+#include <memory>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+#include "stim.h"
+
+namespace pm {
+
+/// The errors of a detector error model whose smallest detector is in a given round, with their detectors given
+/// relative to the first detector of that round. Rounds with identical errors, such as those in the bulk of a
+/// memory experiment, share a single RoundErrors.
+struct RoundErrors {
+    struct Error {
+        double probability;
+        std::vector<size_t> detectors;
+        std::vector<size_t> observables;
+        bool operator==(const Error& rhs) const;
+    };
+    size_t num_detectors;
+    std::vector<Error> errors;
+    bool operator==(const RoundErrors& rhs) const;
+};
+
+/// Decodes shots of a detector error model consisting of many rounds of detectors, using a window of only
+/// `window_rounds' rounds at a time. The detection events of the window are decoded to edges, and the edges with an
+/// endpoint in the first `commit_rounds' rounds of the window are committed: their observables are added to the
+/// prediction, and their other endpoint is flipped if it lies beyond the committed rounds. The window then slides
+/// forward by `commit_rounds' rounds. Errors crossing the end of the window are cut to edges to a boundary, and
+/// the final window commits all of its edges.
+///
+/// The matching graphs of the most recently built windows are cached, keyed by the RoundErrors of their rounds, so in
+/// the periodic bulk of the model a single window graph is reused. The errors of each distinct round are only stored
+/// once, so the memory used is bounded by the size of a window and the number of distinct rounds, and the work per
+/// round is constant. Shots can either be decoded at once with `decode', or streamed one round at a time with
+/// `start_shot', `add_round' and `finish_shot', in which case each window is decoded as soon as all of its rounds
+/// have been added.
+class SlidingWindowDecoder {
+   public:
+    /// The maximum number of window matching graphs that are cached.
+    static constexpr size_t MAX_CACHED_WINDOW_GRAPHS = 4;
+
+    /// `round_sizes[r]' is the number of detectors in round r. The detectors of each round must be consecutive.
+    /// Unless the window covers every round, no error may span more than `window_rounds - commit_rounds' rounds,
+    /// so that the committed edges never cross the end of the window.
+    SlidingWindowDecoder(
+        const stim::DetectorErrorModel& detector_error_model,
+        const std::vector<size_t>& round_sizes,
+        size_t window_rounds,
+        size_t commit_rounds);
+    /// Takes the rounds of the detectors from their coordinates (see `detector_round_sizes_from_coordinates').
+    SlidingWindowDecoder(
+        const stim::DetectorErrorModel& detector_error_model, size_t window_rounds, size_t commit_rounds);
+
+    size_t num_rounds() const;
+    size_t num_detectors() const;
+    size_t num_observables() const;
+    /// The number of distinct RoundErrors stored.
+    size_t num_distinct_rounds() const;
+    /// The number of window matching graphs built so far.
+    size_t num_window_graphs_built() const;
+
+    /// Decodes the detection events `detection_events' (in any order) of a whole shot. The predicted observables
+    /// are XOR-ed into the array starting at `obs_begin_ptr', which has `num_observables()' elements.
+    void decode(const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr);
+
+    /// Starts a new shot, discarding the state of any unfinished shot.
+    void start_shot();
+    /// Adds the detection events of the next round of the current shot, decoding the next window if it is complete.
+    void add_round(const std::vector<uint64_t>& detection_events);
+    /// Decodes the final window of the current shot, once all of its rounds have been added, and XORs the predicted
+    /// observables into the array starting at `obs_begin_ptr'.
+    void finish_shot(uint8_t* obs_begin_ptr);
+
+   private:
+    size_t _window_rounds;
+    size_t _commit_rounds;
+    size_t _num_observables;
+    std::vector<RoundErrors> distinct_rounds;
+    /// The index in `distinct_rounds' of the errors of each round.
+    std::vector<size_t> round_errors_index;
+    /// The first detector of each round, followed by the number of detectors.
+    std::vector<size_t> round_first_detector;
+
+    /// The first round of the current window, and the number of rounds added to the current shot.
+    size_t window_start;
+    size_t num_rounds_added;
+    /// The detection events of the rounds from `window_start' to `num_rounds_added', indexed relative to the
+    /// first detector of `window_start', including the flips from previously committed edges.
+    std::vector<uint8_t> syndrome;
+    std::vector<uint8_t> predictions;
+
+    /// The most recently built window matching graphs, each with the `round_errors_index' of its rounds. Once the
+    /// cache is full, the oldest graph is replaced.
+    std::vector<std::pair<std::vector<size_t>, std::unique_ptr<UserGraph>>> window_graphs;
+    size_t _num_window_graphs_built;
+    std::vector<uint64_t> window_detection_events;
+    std::vector<int64_t> window_edges;
+
+    UserGraph& get_window_graph(size_t end_round);
+    /// Decodes the window from `window_start' to `end_round', commits its edges and slides the window forward.
+    void decode_window(size_t end_round, bool is_final_window);
+};
+
+/// Returns the number of detectors in each round of `detector_error_model', where the round of a detector is given by
+/// its last coordinate (its time). Every detector must have coordinates, and the times of the detectors must be
+/// non-decreasing with their index.
+std::vector<size_t> detector_round_sizes_from_coordinates(const stim::DetectorErrorModel& detector_error_model);
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SLIDING_WINDOW_H
@@ -0,0 +1,151 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "pymatching/sparse_blossom/driver/sliding_window.h"
+
+#include <gtest/gtest.h>
+
+#include "pymatching/rand/rand_gen.h"
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+#include "stim.h"
+
+TEST(SlidingWindow, RoundSizesFromCoordinates) {
+    auto dem = pm::repetition_code_memory_dem(5, 7);
+    ASSERT_EQ(pm::detector_round_sizes_from_coordinates(dem), std::vector<size_t>(7, 4));
+
+    auto unordered = stim::DetectorErrorModel(R"DEM(
+        detector(0, 1) D0
+        detector(0, 0) D1
+        error(0.1) D0 D1
+    )DEM");
+    ASSERT_THROW(pm::detector_round_sizes_from_coordinates(unordered), std::invalid_argument);
+    auto missing = stim::DetectorErrorModel(R"DEM(
+        detector(0, 0) D0
+        error(0.1) D0 D1
+    )DEM");
+    ASSERT_THROW(pm::detector_round_sizes_from_coordinates(missing), std::invalid_argument);
+}
+
+TEST(SlidingWindow, BulkRoundsAndWindowGraphsAreShared) {
+    auto dem = pm::repetition_code_memory_dem(5, 40);
+    pm::SlidingWindowDecoder decoder(dem, 6, 3);
+    ASSERT_EQ(decoder.num_rounds(), 40);
+    ASSERT_EQ(decoder.num_detectors(), 160);
+    // The final round has no time-like errors, so differs from the others.
+    ASSERT_EQ(decoder.num_distinct_rounds(), 2);
+
+    std::vector<uint8_t> obs(1, 0);
+    decoder.decode({}, obs.data());
+    // The windows starting at rounds 0, 3, ..., 33 are identical, and the final window covers rounds 33 to 39.
+    ASSERT_EQ(decoder.num_window_graphs_built(), 2);
+    decoder.decode({5}, obs.data());
+    ASSERT_EQ(decoder.num_window_graphs_built(), 2);
+}
+
+TEST(SlidingWindow, MatchesFullDecodingOfSparseErrors) {
+    size_t distance = 7;
+    size_t num_rounds = 30;
+    auto dem = pm::repetition_code_memory_dem(distance, num_rounds);
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS);
+    pm::SlidingWindowDecoder decoder(dem, 5, 2);
+
+    std::vector<std::pair<std::vector<size_t>, std::vector<size_t>>> errors;
+    pm::iter_detector_error_model_edges(
+        dem, [&](double, const std::vector<size_t>& detectors, std::vector<size_t>& observables) {
+            errors.push_back({detectors, observables});
+        });
+
+    // Errors that are far apart in time are corrected by both decoders.
+    pm::set_seed(0);
+    for (size_t shot = 0; shot < 200; shot++) {
+        std::vector<uint8_t> syndrome(decoder.num_detectors(), 0);
+        uint8_t actual_obs = 0;
+        for (size_t k = 0; k < 3; k++) {
+            size_t round = k * 10 + (size_t)(pm::rand_float(0, 1) * 5);
+            std::vector<size_t> candidates;
+            for (size_t e = 0; e < errors.size(); e++) {
+                if (errors[e].first[0] / (distance - 1) == round)
+                    candidates.push_back(e);
+            }
+            auto& error = errors[candidates[(size_t)(pm::rand_float(0, 1) * candidates.size()) % candidates.size()]];
+            for (auto d : error.first)
+                syndrome[d] ^= 1;
+            actual_obs ^= error.second.size();
+        }
+        std::vector<uint64_t> detection_events;
+        for (size_t d = 0; d < syndrome.size(); d++) {
+            if (syndrome[d])
+                detection_events.push_back(d);
+        }
+
+        std::vector<uint8_t> window_obs(1, 0);
+        decoder.decode(detection_events, window_obs.data());
+        auto full = pm::decode_detection_events_for_up_to_64_observables(mwpm, detection_events);
+        ASSERT_EQ(window_obs[0], full.obs_mask);
+        ASSERT_EQ(window_obs[0], actual_obs);
+    }
+}
+
+TEST(SlidingWindow, StreamingMatchesWholeShotDecoding) {
+    auto dem = pm::repetition_code_memory_dem(5, 20);
+    pm::SlidingWindowDecoder whole(dem, 4, 2);
+    pm::SlidingWindowDecoder streamed(dem, 4, 2);
+    pm::SlidingWindowDecoder single_window(dem, 20, 20);
+    auto mwpm = pm::detector_error_model_to_mwpm(dem, pm::NUM_DISTINCT_WEIGHTS);
+
+    pm::set_seed(1);
+    for (size_t shot = 0; shot < 100; shot++) {
+        std::vector<uint64_t> detection_events;
+        std::vector<std::vector<uint64_t>> rounds(20);
+        for (size_t d = 0; d < whole.num_detectors(); d++) {
+            if (pm::rand_float(0, 1) < 0.05) {
+                detection_events.push_back(d);
+                rounds[d / 4].push_back(d);
+            }
+        }
+
+        std::vector<uint8_t> obs1(1, 0), obs2(1, 0), obs3(1, 0);
+        whole.decode(detection_events, obs1.data());
+        streamed.start_shot();
+        for (auto& round : rounds)
+            streamed.add_round(round);
+        streamed.finish_shot(obs2.data());
+        ASSERT_EQ(obs1, obs2);
+
+        // A window covering every round is the same as decoding the whole graph.
+        single_window.decode(detection_events, obs3.data());
+        auto full = pm::decode_detection_events_for_up_to_64_observables(mwpm, detection_events);
+        ASSERT_EQ(obs3[0], full.obs_mask);
+    }
+}
+
+TEST(SlidingWindow, InvalidArguments) {
+    auto dem = pm::repetition_code_memory_dem(5, 10);
+    ASSERT_THROW(pm::SlidingWindowDecoder(dem, 4, 0), std::invalid_argument);
+    ASSERT_THROW(pm::SlidingWindowDecoder(dem, 4, 5), std::invalid_argument);
+    // Time-like errors span one round, so at least one round of the window must not be committed.
+    ASSERT_THROW(pm::SlidingWindowDecoder(dem, 4, 4), std::invalid_argument);
+    ASSERT_THROW(pm::SlidingWindowDecoder(dem, std::vector<size_t>(9, 4), 4, 2), std::invalid_argument);
+
+    pm::SlidingWindowDecoder decoder(dem, 4, 2);
+    std::vector<uint8_t> obs(1, 0);
+    ASSERT_THROW(decoder.decode({40}, obs.data()), std::invalid_argument);
+    decoder.start_shot();
+    ASSERT_THROW(decoder.add_round({4}), std::invalid_argument);
+    decoder.start_shot();
+    decoder.add_round({});
+    ASSERT_THROW(decoder.finish_shot(obs.data()), std::invalid_argument);
+}
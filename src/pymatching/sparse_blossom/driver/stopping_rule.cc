@@ -0,0 +1,27 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/stopping_rule.h"
+
+#include <cmath>
+
+bool pm::StoppingRule::is_satisfied(size_t num_shots, size_t num_errors) const {
+    if (num_shots >= max_shots || num_errors >= max_errors)
+        return true;
+    if (max_relative_error <= 0 || num_errors < MIN_ERRORS_FOR_RELATIVE_ERROR)
+        return false;
+    // 1.96 * sqrt(p * (1 - p) / n) <= r * p is the same as 1.96^2 * (1 - p) <= r^2 * num_errors.
+    double p = (double)num_errors / (double)num_shots;
+    return 1.96 * 1.96 * (1 - p) <= max_relative_error * max_relative_error * (double)num_errors;
+}
@@ -0,0 +1,45 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_STOPPING_RULE_H
+#define PYMATCHING2_STOPPING_RULE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace pm {
+
+/// Decides when enough shots have been decoded to estimate a logical error rate, so that a sweep point can stop
+/// early instead of decoding every available shot.
+///
+/// Decoding stops once `max_shots' shots have been decoded, once `max_errors' logical errors have been found, or once
+/// the 95% confidence interval of the logical error rate is narrow enough: its half-width, using the normal
+/// approximation 1.96 * sqrt(p * (1 - p) / num_shots) of the binomial distribution, is at most `max_relative_error'
+/// times the estimate p = num_errors / num_shots. The relative criterion is only applied once at least
+/// MIN_ERRORS_FOR_RELATIVE_ERROR errors have been found, since the approximation is poor for fewer. Each limit can
+/// be disabled by leaving it at its default.
+struct StoppingRule {
+    static constexpr size_t MIN_ERRORS_FOR_RELATIVE_ERROR = 10;
+
+    size_t max_shots = SIZE_MAX;
+    size_t max_errors = SIZE_MAX;
+    double max_relative_error = 0;
+
+    /// Whether decoding can stop after `num_shots' shots, of which `num_errors' had a logical error.
+    bool is_satisfied(size_t num_shots, size_t num_errors) const;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_STOPPING_RULE_H
@@ -0,0 +1,49 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/stopping_rule.h"
+
+#include <gtest/gtest.h>
+
+using namespace pm;
+
+TEST(StoppingRule, NeverStopsByDefault) {
+    StoppingRule rule;
+    ASSERT_FALSE(rule.is_satisfied(0, 0));
+    ASSERT_FALSE(rule.is_satisfied(1000000000, 0));
+    ASSERT_FALSE(rule.is_satisfied(1000000000, 1000000));
+}
+
+TEST(StoppingRule, StopsAtMaxShotsOrMaxErrors) {
+    StoppingRule rule;
+    rule.max_shots = 100;
+    rule.max_errors = 5;
+    ASSERT_FALSE(rule.is_satisfied(99, 4));
+    ASSERT_TRUE(rule.is_satisfied(100, 0));
+    ASSERT_TRUE(rule.is_satisfied(50, 5));
+}
+
+TEST(StoppingRule, StopsOnceConfidenceIntervalIsNarrowEnough) {
+    StoppingRule rule;
+    rule.max_relative_error = 0.2;
+    // At a low error rate, 1.96 / sqrt(num_errors) <= 0.2 needs about 97 errors.
+    ASSERT_FALSE(rule.is_satisfied(1000000, 95));
+    ASSERT_TRUE(rule.is_satisfied(1000000, 97));
+    // A high error rate narrows the interval, but never before MIN_ERRORS_FOR_RELATIVE_ERROR errors.
+    ASSERT_TRUE(rule.is_satisfied(100, 90));
+    ASSERT_FALSE(rule.is_satisfied(StoppingRule::MIN_ERRORS_FOR_RELATIVE_ERROR - 1,
+                                   StoppingRule::MIN_ERRORS_FOR_RELATIVE_ERROR - 1));
+    ASSERT_TRUE(rule.is_satisfied(StoppingRule::MIN_ERRORS_FOR_RELATIVE_ERROR,
+                                  StoppingRule::MIN_ERRORS_FOR_RELATIVE_ERROR));
+}
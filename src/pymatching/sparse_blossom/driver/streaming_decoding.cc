@@ -0,0 +1,234 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/streaming_decoding.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+constexpr pm::cumulative_time_int NO_HORIZON = std::numeric_limits<pm::cumulative_time_int>::max();
+
+}  // namespace
+
+pm::StreamingDecoder::StreamingDecoder(Mwpm& mwpm, std::vector<uint32_t> detector_rounds)
+    : mwpm(mwpm), shot_in_progress(false), round_added(false), last_round(0), horizon(NO_HORIZON) {
+    auto& graph = mwpm.flooder.graph;
+    if (graph.num_observables > sizeof(pm::obs_int) * 8)
+        throw std::invalid_argument(
+            "Streaming decoding is only supported for graphs with at most " +
+            std::to_string(sizeof(pm::obs_int) * 8) + " observables.");
+    if (mwpm.flooder.negative_weight_sum != 0 || !mwpm.flooder.negative_weight_detection_events.empty())
+        throw std::invalid_argument("Streaming decoding is not supported for graphs with negative edge weights.");
+    size_t num_nodes = graph.nodes.size();
+    if (detector_rounds.size() != num_nodes)
+        throw std::invalid_argument(
+            "Got rounds for " + std::to_string(detector_rounds.size()) + " detectors, but the graph has " +
+            std::to_string(num_nodes) + " nodes.");
+    if (graph.node_relabeling) {
+        node_rounds.resize(num_nodes);
+        for (size_t d = 0; d < num_nodes; d++)
+            node_rounds[graph.node_relabeling->graph_index[d]] = detector_rounds[d];
+    } else {
+        node_rounds = std::move(detector_rounds);
+    }
+    distances.assign(num_nodes, NO_HORIZON);
+}
+
+size_t pm::StreamingDecoder::node_of_detector(uint64_t detector) {
+    auto& graph = mwpm.flooder.graph;
+    if (detector >= graph.nodes.size())
+        throw std::invalid_argument(
+            "Detection event index `" + std::to_string(detector) + "` is larger than the number of nodes in the graph.");
+    size_t node = graph.node_relabeling ? graph.node_relabeling->graph_index[detector] : detector;
+    if (node < graph.is_user_graph_boundary_node.size() && graph.is_user_graph_boundary_node[node])
+        return SIZE_MAX;
+    return node;
+}
+
+void pm::StreamingDecoder::abandon_shot() {
+    mwpm.reset();
+    sources.clear();
+    bounds.clear();
+    horizon = NO_HORIZON;
+    shot_in_progress = false;
+}
+
+void pm::StreamingDecoder::start_shot() {
+    if (shot_in_progress)
+        abandon_shot();
+    if (!mwpm.flooder.queue.empty())
+        throw std::invalid_argument("!mwpm.flooder.queue.empty()");
+    mwpm.flooder.queue.cur_time = 0;
+    mwpm.flooder.start_shot();
+    round_added = false;
+    last_round = 0;
+    horizon = NO_HORIZON;
+    shot_in_progress = true;
+}
+
+pm::cumulative_time_int pm::StreamingDecoder::distance_to_later_round(size_t node, uint32_t round) {
+    auto& graph = mwpm.flooder.graph;
+    const DetectorNode* first_node = graph.nodes.data();
+    auto later = std::greater<std::pair<cumulative_time_int, size_t>>();
+    cumulative_time_int result = NO_HORIZON;
+    distances[node] = 0;
+    touched_nodes.push_back(node);
+    heap.emplace_back(0, node);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto [dist, node_index] = heap.back();
+        heap.pop_back();
+        if (dist != distances[node_index])
+            continue;
+        if (node_rounds[node_index] > round) {
+            result = dist;
+            break;
+        }
+        const DetectorNode& detector_node = graph.nodes[node_index];
+        for (size_t i = 0; i < detector_node.neighbors.size(); i++) {
+            const DetectorNode* neighbor = detector_node.neighbors[i];
+            if (neighbor == nullptr)
+                continue;
+            cumulative_time_int neighbor_dist = dist + detector_node.neighbor_weights[i];
+            size_t neighbor_index = neighbor - first_node;
+            if (neighbor_dist < distances[neighbor_index]) {
+                if (distances[neighbor_index] == NO_HORIZON)
+                    touched_nodes.push_back(neighbor_index);
+                distances[neighbor_index] = neighbor_dist;
+                heap.emplace_back(neighbor_dist, neighbor_index);
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+    }
+    for (size_t node_index : touched_nodes)
+        distances[node_index] = NO_HORIZON;
+    touched_nodes.clear();
+    heap.clear();
+    return result;
+}
+
+pm::cumulative_time_int pm::StreamingDecoder::compute_safe_horizon() {
+    // The nodes of the rounds after `last_round' only shrink as rounds are added, so a bound computed for an earlier
+    // round is still a lower bound, and only the smallest bounds need to be made exact.
+    auto later = std::greater<HorizonBound>();
+    while (!bounds.empty()) {
+        HorizonBound& top = bounds.front();
+        if (top.round == last_round || top.time == NO_HORIZON)
+            return top.time;
+        std::pop_heap(bounds.begin(), bounds.end(), later);
+        HorizonBound& bound = bounds.back();
+        cumulative_time_int distance = distance_to_later_round(bound.node, last_round);
+        bound.time = distance == NO_HORIZON ? NO_HORIZON : bound.created_at + distance;
+        bound.round = last_round;
+        std::push_heap(bounds.begin(), bounds.end(), later);
+    }
+    return NO_HORIZON;
+}
+
+void pm::StreamingDecoder::add_round(uint32_t round, std::span<const uint64_t> detection_events) {
+    if (!shot_in_progress)
+        start_shot();
+    if (round_added && round <= last_round)
+        throw std::invalid_argument(
+            "Round " + std::to_string(round) + " was added after round " + std::to_string(last_round) + ".");
+    for (auto detector : detection_events) {
+        size_t node;
+        try {
+            node = node_of_detector(detector);
+        } catch (const std::invalid_argument&) {
+            abandon_shot();
+            throw;
+        }
+        if (node == SIZE_MAX)
+            continue;
+        if (node_rounds[node] != round) {
+            abandon_shot();
+            throw std::invalid_argument(
+                "Detector " + std::to_string(detector) + " is in round " + std::to_string(node_rounds[node]) +
+                ", not in round " + std::to_string(round) + ".");
+        }
+    }
+    last_round = round;
+    round_added = true;
+
+    // Nodes of this round cannot have been reached, since flooding stopped before the previous horizon.
+    auto later = std::greater<HorizonBound>();
+    cumulative_time_int now = mwpm.flooder.queue.cur_time;
+    for (auto detector : detection_events) {
+        size_t node = node_of_detector(detector);
+        if (node == SIZE_MAX)
+            continue;
+        mwpm.create_detection_event(&mwpm.flooder.graph.nodes[node]);
+        sources.push_back(node);
+        cumulative_time_int distance = distance_to_later_round(node, round);
+        bounds.push_back({distance == NO_HORIZON ? NO_HORIZON : now + distance, now, round, node});
+        std::push_heap(bounds.begin(), bounds.end(), later);
+    }
+
+    horizon = compute_safe_horizon();
+    // The edge weights are even, so that regions created at the same time always collide at an integer time. So that
+    // this stays true for the regions of later rounds, flooding stops at an even time before the horizon, which the
+    // queue is then moved to.
+    cumulative_time_int stop = horizon == NO_HORIZON ? NO_HORIZON : (horizon - 1) & ~(cumulative_time_int)1;
+    while (true) {
+        auto event = mwpm.flooder.run_until_next_mwpm_notification_before(stop == NO_HORIZON ? NO_HORIZON : stop + 1);
+        if (event.event_type == pm::NO_EVENT)
+            break;
+        mwpm.process_event(event);
+    }
+    cumulative_time_int cur_time = mwpm.flooder.queue.cur_time;
+    mwpm.flooder.advance_time_to(stop == NO_HORIZON ? cur_time + (cur_time & 1) : stop);
+}
+
+pm::MatchingResult pm::StreamingDecoder::finish_shot() {
+    if (!shot_in_progress)
+        start_shot();
+    horizon = NO_HORIZON;
+    while (true) {
+        auto event = mwpm.flooder.run_until_next_mwpm_notification();
+        if (event.event_type == pm::NO_EVENT)
+            break;
+        mwpm.process_event(event);
+    }
+    if (mwpm.node_arena.size() != 0) {
+        abandon_shot();
+        throw std::invalid_argument(
+            "No perfect matching could be found. This likely means that the syndrome has odd "
+            "parity in the support of a connected component without a boundary.");
+    }
+
+    MatchingResult res;
+    for (auto node : sources) {
+        auto& detector_node = mwpm.flooder.graph.nodes[node];
+        if (detector_node.region_that_arrived)
+            res += mwpm.shatter_blossom_and_extract_matches(detector_node.region_that_arrived_top);
+    }
+    sources.clear();
+    bounds.clear();
+    shot_in_progress = false;
+    return res;
+}
+
+pm::cumulative_time_int pm::StreamingDecoder::safe_horizon() const {
+    return horizon;
+}
+
+size_t pm::StreamingDecoder::num_detection_events() const {
+    return sources.size();
+}
@@ -0,0 +1,109 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_STREAMING_DECODING_H
+#define PYMATCHING2_STREAMING_DECODING_H
+
+#include <span>
+#include <vector>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+
+namespace pm {
+
+/// Decodes a shot whose detection events arrive round by round, flooding as far as is safe after each round so that
+/// most of the work is done before the last round has arrived.
+///
+/// Every detector belongs to a round, and the rounds of a shot are added in increasing order. The blossom algorithm
+/// only needs the region of a detection event to start growing from an empty node: it finds a minimum-weight
+/// matching for any schedule of dual updates, so a region created part way through flooding (starting from radius
+/// 0 at the current time, which is kept even like the edge weights) gives the same weight as decoding the whole shot
+/// at once. A region that was created at
+/// time c from a node s cannot reach a node v before time c + d(s, v), so after round t has been added, the flooder
+/// can process every event before the safe horizon, the smallest c + d(s, v) over the detection events s added so far
+/// and the nodes v of later rounds, without reaching a node that a later detection event may be at. The horizon is
+/// recomputed after each round, with a Dijkstra search from only the detection events whose previous bound is
+/// smallest.
+///
+/// The weight of the solution is always that of a minimum-weight matching, but when several matchings have the same
+/// weight, the predicted observables may differ from those of decoding the whole shot. Only graphs without negative
+/// edge weights, and with at most 64 (=sizeof(pm::obs_int)*8) observables, are supported.
+class StreamingDecoder {
+   public:
+    /// Decodes using `mwpm', which must outlive the decoder, and must not be used for other decoding while a shot is in
+    /// progress. `detector_rounds[d]' is the round of detector d, for every detector of the graph. Throws
+    /// std::invalid_argument if the graph is not supported.
+    StreamingDecoder(Mwpm& mwpm, std::vector<uint32_t> detector_rounds);
+
+    /// Starts a new shot, abandoning the current one if it has not been finished.
+    void start_shot();
+    /// Adds the detection events of round `round', which must all be detectors of that round, and then floods up to
+    /// the new safe horizon. Each round is added at most once, in increasing order, and a round without detection events
+    /// may be skipped or added with no detection events (which lets the horizon advance). Throws std::invalid_argument
+    /// for a round that is not after the last one added, or for a detection event not in the round (in which case the
+    /// shot is abandoned).
+    void add_round(uint32_t round, std::span<const uint64_t> detection_events);
+    /// Floods the remaining events, and returns the solution for all the detection events added since `start_shot'.
+    /// Throws std::invalid_argument if no perfect matching can be found.
+    MatchingResult finish_shot();
+
+    /// Events at or after this time have not been processed yet (the largest time if every event has been).
+    cumulative_time_int safe_horizon() const;
+    /// The number of detection events added since `start_shot'.
+    size_t num_detection_events() const;
+
+   private:
+    /// A lower bound on when the region created at `node' (at time `created_at') can reach a node of a round after
+    /// `round'.
+    struct HorizonBound {
+        cumulative_time_int time;
+        cumulative_time_int created_at;
+        uint32_t round;
+        size_t node;
+
+        bool operator>(const HorizonBound& other) const {
+            return time > other.time;
+        }
+    };
+
+    Mwpm& mwpm;
+    /// Indexed by graph node.
+    std::vector<uint32_t> node_rounds;
+    bool shot_in_progress;
+    /// Whether a round has been added to the current shot, and the last one that was.
+    bool round_added;
+    uint32_t last_round;
+    cumulative_time_int horizon;
+    /// The (graph) node indices of the detection events of the current shot.
+    std::vector<uint64_t> sources;
+    /// A min-heap, with one bound per detection event.
+    std::vector<HorizonBound> bounds;
+
+    /// Scratch space for the Dijkstra searches, kept between calls to avoid reallocating it.
+    std::vector<cumulative_time_int> distances;
+    std::vector<size_t> touched_nodes;
+    std::vector<std::pair<cumulative_time_int, size_t>> heap;
+
+    /// Returns the graph node index of detector `detector', or SIZE_MAX if it is a boundary node.
+    size_t node_of_detector(uint64_t detector);
+    /// The distance from `node' to the nearest node of a round after `round', or the largest time if there is none.
+    cumulative_time_int distance_to_later_round(size_t node, uint32_t round);
+    /// Tightens the bounds until the smallest one is exact for the current round, and returns it.
+    cumulative_time_int compute_safe_horizon();
+    void abandon_shot();
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_STREAMING_DECODING_H
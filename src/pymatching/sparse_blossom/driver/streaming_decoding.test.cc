@@ -0,0 +1,89 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/streaming_decoding.h"
+
+#include <random>
+
+#include "gtest/gtest.h"
+
+#include "pymatching/sparse_blossom/driver/test_graphs.test.h"
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+
+TEST(StreamingDecoder, MatchesDecodingWholeShots) {
+    std::mt19937 rng(5);
+    size_t width = 8, height = 50;
+    auto graph = pm::grid_graph(width, height, rng);
+    auto& mwpm = graph.get_mwpm();
+    std::vector<uint32_t> rounds;
+    for (size_t node = 0; node < width * height; node++)
+        rounds.push_back(node / width);
+    pm::StreamingDecoder decoder(mwpm, rounds);
+
+    size_t num_processed_before_finishing = 0, num_processed = 0;
+    for (size_t shot = 0; shot < 200; shot++) {
+        std::vector<uint64_t> detection_events;
+        for (size_t node = 0; node < width * height; node++)
+            if (rng() % 12 == 0)
+                detection_events.push_back(node);
+
+        size_t start = mwpm.flooder.num_valid_dequeues;
+        decoder.start_shot();
+        auto it = detection_events.begin();
+        for (uint32_t round = 0; round < height; round++) {
+            auto end = it;
+            while (end != detection_events.end() && rounds[*end] == round)
+                end++;
+            // Leave out some of the rounds without detection events.
+            if (it != end || round % 3)
+                decoder.add_round(round, {it, end});
+            it = end;
+            ASSERT_LE(mwpm.flooder.queue.cur_time, decoder.safe_horizon());
+        }
+        ASSERT_EQ(decoder.num_detection_events(), detection_events.size());
+        num_processed_before_finishing += mwpm.flooder.num_valid_dequeues - start;
+        auto res = decoder.finish_shot();
+        num_processed += mwpm.flooder.num_valid_dequeues - start;
+
+        auto expected = pm::decode_detection_events_for_up_to_64_observables(mwpm, detection_events);
+        ASSERT_EQ(res.weight, expected.weight) << shot;
+    }
+    // Most of the flooding is done before the last round arrives.
+    ASSERT_GT(num_processed_before_finishing, num_processed / 2);
+}
+
+TEST(StreamingDecoder, RejectsRoundsOutOfOrder) {
+    std::mt19937 rng(1);
+    auto graph = pm::grid_graph(4, 5, rng);
+    auto& mwpm = graph.get_mwpm();
+    std::vector<uint32_t> rounds;
+    for (size_t node = 0; node < 20; node++)
+        rounds.push_back(node / 4);
+    pm::StreamingDecoder decoder(mwpm, rounds);
+    ASSERT_THROW(pm::StreamingDecoder(mwpm, {0, 1}), std::invalid_argument);
+
+    decoder.start_shot();
+    std::vector<uint64_t> round_2{8, 9};
+    decoder.add_round(2, round_2);
+    ASSERT_THROW(decoder.add_round(2, {}), std::invalid_argument);
+    ASSERT_THROW(decoder.add_round(1, {}), std::invalid_argument);
+    std::vector<uint64_t> wrong_round{4};
+    ASSERT_THROW(decoder.add_round(3, wrong_round), std::invalid_argument);
+
+    // The shot was abandoned, and the decoder and the Mwpm can still be used.
+    ASSERT_EQ(decoder.num_detection_events(), 0);
+    decoder.add_round(2, round_2);
+    auto res = decoder.finish_shot();
+    ASSERT_EQ(res, pm::decode_detection_events_for_up_to_64_observables(mwpm, round_2));
+}
@@ -0,0 +1,272 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+
+#include <stdexcept>
+#include <string>
+
+// The AVX2 and AVX-512 kernels are compiled with per-function target attributes, so that the rest of the library
+// doesn't need those instruction sets. MSVC has no equivalent, so only uses the portable kernel.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define PM_X86_SIMD_KERNELS 1
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#define PM_NEON_SIMD_KERNELS 1
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+using SetBitsKernel = void (*)(const uint8_t*, size_t, std::vector<uint64_t>&, uint64_t);
+using NonzeroBytesKernel = void (*)(const uint8_t*, size_t, std::vector<uint64_t>&);
+
+/// Appends the set bits of the 64-bit little-endian word at `bytes + j'.
+inline void append_set_bits_of_word(const uint8_t* bytes, size_t j, std::vector<uint64_t>& out, uint64_t index_offset) {
+    uint64_t word;
+    std::memcpy(&word, bytes + j, 8);
+    while (word) {
+        out.push_back(index_offset + (j << 3) + std::countr_zero(word));
+        word &= word - 1;
+    }
+}
+
+/// Appends the indices of the bits set in `mask', where bit k of `mask' stands for byte `j + k'.
+inline void append_mask_indices(uint64_t mask, size_t j, std::vector<uint64_t>& out) {
+    while (mask) {
+        out.push_back(j + std::countr_zero(mask));
+        mask &= mask - 1;
+    }
+}
+
+#ifdef PM_X86_SIMD_KERNELS
+
+__attribute__((target("avx2"))) void append_set_bit_indices_avx2(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out, uint64_t index_offset) {
+    size_t j = 0;
+    __m256i zero = _mm256_setzero_si256();
+    for (; j + 32 <= num_bytes; j += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + j));
+        if (_mm256_testz_si256(v, v))
+            continue;
+        uint32_t zero_words = (uint32_t)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(v, zero)));
+        uint32_t nonzero_words = ~zero_words & 0xF;
+        while (nonzero_words) {
+            append_set_bits_of_word(bytes, j + 8 * std::countr_zero(nonzero_words), out, index_offset);
+            nonzero_words &= nonzero_words - 1;
+        }
+    }
+    pm::append_set_bit_indices_portable(bytes + j, num_bytes - j, out, index_offset + (j << 3));
+}
+
+__attribute__((target("avx2"))) void append_nonzero_byte_indices_avx2(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out) {
+    size_t j = 0;
+    __m256i zero = _mm256_setzero_si256();
+    for (; j + 32 <= num_bytes; j += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + j));
+        uint32_t zero_bytes = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero));
+        append_mask_indices(~zero_bytes, j, out);
+    }
+    size_t first_tail = out.size();
+    pm::append_nonzero_byte_indices_portable(bytes + j, num_bytes - j, out);
+    for (size_t k = first_tail; k < out.size(); k++)
+        out[k] += j;
+}
+
+__attribute__((target("avx512f,avx512bw"))) void append_set_bit_indices_avx512(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out, uint64_t index_offset) {
+    size_t j = 0;
+    for (; j + 64 <= num_bytes; j += 64) {
+        __m512i v = _mm512_loadu_si512(bytes + j);
+        uint8_t nonzero_words = (uint8_t)_mm512_test_epi64_mask(v, v);
+        while (nonzero_words) {
+            append_set_bits_of_word(bytes, j + 8 * std::countr_zero(nonzero_words), out, index_offset);
+            nonzero_words &= nonzero_words - 1;
+        }
+    }
+    pm::append_set_bit_indices_portable(bytes + j, num_bytes - j, out, index_offset + (j << 3));
+}
+
+__attribute__((target("avx512f,avx512bw"))) void append_nonzero_byte_indices_avx512(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out) {
+    size_t j = 0;
+    for (; j + 64 <= num_bytes; j += 64) {
+        __m512i v = _mm512_loadu_si512(bytes + j);
+        append_mask_indices(_mm512_test_epi8_mask(v, v), j, out);
+    }
+    size_t first_tail = out.size();
+    pm::append_nonzero_byte_indices_portable(bytes + j, num_bytes - j, out);
+    for (size_t k = first_tail; k < out.size(); k++)
+        out[k] += j;
+}
+
+#endif
+
+#ifdef PM_NEON_SIMD_KERNELS
+
+void append_set_bit_indices_neon(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out, uint64_t index_offset) {
+    size_t j = 0;
+    for (; j + 16 <= num_bytes; j += 16) {
+        if (vmaxvq_u8(vld1q_u8(bytes + j)) == 0)
+            continue;
+        append_set_bits_of_word(bytes, j, out, index_offset);
+        append_set_bits_of_word(bytes, j + 8, out, index_offset);
+    }
+    pm::append_set_bit_indices_portable(bytes + j, num_bytes - j, out, index_offset + (j << 3));
+}
+
+void append_nonzero_byte_indices_neon(const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out) {
+    size_t j = 0;
+    for (; j + 16 <= num_bytes; j += 16) {
+        if (vmaxvq_u8(vld1q_u8(bytes + j)) == 0)
+            continue;
+        for (size_t k = j; k < j + 16; k++) {
+            if (bytes[k])
+                out.push_back(k);
+        }
+    }
+    size_t first_tail = out.size();
+    pm::append_nonzero_byte_indices_portable(bytes + j, num_bytes - j, out);
+    for (size_t k = first_tail; k < out.size(); k++)
+        out[k] += j;
+}
+
+#endif
+
+bool is_supported(pm::SimdKernel kernel) {
+    switch (kernel) {
+        case pm::SimdKernel::PORTABLE:
+            return true;
+#ifdef PM_X86_SIMD_KERNELS
+        case pm::SimdKernel::AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+        case pm::SimdKernel::AVX512:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+#endif
+#ifdef PM_NEON_SIMD_KERNELS
+        case pm::SimdKernel::NEON:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+struct SelectedKernels {
+    pm::SimdKernel kernel;
+    SetBitsKernel set_bits;
+    NonzeroBytesKernel nonzero_bytes;
+
+    explicit SelectedKernels(pm::SimdKernel kernel) : kernel(kernel) {
+        switch (kernel) {
+#ifdef PM_X86_SIMD_KERNELS
+            case pm::SimdKernel::AVX2:
+                set_bits = append_set_bit_indices_avx2;
+                nonzero_bytes = append_nonzero_byte_indices_avx2;
+                break;
+            case pm::SimdKernel::AVX512:
+                set_bits = append_set_bit_indices_avx512;
+                nonzero_bytes = append_nonzero_byte_indices_avx512;
+                break;
+#endif
+#ifdef PM_NEON_SIMD_KERNELS
+            case pm::SimdKernel::NEON:
+                set_bits = append_set_bit_indices_neon;
+                nonzero_bytes = append_nonzero_byte_indices_neon;
+                break;
+#endif
+            default:
+                set_bits = pm::append_set_bit_indices_portable;
+                nonzero_bytes = pm::append_nonzero_byte_indices_portable;
+                break;
+        }
+    }
+};
+
+/// The selected kernels, chosen when first used.
+SelectedKernels& selected_kernels() {
+    static SelectedKernels selected(pm::supported_simd_kernels().back());
+    return selected;
+}
+
+}  // namespace
+
+const char* pm::simd_kernel_name(SimdKernel kernel) {
+    switch (kernel) {
+        case SimdKernel::PORTABLE:
+            return "portable";
+        case SimdKernel::AVX2:
+            return "avx2";
+        case SimdKernel::AVX512:
+            return "avx512";
+        case SimdKernel::NEON:
+            return "neon";
+    }
+    return "unknown";
+}
+
+std::vector<pm::SimdKernel> pm::supported_simd_kernels() {
+    std::vector<SimdKernel> kernels;
+    for (auto kernel : {SimdKernel::PORTABLE, SimdKernel::AVX2, SimdKernel::AVX512, SimdKernel::NEON}) {
+        if (is_supported(kernel))
+            kernels.push_back(kernel);
+    }
+    return kernels;
+}
+
+pm::SimdKernel pm::get_simd_kernel() {
+    return selected_kernels().kernel;
+}
+
+void pm::set_simd_kernel(SimdKernel kernel) {
+    if (!is_supported(kernel))
+        throw std::invalid_argument(
+            std::string("The ") + simd_kernel_name(kernel) +
+            " syndrome extraction kernel isn't supported by this CPU.");
+    selected_kernels() = SelectedKernels(kernel);
+}
+
+void pm::append_set_bit_indices(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out, uint64_t index_offset) {
+    selected_kernels().set_bits(bytes, num_bytes, out, index_offset);
+}
+
+void pm::append_set_bit_indices_in_range(
+    const uint8_t* bytes, size_t begin_bit, size_t end_bit, std::vector<uint64_t>& out) {
+    if (begin_bit >= end_bit)
+        return;
+    size_t first_byte = begin_bit >> 3;
+    size_t end_byte = (end_bit + 7) >> 3;
+    size_t start = out.size();
+    append_set_bit_indices(bytes + first_byte, end_byte - first_byte, out, first_byte << 3);
+    // Only the first and last bytes can have set bits outside the range.
+    size_t keep_begin = start;
+    while (keep_begin < out.size() && out[keep_begin] < begin_bit)
+        keep_begin++;
+    size_t keep_end = out.size();
+    while (keep_end > keep_begin && out[keep_end - 1] >= end_bit)
+        keep_end--;
+    for (size_t k = keep_begin; k < keep_end; k++)
+        out[start + k - keep_begin] = out[k] - begin_bit;
+    out.resize(start + keep_end - keep_begin);
+}
+
+void pm::append_nonzero_byte_indices(const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out) {
+    selected_kernels().nonzero_bytes(bytes, num_bytes, out);
+}
@@ -0,0 +1,121 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SYNDROME_EXTRACTION_H
+#define PYMATCHING2_SYNDROME_EXTRACTION_H
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace pm {
+
+/// The versions of the syndrome extraction kernels. The library is built for the baseline instruction set of each
+/// platform (e.g. without AVX2 on x86-64, so that wheels run on any CPU), and the kernels for wider vector
+/// instruction sets are compiled separately and chosen at runtime, according to what the CPU supports.
+enum class SimdKernel : uint8_t {
+    /// Scans 64-bit words. Runs everywhere.
+    PORTABLE = 0,
+    /// Skips zero 32-byte blocks of the syndrome. x86-64 CPUs with AVX2.
+    AVX2 = 1,
+    /// Skips zero 64-byte blocks of the syndrome. x86-64 CPUs with AVX-512F and AVX-512BW.
+    AVX512 = 2,
+    /// Skips zero 16-byte blocks of the syndrome. All 64-bit ARM CPUs.
+    NEON = 3,
+};
+
+/// The name of `kernel', e.g. "avx2".
+const char* simd_kernel_name(SimdKernel kernel);
+/// The kernels that can run on this CPU, always including PORTABLE, from the least to the most preferred.
+std::vector<SimdKernel> supported_simd_kernels();
+/// The kernel used by `append_set_bit_indices' and `append_nonzero_byte_indices'. This is the most preferred
+/// supported kernel unless changed with `set_simd_kernel'.
+SimdKernel get_simd_kernel();
+/// Selects the kernel used from now on, e.g. to compare their speed. Throws std::invalid_argument if it isn't
+/// supported by this CPU. Not thread safe with respect to concurrent extraction.
+void set_simd_kernel(SimdKernel kernel);
+
+/// Appends `index_offset + k' to `out' for every set bit k of a little-endian bit-packed array of `num_bytes'
+/// bytes, in which bit k is `(bytes[k / 8] >> (k % 8)) & 1'. The indices are appended in increasing order.
+/// Uses the kernel selected by `get_simd_kernel'.
+void append_set_bit_indices(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out, uint64_t index_offset = 0);
+
+/// Appends `k - begin_bit' to `out' for every set bit k in [begin_bit, end_bit) of a little-endian bit-packed array,
+/// as for `append_set_bit_indices', e.g. to extract the detection events of one of several syndromes packed side by
+/// side in a row. The range needn't start or end on a byte boundary.
+void append_set_bit_indices_in_range(
+    const uint8_t* bytes, size_t begin_bit, size_t end_bit, std::vector<uint64_t>& out);
+
+/// Appends the index of every nonzero byte of an (unpacked) array of `num_bytes' bytes to `out', in increasing
+/// order. Uses the kernel selected by `get_simd_kernel'.
+void append_nonzero_byte_indices(const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out);
+
+/// The PORTABLE kernel of `append_set_bit_indices'.
+///
+/// At low error rates almost every word of a syndrome is zero, so the array is scanned a 64-bit word at a time,
+/// skipping zero words, and the set bits of each nonzero word are enumerated using std::countr_zero.
+inline void append_set_bit_indices_portable(
+    const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out, uint64_t index_offset = 0) {
+    size_t j = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        for (; j + 8 <= num_bytes; j += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + j, 8);
+            while (word) {
+                out.push_back(index_offset + (j << 3) + std::countr_zero(word));
+                word &= word - 1;
+            }
+        }
+    }
+    for (; j < num_bytes; j++) {
+        uint8_t b = bytes[j];
+        while (b) {
+            out.push_back(index_offset + (j << 3) + std::countr_zero(b));
+            b &= b - 1;
+        }
+    }
+}
+
+/// The PORTABLE kernel of `append_nonzero_byte_indices'. Like `append_set_bit_indices_portable', zero 64-bit words
+/// are skipped.
+inline void append_nonzero_byte_indices_portable(const uint8_t* bytes, size_t num_bytes, std::vector<uint64_t>& out) {
+    size_t j = 0;
+    if constexpr (std::endian::native == std::endian::little) {
+        for (; j + 8 <= num_bytes; j += 8) {
+            uint64_t word;
+            std::memcpy(&word, bytes + j, 8);
+            if (!word)
+                continue;
+            // Collapse each nonzero byte to its lowest bit.
+            word |= word >> 4;
+            word |= word >> 2;
+            word |= word >> 1;
+            word &= 0x0101010101010101ULL;
+            while (word) {
+                out.push_back(j + (std::countr_zero(word) >> 3));
+                word &= word - 1;
+            }
+        }
+    }
+    for (; j < num_bytes; j++) {
+        if (bytes[j])
+            out.push_back(j);
+    }
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SYNDROME_EXTRACTION_H
@@ -0,0 +1,134 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+
+#include "pymatching/perf/util.perf.h"
+
+namespace {
+
+/// A batch of bit-packed syndromes with roughly `p * num_detectors` detection events each.
+std::vector<uint8_t> random_bit_packed_shots(size_t num_shots, size_t num_bytes_per_shot, double p) {
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+    std::bernoulli_distribution flip(p);
+    std::vector<uint8_t> shots(num_shots * num_bytes_per_shot);
+    for (size_t k = 0; k < shots.size() * 8; k++) {
+        if (flip(rng))
+            shots[k >> 3] |= 1 << (k & 7);
+    }
+    return shots;
+}
+
+/// Times `append_set_bit_indices' with the kernel `kernel', or says that it was skipped if the CPU doesn't support it.
+void benchmark_bit_packed_extraction_with_kernel(pm::SimdKernel kernel) {
+    auto supported = pm::supported_simd_kernels();
+    if (std::find(supported.begin(), supported.end(), kernel) == supported.end()) {
+        std::cerr << "(skipped: the " << pm::simd_kernel_name(kernel) << " kernel isn't supported by this CPU) ";
+        return;
+    }
+    auto default_kernel = pm::get_simd_kernel();
+    pm::set_simd_kernel(kernel);
+    size_t num_shots = 1000;
+    size_t num_bytes_per_shot = 2000;
+    auto shots = random_bit_packed_shots(num_shots, num_bytes_per_shot, 0.001);
+
+    std::vector<uint64_t> detection_events;
+    size_t total = 0;
+    benchmark_go([&]() {
+        for (size_t i = 0; i < num_shots; i++) {
+            pm::append_set_bit_indices(shots.data() + i * num_bytes_per_shot, num_bytes_per_shot, detection_events);
+            total += detection_events.size();
+            detection_events.clear();
+        }
+    })
+        .goal_micros(400)
+        .show_rate("Shots", (double)num_shots);
+    pm::set_simd_kernel(default_kernel);
+    if (total == 0) {
+        std::cerr << "data dependence";
+    }
+}
+
+}  // namespace
+
+BENCHMARK(syndrome_extraction_bit_packed_d25_p1000) {
+    // Roughly the number of detectors of a distance 25 surface code memory experiment with 25 rounds.
+    size_t num_shots = 1000;
+    size_t num_bytes_per_shot = 2000;
+    auto shots = random_bit_packed_shots(num_shots, num_bytes_per_shot, 0.001);
+
+    std::vector<uint64_t> detection_events;
+    size_t total = 0;
+    benchmark_go([&]() {
+        for (size_t i = 0; i < num_shots; i++) {
+            pm::append_set_bit_indices(shots.data() + i * num_bytes_per_shot, num_bytes_per_shot, detection_events);
+            total += detection_events.size();
+            detection_events.clear();
+        }
+    })
+        .goal_micros(400)
+        .show_rate("Shots", (double)num_shots);
+    if (total == 0) {
+        std::cerr << "data dependence";
+    }
+}
+
+// The same extraction with each of the kernels that can be chosen at runtime.
+BENCHMARK(syndrome_extraction_bit_packed_d25_p1000_portable) {
+    benchmark_bit_packed_extraction_with_kernel(pm::SimdKernel::PORTABLE);
+}
+
+BENCHMARK(syndrome_extraction_bit_packed_d25_p1000_avx2) {
+    benchmark_bit_packed_extraction_with_kernel(pm::SimdKernel::AVX2);
+}
+
+BENCHMARK(syndrome_extraction_bit_packed_d25_p1000_avx512) {
+    benchmark_bit_packed_extraction_with_kernel(pm::SimdKernel::AVX512);
+}
+
+BENCHMARK(syndrome_extraction_bit_packed_d25_p1000_neon) {
+    benchmark_bit_packed_extraction_with_kernel(pm::SimdKernel::NEON);
+}
+
+BENCHMARK(syndrome_extraction_bit_by_bit_d25_p1000) {
+    // The scalar scan that `append_set_bit_indices` replaces, for comparison.
+    size_t num_shots = 1000;
+    size_t num_bytes_per_shot = 2000;
+    auto shots = random_bit_packed_shots(num_shots, num_bytes_per_shot, 0.001);
+
+    std::vector<uint64_t> detection_events;
+    size_t total = 0;
+    benchmark_go([&]() {
+        for (size_t i = 0; i < num_shots; i++) {
+            const uint8_t *shot = shots.data() + i * num_bytes_per_shot;
+            for (size_t j = 0; j < num_bytes_per_shot; j++) {
+                for (size_t r = 0; r < 8; r++) {
+                    if (shot[j] & (1 << r))
+                        detection_events.push_back((j << 3) + r);
+                }
+            }
+            total += detection_events.size();
+            detection_events.clear();
+        }
+    })
+        .goal_micros(10000)
+        .show_rate("Shots", (double)num_shots);
+    if (total == 0) {
+        std::cerr << "data dependence";
+    }
+}
@@ -0,0 +1,99 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+
+#include <algorithm>
+#include <random>
+
+#include "gtest/gtest.h"
+
+TEST(SyndromeExtraction, AppendSetBitIndices) {
+    std::vector<uint8_t> bytes = {0, 1, 0, 0, 0, 0, 0, 128, 0, 0, 0, 0, 0, 0, 0, 0, 255, 0, 6};
+    std::vector<uint64_t> out = {3};
+    pm::append_set_bit_indices(bytes.data(), bytes.size(), out);
+    ASSERT_EQ(
+        out, std::vector<uint64_t>({3, 8, 63, 128, 129, 130, 131, 132, 133, 134, 135, 145, 146}));
+    out.clear();
+    pm::append_set_bit_indices(bytes.data() + 1, 1, out, 100);
+    ASSERT_EQ(out, std::vector<uint64_t>({100}));
+    out.clear();
+    pm::append_set_bit_indices(bytes.data(), 0, out);
+    ASSERT_TRUE(out.empty());
+}
+
+TEST(SyndromeExtraction, AppendSetBitIndicesInRange) {
+    std::vector<uint8_t> bytes = {0xFF, 0x81, 0, 0, 0, 0, 0, 0, 0, 0, 0x0F};
+    std::vector<uint64_t> out = {3};
+    pm::append_set_bit_indices_in_range(bytes.data(), 5, 83, out);
+    ASSERT_EQ(out, std::vector<uint64_t>({3, 0, 1, 2, 3, 10, 75, 76, 77}));
+    out.clear();
+    pm::append_set_bit_indices_in_range(bytes.data(), 9, 15, out);
+    ASSERT_TRUE(out.empty());
+    pm::append_set_bit_indices_in_range(bytes.data(), 15, 15, out);
+    ASSERT_TRUE(out.empty());
+    pm::append_set_bit_indices_in_range(bytes.data(), 2, 4, out);
+    ASSERT_EQ(out, std::vector<uint64_t>({0, 1}));
+}
+
+TEST(SyndromeExtraction, AppendNonzeroByteIndices) {
+    std::vector<uint8_t> bytes = {0, 1, 0, 0, 0, 0, 0, 128, 0, 0, 0, 0, 0, 0, 0, 0, 255, 0, 6};
+    std::vector<uint64_t> out;
+    pm::append_nonzero_byte_indices(bytes.data(), bytes.size(), out);
+    ASSERT_EQ(out, std::vector<uint64_t>({1, 7, 16, 18}));
+}
+
+TEST(SyndromeExtraction, MatchesBitByBitScan) {
+    std::mt19937 rng(5);
+    auto default_kernel = pm::get_simd_kernel();
+    ASSERT_EQ(default_kernel, pm::supported_simd_kernels().back());
+    for (auto kernel : pm::supported_simd_kernels()) {
+        pm::set_simd_kernel(kernel);
+        // Long enough to cover several blocks of the widest kernel, and every length of the tail.
+        for (size_t num_bytes = 0; num_bytes < 200; num_bytes++) {
+            for (double p : {0.0, 0.002, 0.01, 0.2, 1.0}) {
+                std::vector<uint8_t> unpacked(num_bytes * 8);
+                std::vector<uint8_t> packed(num_bytes);
+                std::bernoulli_distribution flip(p);
+                std::vector<uint64_t> expected;
+                for (size_t k = 0; k < unpacked.size(); k++) {
+                    if (flip(rng)) {
+                        unpacked[k] = 1 + (k % 3);
+                        packed[k >> 3] |= 1 << (k & 7);
+                        expected.push_back(k);
+                    }
+                }
+                std::vector<uint64_t> from_packed;
+                pm::append_set_bit_indices(packed.data(), packed.size(), from_packed);
+                ASSERT_EQ(from_packed, expected) << pm::simd_kernel_name(kernel);
+                std::vector<uint64_t> from_unpacked;
+                pm::append_nonzero_byte_indices(unpacked.data(), unpacked.size(), from_unpacked);
+                ASSERT_EQ(from_unpacked, expected) << pm::simd_kernel_name(kernel);
+            }
+        }
+    }
+    pm::set_simd_kernel(default_kernel);
+}
+
+TEST(SyndromeExtraction, SetSimdKernel) {
+    auto supported = pm::supported_simd_kernels();
+    ASSERT_EQ(supported.front(), pm::SimdKernel::PORTABLE);
+    for (auto kernel : {pm::SimdKernel::PORTABLE, pm::SimdKernel::AVX2, pm::SimdKernel::AVX512, pm::SimdKernel::NEON}) {
+        if (std::find(supported.begin(), supported.end(), kernel) == supported.end()) {
+            ASSERT_THROW(pm::set_simd_kernel(kernel), std::invalid_argument);
+        }
+    }
+    // No CPU supports both the x86-64 and the ARM kernels.
+    ASSERT_LT(supported.size(), 4);
+}
@@ -0,0 +1,86 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef PYMATCHING2_TEST_GRAPHS_TEST_H
+#define PYMATCHING2_TEST_GRAPHS_TEST_H
+
+#include <random>
+#include <sstream>
+
+#include "pymatching/sparse_blossom/driver/user_graph.h"
+#include "stim.h"
+
+namespace pm {
+
+/// A repetition code memory experiment with `distance' data qubits and `num_rounds' rounds of `distance - 1'
+/// detectors, with data errors (flipping observable 0 on the first qubit) and measurement errors.
+inline stim::DetectorErrorModel repetition_code_memory_dem(size_t distance, size_t num_rounds) {
+    std::stringstream ss;
+    size_t n = distance - 1;
+    for (size_t r = 0; r < num_rounds; r++) {
+        for (size_t i = 0; i < n; i++)
+            ss << "detector(" << i << ", " << r << ") D" << r * n + i << "\n";
+    }
+    for (size_t r = 0; r < num_rounds; r++) {
+        size_t d = r * n;
+        ss << "error(0.01) D" << d << " L0\n";
+        for (size_t i = 0; i + 1 < n; i++)
+            ss << "error(0.01) D" << d + i << " D" << d + i + 1 << "\n";
+        ss << "error(0.01) D" << d + n - 1 << "\n";
+        if (r + 1 < num_rounds) {
+            for (size_t i = 0; i < n; i++)
+                ss << "error(0.02) D" << d + i << " D" << d + n + i << "\n";
+        }
+    }
+    return stim::DetectorErrorModel(ss.str().c_str());
+}
+
+/// A `width' x `height' grid of nodes, with boundary edges on the left and right sides and random weights. Row y is
+/// round y.
+inline UserGraph grid_graph(size_t width, size_t height, std::mt19937& rng) {
+    std::uniform_real_distribution<double> weight(1.0, 3.0);
+    UserGraph graph;
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            size_t node = y * width + x;
+            if (x + 1 < width)
+                graph.add_or_merge_edge(node, node + 1, {0}, weight(rng), -1);
+            if (y + 1 < height)
+                graph.add_or_merge_edge(node, node + width, {1}, weight(rng), -1);
+        }
+        graph.add_or_merge_boundary_edge(y * width, {2}, weight(rng), -1);
+        graph.add_or_merge_boundary_edge(y * width + width - 1, {3}, weight(rng), -1);
+    }
+    return graph;
+}
+
+/// A repetition code of `num_nodes' detectors with a boundary edge at each end. Edge k (the boundary edge of the first
+/// detector for k = 0, the edge between detectors k - 1 and k, and the boundary edge of the last detector for
+/// k = num_nodes) flips observable `k % num_observables', and has weight `1 + weight_step * (k % 3)'.
+inline UserGraph repetition_code_graph(size_t num_nodes, size_t num_observables, double weight_step = 1.0) {
+    UserGraph graph(num_nodes, num_observables);
+    for (size_t k = 0; k <= num_nodes; k++) {
+        double weight = 1.0 + weight_step * (double)(k % 3);
+        if (k == 0 || k == num_nodes)
+            graph.add_or_merge_boundary_edge(k == 0 ? 0 : k - 1, {k % num_observables}, weight, 0.1);
+        else
+            graph.add_or_merge_edge(k - 1, k, {k % num_observables}, weight, 0.1);
+    }
+    return graph;
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_TEST_GRAPHS_TEST_H
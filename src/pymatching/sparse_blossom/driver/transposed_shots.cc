@@ -0,0 +1,114 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/transposed_shots.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+/// Loads the `num_shots' (<= 64) bits of a detector starting at `bytes' as a little-endian word.
+inline uint64_t load_shot_bits(const uint8_t* bytes, size_t num_shots) {
+    uint64_t word = 0;
+    size_t num_bytes = (num_shots + 7) >> 3;
+    if constexpr (std::endian::native == std::endian::little) {
+        std::memcpy(&word, bytes, num_bytes);
+    } else {
+        for (size_t j = 0; j < num_bytes; j++)
+            word |= (uint64_t)bytes[j] << (8 * j);
+    }
+    if (num_shots < 64)
+        word &= (UINT64_C(1) << num_shots) - 1;
+    return word;
+}
+
+}  // namespace
+
+void pm::scatter_detector_major_bits(
+    const uint8_t* rows,
+    size_t row_stride,
+    size_t num_detectors,
+    size_t first_shot,
+    size_t num_shots,
+    std::vector<uint64_t>* shot_detection_events) {
+    const uint8_t* window = rows + (first_shot >> 3);
+    for (size_t d = 0; d < num_detectors; d++) {
+        uint64_t word = load_shot_bits(window + d * row_stride, num_shots);
+        while (word) {
+            shot_detection_events[std::countr_zero(word)].push_back(d);
+            word &= word - 1;
+        }
+    }
+}
+
+pm::Ptb64ShotReader::Ptb64ShotReader(FILE* file, size_t num_detectors, size_t num_appended_observables)
+    : file(file),
+      num_detectors(num_detectors),
+      num_appended_observables(num_appended_observables),
+      block((num_detectors + num_appended_observables) * 8),
+      next_shot_in_block(64) {
+}
+
+bool pm::Ptb64ShotReader::read_shot(stim::SparseShot& shot) {
+    if (next_shot_in_block == 64) {
+        size_t n = fread(block.data(), 1, block.size(), file);
+        if (n == 0)
+            return false;
+        if (n != block.size())
+            throw std::invalid_argument("ptb64 data ended in the middle of a block of 64 shots.");
+        for (auto& detection_events : block_detection_events)
+            detection_events.clear();
+        pm::scatter_detector_major_bits(block.data(), 8, num_detectors, 0, 64, block_detection_events.data());
+        next_shot_in_block = 0;
+    }
+    auto& detection_events = block_detection_events[next_shot_in_block];
+    shot.hits.insert(shot.hits.end(), detection_events.begin(), detection_events.end());
+    if (num_appended_observables > 0) {
+        if (num_appended_observables > shot.obs_mask.num_bits_padded())
+            shot.obs_mask = stim::simd_bits<stim::MAX_BITWORD_WIDTH>(num_appended_observables);
+        for (size_t k = 0; k < num_appended_observables; k++) {
+            if ((block[(num_detectors + k) * 8 + (next_shot_in_block >> 3)] >> (next_shot_in_block & 7)) & 1)
+                shot.obs_mask[k] = true;
+        }
+    }
+    next_shot_in_block++;
+    return true;
+}
+
+pm::Ptb64PredictionWriter::Ptb64PredictionWriter(FILE* file, size_t num_observables)
+    : file(file), words(num_observables, 0), num_shots_in_block(0) {
+}
+
+void pm::Ptb64PredictionWriter::write_shot(const uint8_t* obs_crossed) {
+    for (size_t k = 0; k < words.size(); k++)
+        words[k] |= (uint64_t)(obs_crossed[k] & 1) << num_shots_in_block;
+    if (++num_shots_in_block < 64)
+        return;
+    for (uint64_t word : words) {
+        uint8_t bytes[8];
+        for (size_t j = 0; j < 8; j++)
+            bytes[j] = (uint8_t)(word >> (8 * j));
+        fwrite(bytes, 1, 8, file);
+    }
+    std::fill(words.begin(), words.end(), 0);
+    num_shots_in_block = 0;
+}
+
+void pm::Ptb64PredictionWriter::finish() {
+    if (num_shots_in_block != 0)
+        throw std::invalid_argument("The ptb64 format requires the number of shots to be a multiple of 64.");
+}
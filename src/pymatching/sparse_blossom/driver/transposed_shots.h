@@ -0,0 +1,84 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_TRANSPOSED_SHOTS_H
+#define PYMATCHING2_TRANSPOSED_SHOTS_H
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "stim.h"
+
+namespace pm {
+
+/// Scatters a window of up to 64 shots of a detector-major (transposed) bit-packed table into the detection events
+/// of each shot.
+///
+/// In the table, the bit of detector d in shot k is `(rows[d * row_stride + k / 8] >> (k % 8)) & 1'. For each
+/// detector d < `num_detectors' and each shot k in [`first_shot', `first_shot' + `num_shots'), where `first_shot' is
+/// a multiple of 8 and `num_shots' <= 64, d is appended to `shot_detection_events[k - first_shot]' if its bit is set.
+/// Each detector's bits for the window are loaded as a single word and only its set bits are visited, so the cost
+/// is proportional to the number of detectors plus the number of detection events, and the detection events of each
+/// shot are appended in increasing order.
+void scatter_detector_major_bits(
+    const uint8_t* rows,
+    size_t row_stride,
+    size_t num_detectors,
+    size_t first_shot,
+    size_t num_shots,
+    std::vector<uint64_t>* shot_detection_events);
+
+/// Reads shots from a file in stim's `ptb64' format, in which each block of 64 shots is stored as one little-endian
+/// 64-bit word per bit of the record (the detectors, then any appended observables), holding that bit for each of
+/// the 64 shots. Each block is read with a single fread and scattered into the 64 shots with
+/// `scatter_detector_major_bits', rather than being transposed bit by bit.
+class Ptb64ShotReader {
+   public:
+    Ptb64ShotReader(FILE* file, size_t num_detectors, size_t num_appended_observables);
+
+    /// Reads the next shot into `shot', which should already have been cleared. Returns false once the file has
+    /// no more shots. Throws std::invalid_argument if the file ends in the middle of a block.
+    bool read_shot(stim::SparseShot& shot);
+
+   private:
+    FILE* file;
+    size_t num_detectors;
+    size_t num_appended_observables;
+    std::vector<uint8_t> block;
+    std::array<std::vector<uint64_t>, 64> block_detection_events;
+    size_t next_shot_in_block;
+};
+
+/// Writes predicted observables to a file in stim's `ptb64' format, buffering each block of 64 shots.
+class Ptb64PredictionWriter {
+   public:
+    Ptb64PredictionWriter(FILE* file, size_t num_observables);
+
+    /// Adds the predictions of the next shot, where `obs_crossed[k]' is 1 if observable k was flipped.
+    void write_shot(const uint8_t* obs_crossed);
+    /// Writes out the last block. Throws std::invalid_argument if the number of shots isn't a multiple of 64, which
+    /// the format requires.
+    void finish();
+
+   private:
+    FILE* file;
+    std::vector<uint64_t> words;
+    size_t num_shots_in_block;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_TRANSPOSED_SHOTS_H
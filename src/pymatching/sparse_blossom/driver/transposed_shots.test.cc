@@ -0,0 +1,129 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/driver/transposed_shots.h"
+
+#include <gtest/gtest.h>
+
+TEST(TransposedShots, ScatterDetectorMajorBits) {
+    // Three detectors and 80 shots, with a row stride of 10 bytes.
+    size_t num_shots = 80;
+    size_t stride = 10;
+    std::vector<uint8_t> rows(3 * stride, 0);
+    auto set_bit = [&](size_t d, size_t k) {
+        rows[d * stride + k / 8] |= 1 << (k % 8);
+    };
+    set_bit(0, 0);
+    set_bit(2, 0);
+    set_bit(1, 9);
+    set_bit(0, 63);
+    set_bit(1, 63);
+    set_bit(2, 64);
+    set_bit(0, 79);
+
+    std::vector<std::vector<uint64_t>> shots(num_shots);
+    pm::scatter_detector_major_bits(rows.data(), stride, 3, 0, 64, shots.data());
+    pm::scatter_detector_major_bits(rows.data(), stride, 3, 64, 16, shots.data() + 64);
+    for (size_t k = 0; k < num_shots; k++) {
+        std::vector<uint64_t> expected;
+        if (k == 0)
+            expected = {0, 2};
+        else if (k == 9)
+            expected = {1};
+        else if (k == 63)
+            expected = {0, 1};
+        else if (k == 64)
+            expected = {2};
+        else if (k == 79)
+            expected = {0};
+        ASSERT_EQ(shots[k], expected) << k;
+    }
+
+    // Bits past the end of a partial window are ignored.
+    std::vector<std::vector<uint64_t>> partial(8);
+    pm::scatter_detector_major_bits(rows.data(), stride, 3, 56, 7, partial.data());
+    for (const auto& detection_events : partial)
+        ASSERT_TRUE(detection_events.empty());
+}
+
+TEST(TransposedShots, Ptb64RoundTrip) {
+    size_t num_detectors = 3;
+    size_t num_observables = 2;
+    FILE* f = tmpfile();
+    // Two blocks of 64 shots. Shot k has detector k % 3 set, and observable 1 set if k is odd.
+    for (size_t block = 0; block < 2; block++) {
+        for (size_t bit = 0; bit < num_detectors + num_observables; bit++) {
+            uint8_t bytes[8] = {0};
+            for (size_t s = 0; s < 64; s++) {
+                size_t k = block * 64 + s;
+                bool value = bit < num_detectors ? k % 3 == bit : bit == num_detectors + 1 && k % 2 == 1;
+                if (value)
+                    bytes[s / 8] |= 1 << (s % 8);
+            }
+            fwrite(bytes, 1, 8, f);
+        }
+    }
+    rewind(f);
+
+    FILE* out = tmpfile();
+    pm::Ptb64ShotReader reader(f, num_detectors, num_observables);
+    pm::Ptb64PredictionWriter writer(out, num_observables);
+    stim::SparseShot shot;
+    size_t num_shots = 0;
+    while (true) {
+        shot.clear();
+        if (!reader.read_shot(shot))
+            break;
+        ASSERT_EQ(shot.hits, std::vector<uint64_t>{num_shots % 3});
+        ASSERT_EQ(shot.obs_mask_as_u64(), num_shots % 2 == 1 ? 2 : 0);
+        uint8_t obs_crossed[2] = {(uint8_t)(num_shots % 3 == 0), (uint8_t)(num_shots % 2)};
+        writer.write_shot(obs_crossed);
+        num_shots++;
+    }
+    ASSERT_EQ(num_shots, 128);
+    writer.finish();
+    fclose(f);
+
+    rewind(out);
+    std::vector<uint8_t> written(2 * num_observables * 8);
+    ASSERT_EQ(fread(written.data(), 1, written.size() + 1, out), written.size());
+    fclose(out);
+    for (size_t block = 0; block < 2; block++) {
+        for (size_t s = 0; s < 64; s++) {
+            size_t k = block * 64 + s;
+            for (size_t obs = 0; obs < num_observables; obs++) {
+                bool bit = (written[(block * num_observables + obs) * 8 + s / 8] >> (s % 8)) & 1;
+                ASSERT_EQ(bit, obs == 0 ? k % 3 == 0 : k % 2 == 1);
+            }
+        }
+    }
+}
+
+TEST(TransposedShots, Ptb64PartialBlocksThrow) {
+    FILE* f = tmpfile();
+    uint8_t bytes[4] = {1};
+    fwrite(bytes, 1, 4, f);
+    rewind(f);
+    pm::Ptb64ShotReader reader(f, 1, 0);
+    stim::SparseShot shot;
+    ASSERT_THROW(reader.read_shot(shot), std::invalid_argument);
+    fclose(f);
+
+    FILE* out = tmpfile();
+    pm::Ptb64PredictionWriter writer(out, 1);
+    uint8_t obs_crossed[1] = {1};
+    writer.write_shot(obs_crossed);
+    ASSERT_THROW(writer.finish(), std::invalid_argument);
+    fclose(out);
+}
@@ -14,23 +14,26 @@
 
 #include "pymatching/sparse_blossom/driver/user_graph.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <map>
+#include <thread>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+#include "pymatching/sparse_blossom/memory_bytes.h"
+#include "pymatching/sparse_blossom/search/search_shortest_paths.h"
+
 pm::UserNode::UserNode() : is_boundary(false) {
 }
 
-size_t pm::UserNode::index_of_neighbor(size_t node) const {
-    auto it = std::find_if(neighbors.begin(), neighbors.end(), [&](const UserNeighbor& neighbor) {
-        if (neighbor.pos == 0) {
-            return neighbor.edge_it->node1 == node;
-        } else if (neighbor.pos == 1) {
-            return neighbor.edge_it->node2 == node;
-        } else {
-            throw std::runtime_error("`neighbor.pos` should be 0 or 1, but got: " + std::to_string(neighbor.pos));
-        }
-    });
-    if (it == neighbors.end())
+size_t pm::UserGraph::index_of_edge(size_t node1, size_t node2) const {
+    check_edges_loaded();
+    auto it = _edge_index.find({std::min(node1, node2), std::max(node1, node2)});
+    if (it == _edge_index.end())
         return SIZE_MAX;
-
-    return it - neighbors.begin();
+    return it->second;
 }
 
 bool is_valid_probability(double p) {
@@ -38,22 +41,22 @@ bool is_valid_probability(double p) {
 }
 
 void pm::UserGraph::merge_edge_or_boundary_edge(
-    size_t node,
-    size_t neighbor_index,
+    size_t edge_index,
     const std::vector<size_t>& parallel_observables,
     double parallel_weight,
     double parallel_error_probability,
     pm::MERGE_STRATEGY merge_strategy) {
-    auto& neighbor = nodes[node].neighbors[neighbor_index];
+    check_not_frozen();
+    auto& edge = edges[edge_index];
     if (merge_strategy == DISALLOW) {
         throw std::invalid_argument(
-            "Edge (" + std::to_string(neighbor.edge_it->node1) + ", " + std::to_string(neighbor.edge_it->node2) +
+            "Edge (" + std::to_string(edge.node1) + ", " + std::to_string(edge.node2) +
             ") already exists in the graph. "
             "Parallel edges not permitted with the provided `disallow` `merge_strategy`. Please provide a "
             "different `merge_strategy`.");
     } else if (
         merge_strategy == KEEP_ORIGINAL ||
-        (merge_strategy == SMALLEST_WEIGHT && parallel_weight >= neighbor.edge_it->weight)) {
+        (merge_strategy == SMALLEST_WEIGHT && parallel_weight >= edge.weight)) {
         return;
     } else {
         double new_weight, new_error_probability;
@@ -63,24 +66,27 @@ void pm::UserGraph::merge_edge_or_boundary_edge(
             new_error_probability = parallel_error_probability;
             use_new_observables = true;
         } else if (merge_strategy == INDEPENDENT) {
-            new_weight = pm::merge_weights(parallel_weight, neighbor.edge_it->weight);
+            new_weight = pm::merge_weights(parallel_weight, edge.weight);
             new_error_probability = -1;
-            if (is_valid_probability(neighbor.edge_it->error_probability) &&
+            if (is_valid_probability(edge.error_probability) &&
                 is_valid_probability(parallel_error_probability))
-                new_error_probability = parallel_error_probability * (1 - neighbor.edge_it->error_probability) +
-                                        neighbor.edge_it->error_probability * (1 - parallel_error_probability);
+                new_error_probability = parallel_error_probability * (1 - edge.error_probability) +
+                                        edge.error_probability * (1 - parallel_error_probability);
             // We do not need to update the observables. If they do not match up, then the code has distance 2.
             use_new_observables = false;
         } else {
             throw std::invalid_argument("Merge strategy not recognised.");
         }
-        // Update the existing edge weight and probability in the adjacency list of `node`
-        neighbor.edge_it->weight = new_weight;
-        neighbor.edge_it->error_probability = new_error_probability;
+        const auto& new_observables = use_new_observables ? parallel_observables : edge.observable_indices;
+        if (!try_update_mwpm_edge_in_place(edge, new_observables, new_weight))
+            _mwpm_needs_updating = true;
+
+        // Update the existing edge weight and probability
+        edge.weight = new_weight;
+        edge.error_probability = new_error_probability;
         if (use_new_observables)
-            neighbor.edge_it->observable_indices = parallel_observables;
+            edge.observable_indices = parallel_observables;
 
-        _mwpm_needs_updating = true;
         if (new_error_probability < 0 || new_error_probability > 1)
             _all_edges_have_error_probabilities = false;
     }
@@ -93,18 +99,18 @@ void pm::UserGraph::add_or_merge_edge(
     double weight,
     double error_probability,
     MERGE_STRATEGY merge_strategy) {
+    check_not_frozen();
     auto max_id = std::max(node1, node2);
     if (max_id + 1 > nodes.size())
         nodes.resize(max_id + 1);
 
-    size_t idx = nodes[node1].index_of_neighbor(node2);
+    auto inserted = _edge_index.insert({{std::min(node1, node2), std::max(node1, node2)}, edges.size()});
 
-    if (idx == SIZE_MAX) {
-        pm::UserEdge edge = {node1, node2, observables, weight, error_probability};
-        edges.push_back(edge);
-        nodes[node1].neighbors.push_back({std::prev(edges.end()), 1});
+    if (inserted.second) {
+        edges.push_back({node1, node2, observables, weight, error_probability});
+        nodes[node1].neighbors.push_back({edges.size() - 1, 1});
         if (node1 != node2)
-            nodes[node2].neighbors.push_back({std::prev(edges.end()), 0});
+            nodes[node2].neighbors.push_back({edges.size() - 1, 0});
 
         for (auto& obs : observables) {
             if (obs + 1 > _num_observables)
@@ -114,7 +120,7 @@ void pm::UserGraph::add_or_merge_edge(
         if (error_probability < 0 || error_probability > 1)
             _all_edges_have_error_probabilities = false;
     } else {
-        merge_edge_or_boundary_edge(node1, idx, observables, weight, error_probability, merge_strategy);
+        merge_edge_or_boundary_edge(inserted.first->second, observables, weight, error_probability, merge_strategy);
     }
 }
 
@@ -124,15 +130,15 @@ void pm::UserGraph::add_or_merge_boundary_edge(
     double weight,
     double error_probability,
     MERGE_STRATEGY merge_strategy) {
+    check_not_frozen();
     if (node + 1 > nodes.size())
         nodes.resize(node + 1);
 
-    size_t idx = nodes[node].index_of_neighbor(SIZE_MAX);
+    auto inserted = _edge_index.insert({{node, SIZE_MAX}, edges.size()});
 
-    if (idx == SIZE_MAX) {
-        pm::UserEdge edge = {node, SIZE_MAX, observables, weight, error_probability};
-        edges.push_back(edge);
-        nodes[node].neighbors.push_back({std::prev(edges.end()), 1});
+    if (inserted.second) {
+        edges.push_back({node, SIZE_MAX, observables, weight, error_probability});
+        nodes[node].neighbors.push_back({edges.size() - 1, 1});
 
         for (auto& obs : observables) {
             if (obs + 1 > _num_observables)
@@ -142,25 +148,73 @@ void pm::UserGraph::add_or_merge_boundary_edge(
         if (error_probability < 0 || error_probability > 1)
             _all_edges_have_error_probabilities = false;
     } else {
-        merge_edge_or_boundary_edge(node, idx, observables, weight, error_probability, merge_strategy);
+        merge_edge_or_boundary_edge(inserted.first->second, observables, weight, error_probability, merge_strategy);
+    }
+}
+
+void pm::UserGraph::reserve_edges(size_t num_edges) {
+    check_not_frozen();
+    edges.reserve(num_edges);
+    _edge_index.reserve(num_edges);
+}
+
+void pm::UserGraph::add_or_merge_edges(const std::vector<UserEdge>& new_edges, MERGE_STRATEGY merge_strategy) {
+    reserve_edges(edges.size() + new_edges.size());
+    for (auto& e : new_edges) {
+        if (e.node2 == SIZE_MAX) {
+            add_or_merge_boundary_edge(e.node1, e.observable_indices, e.weight, e.error_probability, merge_strategy);
+        } else {
+            add_or_merge_edge(e.node1, e.node2, e.observable_indices, e.weight, e.error_probability, merge_strategy);
+        }
     }
 }
 
 pm::UserGraph::UserGraph()
-    : _num_observables(0), _mwpm_needs_updating(true), _all_edges_have_error_probabilities(true) {
+    : _num_observables(0),
+      _mwpm_needs_updating(true),
+      _all_edges_have_error_probabilities(true),
+      _mwpm_max_abs_weight(0),
+      _mwpm_all_weights_integral(true),
+      _syndrome_cache_capacity(0),
+      _num_path_threads(1),
+      _decoder_engine(pm::SPARSE_BLOSSOM),
+      _predecoder_mode(pm::PREDECODER_OFF),
+      _is_attached(false),
+      _num_attached_edges(0) {
 }
 
 pm::UserGraph::UserGraph(size_t num_nodes)
-    : _num_observables(0), _mwpm_needs_updating(true), _all_edges_have_error_probabilities(true) {
+    : _num_observables(0),
+      _mwpm_needs_updating(true),
+      _all_edges_have_error_probabilities(true),
+      _mwpm_max_abs_weight(0),
+      _mwpm_all_weights_integral(true),
+      _syndrome_cache_capacity(0),
+      _num_path_threads(1),
+      _decoder_engine(pm::SPARSE_BLOSSOM),
+      _predecoder_mode(pm::PREDECODER_OFF),
+      _is_attached(false),
+      _num_attached_edges(0) {
     nodes.resize(num_nodes);
 }
 
 pm::UserGraph::UserGraph(size_t num_nodes, size_t num_observables)
-    : _num_observables(num_observables), _mwpm_needs_updating(true), _all_edges_have_error_probabilities(true) {
+    : _num_observables(num_observables),
+      _mwpm_needs_updating(true),
+      _all_edges_have_error_probabilities(true),
+      _mwpm_max_abs_weight(0),
+      _mwpm_all_weights_integral(true),
+      _syndrome_cache_capacity(0),
+      _num_path_threads(1),
+      _decoder_engine(pm::SPARSE_BLOSSOM),
+      _predecoder_mode(pm::PREDECODER_OFF),
+      _is_attached(false),
+      _num_attached_edges(0) {
     nodes.resize(num_nodes);
 }
 
 void pm::UserGraph::set_boundary(const std::set<size_t>& boundary) {
+    check_not_frozen();
     for (auto& n : boundary_nodes)
         nodes[n].is_boundary = false;
     boundary_nodes = boundary;
@@ -192,9 +246,141 @@ bool pm::UserGraph::is_boundary_node(size_t node_id) {
     return (node_id == SIZE_MAX) || nodes[node_id].is_boundary;
 }
 
-void pm::UserGraph::update_mwpm() {
-    _mwpm = to_mwpm(pm::NUM_DISTINCT_WEIGHTS, false);
+void pm::UserGraph::rebuild_mwpm(bool ensure_search_graph_included) {
+    check_edges_loaded();
+    _mwpm = to_mwpm(pm::NUM_DISTINCT_WEIGHTS, ensure_search_graph_included);
+    _mwpm.syndrome_cache.set_capacity(_syndrome_cache_capacity);
+    _mwpm.set_num_path_threads(_num_path_threads);
+    _mwpm.set_decoder_engine(_decoder_engine);
+    _mwpm.predecoder.mode = _predecoder_mode;
+    _mwpm.work_budget = _work_budget;
+    _mwpm_needs_updating = false;
+    record_mwpm_weight_range();
+}
+
+void pm::UserGraph::set_mwpm(pm::Mwpm mwpm) {
+    check_not_frozen();
+    if (mwpm.flooder.graph.nodes.size() != nodes.size())
+        throw std::invalid_argument(
+            "The Mwpm has " + std::to_string(mwpm.flooder.graph.nodes.size()) + " nodes, but the graph has " +
+            std::to_string(nodes.size()) + " nodes.");
+    _mwpm = std::move(mwpm);
+    _mwpm.syndrome_cache.set_capacity(_syndrome_cache_capacity);
+    _mwpm.set_num_path_threads(_num_path_threads);
+    _mwpm.set_decoder_engine(_decoder_engine);
+    _mwpm.predecoder.mode = _predecoder_mode;
+    _mwpm.work_budget = _work_budget;
+    _mwpm_replicas.clear();
     _mwpm_needs_updating = false;
+    record_mwpm_weight_range();
+}
+
+void pm::UserGraph::record_mwpm_weight_range() {
+    _mwpm_max_abs_weight = 0;
+    _mwpm_all_weights_integral = true;
+    for (auto& e : edges) {
+        _mwpm_max_abs_weight = std::max(_mwpm_max_abs_weight, std::abs(e.weight));
+        if (round(e.weight) != e.weight)
+            _mwpm_all_weights_integral = false;
+    }
+}
+
+void pm::UserGraph::update_mwpm() {
+    rebuild_mwpm(false);
+    _mwpm_replicas.clear();
+}
+
+bool pm::UserGraph::try_update_mwpm_edge_in_place(
+    const UserEdge& edge, const std::vector<size_t>& new_observables, double new_weight) {
+    auto& graph = _mwpm.flooder.graph;
+    if (_mwpm_needs_updating || edge.node1 == edge.node2 || std::abs(new_weight) > pm::MAX_USER_EDGE_WEIGHT)
+        return false;
+    for (auto obs : new_observables) {
+        if (obs >= graph.num_observables)
+            return false;
+    }
+
+    // The normalising constant is 1 if all weights are integers, and otherwise is set by the largest absolute weight.
+    // If the only non-integral weight becomes integral the constant may change, which is not checked for here.
+    bool old_weight_is_integral = round(edge.weight) == edge.weight;
+    bool new_weight_is_integral = round(new_weight) == new_weight;
+    if (_mwpm_all_weights_integral) {
+        if (!new_weight_is_integral)
+            return false;
+    } else {
+        if (!old_weight_is_integral && new_weight_is_integral)
+            return false;
+        double old_abs_weight = std::abs(edge.weight);
+        double new_abs_weight = std::abs(new_weight);
+        if (new_abs_weight > _mwpm_max_abs_weight ||
+            (old_abs_weight == _mwpm_max_abs_weight && new_abs_weight != _mwpm_max_abs_weight))
+            return false;
+    }
+
+    bool node1_boundary = is_boundary_node(edge.node1);
+    bool node2_boundary = is_boundary_node(edge.node2);
+    if (node1_boundary && node2_boundary) {
+        // Edges between two boundary nodes are not in the matching graph.
+        return true;
+    }
+    size_t u = node1_boundary ? edge.node2 : edge.node1;
+    size_t v = node1_boundary || node2_boundary ? SIZE_MAX : edge.node2;
+    if (v == SIZE_MAX) {
+        // Only the smallest of parallel edges to the boundary is kept in the matching graph.
+        size_t num_boundary_edges = 0;
+        for (auto& neighbor : nodes[u].neighbors) {
+            auto& neighbor_edge = edges[neighbor.edge_index];
+            size_t other = neighbor.pos == 0 ? neighbor_edge.node1 : neighbor_edge.node2;
+            if (is_boundary_node(other))
+                num_boundary_edges++;
+        }
+        if (num_boundary_edges > 1)
+            return false;
+    }
+
+    // Discretize the weights in the same way as `iter_discretized_edges'.
+    double half_normalising_constant = graph.normalising_constant / 2;
+    auto discretize = [&](double weight) {
+        return 2 * (pm::signed_weight_int)round(weight * half_normalising_constant);
+    };
+    pm::signed_weight_int old_w = discretize(edge.weight);
+    pm::signed_weight_int new_w = discretize(new_weight);
+
+    // The replicas share the topology of `_mwpm', and are cheap to recreate.
+    // The search graph of `_mwpm' shares the topology too, and follows the change made by the matching graph.
+    _mwpm_replicas.clear();
+    graph.update_edge(u, v, old_w, edge.observable_indices, new_w, new_observables, false);
+    _mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+    if (_mwpm.search_flooder.graph.nodes.size() == graph.nodes.size()) {
+        _mwpm.search_flooder.graph.update_shared_edge(u, v, new_w, graph.topology);
+        _mwpm.search_flooder.handle_graph_weights_changed();
+    }
+    _mwpm.small_syndrome_cache.clear();
+    _mwpm.syndrome_cache.clear();
+    return true;
+}
+
+void pm::UserGraph::update_edge(
+    size_t node1, size_t node2, const std::vector<size_t>& observables, double weight, double error_probability) {
+    check_not_frozen();
+    size_t idx = index_of_edge(node1, node2);
+    if (idx == SIZE_MAX) {
+        throw std::invalid_argument(
+            "Edge (" + std::to_string(node1) + ", " + (node2 == SIZE_MAX ? "boundary" : std::to_string(node2)) +
+            ") is not in the graph.");
+    }
+    auto& edge = edges[idx];
+    if (!try_update_mwpm_edge_in_place(edge, observables, weight))
+        _mwpm_needs_updating = true;
+    edge.observable_indices = observables;
+    edge.weight = weight;
+    edge.error_probability = error_probability;
+    for (auto& obs : observables) {
+        if (obs + 1 > _num_observables)
+            _num_observables = obs + 1;
+    }
+    if (error_probability < 0 || error_probability > 1)
+        _all_edges_have_error_probabilities = false;
 }
 
 pm::Mwpm& pm::UserGraph::get_mwpm() {
@@ -204,6 +390,7 @@ pm::Mwpm& pm::UserGraph::get_mwpm() {
 }
 
 void pm::UserGraph::add_noise(uint8_t* error_arr, uint8_t* syndrome_arr) const {
+    check_edges_loaded();
     if (!_all_edges_have_error_probabilities)
         return;
 
@@ -225,15 +412,68 @@ void pm::UserGraph::add_noise(uint8_t* error_arr, uint8_t* syndrome_arr) const {
         *(syndrome_arr + b) = 0;
 }
 
+void pm::UserGraph::add_noise_batch(
+    size_t num_shots, uint64_t seed, uint8_t* syndromes, uint8_t* observables) const {
+    check_edges_loaded();
+    if (!_all_edges_have_error_probabilities)
+        throw std::invalid_argument("Not all edges have error probabilities, so noise cannot be sampled.");
+    size_t syndrome_bytes = (nodes.size() + 7) >> 3;
+    size_t observable_bytes = (_num_observables + 7) >> 3;
+    std::fill(syndromes, syndromes + num_shots * syndrome_bytes, 0);
+    std::fill(observables, observables + num_shots * observable_bytes, 0);
+
+    std::map<double, std::vector<size_t>> edges_by_probability;
+    for (size_t i = 0; i < edges.size(); i++) {
+        if (edges[i].error_probability > 0)
+            edges_by_probability[edges[i].error_probability].push_back(i);
+    }
+
+    pm::Xoshiro256PlusPlus rng(seed);
+    for (auto& [p, group] : edges_by_probability) {
+        // The trials of the group are numbered shot-major, and the gap to the next flipped edge is drawn directly.
+        uint64_t num_trials = (uint64_t)num_shots * group.size();
+        double log_q = std::log1p(-std::min(p, 1.0));
+        uint64_t trial = 0;
+        while (true) {
+            if (p < 1) {
+                double gap = std::floor(std::log(1 - rng.uniform_double()) / log_q);
+                if (gap >= (double)(num_trials - trial))
+                    break;
+                trial += (uint64_t)gap;
+            }
+            if (trial >= num_trials)
+                break;
+            const UserEdge& e = edges[group[trial % group.size()]];
+            size_t shot = trial / group.size();
+            uint8_t* syndrome = syndromes + shot * syndrome_bytes;
+            uint8_t* obs = observables + shot * observable_bytes;
+            for (auto o : e.observable_indices)
+                obs[o >> 3] ^= 1 << (o & 7);
+            syndrome[e.node1 >> 3] ^= 1 << (e.node1 & 7);
+            if (e.node2 != SIZE_MAX)
+                syndrome[e.node2 >> 3] ^= 1 << (e.node2 & 7);
+            trial++;
+        }
+    }
+
+    for (size_t shot = 0; shot < num_shots; shot++) {
+        uint8_t* syndrome = syndromes + shot * syndrome_bytes;
+        for (auto& b : boundary_nodes)
+            syndrome[b >> 3] &= ~(1 << (b & 7));
+    }
+}
+
 size_t pm::UserGraph::get_num_edges() {
-    return edges.size();
+    return _is_attached ? _num_attached_edges : edges.size();
 }
 
 bool pm::UserGraph::all_edges_have_error_probabilities() {
+    check_edges_loaded();
     return _all_edges_have_error_probabilities;
 }
 
 double pm::UserGraph::max_abs_weight() {
+    check_edges_loaded();
     double max_abs_weight = 0;
     for (auto& e : edges) {
         if (std::abs(e.weight) > max_abs_weight) {
@@ -257,6 +497,7 @@ pm::MatchingGraph pm::UserGraph::to_matching_graph(pm::weight_int num_distinct_w
     );
 
     matching_graph.normalising_constant = normalising_constant;
+    matching_graph.compact_topology();
     if (boundary_nodes.size() > 0) {
         matching_graph.is_user_graph_boundary_node.clear();
         matching_graph.is_user_graph_boundary_node.resize(nodes.size(), false);
@@ -266,31 +507,23 @@ pm::MatchingGraph pm::UserGraph::to_matching_graph(pm::weight_int num_distinct_w
     return matching_graph;
 }
 
-pm::SearchGraph pm::UserGraph::to_search_graph(pm::weight_int num_distinct_weights) {
-    /// Identical to to_matching_graph but for constructing a pm::SearchGraph
-    pm::SearchGraph search_graph(nodes.size());
-
-    to_matching_or_search_graph_helper(
-        num_distinct_weights,
-        [&](size_t u, size_t v, pm::signed_weight_int weight, const std::vector<size_t>& observables) {
-            search_graph.add_edge(u, v, weight, observables);
-        },
-        [&](size_t u, pm::signed_weight_int weight, const std::vector<size_t>& observables) {
-            search_graph.add_boundary_edge(u, weight, observables);
-        }
-    );
-    return search_graph;
+pm::SearchGraph pm::UserGraph::to_search_graph(
+    const pm::MatchingGraph& matching_graph, pm::weight_int num_distinct_weights) {
+    return pm::search_graph_sharing_edges(
+        matching_graph, [&](const auto& handle_edge, const auto& handle_boundary_edge) {
+            to_matching_or_search_graph_helper(num_distinct_weights, handle_edge, handle_boundary_edge);
+        });
 }
 
 pm::Mwpm pm::UserGraph::to_mwpm(pm::weight_int num_distinct_weights, bool ensure_search_graph_included) {
+    auto matching_graph = to_matching_graph(num_distinct_weights);
     if (_num_observables > sizeof(pm::obs_int) * 8 || ensure_search_graph_included) {
-        auto mwpm = pm::Mwpm(
-            pm::GraphFlooder(to_matching_graph(num_distinct_weights)),
-            pm::SearchFlooder(to_search_graph(num_distinct_weights)));
+        auto search_graph = to_search_graph(matching_graph, num_distinct_weights);
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(matching_graph)), pm::SearchFlooder(std::move(search_graph)));
         mwpm.flooder.sync_negative_weight_observables_and_detection_events();
         return mwpm;
     } else {
-        auto mwpm = pm::Mwpm(pm::GraphFlooder(to_matching_graph(num_distinct_weights)));
+        auto mwpm = pm::Mwpm(pm::GraphFlooder(std::move(matching_graph)));
         mwpm.flooder.sync_negative_weight_observables_and_detection_events();
         return mwpm;
     }
@@ -300,12 +533,328 @@ pm::Mwpm& pm::UserGraph::get_mwpm_with_search_graph() {
     if (!_mwpm_needs_updating && _mwpm.flooder.graph.nodes.size() == _mwpm.search_flooder.graph.nodes.size()) {
         return _mwpm;
     } else {
-        _mwpm = to_mwpm(pm::NUM_DISTINCT_WEIGHTS, true);
-        _mwpm_needs_updating = false;
+        if (_mwpm_needs_updating)
+            _mwpm_replicas.clear();
+        rebuild_mwpm(true);
         return _mwpm;
     }
 }
 
+std::vector<pm::Mwpm*> pm::UserGraph::get_mwpms(size_t num_mwpms) {
+    check_not_frozen();
+    std::vector<pm::Mwpm*> mwpms;
+    if (num_mwpms == 0)
+        return mwpms;
+    mwpms.push_back(&get_mwpm());
+    if (_mwpm_replicas.size() < num_mwpms - 1) {
+        _mwpm_replicas.reserve(num_mwpms - 1);
+        auto& mwpm = *mwpms[0];
+        while (_mwpm_replicas.size() < num_mwpms - 1) {
+            // Each replica shares the (read-only) topology of the matching graph, and only holds its own
+            // ephemeral state. The search graph is only needed when there are too many observables for obs_int.
+            pm::GraphFlooder flooder(mwpm.flooder.graph.clone_sharing_topology());
+            if (_num_observables > sizeof(pm::obs_int) * 8) {
+                _mwpm_replicas.emplace_back(
+                    std::move(flooder), pm::SearchFlooder(mwpm.search_flooder.graph.clone_sharing_topology()));
+            } else {
+                _mwpm_replicas.emplace_back(std::move(flooder));
+            }
+            _mwpm_replicas.back().flooder.sync_negative_weight_observables_and_detection_events();
+            _mwpm_replicas.back().syndrome_cache.set_capacity(_syndrome_cache_capacity);
+            _mwpm_replicas.back().set_num_path_threads(_num_path_threads);
+            _mwpm_replicas.back().set_decoder_engine(_decoder_engine);
+            _mwpm_replicas.back().predecoder.mode = _predecoder_mode;
+            _mwpm_replicas.back().work_budget = _work_budget;
+        }
+    }
+    if (num_mwpms > 1)
+        mwpms[0]->small_syndrome_cache.precompute_all_pairs_paths(mwpms[0]->flooder.graph);
+    for (size_t i = 0; i < num_mwpms - 1; i++) {
+        _mwpm_replicas[i].small_syndrome_cache.boundary_distances = mwpms[0]->small_syndrome_cache.boundary_distances;
+        _mwpm_replicas[i].small_syndrome_cache.all_pairs_paths = mwpms[0]->small_syndrome_cache.all_pairs_paths;
+        mwpms.push_back(&_mwpm_replicas[i]);
+    }
+    return mwpms;
+}
+
+const pm::BoundaryDistances& pm::UserGraph::get_boundary_distances() {
+    auto& mwpm = get_mwpm();
+    return mwpm.small_syndrome_cache.precompute_boundary_distances(mwpm.flooder.graph);
+}
+
+pm::MwpmLease::MwpmLease(pm::Mwpm& mwpm) : mwpm(&mwpm) {
+}
+
+pm::MwpmLease::MwpmLease(std::shared_ptr<MwpmPool> pool, std::unique_ptr<Mwpm> mwpm)
+    : mwpm(mwpm.get()), pool(std::move(pool)), owned_mwpm(std::move(mwpm)) {
+}
+
+pm::MwpmLease::~MwpmLease() {
+    if (pool && owned_mwpm) {
+        std::lock_guard<std::mutex> lock(pool->mutex);
+        pool->idle_mwpms.push_back(std::move(owned_mwpm));
+    }
+}
+
+void pm::UserGraph::check_not_frozen() const {
+    if (_mwpm_pool)
+        throw std::invalid_argument(
+            "The graph is frozen, so it can't be modified, and its weights can't be overridden while decoding.");
+}
+
+void pm::UserGraph::freeze() {
+    if (_mwpm_pool)
+        return;
+    get_mwpm_with_search_graph();
+    get_boundary_distances();
+    _mwpm.small_syndrome_cache.precompute_all_pairs_paths(_mwpm.flooder.graph);
+    _mwpm_replicas.clear();
+    _mwpm_pool = std::make_shared<MwpmPool>();
+}
+
+bool pm::UserGraph::is_frozen() const {
+    return _mwpm_pool != nullptr;
+}
+
+pm::MwpmLease pm::UserGraph::acquire_mwpm(bool ensure_search_graph_included) {
+    if (!_mwpm_pool)
+        return MwpmLease(ensure_search_graph_included ? get_mwpm_with_search_graph() : get_mwpm());
+    {
+        std::lock_guard<std::mutex> lock(_mwpm_pool->mutex);
+        if (!_mwpm_pool->idle_mwpms.empty()) {
+            auto mwpm = std::move(_mwpm_pool->idle_mwpms.back());
+            _mwpm_pool->idle_mwpms.pop_back();
+            return MwpmLease(_mwpm_pool, std::move(mwpm));
+        }
+    }
+    // The graph can't change once frozen, so the new Mwpm is built (without holding the lock) only by reading it and
+    // `_mwpm', which is never itself used for decoding. Like the replicas of `get_mwpms', it shares the topology of
+    // the matching graph, and the boundary distances and guided search landmarks, of `_mwpm'.
+    return MwpmLease(_mwpm_pool, build_pooled_mwpm(_mwpm.flooder.graph.topology));
+}
+
+void pm::UserGraph::attach_mwpm(pm::Mwpm mwpm, size_t num_edges) {
+    if (!edges.empty())
+        throw std::invalid_argument("A Mwpm can only be attached to a graph with no edges.");
+    set_mwpm(std::move(mwpm));
+    _is_attached = true;
+    _num_attached_edges = num_edges;
+    freeze();
+}
+
+bool pm::UserGraph::is_attached() const {
+    return _is_attached;
+}
+
+void pm::UserGraph::check_edges_loaded() const {
+    if (_is_attached)
+        throw std::invalid_argument(
+            "The graph was attached to a graph file without loading its edges, so they can't be read. Load the "
+            "graph file instead to use them.");
+}
+
+std::shared_ptr<pm::MatchingGraphTopology> pm::UserGraph::copy_frozen_topology(pm::HugePagePolicy huge_pages) const {
+    if (!_mwpm_pool)
+        throw std::invalid_argument("The topology of a graph can only be copied once it is frozen.");
+    return std::make_shared<pm::MatchingGraphTopology>(_mwpm.flooder.graph.topology->copy_with_huge_pages(huge_pages));
+}
+
+pm::MwpmLease pm::UserGraph::acquire_mwpm_on_topology(std::shared_ptr<MatchingGraphTopology> topology) {
+    if (!_mwpm_pool)
+        throw std::invalid_argument("A Mwpm can only be built on a copy of the topology of a frozen graph.");
+    return MwpmLease(_mwpm_pool, build_pooled_mwpm(topology));
+}
+
+std::unique_ptr<pm::Mwpm> pm::UserGraph::build_pooled_mwpm(
+    const std::shared_ptr<MatchingGraphTopology>& topology) const {
+    auto matching_graph = _mwpm.flooder.graph.clone_sharing_topology();
+    auto search_graph = _mwpm.search_flooder.graph.clone_sharing_topology();
+    if (topology != matching_graph.topology) {
+        // The search graph only reads the copy if it shares the topology of the matching graph.
+        if (search_graph.topology == matching_graph.topology)
+            search_graph.set_topology(topology);
+        matching_graph.set_topology(topology);
+    }
+    auto mwpm = std::make_unique<pm::Mwpm>(
+        pm::GraphFlooder(std::move(matching_graph)), pm::SearchFlooder(std::move(search_graph)));
+    mwpm->flooder.sync_negative_weight_observables_and_detection_events();
+    mwpm->small_syndrome_cache.boundary_distances = _mwpm.small_syndrome_cache.boundary_distances;
+    mwpm->small_syndrome_cache.all_pairs_paths = _mwpm.small_syndrome_cache.all_pairs_paths;
+    mwpm->small_syndrome_cache.enabled = _mwpm.small_syndrome_cache.enabled;
+    mwpm->search_flooder.landmarks = _mwpm.search_flooder.landmarks;
+    mwpm->search_flooder.path_cache.set_capacity(_mwpm.search_flooder.path_cache.capacity());
+    mwpm->syndrome_cache.set_capacity(_syndrome_cache_capacity);
+    mwpm->set_num_path_threads(_num_path_threads);
+    mwpm->set_decoder_engine(_decoder_engine);
+    mwpm->predecoder.mode = _predecoder_mode;
+    mwpm->work_budget = _work_budget;
+    return mwpm;
+}
+
+void pm::UserGraph::set_syndrome_cache_capacity(size_t capacity) {
+    check_not_frozen();
+    _syndrome_cache_capacity = capacity;
+    _mwpm.syndrome_cache.set_capacity(capacity);
+    for (auto& replica : _mwpm_replicas)
+        replica.syndrome_cache.set_capacity(capacity);
+}
+
+size_t pm::UserGraph::get_syndrome_cache_capacity() const {
+    return _syndrome_cache_capacity;
+}
+
+void pm::UserGraph::set_num_path_threads(size_t num_threads) {
+    check_not_frozen();
+    if (num_threads == 0)
+        throw std::invalid_argument("The number of path threads must be at least 1.");
+    _num_path_threads = num_threads;
+    _mwpm.set_num_path_threads(num_threads);
+    for (auto& replica : _mwpm_replicas)
+        replica.set_num_path_threads(num_threads);
+}
+
+size_t pm::UserGraph::get_num_path_threads() const {
+    return _num_path_threads;
+}
+
+void pm::UserGraph::set_decoder_engine(pm::DecoderEngine engine) {
+    check_not_frozen();
+    _decoder_engine = engine;
+    _mwpm.set_decoder_engine(engine);
+    for (auto& replica : _mwpm_replicas)
+        replica.set_decoder_engine(engine);
+}
+
+pm::DecoderEngine pm::UserGraph::get_decoder_engine() const {
+    return _decoder_engine;
+}
+
+void pm::UserGraph::set_predecoder_mode(pm::PredecoderMode mode) {
+    check_not_frozen();
+    _predecoder_mode = mode;
+    _mwpm.predecoder.mode = mode;
+    for (auto& replica : _mwpm_replicas)
+        replica.predecoder.mode = mode;
+}
+
+pm::PredecoderMode pm::UserGraph::get_predecoder_mode() const {
+    return _predecoder_mode;
+}
+
+void pm::UserGraph::set_work_budget(pm::WorkBudget budget) {
+    check_not_frozen();
+    _work_budget = budget;
+    _mwpm.work_budget = budget;
+    for (auto& replica : _mwpm_replicas)
+        replica.work_budget = budget;
+}
+
+pm::WorkBudget pm::UserGraph::get_work_budget() const {
+    return _work_budget;
+}
+
+uint64_t pm::UserGraph::get_num_degraded_shots() {
+    uint64_t count = _mwpm.num_degraded_shots;
+    for (auto& replica : _mwpm_replicas)
+        count += replica.num_degraded_shots;
+    if (_mwpm_pool) {
+        std::lock_guard<std::mutex> lock(_mwpm_pool->mutex);
+        for (auto& mwpm : _mwpm_pool->idle_mwpms)
+            count += mwpm->num_degraded_shots;
+    }
+    return count;
+}
+
+std::pair<uint64_t, uint64_t> pm::UserGraph::get_syndrome_cache_counts() {
+    std::pair<uint64_t, uint64_t> counts{0, 0};
+    auto add_counts = [&](const pm::Mwpm& mwpm) {
+        counts.first += mwpm.syndrome_cache.num_hits;
+        counts.second += mwpm.syndrome_cache.num_misses;
+    };
+    add_counts(_mwpm);
+    for (auto& replica : _mwpm_replicas)
+        add_counts(replica);
+    if (_mwpm_pool) {
+        std::lock_guard<std::mutex> lock(_mwpm_pool->mutex);
+        for (auto& mwpm : _mwpm_pool->idle_mwpms)
+            add_counts(*mwpm);
+    }
+    return counts;
+}
+
+pm::UserGraphMemoryUsage pm::UserGraph::get_memory_usage() {
+    pm::UserGraphMemoryUsage usage;
+    usage.user_graph = pm::memory_bytes(nodes) + pm::memory_bytes(edges) + pm::memory_bytes(boundary_nodes) +
+                       pm::memory_bytes(_edge_index) + edge_correlations.memory_bytes();
+    for (const auto& node : nodes)
+        usage.user_graph += pm::memory_bytes(node.neighbors);
+    for (const auto& edge : edges)
+        usage.user_graph += pm::memory_bytes(edge.observable_indices);
+
+    std::unordered_set<const void*> counted_shared;
+    auto add_usage = [&](const pm::Mwpm& mwpm) {
+        if (mwpm.flooder.graph.nodes.empty())
+            return;
+        usage.mwpms += mwpm.memory_usage(counted_shared);
+        usage.num_mwpms++;
+        usage.max_capacity.include(mwpm.capacity());
+    };
+    add_usage(_mwpm);
+    for (auto& replica : _mwpm_replicas)
+        add_usage(replica);
+    if (_mwpm_pool) {
+        std::lock_guard<std::mutex> lock(_mwpm_pool->mutex);
+        for (auto& mwpm : _mwpm_pool->idle_mwpms)
+            add_usage(*mwpm);
+    }
+    return usage;
+}
+
+pm::MwpmCapacity pm::UserGraph::warm_up(
+    size_t num_mwpms, size_t num_shots, size_t expected_detection_events, uint64_t seed) {
+    size_t syndrome_bytes = (get_num_nodes() + 7) >> 3;
+    std::vector<uint8_t> syndromes(num_shots * syndrome_bytes);
+    std::vector<uint8_t> observables(num_shots * ((_num_observables + 7) >> 3));
+    if (num_shots > 0)
+        add_noise_batch(num_shots, seed, syndromes.data(), observables.data());
+
+    // The leases of a frozen graph are all held at once, so that each is a different Mwpm of the pool.
+    std::vector<pm::MwpmLease> leases;
+    std::vector<pm::Mwpm*> mwpms;
+    if (is_frozen()) {
+        for (size_t k = 0; k < num_mwpms; k++) {
+            leases.push_back(acquire_mwpm());
+            mwpms.push_back(&*leases.back());
+        }
+    } else if (num_mwpms > 0) {
+        mwpms = get_mwpms(num_mwpms);
+    }
+
+    pm::MwpmCapacity result;
+    std::vector<uint64_t> detection_events;
+    std::vector<uint8_t> obs(_num_observables);
+    for (auto mwpm : mwpms) {
+        mwpm->reserve(expected_detection_events);
+        auto stats = mwpm->flooder.stats;
+        auto num_hits = mwpm->syndrome_cache.num_hits;
+        auto num_misses = mwpm->syndrome_cache.num_misses;
+        auto num_degraded_shots = mwpm->num_degraded_shots;
+        for (size_t i = 0; i < num_shots; i++) {
+            detection_events.clear();
+            pm::append_set_bit_indices(syndromes.data() + i * syndrome_bytes, syndrome_bytes, detection_events);
+            pm::total_weight_int weight = 0;
+            std::fill(obs.begin(), obs.end(), 0);
+            pm::decode_detection_events(*mwpm, detection_events, obs.data(), weight);
+        }
+        mwpm->flooder.stats = stats;
+        mwpm->syndrome_cache.num_hits = num_hits;
+        mwpm->syndrome_cache.num_misses = num_misses;
+        mwpm->num_degraded_shots = num_degraded_shots;
+        result.include(mwpm->capacity());
+    }
+    return result;
+}
+
 void pm::UserGraph::handle_dem_instruction(
     double p, const std::vector<size_t>& detectors, const std::vector<size_t>& observables) {
     if (detectors.size() == 2) {
@@ -316,7 +865,8 @@ void pm::UserGraph::handle_dem_instruction(
 }
 
 void pm::UserGraph::get_nodes_on_shortest_path_from_source(size_t src, size_t dst, std::vector<size_t>& out_nodes) {
-    auto& mwpm = get_mwpm_with_search_graph();
+    auto mwpm_lease = acquire_mwpm(true);
+    auto& mwpm = *mwpm_lease;
     bool src_is_boundary = is_boundary_node(src);
     bool dst_is_boundary = is_boundary_node(dst);
     if (src != SIZE_MAX && src >= nodes.size())
@@ -341,24 +891,510 @@ void pm::UserGraph::get_nodes_on_shortest_path_from_source(size_t src, size_t ds
     }
 }
 
-bool pm::UserGraph::has_edge(size_t node1, size_t node2) {
-    if (node1 >= nodes.size())
+pm::ShortestPaths pm::UserGraph::get_shortest_paths(
+    const std::vector<size_t>& sources, const std::vector<size_t>& targets, size_t num_threads) {
+    if (sources.size() != targets.size())
+        throw std::invalid_argument("The number of sources and the number of targets must be equal.");
+    size_t num_pairs = sources.size();
+    std::vector<size_t> source_of(num_pairs);
+    std::vector<size_t> target_of(num_pairs);
+    for (size_t i = 0; i < num_pairs; i++) {
+        for (auto node : {sources[i], targets[i]}) {
+            if (node != SIZE_MAX && node >= nodes.size())
+                throw std::invalid_argument("node " + std::to_string(node) + " is not in the graph");
+        }
+        source_of[i] = is_boundary_node(sources[i]) ? SIZE_MAX : sources[i];
+        target_of[i] = is_boundary_node(targets[i]) ? SIZE_MAX : targets[i];
+        if (source_of[i] == SIZE_MAX && target_of[i] == SIZE_MAX)
+            throw std::invalid_argument("Both the source and destination vertices provided are boundary nodes");
+    }
+
+    // The pairs sharing a source are consecutive in `order', and each group is handled by one search.
+    std::vector<size_t> order(num_pairs);
+    for (size_t i = 0; i < num_pairs; i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return source_of[a] < source_of[b];
+    });
+    std::vector<size_t> group_starts;
+    for (size_t k = 0; k < num_pairs; k++) {
+        if (k == 0 || source_of[order[k]] != source_of[order[k - 1]])
+            group_starts.push_back(k);
+    }
+    group_starts.push_back(num_pairs);
+    size_t num_groups = group_starts.size() - 1;
+
+    auto mwpm_lease = acquire_mwpm(true);
+    auto& search_graph = mwpm_lease->search_flooder.graph;
+    double normalising_constant = mwpm_lease->flooder.graph.normalising_constant;
+    std::vector<std::vector<size_t>> paths(num_pairs);
+    ShortestPaths result;
+    result.distances.resize(num_pairs);
+
+    // The search graph is only read, so each thread grows its own tree over it.
+    std::atomic<size_t> next_group{0};
+    auto find_paths_of_groups = [&]() {
+        pm::SearchShortestPathTree tree(search_graph);
+        std::vector<size_t> group_targets;
+        size_t g;
+        while ((g = next_group++) < num_groups) {
+            group_targets.clear();
+            for (size_t k = group_starts[g]; k < group_starts[g + 1]; k++)
+                group_targets.push_back(target_of[order[k]]);
+            tree.grow(source_of[order[group_starts[g]]], group_targets);
+            for (size_t k = group_starts[g]; k < group_starts[g + 1]; k++) {
+                size_t i = order[k];
+                auto distance = tree.distance_to(target_of[i]);
+                if (distance == pm::SearchShortestPathTree::UNREACHABLE) {
+                    result.distances[i] = std::numeric_limits<double>::infinity();
+                } else {
+                    result.distances[i] = (double)distance / normalising_constant;
+                    tree.append_path_to(target_of[i], paths[i]);
+                }
+            }
+        }
+    };
+    size_t num_workers = std::max<size_t>(1, std::min(num_threads, num_groups));
+    if (num_workers == 1) {
+        find_paths_of_groups();
+    } else {
+        std::vector<std::exception_ptr> errors(num_workers);
+        std::vector<std::thread> workers;
+        workers.reserve(num_workers);
+        for (size_t w = 0; w < num_workers; w++) {
+            workers.emplace_back([&, w]() {
+                try {
+                    find_paths_of_groups();
+                } catch (...) {
+                    errors[w] = std::current_exception();
+                }
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+        for (auto& error : errors) {
+            if (error)
+                std::rethrow_exception(error);
+        }
+    }
+
+    result.offsets.reserve(num_pairs + 1);
+    result.offsets.push_back(0);
+    for (auto& path : paths) {
+        result.nodes.insert(result.nodes.end(), path.begin(), path.end());
+        result.offsets.push_back(result.nodes.size());
+    }
+    return result;
+}
+
+std::vector<double> pm::UserGraph::get_distances_from_source(size_t source) {
+    if (source != SIZE_MAX && source >= nodes.size())
+        throw std::invalid_argument("node " + std::to_string(source) + " is not in the graph");
+    bool source_is_boundary = is_boundary_node(source);
+    auto mwpm_lease = acquire_mwpm(true);
+    double normalising_constant = mwpm_lease->flooder.graph.normalising_constant;
+    pm::SearchShortestPathTree tree(mwpm_lease->search_flooder.graph);
+    tree.grow_to_all(source_is_boundary ? SIZE_MAX : source);
+    auto to_user_distance = [&](pm::cumulative_time_int distance) {
+        if (distance == pm::SearchShortestPathTree::UNREACHABLE)
+            return std::numeric_limits<double>::infinity();
+        return (double)distance / normalising_constant;
+    };
+    double boundary_distance = source_is_boundary ? 0 : to_user_distance(tree.distance_to(SIZE_MAX));
+    std::vector<double> distances(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+        distances[i] = is_boundary_node(i) ? boundary_distance : to_user_distance(tree.distance_to(i));
+    return distances;
+}
+
+bool pm::UserGraph::matching_graph_edge_of(const UserEdge& edge, size_t& u, size_t& v) {
+    bool node1_boundary = is_boundary_node(edge.node1);
+    bool node2_boundary = is_boundary_node(edge.node2);
+    if (node1_boundary && node2_boundary)
         return false;
-    return nodes[node1].index_of_neighbor(node2) != SIZE_MAX;
+    u = node1_boundary ? edge.node2 : edge.node1;
+    v = node1_boundary || node2_boundary ? SIZE_MAX : edge.node2;
+    if (v == SIZE_MAX) {
+        // Only the smallest of parallel edges to the boundary is kept in the matching graph.
+        size_t num_boundary_edges = 0;
+        for (auto& neighbor : nodes[u].neighbors) {
+            auto& neighbor_edge = edges[neighbor.edge_index];
+            size_t other = neighbor.pos == 0 ? neighbor_edge.node1 : neighbor_edge.node2;
+            if (is_boundary_node(other))
+                num_boundary_edges++;
+        }
+        if (num_boundary_edges > 1) {
+            std::string edge_str = "(" + std::to_string(edge.node1) + ", " +
+                                   (edge.node2 == SIZE_MAX ? "boundary" : std::to_string(edge.node2)) + ")";
+            throw std::invalid_argument(
+                "The weight of edge " + edge_str +
+                " cannot be overridden, since its node has more than one edge to the boundary.");
+        }
+    }
+    return true;
+}
+
+namespace {
+
+/// Suspends the caches of a Mwpm that are only valid for the original weights of its graph: the cached solutions
+/// of small and repeated syndromes, the cached search paths and the guided search landmarks. They are set aside
+/// while the weights are temporarily overridden, and restored when the suspender goes out of scope, so it should be
+/// created before the first weight is changed and destroyed after the last one is restored.
+class OriginalWeightCachesSuspender {
+   public:
+    explicit OriginalWeightCachesSuspender(pm::Mwpm& mwpm)
+        : mwpm(mwpm),
+          small_syndrome_cache_was_enabled(mwpm.small_syndrome_cache.enabled),
+          path_cache(0),
+          syndrome_cache(0),
+          landmarks(std::move(mwpm.search_flooder.landmarks)) {
+        mwpm.small_syndrome_cache.enabled = false;
+        std::swap(path_cache, mwpm.search_flooder.path_cache);
+        std::swap(syndrome_cache, mwpm.syndrome_cache);
+        mwpm.search_flooder.landmarks = nullptr;
+    }
+    ~OriginalWeightCachesSuspender() {
+        mwpm.small_syndrome_cache.enabled = small_syndrome_cache_was_enabled;
+        std::swap(path_cache, mwpm.search_flooder.path_cache);
+        std::swap(syndrome_cache, mwpm.syndrome_cache);
+        mwpm.search_flooder.landmarks = std::move(landmarks);
+    }
+    OriginalWeightCachesSuspender(const OriginalWeightCachesSuspender&) = delete;
+    OriginalWeightCachesSuspender& operator=(const OriginalWeightCachesSuspender&) = delete;
+
+   private:
+    pm::Mwpm& mwpm;
+    bool small_syndrome_cache_was_enabled;
+    pm::SearchPathCache path_cache;
+    pm::SyndromeCache syndrome_cache;
+    std::shared_ptr<const pm::SearchLandmarks> landmarks;
+};
+
+}  // namespace
+
+void pm::UserGraph::decode_with_weight_overrides(
+    const std::vector<uint64_t>& detection_events,
+    const std::vector<std::pair<size_t, size_t>>& edges,
+    const std::vector<double>& weights,
+    uint8_t* obs_begin_ptr,
+    pm::total_weight_int& weight) {
+    check_not_frozen();
+    if (edges.size() != weights.size())
+        throw std::invalid_argument("The number of edges and the number of override weights must be equal.");
+    auto& mwpm = get_mwpm();
+    auto& graph = mwpm.flooder.graph;
+    bool has_search_graph = mwpm.search_flooder.graph.nodes.size() == graph.nodes.size();
+    double max_override_weight = _mwpm_all_weights_integral ? pm::MAX_USER_EDGE_WEIGHT : _mwpm_max_abs_weight;
+
+    // Check every override before modifying anything, so that an invalid override leaves the Mwpm unchanged.
+    std::vector<UserEdge*> overridden_edges;
+    overridden_edges.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+        size_t node1 = edges[i].first;
+        size_t node2 = edges[i].second;
+        std::string edge_str =
+            "(" + std::to_string(node1) + ", " + (node2 == SIZE_MAX ? "boundary" : std::to_string(node2)) + ")";
+        size_t idx = index_of_edge(node1, node2);
+        if (idx == SIZE_MAX)
+            throw std::invalid_argument("Edge " + edge_str + " is not in the graph.");
+        auto& edge = this->edges[idx];
+        if (std::abs(weights[i]) > max_override_weight) {
+            throw std::invalid_argument(
+                "The override weight " + std::to_string(weights[i]) + " of edge " + edge_str +
+                " exceeds the largest absolute edge weight in the graph (" + std::to_string(max_override_weight) +
+                ").");
+        }
+        if (edge.node1 == edge.node2)
+            throw std::invalid_argument("The weight of the self-loop " + edge_str + " cannot be overridden.");
+        size_t u, v;
+        matching_graph_edge_of(edge, u, v);
+        overridden_edges.push_back(&edge);
+    }
+
+    // Discretize the weights in the same way as `iter_discretized_edges'.
+    double half_normalising_constant = graph.normalising_constant / 2;
+    auto discretize = [&](double w) {
+        return 2 * (pm::signed_weight_int)round(w * half_normalising_constant);
+    };
+    bool has_negative_weights = false;
+    auto set_edge_weight = [&](UserEdge& edge, double new_weight) {
+        bool node1_boundary = is_boundary_node(edge.node1);
+        bool node2_boundary = is_boundary_node(edge.node2);
+        if (!node1_boundary || !node2_boundary) {
+            size_t u = node1_boundary ? edge.node2 : edge.node1;
+            size_t v = node1_boundary || node2_boundary ? SIZE_MAX : edge.node2;
+            pm::signed_weight_int old_w = discretize(edge.weight);
+            pm::signed_weight_int new_w = discretize(new_weight);
+            has_negative_weights |= old_w < 0 || new_w < 0;
+            // The change is rolled back before any replica sharing the topology is used again.
+            graph.update_edge(u, v, old_w, edge.observable_indices, new_w, edge.observable_indices, false);
+            if (has_search_graph)
+                mwpm.search_flooder.graph.update_shared_edge(u, v, new_w, graph.topology);
+        }
+        edge.weight = new_weight;
+    };
+
+    OriginalWeightCachesSuspender suspended_caches(mwpm);
+
+    std::vector<double> original_weights;
+    original_weights.reserve(edges.size());
+    for (size_t i = 0; i < edges.size(); i++) {
+        original_weights.push_back(overridden_edges[i]->weight);
+        set_edge_weight(*overridden_edges[i], weights[i]);
+    }
+    if (has_negative_weights)
+        mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+
+    auto roll_back = [&]() {
+        // Restore in reverse order, so that edges overridden more than once get back their original weight.
+        for (size_t i = edges.size(); i-- > 0;)
+            set_edge_weight(*overridden_edges[i], original_weights[i]);
+        if (has_negative_weights)
+            mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+    };
+    try {
+        pm::decode_detection_events(mwpm, detection_events, obs_begin_ptr, weight);
+    } catch (...) {
+        roll_back();
+        throw;
+    }
+    roll_back();
+}
+
+void pm::UserGraph::decode_with_erasures(
+    const std::vector<uint64_t>& detection_events,
+    const std::vector<size_t>& erased_edges,
+    uint8_t* obs_begin_ptr,
+    pm::total_weight_int& weight) {
+    double solution_weight;
+    decode_batch_with_erasures(
+        1,
+        [&](size_t, std::vector<uint64_t>& shot_detection_events) {
+            shot_detection_events = detection_events;
+        },
+        [&](size_t, std::vector<size_t>& shot_erased_edges) {
+            shot_erased_edges = erased_edges;
+        },
+        obs_begin_ptr,
+        &solution_weight);
+    weight = (pm::total_weight_int)std::llround(solution_weight * get_mwpm().flooder.graph.normalising_constant);
+}
+
+void pm::UserGraph::decode_batch_with_erasures(
+    size_t num_shots,
+    const std::function<void(size_t, std::vector<uint64_t>&)>& get_detection_events,
+    const std::function<void(size_t, std::vector<size_t>&)>& get_erased_edges,
+    uint8_t* predictions,
+    double* weights) {
+    check_not_frozen();
+    auto& mwpm = get_mwpm();
+    auto& graph = mwpm.flooder.graph;
+    bool has_search_graph = mwpm.search_flooder.graph.nodes.size() == graph.nodes.size();
+    size_t num_observables = get_num_observables();
+    double half_normalising_constant = graph.normalising_constant / 2;
+
+    // An erased edge that was patched, with the discretized weight it is restored to.
+    struct ErasedEdge {
+        size_t u;
+        size_t v;
+        const std::vector<size_t>* observables;
+        pm::signed_weight_int original_weight;
+    };
+    std::vector<ErasedEdge> patched_edges;
+    std::vector<bool> is_erased(edges.size(), false);
+    bool has_negative_erased_edge = false;
+    auto restore = [&]() {
+        for (size_t i = patched_edges.size(); i-- > 0;) {
+            auto& e = patched_edges[i];
+            // The change is rolled back before any replica sharing the topology is used again.
+            graph.update_edge(e.u, e.v, 0, *e.observables, e.original_weight, *e.observables, false);
+            if (has_search_graph)
+                mwpm.search_flooder.graph.update_shared_edge(e.u, e.v, e.original_weight, graph.topology);
+        }
+        if (has_negative_erased_edge)
+            mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+        patched_edges.clear();
+        has_negative_erased_edge = false;
+    };
+
+    OriginalWeightCachesSuspender suspended_caches(mwpm);
+    try {
+        std::vector<uint64_t> detection_events;
+        std::vector<size_t> erased_edges;
+        for (size_t k = 0; k < num_shots; k++) {
+            erased_edges.clear();
+            get_erased_edges(k, erased_edges);
+            for (size_t e : erased_edges) {
+                if (e >= edges.size())
+                    throw std::invalid_argument(
+                        "The erased edge index " + std::to_string(e) + " of shot " + std::to_string(k) +
+                        " is out of range, since the graph has " + std::to_string(edges.size()) + " edges.");
+                auto& edge = edges[e];
+                size_t u, v;
+                if (is_erased[e] || edge.node1 == edge.node2 || !matching_graph_edge_of(edge, u, v))
+                    continue;
+                is_erased[e] = true;
+                // Discretize the weight in the same way as `iter_discretized_edges'.
+                auto original_weight = 2 * (pm::signed_weight_int)round(edge.weight * half_normalising_constant);
+                has_negative_erased_edge |= original_weight < 0;
+                graph.update_edge(u, v, original_weight, edge.observable_indices, 0, edge.observable_indices, false);
+                if (has_search_graph)
+                    mwpm.search_flooder.graph.update_shared_edge(u, v, 0, graph.topology);
+                patched_edges.push_back({u, v, &edge.observable_indices, original_weight});
+            }
+            for (size_t e : erased_edges)
+                is_erased[e] = false;
+            if (has_negative_erased_edge)
+                mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+            detection_events.clear();
+            get_detection_events(k, detection_events);
+            pm::total_weight_int solution_weight = 0;
+            pm::decode_detection_events(
+                mwpm, detection_events, predictions + k * num_observables, solution_weight);
+            weights[k] = (double)solution_weight / graph.normalising_constant;
+            restore();
+        }
+    } catch (...) {
+        restore();
+        throw;
+    }
+}
+
+void pm::UserGraph::decode_batch_with_edge_probabilities(
+    size_t num_shots,
+    const std::function<void(size_t, std::vector<uint64_t>&)>& get_detection_events,
+    const double* edge_probabilities,
+    uint8_t* predictions,
+    double* weights) {
+    check_not_frozen();
+    auto& mwpm = get_mwpm();
+    auto& graph = mwpm.flooder.graph;
+    bool has_search_graph = mwpm.search_flooder.graph.nodes.size() == graph.nodes.size();
+    size_t num_edges = edges.size();
+    size_t num_observables = get_num_observables();
+
+    // The matching graph edge of each edge, which is skipped if it has none (or is a self-loop).
+    std::vector<size_t> edge_u(num_edges), edge_v(num_edges);
+    std::vector<bool> patched(num_edges);
+    for (size_t e = 0; e < num_edges; e++)
+        patched[e] = edges[e].node1 != edges[e].node2 && matching_graph_edge_of(edges[e], edge_u[e], edge_v[e]);
+
+    // The weights are discretized with the normalising constant of the graph, as for `decode_with_weight_overrides',
+    // so they are clamped to the largest absolute edge weight of the graph.
+    double max_weight = _mwpm_all_weights_integral ? pm::MAX_USER_EDGE_WEIGHT : _mwpm_max_abs_weight;
+    double half_normalising_constant = graph.normalising_constant / 2;
+    auto discretize = [&](double w) {
+        return 2 * (pm::signed_weight_int)round(w * half_normalising_constant);
+    };
+    std::vector<pm::signed_weight_int> original_weights(num_edges);
+    for (size_t e = 0; e < num_edges; e++)
+        original_weights[e] = discretize(edges[e].weight);
+    std::vector<pm::signed_weight_int> current_weights = original_weights;
+    std::vector<pm::signed_weight_int> new_weights(num_edges);
+
+    bool has_negative_weights = false;
+    auto set_weights = [&](const std::vector<pm::signed_weight_int>& target) {
+        bool negative = false;
+        for (size_t e = 0; e < num_edges; e++) {
+            negative |= target[e] < 0;
+            if (!patched[e] || target[e] == current_weights[e])
+                continue;
+            negative |= current_weights[e] < 0;
+            const auto& obs = edges[e].observable_indices;
+            // The change is rolled back before any replica sharing the topology is used again.
+            graph.update_edge(edge_u[e], edge_v[e], current_weights[e], obs, target[e], obs, false);
+            if (has_search_graph)
+                mwpm.search_flooder.graph.update_shared_edge(edge_u[e], edge_v[e], target[e], graph.topology);
+            current_weights[e] = target[e];
+        }
+        if (negative || has_negative_weights)
+            mwpm.flooder.sync_negative_weight_observables_and_detection_events();
+        has_negative_weights = negative;
+    };
+
+    OriginalWeightCachesSuspender suspended_caches(mwpm);
+
+    auto roll_back = [&]() {
+        set_weights(original_weights);
+    };
+    try {
+        std::vector<uint64_t> detection_events;
+        for (size_t k = 0; k < num_shots; k++) {
+            const double* shot_probabilities = edge_probabilities + k * num_edges;
+            bool all_valid = true;
+            for (size_t e = 0; e < num_edges; e++) {
+                double p = shot_probabilities[e];
+                all_valid &= p >= 0 && p <= 1;
+                // p = 0 and p = 1 give infinite weights, which are clamped like any other (and NaN is mapped to 0).
+                p = std::min(1.0, std::max(0.0, p));
+                double w = std::min(std::max(std::log((1 - p) / p), -max_weight), max_weight);
+                new_weights[e] = discretize(w);
+            }
+            if (!all_valid)
+                throw std::invalid_argument(
+                    "The edge probabilities of shot " + std::to_string(k) + " must all be between 0 and 1.");
+            set_weights(new_weights);
+            detection_events.clear();
+            get_detection_events(k, detection_events);
+            pm::total_weight_int solution_weight = 0;
+            pm::decode_detection_events(
+                mwpm, detection_events, predictions + k * num_observables, solution_weight);
+            weights[k] = (double)solution_weight / graph.normalising_constant;
+        }
+    } catch (...) {
+        roll_back();
+        throw;
+    }
+    roll_back();
+}
+
+void pm::UserGraph::decode_correlated(
+    const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr, pm::total_weight_int& weight) {
+    check_not_frozen();
+    if (edge_correlations.empty())
+        throw std::invalid_argument(
+            "The graph has no edge correlations. Load it from a detector error model with decomposed errors, with "
+            "correlations enabled.");
+    std::vector<int64_t> matched_edges;
+    pm::decode_detection_events_to_edges(get_mwpm_with_search_graph(), detection_events, matched_edges);
+
+    std::vector<std::pair<size_t, size_t>> partner_edges;
+    std::vector<double> partner_weights;
+    edge_correlations.append_partner_weights(matched_edges, partner_edges, partner_weights);
+    // Only lower weights, and skip edges that were merged away or can't be overridden (such as a boundary edge of
+    // a boundary node).
+    size_t num_overrides = 0;
+    for (size_t k = 0; k < partner_edges.size(); k++) {
+        size_t idx = index_of_edge(partner_edges[k].first, partner_edges[k].second);
+        if (idx == SIZE_MAX || partner_weights[k] >= edges[idx].weight)
+            continue;
+        if (is_boundary_node(edges[idx].node1) || is_boundary_node(edges[idx].node2))
+            continue;
+        partner_edges[num_overrides] = partner_edges[k];
+        partner_weights[num_overrides] = partner_weights[k];
+        num_overrides++;
+    }
+    partner_edges.resize(num_overrides);
+    partner_weights.resize(num_overrides);
+    decode_with_weight_overrides(detection_events, partner_edges, partner_weights, obs_begin_ptr, weight);
+}
+
+bool pm::UserGraph::has_edge(size_t node1, size_t node2) {
+    return index_of_edge(node1, node2) != SIZE_MAX;
 }
 
 bool pm::UserGraph::has_boundary_edge(size_t node) {
-    if (node >= nodes.size())
-        return false;
-    return nodes[node].index_of_neighbor(SIZE_MAX) != SIZE_MAX;
+    return index_of_edge(node, SIZE_MAX) != SIZE_MAX;
 }
 
 void pm::UserGraph::set_min_num_observables(size_t num_observables) {
+    check_not_frozen();
     if (num_observables > _num_observables)
         _num_observables = num_observables;
 }
 
 double pm::UserGraph::get_edge_weight_normalising_constant(size_t max_num_distinct_weights) {
+    check_edges_loaded();
     double max_abs_weight = 0;
     bool all_integral_weight = true;
     for (auto& e : edges) {
@@ -381,11 +1417,119 @@ double pm::UserGraph::get_edge_weight_normalising_constant(size_t max_num_distin
     }
 }
 
-pm::UserGraph pm::detector_error_model_to_user_graph(const stim::DetectorErrorModel& detector_error_model) {
+pm::UserGraph pm::detector_error_model_to_user_graph(
+    const stim::DetectorErrorModel& detector_error_model, bool enable_correlations) {
     pm::UserGraph user_graph(detector_error_model.count_detectors(), detector_error_model.count_observables());
     pm::iter_detector_error_model_edges(
         detector_error_model, [&](double p, const std::vector<size_t>& detectors, std::vector<size_t>& observables) {
             user_graph.handle_dem_instruction(p, detectors, observables);
         });
+    if (enable_correlations)
+        user_graph.edge_correlations = pm::detector_error_model_to_edge_correlation_table(detector_error_model);
     return user_graph;
 }
+
+pm::UserGraph pm::check_matrix_to_user_graph(
+    const pm::CscBinaryMatrix& check_matrix,
+    const double* weights,
+    const double* error_probabilities,
+    pm::MERGE_STRATEGY merge_strategy,
+    bool use_virtual_boundary_node,
+    size_t num_repetitions,
+    const double* timelike_weights,
+    const double* measurement_error_probabilities,
+    const pm::CscBinaryMatrix* faults_matrix) {
+    auto& H = check_matrix;
+    if (faults_matrix != nullptr && faults_matrix->num_cols != H.num_cols)
+        throw std::invalid_argument(
+            "`faults_matrix` array with shape (" + std::to_string(faults_matrix->num_rows) + ", " +
+            std::to_string(faults_matrix->num_cols) +
+            ") must have the same number of columns as the check matrix, which has shape (" +
+            std::to_string(H.num_rows) + ", " + std::to_string(H.num_cols) + ").");
+    for (size_t c = 0; c < H.num_cols; c++) {
+        if (H.indptr[c] < 0 || H.indptr[c] > H.indptr[c + 1] || H.indptr[c + 1] > H.indptr[H.num_cols])
+            throw std::invalid_argument(
+                "`check_matrix.indptr` elements must not exceed size of `check_matrix.indices`");
+        for (auto k = H.indptr[c]; k < H.indptr[c + 1]; k++) {
+            if (H.indices[k] < 0 || (size_t)H.indices[k] >= H.num_rows)
+                throw std::invalid_argument(
+                    "`check_matrix.indices` contains the row index " + std::to_string(H.indices[k]) +
+                    ", but the check matrix has " + std::to_string(H.num_rows) + " rows.");
+        }
+        auto num_dets = H.indptr[c + 1] - H.indptr[c];
+        if (num_dets > 2)
+            throw std::invalid_argument(
+                "`check_matrix` must contain at most two ones per column, but column " + std::to_string(c) +
+                " has " + std::to_string(num_dets) + " ones.");
+    }
+    if (num_repetitions > 1) {
+        if (timelike_weights == nullptr)
+            throw std::invalid_argument("must provide `timelike_weights` for repetitions > 1.");
+        if (measurement_error_probabilities == nullptr)
+            throw std::invalid_argument("must provide `measurement_error_probabilities` for repetitions > 1.");
+    }
+
+    size_t num_detectors = H.num_rows * num_repetitions;
+    size_t num_observables = faults_matrix == nullptr ? H.num_cols : faults_matrix->num_rows;
+    pm::UserGraph graph(num_detectors, num_observables);
+    size_t num_timelike_edges = num_repetitions > 1 ? H.num_rows * (num_repetitions - 1) : 0;
+    graph.reserve_edges(H.num_cols * num_repetitions + num_timelike_edges);
+
+    // The fault ids of each column are the same in every round, so they are collected once.
+    std::vector<size_t> obs_offsets(H.num_cols + 1, 0);
+    std::vector<size_t> obs;
+    if (faults_matrix == nullptr) {
+        obs.resize(H.num_cols);
+        for (size_t c = 0; c < H.num_cols; c++) {
+            obs[c] = c;
+            obs_offsets[c + 1] = c + 1;
+        }
+    } else {
+        auto& F = *faults_matrix;
+        obs.reserve(F.indptr[F.num_cols]);
+        for (size_t c = 0; c < F.num_cols; c++) {
+            for (auto k = F.indptr[c]; k < F.indptr[c + 1]; k++)
+                obs.push_back((size_t)F.indices[k]);
+            obs_offsets[c + 1] = obs.size();
+        }
+    }
+
+    std::vector<size_t> edge_obs;
+    for (size_t rep = 0; rep < num_repetitions; rep++) {
+        size_t offset = H.num_rows * rep;
+        for (size_t c = 0; c < H.num_cols; c++) {
+            auto idx_start = H.indptr[c];
+            auto num_dets = H.indptr[c + 1] - idx_start;
+            if (num_dets == 0)
+                continue;
+            edge_obs.assign(obs.begin() + obs_offsets[c], obs.begin() + obs_offsets[c + 1]);
+            size_t u = H.indices[idx_start] + offset;
+            if (num_dets == 2) {
+                graph.add_or_merge_edge(
+                    u, H.indices[idx_start + 1] + offset, edge_obs, weights[c], error_probabilities[c], merge_strategy);
+            } else if (use_virtual_boundary_node) {
+                graph.add_or_merge_boundary_edge(u, edge_obs, weights[c], error_probabilities[c], merge_strategy);
+            } else {
+                graph.add_or_merge_edge(u, num_detectors, edge_obs, weights[c], error_probabilities[c], merge_strategy);
+            }
+        }
+    }
+
+    for (size_t rep = 0; rep + 1 < num_repetitions; rep++) {
+        for (size_t row = 0; row < H.num_rows; row++) {
+            graph.add_or_merge_edge(
+                row + rep * H.num_rows,
+                row + (rep + 1) * H.num_rows,
+                {},
+                timelike_weights[row],
+                measurement_error_probabilities[row],
+                merge_strategy);
+        }
+    }
+
+    // Set the boundary if not using a virtual boundary and if a boundary edge was added
+    if (!use_virtual_boundary_node && graph.nodes.size() == num_detectors + 1)
+        graph.set_boundary({num_detectors});
+
+    return graph;
+}
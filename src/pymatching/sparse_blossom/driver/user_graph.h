@@ -16,11 +16,15 @@
 #define PYMATCHING2_USER_GRAPH_H
 
 #include <cmath>
-#include <list>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "pymatching/rand/rand_gen.h"
+#include "pymatching/sparse_blossom/driver/edge_correlations.h"
 #include "pymatching/sparse_blossom/driver/io.h"
 #include "pymatching/sparse_blossom/ints.h"
 
@@ -35,14 +39,13 @@ struct UserEdge {
 };
 
 struct UserNeighbor {
-    std::list<UserEdge>::iterator edge_it;
-    uint8_t pos{};  // The position of the neighboring node in the edge (either 0 if node1, or 1 if node2)
+    size_t edge_index;  // The index of the edge in `UserGraph::edges'
+    uint8_t pos{};      // The position of the neighboring node in the edge (either 0 if node1, or 1 if node2)
 };
 
 class UserNode {
    public:
     UserNode();
-    size_t index_of_neighbor(size_t node) const;
     std::vector<UserNeighbor> neighbors;  /// The node's neighbors.
     bool is_boundary;
 };
@@ -51,18 +54,79 @@ const pm::weight_int MAX_USER_EDGE_WEIGHT = NUM_DISTINCT_WEIGHTS - 1;
 
 enum MERGE_STRATEGY : uint8_t { DISALLOW, INDEPENDENT, SMALLEST_WEIGHT, KEEP_ORIGINAL, REPLACE };
 
+/// The Mwpm objects built for a frozen `UserGraph' that are not currently in use.
+struct MwpmPool {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Mwpm>> idle_mwpms;
+};
+
+/// Exclusive use of a Mwpm of a `UserGraph', obtained from `UserGraph::acquire_mwpm'. A Mwpm taken from the pool of
+/// a frozen graph is returned to the pool when the lease is destroyed, which is safe even after the graph itself has
+/// been destroyed.
+class MwpmLease {
+   public:
+    /// Borrows `mwpm', which is owned by someone else.
+    explicit MwpmLease(Mwpm& mwpm);
+    /// Takes `mwpm' out of `pool', to which it is returned when the lease is destroyed.
+    MwpmLease(std::shared_ptr<MwpmPool> pool, std::unique_ptr<Mwpm> mwpm);
+    MwpmLease(MwpmLease&& other) noexcept = default;
+    MwpmLease& operator=(MwpmLease&& other) = delete;
+    ~MwpmLease();
+
+    Mwpm& operator*() const {
+        return *mwpm;
+    }
+    Mwpm* operator->() const {
+        return mwpm;
+    }
+
+   private:
+    Mwpm* mwpm;
+    std::shared_ptr<MwpmPool> pool;
+    std::unique_ptr<Mwpm> owned_mwpm;
+};
+
+/// The shortest paths between pairs of nodes of a `UserGraph', as returned by `UserGraph::get_shortest_paths'.
+struct ShortestPaths {
+    /// The nodes on path `i' are `nodes[offsets[i]]' to `nodes[offsets[i + 1] - 1]', from its source to its target,
+    /// excluding any boundary node at either end. The path is empty if the target can't be reached.
+    std::vector<size_t> offsets;
+    std::vector<size_t> nodes;
+    /// The length of each path, in units of the edge weights, or infinity if the target can't be reached.
+    std::vector<double> distances;
+};
+
+/// The memory held by a `UserGraph' and its Mwpm objects, in bytes, as returned by `UserGraph::get_memory_usage'.
+struct UserGraphMemoryUsage {
+    /// The nodes and edges of the UserGraph itself, the index of its edges and its edge correlations.
+    size_t user_graph = 0;
+    /// The Mwpm objects of the graph, counting what they share once.
+    MwpmMemoryUsage mwpms;
+    size_t num_mwpms = 0;
+    /// The largest capacity of any of the Mwpm objects.
+    MwpmCapacity max_capacity;
+
+    inline size_t total() const {
+        return user_graph + mwpms.total();
+    }
+};
+
 class UserGraph {
    public:
     std::vector<UserNode> nodes;
-    std::list<UserEdge> edges;
+    /// The edges, in the order in which they were added. Edges are never removed, so indices into it are stable.
+    std::vector<UserEdge> edges;
     std::set<size_t> boundary_nodes;
+    /// The correlations between edges used by `decode_correlated'. Only filled if the graph was built from a detector
+    /// error model with correlations enabled.
+    EdgeCorrelationTable edge_correlations;
 
     UserGraph();
     explicit UserGraph(size_t num_nodes);
     UserGraph(size_t num_nodes, size_t num_observables);
+    /// Merges a parallel edge into the existing edge `edges[edge_index]' using `merge_strategy'.
     void merge_edge_or_boundary_edge(
-        size_t node,
-        size_t neighbor_index,
+        size_t edge_index,
         const std::vector<size_t>& parallel_observables,
         double parallel_weight,
         double parallel_error_probability,
@@ -80,6 +144,19 @@ class UserGraph {
         double weight,
         double error_probability,
         MERGE_STRATEGY merge_strategy = DISALLOW);
+    /// Reserves space for `num_edges' edges in total, so that adding them does not reallocate or rehash.
+    void reserve_edges(size_t num_edges);
+    /// Adds or merges each of `new_edges' in turn, as `add_or_merge_edge' (or `add_or_merge_boundary_edge' if its
+    /// `node2' is SIZE_MAX) does, after reserving space for all of them.
+    void add_or_merge_edges(const std::vector<UserEdge>& new_edges, MERGE_STRATEGY merge_strategy = DISALLOW);
+    /// Returns the index in `edges' of the edge (node1, node2), or of the boundary edge of node1 if node2 is
+    /// SIZE_MAX, or SIZE_MAX if there is no such edge. Takes constant time on average.
+    size_t index_of_edge(size_t node1, size_t node2) const;
+    /// Changes the observables, weight and error probability of the existing edge (node1, node2), or of the boundary
+    /// edge of node1 if node2 is SIZE_MAX. If the Mwpm has already been built, it is updated in place when possible
+    /// (see `try_update_mwpm_edge_in_place'), rather than being rebuilt the next time it is needed.
+    void update_edge(
+        size_t node1, size_t node2, const std::vector<size_t>& observables, double weight, double error_probability);
     bool has_edge(size_t node1, size_t node2);
     bool has_boundary_edge(size_t node);
     void set_boundary(const std::set<size_t>& boundary);
@@ -91,6 +168,17 @@ class UserGraph {
     size_t get_num_edges();
     bool is_boundary_node(size_t node_id);
     void add_noise(uint8_t* error_arr, uint8_t* syndrome_arr) const;
+    /// Samples `num_shots' shots of independent edge errors, each edge being flipped with its error probability,
+    /// using a generator seeded with `seed' (so it doesn't use or change the global generator). Writes shot k to row k
+    /// of `syndromes', which has (get_num_nodes() + 7) / 8 bytes per row, and of `observables', which has
+    /// (get_num_observables() + 7) / 8 bytes per row, as bit-packed little-endian rows, like the bit-packed shots
+    /// and predictions of `decode_batch'. Boundary nodes are never detection events.
+    ///
+    /// The edges are grouped by error probability, and the flipped edges of each group are found by drawing the
+    /// geometrically distributed gaps between them, so that the time taken is proportional to the number of distinct
+    /// probabilities plus the number of flips, rather than to the number of edges times the number of shots. Throws
+    /// std::invalid_argument if not all edges have error probabilities.
+    void add_noise_batch(size_t num_shots, uint64_t seed, uint8_t* syndromes, uint8_t* observables) const;
     bool all_edges_have_error_probabilities();
     double max_abs_weight();
     double get_edge_weight_normalising_constant(size_t max_num_distinct_weights);
@@ -105,19 +193,218 @@ class UserGraph {
         const EdgeCallable& edge_func,
         const BoundaryEdgeCallable& boundary_edge_func);
     pm::MatchingGraph to_matching_graph(pm::weight_int num_distinct_weights);
-    pm::SearchGraph to_search_graph(pm::weight_int num_distinct_weights);
+    pm::SearchGraph to_search_graph(const pm::MatchingGraph& matching_graph, pm::weight_int num_distinct_weights);
     pm::Mwpm to_mwpm(pm::weight_int num_distinct_weights, bool ensure_search_graph_included);
     void update_mwpm();
     Mwpm& get_mwpm();
     Mwpm& get_mwpm_with_search_graph();
+    /// Installs `mwpm', which must have been built from this graph in its current state (e.g. loaded from a graph
+    /// file saved from it), as the Mwpm of the graph, so that it is not rebuilt until the graph is modified.
+    void set_mwpm(Mwpm mwpm);
+    /// Returns pointers to `num_mwpms' independent Mwpm objects built from this graph, the first of which
+    /// is the one returned by `get_mwpm()'. The extra replicas share the matching graph topology of the first,
+    /// are cached, and are rebuilt lazily only after the graph is modified. Each replica can be used by a
+    /// different thread concurrently.
+    std::vector<Mwpm*> get_mwpms(size_t num_mwpms);
+    /// Returns the distance from each node to the boundary (and the observables crossed by the path), computing it
+    /// the first time it is requested after the graph is modified. Once computed, it is also used to speed up
+    /// decoding of syndromes with very few detection events.
+    const BoundaryDistances& get_boundary_distances();
+    /// Makes the graph immutable, so that it can be decoded by several threads at once. The Mwpm (including its
+    /// search graph) and the boundary distances are built first. From then on, the methods that modify the graph or
+    /// the weights of its Mwpm throw std::invalid_argument, and `acquire_mwpm' gives each concurrent caller its own
+    /// Mwpm. A graph can't be unfrozen.
+    void freeze();
+    bool is_frozen() const;
+    /// Returns exclusive use of a Mwpm built from this graph, for decoding. If the graph is frozen, this may be called
+    /// from any thread: the Mwpm is taken from a pool of Mwpm objects sharing the topology of the graph's own Mwpm,
+    /// and a new one is added to the pool if they are all in use. Otherwise, it is the graph's own Mwpm, as returned
+    /// by `get_mwpm()' (or by `get_mwpm_with_search_graph()' if `ensure_search_graph_included' is true).
+    MwpmLease acquire_mwpm(bool ensure_search_graph_included = false);
+    /// A copy of the topology of the matching graph of the frozen graph, whose edge arrays are allocated with
+    /// `huge_pages' (see `MatchingGraphTopology::copy_with_huge_pages'), for `acquire_mwpm_on_topology'. Throws
+    /// std::invalid_argument if the graph is not frozen.
+    std::shared_ptr<MatchingGraphTopology> copy_frozen_topology(HugePagePolicy huge_pages) const;
+    /// Like `acquire_mwpm' on a frozen graph, but always builds a new Mwpm, whose graphs read `topology' (a copy from
+    /// `copy_frozen_topology') instead of the topology of the graph's own Mwpm. The Mwpm is built on the calling
+    /// thread, so that with the usual first-touch policy its state is on that thread's NUMA node. It joins the pool
+    /// when the lease ends. Throws std::invalid_argument if the graph is not frozen.
+    MwpmLease acquire_mwpm_on_topology(std::shared_ptr<MatchingGraphTopology> topology);
+    /// Installs `mwpm', attached to a graph file (see `attach_user_graph_to_graph_file'), as the Mwpm of this graph,
+    /// which must have no edges, in place of the `num_edges' edges of the graph it was saved from, which are not
+    /// loaded. The graph is then frozen, and its methods that read its edges (other than `get_num_edges') throw
+    /// std::invalid_argument.
+    void attach_mwpm(Mwpm mwpm, size_t num_edges);
+    /// Whether the Mwpm of the graph was attached with `attach_mwpm', so that its edges are not loaded.
+    bool is_attached() const;
+    /// Throws std::invalid_argument if the edges of the graph are not loaded, because its Mwpm was attached.
+    void check_edges_loaded() const;
+    /// Sets the number of syndromes whose solutions each Mwpm of the graph remembers (see `SyndromeCache'), so that
+    /// repeated syndromes are decoded without running the blossom algorithm again. A capacity of zero (the default)
+    /// disables the cache. Throws std::invalid_argument if the graph is frozen.
+    void set_syndrome_cache_capacity(size_t capacity);
+    size_t get_syndrome_cache_capacity() const;
+    /// Sets the number of threads (including the decoding thread) that each Mwpm of the graph uses to find the
+    /// shortest paths of the matches of a shot, when decoding to edges or with too many observables for a bit mask
+    /// (see `Mwpm::set_num_path_threads'). Defaults to 1. Throws std::invalid_argument if the graph is frozen or
+    /// `num_threads' is zero.
+    void set_num_path_threads(size_t num_threads);
+    size_t get_num_path_threads() const;
+    /// Sets the algorithm each Mwpm of the graph decodes shots with (see `Mwpm::set_decoder_engine'). Defaults to
+    /// SPARSE_BLOSSOM. Throws std::invalid_argument if the graph is frozen.
+    void set_decoder_engine(DecoderEngine engine);
+    DecoderEngine get_decoder_engine() const;
+    /// Sets which pairs of adjacent detection events each Mwpm of the graph matches before running the blossom
+    /// algorithm (see `Predecoder'). Defaults to PREDECODER_OFF. Throws std::invalid_argument if the graph is frozen.
+    void set_predecoder_mode(PredecoderMode mode);
+    PredecoderMode get_predecoder_mode() const;
+    /// Sets the most work each Mwpm of the graph may do on a shot before decoding it approximately instead (see
+    /// `Mwpm::work_budget'). Throws std::invalid_argument if the graph is frozen.
+    void set_work_budget(WorkBudget budget);
+    WorkBudget get_work_budget() const;
+    /// Returns the total number of shots that ran out of work budget in the Mwpm objects of the graph, excluding any
+    /// currently leased by `acquire_mwpm'.
+    uint64_t get_num_degraded_shots();
+    /// Returns the total number of (hits, misses) of the syndrome caches of the Mwpm objects of the graph, excluding
+    /// any currently leased by `acquire_mwpm'.
+    std::pair<uint64_t, uint64_t> get_syndrome_cache_counts();
+    /// Grows the memory of the first `num_mwpms' Mwpm objects used for decoding (those of `get_mwpms', or, if the
+    /// graph is frozen, those leased first by `acquire_mwpm') before it is needed, so that the first shots decoded
+    /// aren't slowed down by growing it. Each Mwpm reserves memory for `expected_detection_events' detection events
+    /// (see `Mwpm::reserve'), and then decodes `num_shots' shots sampled with `add_noise_batch' (using `seed'),
+    /// without changing its decoder statistics or syndrome cache counts. Returns the largest capacity reached by any
+    /// of them. Throws std::invalid_argument if `num_shots' is not zero and not all edges have error probabilities.
+    MwpmCapacity warm_up(size_t num_mwpms, size_t num_shots, size_t expected_detection_events, uint64_t seed);
+    /// Returns the memory held by the graph and by its Mwpm objects, excluding any currently leased by
+    /// `acquire_mwpm'. Only the Mwpm objects that have been built are counted, and their decoder state is what the
+    /// shots decoded so far (and `warm_up') have grown it to.
+    UserGraphMemoryUsage get_memory_usage();
     void handle_dem_instruction(double p, const std::vector<size_t>& detectors, const std::vector<size_t>& observables);
     void get_nodes_on_shortest_path_from_source(size_t src, size_t dst, std::vector<size_t>& out_nodes);
+    /// Finds the shortest path from `sources[i]' to `targets[i]' for each i, where SIZE_MAX (or any boundary node)
+    /// denotes the boundary. The pairs are grouped by source, so that all the paths from the same source are found
+    /// with a single Dijkstra search (see `SearchShortestPathTree'), and the sources are divided between
+    /// `num_threads' threads. Throws std::invalid_argument if a node is not in the graph, or if both nodes of a pair
+    /// are on the boundary.
+    ShortestPaths get_shortest_paths(
+        const std::vector<size_t>& sources, const std::vector<size_t>& targets, size_t num_threads = 1);
+    /// The length of a shortest path from `source' (SIZE_MAX or any boundary node for the boundary) to each node,
+    /// in units of the edge weights, with a single Dijkstra search. The distance to a boundary node is the distance
+    /// to the boundary (or 0 from the boundary), and the distance to a node that can't be reached is infinity.
+    std::vector<double> get_distances_from_source(size_t source);
+    /// Decodes `detection_events' as `decode_detection_events' does, but with the weight of each edge
+    /// `edges[i]' (where a second node of SIZE_MAX denotes a boundary edge) temporarily set to `weights[i]'.
+    /// The weights of the Mwpm are patched in place and restored after decoding, so the cost of the overrides
+    /// is proportional to their number rather than to the size of the graph. The override weights are
+    /// discretized with the same normalising constant as the rest of the graph, so their absolute values must
+    /// not exceed the largest absolute edge weight of the graph (unless all the edge weights are integers).
+    void decode_with_weight_overrides(
+        const std::vector<uint64_t>& detection_events,
+        const std::vector<std::pair<size_t, size_t>>& edges,
+        const std::vector<double>& weights,
+        uint8_t* obs_begin_ptr,
+        pm::total_weight_int& weight);
+
+    /// Decodes a batch of `num_shots' shots, each with its own error probability for every edge, for example
+    /// posteriors from a round of belief propagation (as in belief-matching). The detection events of shot k are
+    /// appended to an empty vector by `get_detection_events(k, detection_events)', and the probability of edge e in
+    /// shot k is `edge_probabilities[k * edges.size() + e]'. Each probability p is converted to the weight
+    /// log((1 - p) / p), clamped to the largest absolute edge weight of the graph, and discretized with the graph's
+    /// normalising constant. The weights of the Mwpm are patched in place (only those that changed since the
+    /// previous shot) and restored once the batch is decoded. The predicted observables of shot k are XOR-ed into
+    /// `predictions[k * get_num_observables():]', and its solution weight (using its own edge weights) is written to
+    /// `weights[k]'. Throws std::invalid_argument if a node has more than one edge to the boundary.
+    void decode_batch_with_edge_probabilities(
+        size_t num_shots,
+        const std::function<void(size_t, std::vector<uint64_t>&)>& get_detection_events,
+        const double* edge_probabilities,
+        uint8_t* predictions,
+        double* weights);
+    /// Decodes `detection_events' as `decode_detection_events' does, but with the edges whose indices (in `edges')
+    /// are in `erased_edges' known to have been erased in this shot, so that their weight is temporarily set to 0.
+    /// The erased edges keep their observables. As for `decode_with_weight_overrides', the weights of the Mwpm are
+    /// patched in place and restored after decoding, at a cost proportional to the number of erased edges. Throws
+    /// std::invalid_argument if an edge index is out of range, or an erased boundary edge's node has more than one
+    /// edge to the boundary.
+    void decode_with_erasures(
+        const std::vector<uint64_t>& detection_events,
+        const std::vector<size_t>& erased_edges,
+        uint8_t* obs_begin_ptr,
+        pm::total_weight_int& weight);
+    /// Decodes a batch of `num_shots' shots, each with its own set of erased edges, as `decode_with_erasures' does.
+    /// The detection events and erased edge indices of shot k are appended to empty vectors by
+    /// `get_detection_events(k, detection_events)' and `get_erased_edges(k, erased_edges)'. Only the erased edges of
+    /// each shot are patched before it is decoded and restored after it. The predicted observables of shot k are
+    /// XOR-ed into `predictions[k * get_num_observables():]', and its solution weight (in which erased edges have
+    /// weight 0) is written to `weights[k]'.
+    void decode_batch_with_erasures(
+        size_t num_shots,
+        const std::function<void(size_t, std::vector<uint64_t>&)>& get_detection_events,
+        const std::function<void(size_t, std::vector<size_t>&)>& get_erased_edges,
+        uint8_t* predictions,
+        double* weights);
+    /// Decodes `detection_events' with two rounds of matching, to account for the correlations between edges in
+    /// `edge_correlations'. The first round decodes as `decode_detection_events' does. The weights of the edges
+    /// correlated with the edges in its matching are then lowered (see `EdgeCorrelationTable::append_partner_weights')
+    /// and the second round decodes again with these weights, as `decode_with_weight_overrides' does. The predicted
+    /// observables and the weight (using the lowered weights) of the second round are returned. Throws
+    /// std::invalid_argument if the graph has no correlations.
+    void decode_correlated(
+        const std::vector<uint64_t>& detection_events, uint8_t* obs_begin_ptr, pm::total_weight_int& weight);
 
    private:
+    /// An edge (u, v) is indexed by its key (min(u, v), max(u, v)), with v equal to SIZE_MAX for a boundary edge.
+    struct EdgeKey {
+        size_t u;
+        size_t v;
+        bool operator==(const EdgeKey& other) const {
+            return u == other.u && v == other.v;
+        }
+    };
+    struct EdgeKeyHash {
+        size_t operator()(const EdgeKey& key) const {
+            return std::hash<size_t>{}(key.u * 0x9E3779B97F4A7C15ULL ^ key.v);
+        }
+    };
+    std::unordered_map<EdgeKey, size_t, EdgeKeyHash> _edge_index;
     pm::Mwpm _mwpm;
+    std::vector<pm::Mwpm> _mwpm_replicas;
     size_t _num_observables;
     bool _mwpm_needs_updating;
     bool _all_edges_have_error_probabilities;
+    /// The largest absolute edge weight, and whether all the edge weights were integers, when `_mwpm' was last
+    /// built. Together these determine the normalising constant used to discretize the edge weights.
+    double _mwpm_max_abs_weight;
+    bool _mwpm_all_weights_integral;
+    /// The idle Mwpm objects of a frozen graph, or nullptr if the graph is not frozen.
+    std::shared_ptr<MwpmPool> _mwpm_pool;
+    size_t _syndrome_cache_capacity;
+    size_t _num_path_threads;
+    DecoderEngine _decoder_engine;
+    PredecoderMode _predecoder_mode;
+    WorkBudget _work_budget;
+    /// Whether `_mwpm' was attached with `attach_mwpm', and the number of edges of the graph it was saved from.
+    bool _is_attached;
+    size_t _num_attached_edges;
+
+    /// Throws std::invalid_argument if the graph is frozen.
+    void check_not_frozen() const;
+    /// Builds a new Mwpm for the pool of a frozen graph, whose graphs read `topology'.
+    std::unique_ptr<Mwpm> build_pooled_mwpm(const std::shared_ptr<MatchingGraphTopology>& topology) const;
+    void rebuild_mwpm(bool ensure_search_graph_included);
+    /// Records the largest absolute edge weight, and whether all the edge weights are integers, for `_mwpm'.
+    void record_mwpm_weight_range();
+    /// Sets (u, v) to the edge of the matching graph that `edge' corresponds to, with v equal to SIZE_MAX for a
+    /// boundary edge. Returns false if there is none, because both nodes of `edge' are boundary nodes. Throws
+    /// std::invalid_argument if the weight of the edge can't be changed in place, because it is a boundary edge of a
+    /// node with more than one edge to the boundary (of which only the smallest is in the matching graph).
+    bool matching_graph_edge_of(const UserEdge& edge, size_t& u, size_t& v);
+    /// Changes the weight and observables of `edge' to `new_weight' and `new_observables' in `_mwpm' (but not in
+    /// `edge' itself), without rebuilding it. This is only possible if the normalising constant used to discretize
+    /// the edge weights is unchanged, and if the edge corresponds to a single edge of the matching graph. Returns
+    /// false, leaving `_mwpm' unchanged, if it is not possible, in which case `_mwpm' must be rebuilt.
+    bool try_update_mwpm_edge_in_place(
+        const UserEdge& edge, const std::vector<size_t>& new_observables, double new_weight);
 };
 
 template <typename EdgeCallable, typename BoundaryEdgeCallable>
@@ -177,7 +464,38 @@ inline double UserGraph::to_matching_or_search_graph_helper(
     return normalising_constant;
 }
 
-UserGraph detector_error_model_to_user_graph(const stim::DetectorErrorModel& detector_error_model);
+/// Builds the graph of the graphlike error instructions of `detector_error_model'. If `enable_correlations' is true,
+/// the correlations between the components of decomposed error instructions are also recorded in
+/// `UserGraph::edge_correlations', for use by `UserGraph::decode_correlated'.
+UserGraph detector_error_model_to_user_graph(
+    const stim::DetectorErrorModel& detector_error_model, bool enable_correlations = false);
+
+/// A binary matrix in compressed sparse column (CSC) format, whose ones in column c are in the rows
+/// `indices[indptr[c]:indptr[c + 1]]'. The arrays are not owned.
+struct CscBinaryMatrix {
+    size_t num_rows;
+    size_t num_cols;
+    const int64_t* indptr;   /// Has `num_cols + 1' elements
+    const int64_t* indices;  /// Has `indptr[num_cols]' elements
+};
+
+/// Builds the matching graph of a check matrix in a single pass over its columns, each of which (with one or two
+/// ones) is an edge with weight `weights[c]' and error probability `error_probabilities[c]'. Its fault ids are the
+/// rows of the ones in column c of `faults_matrix', or just {c} if `faults_matrix' is null. Columns with a single one
+/// are connected to a virtual boundary if `use_virtual_boundary_node' is true, and otherwise to an extra boundary node
+/// (with the largest index). If `num_repetitions' is greater than one, the check matrix edges are repeated in each
+/// round, and the copies of row r in consecutive rounds are joined by an edge with weight `timelike_weights[r]' and
+/// error probability `measurement_error_probabilities[r]'.
+UserGraph check_matrix_to_user_graph(
+    const CscBinaryMatrix& check_matrix,
+    const double* weights,
+    const double* error_probabilities,
+    MERGE_STRATEGY merge_strategy,
+    bool use_virtual_boundary_node,
+    size_t num_repetitions,
+    const double* timelike_weights,
+    const double* measurement_error_probabilities,
+    const CscBinaryMatrix* faults_matrix);
 
 }  // namespace pm
 
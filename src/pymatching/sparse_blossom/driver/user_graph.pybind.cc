@@ -14,8 +14,24 @@
 
 #include "pymatching/sparse_blossom/driver/user_graph.pybind.h"
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <optional>
+#include <span>
+#include <thread>
+
 #include "pybind11/pybind11.h"
+#include "pymatching/sparse_blossom/driver/bit_packed_decoding.h"
+#include "pymatching/sparse_blossom/driver/graph_cache.h"
+#include "pymatching/sparse_blossom/driver/graph_file.h"
+#include "pymatching/sparse_blossom/driver/latency_histogram.h"
 #include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/driver/shot_scheduler.h"
+#include "pymatching/sparse_blossom/driver/syndrome_extraction.h"
+#include "pymatching/sparse_blossom/driver/transposed_shots.h"
 #include "stim.h"
 
 using namespace py::literals;
@@ -30,8 +46,8 @@ pm_pybind::CompressedSparseColumnCheckMatrix::CompressedSparseColumnCheckMatrix(
     // are stored in indices[indptr[i]:indptr[i+1]] and their corresponding values are stored in
     // data[indptr[i]:indptr[i+1]]."
     data = matrix.attr("data").cast<py::array_t<uint8_t>>();
-    indices = matrix.attr("indices").cast<py::array_t<int64_t>>();
-    indptr = matrix.attr("indptr").cast<py::array_t<int64_t>>();
+    indices = matrix.attr("indices").cast<contiguous_array<int64_t>>();
+    indptr = matrix.attr("indptr").cast<contiguous_array<int64_t>>();
 
     py::tuple shape = matrix.attr("shape");
     num_rows = shape[0].cast<size_t>();  // The number of nodes in the matching graph
@@ -45,6 +61,10 @@ pm_pybind::CompressedSparseColumnCheckMatrix::CompressedSparseColumnCheckMatrix(
             "`matrix.indptr` size (" + std::to_string(indptr.size()) + ") must be 1 larger than number of columns (" +
             std::to_string(num_cols) + ").");
 
+    // Check the number of nonzero elements given by indptr is consistent with indices
+    if (indptr.at(num_cols) > indices.size())
+        throw std::invalid_argument("`matrix.indptr` elements must not exceed size of `matrix.indices`");
+
     // Check data is the same size as indices
     if (data_unchecked.size() != indices.size())
         throw std::invalid_argument("`matrix.data` must be the same size as `matrix.indices`");
@@ -63,6 +83,10 @@ pm_pybind::CompressedSparseColumnCheckMatrix::CompressedSparseColumnCheckMatrix(
     }
 }
 
+pm::CscBinaryMatrix pm_pybind::CompressedSparseColumnCheckMatrix::view() const {
+    return {num_rows, num_cols, indptr.data(), indices.data()};
+}
+
 py::class_<pm::UserGraph> pm_pybind::pybind_user_graph(py::module &m) {
     auto g = py::class_<pm::UserGraph>(m, "MatchingGraph");
     return g;
@@ -83,6 +107,87 @@ pm::MERGE_STRATEGY merge_strategy_from_string(const std::string &merge_strategy)
     }
 }
 
+/// Checks that a 2D `shots` array has a valid number of columns for the graph.
+void check_shots_shape(pm::UserGraph &self, const py::array_t<uint8_t> &shots, bool bit_packed_shots) {
+    if (shots.ndim() != 2)
+        throw std::invalid_argument("`shots` array should have two dimensions, not " + std::to_string(shots.ndim()));
+    if (bit_packed_shots) {
+        size_t cols_min = (self.get_num_detectors() + 7) >> 3;
+        size_t cols_max = (self.get_num_nodes() + 7) >> 3;
+        if (shots.shape(1) < cols_min || shots.shape(1) > cols_max)
+            throw std::invalid_argument(
+                "bit_packed `shots` array should have at least " + std::to_string(cols_min) +
+                " columns (ceil(num_detectors/8)) and at most " + std::to_string(cols_max) +
+                " columns, (ceil(num_nodes/8)). Instead it has " + std::to_string(shots.shape(1)) + " columns.");
+    } else {
+        if (shots.shape(1) < self.get_num_detectors() || shots.shape(1) > self.get_num_nodes())
+            throw std::invalid_argument(
+                "`shots` array should have at least " + std::to_string(self.get_num_detectors()) +
+                " columns (the number of "
+                "detectors), and no more than " +
+                std::to_string(self.get_num_nodes()) + " columns (the number of nodes), but instead has " +
+                std::to_string(shots.shape(1)) + " columns");
+    }
+}
+
+/// Appends the indices of the detection events in row `i' of a 2D `shots' array to `detection_events'. Only reads
+/// the array data, so may be called without holding the GIL.
+void append_detection_events_of_shot(
+    const py::detail::unchecked_reference<uint8_t, 2> &s,
+    size_t i,
+    bool bit_packed_shots,
+    std::vector<uint64_t> &detection_events) {
+    // Rows that are contiguous in memory can be scanned a word at a time.
+    bool row_is_contiguous = s.shape(1) <= 1 || s.data(i, 1) == s.data(i, 0) + 1;
+    if (row_is_contiguous) {
+        if (bit_packed_shots) {
+            pm::append_set_bit_indices(s.data(i, 0), s.shape(1), detection_events);
+        } else {
+            pm::append_nonzero_byte_indices(s.data(i, 0), s.shape(1), detection_events);
+        }
+    } else if (bit_packed_shots) {
+        for (py::ssize_t j = 0; j < s.shape(1); j++) {
+            size_t bit_offset = j << 3;
+            for (size_t r = 0; r < 8; r++) {
+                if (s(i, j) & (1 << r))
+                    detection_events.push_back(bit_offset + r);
+            }
+        }
+    } else {
+        for (py::ssize_t j = 0; j < s.shape(1); j++) {
+            if (s(i, j))
+                detection_events.push_back(j);
+        }
+    }
+}
+
+/// Converts a flat vector of node index pairs, and the offsets of the pairs of each shot, into a (offsets, pairs)
+/// tuple of numpy arrays, with `pairs' of shape (num_pairs, 2).
+py::tuple pairs_and_offsets_to_arrays(std::vector<int64_t> *pairs, std::vector<int64_t> *offsets) {
+    auto num_pairs = (py::ssize_t)(pairs->size() / 2);
+    auto pairs_arr = pm_pybind::vec_to_array<int64_t>(pairs);
+    pairs_arr.resize({num_pairs, (py::ssize_t)2});
+    return py::make_tuple(pm_pybind::vec_to_array<int64_t>(offsets), pairs_arr);
+}
+
+std::string read_text_file(const char *path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::stringstream msg;
+        msg << "Failed to open '" << path << "'";
+        throw std::invalid_argument(msg.str());
+    }
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return contents.str();
+}
+
+/// Graph files don't hold the correlations between edges, so graphs with correlations enabled can't be cached.
+void check_cache_dir_without_correlations(bool enable_correlations) {
+    if (enable_correlations)
+        throw std::invalid_argument("A graph cache directory can't be used with enable_correlations=True.");
+}
+
 void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGraph> &g) {
     g.def(py::init<>());
     g.def(py::init<size_t>(), "num_nodes"_a);
@@ -149,12 +254,144 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
         "weight"_a,
         "error_probability"_a,
         "merge_strategy"_a);
+    g.def(
+        "add_edges",
+        [](pm::UserGraph &self,
+           const py::array_t<int64_t> &node1,
+           const py::array_t<int64_t> &node2,
+           const py::array_t<int64_t> &observables,
+           const py::array_t<double> &weights,
+           const py::array_t<double> &error_probabilities,
+           const std::string &merge_strategy) {
+            if (node1.ndim() != 1 || node2.ndim() != 1 || weights.ndim() != 1 || error_probabilities.ndim() != 1)
+                throw std::invalid_argument(
+                    "`node1`, `node2`, `weights` and `error_probabilities` must be 1D arrays.");
+            py::ssize_t num_edges = node1.shape(0);
+            if (node2.shape(0) != num_edges || weights.shape(0) != num_edges ||
+                error_probabilities.shape(0) != num_edges)
+                throw std::invalid_argument(
+                    "`node1`, `node2`, `weights` and `error_probabilities` must have the same length.");
+            if (observables.ndim() != 2 || observables.shape(0) != num_edges)
+                throw std::invalid_argument("`observables` must be a 2D array with one row per edge.");
+            auto merge_strategy_enum = merge_strategy_from_string(merge_strategy);
+            auto n1 = node1.unchecked<1>();
+            auto n2 = node2.unchecked<1>();
+            auto o = observables.unchecked<2>();
+            auto w = weights.unchecked<1>();
+            auto p = error_probabilities.unchecked<1>();
+
+            // Node2 of -1 denotes a boundary edge, and observable indices of -1 are padding.
+            std::vector<pm::UserEdge> new_edges;
+            new_edges.reserve(num_edges);
+            size_t num_skipped = 0;
+            for (py::ssize_t i = 0; i < num_edges; i++) {
+                if (n1(i) < 0 || n2(i) < -1)
+                    throw std::invalid_argument("Node indices must be non-negative (or -1 for `node2`).");
+                if (std::abs(w(i)) > pm::MAX_USER_EDGE_WEIGHT) {
+                    num_skipped++;
+                    continue;
+                }
+                std::vector<size_t> edge_observables;
+                for (py::ssize_t k = 0; k < o.shape(1); k++) {
+                    if (o(i, k) >= 0)
+                        edge_observables.push_back(o(i, k));
+                }
+                new_edges.push_back(
+                    {(size_t)n1(i), n2(i) < 0 ? SIZE_MAX : (size_t)n2(i), std::move(edge_observables), w(i), p(i)});
+            }
+            if (num_skipped > 0) {
+                auto warnings = pybind11::module::import("warnings");
+                warnings.attr("warn")(
+                    std::to_string(num_skipped) + " edges have a weight exceeding the maximum edge weight " +
+                    std::to_string(pm::MAX_USER_EDGE_WEIGHT) + " and have not been added to the matching graph.");
+            }
+            self.add_or_merge_edges(new_edges, merge_strategy_enum);
+        },
+        "node1"_a,
+        "node2"_a,
+        "observables"_a,
+        "weights"_a,
+        "error_probabilities"_a,
+        "merge_strategy"_a);
     g.def("set_boundary", &pm::UserGraph::set_boundary, "boundary"_a);
     g.def("get_boundary", &pm::UserGraph::get_boundary);
     g.def("get_num_observables", &pm::UserGraph::get_num_observables);
     g.def("set_min_num_observables", &pm::UserGraph::set_min_num_observables, "num_observables"_a);
     g.def("get_num_nodes", &pm::UserGraph::get_num_nodes);
     g.def("get_num_edges", &pm::UserGraph::get_num_edges);
+    g.def("freeze", &pm::UserGraph::freeze);
+    g.def("is_frozen", &pm::UserGraph::is_frozen);
+    g.def("set_syndrome_cache_capacity", &pm::UserGraph::set_syndrome_cache_capacity, "capacity"_a);
+    g.def("get_syndrome_cache_capacity", &pm::UserGraph::get_syndrome_cache_capacity);
+    g.def("get_syndrome_cache_counts", &pm::UserGraph::get_syndrome_cache_counts);
+    g.def("set_num_path_threads", &pm::UserGraph::set_num_path_threads, "num_threads"_a);
+    g.def("get_num_path_threads", &pm::UserGraph::get_num_path_threads);
+    g.def(
+        "set_decoder_engine",
+        [](pm::UserGraph &self, const std::string &engine) {
+            self.set_decoder_engine(pm::decoder_engine_from_string(engine));
+        },
+        "engine"_a);
+    g.def("get_decoder_engine", [](const pm::UserGraph &self) {
+        return pm::decoder_engine_name(self.get_decoder_engine());
+    });
+    g.def(
+        "set_predecoder_mode",
+        [](pm::UserGraph &self, const std::string &mode) {
+            self.set_predecoder_mode(pm::predecoder_mode_from_string(mode));
+        },
+        "mode"_a);
+    g.def("get_predecoder_mode", [](const pm::UserGraph &self) {
+        return pm::predecoder_mode_name(self.get_predecoder_mode());
+    });
+    g.def(
+        "set_work_budget",
+        [](pm::UserGraph &self, size_t max_flood_check_events, uint64_t max_nanoseconds) {
+            self.set_work_budget(pm::WorkBudget{max_flood_check_events, max_nanoseconds});
+        },
+        "max_flood_check_events"_a,
+        "max_nanoseconds"_a);
+    g.def("get_work_budget", [](const pm::UserGraph &self) {
+        auto budget = self.get_work_budget();
+        return std::make_pair(budget.max_flood_check_events, budget.max_nanoseconds);
+    });
+    g.def("get_num_degraded_shots", &pm::UserGraph::get_num_degraded_shots);
+    g.def(
+        "warm_up",
+        [](pm::UserGraph &self, size_t num_mwpms, size_t num_shots, size_t expected_detection_events, uint64_t seed) {
+            std::optional<py::gil_scoped_release> release;
+            if (self.is_frozen())
+                release.emplace();
+            auto capacity = self.warm_up(num_mwpms, num_shots, expected_detection_events, seed);
+            release.reset();
+            return py::dict(
+                "regions"_a = capacity.regions,
+                "alt_tree_nodes"_a = capacity.alt_tree_nodes,
+                "queue_events"_a = capacity.queue_events,
+                "match_edges"_a = capacity.match_edges,
+                "reached_nodes"_a = capacity.reached_nodes,
+                "shatter_stack"_a = capacity.shatter_stack);
+        },
+        "num_mwpms"_a,
+        "num_shots"_a,
+        "expected_detection_events"_a,
+        "seed"_a);
+    g.def("get_memory_usage", [](pm::UserGraph &self) {
+        auto usage = self.get_memory_usage();
+        return py::dict(
+            "user_graph"_a = usage.user_graph,
+            "shared_graph"_a = usage.mwpms.shared_graph,
+            "mapped_graph"_a = usage.mwpms.mapped_graph,
+            "matching_graph"_a = usage.mwpms.matching_graph,
+            "search_graph"_a = usage.mwpms.search_graph,
+            "decoder_state"_a = usage.mwpms.decoder_state,
+            "auxiliary"_a = usage.mwpms.auxiliary,
+            "total"_a = usage.total(),
+            "num_decoders"_a = usage.num_mwpms,
+            "max_regions"_a = usage.max_capacity.regions,
+            "max_alt_tree_nodes"_a = usage.max_capacity.alt_tree_nodes,
+            "max_queue_events"_a = usage.max_capacity.queue_events);
+    });
     g.def("get_num_detectors", &pm::UserGraph::get_num_detectors);
     g.def("all_edges_have_error_probabilities", &pm::UserGraph::all_edges_have_error_probabilities);
     g.def("add_noise", [](pm::UserGraph &self) {
@@ -175,17 +412,76 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
         std::pair<py::array_t<std::uint8_t>, py::array_t<std::uint8_t>> res = {error_arr, syndrome_arr};
         return res;
     });
+    g.def(
+        "add_noise_batch",
+        [](pm::UserGraph &self, size_t num_shots, uint64_t seed) {
+            py::array_t<uint8_t> syndromes(
+                {(py::ssize_t)num_shots, (py::ssize_t)((self.get_num_nodes() + 7) >> 3)});
+            py::array_t<uint8_t> observables(
+                {(py::ssize_t)num_shots, (py::ssize_t)((self.get_num_observables() + 7) >> 3)});
+            uint8_t *syndromes_ptr = syndromes.mutable_data();
+            uint8_t *observables_ptr = observables.mutable_data();
+            {
+                py::gil_scoped_release release;
+                self.add_noise_batch(num_shots, seed, syndromes_ptr, observables_ptr);
+            }
+            return std::make_pair(syndromes, observables);
+        },
+        "num_shots"_a,
+        "seed"_a);
     g.def(
         "decode",
-        [](pm::UserGraph &self, const py::array_t<uint64_t> &detection_events) {
-            std::vector<uint64_t> detection_events_vec(
-                detection_events.data(), detection_events.data() + detection_events.size());
-            auto &mwpm = self.get_mwpm();
-            auto obs_crossed = new std::vector<uint8_t>(self.get_num_observables(), 0);
+        [](pm::UserGraph &self,
+           const py::array_t<uint64_t, py::array::c_style | py::array::forcecast> &detection_events,
+           bool enable_correlations,
+           const py::object &out) {
+            // The detection events are read in place, and with `out' the observables are written in place, so that
+            // a warmed-up decoder doesn't allocate for each call.
+            std::span<const uint64_t> detection_events_span(detection_events.data(), detection_events.size());
+            size_t num_observables = self.get_num_observables();
+            std::optional<py::array_t<uint8_t, py::array::c_style>> out_arr;
+            if (!out.is_none()) {
+                if (!py::isinstance<py::array_t<uint8_t, py::array::c_style>>(out))
+                    throw std::invalid_argument("`out` must be a C-contiguous numpy array with dtype uint8.");
+                out_arr = out.cast<py::array_t<uint8_t, py::array::c_style>>();
+                if (out_arr->ndim() != 1 || (size_t)out_arr->shape(0) != num_observables)
+                    throw std::invalid_argument(
+                        "`out` must be a 1D array with one element per observable (" +
+                        std::to_string(num_observables) + ").");
+            }
+            auto mwpm = self.acquire_mwpm();
+            std::vector<uint8_t> *obs_crossed = nullptr;
+            uint8_t *obs_begin_ptr;
+            if (out_arr) {
+                obs_begin_ptr = out_arr->mutable_data();
+                std::fill(obs_begin_ptr, obs_begin_ptr + num_observables, 0);
+            } else {
+                obs_crossed = new std::vector<uint8_t>(num_observables, 0);
+                obs_begin_ptr = obs_crossed->data();
+            }
             pm::total_weight_int weight = 0;
-            pm::decode_detection_events(mwpm, detection_events_vec, obs_crossed->data(), weight);
-            double rescaled_weight = (double)weight / mwpm.flooder.graph.normalising_constant;
+            try {
+                if (enable_correlations) {
+                    std::vector<uint64_t> detection_events_vec(
+                        detection_events_span.begin(), detection_events_span.end());
+                    self.decode_correlated(detection_events_vec, obs_begin_ptr, weight);
+                } else {
+                    // A frozen graph can be decoded by other threads at the same time, each with its own Mwpm.
+                    std::optional<py::gil_scoped_release> release;
+                    if (self.is_frozen())
+                        release.emplace();
+                    pm::decode_detection_events(*mwpm, detection_events_span, obs_begin_ptr, weight);
+                }
+            } catch (...) {
+                delete obs_crossed;
+                throw;
+            }
+            double rescaled_weight = (double)weight / mwpm->flooder.graph.normalising_constant;
 
+            if (out_arr) {
+                std::pair<py::array_t<std::uint8_t>, double> res = {*out_arr, rescaled_weight};
+                return res;
+            }
             auto err_capsule = py::capsule(obs_crossed, [](void *x) {
                 delete reinterpret_cast<std::vector<uint8_t> *>(x);
             });
@@ -194,16 +490,90 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
             std::pair<py::array_t<std::uint8_t>, double> res = {obs_crossed_arr, rescaled_weight};
             return res;
         },
-        "detection_events"_a);
+        "detection_events"_a,
+        "enable_correlations"_a = false,
+        "out"_a = py::none());
+    g.def(
+        "decode_with_weight_overrides",
+        [](pm::UserGraph &self,
+           const py::array_t<uint64_t> &detection_events,
+           const py::array_t<int64_t> &edges,
+           const py::array_t<double> &weights) {
+            if (edges.ndim() != 2 || edges.shape(1) != 2)
+                throw std::invalid_argument("`edges` must be a 2D array with two columns.");
+            if (weights.ndim() != 1 || weights.shape(0) != edges.shape(0))
+                throw std::invalid_argument("`weights` must be a 1D array with one element per row of `edges`.");
+            std::vector<uint64_t> detection_events_vec(
+                detection_events.data(), detection_events.data() + detection_events.size());
+            auto e = edges.unchecked<2>();
+            auto w = weights.unchecked<1>();
+            std::vector<std::pair<size_t, size_t>> edges_vec;
+            std::vector<double> weights_vec;
+            edges_vec.reserve(e.shape(0));
+            weights_vec.reserve(e.shape(0));
+            for (py::ssize_t i = 0; i < e.shape(0); i++) {
+                if (e(i, 0) < 0)
+                    throw std::invalid_argument("The first node of an edge must not be the boundary (-1).");
+                edges_vec.push_back({(size_t)e(i, 0), e(i, 1) < 0 ? SIZE_MAX : (size_t)e(i, 1)});
+                weights_vec.push_back(w(i));
+            }
+            auto &mwpm = self.get_mwpm();
+            auto obs_crossed = new std::vector<uint8_t>(self.get_num_observables(), 0);
+            pm::total_weight_int weight = 0;
+            try {
+                self.decode_with_weight_overrides(
+                    detection_events_vec, edges_vec, weights_vec, obs_crossed->data(), weight);
+            } catch (...) {
+                delete obs_crossed;
+                throw;
+            }
+            double rescaled_weight = (double)weight / mwpm.flooder.graph.normalising_constant;
+            auto obs_crossed_arr = pm_pybind::vec_to_array<uint8_t>(obs_crossed);
+            std::pair<py::array_t<std::uint8_t>, double> res = {obs_crossed_arr, rescaled_weight};
+            return res;
+        },
+        "detection_events"_a,
+        "edges"_a,
+        "weights"_a);
+    g.def(
+        "decode_with_erasures",
+        [](pm::UserGraph &self,
+           const py::array_t<uint64_t> &detection_events,
+           const pm_pybind::contiguous_array<int64_t> &erased_edges) {
+            std::vector<uint64_t> detection_events_vec(
+                detection_events.data(), detection_events.data() + detection_events.size());
+            std::vector<size_t> erased_edges_vec;
+            erased_edges_vec.reserve(erased_edges.size());
+            for (py::ssize_t i = 0; i < erased_edges.size(); i++) {
+                if (erased_edges.data()[i] < 0)
+                    throw std::invalid_argument("Erased edge indices must be non-negative.");
+                erased_edges_vec.push_back((size_t)erased_edges.data()[i]);
+            }
+            auto &mwpm = self.get_mwpm();
+            auto obs_crossed = new std::vector<uint8_t>(self.get_num_observables(), 0);
+            pm::total_weight_int weight = 0;
+            try {
+                self.decode_with_erasures(detection_events_vec, erased_edges_vec, obs_crossed->data(), weight);
+            } catch (...) {
+                delete obs_crossed;
+                throw;
+            }
+            double rescaled_weight = (double)weight / mwpm.flooder.graph.normalising_constant;
+            auto obs_crossed_arr = pm_pybind::vec_to_array<uint8_t>(obs_crossed);
+            std::pair<py::array_t<std::uint8_t>, double> res = {obs_crossed_arr, rescaled_weight};
+            return res;
+        },
+        "detection_events"_a,
+        "erased_edges"_a);
     g.def(
          "decode_to_edges_array",
          [](pm::UserGraph &self, const py::array_t<uint64_t> &detection_events) {
-             auto &mwpm = self.get_mwpm_with_search_graph();
+             auto mwpm = self.acquire_mwpm(true);
              std::vector<uint64_t> detection_events_vec(
                  detection_events.data(), detection_events.data() + detection_events.size());
              auto edges = new std::vector<int64_t>();
              edges->reserve(detection_events_vec.size() / 2);
-             pm::decode_detection_events_to_edges(mwpm, detection_events_vec, *edges);
+             pm::decode_detection_events_to_edges(*mwpm, detection_events_vec, *edges);
              auto num_edges = edges->size() / 2;
              auto edges_arr = pm_pybind::vec_to_array<int64_t>(edges);
              edges_arr.resize({(py::ssize_t)num_edges, (py::ssize_t)2});
@@ -214,7 +584,8 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
     g.def(
         "decode_to_matched_detection_events_array",
         [](pm::UserGraph &self, const py::array_t<uint64_t> &detection_events) {
-            auto &mwpm = self.get_mwpm();
+            auto mwpm_lease = self.acquire_mwpm();
+            auto &mwpm = *mwpm_lease;
             std::vector<uint64_t> detection_events_vec(
                 detection_events.data(), detection_events.data() + detection_events.size());
             pm::decode_detection_events_to_match_edges(mwpm, detection_events_vec);
@@ -240,28 +611,20 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
         "detection_events"_a);
     g.def(
         "decode_batch",
-        [](pm::UserGraph &self, const py::array_t<uint8_t> &shots, bool bit_packed_shots, bool bit_packed_predictions) {
-            if (shots.ndim() != 2)
+        [](pm::UserGraph &self,
+           const py::array_t<uint8_t> &shots,
+           bool bit_packed_shots,
+           bool bit_packed_predictions,
+           size_t num_threads,
+           bool return_stats,
+           bool return_latencies,
+           bool enable_correlations,
+           bool largest_shots_first,
+           bool return_weights) {
+            check_shots_shape(self, shots, bit_packed_shots);
+            if (return_stats && !pm::DECODER_STATS_ENABLED)
                 throw std::invalid_argument(
-                    "`shots` array should have two dimensions, not " + std::to_string(shots.ndim()));
-            if (bit_packed_shots) {
-                size_t cols_min = (self.get_num_detectors() + 7) >> 3;
-                size_t cols_max = (self.get_num_nodes() + 7) >> 3;
-                if (shots.shape(1) < cols_min || shots.shape(1) > cols_max)
-                    throw std::invalid_argument(
-                        "bit_packed `shots` array should have at least " + std::to_string(cols_min) +
-                        " columns (ceil(num_detectors/8)) and at most " + std::to_string(cols_max) +
-                        " columns, (ceil(num_nodes/8)). Instead it has " + std::to_string(shots.shape(1)) +
-                        " columns.");
-            } else {
-                if (shots.shape(1) < self.get_num_detectors() || shots.shape(1) > self.get_num_nodes())
-                    throw std::invalid_argument(
-                        "`shots` array should have at least " + std::to_string(self.get_num_detectors()) +
-                        " columns (the number of "
-                        "detectors), and no more than " +
-                        std::to_string(self.get_num_nodes()) + " columns (the number of nodes), but instead has " +
-                        std::to_string(shots.shape(1)) + " columns");
-            }
+                    "Decoder stats are not available, since PyMatching was built without PYMATCHING_DECODER_STATS.");
 
             // Reserve all-zeros predictions array
             size_t num_observable_bytes =
@@ -271,61 +634,894 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
             py::buffer_info buff = predictions.request();
             uint8_t *predictions_ptr = (uint8_t *)buff.ptr;
 
-            // Reserve weights array
-            py::array_t<double> weights = py::array_t<double>(shots.shape(0));
+            // Reserve weights array, which is left empty if the weights aren't returned
+            py::array_t<double> weights = py::array_t<double>(return_weights ? shots.shape(0) : 0);
             auto ws = weights.mutable_unchecked<1>();
 
-            auto &mwpm = self.get_mwpm();
-            std::vector<uint64_t> detection_events;
+            // Reserve the stats array, with a row of `pm::DecoderStats::values()' for each shot
+            py::array_t<uint64_t> stats = py::array_t<uint64_t>(std::vector<py::ssize_t>{
+                (py::ssize_t)(return_stats ? shots.shape(0) : 0), (py::ssize_t)pm::DecoderStats::NUM_FIELDS});
+            auto st = stats.mutable_unchecked<2>();
 
-            // Vector used to extract predicted observables when decoding if bit_packed_predictions is true
-            std::vector<uint8_t> temp_predictions;
-            if (bit_packed_predictions)
-                temp_predictions.resize(self.get_num_observables());
+            // Reserve the latencies array, with the total latency and the latency of each phase of
+            // `pm::DecodePhaseTimes' (in the order of `pm::DecodeLatencyHistograms::PHASE_NAMES') for each shot
+            py::array_t<uint64_t> latencies = py::array_t<uint64_t>(std::vector<py::ssize_t>{
+                (py::ssize_t)(return_latencies ? shots.shape(0) : 0),
+                (py::ssize_t)pm::DecodeLatencyHistograms::PHASE_NAMES.size()});
+            auto lt = latencies.mutable_unchecked<2>();
 
-            // Iterate over the shots, getting detection events and decoding
+            size_t num_shots = shots.shape(0);
+            size_t num_workers = std::max<size_t>(1, std::min<size_t>(num_threads, num_shots));
+            // Correlated decoding temporarily overrides the weights of the graph itself, so it uses a single thread.
+            if (enable_correlations)
+                num_workers = 1;
+            // A frozen graph lends each worker a Mwpm from its pool, so that other threads can decode it too.
+            std::vector<pm::MwpmLease> mwpm_leases;
+            std::vector<pm::Mwpm *> mwpms;
+            if (self.is_frozen()) {
+                for (size_t w = 0; w < num_workers; w++) {
+                    mwpm_leases.push_back(self.acquire_mwpm());
+                    mwpms.push_back(&*mwpm_leases.back());
+                }
+            } else {
+                mwpms = self.get_mwpms(num_workers);
+            }
+            size_t num_observables = self.get_num_observables();
+            double normalising_constant = mwpms[0]->flooder.graph.normalising_constant;
             auto s = shots.unchecked<2>();
-            for (py::ssize_t i = 0; i < s.shape(0); i++) {
-                if (bit_packed_shots) {
-                    for (py::ssize_t j = 0; j < s.shape(1); j++) {
-                        size_t bit_offset = j << 3;
-                        for (size_t r = 0; r < 8; r++) {
-                            if (s(i, j) & (1 << r))
-                                detection_events.push_back(bit_offset + r);
+
+            // Workers take shots from the scheduler in small ranges (stealing them from each other once their own
+            // shots run out) and write directly into the output arrays. Each shot is decoded by exactly one worker,
+            // so no other synchronisation is needed.
+            pm::ShotScheduler scheduler(num_shots, num_workers);
+            if (largest_shots_first && num_shots > 1) {
+                // The number of detection events of a shot is a proxy for the cost of decoding it.
+                std::vector<size_t> costs(num_shots);
+                std::vector<uint64_t> detection_events;
+                for (size_t i = 0; i < num_shots; i++) {
+                    append_detection_events_of_shot(s, i, bit_packed_shots, detection_events);
+                    costs[i] = detection_events.size();
+                    detection_events.clear();
+                }
+                scheduler.order_by_decreasing_cost(costs);
+            }
+            auto decode_shots_of_worker = [&](pm::Mwpm &mwpm, size_t worker) {
+                std::vector<uint64_t> detection_events;
+
+                // Vector used to extract predicted observables when decoding if bit_packed_predictions is true
+                std::vector<uint8_t> temp_predictions;
+                if (bit_packed_predictions)
+                    temp_predictions.resize(num_observables);
+
+                // Iterate over the shots, getting detection events and decoding
+                size_t begin, end;
+                while (scheduler.next_range(worker, begin, end)) {
+                    for (size_t p = begin; p < end; p++) {
+                        size_t i = scheduler.shot_at(p);
+                        std::chrono::steady_clock::time_point shot_start;
+                        pm::DecodePhaseTimes phase_times;
+                        pm::DecodePhaseTimes *phase_times_ptr = nullptr;
+                        if (return_latencies) {
+                            shot_start = std::chrono::steady_clock::now();
+                            phase_times_ptr = &phase_times;
                         }
-                    }
-                } else {
-                    for (py::ssize_t j = 0; j < s.shape(1); j++) {
-                        if (s(i, j))
-                            detection_events.push_back(j);
+                        append_detection_events_of_shot(s, i, bit_packed_shots, detection_events);
+                        if (return_latencies)
+                            phase_times.syndrome_extraction_ns = pm::nanoseconds_since(shot_start);
+                        pm::total_weight_int solution_weight = 0;
+                        if (return_stats)
+                            mwpm.flooder.stats.clear();
+                        if (bit_packed_predictions) {
+                            std::fill(temp_predictions.begin(), temp_predictions.end(), 0);
+                            if (enable_correlations) {
+                                self.decode_correlated(detection_events, temp_predictions.data(), solution_weight);
+                            } else {
+                                pm::decode_detection_events(
+                                    mwpm,
+                                    detection_events,
+                                    temp_predictions.data(),
+                                    solution_weight,
+                                    phase_times_ptr);
+                            }
+                            // bitpack the predictions
+                            for (size_t k = 0; k < temp_predictions.size(); k++) {
+                                size_t arr_idx = k >> 3;
+                                *(predictions_ptr + (num_observable_bytes * i) + arr_idx) ^=
+                                    (temp_predictions[k] << (k % 8));
+                            }
+                        } else if (enable_correlations) {
+                            self.decode_correlated(
+                                detection_events, predictions_ptr + (num_observable_bytes * i), solution_weight);
+                        } else {
+                            pm::decode_detection_events(
+                                mwpm,
+                                detection_events,
+                                predictions_ptr + (num_observable_bytes * i),
+                                solution_weight,
+                                phase_times_ptr);
+                        }
+                        if (return_weights)
+                            ws(i) = (double)solution_weight / normalising_constant;
+                        if (return_latencies) {
+                            lt(i, 0) = pm::nanoseconds_since(shot_start);
+                            lt(i, 1) = phase_times.syndrome_extraction_ns;
+                            lt(i, 2) = phase_times.flooding_ns;
+                            lt(i, 3) = phase_times.result_extraction_ns;
+                        }
+                        if (return_stats) {
+                            auto values = mwpm.flooder.stats.values();
+                            for (size_t k = 0; k < values.size(); k++)
+                                st(i, k) = values[k];
+                        }
+                        detection_events.clear();
                     }
                 }
-                pm::total_weight_int solution_weight = 0;
-                if (bit_packed_predictions) {
-                    std::fill(temp_predictions.begin(), temp_predictions.end(), 0);
-                    pm::decode_detection_events(mwpm, detection_events, temp_predictions.data(), solution_weight);
-                    // bitpack the predictions
-                    for (size_t k = 0; k < temp_predictions.size(); k++) {
-                        size_t arr_idx = k >> 3;
-                        *(predictions_ptr + (num_observable_bytes * i) + arr_idx) ^= (temp_predictions[k] << (k % 8));
+            };
+
+            if (num_workers == 1) {
+                std::optional<py::gil_scoped_release> release;
+                if (self.is_frozen())
+                    release.emplace();
+                decode_shots_of_worker(*mwpms[0], 0);
+            } else {
+                // Decode the shots with one thread per worker, without the GIL.
+                std::vector<std::exception_ptr> errors(num_workers);
+                {
+                    py::gil_scoped_release release;
+                    std::vector<std::thread> workers;
+                    workers.reserve(num_workers);
+                    for (size_t w = 0; w < num_workers; w++) {
+                        workers.emplace_back([&, w]() {
+                            try {
+                                decode_shots_of_worker(*mwpms[w], w);
+                            } catch (...) {
+                                errors[w] = std::current_exception();
+                            }
+                        });
                     }
-                } else {
-                    pm::decode_detection_events(
-                        mwpm, detection_events, predictions_ptr + (num_observable_bytes * i), solution_weight);
+                    for (auto &worker : workers)
+                        worker.join();
+                }
+                for (auto &error : errors) {
+                    if (error)
+                        std::rethrow_exception(error);
                 }
-                ws(i) = (double)solution_weight / mwpm.flooder.graph.normalising_constant;
-                detection_events.clear();
             }
             predictions.resize({(py::ssize_t)shots.shape(0), (py::ssize_t)num_observable_bytes});
+            return py::make_tuple(
+                predictions,
+                weights,
+                return_stats ? py::object(stats) : py::none(),
+                return_latencies ? py::object(latencies) : py::none());
+        },
+        "shots"_a,
+        "bit_packed_shots"_a = false,
+        "bit_packed_predictions"_a = false,
+        "num_threads"_a = 1,
+        "return_stats"_a = false,
+        "return_latencies"_a = false,
+        "enable_correlations"_a = false,
+        "largest_shots_first"_a = false,
+        "return_weights"_a = true);
+    g.def(
+        "decode_batch_transposed",
+        [](pm::UserGraph &self,
+           const py::array_t<uint8_t, py::array::c_style | py::array::forcecast> &shots,
+           size_t num_threads,
+           bool return_weights) {
+            // Row d of `shots' holds the bit of detector d for every shot, bit-packed in little endian order.
+            if (shots.ndim() != 2)
+                throw std::invalid_argument(
+                    "`shots` array should have two dimensions, not " + std::to_string(shots.ndim()));
+            size_t num_rows = shots.shape(0);
+            size_t row_bytes = shots.shape(1);
+            if (num_rows < self.get_num_detectors() || num_rows > self.get_num_nodes())
+                throw std::invalid_argument(
+                    "transposed `shots` array should have at least " + std::to_string(self.get_num_detectors()) +
+                    " rows (the number of detectors), and no more than " + std::to_string(self.get_num_nodes()) +
+                    " rows (the number of nodes), but instead has " + std::to_string(num_rows) + " rows");
+            size_t num_shots = row_bytes * 8;
+            size_t num_observables = self.get_num_observables();
+
+            // The predictions are transposed in the same way, with a row of bit-packed shots per observable.
+            py::array_t<uint8_t> predictions(
+                std::vector<py::ssize_t>{(py::ssize_t)num_observables, (py::ssize_t)row_bytes});
+            predictions[py::make_tuple(py::ellipsis())] = 0;
+            uint8_t *predictions_ptr = predictions.mutable_data();
+            py::array_t<double> weights = py::array_t<double>(return_weights ? num_shots : 0);
+            double *weights_ptr = weights.mutable_data();
+            const uint8_t *shots_ptr = shots.data();
+
+            // Each worker decodes whole blocks of 64 shots, which write to disjoint bytes of the predictions.
+            size_t num_blocks = (num_shots + 63) / 64;
+            size_t num_workers = std::max<size_t>(1, std::min<size_t>(num_threads, num_blocks));
+            std::vector<pm::MwpmLease> mwpm_leases;
+            std::vector<pm::Mwpm *> mwpms;
+            if (self.is_frozen()) {
+                for (size_t w = 0; w < num_workers; w++) {
+                    mwpm_leases.push_back(self.acquire_mwpm());
+                    mwpms.push_back(&*mwpm_leases.back());
+                }
+            } else {
+                mwpms = self.get_mwpms(num_workers);
+            }
+            double normalising_constant = mwpms[0]->flooder.graph.normalising_constant;
+            pm::ShotScheduler scheduler(num_blocks, num_workers);
+            auto decode_blocks_of_worker = [&](pm::Mwpm &mwpm, size_t worker) {
+                std::array<std::vector<uint64_t>, 64> block_detection_events;
+                std::vector<uint8_t> obs_crossed(num_observables);
+                size_t begin, end;
+                while (scheduler.next_range(worker, begin, end)) {
+                    for (size_t b = begin; b < end; b++) {
+                        size_t first_shot = b * 64;
+                        size_t n = std::min<size_t>(64, num_shots - first_shot);
+                        for (auto &detection_events : block_detection_events)
+                            detection_events.clear();
+                        pm::scatter_detector_major_bits(
+                            shots_ptr, row_bytes, num_rows, first_shot, n, block_detection_events.data());
+                        for (size_t k = 0; k < n; k++) {
+                            size_t shot = first_shot + k;
+                            std::fill(obs_crossed.begin(), obs_crossed.end(), 0);
+                            pm::total_weight_int solution_weight = 0;
+                            pm::decode_detection_events(
+                                mwpm, block_detection_events[k], obs_crossed.data(), solution_weight);
+                            for (size_t o = 0; o < num_observables; o++)
+                                predictions_ptr[o * row_bytes + (shot >> 3)] |= (obs_crossed[o] & 1) << (shot & 7);
+                            if (return_weights)
+                                weights_ptr[shot] = (double)solution_weight / normalising_constant;
+                        }
+                    }
+                }
+            };
+
+            if (num_workers == 1) {
+                std::optional<py::gil_scoped_release> release;
+                if (self.is_frozen())
+                    release.emplace();
+                decode_blocks_of_worker(*mwpms[0], 0);
+            } else {
+                std::vector<std::exception_ptr> errors(num_workers);
+                {
+                    py::gil_scoped_release release;
+                    std::vector<std::thread> workers;
+                    workers.reserve(num_workers);
+                    for (size_t w = 0; w < num_workers; w++) {
+                        workers.emplace_back([&, w]() {
+                            try {
+                                decode_blocks_of_worker(*mwpms[w], w);
+                            } catch (...) {
+                                errors[w] = std::current_exception();
+                            }
+                        });
+                    }
+                    for (auto &worker : workers)
+                        worker.join();
+                }
+                for (auto &error : errors) {
+                    if (error)
+                        std::rethrow_exception(error);
+                }
+            }
+            return py::make_tuple(predictions, weights);
+        },
+        "shots"_a,
+        "num_threads"_a = 1,
+        "return_weights"_a = true);
+    g.def(
+        "decode_batch_bit_packed",
+        [](pm::UserGraph &self,
+           const py::array_t<uint8_t> &shots,
+           size_t num_observables,
+           size_t num_threads) {
+            // Row i of `shots' holds the bit-packed detection events of shot i, as in sinter and stim's `b8' format,
+            // and the predictions are returned bit-packed in the same way, with at least `num_observables' bits per
+            // shot. The rows are decoded in place, unless they first need to be copied to make them contiguous.
+            check_shots_shape(self, shots, true);
+            auto contiguous_shots = py::array_t<uint8_t, py::array::c_style>::ensure(shots);
+            size_t num_shots = shots.shape(0);
+            size_t num_shot_bytes = shots.shape(1);
+            size_t num_prediction_bytes = (std::max(num_observables, self.get_num_observables()) + 7) >> 3;
+            py::array_t<uint8_t> predictions(
+                std::vector<py::ssize_t>{(py::ssize_t)num_shots, (py::ssize_t)num_prediction_bytes});
+            uint8_t *predictions_ptr = predictions.mutable_data();
+            const uint8_t *shots_ptr = contiguous_shots.data();
+
+            size_t num_workers = std::max<size_t>(1, std::min<size_t>(num_threads, num_shots));
+            std::vector<pm::MwpmLease> mwpm_leases;
+            std::vector<pm::Mwpm *> mwpms;
+            if (self.is_frozen()) {
+                for (size_t w = 0; w < num_workers; w++) {
+                    mwpm_leases.push_back(self.acquire_mwpm());
+                    mwpms.push_back(&*mwpm_leases.back());
+                }
+            } else {
+                mwpms = self.get_mwpms(num_workers);
+            }
+            std::optional<py::gil_scoped_release> release;
+            if (self.is_frozen() || num_workers > 1)
+                release.emplace();
+            pm::decode_bit_packed_shots(
+                mwpms, shots_ptr, num_shots, num_shot_bytes, predictions_ptr, num_prediction_bytes);
+            release.reset();
+            return predictions;
+        },
+        "shots"_a,
+        "num_observables"_a = 0,
+        "num_threads"_a = 1);
+    g.def(
+        "decode_bit_packed_shot_file",
+        [](pm::UserGraph &self,
+           size_t num_shots,
+           const std::string &dets_b8_path,
+           size_t num_detectors,
+           const std::string &predictions_b8_path,
+           size_t num_observables,
+           size_t num_threads) {
+            if (num_observables < self.get_num_observables())
+                throw std::invalid_argument(
+                    "The predictions file needs at least " + std::to_string(self.get_num_observables()) +
+                    " observables per shot (the number of observables of the graph), but num_observables is " +
+                    std::to_string(num_observables) + ".");
+            size_t num_workers = std::max<size_t>(1, std::min<size_t>(num_threads, num_shots));
+            std::vector<pm::MwpmLease> mwpm_leases;
+            std::vector<pm::Mwpm *> mwpms;
+            if (self.is_frozen()) {
+                for (size_t w = 0; w < num_workers; w++) {
+                    mwpm_leases.push_back(self.acquire_mwpm());
+                    mwpms.push_back(&*mwpm_leases.back());
+                }
+            } else {
+                mwpms = self.get_mwpms(num_workers);
+            }
+            std::optional<py::gil_scoped_release> release;
+            if (self.is_frozen() || num_workers > 1)
+                release.emplace();
+            pm::decode_bit_packed_shot_file(
+                mwpms, num_shots, dets_b8_path, num_detectors, predictions_b8_path, num_observables);
+        },
+        "num_shots"_a,
+        "dets_b8_path"_a,
+        "num_detectors"_a,
+        "predictions_b8_path"_a,
+        "num_observables"_a,
+        "num_threads"_a = 1);
+    g.def(
+        "decode_batch_sparse",
+        [](pm::UserGraph &self,
+           const pm_pybind::contiguous_array<uint64_t> &indptr,
+           const py::array &indices,
+           bool bit_packed_predictions,
+           size_t num_threads,
+           bool return_weights) {
+            // The detection events of shot k are `indices[indptr[k]:indptr[k + 1]]', as for the rows of a
+            // `scipy.sparse.csr_matrix'. uint64 indices are decoded in place, and uint32 indices are widened one shot
+            // at a time, so neither is ever densified into a row of the syndrome.
+            if (indptr.ndim() != 1 || indptr.shape(0) < 1)
+                throw std::invalid_argument("`indptr` should be a 1D array of length num_shots + 1.");
+            if (indices.ndim() != 1)
+                throw std::invalid_argument(
+                    "`indices` array should have one dimension, not " + std::to_string(indices.ndim()));
+            const uint64_t *indices64 = nullptr;
+            const uint32_t *indices32 = nullptr;
+            bool is_contiguous = indices.flags() & py::array::c_style;
+            if (is_contiguous && indices.dtype().is(py::dtype::of<uint64_t>()))
+                indices64 = static_cast<const uint64_t *>(indices.data());
+            else if (is_contiguous && indices.dtype().is(py::dtype::of<uint32_t>()))
+                indices32 = static_cast<const uint32_t *>(indices.data());
+            else
+                throw std::invalid_argument("`indices` should be a contiguous array of dtype uint32 or uint64.");
+            size_t num_shots = indptr.shape(0) - 1;
+            const uint64_t *indptr_ptr = indptr.data();
+            if (indptr_ptr[0] != 0 || indptr_ptr[num_shots] != (uint64_t)indices.shape(0))
+                throw std::invalid_argument("`indptr` should start at 0 and end at the length of `indices`.");
+            for (size_t k = 0; k < num_shots; k++) {
+                if (indptr_ptr[k] > indptr_ptr[k + 1])
+                    throw std::invalid_argument("`indptr` must be non-decreasing.");
+            }
+
+            size_t num_observables = self.get_num_observables();
+            size_t num_observable_bytes = bit_packed_predictions ? (num_observables + 7) >> 3 : num_observables;
+            py::array_t<uint8_t> predictions = py::array_t<uint8_t>(num_shots * num_observable_bytes);
+            predictions[py::make_tuple(py::ellipsis())] = 0;
+            uint8_t *predictions_ptr = predictions.mutable_data();
+            py::array_t<double> weights = py::array_t<double>(return_weights ? num_shots : 0);
+            double *weights_ptr = weights.mutable_data();
+
+            size_t num_workers = std::max<size_t>(1, std::min<size_t>(num_threads, num_shots));
+            std::vector<pm::MwpmLease> mwpm_leases;
+            std::vector<pm::Mwpm *> mwpms;
+            if (self.is_frozen()) {
+                for (size_t w = 0; w < num_workers; w++) {
+                    mwpm_leases.push_back(self.acquire_mwpm());
+                    mwpms.push_back(&*mwpm_leases.back());
+                }
+            } else {
+                mwpms = self.get_mwpms(num_workers);
+            }
+            double normalising_constant = mwpms[0]->flooder.graph.normalising_constant;
+            pm::ShotScheduler scheduler(num_shots, num_workers);
+            auto decode_shots_of_worker = [&](pm::Mwpm &mwpm, size_t worker) {
+                std::vector<uint64_t> widened_detection_events;
+                std::vector<uint8_t> temp_predictions;
+                if (bit_packed_predictions)
+                    temp_predictions.resize(num_observables);
+                size_t begin, end;
+                while (scheduler.next_range(worker, begin, end)) {
+                    for (size_t i = begin; i < end; i++) {
+                        std::span<const uint64_t> detection_events;
+                        if (indices64 != nullptr) {
+                            detection_events = {indices64 + indptr_ptr[i], indices64 + indptr_ptr[i + 1]};
+                        } else {
+                            widened_detection_events.assign(indices32 + indptr_ptr[i], indices32 + indptr_ptr[i + 1]);
+                            detection_events = widened_detection_events;
+                        }
+                        pm::total_weight_int solution_weight = 0;
+                        uint8_t *shot_predictions = predictions_ptr + num_observable_bytes * i;
+                        if (bit_packed_predictions) {
+                            std::fill(temp_predictions.begin(), temp_predictions.end(), 0);
+                            pm::decode_detection_events(
+                                mwpm, detection_events, temp_predictions.data(), solution_weight);
+                            for (size_t k = 0; k < num_observables; k++)
+                                shot_predictions[k >> 3] ^= (temp_predictions[k] & 1) << (k & 7);
+                        } else {
+                            pm::decode_detection_events(mwpm, detection_events, shot_predictions, solution_weight);
+                        }
+                        if (return_weights)
+                            weights_ptr[i] = (double)solution_weight / normalising_constant;
+                    }
+                }
+            };
+
+            if (num_workers == 1) {
+                std::optional<py::gil_scoped_release> release;
+                if (self.is_frozen())
+                    release.emplace();
+                decode_shots_of_worker(*mwpms[0], 0);
+            } else {
+                std::vector<std::exception_ptr> errors(num_workers);
+                {
+                    py::gil_scoped_release release;
+                    std::vector<std::thread> workers;
+                    workers.reserve(num_workers);
+                    for (size_t w = 0; w < num_workers; w++) {
+                        workers.emplace_back([&, w]() {
+                            try {
+                                decode_shots_of_worker(*mwpms[w], w);
+                            } catch (...) {
+                                errors[w] = std::current_exception();
+                            }
+                        });
+                    }
+                    for (auto &worker : workers)
+                        worker.join();
+                }
+                for (auto &error : errors) {
+                    if (error)
+                        std::rethrow_exception(error);
+                }
+            }
+            predictions.resize({(py::ssize_t)num_shots, (py::ssize_t)num_observable_bytes});
             return py::make_tuple(predictions, weights);
         },
+        "indptr"_a,
+        "indices"_a,
+        "bit_packed_predictions"_a = false,
+        "num_threads"_a = 1,
+        "return_weights"_a = true);
+    g.def(
+        "count_logical_errors",
+        [](pm::UserGraph &self,
+           const py::array_t<uint8_t> &shots,
+           const py::array_t<uint8_t> &actual_observables,
+           bool bit_packed_shots,
+           bool bit_packed_observables,
+           size_t num_threads) {
+            check_shots_shape(self, shots, bit_packed_shots);
+            size_t num_shots = shots.shape(0);
+            size_t num_observables = self.get_num_observables();
+            size_t num_observable_columns = bit_packed_observables ? (num_observables + 7) >> 3 : num_observables;
+            if (actual_observables.ndim() != 2 || (size_t)actual_observables.shape(0) != num_shots ||
+                (size_t)actual_observables.shape(1) != num_observable_columns)
+                throw std::invalid_argument(
+                    "`actual_observables` array should have shape (" + std::to_string(num_shots) + ", " +
+                    std::to_string(num_observable_columns) + ")" +
+                    (bit_packed_observables ? " (the number of shots, and ceil(num_fault_ids/8))"
+                                            : " (the number of shots, and the number of fault ids)") +
+                    ".");
+
+            // Nothing is returned for each shot: each worker only counts the shots whose predicted observables
+            // differ from the actual ones, in total and for each observable, and the counts are added up at the end.
+            size_t num_workers = std::max<size_t>(1, std::min<size_t>(num_threads, num_shots));
+            std::vector<pm::MwpmLease> mwpm_leases;
+            std::vector<pm::Mwpm *> mwpms;
+            if (self.is_frozen()) {
+                for (size_t w = 0; w < num_workers; w++) {
+                    mwpm_leases.push_back(self.acquire_mwpm());
+                    mwpms.push_back(&*mwpm_leases.back());
+                }
+            } else {
+                mwpms = self.get_mwpms(num_workers);
+            }
+            auto s = shots.unchecked<2>();
+            auto a = actual_observables.unchecked<2>();
+            std::vector<size_t> worker_num_errors(num_workers, 0);
+            std::vector<std::vector<uint64_t>> worker_observable_errors(
+                num_workers, std::vector<uint64_t>(num_observables, 0));
+            pm::ShotScheduler scheduler(num_shots, num_workers);
+            auto count_errors_of_worker = [&](pm::Mwpm &mwpm, size_t worker) {
+                std::vector<uint64_t> detection_events;
+                std::vector<uint8_t> obs_crossed(num_observables);
+                auto &observable_errors = worker_observable_errors[worker];
+                size_t begin, end;
+                while (scheduler.next_range(worker, begin, end)) {
+                    for (size_t i = begin; i < end; i++) {
+                        append_detection_events_of_shot(s, i, bit_packed_shots, detection_events);
+                        std::fill(obs_crossed.begin(), obs_crossed.end(), 0);
+                        pm::total_weight_int solution_weight = 0;
+                        pm::decode_detection_events(mwpm, detection_events, obs_crossed.data(), solution_weight);
+                        bool is_error = false;
+                        for (size_t k = 0; k < num_observables; k++) {
+                            uint8_t actual = bit_packed_observables ? (a(i, k >> 3) >> (k & 7)) & 1 : a(i, k) != 0;
+                            if ((obs_crossed[k] & 1) != actual) {
+                                observable_errors[k]++;
+                                is_error = true;
+                            }
+                        }
+                        worker_num_errors[worker] += is_error;
+                        detection_events.clear();
+                    }
+                }
+            };
+
+            if (num_workers == 1) {
+                std::optional<py::gil_scoped_release> release;
+                if (self.is_frozen())
+                    release.emplace();
+                count_errors_of_worker(*mwpms[0], 0);
+            } else {
+                std::vector<std::exception_ptr> errors(num_workers);
+                {
+                    py::gil_scoped_release release;
+                    std::vector<std::thread> workers;
+                    workers.reserve(num_workers);
+                    for (size_t w = 0; w < num_workers; w++) {
+                        workers.emplace_back([&, w]() {
+                            try {
+                                count_errors_of_worker(*mwpms[w], w);
+                            } catch (...) {
+                                errors[w] = std::current_exception();
+                            }
+                        });
+                    }
+                    for (auto &worker : workers)
+                        worker.join();
+                }
+                for (auto &error : errors) {
+                    if (error)
+                        std::rethrow_exception(error);
+                }
+            }
+
+            size_t num_errors = 0;
+            py::array_t<uint64_t> observable_errors((py::ssize_t)num_observables);
+            auto oe = observable_errors.mutable_unchecked<1>();
+            for (size_t k = 0; k < num_observables; k++)
+                oe(k) = 0;
+            for (size_t w = 0; w < num_workers; w++) {
+                num_errors += worker_num_errors[w];
+                for (size_t k = 0; k < num_observables; k++)
+                    oe(k) += worker_observable_errors[w][k];
+            }
+            return py::make_tuple(num_errors, observable_errors);
+        },
         "shots"_a,
+        "actual_observables"_a,
         "bit_packed_shots"_a = false,
-        "bit_packed_predictions"_a = false);
+        "bit_packed_observables"_a = false,
+        "num_threads"_a = 1);
+    g.def(
+        "decode_batch_with_edge_probabilities",
+        [](pm::UserGraph &self,
+           const py::array_t<uint8_t> &shots,
+           const pm_pybind::contiguous_array<double> &edge_probabilities,
+           bool bit_packed_shots) {
+            check_shots_shape(self, shots, bit_packed_shots);
+            size_t num_shots = shots.shape(0);
+            size_t num_edges = self.get_num_edges();
+            if (edge_probabilities.ndim() != 2 || (size_t)edge_probabilities.shape(0) != num_shots ||
+                (size_t)edge_probabilities.shape(1) != num_edges)
+                throw std::invalid_argument(
+                    "`edge_probabilities` should have shape (num_shots, num_edges) = (" + std::to_string(num_shots) +
+                    ", " + std::to_string(num_edges) + ").");
+            size_t num_observables = self.get_num_observables();
+            py::array_t<uint8_t> predictions = py::array_t<uint8_t>(num_shots * num_observables);
+            predictions[py::make_tuple(py::ellipsis())] = 0;
+            py::array_t<double> weights = py::array_t<double>(num_shots);
+            uint8_t *predictions_ptr = (uint8_t *)predictions.request().ptr;
+            double *weights_ptr = (double *)weights.request().ptr;
+            const double *probabilities_ptr = edge_probabilities.data();
+            auto s = shots.unchecked<2>();
+            {
+                py::gil_scoped_release release;
+                self.decode_batch_with_edge_probabilities(
+                    num_shots,
+                    [&](size_t k, std::vector<uint64_t> &detection_events) {
+                        append_detection_events_of_shot(s, k, bit_packed_shots, detection_events);
+                    },
+                    probabilities_ptr,
+                    predictions_ptr,
+                    weights_ptr);
+            }
+            predictions.resize({(py::ssize_t)num_shots, (py::ssize_t)num_observables});
+            return py::make_tuple(predictions, weights);
+        },
+        "shots"_a,
+        "edge_probabilities"_a,
+        "bit_packed_shots"_a = false);
+    g.def(
+        "decode_batch_with_erasures",
+        [](pm::UserGraph &self,
+           const py::array_t<uint8_t> &shots,
+           const pm_pybind::contiguous_array<int64_t> &erased_edges,
+           const pm_pybind::contiguous_array<int64_t> &erased_edge_offsets,
+           bool bit_packed_shots) {
+            // The erased edges of shot k are `erased_edges[erased_edge_offsets[k]:erased_edge_offsets[k + 1]]'.
+            check_shots_shape(self, shots, bit_packed_shots);
+            size_t num_shots = shots.shape(0);
+            if (erased_edge_offsets.ndim() != 1 || (size_t)erased_edge_offsets.shape(0) != num_shots + 1)
+                throw std::invalid_argument(
+                    "`erased_edge_offsets` should have length num_shots + 1 = " + std::to_string(num_shots + 1) + ".");
+            const int64_t *edges_ptr = erased_edges.data();
+            const int64_t *offsets_ptr = erased_edge_offsets.data();
+            for (size_t k = 0; k < num_shots; k++) {
+                if (offsets_ptr[k] < 0 || offsets_ptr[k] > offsets_ptr[k + 1] ||
+                    offsets_ptr[k + 1] > (int64_t)erased_edges.size())
+                    throw std::invalid_argument("`erased_edge_offsets` must be non-decreasing and within bounds.");
+            }
+            for (py::ssize_t i = 0; i < erased_edges.size(); i++) {
+                if (edges_ptr[i] < 0)
+                    throw std::invalid_argument("Erased edge indices must be non-negative.");
+            }
+            size_t num_observables = self.get_num_observables();
+            py::array_t<uint8_t> predictions = py::array_t<uint8_t>(num_shots * num_observables);
+            predictions[py::make_tuple(py::ellipsis())] = 0;
+            py::array_t<double> weights = py::array_t<double>(num_shots);
+            uint8_t *predictions_ptr = (uint8_t *)predictions.request().ptr;
+            double *weights_ptr = (double *)weights.request().ptr;
+            auto s = shots.unchecked<2>();
+            {
+                py::gil_scoped_release release;
+                self.decode_batch_with_erasures(
+                    num_shots,
+                    [&](size_t k, std::vector<uint64_t> &detection_events) {
+                        append_detection_events_of_shot(s, k, bit_packed_shots, detection_events);
+                    },
+                    [&](size_t k, std::vector<size_t> &shot_erased_edges) {
+                        shot_erased_edges.assign(edges_ptr + offsets_ptr[k], edges_ptr + offsets_ptr[k + 1]);
+                    },
+                    predictions_ptr,
+                    weights_ptr);
+            }
+            predictions.resize({(py::ssize_t)num_shots, (py::ssize_t)num_observables});
+            return py::make_tuple(predictions, weights);
+        },
+        "shots"_a,
+        "erased_edges"_a,
+        "erased_edge_offsets"_a,
+        "bit_packed_shots"_a = false);
+    g.def(
+        "decode_batch_to_edges_array",
+        [](pm::UserGraph &self, const py::array_t<uint8_t> &shots, bool bit_packed_shots) {
+            check_shots_shape(self, shots, bit_packed_shots);
+            auto mwpm_lease = self.acquire_mwpm(true);
+            auto &mwpm = *mwpm_lease;
+            auto s = shots.unchecked<2>();
+            size_t num_shots = shots.shape(0);
+            auto edges = new std::vector<int64_t>();
+            auto offsets = new std::vector<int64_t>();
+            offsets->reserve(num_shots + 1);
+            offsets->push_back(0);
+            try {
+                py::gil_scoped_release release;
+                std::vector<uint64_t> detection_events;
+                std::vector<int64_t> shot_edges;
+                for (size_t i = 0; i < num_shots; i++) {
+                    append_detection_events_of_shot(s, i, bit_packed_shots, detection_events);
+                    pm::decode_detection_events_to_edges(mwpm, detection_events, shot_edges);
+                    edges->insert(edges->end(), shot_edges.begin(), shot_edges.end());
+                    offsets->push_back((int64_t)(edges->size() / 2));
+                    detection_events.clear();
+                    shot_edges.clear();
+                }
+            } catch (...) {
+                delete edges;
+                delete offsets;
+                throw;
+            }
+            return pairs_and_offsets_to_arrays(edges, offsets);
+        },
+        "shots"_a,
+        "bit_packed_shots"_a = false);
+    g.def(
+        "decode_batch_to_matched_detection_events_array",
+        [](pm::UserGraph &self, const py::array_t<uint8_t> &shots, bool bit_packed_shots) {
+            check_shots_shape(self, shots, bit_packed_shots);
+            auto mwpm_lease = self.acquire_mwpm();
+            auto &mwpm = *mwpm_lease;
+            auto s = shots.unchecked<2>();
+            size_t num_shots = shots.shape(0);
+            auto pairs = new std::vector<int64_t>();
+            auto offsets = new std::vector<int64_t>();
+            offsets->reserve(num_shots + 1);
+            offsets->push_back(0);
+            try {
+                py::gil_scoped_release release;
+                std::vector<uint64_t> detection_events;
+                for (size_t i = 0; i < num_shots; i++) {
+                    append_detection_events_of_shot(s, i, bit_packed_shots, detection_events);
+                    pm::decode_detection_events_to_match_edges(mwpm, detection_events);
+                    for (auto &e : mwpm.flooder.match_edges) {
+                        pairs->push_back(e.loc_from - &mwpm.flooder.graph.nodes[0]);
+                        pairs->push_back(e.loc_to ? e.loc_to - &mwpm.flooder.graph.nodes[0] : -1);
+                    }
+                    offsets->push_back((int64_t)(pairs->size() / 2));
+                    detection_events.clear();
+                }
+            } catch (...) {
+                delete pairs;
+                delete offsets;
+                throw;
+            }
+            return pairs_and_offsets_to_arrays(pairs, offsets);
+        },
+        "shots"_a,
+        "bit_packed_shots"_a = false);
+    g.def(
+        "decode_to_outputs",
+        [](pm::UserGraph &self,
+           const py::array_t<uint64_t> &detection_events,
+           bool prediction,
+           bool weight,
+           bool matched_dets,
+           bool edges) {
+            auto mwpm_lease = self.acquire_mwpm(edges);
+            auto &mwpm = *mwpm_lease;
+            std::vector<uint64_t> detection_events_vec(
+                detection_events.data(), detection_events.data() + detection_events.size());
+            auto obs_crossed = new std::vector<uint8_t>(prediction ? self.get_num_observables() : 0, 0);
+            auto pairs = new std::vector<int64_t>();
+            auto edges_vec = new std::vector<int64_t>();
+            pm::total_weight_int solution_weight = 0;
+            try {
+                pm::decode_detection_events_to_outputs(
+                    mwpm,
+                    detection_events_vec,
+                    prediction ? obs_crossed->data() : nullptr,
+                    weight ? &solution_weight : nullptr,
+                    matched_dets ? pairs : nullptr,
+                    edges ? edges_vec : nullptr);
+            } catch (...) {
+                delete obs_crossed;
+                delete pairs;
+                delete edges_vec;
+                throw;
+            }
+            py::dict res;
+            auto to_pairs_array = [](std::vector<int64_t> *vec) {
+                auto num_pairs = (py::ssize_t)(vec->size() / 2);
+                auto arr = pm_pybind::vec_to_array<int64_t>(vec);
+                arr.resize({num_pairs, (py::ssize_t)2});
+                return arr;
+            };
+            if (prediction)
+                res["prediction"] = pm_pybind::vec_to_array<uint8_t>(obs_crossed);
+            else
+                delete obs_crossed;
+            if (weight)
+                res["weight"] = (double)solution_weight / mwpm.flooder.graph.normalising_constant;
+            if (matched_dets)
+                res["matched_dets"] = to_pairs_array(pairs);
+            else
+                delete pairs;
+            if (edges)
+                res["edges"] = to_pairs_array(edges_vec);
+            else
+                delete edges_vec;
+            return res;
+        },
+        "detection_events"_a,
+        "prediction"_a = true,
+        "weight"_a = false,
+        "matched_dets"_a = false,
+        "edges"_a = false);
+    g.def(
+        "decode_batch_to_outputs",
+        [](pm::UserGraph &self,
+           const py::array_t<uint8_t> &shots,
+           bool prediction,
+           bool weight,
+           bool matched_dets,
+           bool edges,
+           bool bit_packed_shots) {
+            check_shots_shape(self, shots, bit_packed_shots);
+            auto mwpm_lease = self.acquire_mwpm(edges);
+            auto &mwpm = *mwpm_lease;
+            auto s = shots.unchecked<2>();
+            size_t num_shots = shots.shape(0);
+            size_t num_observables = self.get_num_observables();
+
+            py::array_t<uint8_t> predictions = py::array_t<uint8_t>(std::vector<py::ssize_t>{
+                (py::ssize_t)(prediction ? num_shots : 0), (py::ssize_t)num_observables});
+            predictions[py::make_tuple(py::ellipsis())] = 0;
+            uint8_t *predictions_ptr = (uint8_t *)predictions.request().ptr;
+            py::array_t<double> weights = py::array_t<double>(weight ? num_shots : 0);
+            auto ws = weights.mutable_unchecked<1>();
+            double normalising_constant = mwpm.flooder.graph.normalising_constant;
+
+            auto pairs = new std::vector<int64_t>();
+            auto pair_offsets = new std::vector<int64_t>();
+            auto edges_vec = new std::vector<int64_t>();
+            auto edge_offsets = new std::vector<int64_t>();
+            pair_offsets->push_back(0);
+            edge_offsets->push_back(0);
+            try {
+                py::gil_scoped_release release;
+                std::vector<uint64_t> detection_events;
+                for (size_t i = 0; i < num_shots; i++) {
+                    append_detection_events_of_shot(s, i, bit_packed_shots, detection_events);
+                    pm::total_weight_int solution_weight = 0;
+                    pm::decode_detection_events_to_outputs(
+                        mwpm,
+                        detection_events,
+                        prediction ? predictions_ptr + i * num_observables : nullptr,
+                        weight ? &solution_weight : nullptr,
+                        matched_dets ? pairs : nullptr,
+                        edges ? edges_vec : nullptr);
+                    if (weight)
+                        ws(i) = (double)solution_weight / normalising_constant;
+                    if (matched_dets)
+                        pair_offsets->push_back((int64_t)(pairs->size() / 2));
+                    if (edges)
+                        edge_offsets->push_back((int64_t)(edges_vec->size() / 2));
+                    detection_events.clear();
+                }
+            } catch (...) {
+                delete pairs;
+                delete pair_offsets;
+                delete edges_vec;
+                delete edge_offsets;
+                throw;
+            }
+            py::dict res;
+            if (prediction)
+                res["predictions"] = predictions;
+            if (weight)
+                res["weights"] = weights;
+            if (matched_dets) {
+                res["matched_dets"] = pairs_and_offsets_to_arrays(pairs, pair_offsets);
+            } else {
+                delete pairs;
+                delete pair_offsets;
+            }
+            if (edges) {
+                res["edges"] = pairs_and_offsets_to_arrays(edges_vec, edge_offsets);
+            } else {
+                delete edges_vec;
+                delete edge_offsets;
+            }
+            return res;
+        },
+        "shots"_a,
+        "prediction"_a = true,
+        "weight"_a = false,
+        "matched_dets"_a = false,
+        "edges"_a = false,
+        "bit_packed_shots"_a = false);
     g.def(
         "decode_to_matched_detection_events_dict",
         [](pm::UserGraph &self, const py::array_t<uint64_t> &detection_events) {
-            auto &mwpm = self.get_mwpm();
+            auto mwpm_lease = self.acquire_mwpm();
+            auto &mwpm = *mwpm_lease;
             std::vector<uint64_t> detection_events_vec(
                 detection_events.data(), detection_events.data() + detection_events.size());
             pm::decode_detection_events_to_match_edges(mwpm, detection_events_vec);
@@ -346,6 +1542,7 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
         },
         "detection_events"_a);
     g.def("get_edges", [](const pm::UserGraph &self) {
+        self.check_edges_loaded();
         py::list edges;
 
         for (auto &e : self.edges) {
@@ -367,24 +1564,119 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
         }
         return edges;
     });
+    g.def(
+        "save_graph_file",
+        [](pm::UserGraph &self, const std::string &path) {
+            pm::save_graph_file(path, self);
+        },
+        "path"_a);
+    g.def(
+        "save_to_shared_memory",
+        [](pm::UserGraph &self, const std::string &name) {
+            pm::save_graph_to_shared_memory(name, self);
+        },
+        "name"_a);
+    g.def("is_attached", &pm::UserGraph::is_attached);
     g.def("has_edge", &pm::UserGraph::has_edge, "node1"_a, "node2"_a);
     g.def("has_boundary_edge", &pm::UserGraph::has_boundary_edge, "node"_a);
+    g.def(
+        "get_boundary_distances",
+        [](pm::UserGraph &self, bool return_observables) -> py::object {
+            auto &boundary_distances = self.get_boundary_distances();
+            double normalising_constant = self.get_mwpm().flooder.graph.normalising_constant;
+            size_t num_nodes = boundary_distances.distances.size();
+            py::array_t<double> distances_arr((py::ssize_t)num_nodes);
+            auto d = distances_arr.mutable_unchecked<1>();
+            for (size_t i = 0; i < num_nodes; i++) {
+                if (self.is_boundary_node(i)) {
+                    d((py::ssize_t)i) = 0;
+                } else if (boundary_distances.reaches_boundary(i)) {
+                    d((py::ssize_t)i) = (double)boundary_distances.distances[i] / normalising_constant;
+                } else {
+                    d((py::ssize_t)i) = std::numeric_limits<double>::infinity();
+                }
+            }
+            if (!return_observables)
+                return distances_arr;
+
+            size_t num_observables = self.get_num_observables();
+            if (num_observables > sizeof(pm::obs_int) * 8)
+                throw std::invalid_argument(
+                    "The observables crossed by boundary paths are only available for graphs with at most " +
+                    std::to_string(sizeof(pm::obs_int) * 8) + " observables.");
+            py::array_t<uint8_t> observables_arr({(py::ssize_t)num_nodes, (py::ssize_t)num_observables});
+            auto o = observables_arr.mutable_unchecked<2>();
+            for (size_t i = 0; i < num_nodes; i++) {
+                pm::obs_int obs_mask = self.is_boundary_node(i) ? 0 : boundary_distances.observables[i];
+                for (size_t k = 0; k < num_observables; k++)
+                    o((py::ssize_t)i, (py::ssize_t)k) = pm::obs_int_bit(obs_mask, k);
+            }
+            return py::make_tuple(distances_arr, observables_arr);
+        },
+        "return_observables"_a = false);
+    g.def(
+        "shortest_paths",
+        [](pm::UserGraph &self,
+           const py::array_t<int64_t> &sources,
+           const py::array_t<int64_t> &targets,
+           size_t num_threads) {
+            auto s = sources.unchecked<1>();
+            auto t = targets.unchecked<1>();
+            if (s.shape(0) != t.shape(0))
+                throw std::invalid_argument("sources and targets must have the same length.");
+            // A negative node index denotes the boundary.
+            std::vector<size_t> source_vec((size_t)s.shape(0));
+            std::vector<size_t> target_vec((size_t)t.shape(0));
+            for (py::ssize_t i = 0; i < s.shape(0); i++) {
+                source_vec[i] = s(i) < 0 ? SIZE_MAX : (size_t)s(i);
+                target_vec[i] = t(i) < 0 ? SIZE_MAX : (size_t)t(i);
+            }
+            pm::ShortestPaths paths;
+            {
+                py::gil_scoped_release release;
+                paths = self.get_shortest_paths(source_vec, target_vec, num_threads);
+            }
+            py::array_t<int64_t> offsets_arr((py::ssize_t)paths.offsets.size());
+            auto o = offsets_arr.mutable_unchecked<1>();
+            for (size_t i = 0; i < paths.offsets.size(); i++)
+                o((py::ssize_t)i) = (int64_t)paths.offsets[i];
+            py::array_t<int64_t> nodes_arr((py::ssize_t)paths.nodes.size());
+            auto n = nodes_arr.mutable_unchecked<1>();
+            for (size_t i = 0; i < paths.nodes.size(); i++)
+                n((py::ssize_t)i) = (int64_t)paths.nodes[i];
+            py::array_t<double> distances_arr((py::ssize_t)paths.distances.size());
+            auto d = distances_arr.mutable_unchecked<1>();
+            for (size_t i = 0; i < paths.distances.size(); i++)
+                d((py::ssize_t)i) = paths.distances[i];
+            return py::make_tuple(offsets_arr, nodes_arr, distances_arr);
+        },
+        "sources"_a,
+        "targets"_a,
+        "num_threads"_a = 1);
+    g.def(
+        "distances_from",
+        [](pm::UserGraph &self, int64_t source) {
+            auto distances = self.get_distances_from_source(source < 0 ? SIZE_MAX : (size_t)source);
+            py::array_t<double> distances_arr((py::ssize_t)distances.size());
+            auto d = distances_arr.mutable_unchecked<1>();
+            for (size_t i = 0; i < distances.size(); i++)
+                d((py::ssize_t)i) = distances[i];
+            return distances_arr;
+        },
+        "source"_a);
     g.def(
         "get_edge_data",
         [](const pm::UserGraph &self, size_t node1, size_t node2) {
             if (node1 >= self.nodes.size())
                 throw std::invalid_argument("node1 (" + std::to_string(node1) + ") not in graph");
-            size_t idx = self.nodes[node1].index_of_neighbor(node2);
+            size_t idx = self.index_of_edge(node1, node2);
             if (idx == SIZE_MAX)
                 throw std::invalid_argument(
                     "Edge (" + std::to_string(node1) + ", " + std::to_string(node2) + ") not in graph.");
-            auto n = self.nodes[node1].neighbors[idx];
-            std::set<size_t> observables_set(
-                n.edge_it->observable_indices.begin(), n.edge_it->observable_indices.end());
+            auto &e = self.edges[idx];
+            std::set<size_t> observables_set(e.observable_indices.begin(), e.observable_indices.end());
             py::dict attrs(
-                "fault_ids"_a = observables_set,
-                "weight"_a = n.edge_it->weight,
-                "error_probability"_a = n.edge_it->error_probability);
+                "fault_ids"_a = observables_set, "weight"_a = e.weight, "error_probability"_a = e.error_probability);
             return attrs;
         },
         "node1"_a,
@@ -394,185 +1686,142 @@ void pm_pybind::pybind_user_graph_methods(py::module &m, py::class_<pm::UserGrap
         [](const pm::UserGraph &self, size_t node) {
             if (node >= self.nodes.size())
                 throw std::invalid_argument("node (" + std::to_string(node) + ") not in graph");
-            size_t idx = self.nodes[node].index_of_neighbor(SIZE_MAX);
+            size_t idx = self.index_of_edge(node, SIZE_MAX);
             if (idx == SIZE_MAX)
                 throw std::invalid_argument("Boundary edge (" + std::to_string(node) + ",) not in graph.");
-            auto n = self.nodes[node].neighbors[idx];
-            std::set<size_t> observables_set(
-                n.edge_it->observable_indices.begin(), n.edge_it->observable_indices.end());
+            auto &e = self.edges[idx];
+            std::set<size_t> observables_set(e.observable_indices.begin(), e.observable_indices.end());
             py::dict attrs(
-                "fault_ids"_a = observables_set,
-                "weight"_a = n.edge_it->weight,
-                "error_probability"_a = n.edge_it->error_probability);
+                "fault_ids"_a = observables_set, "weight"_a = e.weight, "error_probability"_a = e.error_probability);
             return attrs;
         },
         "node"_a);
-    m.def("detector_error_model_to_matching_graph", [](const char *dem_string) {
-        auto dem = stim::DetectorErrorModel(dem_string);
-        return pm::detector_error_model_to_user_graph(dem);
+    m.attr("decoder_stats_enabled") = pm::DECODER_STATS_ENABLED;
+    py::list decoder_stats_field_names;
+    for (auto name : pm::DecoderStats::FIELD_NAMES)
+        decoder_stats_field_names.append(name);
+    m.attr("decoder_stats_field_names") = decoder_stats_field_names;
+    py::list decode_latency_phase_names;
+    for (auto name : pm::DecodeLatencyHistograms::PHASE_NAMES)
+        decode_latency_phase_names.append(name);
+    m.attr("decode_latency_phase_names") = decode_latency_phase_names;
+    m.def(
+        "detector_error_model_to_matching_graph",
+        [](const char *dem_string, bool enable_correlations) {
+            auto dem = stim::DetectorErrorModel(dem_string);
+            return pm::detector_error_model_to_user_graph(dem, enable_correlations);
+        },
+        "dem_string"_a,
+        "enable_correlations"_a = false);
+    m.def(
+        "detector_error_model_file_to_matching_graph",
+        [](const char *dem_path, bool enable_correlations, const std::optional<std::string> &cache_dir) {
+            if (cache_dir.has_value()) {
+                check_cache_dir_without_correlations(enable_correlations);
+                return pm::cached_detector_error_model_to_user_graph(*cache_dir, read_text_file(dem_path));
+            }
+            FILE *file = fopen(dem_path, "r");
+            if (file == nullptr) {
+                std::stringstream msg;
+                msg << "Failed to open '" << dem_path << "'";
+                throw std::invalid_argument(msg.str());
+            }
+            auto dem = stim::DetectorErrorModel::from_file(file);
+            fclose(file);
+            return pm::detector_error_model_to_user_graph(dem, enable_correlations);
+        },
+        "dem_path"_a,
+        "enable_correlations"_a = false,
+        "cache_dir"_a = py::none());
+    m.def("graph_file_to_matching_graph", [](const std::string &path) {
+        return pm::load_user_graph_from_graph_file(path);
     });
-    m.def("detector_error_model_file_to_matching_graph", [](const char *dem_path) {
-        FILE *file = fopen(dem_path, "r");
-        if (file == nullptr) {
-            std::stringstream msg;
-            msg << "Failed to open '" << dem_path << "'";
-            throw std::invalid_argument(msg.str());
-        }
-        auto dem = stim::DetectorErrorModel::from_file(file);
-        fclose(file);
-        return pm::detector_error_model_to_user_graph(dem);
+    m.def("attach_graph_file_to_matching_graph", [](const std::string &path) {
+        return pm::attach_user_graph_to_graph_file(path);
     });
-    m.def("stim_circuit_file_to_matching_graph", [](const char *stim_circuit_path) {
-        FILE *file = fopen(stim_circuit_path, "r");
-        if (file == nullptr) {
-            std::stringstream msg;
-            msg << "Failed to open '" << stim_circuit_path << "'";
-            throw std::invalid_argument(msg.str());
-        }
-        auto circuit = stim::Circuit::from_file(file);
-        fclose(file);
-        auto dem = stim::ErrorAnalyzer::circuit_to_detector_error_model(circuit, true, true, false, 0, false, false);
-        return pm::detector_error_model_to_user_graph(dem);
+    m.def("attach_shared_memory_to_matching_graph", [](const std::string &name) {
+        return pm::attach_user_graph_to_shared_memory(name);
     });
+    m.def("remove_shared_memory_graph", &pm::remove_graph_from_shared_memory, "name"_a);
+    m.def(
+        "stim_circuit_file_to_matching_graph",
+        [](const char *stim_circuit_path, bool enable_correlations, const std::optional<std::string> &cache_dir) {
+            if (cache_dir.has_value()) {
+                check_cache_dir_without_correlations(enable_correlations);
+                return pm::cached_stim_circuit_to_user_graph(*cache_dir, read_text_file(stim_circuit_path));
+            }
+            FILE *file = fopen(stim_circuit_path, "r");
+            if (file == nullptr) {
+                std::stringstream msg;
+                msg << "Failed to open '" << stim_circuit_path << "'";
+                throw std::invalid_argument(msg.str());
+            }
+            auto circuit = stim::Circuit::from_file(file);
+            fclose(file);
+            auto dem = stim::ErrorAnalyzer::circuit_to_detector_error_model(circuit, true, true, false, 0, false, false);
+            return pm::detector_error_model_to_user_graph(dem, enable_correlations);
+        },
+        "stim_circuit_path"_a,
+        "enable_correlations"_a = false,
+        "cache_dir"_a = py::none());
     m.def(
         "sparse_column_check_matrix_to_matching_graph",
         [](const py::object &check_matrix,
-           const py::array_t<double> &weights,
-           const py::array_t<double> &error_probabilities,
+           const pm_pybind::contiguous_array<double> &weights,
+           const pm_pybind::contiguous_array<double> &error_probabilities,
            const std::string &merge_strategy,
            bool use_virtual_boundary_node,
            size_t num_repetitions,
-           const py::array_t<double> &timelike_weights,
-           const py::array_t<double> &measurement_error_probabilities,
-           py::object &faults_matrix) {
+           const std::optional<pm_pybind::contiguous_array<double>> &timelike_weights,
+           const std::optional<pm_pybind::contiguous_array<double>> &measurement_error_probabilities,
+           const py::object &faults_matrix) {
             auto H = CompressedSparseColumnCheckMatrix(check_matrix);
+            std::optional<CompressedSparseColumnCheckMatrix> F;
+            if (!faults_matrix.is_none())
+                F.emplace(faults_matrix);
 
-            if (faults_matrix.is(py::none())) {
-                faults_matrix =
-                    py::module_::import("scipy.sparse")
-                        .attr("eye")(
-                            H.num_cols, "dtype"_a = py::module_::import("numpy").attr("uint8"), "format"_a = "csc");
-            }
-            auto F = CompressedSparseColumnCheckMatrix(faults_matrix);
-
-            auto weights_unchecked = weights.unchecked<1>();
             // Check weights array size is correct
-            if ((size_t)weights_unchecked.size() != H.num_cols)
+            if ((size_t)weights.size() != H.num_cols)
                 throw std::invalid_argument(
-                    "The size of the `weights` array (" + std::to_string(weights_unchecked.size()) +
+                    "The size of the `weights` array (" + std::to_string(weights.size()) +
                     ") should match the number of columns in the check matrix (" + std::to_string(H.num_cols) + ")");
-            auto error_probabilities_unchecked = error_probabilities.unchecked<1>();
             // Check error_probabilities array is correct
-            if ((size_t)error_probabilities_unchecked.size() != H.num_cols)
+            if ((size_t)error_probabilities.size() != H.num_cols)
                 throw std::invalid_argument(
-                    "The size of the `error_probabilities` array (" +
-                    std::to_string(error_probabilities_unchecked.size()) +
+                    "The size of the `error_probabilities` array (" + std::to_string(error_probabilities.size()) +
                     ") should match the number of columns in the check matrix (" + std::to_string(H.num_cols) + ")");
-
-            if (H.num_cols != F.num_cols)
-                throw std::invalid_argument(
-                    "`faults_matrix` array with shape (" + std::to_string(F.num_rows) + ", " +
-                    std::to_string(F.num_cols) +
-                    ") must have the same number of columns as the check matrix, which has shape (" +
-                    std::to_string(H.num_rows) + ", " + std::to_string(H.num_cols) + ").");
-
-            auto merge_strategy_enum = merge_strategy_from_string(merge_strategy);
-
-            auto H_indptr_unchecked = H.indptr.unchecked<1>();
-            auto H_indices_unchecked = H.indices.unchecked<1>();
-            auto F_indptr_unchecked = F.indptr.unchecked<1>();
-            auto F_indices_unchecked = F.indices.unchecked<1>();
-
-            // Now construct the graph
-            size_t num_detectors = H.num_rows * num_repetitions;
-            pm::UserGraph graph(num_detectors, F.num_rows);
-            // Each column corresponds to an edge. Iterate over the columns, adding the edges to the graph.
-            // Also iterate over the number of repetitions (in case num_repetitions > 1)
-            for (size_t rep = 0; rep < num_repetitions; rep++) {
-                for (py::ssize_t c = 0; (size_t)c < H.num_cols; c++) {
-                    auto idx_start = H_indptr_unchecked[c];
-                    auto idx_end = H_indptr_unchecked[c + 1];
-                    auto num_dets = idx_end - idx_start;
-                    if (idx_start > H_indices_unchecked.size() - 1 && idx_start != idx_end)
-                        throw std::invalid_argument(
-                            "`check_matrix.indptr` elements must not exceed size of `check_matrix.indices`");
-                    auto f_idx_start = F_indptr_unchecked[c];
-                    auto f_idx_end = F_indptr_unchecked[c + 1];
-                    std::vector<size_t> obs;
-                    obs.reserve(f_idx_end - f_idx_start);
-                    for (auto q = f_idx_start; q < f_idx_end; q++)
-                        obs.push_back((size_t)F_indices_unchecked(q));
-                    if (num_dets == 2) {
-                        graph.add_or_merge_edge(
-                            H_indices_unchecked(idx_start) + H.num_rows * rep,
-                            H_indices_unchecked(idx_start + 1) + H.num_rows * rep,
-                            obs,
-                            weights_unchecked(c),
-                            error_probabilities_unchecked(c),
-                            merge_strategy_enum);
-                    } else if (num_dets == 1) {
-                        if (use_virtual_boundary_node) {
-                            graph.add_or_merge_boundary_edge(
-                                H_indices_unchecked(idx_start) + H.num_rows * rep,
-                                obs,
-                                weights_unchecked(c),
-                                error_probabilities_unchecked(c),
-                                merge_strategy_enum);
-                        } else {
-                            graph.add_or_merge_edge(
-                                H_indices_unchecked(idx_start) + H.num_rows * rep,
-                                num_detectors,
-                                obs,
-                                weights_unchecked(c),
-                                error_probabilities_unchecked(c),
-                                merge_strategy_enum);
-                        }
-                    } else if (num_dets != 0) {
-                        throw std::invalid_argument(
-                            "`check_matrix` must contain at most two ones per column, but column " + std::to_string(c) +
-                            " has " + std::to_string(num_dets) + " ones.");
-                    }
-                }
-            }
-
             if (num_repetitions > 1) {
-                if (timelike_weights.is(py::none()))
-                    throw std::invalid_argument("must provide `timelike_weights` for repetitions > 1.");
-                if (measurement_error_probabilities.is(py::none()))
-                    throw std::invalid_argument("must provide `measurement_error_probabilities` for repetitions > 1.");
-                auto t_weights = timelike_weights.unchecked<1>();
-                if ((size_t)t_weights.size() != H.num_rows) {
+                if (timelike_weights && (size_t)timelike_weights->size() != H.num_rows) {
                     throw std::invalid_argument(
-                        "timelike_weights has length " + std::to_string(t_weights.size()) +
+                        "timelike_weights has length " + std::to_string(timelike_weights->size()) +
                         " but its length must equal the number of columns in the check matrix (" +
                         std::to_string(H.num_rows) + ").");
                 }
-                auto meas_errs = measurement_error_probabilities.unchecked<1>();
-                if ((size_t)meas_errs.size() != H.num_rows) {
+                if (measurement_error_probabilities &&
+                    (size_t)measurement_error_probabilities->size() != H.num_rows) {
                     throw std::invalid_argument(
-                        "`measurement_error_probabilities` has length " + std::to_string(meas_errs.size()) +
+                        "`measurement_error_probabilities` has length " +
+                        std::to_string(measurement_error_probabilities->size()) +
                         " but its length must equal the number of columns in the check matrix (" +
                         std::to_string(H.num_rows) + ").");
                 }
-
-                for (size_t rep = 0; rep < num_repetitions - 1; rep++) {
-                    for (size_t row = 0; row < H.num_rows; row++) {
-                        graph.add_or_merge_edge(
-                            row + rep * H.num_rows,
-                            row + (rep + 1) * H.num_rows,
-                            {},
-                            t_weights(row),
-                            meas_errs(row),
-                            merge_strategy_enum);
-                    }
-                }
             }
 
-            // Set the boundary if not using a virtual boundary and if a boundary edge was added
-            if (!use_virtual_boundary_node && graph.nodes.size() == num_detectors + 1)
-                graph.set_boundary({num_detectors});
-
-            return graph;
+            auto H_view = H.view();
+            std::optional<pm::CscBinaryMatrix> F_view;
+            if (F)
+                F_view = F->view();
+            auto merge_strategy_enum = merge_strategy_from_string(merge_strategy);
+            return pm::check_matrix_to_user_graph(
+                H_view,
+                weights.data(),
+                error_probabilities.data(),
+                merge_strategy_enum,
+                use_virtual_boundary_node,
+                num_repetitions,
+                timelike_weights ? timelike_weights->data() : nullptr,
+                measurement_error_probabilities ? measurement_error_probabilities->data() : nullptr,
+                F_view ? &*F_view : nullptr);
         },
         "check_matrix"_a,
         "weights"_a,
@@ -24,11 +24,17 @@ namespace py = pybind11;
 
 namespace pm_pybind {
 
+/// A numpy array which is converted, if necessary, to be C-contiguous, so that its data can be used directly.
+template <typename T>
+using contiguous_array = py::array_t<T, py::array::c_style | py::array::forcecast>;
+
 struct CompressedSparseColumnCheckMatrix {
     explicit CompressedSparseColumnCheckMatrix(const py::object &matrix);
+    /// A view of the matrix, which is valid for as long as this object is.
+    pm::CscBinaryMatrix view() const;
     py::array_t<uint8_t> data;
-    py::array_t<int64_t> indices;
-    py::array_t<int64_t> indptr;
+    contiguous_array<int64_t> indices;
+    contiguous_array<int64_t> indptr;
     size_t num_rows;
     size_t num_cols;
 };
@@ -17,6 +17,8 @@
 
 #include <cmath>
 #include <gtest/gtest.h>
+#include <random>
+#include <thread>
 
 TEST(UserGraph, ConstructGraph) {
     pm::UserGraph graph;
@@ -31,21 +33,25 @@ TEST(UserGraph, ConstructGraph) {
     graph.set_boundary({3, 4});
     ASSERT_EQ(graph.get_num_observables(), 5);
     ASSERT_EQ(graph.nodes.size(), 5);
-    ASSERT_EQ(graph.nodes[0].neighbors[0].edge_it->node2, SIZE_MAX);
-    ASSERT_EQ(graph.nodes[0].neighbors[0].edge_it->weight, pm::merge_weights(4.1, 1.0));
-    ASSERT_EQ(graph.nodes[0].neighbors[0].edge_it->error_probability, 0.1 * (1 - 0.46) + 0.46 * (1 - 0.1));
-    ASSERT_EQ(graph.nodes[0].neighbors[1].edge_it->node2, 1);
-    ASSERT_EQ(graph.nodes[0].neighbors[1].edge_it->weight, pm::merge_weights(2.5, 2.1));
-    ASSERT_EQ(graph.nodes[0].neighbors[1].edge_it->error_probability, 0.4 * (1 - 0.45) + 0.45 * (1 - 0.4));
-    ASSERT_EQ(graph.nodes[1].neighbors[0].edge_it->weight, pm::merge_weights(2.5, 2.1));
-    ASSERT_EQ(graph.nodes[1].neighbors[0].edge_it->error_probability, 0.4 * (1 - 0.45) + 0.45 * (1 - 0.4));
-    ASSERT_EQ(graph.nodes[1].neighbors[1].edge_it->weight, -3.5);
-    ASSERT_EQ(graph.nodes[1].neighbors[0].edge_it->node1, 0);
-    ASSERT_EQ(graph.nodes[2].neighbors[0].edge_it->node1, 1);
-    ASSERT_EQ(graph.nodes[2].neighbors[1].edge_it->node2, 3);
-    ASSERT_EQ(graph.nodes[0].index_of_neighbor(1), 1);
-    ASSERT_EQ(graph.nodes[0].index_of_neighbor(SIZE_MAX), 0);
-    ASSERT_EQ(graph.nodes[0].index_of_neighbor(3), SIZE_MAX);
+    auto edge_of = [&](size_t node, size_t neighbor_index) -> pm::UserEdge& {
+        return graph.edges[graph.nodes[node].neighbors[neighbor_index].edge_index];
+    };
+    ASSERT_EQ(edge_of(0, 0).node2, SIZE_MAX);
+    ASSERT_EQ(edge_of(0, 0).weight, pm::merge_weights(4.1, 1.0));
+    ASSERT_EQ(edge_of(0, 0).error_probability, 0.1 * (1 - 0.46) + 0.46 * (1 - 0.1));
+    ASSERT_EQ(edge_of(0, 1).node2, 1);
+    ASSERT_EQ(edge_of(0, 1).weight, pm::merge_weights(2.5, 2.1));
+    ASSERT_EQ(edge_of(0, 1).error_probability, 0.4 * (1 - 0.45) + 0.45 * (1 - 0.4));
+    ASSERT_EQ(edge_of(1, 0).weight, pm::merge_weights(2.5, 2.1));
+    ASSERT_EQ(edge_of(1, 0).error_probability, 0.4 * (1 - 0.45) + 0.45 * (1 - 0.4));
+    ASSERT_EQ(edge_of(1, 1).weight, -3.5);
+    ASSERT_EQ(edge_of(1, 0).node1, 0);
+    ASSERT_EQ(edge_of(2, 0).node1, 1);
+    ASSERT_EQ(edge_of(2, 1).node2, 3);
+    ASSERT_EQ(graph.index_of_edge(0, 1), 1);
+    ASSERT_EQ(graph.index_of_edge(1, 0), 1);
+    ASSERT_EQ(graph.index_of_edge(0, SIZE_MAX), 0);
+    ASSERT_EQ(graph.index_of_edge(0, 3), SIZE_MAX);
     auto& mwpm = graph.get_mwpm();
     auto& g2 = mwpm.flooder.graph;
     ASSERT_EQ(g2.nodes.size(), 5);
@@ -106,6 +112,89 @@ TEST(UserGraph, AddNoise) {
     ASSERT_EQ(syndrome, expected_syndrome);
 }
 
+TEST(UserGraph, AddNoiseBatch) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 1, 1);
+    graph.add_or_merge_edge(0, 1, {1}, 1, 0);
+    graph.add_or_merge_edge(1, 2, {2}, 1, 0.1);
+    graph.add_or_merge_edge(2, 3, {3}, 1, 0.1);
+    graph.add_or_merge_edge(3, 4, {4}, 1, 0.02);
+    graph.add_or_merge_edge(4, 5, {5}, 1, 0);
+    graph.add_or_merge_edge(5, 6, {6}, 1, 1);
+    graph.add_or_merge_edge(6, 7, {7}, 1, 1);
+    graph.add_or_merge_edge(7, 8, {8}, 1, 0.5);
+    graph.set_boundary({7});
+    size_t num_shots = 20000;
+    size_t syndrome_bytes = (graph.get_num_nodes() + 7) / 8;
+    size_t observable_bytes = (graph.get_num_observables() + 7) / 8;
+    std::vector<uint8_t> syndromes(num_shots * syndrome_bytes, 0xFF);
+    std::vector<uint8_t> observables(num_shots * observable_bytes, 0xFF);
+    graph.add_noise_batch(num_shots, 5, syndromes.data(), observables.data());
+
+    std::vector<size_t> obs_counts(graph.get_num_observables(), 0);
+    for (size_t k = 0; k < num_shots; k++) {
+        std::vector<uint8_t> obs(graph.get_num_observables());
+        for (size_t o = 0; o < obs.size(); o++) {
+            obs[o] = (observables[k * observable_bytes + o / 8] >> (o % 8)) & 1;
+            obs_counts[o] += obs[o];
+        }
+        // Each node is a detection event iff an odd number of its edges are flipped, except for the boundary node.
+        for (size_t n = 0; n < graph.get_num_nodes(); n++) {
+            uint8_t expected = n == 7 ? 0 : obs[n] ^ (n + 1 < obs.size() ? obs[n + 1] : 0);
+            ASSERT_EQ((syndromes[k * syndrome_bytes + n / 8] >> (n % 8)) & 1, expected);
+        }
+    }
+    std::vector<double> p = {1, 0, 0.1, 0.1, 0.02, 0, 1, 1, 0.5};
+    for (size_t o = 0; o < p.size(); o++) {
+        double expected = p[o] * num_shots;
+        double tolerance = 5 * std::sqrt(num_shots * p[o] * (1 - p[o]));
+        ASSERT_NEAR((double)obs_counts[o], expected, tolerance) << o;
+    }
+
+    // The same seed gives the same shots, and a different seed different shots.
+    std::vector<uint8_t> syndromes2(syndromes.size()), observables2(observables.size());
+    graph.add_noise_batch(num_shots, 5, syndromes2.data(), observables2.data());
+    ASSERT_EQ(syndromes, syndromes2);
+    ASSERT_EQ(observables, observables2);
+    graph.add_noise_batch(num_shots, 6, syndromes2.data(), observables2.data());
+    ASSERT_NE(observables, observables2);
+
+    pm::UserGraph no_probabilities;
+    no_probabilities.add_or_merge_edge(0, 1, {0}, 1, -1);
+    ASSERT_THROW(no_probabilities.add_noise_batch(1, 0, syndromes.data(), observables.data()), std::invalid_argument);
+}
+
+TEST(UserGraph, AddOrMergeEdges) {
+    pm::UserGraph graph;
+    graph.add_or_merge_edges(
+        {{0, 1, {0}, 2.5, 0.4},
+         {1, 2, {1}, 1.5, 0.2},
+         {1, 0, {2}, 2.1, 0.45},
+         {2, SIZE_MAX, {}, 3.0, 0.1},
+         {2, SIZE_MAX, {3}, 1.0, 0.3}},
+        pm::INDEPENDENT);
+    ASSERT_EQ(graph.get_num_edges(), 3);
+    ASSERT_EQ(graph.get_num_nodes(), 3);
+    ASSERT_EQ(graph.get_num_observables(), 2);
+    ASSERT_EQ(graph.index_of_edge(1, 0), 0);
+    ASSERT_EQ(graph.index_of_edge(2, 1), 1);
+    ASSERT_EQ(graph.index_of_edge(2, SIZE_MAX), 2);
+    ASSERT_TRUE(graph.has_edge(0, 1));
+    ASSERT_TRUE(graph.has_boundary_edge(2));
+    ASSERT_FALSE(graph.has_edge(0, 2));
+    ASSERT_FALSE(graph.has_boundary_edge(7));
+    ASSERT_EQ(graph.edges[0].weight, pm::merge_weights(2.5, 2.1));
+    ASSERT_EQ(graph.edges[0].observable_indices, std::vector<size_t>({0}));
+    ASSERT_EQ(graph.edges[2].weight, pm::merge_weights(3.0, 1.0));
+
+    ASSERT_THROW(graph.add_or_merge_edges({{2, 1, {}, 1.0, 0.1}}), std::invalid_argument);
+    graph.add_or_merge_edges({{2, 1, {4}, 1.0, 0.1}, {3, 0, {}, 1.0, 0.1}}, pm::REPLACE);
+    ASSERT_EQ(graph.get_num_edges(), 4);
+    ASSERT_EQ(graph.edges[1].observable_indices, std::vector<size_t>({4}));
+    ASSERT_EQ(graph.edges[3].node1, 3);
+    ASSERT_EQ(graph.index_of_edge(0, 3), 3);
+}
+
 TEST(UserGraph, NodesAlongShortestPath) {
     pm::UserGraph graph;
     graph.add_or_merge_boundary_edge(0, {0}, 1, -1);
@@ -145,6 +234,45 @@ TEST(UserGraph, NodesAlongShortestPath) {
     }
 }
 
+TEST(UserGraph, GetShortestPathsAndDistances) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 1, -1);
+    graph.add_or_merge_edge(0, 1, {1}, 1, -1);
+    graph.add_or_merge_edge(1, 2, {2}, 1, -1);
+    graph.add_or_merge_edge(2, 3, {3}, 1, -1);
+    graph.add_or_merge_edge(3, 4, {4}, 1, -1);
+    graph.add_or_merge_edge(4, 5, {5}, 1, -1);
+    graph.add_or_merge_edge(6, 7, {}, 2, -1);
+    graph.set_boundary({5});
+
+    std::vector<size_t> sources = {4, 1, SIZE_MAX, 5, 4, 0};
+    std::vector<size_t> targets = {0, SIZE_MAX, 3, 3, 4, 7};
+    for (size_t num_threads : {1, 3}) {
+        auto paths = graph.get_shortest_paths(sources, targets, num_threads);
+        std::vector<size_t> expected_offsets = {0, 5, 7, 9, 11, 12, 12};
+        std::vector<size_t> expected_nodes = {4, 3, 2, 1, 0, 1, 0, 4, 3, 4, 3, 4};
+        ASSERT_EQ(paths.offsets, expected_offsets);
+        ASSERT_EQ(paths.nodes, expected_nodes);
+        std::vector<double> expected_distances = {4, 2, 2, 2, 0};
+        for (size_t i = 0; i < expected_distances.size(); i++)
+            ASSERT_NEAR(paths.distances[i], expected_distances[i], 1e-4);
+        ASSERT_TRUE(std::isinf(paths.distances.back()));
+    }
+    ASSERT_THROW(graph.get_shortest_paths({5}, {SIZE_MAX}), std::invalid_argument);
+    ASSERT_THROW(graph.get_shortest_paths({8}, {0}), std::invalid_argument);
+
+    auto distances = graph.get_distances_from_source(1);
+    std::vector<double> expected_from_1 = {1, 0, 1, 2, 3, 2};
+    for (size_t i = 0; i < expected_from_1.size(); i++)
+        ASSERT_NEAR(distances[i], expected_from_1[i], 1e-4);
+    ASSERT_TRUE(std::isinf(distances[6]) && std::isinf(distances[7]));
+    distances = graph.get_distances_from_source(5);
+    std::vector<double> expected_from_boundary = {1, 2, 3, 2, 1, 0};
+    for (size_t i = 0; i < expected_from_boundary.size(); i++)
+        ASSERT_NEAR(distances[i], expected_from_boundary[i], 1e-4);
+    ASSERT_TRUE(std::isinf(distances[6]) && std::isinf(distances[7]));
+}
+
 TEST(UserGraph, DecodeUserGraphDetectionEventOnBoundaryNode) {
     {
         pm::UserGraph graph;
@@ -166,3 +294,635 @@ TEST(UserGraph, DecodeUserGraphDetectionEventOnBoundaryNode) {
         pm::decode_detection_events(mwpm, {2}, res.obs_crossed.data(), res.weight);
     }
 }
+
+TEST(UserGraph, GetMwpmsReturnsIndependentReplicas) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 1.5, -1);
+    graph.add_or_merge_edge(0, 1, {1}, 1.0, -1);
+    graph.add_or_merge_edge(1, 2, {2}, 2.0, -1);
+    graph.add_or_merge_boundary_edge(2, {3}, 0.5, -1);
+
+    auto mwpms = graph.get_mwpms(3);
+    ASSERT_EQ(mwpms.size(), 3);
+    ASSERT_EQ(mwpms[0], &graph.get_mwpm());
+    ASSERT_NE(mwpms[1], mwpms[0]);
+    ASSERT_NE(mwpms[2], mwpms[1]);
+    ASSERT_EQ(graph.get_mwpms(2)[1], mwpms[1]);
+    ASSERT_EQ(mwpms[1]->flooder.graph.topology, mwpms[0]->flooder.graph.topology);
+
+    for (auto mwpm : mwpms) {
+        pm::ExtendedMatchingResult res(mwpm->flooder.graph.num_observables);
+        pm::decode_detection_events(*mwpm, {0, 2}, res.obs_crossed.data(), res.weight);
+        ASSERT_EQ(res, pm::ExtendedMatchingResult({1, 0, 0, 1}, 4 * mwpm->flooder.graph.normalising_constant / 2));
+    }
+
+    graph.add_or_merge_edge(0, 2, {}, 0.1, -1);
+    auto updated_mwpms = graph.get_mwpms(3);
+    for (auto mwpm : updated_mwpms) {
+        pm::ExtendedMatchingResult res(mwpm->flooder.graph.num_observables);
+        pm::decode_detection_events(*mwpm, {0, 2}, res.obs_crossed.data(), res.weight);
+        ASSERT_EQ(res.obs_crossed, std::vector<uint8_t>({0, 0, 0, 0}));
+    }
+}
+
+struct TestEdge {
+    size_t u;
+    size_t v;
+    std::vector<size_t> observables;
+    double weight;
+};
+
+pm::UserGraph user_graph_from_edges(const std::vector<TestEdge>& edges) {
+    pm::UserGraph graph;
+    for (auto& e : edges) {
+        if (e.v == SIZE_MAX) {
+            graph.add_or_merge_boundary_edge(e.u, e.observables, e.weight, -1);
+        } else {
+            graph.add_or_merge_edge(e.u, e.v, e.observables, e.weight, -1);
+        }
+    }
+    return graph;
+}
+
+void assert_decodes_identically(pm::UserGraph& updated, pm::UserGraph& rebuilt, size_t num_nodes) {
+    auto& m1 = updated.get_mwpm();
+    auto& m2 = rebuilt.get_mwpm();
+    ASSERT_EQ(m1.flooder.graph.normalising_constant, m2.flooder.graph.normalising_constant);
+    for (size_t i = 0; i < num_nodes; i++) {
+        for (size_t j = i; j < num_nodes; j++) {
+            std::vector<uint64_t> dets = {i};
+            if (j != i)
+                dets.push_back(j);
+            pm::ExtendedMatchingResult res1(m1.flooder.graph.num_observables);
+            pm::ExtendedMatchingResult res2(m2.flooder.graph.num_observables);
+            pm::decode_detection_events(m1, dets, res1.obs_crossed.data(), res1.weight);
+            pm::decode_detection_events(m2, dets, res2.obs_crossed.data(), res2.weight);
+            ASSERT_EQ(res1, res2);
+        }
+    }
+}
+
+TEST(UserGraph, UpdateEdgeInPlace) {
+    size_t num_nodes = 8;
+    std::vector<TestEdge> edges = {{0, SIZE_MAX, {0}, 1.5}};
+    for (size_t i = 0; i + 1 < num_nodes; i++)
+        edges.push_back({i, i + 1, {i % 2 + 1}, 1.0 + 0.25 * (double)(i % 3)});
+    edges.push_back({num_nodes - 1, SIZE_MAX, {3}, 2.5});
+    edges.push_back({2, 5, {}, 3.0});
+    auto graph = user_graph_from_edges(edges);
+    auto topology = graph.get_mwpm().flooder.graph.topology.get();
+
+    // Changes that leave the maximum weight (3.0) unchanged are applied in place.
+    std::vector<TestEdge> updates = {
+        {3, 4, {1, 2}, 2.75},
+        {0, SIZE_MAX, {}, 0.5},
+        {5, 6, {3}, -0.75},
+        {7, SIZE_MAX, {0, 3}, -1.25},
+        {5, 6, {1}, 1.75},
+    };
+    for (auto& update : updates) {
+        graph.update_edge(update.u, update.v, update.observables, update.weight, -1);
+        for (auto& e : edges) {
+            if (e.u == update.u && e.v == update.v)
+                e = update;
+        }
+        ASSERT_EQ(graph.get_mwpm().flooder.graph.topology.get(), topology);
+        auto rebuilt = user_graph_from_edges(edges);
+        assert_decodes_identically(graph, rebuilt, num_nodes);
+    }
+
+    // Increasing the maximum weight changes the normalising constant, so the Mwpm is rebuilt.
+    graph.update_edge(1, 2, {}, 4.5, -1);
+    edges[2] = {1, 2, {}, 4.5};
+    ASSERT_NE(graph.get_mwpm().flooder.graph.topology.get(), topology);
+    auto rebuilt = user_graph_from_edges(edges);
+    assert_decodes_identically(graph, rebuilt, num_nodes);
+
+    ASSERT_THROW(graph.update_edge(0, 3, {}, 1.0, -1), std::invalid_argument);
+}
+
+TEST(UserGraph, UpdateEdgeInPlaceWithSearchGraph) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 2.0, -1);
+    for (size_t i = 0; i < 5; i++)
+        graph.add_or_merge_edge(i, i + 1, {i + 1}, 2.0, -1);
+    graph.add_or_merge_boundary_edge(5, {6}, 2.0, -1);
+    auto& mwpm = graph.get_mwpm_with_search_graph();
+    std::vector<int64_t> edges;
+    pm::decode_detection_events_to_edges(mwpm, {1, 4}, edges);
+    ASSERT_EQ(edges.size(), 6);
+
+    // Making the central edges expensive matches both detection events to the boundary instead.
+    graph.update_edge(2, 3, {3}, 20.0, -1);
+    graph.update_edge(1, 2, {2}, 20.0, -1);
+    graph.update_edge(3, 4, {4}, 20.0, -1);
+    ASSERT_EQ(&graph.get_mwpm_with_search_graph(), &mwpm);
+    edges.clear();
+    pm::decode_detection_events_to_edges(mwpm, {1, 4}, edges);
+    std::vector<std::pair<int64_t, int64_t>> edge_pairs;
+    for (size_t i = 0; i < edges.size(); i += 2)
+        edge_pairs.push_back({std::min(edges[i], edges[i + 1]), std::max(edges[i], edges[i + 1])});
+    std::sort(edge_pairs.begin(), edge_pairs.end());
+    std::vector<std::pair<int64_t, int64_t>> expected = {{-1, 0}, {-1, 5}, {0, 1}, {4, 5}};
+    ASSERT_EQ(edge_pairs, expected);
+}
+
+TEST(UserGraph, DecodeWithWeightOverrides) {
+    size_t num_nodes = 8;
+    std::vector<TestEdge> edges = {{0, SIZE_MAX, {0}, 1.5}};
+    for (size_t i = 0; i + 1 < num_nodes; i++)
+        edges.push_back({i, i + 1, {i % 2 + 1}, 1.0 + 0.25 * (double)(i % 3)});
+    edges.push_back({num_nodes - 1, SIZE_MAX, {3}, 2.5});
+    edges.push_back({2, 5, {}, 3.0});
+    auto graph = user_graph_from_edges(edges);
+    auto original = user_graph_from_edges(edges);
+    auto topology = graph.get_mwpm().flooder.graph.topology;
+    graph.get_mwpms(2);
+
+    // The edge (5, 6) is overridden twice, in which case the last weight is used.
+    std::vector<std::pair<size_t, size_t>> override_edges = {{3, 4}, {0, SIZE_MAX}, {5, 6}, {7, SIZE_MAX}, {5, 6}};
+    std::vector<double> override_weights = {2.75, 0.5, -0.75, -1.25, 0.25};
+    auto overridden_edges = edges;
+    for (size_t k = 0; k < override_edges.size(); k++) {
+        for (auto& e : overridden_edges) {
+            if (e.u == override_edges[k].first && e.v == override_edges[k].second)
+                e.weight = override_weights[k];
+        }
+    }
+    auto overridden = user_graph_from_edges(overridden_edges);
+
+    for (size_t i = 0; i < num_nodes; i++) {
+        for (size_t j = i; j < num_nodes; j++) {
+            std::vector<uint64_t> dets = {i};
+            if (j != i)
+                dets.push_back(j);
+            size_t num_observables = graph.get_num_observables();
+            pm::ExtendedMatchingResult res(num_observables), expected(num_observables);
+            graph.decode_with_weight_overrides(
+                dets, override_edges, override_weights, res.obs_crossed.data(), res.weight);
+            pm::decode_detection_events(overridden.get_mwpm(), dets, expected.obs_crossed.data(), expected.weight);
+            ASSERT_EQ(res, expected);
+        }
+    }
+
+    // The original weights are restored, in the shared topology, after decoding.
+    ASSERT_EQ(graph.get_mwpm().flooder.graph.topology, topology);
+    ASSERT_EQ(graph.get_mwpms(2)[1]->flooder.graph.topology, topology);
+    assert_decodes_identically(graph, original, num_nodes);
+
+    pm::ExtendedMatchingResult res(graph.get_num_observables());
+    ASSERT_THROW(
+        graph.decode_with_weight_overrides({0}, {{0, 3}}, {1.0}, res.obs_crossed.data(), res.weight),
+        std::invalid_argument);
+    ASSERT_THROW(
+        graph.decode_with_weight_overrides({0}, {{0, 1}}, {3.5}, res.obs_crossed.data(), res.weight),
+        std::invalid_argument);
+    ASSERT_THROW(
+        graph.decode_with_weight_overrides({0}, {{0, 1}}, {}, res.obs_crossed.data(), res.weight),
+        std::invalid_argument);
+}
+
+TEST(UserGraph, DecodeWithErasures) {
+    size_t num_nodes = 8;
+    std::vector<TestEdge> edges = {{0, SIZE_MAX, {0}, 1.5}};
+    for (size_t i = 0; i + 1 < num_nodes; i++)
+        edges.push_back({i, i + 1, {i % 2 + 1}, 1.0 + 0.25 * (double)(i % 3)});
+    edges.push_back({num_nodes - 1, SIZE_MAX, {3}, 2.5});
+    edges.push_back({2, 5, {}, 3.0});
+    edges[4].weight = -0.5;
+    auto graph = user_graph_from_edges(edges);
+    auto original = user_graph_from_edges(edges);
+    auto topology = graph.get_mwpm().flooder.graph.topology;
+
+    // The edges are indexed in the order they were added. Edge 6 is erased twice in the first shot.
+    std::vector<std::vector<size_t>> erasures = {{0, 6, 4, 8, 6}, {}, {3}};
+    std::vector<pm::UserGraph> erased_graphs;
+    for (auto& erased : erasures) {
+        auto erased_edges = edges;
+        for (size_t e : erased)
+            erased_edges[e].weight = 0;
+        erased_graphs.push_back(user_graph_from_edges(erased_edges));
+    }
+
+    size_t num_observables = graph.get_num_observables();
+    for (size_t i = 0; i < num_nodes; i++) {
+        for (size_t j = i; j < num_nodes; j++) {
+            std::vector<uint64_t> dets = {i};
+            if (j != i)
+                dets.push_back(j);
+            std::vector<uint8_t> predictions(erasures.size() * num_observables, 0);
+            std::vector<double> weights(erasures.size());
+            graph.decode_batch_with_erasures(
+                erasures.size(),
+                [&](size_t, std::vector<uint64_t>& detection_events) {
+                    detection_events = dets;
+                },
+                [&](size_t k, std::vector<size_t>& erased_edges) {
+                    erased_edges = erasures[k];
+                },
+                predictions.data(),
+                weights.data());
+            for (size_t k = 0; k < erasures.size(); k++) {
+                pm::ExtendedMatchingResult res(num_observables), expected(num_observables);
+                graph.decode_with_erasures(dets, erasures[k], res.obs_crossed.data(), res.weight);
+                auto& mwpm = erased_graphs[k].get_mwpm();
+                pm::decode_detection_events(mwpm, dets, expected.obs_crossed.data(), expected.weight);
+                ASSERT_EQ(res, expected);
+                std::vector<uint8_t> shot_predictions(
+                    predictions.begin() + k * num_observables, predictions.begin() + (k + 1) * num_observables);
+                ASSERT_EQ(shot_predictions, expected.obs_crossed);
+                ASSERT_EQ(weights[k], (double)expected.weight / mwpm.flooder.graph.normalising_constant);
+            }
+        }
+    }
+
+    // The original weights are restored, in the shared topology, after decoding.
+    ASSERT_EQ(graph.get_mwpm().flooder.graph.topology, topology);
+    assert_decodes_identically(graph, original, num_nodes);
+
+    pm::ExtendedMatchingResult res(num_observables);
+    ASSERT_THROW(
+        graph.decode_with_erasures({0}, {1, edges.size()}, res.obs_crossed.data(), res.weight),
+        std::invalid_argument);
+    assert_decodes_identically(graph, original, num_nodes);
+}
+
+TEST(UserGraph, CheckMatrixToUserGraph) {
+    // H = [[1, 1, 0, 0], [0, 1, 1, 0], [0, 0, 1, 1]]
+    std::vector<int64_t> indptr = {0, 1, 3, 5, 6};
+    std::vector<int64_t> indices = {0, 0, 1, 1, 2, 2};
+    pm::CscBinaryMatrix H = {3, 4, indptr.data(), indices.data()};
+    std::vector<double> weights = {1.0, 2.0, 3.0, 4.0};
+    std::vector<double> error_probabilities = {0.1, 0.2, 0.3, 0.4};
+
+    auto graph = pm::check_matrix_to_user_graph(
+        H, weights.data(), error_probabilities.data(), pm::SMALLEST_WEIGHT, false, 1, nullptr, nullptr, nullptr);
+    ASSERT_EQ(graph.get_num_nodes(), 4);
+    ASSERT_EQ(graph.get_boundary(), std::set<size_t>({3}));
+    ASSERT_EQ(graph.get_num_edges(), 4);
+    ASSERT_EQ(graph.get_num_observables(), 4);
+    auto& e = graph.edges[graph.index_of_edge(1, 2)];
+    ASSERT_EQ(e.weight, 3.0);
+    ASSERT_EQ(e.error_probability, 0.3);
+    ASSERT_EQ(e.observable_indices, std::vector<size_t>({2}));
+    ASSERT_TRUE(graph.has_edge(2, 3));
+
+    // F = [[1, 0, 0, 1]], with three rounds of measurements joined by timelike edges.
+    std::vector<int64_t> f_indptr = {0, 1, 1, 1, 2};
+    std::vector<int64_t> f_indices = {0, 0};
+    pm::CscBinaryMatrix F = {1, 4, f_indptr.data(), f_indices.data()};
+    std::vector<double> timelike_weights = {5.0, 6.0, 7.0};
+    std::vector<double> measurement_error_probabilities = {0.01, 0.02, 0.03};
+    auto repeated = pm::check_matrix_to_user_graph(
+        H,
+        weights.data(),
+        error_probabilities.data(),
+        pm::SMALLEST_WEIGHT,
+        true,
+        3,
+        timelike_weights.data(),
+        measurement_error_probabilities.data(),
+        &F);
+    ASSERT_EQ(repeated.get_num_nodes(), 9);
+    ASSERT_TRUE(repeated.get_boundary().empty());
+    ASSERT_EQ(repeated.get_num_edges(), 4 * 3 + 3 * 2);
+    ASSERT_EQ(repeated.get_num_observables(), 1);
+    ASSERT_TRUE(repeated.has_boundary_edge(8));
+    ASSERT_EQ(repeated.edges[repeated.index_of_edge(8, SIZE_MAX)].observable_indices, std::vector<size_t>({0}));
+    ASSERT_EQ(repeated.edges[repeated.index_of_edge(4, 7)].weight, 6.0);
+    ASSERT_EQ(repeated.edges[repeated.index_of_edge(4, 7)].error_probability, 0.02);
+
+    ASSERT_THROW(
+        pm::check_matrix_to_user_graph(
+            H, weights.data(), error_probabilities.data(), pm::SMALLEST_WEIGHT, true, 2, nullptr, nullptr, nullptr),
+        std::invalid_argument);
+    std::vector<int64_t> bad_indptr = {0, 3, 3, 5, 6};
+    pm::CscBinaryMatrix bad_H = {3, 4, bad_indptr.data(), indices.data()};
+    ASSERT_THROW(
+        pm::check_matrix_to_user_graph(
+            bad_H, weights.data(), error_probabilities.data(), pm::SMALLEST_WEIGHT, true, 1, nullptr, nullptr, nullptr),
+        std::invalid_argument);
+}
+
+TEST(UserGraph, DecodeCorrelated) {
+    // The first round matches D2 and D3 to the boundary. Once D0 and D1 are matched to each other, the edge
+    // (D2, D3) from the same error is much more likely, and the second round uses it instead, flipping L0.
+    stim::DetectorErrorModel dem(R"DEM(
+        error(0.1) D0 D1 ^ D2 D3 L0
+        error(0.3) D2
+        error(0.3) D3
+    )DEM");
+    auto graph = pm::detector_error_model_to_user_graph(dem, true);
+    std::vector<uint64_t> detection_events{0, 1, 2, 3};
+    std::vector<uint8_t> obs(1, 0);
+    pm::total_weight_int weight = 0;
+    pm::decode_detection_events(graph.get_mwpm(), detection_events, obs.data(), weight);
+    ASSERT_EQ(obs, std::vector<uint8_t>{0});
+
+    obs[0] = 0;
+    weight = 0;
+    graph.decode_correlated(detection_events, obs.data(), weight);
+    ASSERT_EQ(obs, std::vector<uint8_t>{1});
+    // Only the weight of (D0, D1) remains, since the weight of (D2, D3) was lowered to 0.
+    ASSERT_NEAR((double)weight / graph.get_mwpm().flooder.graph.normalising_constant, std::log(0.9 / 0.1), 1e-3);
+
+    // The weights are restored afterwards.
+    obs[0] = 0;
+    pm::decode_detection_events(graph.get_mwpm(), detection_events, obs.data(), weight);
+    ASSERT_EQ(obs, std::vector<uint8_t>{0});
+
+    auto uncorrelated = pm::detector_error_model_to_user_graph(dem);
+    ASSERT_THROW(uncorrelated.decode_correlated(detection_events, obs.data(), weight), std::invalid_argument);
+}
+
+TEST(UserGraph, DecodeBatchWithEdgeProbabilities) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 2.2, -1);
+    graph.add_or_merge_edge(0, 1, {}, 1.4, -1);
+    graph.add_or_merge_boundary_edge(1, {1}, 2.2, -1);
+    std::vector<std::vector<uint64_t>> shots{{0, 1}, {0, 1}, {0}};
+    std::vector<double> probabilities{0.1, 0.2, 0.1, 0.4, 0.01, 0.4, 0.4, 0.01, 0.4};
+    std::vector<uint8_t> predictions(6, 0);
+    std::vector<double> weights(3);
+    auto get_detection_events = [&](size_t k, std::vector<uint64_t>& detection_events) {
+        detection_events = shots[k];
+    };
+    graph.decode_batch_with_edge_probabilities(
+        3, get_detection_events, probabilities.data(), predictions.data(), weights.data());
+    ASSERT_EQ(predictions, (std::vector<uint8_t>{0, 0, 1, 1, 1, 0}));
+    // Builds with PM_COMPACT_WEIGHTS discretize the weights more coarsely.
+    double tolerance = PM_COMPACT_WEIGHTS ? 1e-2 : 1e-3;
+    ASSERT_NEAR(weights[0], std::log(0.8 / 0.2), tolerance);
+    // The weight log(0.99 / 0.01) of edge (0, 1) is clamped to 2.2, but the boundary edges are still cheaper.
+    ASSERT_NEAR(weights[1], 2 * std::log(0.6 / 0.4), tolerance);
+    ASSERT_NEAR(weights[2], std::log(0.6 / 0.4), tolerance);
+
+    // The original weights are restored afterwards.
+    std::vector<uint8_t> obs(2, 0);
+    pm::total_weight_int weight = 0;
+    pm::decode_detection_events(graph.get_mwpm(), shots[0], obs.data(), weight);
+    ASSERT_EQ(obs, (std::vector<uint8_t>{0, 0}));
+    ASSERT_NEAR((double)weight / graph.get_mwpm().flooder.graph.normalising_constant, 1.4, tolerance);
+
+    probabilities[4] = 1.5;
+    ASSERT_THROW(
+        graph.decode_batch_with_edge_probabilities(
+            3, get_detection_events, probabilities.data(), predictions.data(), weights.data()),
+        std::invalid_argument);
+    weight = 0;
+    pm::decode_detection_events(graph.get_mwpm(), shots[0], obs.data(), weight);
+    ASSERT_NEAR((double)weight / graph.get_mwpm().flooder.graph.normalising_constant, 1.4, tolerance);
+}
+
+TEST(UserGraph, FrozenGraphDecodesConcurrently) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 1.5, -1);
+    graph.add_or_merge_edge(0, 1, {1}, 1.0, -1);
+    graph.add_or_merge_edge(1, 2, {2}, 2.0, -1);
+    graph.add_or_merge_boundary_edge(2, {3}, 0.5, -1);
+    ASSERT_FALSE(graph.is_frozen());
+    ASSERT_EQ(&*graph.acquire_mwpm(), &graph.get_mwpm());
+    graph.freeze();
+    ASSERT_TRUE(graph.is_frozen());
+
+    ASSERT_THROW(graph.add_or_merge_edge(0, 2, {}, 0.1, -1), std::invalid_argument);
+    ASSERT_THROW(graph.update_edge(0, 1, {1}, 3.0, -1), std::invalid_argument);
+    ASSERT_THROW(graph.set_boundary({2}), std::invalid_argument);
+    ASSERT_THROW(graph.get_mwpms(2), std::invalid_argument);
+    ASSERT_EQ(graph.get_num_edges(), 4);
+
+    {
+        // Leases held at the same time have distinct Mwpms, which are reused once returned to the pool.
+        auto lease1 = graph.acquire_mwpm();
+        auto lease2 = graph.acquire_mwpm();
+        ASSERT_NE(&*lease1, &*lease2);
+        ASSERT_NE(&*lease1, &graph.get_mwpm());
+        ASSERT_EQ(lease1->flooder.graph.topology, graph.get_mwpm().flooder.graph.topology);
+    }
+    pm::Mwpm* pooled_mwpm;
+    {
+        auto lease = graph.acquire_mwpm();
+        pooled_mwpm = &*lease;
+    }
+    ASSERT_EQ(&*graph.acquire_mwpm(), pooled_mwpm);
+
+    std::vector<std::thread> threads;
+    std::vector<uint8_t> all_correct(4, true);
+    for (size_t t = 0; t < all_correct.size(); t++) {
+        threads.emplace_back([&, t]() {
+            for (size_t k = 0; k < 100; k++) {
+                auto mwpm = graph.acquire_mwpm();
+                pm::ExtendedMatchingResult res(mwpm->flooder.graph.num_observables);
+                pm::decode_detection_events(*mwpm, {0, 2}, res.obs_crossed.data(), res.weight);
+                if (res != pm::ExtendedMatchingResult({1, 0, 0, 1}, 4 * mwpm->flooder.graph.normalising_constant / 2))
+                    all_correct[t] = false;
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    for (auto correct : all_correct)
+        ASSERT_TRUE(correct);
+}
+
+TEST(UserGraph, WarmUp) {
+    pm::UserGraph graph;
+    size_t num_nodes = 30;
+    graph.add_or_merge_boundary_edge(0, {0}, 1, 0.1);
+    for (size_t i = 0; i + 1 < num_nodes; i++)
+        graph.add_or_merge_edge(i, i + 1, {i + 1}, 1, 0.1);
+    graph.add_or_merge_boundary_edge(num_nodes - 1, {num_nodes}, 1, 0.1);
+
+    // Reserving without sampling shots reserves the same for each Mwpm.
+    auto reserved = graph.warm_up(2, 0, 10, 0);
+    ASSERT_GE(reserved.regions, 20);
+    ASSERT_EQ(reserved.reached_nodes, num_nodes);
+    for (auto mwpm : graph.get_mwpms(2))
+        ASSERT_EQ(mwpm->capacity(), reserved);
+
+    // Sampled shots only grow the capacity, and don't count as decoded.
+    graph.set_syndrome_cache_capacity(64);
+    auto sampled = graph.warm_up(2, 200, 10, 3);
+    sampled.include(reserved);
+    ASSERT_EQ(graph.get_mwpm().capacity(), sampled);
+    ASSERT_EQ(graph.get_syndrome_cache_counts(), (std::pair<uint64_t, uint64_t>{0, 0}));
+
+    // The Mwpms of a frozen graph are warmed up in its pool.
+    graph.freeze();
+    auto pooled = graph.warm_up(3, 20, 40, 4);
+    ASSERT_GE(pooled.alt_tree_nodes, 40);
+    {
+        std::vector<pm::MwpmLease> leases;
+        for (size_t k = 0; k < 3; k++) {
+            leases.push_back(graph.acquire_mwpm());
+            ASSERT_GE(leases.back()->capacity().alt_tree_nodes, 40);
+        }
+    }
+
+    pm::UserGraph no_probabilities;
+    no_probabilities.add_or_merge_edge(0, 1, {}, 1, -1);
+    ASSERT_THROW(no_probabilities.warm_up(1, 1, 0, 0), std::invalid_argument);
+    no_probabilities.warm_up(1, 0, 5, 0);
+}
+
+TEST(UserGraph, MemoryUsage) {
+    pm::UserGraph graph;
+    size_t num_nodes = 100;
+    graph.add_or_merge_boundary_edge(0, {0}, 1, 0.1);
+    for (size_t i = 0; i + 1 < num_nodes; i++)
+        graph.add_or_merge_edge(i, i + 1, {i + 1}, 1, 0.1);
+
+    auto unbuilt = graph.get_memory_usage();
+    ASSERT_GE(unbuilt.user_graph, (num_nodes - 1) * sizeof(pm::UserEdge));
+    ASSERT_EQ(unbuilt.num_mwpms, 0);
+    ASSERT_EQ(unbuilt.total(), unbuilt.user_graph);
+
+    graph.get_mwpm();
+    auto one = graph.get_memory_usage();
+    ASSERT_EQ(one.num_mwpms, 1);
+    ASSERT_EQ(one.user_graph, unbuilt.user_graph);
+    ASSERT_GE(one.mwpms.matching_graph, num_nodes * sizeof(pm::DetectorNode));
+    ASSERT_GT(one.mwpms.shared_graph, 0);
+    ASSERT_EQ(one.total(), one.user_graph + one.mwpms.total());
+
+    // Replicas share the topology of the graph, but each has its own nodes.
+    graph.get_mwpms(3);
+    auto three = graph.get_memory_usage();
+    ASSERT_EQ(three.num_mwpms, 3);
+    ASSERT_EQ(three.mwpms.matching_graph, 3 * one.mwpms.matching_graph);
+    ASSERT_LT(three.mwpms.shared_graph, 2 * one.mwpms.shared_graph);
+
+    // Warming up grows the decoder state, up to the capacity it reports.
+    auto capacity = graph.warm_up(3, 0, 50, 0);
+    auto warmed = graph.get_memory_usage();
+    ASSERT_EQ(warmed.max_capacity, capacity);
+    ASSERT_GE(
+        warmed.mwpms.decoder_state,
+        three.mwpms.decoder_state + 3 * (100 * sizeof(pm::GraphFillRegion) + 50 * sizeof(pm::AltTreeNode)));
+}
+
+TEST(UserGraph, SyndromeCacheMatchesUncachedDecoding) {
+    size_t num_nodes = 20;
+    auto make_graph = [&]() {
+        pm::UserGraph graph;
+        graph.add_or_merge_boundary_edge(0, {0}, 2.0, -1);
+        for (size_t i = 0; i + 1 < num_nodes; i++)
+            graph.add_or_merge_edge(i, i + 1, {i % 4}, 1.0 + (i % 3) * 0.5, -1);
+        graph.add_or_merge_boundary_edge(num_nodes - 1, {1}, 2.0, -1);
+        return graph;
+    };
+    auto graph = make_graph();
+    auto uncached_graph = make_graph();
+    graph.set_syndrome_cache_capacity(64);
+    ASSERT_EQ(graph.get_mwpm().syndrome_cache.capacity(), 64);
+
+    std::mt19937 rng(5);
+    std::vector<std::vector<uint64_t>> syndromes;
+    for (size_t k = 0; k < 50; k++) {
+        std::vector<uint64_t> syndrome;
+        for (size_t i = 0; i < num_nodes; i++)
+            if (rng() % 8 == 0)
+                syndrome.push_back(i);
+        syndromes.push_back(syndrome);
+    }
+    for (size_t repeat = 0; repeat < 3; repeat++) {
+        for (auto& syndrome : syndromes) {
+            pm::ExtendedMatchingResult res(4), expected(4);
+            pm::decode_detection_events(graph.get_mwpm(), syndrome, res.obs_crossed.data(), res.weight);
+            pm::decode_detection_events(
+                uncached_graph.get_mwpm(), syndrome, expected.obs_crossed.data(), expected.weight);
+            ASSERT_EQ(res, expected);
+            ASSERT_EQ(
+                pm::decode_detection_events_for_up_to_64_observables(graph.get_mwpm(), syndrome),
+                pm::decode_detection_events_for_up_to_64_observables(uncached_graph.get_mwpm(), syndrome));
+        }
+    }
+    auto counts = graph.get_syndrome_cache_counts();
+    ASSERT_GT(counts.first, 0);
+    ASSERT_GT(counts.second, 0);
+
+    // Changing an edge weight forgets the cached solutions.
+    graph.update_edge(4, 5, {0}, 0.1, -1);
+    uncached_graph.update_edge(4, 5, {0}, 0.1, -1);
+    for (auto& syndrome : syndromes)
+        ASSERT_EQ(
+            pm::decode_detection_events_for_up_to_64_observables(graph.get_mwpm(), syndrome),
+            pm::decode_detection_events_for_up_to_64_observables(uncached_graph.get_mwpm(), syndrome));
+
+    // Replicas and pooled Mwpms of a frozen graph have their own caches.
+    ASSERT_EQ(graph.get_mwpms(2)[1]->syndrome_cache.capacity(), 64);
+    graph.freeze();
+    ASSERT_THROW(graph.set_syndrome_cache_capacity(0), std::invalid_argument);
+    ASSERT_EQ(graph.acquire_mwpm()->syndrome_cache.capacity(), 64);
+}
+
+TEST(UserGraph, UnionFindDecoderEngine) {
+    pm::UserGraph graph;
+    graph.add_or_merge_boundary_edge(0, {0}, 1.0, -1);
+    for (size_t i = 0; i < 9; i++)
+        graph.add_or_merge_edge(i, i + 1, {i + 1}, 1.0, -1);
+    graph.add_or_merge_edge(9, 10, {10}, 1.0, -1);
+    graph.set_boundary({10});
+    ASSERT_EQ(graph.get_decoder_engine(), pm::SPARSE_BLOSSOM);
+    graph.set_decoder_engine(pm::UNION_FIND);
+    ASSERT_EQ(graph.get_mwpm().decoder_engine(), pm::UNION_FIND);
+    ASSERT_EQ(graph.get_mwpms(2)[1]->decoder_engine(), pm::UNION_FIND);
+
+    // Pairs of detection events far apart from each other and from the boundary are matched as by the blossom
+    // algorithm, and a detection event on the boundary node is ignored.
+    auto res = pm::decode_detection_events_for_up_to_64_observables(graph.get_mwpm(), {0, 4, 5, 10});
+    ASSERT_EQ(res.obs_mask, (pm::obs_int)1 | (pm::obs_int)1 << 5);
+    ASSERT_EQ(res.weight, 2 * graph.get_mwpm().flooder.graph.nodes[4].neighbor_weights[0]);
+
+    graph.freeze();
+    ASSERT_THROW(graph.set_decoder_engine(pm::SPARSE_BLOSSOM), std::invalid_argument);
+    ASSERT_EQ(graph.acquire_mwpm()->decoder_engine(), pm::UNION_FIND);
+}
+
+TEST(UserGraph, PredecoderMatchesFullAlgorithm) {
+    // A comb: a line of nodes with boundary edges at each end, and a leaf hanging from each node of the line.
+    size_t num_teeth = 15;
+    auto make_graph = [&]() {
+        pm::UserGraph graph;
+        graph.add_or_merge_boundary_edge(0, {0}, 2.0, -1);
+        for (size_t i = 0; i + 1 < num_teeth; i++)
+            graph.add_or_merge_edge(i, i + 1, {i % 5}, 1.0 + (i % 3) * 0.5, -1);
+        graph.add_or_merge_boundary_edge(num_teeth - 1, {1}, 2.0, -1);
+        for (size_t i = 0; i < num_teeth; i++)
+            graph.add_or_merge_edge(i, num_teeth + i, {5 + i % 3}, 1.0 + (i % 4) * 0.25, -1);
+        return graph;
+    };
+    auto graph = make_graph();
+    auto exact_graph = make_graph();
+    auto approximate_graph = make_graph();
+    exact_graph.set_predecoder_mode(pm::PREDECODER_EXACT);
+    approximate_graph.set_predecoder_mode(pm::PREDECODER_APPROXIMATE);
+    ASSERT_EQ(exact_graph.get_mwpm().predecoder.mode, pm::PREDECODER_EXACT);
+    ASSERT_EQ(exact_graph.get_mwpms(2)[1]->predecoder.mode, pm::PREDECODER_EXACT);
+
+    std::mt19937 rng(3);
+    size_t num_predecoded_shots = 0;
+    for (size_t k = 0; k < 200; k++) {
+        std::vector<uint64_t> syndrome;
+        for (size_t i = 0; i < 2 * num_teeth; i++)
+            if (rng() % 4 == 0)
+                syndrome.push_back(i);
+        auto expected = pm::decode_detection_events_for_up_to_64_observables(graph.get_mwpm(), syndrome);
+        auto exact = pm::decode_detection_events_for_up_to_64_observables(exact_graph.get_mwpm(), syndrome);
+        ASSERT_EQ(exact.weight, expected.weight);
+        if (exact_graph.get_mwpm().predecoder.weight > 0)
+            num_predecoded_shots++;
+        pm::ExtendedMatchingResult res(8);
+        pm::decode_detection_events(exact_graph.get_mwpm(), syndrome, res.obs_crossed.data(), res.weight);
+        ASSERT_EQ(res.weight, expected.weight);
+        auto approximate =
+            pm::decode_detection_events_for_up_to_64_observables(approximate_graph.get_mwpm(), syndrome);
+        ASSERT_GE(approximate.weight, expected.weight);
+    }
+    // Pairs including a leaf are always matched.
+    ASSERT_GT(num_predecoded_shots, 50);
+
+    exact_graph.freeze();
+    ASSERT_THROW(exact_graph.set_predecoder_mode(pm::PREDECODER_OFF), std::invalid_argument);
+    ASSERT_EQ(exact_graph.acquire_mwpm()->predecoder.mode, pm::PREDECODER_EXACT);
+}
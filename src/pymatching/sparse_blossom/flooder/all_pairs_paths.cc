@@ -0,0 +1,142 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/flooder/all_pairs_paths.h"
+
+#include <functional>
+#include <queue>
+
+using namespace pm;
+
+namespace {
+
+/// The shortest paths from a single source, which is reused for each source in turn.
+struct SingleSourcePaths {
+    std::vector<total_weight_int> distances;
+    std::vector<obs_int> observables;
+    std::vector<uint8_t> is_ambiguous;
+    std::vector<size_t> ambiguous_stack;
+
+    /// Finds the shortest paths from node `source' (or from the boundary, if it is SIZE_MAX) to every node.
+    void search_from(const MatchingGraph& graph, size_t source) {
+        size_t num_nodes = graph.nodes.size();
+        distances.assign(num_nodes, AllPairsPaths::UNREACHABLE);
+        observables.assign(num_nodes, 0);
+        is_ambiguous.assign(num_nodes, 0);
+        typedef std::pair<total_weight_int, size_t> QueueEntry;
+        std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+        // From the boundary, every boundary edge (the first neighbor, if present) is a path of one edge.
+        if (source == SIZE_MAX) {
+            for (size_t i = 0; i < num_nodes; i++) {
+                const DetectorNode& node = graph.nodes[i];
+                if (!node.neighbors.empty() && node.neighbors[0] == nullptr) {
+                    distances[i] = node.neighbor_weights[0];
+                    observables[i] = node.neighbor_observables[0];
+                    queue.emplace(distances[i], i);
+                }
+            }
+        } else {
+            distances[source] = 0;
+            queue.emplace(0, source);
+        }
+
+        const DetectorNode* first_node = graph.nodes.data();
+        while (!queue.empty()) {
+            auto [dist, node_index] = queue.top();
+            queue.pop();
+            if (dist != distances[node_index])
+                continue;
+            const DetectorNode& node = graph.nodes[node_index];
+            for (size_t k = 0; k < node.neighbors.size(); k++) {
+                const DetectorNode* neighbor = node.neighbors[k];
+                if (neighbor == nullptr)
+                    continue;
+                size_t neighbor_index = neighbor - first_node;
+                total_weight_int neighbor_dist = dist + node.neighbor_weights[k];
+                if (neighbor_dist < distances[neighbor_index]) {
+                    distances[neighbor_index] = neighbor_dist;
+                    observables[neighbor_index] = observables[node_index] ^ node.neighbor_observables[k];
+                    queue.emplace(neighbor_dist, neighbor_index);
+                }
+            }
+        }
+
+        // A node is ambiguous if a shortest path to it can end with an edge that disagrees with the observables
+        // found for it, or can pass through an ambiguous node. Edges on a shortest path are exactly those with
+        // dist(u) + w = dist(v), and the ambiguity spreads along them (including around cycles of zero weight).
+        for (size_t v = 0; v < num_nodes; v++) {
+            if (distances[v] == AllPairsPaths::UNREACHABLE)
+                continue;
+            const DetectorNode& node = graph.nodes[v];
+            for (size_t k = 0; k < node.neighbors.size() && !is_ambiguous[v]; k++) {
+                const DetectorNode* neighbor = node.neighbors[k];
+                if (neighbor == nullptr) {
+                    if (source == SIZE_MAX && node.neighbor_weights[k] == distances[v] &&
+                        node.neighbor_observables[k] != observables[v])
+                        is_ambiguous[v] = 1;
+                    continue;
+                }
+                size_t u = neighbor - first_node;
+                if (distances[u] != AllPairsPaths::UNREACHABLE &&
+                    distances[u] + node.neighbor_weights[k] == distances[v] &&
+                    (observables[u] ^ node.neighbor_observables[k]) != observables[v])
+                    is_ambiguous[v] = 1;
+            }
+            if (is_ambiguous[v])
+                ambiguous_stack.push_back(v);
+        }
+        while (!ambiguous_stack.empty()) {
+            size_t u = ambiguous_stack.back();
+            ambiguous_stack.pop_back();
+            const DetectorNode& node = graph.nodes[u];
+            for (size_t k = 0; k < node.neighbors.size(); k++) {
+                const DetectorNode* neighbor = node.neighbors[k];
+                if (neighbor == nullptr)
+                    continue;
+                size_t v = neighbor - first_node;
+                if (!is_ambiguous[v] && distances[u] + node.neighbor_weights[k] == distances[v]) {
+                    is_ambiguous[v] = 1;
+                    ambiguous_stack.push_back(v);
+                }
+            }
+        }
+    }
+};
+
+}  // namespace
+
+AllPairsPaths::AllPairsPaths(const MatchingGraph& graph)
+    : num_nodes(graph.nodes.size()),
+      distances(num_nodes * (num_nodes + 1), UNREACHABLE),
+      observables(num_nodes * (num_nodes + 1), 0),
+      is_ambiguous(num_nodes * (num_nodes + 1), 0) {
+    SingleSourcePaths paths;
+    paths.search_from(graph, SIZE_MAX);
+    for (size_t u = 0; u < num_nodes; u++) {
+        size_t index = index_of(u, SIZE_MAX);
+        distances[index] = paths.distances[u];
+        observables[index] = paths.observables[u];
+        is_ambiguous[index] = paths.is_ambiguous[u];
+    }
+    for (size_t u = 0; u < num_nodes; u++) {
+        paths.search_from(graph, u);
+        for (size_t v = 0; v < num_nodes; v++) {
+            size_t index = index_of(u, v);
+            distances[index] = paths.distances[v];
+            observables[index] = paths.observables[v];
+            is_ambiguous[index] = paths.is_ambiguous[v];
+        }
+    }
+}
@@ -0,0 +1,60 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_ALL_PAIRS_PATHS_H
+#define PYMATCHING2_ALL_PAIRS_PATHS_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "pymatching/sparse_blossom/flooder/graph.h"
+
+namespace pm {
+
+/// The length of a shortest path between every pair of nodes of a small MatchingGraph, and from every node to the
+/// boundary, along with the observables crossed by that path. Computed by one Dijkstra search from each node, and
+/// one outwards from the boundary, so only worthwhile for graphs with at most `MAX_NODES' nodes.
+///
+/// Shortest paths of equal length may cross different observables, in which case the decoder's choice between them
+/// can't be predicted. Each path is therefore also marked as ambiguous if any other shortest path between the same
+/// ends crosses different observables.
+struct AllPairsPaths {
+    /// The distance between nodes that are not connected.
+    static constexpr total_weight_int UNREACHABLE = std::numeric_limits<total_weight_int>::max();
+    /// The largest graph for which the table is built automatically. The table has one entry per pair of nodes.
+    static constexpr size_t MAX_NODES = 256;
+
+    size_t num_nodes;
+    /// distances[u * (num_nodes + 1) + v] is the distance between nodes u and v, in the same (integer) units as the
+    /// edge weights, and distances[u * (num_nodes + 1) + num_nodes] is the distance from u to the boundary.
+    std::vector<total_weight_int> distances;
+    /// The observables mask of the path found for each entry of `distances'. Only meaningful if the graph has at
+    /// most 64 (=sizeof(pm::obs_int)*8) observables.
+    std::vector<obs_int> observables;
+    /// Whether another shortest path for each entry of `distances' crosses different observables.
+    std::vector<uint8_t> is_ambiguous;
+
+    AllPairsPaths() = default;
+    explicit AllPairsPaths(const MatchingGraph& graph);
+
+    /// The index of the entry for the path from node `u' to node `v', or to the boundary if `v' is SIZE_MAX.
+    inline size_t index_of(size_t u, size_t v) const {
+        return u * (num_nodes + 1) + (v == SIZE_MAX ? num_nodes : v);
+    }
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_ALL_PAIRS_PATHS_H
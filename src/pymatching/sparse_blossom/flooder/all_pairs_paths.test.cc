@@ -0,0 +1,88 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/flooder/all_pairs_paths.h"
+
+#include <gtest/gtest.h>
+
+using namespace pm;
+
+TEST(AllPairsPaths, DistancesObservablesAndAmbiguity) {
+    MatchingGraph g(5, 3);
+    g.add_boundary_edge(0, 4, {0});
+    g.add_edge(0, 1, 2, {});
+    g.add_edge(1, 2, 2, {1});
+    // As short as the path through node 1, but crossing different observables.
+    g.add_edge(0, 2, 4, {});
+    g.add_edge(2, 3, 2, {});
+    g.add_boundary_edge(3, 6, {2});
+    AllPairsPaths paths(g);
+    ASSERT_EQ(paths.num_nodes, 5);
+
+    auto distance = [&](size_t u, size_t v) {
+        return paths.distances[paths.index_of(u, v)];
+    };
+    auto observables = [&](size_t u, size_t v) {
+        return paths.observables[paths.index_of(u, v)];
+    };
+    auto is_ambiguous = [&](size_t u, size_t v) {
+        return (bool)paths.is_ambiguous[paths.index_of(u, v)];
+    };
+    ASSERT_EQ(distance(0, 1), 2);
+    ASSERT_EQ(observables(0, 1), 0);
+    ASSERT_FALSE(is_ambiguous(0, 1));
+    ASSERT_EQ(distance(1, 3), 4);
+    ASSERT_EQ(observables(1, 3), 2);
+    ASSERT_FALSE(is_ambiguous(1, 3));
+    ASSERT_EQ(distance(0, 2), 4);
+    ASSERT_TRUE(is_ambiguous(0, 2));
+    // The ambiguity spreads to the paths that continue on from node 2.
+    ASSERT_EQ(distance(0, 3), 6);
+    ASSERT_TRUE(is_ambiguous(0, 3));
+    ASSERT_FALSE(is_ambiguous(3, 1));
+
+    ASSERT_EQ(distance(0, SIZE_MAX), 4);
+    ASSERT_EQ(observables(0, SIZE_MAX), 1);
+    ASSERT_EQ(distance(1, SIZE_MAX), 6);
+    ASSERT_EQ(observables(1, SIZE_MAX), 1);
+    ASSERT_FALSE(is_ambiguous(1, SIZE_MAX));
+    ASSERT_EQ(distance(2, SIZE_MAX), 8);
+    ASSERT_TRUE(is_ambiguous(2, SIZE_MAX));
+    ASSERT_EQ(distance(3, SIZE_MAX), 6);
+    ASSERT_EQ(observables(3, SIZE_MAX), 4);
+
+    ASSERT_EQ(distance(4, 4), 0);
+    ASSERT_EQ(distance(4, 0), AllPairsPaths::UNREACHABLE);
+    ASSERT_EQ(distance(4, SIZE_MAX), AllPairsPaths::UNREACHABLE);
+    for (size_t u = 0; u < 5; u++) {
+        for (size_t v = 0; v < 5; v++) {
+            ASSERT_EQ(distance(u, v), distance(v, u));
+            ASSERT_EQ(is_ambiguous(u, v), is_ambiguous(v, u));
+        }
+    }
+}
+
+TEST(AllPairsPaths, ZeroWeightCycleMakesPathsAmbiguous) {
+    MatchingGraph g(3, 1);
+    g.add_edge(0, 1, 0, {0});
+    g.add_edge(1, 2, 0, {});
+    g.add_edge(2, 0, 0, {});
+    AllPairsPaths paths(g);
+    for (size_t u = 0; u < 3; u++) {
+        for (size_t v = 0; v < 3; v++) {
+            ASSERT_EQ(paths.distances[paths.index_of(u, v)], 0);
+            ASSERT_TRUE(paths.is_ambiguous[paths.index_of(u, v)]);
+        }
+    }
+}
@@ -0,0 +1,57 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/flooder/boundary_distances.h"
+
+#include <functional>
+#include <queue>
+
+using namespace pm;
+
+BoundaryDistances::BoundaryDistances(const MatchingGraph& graph)
+    : distances(graph.nodes.size(), UNREACHABLE), observables(graph.nodes.size(), 0) {
+    typedef std::pair<total_weight_int, size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+
+    // Every boundary edge is a path of one edge. The boundary edge, if present, is the first neighbor.
+    for (size_t i = 0; i < graph.nodes.size(); i++) {
+        const DetectorNode& node = graph.nodes[i];
+        if (!node.neighbors.empty() && node.neighbors[0] == nullptr) {
+            distances[i] = node.neighbor_weights[0];
+            observables[i] = node.neighbor_observables[0];
+            queue.emplace(distances[i], i);
+        }
+    }
+
+    const DetectorNode* first_node = graph.nodes.data();
+    while (!queue.empty()) {
+        auto [dist, node_index] = queue.top();
+        queue.pop();
+        if (dist != distances[node_index])
+            continue;
+        const DetectorNode& node = graph.nodes[node_index];
+        for (size_t k = 0; k < node.neighbors.size(); k++) {
+            const DetectorNode* neighbor = node.neighbors[k];
+            if (neighbor == nullptr)
+                continue;
+            size_t neighbor_index = neighbor - first_node;
+            total_weight_int neighbor_dist = dist + node.neighbor_weights[k];
+            if (neighbor_dist < distances[neighbor_index]) {
+                distances[neighbor_index] = neighbor_dist;
+                observables[neighbor_index] = observables[node_index] ^ node.neighbor_observables[k];
+                queue.emplace(neighbor_dist, neighbor_index);
+            }
+        }
+    }
+}
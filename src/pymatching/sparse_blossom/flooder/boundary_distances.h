@@ -0,0 +1,48 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_BOUNDARY_DISTANCES_H
+#define PYMATCHING2_BOUNDARY_DISTANCES_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "pymatching/sparse_blossom/flooder/graph.h"
+
+namespace pm {
+
+/// The length of a shortest path from each node of a MatchingGraph to the boundary, along with the observables
+/// crossed by that path. Computed once, by a single Dijkstra search outwards from the boundary.
+struct BoundaryDistances {
+    /// The distance assigned to nodes that have no path to the boundary.
+    static constexpr total_weight_int UNREACHABLE = std::numeric_limits<total_weight_int>::max();
+
+    /// distances[i] is the distance from node i to the boundary, in the same (integer) units as the edge weights.
+    std::vector<total_weight_int> distances;
+    /// observables[i] is the observables mask of the path found from node i to the boundary. Only meaningful if
+    /// the graph has at most 64 (=sizeof(pm::obs_int)*8) observables.
+    std::vector<obs_int> observables;
+
+    BoundaryDistances() = default;
+    explicit BoundaryDistances(const MatchingGraph& graph);
+
+    inline bool reaches_boundary(size_t node_index) const {
+        return distances[node_index] != UNREACHABLE;
+    }
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_BOUNDARY_DISTANCES_H
@@ -0,0 +1,50 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/flooder/boundary_distances.h"
+
+#include <gtest/gtest.h>
+
+using namespace pm;
+
+TEST(BoundaryDistances, LineGraph) {
+    MatchingGraph g(6, 3);
+    g.add_boundary_edge(0, 4, {0});
+    g.add_edge(0, 1, 6, {});
+    g.add_edge(1, 2, 2, {1});
+    g.add_boundary_edge(2, 10, {2});
+    g.add_edge(2, 3, 2, {});
+    g.add_edge(4, 5, 2, {});
+    BoundaryDistances bd(g);
+    ASSERT_EQ(bd.distances, std::vector<total_weight_int>({4, 10, 10, 12, BoundaryDistances::UNREACHABLE,
+                                                           BoundaryDistances::UNREACHABLE}));
+    ASSERT_EQ(bd.observables[0], 1);
+    ASSERT_EQ(bd.observables[1], 1);
+    ASSERT_EQ(bd.observables[2], 4);
+    ASSERT_EQ(bd.observables[3], 4);
+    ASSERT_TRUE(bd.reaches_boundary(3));
+    ASSERT_FALSE(bd.reaches_boundary(4));
+    ASSERT_FALSE(bd.reaches_boundary(5));
+}
+
+TEST(BoundaryDistances, CompactTopology) {
+    MatchingGraph g(3, 1);
+    g.add_edge(0, 1, 2, {});
+    g.add_edge(1, 2, 2, {0});
+    g.add_boundary_edge(2, 2, {});
+    g.compact_topology();
+    BoundaryDistances bd(g);
+    ASSERT_EQ(bd.distances, std::vector<total_weight_int>({6, 4, 2}));
+    ASSERT_EQ(bd.observables, std::vector<obs_int>({1, 1, 0}));
+}
@@ -0,0 +1,111 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_COLLISION_SCAN_H
+#define PYMATCHING2_COLLISION_SCAN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+#include "pymatching/sparse_blossom/ints.h"
+
+namespace pm {
+
+/// The flooders find the next event at a node by scanning its neighbors for the earliest collision. The state of
+/// each neighbor is behind a pointer, so the scan is done in blocks of up to this many neighbors: the collision
+/// times of a block are first gathered into a small buffer, with NO_COLLISION for neighbors that can't collide, and
+/// the buffer is then reduced with `scan_collision_times', a branch-free loop that the compiler vectorizes (see
+/// `scan_neighbor_collision_times').
+constexpr size_t COLLISION_SCAN_BLOCK_SIZE = 16;
+constexpr cumulative_time_int NO_COLLISION = std::numeric_limits<cumulative_time_int>::max();
+
+/// Updates `best_time' and `best_neighbor' with the collision times `times[0:n]' of the neighbors
+/// `first_neighbor', ..., `first_neighbor + n - 1', keeping the earliest. Ties go to the earlier neighbor, and
+/// a time is only taken if it is strictly less than `best_time', exactly as in a scalar scan of the neighbors
+/// in order.
+inline void scan_collision_times(
+    const cumulative_time_int* times,
+    size_t n,
+    size_t first_neighbor,
+    cumulative_time_int& best_time,
+    size_t& best_neighbor) {
+    cumulative_time_int block_min = NO_COLLISION;
+    for (size_t k = 0; k < n; k++)
+        block_min = times[k] < block_min ? times[k] : block_min;
+    if (block_min < best_time) {
+        size_t k = 0;
+        while (times[k] != block_min)
+            k++;
+        best_time = block_min;
+        best_neighbor = first_neighbor + k;
+    }
+}
+
+/// Nodes with at most this many neighbors (which includes every node of a surface code or toric code graph, even
+/// with circuit-level noise) are scanned by a loop whose trip count is known at compile time, so it is unrolled.
+constexpr size_t MAX_UNROLLED_DEGREE = 12;
+
+template <size_t N, typename TimeOf>
+inline void scan_collision_times_of_fixed_size_block(
+    size_t first_neighbor, const TimeOf& time_of, cumulative_time_int& best_time, size_t& best_neighbor) {
+    cumulative_time_int times[N];
+    for (size_t k = 0; k < N; k++)
+        times[k] = time_of(first_neighbor + k);
+    scan_collision_times(times, N, first_neighbor, best_time, best_neighbor);
+}
+
+template <size_t N, typename TimeOf>
+inline void scan_collision_times_of_unrolled_block(
+    size_t first_neighbor,
+    size_t n,
+    const TimeOf& time_of,
+    cumulative_time_int& best_time,
+    size_t& best_neighbor) {
+    if (n == N) {
+        scan_collision_times_of_fixed_size_block<N>(first_neighbor, time_of, best_time, best_neighbor);
+    } else if constexpr (N > 1) {
+        scan_collision_times_of_unrolled_block<N - 1>(first_neighbor, n, time_of, best_time, best_neighbor);
+    }
+}
+
+/// Updates `best_time' and `best_neighbor' with the collision times `time_of(i)' of the neighbors i in
+/// [`begin_neighbor', `end_neighbor'), as `scan_collision_times' does. `time_of' returns NO_COLLISION for a
+/// neighbor that can't be collided with. Up to MAX_UNROLLED_DEGREE neighbors are scanned by a loop specialized for
+/// their number, and more in blocks of COLLISION_SCAN_BLOCK_SIZE.
+template <typename TimeOf>
+inline void scan_neighbor_collision_times(
+    size_t begin_neighbor,
+    size_t end_neighbor,
+    const TimeOf& time_of,
+    cumulative_time_int& best_time,
+    size_t& best_neighbor) {
+    size_t n = end_neighbor - begin_neighbor;
+    if (n <= MAX_UNROLLED_DEGREE) {
+        scan_collision_times_of_unrolled_block<MAX_UNROLLED_DEGREE>(
+            begin_neighbor, n, time_of, best_time, best_neighbor);
+        return;
+    }
+    cumulative_time_int times[COLLISION_SCAN_BLOCK_SIZE];
+    for (size_t block = begin_neighbor; block < end_neighbor; block += COLLISION_SCAN_BLOCK_SIZE) {
+        size_t block_size = std::min(COLLISION_SCAN_BLOCK_SIZE, end_neighbor - block);
+        for (size_t k = 0; k < block_size; k++)
+            times[k] = time_of(block + k);
+        scan_collision_times(times, block_size, block, best_time, best_neighbor);
+    }
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_COLLISION_SCAN_H
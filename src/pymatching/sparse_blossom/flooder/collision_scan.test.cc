@@ -0,0 +1,87 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/flooder/collision_scan.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+using namespace pm;
+
+TEST(CollisionScan, MatchesScalarScanIncludingTies) {
+    std::mt19937 rng(11);
+    for (size_t trial = 0; trial < 2000; trial++) {
+        // Few distinct times, so that there are many ties, and some neighbors that can't be collided with.
+        size_t num_neighbors = rng() % 50;
+        std::vector<cumulative_time_int> times(num_neighbors);
+        for (auto& t : times)
+            t = rng() % 5 == 0 ? NO_COLLISION : (cumulative_time_int)(rng() % 7) - 3;
+        cumulative_time_int initial_best = trial % 2 ? NO_COLLISION : 0;
+
+        cumulative_time_int expected_time = initial_best;
+        size_t expected_neighbor = SIZE_MAX;
+        for (size_t i = 0; i < num_neighbors; i++) {
+            if (times[i] < expected_time) {
+                expected_time = times[i];
+                expected_neighbor = i;
+            }
+        }
+
+        cumulative_time_int best_time = initial_best;
+        size_t best_neighbor = SIZE_MAX;
+        for (size_t block = 0; block < num_neighbors; block += COLLISION_SCAN_BLOCK_SIZE) {
+            size_t n = std::min(COLLISION_SCAN_BLOCK_SIZE, num_neighbors - block);
+            scan_collision_times(times.data() + block, n, block, best_time, best_neighbor);
+        }
+        ASSERT_EQ(best_time, expected_time);
+        ASSERT_EQ(best_neighbor, expected_neighbor);
+    }
+}
+
+TEST(CollisionScan, NeighborScanMatchesScalarScanForEveryDegree) {
+    std::mt19937 rng(12);
+    for (size_t num_neighbors = 0; num_neighbors <= 3 * COLLISION_SCAN_BLOCK_SIZE; num_neighbors++) {
+        for (size_t trial = 0; trial < 50; trial++) {
+            std::vector<cumulative_time_int> times(num_neighbors);
+            for (auto& t : times)
+                t = rng() % 5 == 0 ? NO_COLLISION : (cumulative_time_int)(rng() % 7) - 3;
+            size_t start = num_neighbors > 0 ? trial % 2 : 0;
+
+            cumulative_time_int expected_time = NO_COLLISION;
+            size_t expected_neighbor = SIZE_MAX;
+            for (size_t i = start; i < num_neighbors; i++) {
+                if (times[i] < expected_time) {
+                    expected_time = times[i];
+                    expected_neighbor = i;
+                }
+            }
+
+            cumulative_time_int best_time = NO_COLLISION;
+            size_t best_neighbor = SIZE_MAX;
+            scan_neighbor_collision_times(
+                start,
+                num_neighbors,
+                [&](size_t i) {
+                    return times[i];
+                },
+                best_time,
+                best_neighbor);
+            ASSERT_EQ(best_time, expected_time);
+            ASSERT_EQ(best_neighbor, expected_neighbor);
+        }
+    }
+}
@@ -15,6 +15,8 @@
 #ifndef PYMATCHING_FILL_MATCH_DETECTOR_NODE_H
 #define PYMATCHING_FILL_MATCH_DETECTOR_NODE_H
 
+#include <cstddef>
+#include <cstdint>
 #include <optional>
 #include <vector>
 
@@ -24,6 +26,92 @@
 
 namespace pm {
 
+class DetectorNode;
+
+/// The neighbor index used in a MatchingGraphTopology to denote an edge to the boundary.
+constexpr node_index_int BOUNDARY_NEIGHBOR_INDEX = UINT32_MAX;
+/// The largest number of nodes a MatchingGraph can have, so that every node index is less than
+/// BOUNDARY_NEIGHBOR_INDEX.
+constexpr size_t MAX_MATCHING_GRAPH_NODES = BOUNDARY_NEIGHBOR_INDEX;
+
+/// A read-only view of the neighbors of a node (a DetectorNode, or a SearchDetectorNode). The neighbors are stored
+/// as node indices in a MatchingGraphTopology (which may be shared by several graphs), and are resolved to pointers
+/// into the `nodes' of the graph that owns the node. A boundary edge resolves to nullptr.
+template <typename Node>
+class BasicNeighborList {
+   public:
+    BasicNeighborList() : graph_nodes(nullptr), indices(nullptr), count(0) {
+    }
+    BasicNeighborList(Node* graph_nodes, const node_index_int* indices, size_t count)
+        : graph_nodes(graph_nodes), indices(indices), count(count) {
+    }
+
+    struct iterator {
+        const BasicNeighborList* list;
+        size_t k;
+        inline Node* operator*() const {
+            return (*list)[k];
+        }
+        inline iterator& operator++() {
+            k++;
+            return *this;
+        }
+        inline bool operator!=(const iterator& other) const {
+            return k != other.k;
+        }
+    };
+
+    inline Node* operator[](size_t k) const {
+        node_index_int index = indices[k];
+        return index == BOUNDARY_NEIGHBOR_INDEX ? nullptr : graph_nodes + index;
+    }
+    inline size_t size() const {
+        return count;
+    }
+    inline bool empty() const {
+        return count == 0;
+    }
+    inline iterator begin() const {
+        return {this, 0};
+    }
+    inline iterator end() const {
+        return {this, count};
+    }
+    /// The node indices of the neighbors, as stored in the topology.
+    inline const node_index_int* index_data() const {
+        return indices;
+    }
+
+   private:
+    Node* graph_nodes;
+    const node_index_int* indices;
+    size_t count;
+};
+
+typedef BasicNeighborList<DetectorNode> NeighborList;
+
+/// A read-only view of one value per edge of a DetectorNode (its weight or observables), stored in a
+/// MatchingGraphTopology. It has as many elements as the node's `neighbors', and doesn't store that count again
+/// so that the hot fields of a DetectorNode fit in a single cache line.
+template <typename T>
+class EdgeValues {
+   public:
+    EdgeValues() : values(nullptr) {
+    }
+    explicit EdgeValues(const T* values) : values(values) {
+    }
+
+    inline const T& operator[](size_t k) const {
+        return values[k];
+    }
+    inline const T* data() const {
+        return values;
+    }
+
+   private:
+    const T* values;
+};
+
 /// A detector node is a location where a detection event might occur.
 ///
 /// It corresponds to a potential symptom that could be seen, and can
@@ -31,40 +119,50 @@ namespace pm {
 ///
 /// There is a 1:1 correspondence between detector nodes in a matching
 /// graph and the DETECTOR annotations in a Stim circuit.
-class DetectorNode {
+///
+/// The fields are split by how often they are used. The fields read or written in every flood step (the top
+/// region, the radius, the event tracker and the neighbors and weights of the edges) are packed into the first
+/// cache line of the node, and the node is aligned to a cache line. The fields only used when a region arrives at
+/// or leaves the node, or when regions collide (the source links and observables), are in the second.
+class alignas(64) DetectorNode {
    public:
     DetectorNode()
-        : region_that_arrived(nullptr),
-          region_that_arrived_top(nullptr),
+        : region_that_arrived_top(nullptr),
           wrapped_radius_cached(0),
+          radius_of_arrival(0),
+          region_that_arrived(nullptr),
           reached_from_source(nullptr),
-          observables_crossed_from_source(0),
-          radius_of_arrival(0) {
+          observables_crossed_from_source(0) {
     }
 
     /// == Ephemeral fields used to track algorithmic state during matching. ==
-    /// The region that reached and owns this node.
-    GraphFillRegion* region_that_arrived;
     /// The topmost region containing this node. Must be kept up to date as
     /// the region structure changes.
     GraphFillRegion* region_that_arrived_top;
     /// Stores the latest value of `compute_wrapped_radius` so it doesn't need to be recomputed
     /// as much. Updated whenever region_that_arrived_top changes.
     int32_t wrapped_radius_cached;
+    /// Manages the next "look at me!" event for the node.
+    QueuedEventTracker node_event_tracker;
+    /// This was the radius of `region_that_arrived` when it arrived at this node. Otherwise 0.
+    cumulative_time_int radius_of_arrival;
+
+    /// == Permanent fields used to define the structure of the graph. ==
+    /// These are views into the (possibly shared) MatchingGraphTopology, bound by the owning MatchingGraph.
+    NeighborList neighbors;                  /// The node's neighbors.
+    EdgeValues<weight_int> neighbor_weights;  /// Distance crossed by the edge to each neighbor.
+
+    /// == Colder ephemeral fields. ==
+    /// The region that reached and owns this node.
+    GraphFillRegion* region_that_arrived;
     /// Of the detection events within the owning region, which one is this node linked to.
     DetectorNode* reached_from_source;
     /// Which observables are crossed, travelling from this node to the source
     /// detection event that reached it. Must be 0 if reached_from_source == nullptr.
     obs_int observables_crossed_from_source;
-    /// This was the radius of `region_that_arrived` when it arrived at this node. Otherwise 0.
-    cumulative_time_int radius_of_arrival;
-    /// Manages the next "look at me!" event for the node.
-    QueuedEventTracker node_event_tracker;
 
-    /// == Permanent fields used to define the structure of the graph. ==
-    std::vector<DetectorNode*> neighbors;       /// The node's neighbors.
-    std::vector<weight_int> neighbor_weights;   /// Distance crossed by the edge to each neighbor.
-    std::vector<obs_int> neighbor_observables;  /// Observables crossed by the edge to each neighbor.
+    /// == Colder permanent fields. ==
+    EdgeValues<obs_int> neighbor_observables;  /// Observables crossed by the edge to each neighbor.
 
     /// After it reached this node, how much further did the owning search region grow? Also is it currently growing?
     inline VaryingCT local_radius() const {
@@ -124,6 +222,9 @@ class DetectorNode {
         cumulative_time_int time, const GraphFillRegion& bounding_region, size_t neighbor_index) const;
 };
 
+// The hot fields must stay within the first cache line (on platforms with 64-bit pointers).
+static_assert(sizeof(void*) != 8 || offsetof(DetectorNode, region_that_arrived) <= 64);
+
 }  // namespace pm
 
 #endif  // PYMATCHING_FILL_MATCH_DETECTOR_NODE_H
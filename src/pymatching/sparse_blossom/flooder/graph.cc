@@ -14,8 +14,11 @@
 
 #include "pymatching/sparse_blossom/flooder/graph.h"
 
+#include <algorithm>
+
 #include "pymatching/sparse_blossom/flooder/graph_fill_region.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/mwpm_event.h"
+#include "pymatching/sparse_blossom/memory_bytes.h"
 
 namespace pm {
 
@@ -48,13 +51,12 @@ void MatchingGraph::add_edge(size_t u, size_t v, signed_weight_int weight, const
             obs_mask ^= (pm::obs_int)1 << obs;
     }
 
-    nodes[u].neighbors.push_back(&(nodes[v]));
-    nodes[u].neighbor_weights.push_back(std::abs(weight));
-    nodes[u].neighbor_observables.push_back(obs_mask);
+    ensure_topology_is_editable();
+    topology->add_half_edge(u, (node_index_int)v, std::abs(weight), obs_mask, observables);
+    topology->add_half_edge(v, (node_index_int)u, std::abs(weight), obs_mask, observables);
 
-    nodes[v].neighbors.push_back(&(nodes[u]));
-    nodes[v].neighbor_weights.push_back(std::abs(weight));
-    nodes[v].neighbor_observables.push_back(obs_mask);
+    bind_node_to_topology(u);
+    bind_node_to_topology(v);
 }
 
 void MatchingGraph::add_boundary_edge(size_t u, signed_weight_int weight, const std::vector<size_t>& observables) {
@@ -82,36 +84,536 @@ void MatchingGraph::add_boundary_edge(size_t u, signed_weight_int weight, const
     if (!n.neighbors.empty() && n.neighbors[0] == nullptr) {
         throw std::invalid_argument("Max one boundary edge.");
     }
-    n.neighbors.insert(n.neighbors.begin(), 1, nullptr);
-    n.neighbor_weights.insert(n.neighbor_weights.begin(), 1, std::abs(weight));
-    n.neighbor_observables.insert(n.neighbor_observables.begin(), 1, obs_mask);
+    ensure_topology_is_editable();
+    topology->add_half_edge(u, BOUNDARY_NEIGHBOR_INDEX, std::abs(weight), obs_mask, observables);
+    bind_node_to_topology(u);
+}
+
+void MatchingGraph::update_edge(
+    size_t u,
+    size_t v,
+    signed_weight_int old_weight,
+    const std::vector<size_t>& old_observables,
+    signed_weight_int new_weight,
+    const std::vector<size_t>& new_observables,
+    bool copy_shared_topology) {
+    if (u >= nodes.size() || (v != SIZE_MAX && v >= nodes.size())) {
+        throw std::invalid_argument(
+            "Node " + std::to_string(v != SIZE_MAX ? std::max(u, v) : u) + " exceeds number of nodes in graph (" +
+            std::to_string(num_nodes) + ")");
+    }
+    // Remove the contribution of the old edge if it had a negative weight, and add the new one.
+    if (old_weight < 0) {
+        update_negative_weight_observables(old_observables);
+        update_negative_weight_detection_events(u);
+        if (v != SIZE_MAX)
+            update_negative_weight_detection_events(v);
+        negative_weight_sum -= old_weight;
+    }
+    if (new_weight < 0) {
+        update_negative_weight_observables(new_observables);
+        update_negative_weight_detection_events(u);
+        if (v != SIZE_MAX)
+            update_negative_weight_detection_events(v);
+        negative_weight_sum += new_weight;
+    }
+    if (u == v)
+        return;
+
+    pm::obs_int obs_mask = 0;
+    if (num_observables <= sizeof(pm::obs_int) * 8) {
+        for (auto obs : new_observables)
+            obs_mask ^= (pm::obs_int)1 << obs;
+    }
+    if (topology->is_periodic() || (copy_shared_topology && topology.use_count() > 1)) {
+        topology = std::make_shared<MatchingGraphTopology>(
+            topology->is_periodic() ? topology->expanded() : MatchingGraphTopology(*topology));
+        bind_all_nodes_to_topology();
+    }
+    topology->set_half_edge(
+        u, v == SIZE_MAX ? BOUNDARY_NEIGHBOR_INDEX : (node_index_int)v, std::abs(new_weight), obs_mask, new_observables);
+    if (v != SIZE_MAX)
+        topology->set_half_edge(v, (node_index_int)u, std::abs(new_weight), obs_mask, new_observables);
+}
+
+void MatchingGraphTopology::add_half_edge(
+    size_t u, node_index_int v, weight_int weight, obs_int obs_mask, const std::vector<size_t>& observables) {
+    auto& t = nodes[u];
+    size_t k = v == BOUNDARY_NEIGHBOR_INDEX ? 0 : t.neighbors.size();
+    t.neighbors.insert(t.neighbors.begin() + k, v);
+    t.neighbor_weights.insert(t.neighbor_weights.begin() + k, weight);
+    t.neighbor_observables.insert(t.neighbor_observables.begin() + k, obs_mask);
+    if (has_observable_indices)
+        t.neighbor_observable_indices.insert(t.neighbor_observable_indices.begin() + k, observables);
+}
+
+void MatchingGraphTopology::set_half_edge(
+    size_t u, node_index_int v, weight_int weight, obs_int obs_mask, const std::vector<size_t>& observables) {
+    const node_index_int *begin, *end;
+    weight_int* weights;
+    obs_int* masks;
+    if (is_compact()) {
+        begin = neighbors.data() + offsets[u];
+        end = neighbors.data() + offsets[u + 1];
+        weights = neighbor_weights.mutable_data() + offsets[u];
+        masks = neighbor_observables.mutable_data() + offsets[u];
+    } else {
+        auto& t = nodes[u];
+        begin = t.neighbors.data();
+        end = begin + t.neighbors.size();
+        weights = t.neighbor_weights.data();
+        masks = t.neighbor_observables.data();
+    }
+    auto it = std::find(begin, end, v);
+    if (it == end) {
+        throw std::invalid_argument(
+            "Edge (" + std::to_string(u) + ", " + (v == BOUNDARY_NEIGHBOR_INDEX ? "boundary" : std::to_string(v)) +
+            ") is not in the graph.");
+    }
+    size_t k = it - begin;
+    weights[k] = weight;
+    masks[k] = obs_mask;
+    if (!has_observable_indices)
+        return;
+    if (!is_compact()) {
+        nodes[u].neighbor_observable_indices[k] = observables;
+        return;
+    }
+    // Replace the observables of the edge in the flat array, moving those of the later edges if the number changed.
+    size_t position = offsets[u] + k;
+    auto first = observable_indices.begin() + observable_offsets[position];
+    auto last = observable_indices.begin() + observable_offsets[position + 1];
+    size_t old_size = last - first;
+    if (old_size == observables.size()) {
+        std::copy(observables.begin(), observables.end(), first);
+        return;
+    }
+    first = observable_indices.erase(first, last);
+    observable_indices.insert(first, observables.begin(), observables.end());
+    for (size_t p = position + 1; p < observable_offsets.size(); p++)
+        observable_offsets[p] = observable_offsets[p] - old_size + observables.size();
+}
+
+void MatchingGraph::bind_node_to_topology(size_t node_id) {
+    auto& n = nodes[node_id];
+    if (topology->is_compact()) {
+        // Shifting the node array by the offset of a periodic node's edges resolves its unit cell neighbors.
+        auto edges = topology->compact_edges_of(node_id);
+        n.neighbors = NeighborList(
+            nodes.data() + edges.shift, topology->neighbors.data() + edges.begin, edges.end - edges.begin);
+        n.neighbor_weights = EdgeValues<weight_int>(topology->neighbor_weights.data() + edges.begin);
+        n.neighbor_observables = EdgeValues<obs_int>(topology->neighbor_observables.data() + edges.begin);
+    } else {
+        auto& t = topology->nodes[node_id];
+        n.neighbors = NeighborList(nodes.data(), t.neighbors.data(), t.neighbors.size());
+        n.neighbor_weights = EdgeValues<weight_int>(t.neighbor_weights.data());
+        n.neighbor_observables = EdgeValues<obs_int>(t.neighbor_observables.data());
+    }
+}
+
+void MatchingGraph::bind_all_nodes_to_topology() {
+    for (size_t i = 0; i < nodes.size(); i++)
+        bind_node_to_topology(i);
+}
+
+void MatchingGraph::ensure_topology_is_editable() {
+    if (topology->is_compact()) {
+        topology = std::make_shared<MatchingGraphTopology>(topology->unpacked());
+        bind_all_nodes_to_topology();
+    } else if (topology.use_count() > 1) {
+        topology = std::make_shared<MatchingGraphTopology>(*topology);
+        bind_all_nodes_to_topology();
+    }
+}
+
+MatchingGraphTopology MatchingGraphTopology::unpacked() const {
+    MatchingGraphTopology result;
+    result.has_observable_indices = has_observable_indices;
+    result.nodes.resize(num_compact_nodes());
+    for (size_t i = 0; i < result.nodes.size(); i++) {
+        auto& t = result.nodes[i];
+        auto [begin, end, shift] = compact_edges_of(i);
+        for (size_t k = begin; k < end; k++) {
+            auto v = neighbors[k];
+            t.neighbors.push_back(v == BOUNDARY_NEIGHBOR_INDEX ? v : v + shift);
+        }
+        t.neighbor_weights.assign(neighbor_weights.begin() + begin, neighbor_weights.begin() + end);
+        t.neighbor_observables.assign(neighbor_observables.begin() + begin, neighbor_observables.begin() + end);
+        if (has_observable_indices) {
+            for (size_t k = begin; k < end; k++) {
+                t.neighbor_observable_indices.emplace_back(
+                    observable_indices.begin() + observable_offsets[k],
+                    observable_indices.begin() + observable_offsets[k + 1]);
+            }
+        }
+    }
+    return result;
+}
+
+MatchingGraphTopology MatchingGraphTopology::packed() const {
+    MatchingGraphTopology result;
+    result.has_observable_indices = has_observable_indices;
+    size_t num_edge_ends = 0;
+    for (auto& t : nodes)
+        num_edge_ends += t.neighbors.size();
+    result.offsets.reserve(nodes.size() + 1);
+    result.neighbors.reserve(num_edge_ends);
+    result.neighbor_weights.reserve(num_edge_ends);
+    result.neighbor_observables.reserve(num_edge_ends);
+    result.offsets.push_back(0);
+    if (has_observable_indices) {
+        result.observable_offsets.reserve(num_edge_ends + 1);
+        result.observable_offsets.push_back(0);
+    }
+    for (auto& t : nodes) {
+        result.neighbors.insert(result.neighbors.end(), t.neighbors.begin(), t.neighbors.end());
+        result.neighbor_weights.insert(
+            result.neighbor_weights.end(), t.neighbor_weights.begin(), t.neighbor_weights.end());
+        result.neighbor_observables.insert(
+            result.neighbor_observables.end(), t.neighbor_observables.begin(), t.neighbor_observables.end());
+        for (auto& obs : t.neighbor_observable_indices) {
+            result.observable_indices.insert(result.observable_indices.end(), obs.begin(), obs.end());
+            result.observable_offsets.push_back(result.observable_indices.size());
+        }
+        result.offsets.push_back(result.neighbors.size());
+    }
+    return result;
+}
+
+MatchingGraphTopology MatchingGraphTopology::expanded() const {
+    MatchingGraphTopology result;
+    result.has_observable_indices = has_observable_indices;
+    if (has_observable_indices)
+        result.observable_offsets.push_back(0);
+    size_t num_nodes = num_compact_nodes();
+    result.offsets.reserve(num_nodes + 1);
+    result.offsets.push_back(0);
+    for (size_t i = 0; i < num_nodes; i++) {
+        auto [begin, end, shift] = compact_edges_of(i);
+        result.append_compact_edges(*this, begin, end, shift);
+        result.offsets.push_back(result.neighbors.size());
+    }
+    result.component_of_node = component_of_node;
+    result.num_components = num_components;
+    return result;
+}
+
+MatchingGraphTopology MatchingGraphTopology::copy_with_huge_pages(HugePagePolicy huge_pages) const {
+    MatchingGraphTopology result;
+    result.nodes = nodes;
+    result.offsets = PackedArray<size_t>(huge_pages);
+    result.offsets.assign(offsets.begin(), offsets.end());
+    result.neighbors = PackedArray<node_index_int>(huge_pages);
+    result.neighbors.assign(neighbors.begin(), neighbors.end());
+    result.neighbor_weights = PackedArray<weight_int>(huge_pages);
+    result.neighbor_weights.assign(neighbor_weights.begin(), neighbor_weights.end());
+    result.neighbor_observables = PackedArray<obs_int>(huge_pages);
+    result.neighbor_observables.assign(neighbor_observables.begin(), neighbor_observables.end());
+    result.has_observable_indices = has_observable_indices;
+    result.observable_offsets = observable_offsets;
+    result.observable_indices = observable_indices;
+    result.component_of_node = component_of_node;
+    result.num_components = num_components;
+    result.period = period;
+    result.periodic_begin = periodic_begin;
+    result.periodic_end = periodic_end;
+    return result;
+}
+
+size_t MatchingGraphTopology::owned_bytes() const {
+    size_t total = memory_bytes(nodes) + memory_bytes(observable_offsets) + memory_bytes(observable_indices);
+    for (const auto& node : nodes) {
+        total += memory_bytes(node.neighbors) + memory_bytes(node.neighbor_weights) +
+                 memory_bytes(node.neighbor_observables) + memory_bytes(node.neighbor_observable_indices);
+        for (const auto& indices : node.neighbor_observable_indices)
+            total += memory_bytes(indices);
+    }
+    return total + offsets.owned_bytes() + neighbors.owned_bytes() + neighbor_weights.owned_bytes() +
+           neighbor_observables.owned_bytes() + component_of_node.owned_bytes();
+}
+
+size_t MatchingGraphTopology::viewed_bytes() const {
+    return offsets.viewed_bytes() + neighbors.viewed_bytes() + neighbor_weights.viewed_bytes() +
+           neighbor_observables.viewed_bytes() + component_of_node.viewed_bytes();
+}
+
+void MatchingGraphTopology::append_compact_edges(
+    const MatchingGraphTopology& source, size_t begin, size_t end, node_index_int shift) {
+    for (size_t k = begin; k < end; k++) {
+        auto v = source.neighbors[k];
+        neighbors.push_back(v == BOUNDARY_NEIGHBOR_INDEX ? v : v + shift);
+    }
+    neighbor_weights.insert(
+        neighbor_weights.end(), source.neighbor_weights.begin() + begin, source.neighbor_weights.begin() + end);
+    neighbor_observables.insert(
+        neighbor_observables.end(),
+        source.neighbor_observables.begin() + begin,
+        source.neighbor_observables.begin() + end);
+    if (has_observable_indices) {
+        for (size_t k = begin; k < end; k++) {
+            observable_indices.insert(
+                observable_indices.end(),
+                source.observable_indices.begin() + source.observable_offsets[k],
+                source.observable_indices.begin() + source.observable_offsets[k + 1]);
+            observable_offsets.push_back(observable_indices.size());
+        }
+    }
+}
+
+void MatchingGraphTopology::label_components() {
+    size_t num_nodes = num_compact_nodes();
+    component_of_node.assign(num_nodes, SIZE_MAX);
+    size_t* component = component_of_node.mutable_data();
+    num_components = 0;
+    std::vector<size_t> stack;
+    for (size_t start = 0; start < num_nodes; start++) {
+        if (component[start] != SIZE_MAX)
+            continue;
+        component[start] = num_components;
+        stack.push_back(start);
+        while (!stack.empty()) {
+            size_t u = stack.back();
+            stack.pop_back();
+            auto [begin, end, shift] = compact_edges_of(u);
+            for (size_t k = begin; k < end; k++) {
+                if (neighbors[k] == BOUNDARY_NEIGHBOR_INDEX)
+                    continue;
+                size_t v = neighbors[k] + shift;
+                if (component[v] == SIZE_MAX) {
+                    component[v] = num_components;
+                    stack.push_back(v);
+                }
+            }
+        }
+        num_components++;
+    }
+}
+
+int64_t MatchingGraphTopology::path_length_bound() const {
+    int64_t bound = 0;
+    for (size_t u = 0; u < num_compact_nodes(); u++) {
+        weight_int max_weight = 0;
+        auto [begin, end, shift] = compact_edges_of(u);
+        for (size_t k = begin; k < end; k++)
+            max_weight = std::max(max_weight, neighbor_weights[k]);
+        bound += max_weight;
+    }
+    return bound;
+}
+
+void MatchingGraph::check_path_lengths_fit() const {
+    if constexpr (PM_COMPACT_WEIGHTS) {
+        if (topology->path_length_bound() > MAX_COMPACT_PATH_LENGTH) {
+            throw std::invalid_argument(
+                "The graph is too large for this build of PyMatching, which uses 16-bit weights and 32-bit times "
+                "(PYMATCHING_COMPACT_WEIGHTS). Use a build without that option.");
+        }
+    }
+}
+
+void MatchingGraph::compact_topology() {
+    if (topology->is_compact())
+        return;
+    auto compact = std::make_shared<MatchingGraphTopology>(topology->packed());
+    compact->label_components();
+    topology = std::move(compact);
+    bind_all_nodes_to_topology();
+    check_path_lengths_fit();
+}
+
+bool MatchingGraph::compress_periodic_topology() {
+    compact_topology();
+    if (topology->is_periodic())
+        return false;
+    const auto& t = *topology;
+    size_t n = nodes.size();
+    if (n < 3)
+        return false;
+
+    // The period is the number of nodes in a round, which is the distance from a node in the bulk to its copy in
+    // the next round, so the candidates are the distances from a node in the middle of the graph to its neighbors.
+    std::vector<size_t> candidates;
+    size_t middle = n / 2;
+    for (size_t k = t.offsets[middle]; k < t.offsets[middle + 1]; k++) {
+        size_t v = t.neighbors[k];
+        if (v != BOUNDARY_NEIGHBOR_INDEX && v != middle)
+            candidates.push_back(v > middle ? v - middle : middle - v);
+    }
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // Whether node i has the edges of node i - p, shifted by p.
+    auto repeats = [&](size_t i, size_t p) {
+        size_t a = t.offsets[i];
+        size_t b = t.offsets[i - p];
+        size_t degree = t.offsets[i + 1] - a;
+        if (degree != t.offsets[i - p + 1] - b)
+            return false;
+        for (size_t k = 0; k < degree; k++) {
+            size_t u = t.neighbors[a + k];
+            size_t w = t.neighbors[b + k];
+            bool same_neighbor = w == BOUNDARY_NEIGHBOR_INDEX ? u == BOUNDARY_NEIGHBOR_INDEX
+                                                              : u != BOUNDARY_NEIGHBOR_INDEX && u == w + p;
+            if (!same_neighbor || t.neighbor_weights[a + k] != t.neighbor_weights[b + k] ||
+                t.neighbor_observables[a + k] != t.neighbor_observables[b + k])
+                return false;
+            if (t.has_observable_indices) {
+                auto obs_u = t.observable_indices_of(i, k);
+                auto obs_w = t.observable_indices_of(i - p, k);
+                if (!std::equal(obs_u.begin(), obs_u.end(), obs_w.begin(), obs_w.end()))
+                    return false;
+            }
+        }
+        return true;
+    };
+
+    // Pick the period and the run of repeating nodes that saves the most nodes. A run must cover at least one whole
+    // period beyond the unit cell for compression to be worthwhile.
+    size_t best_period = 0, best_run_begin = 0, best_run_end = 0;
+    for (size_t p : candidates) {
+        if (2 * p > n)
+            continue;
+        size_t run_begin = p;
+        for (size_t i = p; i <= n; i++) {
+            if (i < n && repeats(i, p))
+                continue;
+            if (i - run_begin >= p && i - run_begin > best_run_end - best_run_begin) {
+                best_period = p;
+                best_run_begin = run_begin;
+                best_run_end = i;
+            }
+            run_begin = i + 1;
+        }
+    }
+    if (best_period == 0)
+        return false;
+
+    auto periodic = std::make_shared<MatchingGraphTopology>();
+    periodic->period = best_period;
+    periodic->periodic_begin = best_run_begin - best_period;
+    periodic->periodic_end = best_run_end;
+    periodic->offsets.push_back(0);
+    periodic->has_observable_indices = t.has_observable_indices;
+    if (t.has_observable_indices)
+        periodic->observable_offsets.push_back(0);
+    auto copy_rows = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            periodic->append_compact_edges(t, t.offsets[i], t.offsets[i + 1], 0);
+            periodic->offsets.push_back(periodic->neighbors.size());
+        }
+    };
+    copy_rows(0, best_run_begin);
+    copy_rows(best_run_end, n);
+    periodic->component_of_node = t.component_of_node;
+    periodic->num_components = t.num_components;
+    topology = std::move(periodic);
+    bind_all_nodes_to_topology();
+    return true;
+}
+
+void MatchingGraph::set_topology(std::shared_ptr<MatchingGraphTopology> new_topology) {
+    topology = std::move(new_topology);
+    if (topology->is_compact() && topology->component_of_node.size() != nodes.size())
+        topology->label_components();
+    if (topology->is_compact())
+        check_path_lengths_fit();
+    bind_all_nodes_to_topology();
 }
 
+MatchingGraph MatchingGraph::clone_sharing_topology() const {
+    MatchingGraph clone;
+    clone.nodes.resize(nodes.size());
+    clone.topology = topology;
+    clone.negative_weight_detection_events_set = negative_weight_detection_events_set;
+    clone.negative_weight_observables_set = negative_weight_observables_set;
+    clone.negative_weight_sum = negative_weight_sum;
+    clone.is_user_graph_boundary_node = is_user_graph_boundary_node;
+    clone.num_nodes = num_nodes;
+    clone.num_observables = num_observables;
+    clone.normalising_constant = normalising_constant;
+    clone.node_relabeling = node_relabeling;
+    clone.bind_all_nodes_to_topology();
+    return clone;
+}
+
+namespace {
+
+void check_num_nodes(size_t num_nodes) {
+    if (num_nodes > MAX_MATCHING_GRAPH_NODES) {
+        throw std::invalid_argument(
+            "A graph can have at most " + std::to_string(MAX_MATCHING_GRAPH_NODES) + " nodes, but " +
+            std::to_string(num_nodes) + " were requested.");
+    }
+}
+
+}  // namespace
+
 MatchingGraph::MatchingGraph(size_t num_nodes, size_t num_observables)
-    : negative_weight_sum(0), num_nodes(num_nodes), num_observables(num_observables), normalising_constant(0) {
+    : topology(std::make_shared<MatchingGraphTopology>()),
+      negative_weight_sum(0),
+      num_nodes(num_nodes),
+      num_observables(num_observables),
+      normalising_constant(0) {
+    check_num_nodes(num_nodes);
     nodes.resize(num_nodes);
+    topology->nodes.resize(num_nodes);
+    topology->has_observable_indices = num_observables > sizeof(pm::obs_int) * 8;
 }
 
 MatchingGraph::MatchingGraph(size_t num_nodes, size_t num_observables, double normalising_constant)
-    : negative_weight_sum(0),
+    : topology(std::make_shared<MatchingGraphTopology>()),
+      negative_weight_sum(0),
       num_nodes(num_nodes),
       num_observables(num_observables),
       normalising_constant(normalising_constant) {
+    check_num_nodes(num_nodes);
     nodes.resize(num_nodes);
+    topology->nodes.resize(num_nodes);
+    topology->has_observable_indices = num_observables > sizeof(pm::obs_int) * 8;
 }
 
 MatchingGraph::MatchingGraph(MatchingGraph&& graph) noexcept
     : nodes(std::move(graph.nodes)),
+      topology(std::move(graph.topology)),
       negative_weight_detection_events_set(std::move(graph.negative_weight_detection_events_set)),
       negative_weight_observables_set(std::move(graph.negative_weight_observables_set)),
       negative_weight_sum(graph.negative_weight_sum),
       is_user_graph_boundary_node(std::move(graph.is_user_graph_boundary_node)),
       num_nodes(graph.num_nodes),
       num_observables(graph.num_observables),
-      normalising_constant(graph.normalising_constant) {
+      normalising_constant(graph.normalising_constant),
+      node_relabeling(std::move(graph.node_relabeling)),
+      relabeled_detection_events(std::move(graph.relabeled_detection_events)) {
+}
+
+std::span<const uint64_t> MatchingGraph::to_graph_node_indices(std::span<const uint64_t> detection_events) {
+    if (!node_relabeling)
+        return detection_events;
+    auto& graph_index = node_relabeling->graph_index;
+    relabeled_detection_events.resize(detection_events.size());
+    for (size_t k = 0; k < detection_events.size(); k++) {
+        auto d = detection_events[k];
+        relabeled_detection_events[k] = d < graph_index.size() ? graph_index[d] : d;
+    }
+    return relabeled_detection_events;
+}
+
+NodeRelabeling::NodeRelabeling(std::vector<size_t> original_index)
+    : original_index(std::move(original_index)), graph_index(this->original_index.size(), SIZE_MAX) {
+    for (size_t i = 0; i < this->original_index.size(); i++) {
+        size_t j = this->original_index[i];
+        if (j >= graph_index.size() || graph_index[j] != SIZE_MAX)
+            throw std::invalid_argument("A node relabeling must be a permutation of the nodes of the graph.");
+        graph_index[j] = i;
+    }
 }
 
-MatchingGraph::MatchingGraph() : negative_weight_sum(0), num_nodes(0), num_observables(0), normalising_constant(0) {
+MatchingGraph::MatchingGraph()
+    : topology(std::make_shared<MatchingGraphTopology>()),
+      negative_weight_sum(0),
+      num_nodes(0),
+      num_observables(0),
+      normalising_constant(0) {
 }
 
 void MatchingGraph::update_negative_weight_observables(const std::vector<size_t>& observables) {
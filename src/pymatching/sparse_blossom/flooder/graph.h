@@ -15,11 +15,14 @@
 #ifndef PYMATCHING2_GRAPH_H
 #define PYMATCHING2_GRAPH_H
 
+#include <memory>
 #include <set>
+#include <span>
 #include <vector>
 
 #include "pymatching/sparse_blossom/flooder/detector_node.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/varying.h"
+#include "pymatching/sparse_blossom/packed_array.h"
 #include "pymatching/sparse_blossom/tracker/flood_check_event.h"
 #include "pymatching/sparse_blossom/tracker/queued_event_tracker.h"
 
@@ -27,11 +30,149 @@ namespace pm {
 
 struct GraphFillRegion;
 
+/// The edges incident to a single node of a MatchingGraphTopology.
+struct TopologyNode {
+    /// Indices of the neighboring nodes. BOUNDARY_NEIGHBOR_INDEX denotes the boundary, which if present is first.
+    std::vector<node_index_int> neighbors;
+    std::vector<weight_int> neighbor_weights;   /// Distance crossed by the edge to each neighbor.
+    std::vector<obs_int> neighbor_observables;  /// Observables crossed by the edge to each neighbor.
+    /// Indices of the observables crossed by the edge to each neighbor. Empty unless the topology
+    /// `has_observable_indices'.
+    std::vector<std::vector<size_t>> neighbor_observable_indices;
+};
+
+/// The permanent structure of a MatchingGraph. It contains no algorithmic state, so it can be shared
+/// (read-only) by many MatchingGraph objects, each of which holds its own ephemeral DetectorNode state, and by the
+/// SearchGraph of each of their Mwpm objects, which holds its own ephemeral SearchDetectorNode state.
+///
+/// The edges are stored in one of two layouts. While the graph is being built edge by edge they are held
+/// per node in `nodes'. Once the graph is complete, `MatchingGraph::compact_topology' packs them into a
+/// compressed sparse row (CSR) layout, so that scanning the neighbors of a node touches contiguous memory
+/// rather than three separate heap allocations per node. The packed arrays, which are scanned while flooding, can be
+/// backed by huge pages (see `copy_with_huge_pages'), or be read-only views of a graph file mapped into memory (see
+/// `attach_mwpm_to_graph_file').
+struct MatchingGraphTopology {
+    /// Editable per-node edges. Empty once the topology has been compacted.
+    std::vector<TopologyNode> nodes;
+    /// CSR layout: the edges of node i are at positions [offsets[i], offsets[i + 1]) of the packed arrays
+    /// below. Empty until the topology has been compacted.
+    PackedArray<size_t> offsets;
+    PackedArray<node_index_int> neighbors;
+    PackedArray<weight_int> neighbor_weights;
+    PackedArray<obs_int> neighbor_observables;
+    /// Whether the observables of the edges are also stored as lists of indices. This is the case for graphs with more
+    /// observables than fit in an obs_int, whose `neighbor_observables' are all zero, so that the SearchFlooder can
+    /// reconstruct the observables crossed by a path.
+    bool has_observable_indices = false;
+    /// CSR layout of the observable indices: the observables of the edge at position k of the packed arrays above are
+    /// at positions [observable_offsets[k], observable_offsets[k + 1]) of `observable_indices'. Empty unless the
+    /// topology has been compacted and `has_observable_indices'.
+    std::vector<size_t> observable_offsets;
+    std::vector<size_t> observable_indices;
+    /// The connected component of each node, ignoring the boundary, with components numbered from 0 in order of
+    /// their smallest node. Since every path between two nodes stays in one component, and a detection event can
+    /// always be matched to the boundary without leaving its own, the components can be matched independently.
+    /// Labeled when the topology is compacted, and empty until then.
+    PackedArray<size_t> component_of_node;
+    size_t num_components = 0;
+    /// Periodic compact layout, set by `MatchingGraph::compress_periodic_topology'. If `period' is nonzero, the
+    /// edges of each node i in [periodic_begin + period, periodic_end) are those of node i - period, with each
+    /// neighbor other than the boundary shifted by `period', so they are only stored once, for the unit cell of nodes
+    /// [periodic_begin, periodic_begin + period). The other nodes keep their own rows of the CSR layout.
+    size_t period = 0;
+    size_t periodic_begin = 0;
+    size_t periodic_end = 0;
+
+    /// The edges of a node in the compact layout: positions [begin, end) of the packed arrays, whose neighbors other
+    /// than the boundary are offset by `shift'.
+    struct CompactEdges {
+        size_t begin;
+        size_t end;
+        node_index_int shift;
+    };
+
+    inline bool is_compact() const {
+        return !offsets.empty();
+    }
+    inline bool is_periodic() const {
+        return period != 0;
+    }
+    /// The number of nodes of a compact topology.
+    inline size_t num_compact_nodes() const {
+        return offsets.size() - 1 + (period != 0 ? periodic_end - periodic_begin - period : 0);
+    }
+    inline CompactEdges compact_edges_of(size_t node) const {
+        size_t row = node;
+        size_t shift = 0;
+        if (period != 0 && node >= periodic_begin + period) {
+            if (node >= periodic_end) {
+                row = node - (periodic_end - periodic_begin - period);
+            } else {
+                shift = (node - periodic_begin) / period * period;
+                row = node - shift;
+            }
+        }
+        return {offsets[row], offsets[row + 1], (node_index_int)shift};
+    }
+    /// The indices of the observables crossed by edge k of `node'. The topology must `has_observable_indices'.
+    inline std::span<const size_t> observable_indices_of(size_t node, size_t k) const {
+        if (!is_compact())
+            return nodes[node].neighbor_observable_indices[k];
+        size_t position = compact_edges_of(node).begin + k;
+        const size_t* first = observable_indices.data();
+        return {first + observable_offsets[position], first + observable_offsets[position + 1]};
+    }
+    /// Adds the edge from `u' to `v' to the per-node layout, before the other edges of `u' if `v' is
+    /// BOUNDARY_NEIGHBOR_INDEX. `observables' are only recorded if the topology `has_observable_indices'.
+    void add_half_edge(
+        size_t u, node_index_int v, weight_int weight, obs_int obs_mask, const std::vector<size_t>& observables);
+    /// Sets the weight and observables of the existing edge from `u' to `v' in either layout, except the periodic one.
+    /// Throws std::invalid_argument if there is no such edge.
+    void set_half_edge(
+        size_t u, node_index_int v, weight_int weight, obs_int obs_mask, const std::vector<size_t>& observables);
+    /// A copy of a compact topology in the per-node layout, so that edges can be added to it.
+    MatchingGraphTopology unpacked() const;
+    /// A copy of a topology in the per-node layout in the compact layout. The components are not labeled.
+    MatchingGraphTopology packed() const;
+    /// A copy of a periodic topology in the ordinary compact layout, with its own row for every node.
+    MatchingGraphTopology expanded() const;
+    /// A copy of the topology, in the same layout, whose packed arrays are allocated with `huge_pages'. The copy is
+    /// written by the calling thread, so with the usual first-touch policy its memory is on the caller's NUMA node.
+    MatchingGraphTopology copy_with_huge_pages(HugePagePolicy huge_pages) const;
+    /// Appends the edges at positions [begin, end) of the packed arrays of the compact topology `source' to the packed
+    /// arrays of this one, adding `shift' to each neighbor other than the boundary. Does not update `offsets'.
+    void append_compact_edges(const MatchingGraphTopology& source, size_t begin, size_t end, node_index_int shift);
+    /// Fills `component_of_node' and `num_components' from the CSR layout.
+    void label_components();
+    /// An upper bound on the length of any shortest path: the sum over the nodes of the largest weight of their
+    /// edges, since a shortest path visits each node at most once.
+    int64_t path_length_bound() const;
+    /// The memory allocated for the topology, in bytes, not counting the packed arrays that are views.
+    size_t owned_bytes() const;
+    /// The size of the memory viewed by the packed arrays that are views (e.g. of a mapped graph file), in bytes.
+    size_t viewed_bytes() const;
+};
+
+/// A relabeling of the nodes of a MatchingGraph, so that nodes that are close together in the graph are also close
+/// together in memory (see `reverse_cuthill_mckee_order'). Node i of the graph is node `original_index[i]' of the
+/// input it was built from (e.g. detector i of a detector error model), and `graph_index' is the inverse permutation.
+struct NodeRelabeling {
+    std::vector<size_t> original_index;
+    std::vector<size_t> graph_index;
+
+    /// Throws std::invalid_argument if `original_index' is not a permutation.
+    explicit NodeRelabeling(std::vector<size_t> original_index);
+};
+
 /// A collection of detector nodes. It's expected that all detector nodes in the graph
 /// will only refer to other detector nodes within the same graph.
 class MatchingGraph {
    public:
+    /// Per-decoder state for each node. The permanent fields of each node are views into `topology'.
     std::vector<DetectorNode> nodes;
+    /// The structure of the graph. May be shared with other MatchingGraph objects, in which case it must not be
+    /// modified in place (`add_edge' and `add_boundary_edge' will first make a private copy).
+    std::shared_ptr<MatchingGraphTopology> topology;
     /// These are the detection events that would occur if an error occurred on every edge with a negative weight
     std::set<size_t> negative_weight_detection_events_set;
     /// These are the observables that would be flipped if an error occurred on every edge with a negative weight
@@ -48,6 +189,9 @@ class MatchingGraph {
     /// This is the normalising constant that the edge weights were multiplied by when converting from floats to
     /// 16-bit ints.
     double normalising_constant;
+    /// If not null, the nodes were relabeled when the graph was built, and the detection events given to the
+    /// decoder (and the nodes it reports back) use the original labels. Shared by clones of the graph.
+    std::shared_ptr<const NodeRelabeling> node_relabeling;
 
     MatchingGraph();
     MatchingGraph(size_t num_nodes, size_t num_observables);
@@ -55,8 +199,63 @@ class MatchingGraph {
     MatchingGraph(MatchingGraph&& graph) noexcept;
     void add_edge(size_t u, size_t v, signed_weight_int weight, const std::vector<size_t>& observables);
     void add_boundary_edge(size_t u, signed_weight_int weight, const std::vector<size_t>& observables);
+    /// Changes the weight and observables of the existing edge (u, v) in place, or of the boundary edge of u if
+    /// v is SIZE_MAX. `old_weight' and `old_observables' must be the values the edge was added (or last updated)
+    /// with, so that the contribution of an edge with a negative weight can be removed. Unlike `add_edge', this
+    /// keeps the topology in its current layout, but the topology must not be shared by any MatchingGraph that
+    /// is still in use (a shared topology is first copied). If `copy_shared_topology' is false, a shared topology
+    /// is modified in place instead, which is only safe if the change is undone before any of the other graphs
+    /// sharing it are used again (e.g. to temporarily override the weights of a few edges).
+    void update_edge(
+        size_t u,
+        size_t v,
+        signed_weight_int old_weight,
+        const std::vector<size_t>& old_observables,
+        signed_weight_int new_weight,
+        const std::vector<size_t>& new_observables,
+        bool copy_shared_topology = true);
     void update_negative_weight_observables(const std::vector<size_t>& observables);
     void update_negative_weight_detection_events(size_t node_id);
+    /// Creates a new MatchingGraph with fresh ephemeral state but sharing this graph's topology, so that it can be
+    /// used by another decoder (e.g. on another thread) without copying the edges.
+    MatchingGraph clone_sharing_topology() const;
+    /// Packs the edges into the CSR layout of MatchingGraphTopology. Called once the graph has been fully built.
+    /// Edges can still be added afterwards, but doing so first unpacks the topology again. In builds with
+    /// PM_COMPACT_WEIGHTS, this and `set_topology' throw std::invalid_argument if the paths of the graph could be
+    /// too long for 32-bit times (see `check_path_lengths_fit').
+    void compact_topology();
+    /// Looks for a range of nodes whose edges repeat with a fixed period, such as the rounds of a memory experiment
+    /// built from a detector error model with a REPEAT block, and if there is one, stores the edges of those nodes
+    /// only once (see `MatchingGraphTopology::period'), so that the topology takes memory proportional to the size
+    /// of a round rather than the number of rounds. The nodes must be numbered round by round (i.e. not reordered).
+    /// The topology is compacted first if it is not already. Returns true if the topology was made periodic. The
+    /// ephemeral state of the nodes is unaffected, and decoding is unchanged. `update_edge' gives the graph a private
+    /// copy of the topology in the ordinary layout, since a change to one node would otherwise apply to every round.
+    bool compress_periodic_topology();
+    /// Replaces the topology of the graph, which must have `num_nodes' nodes, for example with one built directly in
+    /// the compact layout, and points the nodes at it. The negative weight edges must be accounted for separately.
+    void set_topology(std::shared_ptr<MatchingGraphTopology> new_topology);
+    /// In builds with PM_COMPACT_WEIGHTS, throws std::invalid_argument if the compact topology could have a shortest
+    /// path longer than MAX_COMPACT_PATH_LENGTH. Does nothing otherwise.
+    void check_path_lengths_fit() const;
+    /// Returns `detection_events' in the labels of `nodes': `detection_events' itself if the nodes were not
+    /// relabeled, and otherwise a relabeled copy held in a buffer owned by the graph, which is valid until the next
+    /// call. Indices that are not nodes of the graph are left unchanged, so that they are still reported as errors.
+    std::span<const uint64_t> to_graph_node_indices(std::span<const uint64_t> detection_events);
+    /// Returns the label of node `node_index' in the input the graph was built from.
+    inline size_t original_node_index(size_t node_index) const {
+        return node_relabeling ? node_relabeling->original_index[node_index] : node_index;
+    }
+
+   private:
+    std::vector<uint64_t> relabeled_detection_events;
+
+    /// Points the permanent fields of `nodes[node_id]' at its edges stored in `topology'.
+    void bind_node_to_topology(size_t node_id);
+    void bind_all_nodes_to_topology();
+    /// Makes sure that `topology' is not shared with any other MatchingGraph and is in the per-node layout,
+    /// so that edges can be added to it.
+    void ensure_topology_is_editable();
 };
 
 }  // namespace pm
@@ -51,3 +51,210 @@ TEST(Graph, AddBoundaryEdge) {
     std::set<size_t> expected_detection_events = {0};
     ASSERT_EQ(g.negative_weight_detection_events_set, expected_detection_events);
 }
+
+TEST(Graph, CloneSharingTopology) {
+    pm::MatchingGraph g(3, 64);
+    g.add_edge(0, 1, 2, {0});
+    g.add_boundary_edge(2, 4, {1});
+    g.normalising_constant = 3;
+    auto clone = g.clone_sharing_topology();
+    ASSERT_EQ(clone.topology, g.topology);
+    ASSERT_EQ(clone.nodes.size(), 3);
+    ASSERT_EQ(clone.normalising_constant, 3);
+    ASSERT_EQ(clone.nodes[0].neighbors[0], &clone.nodes[1]);
+    ASSERT_EQ(clone.nodes[1].neighbors[0], &clone.nodes[0]);
+    ASSERT_EQ(clone.nodes[2].neighbors[0], nullptr);
+    ASSERT_EQ(clone.nodes[2].neighbor_weights[0], 4);
+    ASSERT_EQ(clone.nodes[2].neighbor_observables[0], 2);
+    ASSERT_EQ(clone.nodes[0].neighbor_weights.data(), g.nodes[0].neighbor_weights.data());
+
+    // Modifying a graph with a shared topology leaves the other graph unchanged.
+    clone.add_edge(1, 2, 6, {});
+    ASSERT_NE(clone.topology, g.topology);
+    ASSERT_EQ(clone.nodes[1].neighbors.size(), 2);
+    ASSERT_EQ(clone.nodes[1].neighbors[1], &clone.nodes[2]);
+    ASSERT_EQ(clone.nodes[0].neighbors[0], &clone.nodes[1]);
+    ASSERT_EQ(g.nodes[1].neighbors.size(), 1);
+    ASSERT_EQ(g.nodes[2].neighbors.size(), 1);
+}
+
+TEST(Graph, CompactTopology) {
+    pm::MatchingGraph g(4, 64);
+    g.add_edge(0, 1, 2, {0});
+    g.add_edge(1, 2, 4, {1});
+    g.add_boundary_edge(2, 6, {2});
+    g.compact_topology();
+    ASSERT_TRUE(g.topology->is_compact());
+    ASSERT_TRUE(g.topology->nodes.empty());
+    ASSERT_EQ(g.topology->offsets, pm::PackedArray<size_t>({0, 1, 3, 5, 5}));
+    ASSERT_EQ(
+        g.topology->neighbors, pm::PackedArray<pm::node_index_int>({1, 0, 2, pm::BOUNDARY_NEIGHBOR_INDEX, 1}));
+    ASSERT_EQ(g.topology->component_of_node, pm::PackedArray<size_t>({0, 0, 0, 1}));
+    ASSERT_EQ(g.topology->num_components, 2);
+    ASSERT_EQ(g.nodes[0].neighbors.size(), 1);
+    ASSERT_EQ(g.nodes[0].neighbors[0], &g.nodes[1]);
+    ASSERT_EQ(g.nodes[1].neighbors[0], &g.nodes[0]);
+    ASSERT_EQ(g.nodes[1].neighbors[1], &g.nodes[2]);
+    ASSERT_EQ(g.nodes[2].neighbors[0], nullptr);
+    ASSERT_EQ(g.nodes[2].neighbor_weights[0], 6);
+    ASSERT_EQ(g.nodes[2].neighbor_observables[0], 4);
+    ASSERT_EQ(g.nodes[2].neighbors[1], &g.nodes[1]);
+    ASSERT_EQ(g.nodes[1].neighbor_weights[1], 4);
+    ASSERT_EQ(g.nodes[1].neighbor_observables[1], 2);
+    ASSERT_TRUE(g.nodes[3].neighbors.empty());
+    ASSERT_EQ(g.nodes[1].neighbor_weights.data() + 2, g.nodes[2].neighbor_weights.data());
+
+    // Adding an edge to a compacted graph unpacks it again.
+    g.add_edge(2, 3, 8, {});
+    ASSERT_FALSE(g.topology->is_compact());
+    ASSERT_EQ(g.nodes[2].neighbors.size(), 3);
+    ASSERT_EQ(g.nodes[2].neighbors[0], nullptr);
+    ASSERT_EQ(g.nodes[2].neighbors[2], &g.nodes[3]);
+    ASSERT_EQ(g.nodes[3].neighbors[0], &g.nodes[2]);
+    ASSERT_EQ(g.nodes[0].neighbor_weights[0], 2);
+}
+
+namespace {
+
+/// A repetition code memory experiment with `num_rounds' rounds of `d' detectors, in which the first and last
+/// rounds have different weights to the bulk.
+pm::MatchingGraph repetition_code_graph(size_t d, size_t num_rounds) {
+    pm::MatchingGraph g(d * num_rounds, 64);
+    for (size_t r = 0; r < num_rounds; r++) {
+        pm::signed_weight_int w = r == 0 || r + 1 == num_rounds ? 4 : 2;
+        g.add_boundary_edge(r * d, w, {0});
+        for (size_t i = 0; i + 1 < d; i++)
+            g.add_edge(r * d + i, r * d + i + 1, w + (pm::signed_weight_int)(i % 2), {});
+        g.add_boundary_edge(r * d + d - 1, w, {});
+        if (r + 1 < num_rounds) {
+            for (size_t i = 0; i < d; i++)
+                g.add_edge(r * d + i, (r + 1) * d + i, 6, {});
+        }
+    }
+    return g;
+}
+
+void assert_same_edges(const pm::MatchingGraph& a, const pm::MatchingGraph& b) {
+    ASSERT_EQ(a.nodes.size(), b.nodes.size());
+    for (size_t i = 0; i < a.nodes.size(); i++) {
+        auto& na = a.nodes[i];
+        auto& nb = b.nodes[i];
+        ASSERT_EQ(na.neighbors.size(), nb.neighbors.size());
+        for (size_t k = 0; k < na.neighbors.size(); k++) {
+            ASSERT_EQ(na.neighbors[k] == nullptr ? -1 : na.neighbors[k] - a.nodes.data(),
+                      nb.neighbors[k] == nullptr ? -1 : nb.neighbors[k] - b.nodes.data());
+            ASSERT_EQ(na.neighbor_weights[k], nb.neighbor_weights[k]);
+            ASSERT_EQ(na.neighbor_observables[k], nb.neighbor_observables[k]);
+        }
+    }
+}
+
+}  // namespace
+
+TEST(Graph, CompressPeriodicTopology) {
+    size_t d = 5;
+    size_t num_rounds = 40;
+    auto g = repetition_code_graph(d, num_rounds);
+    auto expected = repetition_code_graph(d, num_rounds);
+    expected.compact_topology();
+    ASSERT_TRUE(g.compress_periodic_topology());
+    ASSERT_TRUE(g.topology->is_periodic());
+    ASSERT_EQ(g.topology->period, d);
+    // The second round is the unit cell, since the first has different weights. The second-to-last round is the
+    // last to repeat it, since its edges to the last round are the same.
+    ASSERT_EQ(g.topology->periodic_begin, d);
+    ASSERT_EQ(g.topology->periodic_end, (num_rounds - 1) * d);
+    ASSERT_EQ(g.topology->num_compact_nodes(), d * num_rounds);
+    ASSERT_EQ(g.topology->offsets.size(), 3 * d + 1);
+    ASSERT_LT(g.topology->neighbors.size() * 10, expected.topology->neighbors.size());
+    assert_same_edges(g, expected);
+    ASSERT_EQ(g.topology->component_of_node, expected.topology->component_of_node);
+    ASSERT_EQ(g.topology->path_length_bound(), expected.topology->path_length_bound());
+    ASSERT_FALSE(g.compress_periodic_topology());
+
+    auto expanded = g.topology->expanded();
+    ASSERT_FALSE(expanded.is_periodic());
+    ASSERT_EQ(expanded.offsets, expected.topology->offsets);
+    ASSERT_EQ(expanded.neighbors, expected.topology->neighbors);
+    ASSERT_EQ(expanded.neighbor_weights, expected.topology->neighbor_weights);
+
+    // Clones share the periodic topology.
+    auto clone = g.clone_sharing_topology();
+    assert_same_edges(clone, expected);
+
+    // Updating an edge expands the topology of that graph only.
+    g.update_edge(7 * d, 7 * d + 1, 2, {}, 10, {1});
+    expected.update_edge(7 * d, 7 * d + 1, 2, {}, 10, {1});
+    ASSERT_FALSE(g.topology->is_periodic());
+    assert_same_edges(g, expected);
+    ASSERT_TRUE(clone.topology->is_periodic());
+    ASSERT_EQ(clone.nodes[8 * d].neighbor_weights[2], 2);
+
+    // Adding an edge unpacks the topology as usual.
+    clone.add_edge(0, 2, 8, {});
+    ASSERT_FALSE(clone.topology->is_compact());
+    ASSERT_EQ(clone.nodes[12 * d + 1].neighbors[0], &clone.nodes[11 * d + 1]);
+    ASSERT_EQ(clone.nodes[12 * d + 1].neighbors[3], &clone.nodes[13 * d + 1]);
+
+    // A graph without repeated rounds is left as it is.
+    pm::MatchingGraph path(6, 64);
+    for (size_t i = 0; i + 1 < 6; i++)
+        path.add_edge(i, i + 1, (pm::signed_weight_int)(2 * i + 2), {});
+    ASSERT_FALSE(path.compress_periodic_topology());
+    ASSERT_TRUE(path.topology->is_compact());
+    ASSERT_FALSE(path.topology->is_periodic());
+}
+
+TEST(Graph, CopyTopologyWithHugePages) {
+    // Large enough for the neighbors to be allocated in whole huge pages.
+    auto expected = repetition_code_graph(50, 2000);
+    expected.compact_topology();
+    ASSERT_GE(expected.topology->neighbors.size() * sizeof(pm::node_index_int), pm::MIN_HUGE_PAGE_ALLOCATION);
+    for (auto policy : {pm::HugePagePolicy::NONE, pm::HugePagePolicy::TRANSPARENT, pm::HugePagePolicy::EXPLICIT}) {
+        auto copy = std::make_shared<pm::MatchingGraphTopology>(expected.topology->copy_with_huge_pages(policy));
+        ASSERT_EQ(copy->neighbors.huge_page_policy(), policy);
+        ASSERT_EQ(copy->offsets, expected.topology->offsets);
+        ASSERT_EQ(copy->neighbors, expected.topology->neighbors);
+        ASSERT_EQ(copy->neighbor_weights, expected.topology->neighbor_weights);
+        ASSERT_EQ(copy->neighbor_observables, expected.topology->neighbor_observables);
+        auto g = expected.clone_sharing_topology();
+        g.set_topology(copy);
+        assert_same_edges(g, expected);
+        // Copies of the copy keep its policy.
+        pm::MatchingGraphTopology copy_of_copy(*copy);
+        ASSERT_EQ(copy_of_copy.neighbors.huge_page_policy(), policy);
+    }
+
+    // A periodic topology stays periodic.
+    auto periodic = repetition_code_graph(5, 40);
+    ASSERT_TRUE(periodic.compress_periodic_topology());
+    auto copy = periodic.topology->copy_with_huge_pages(pm::HugePagePolicy::TRANSPARENT);
+    ASSERT_TRUE(copy.is_periodic());
+    ASSERT_EQ(copy.period, periodic.topology->period);
+    ASSERT_EQ(copy.num_compact_nodes(), periodic.topology->num_compact_nodes());
+}
+
+TEST(Graph, TooManyNodes) {
+    ASSERT_THROW(pm::MatchingGraph(pm::MAX_MATCHING_GRAPH_NODES + 1, 0), std::invalid_argument);
+}
+
+TEST(Graph, PathLengthBound) {
+    pm::MatchingGraph g(4, 64);
+    g.add_edge(0, 1, 2, {0});
+    g.add_edge(1, 2, 4, {1});
+    g.add_boundary_edge(2, 6, {2});
+    g.compact_topology();
+    ASSERT_EQ(g.topology->path_length_bound(), 2 + 4 + 6);
+
+    // A long path of heavy edges, whose length is fine with 64-bit times, but not with 32-bit times.
+    size_t num_nodes = 3000;
+    pm::MatchingGraph h(num_nodes, 64);
+    for (size_t i = 0; i + 1 < num_nodes; i++)
+        h.add_edge(i, i + 1, 60000, {});
+    if constexpr (PM_COMPACT_WEIGHTS) {
+        ASSERT_THROW(h.compact_topology(), std::invalid_argument);
+    } else {
+        h.compact_topology();
+        ASSERT_GT(h.topology->path_length_bound(), pm::MAX_COMPACT_PATH_LENGTH);
+    }
+}
@@ -74,11 +74,15 @@ void GraphFillRegion::cleanup_shell_area() {
 
 void GraphFillRegion::clear_blossom_parent() {
     blossom_parent = nullptr;
+    // This region's radius has been frozen since it was wrapped, so it is the only term that leaves the wrapped
+    // radius of the nodes below it, and there is no need to walk up from each node's region to recompute it.
+    int32_t wrapped_radius_removed = radius.y_intercept();
     do_op_for_each_descendant_and_self([&](GraphFillRegion *descendant) {
         descendant->blossom_parent_top = this;
         for (DetectorNode *n : descendant->shell_area) {
             n->region_that_arrived_top = this;
-            n->wrapped_radius_cached = n->compute_wrapped_radius();
+            if (n->reached_from_source != nullptr)
+                n->wrapped_radius_cached -= wrapped_radius_removed;
         }
     });
 }
@@ -95,11 +99,15 @@ void GraphFillRegion::clear_blossom_parent_ignoring_wrapped_radius() {
 
 void GraphFillRegion::wrap_into_blossom(GraphFillRegion *new_blossom_parent_and_top) {
     blossom_parent = new_blossom_parent_and_top;
+    // This region was the top region of the nodes below it, so the (frozen) radius of this region is the only term
+    // that joins their wrapped radius.
+    int32_t wrapped_radius_added = radius.y_intercept();
     do_op_for_each_descendant_and_self([&](GraphFillRegion *descendant) {
         descendant->blossom_parent_top = new_blossom_parent_and_top;
         for (DetectorNode *n : descendant->shell_area) {
             n->region_that_arrived_top = new_blossom_parent_and_top;
-            n->wrapped_radius_cached = n->compute_wrapped_radius();
+            if (n->reached_from_source != nullptr)
+                n->wrapped_radius_cached += wrapped_radius_added;
         }
     });
 }
@@ -20,6 +20,7 @@
 #include "pymatching/sparse_blossom/flooder/match.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/region_edge.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/varying.h"
+#include "pymatching/sparse_blossom/small_vector.h"
 #include "pymatching/sparse_blossom/tracker/queued_event_tracker.h"
 
 namespace pm {
@@ -49,12 +50,13 @@ struct GraphFillRegion {
     pm::Match match;
 
     /// If this region is a blossom, these are its child regions along with the cyclic paths
-    /// between the children.
-    std::vector<pm::RegionEdge> blossom_children;
+    /// between the children. Most regions are not blossoms, and most blossoms are small, so a
+    /// few children are stored inline.
+    pm::SmallVector<pm::RegionEdge, 3> blossom_children;
     /// The set of nodes directly owned by this region. Note that this vector does not include
     /// the nodes indirectly owned by this region that are owned by the blossom children of this
-    /// region (or their children or etc).
-    std::vector<pm::DetectorNode*> shell_area;
+    /// region (or their children or etc). Stored inline while the region only owns a few nodes.
+    pm::SmallVector<pm::DetectorNode*, 8> shell_area;
 
     void cleanup_shell_area();
 
@@ -69,8 +71,10 @@ struct GraphFillRegion {
     void do_op_for_each_node_in_total_area(const Callable& func);
     template <typename Callable>
     void do_op_for_each_descendant_and_self(const Callable& func);
+    /// Makes this region a top region again. Its radius must not have changed since it was wrapped.
     void clear_blossom_parent();
     void clear_blossom_parent_ignoring_wrapped_radius();
+    /// Wraps this top region into a blossom. Its radius must already be frozen.
     void wrap_into_blossom(GraphFillRegion* new_blossom_parent_and_top);
 
     /// Determines if rhs is an ancestor of, or the same as, lhs.
@@ -90,19 +94,36 @@ struct GraphFillRegion {
 
 template <typename Callable>
 inline void pm::GraphFillRegion::do_op_for_each_node_in_total_area(const Callable& func) {
-    for (size_t i = 0; i < shell_area.size(); i++) {
-        func(shell_area[shell_area.size() - i - 1]);
-    }
-    for (auto& child : blossom_children) {
-        child.region->do_op_for_each_node_in_total_area(func);
+    // Blossoms can be nested deeply at high error rates, so the blossom tree is walked with an explicit stack, in
+    // the same order as a recursive pre-order walk.
+    pm::SmallVector<GraphFillRegion*, 16> stack;
+    stack.push_back(this);
+    while (!stack.empty()) {
+        GraphFillRegion* region = stack.back();
+        stack.pop_back();
+        auto& shell = region->shell_area;
+        for (size_t i = 0; i < shell.size(); i++) {
+            func(shell[shell.size() - i - 1]);
+        }
+        auto& children = region->blossom_children;
+        for (size_t i = children.size(); i-- > 0;) {
+            stack.push_back(children[i].region);
+        }
     }
 }
 
 template <typename Callable>
 inline void pm::GraphFillRegion::do_op_for_each_descendant_and_self(const Callable& func) {
-    func(this);
-    for (RegionEdge& child : blossom_children) {
-        child.region->do_op_for_each_descendant_and_self(func);
+    pm::SmallVector<GraphFillRegion*, 16> stack;
+    stack.push_back(this);
+    while (!stack.empty()) {
+        GraphFillRegion* region = stack.back();
+        stack.pop_back();
+        func(region);
+        auto& children = region->blossom_children;
+        for (size_t i = children.size(); i-- > 0;) {
+            stack.push_back(children[i].region);
+        }
     }
 }
 
@@ -156,3 +156,45 @@ TEST(GraphFillRegion, descendance_ordering_lt) {
     ASSERT_FALSE(r[5] < r[4]);
     ASSERT_FALSE(r[5] < r[5]);
 }
+
+TEST(GraphFillRegion, wrapped_radius_follows_nested_blossoms) {
+    std::array<GraphFillRegion, 4> r;
+    std::array<DetectorNode, 3> ds;
+    r[0].radius = VaryingCT::frozen(3);
+    r[1].radius = VaryingCT::frozen(4);
+    r[2].radius = VaryingCT::frozen(5);
+    for (size_t k = 0; k < 2; k++) {
+        DetectorNode &n = ds[k];
+        n.reached_from_source = &ds[k];
+        n.region_that_arrived = &r[k];
+        n.region_that_arrived_top = &r[k];
+        n.radius_of_arrival = (cumulative_time_int)k + 1;
+        n.wrapped_radius_cached = n.compute_wrapped_radius();
+        r[k].shell_area.push_back(&n);
+    }
+    // A node that was never reached keeps a wrapped radius of zero.
+    ds[2].region_that_arrived = &r[1];
+    ds[2].region_that_arrived_top = &r[1];
+    r[1].shell_area.push_back(&ds[2]);
+
+    auto check = [&](GraphFillRegion *top) {
+        for (auto &n : ds) {
+            ASSERT_EQ(n.region_that_arrived_top, top);
+            ASSERT_EQ(n.wrapped_radius_cached, n.compute_wrapped_radius());
+        }
+    };
+    r[2].blossom_children = {{&r[0], {}}, {&r[1], {}}};
+    r[0].wrap_into_blossom(&r[2]);
+    r[1].wrap_into_blossom(&r[2]);
+    check(&r[2]);
+    r[3].blossom_children = {{&r[2], {}}};
+    r[2].wrap_into_blossom(&r[3]);
+    check(&r[3]);
+    ASSERT_EQ(ds[0].wrapped_radius_cached, 3 + 5 - 1);
+    ASSERT_EQ(ds[2].wrapped_radius_cached, 0);
+    r[2].clear_blossom_parent();
+    check(&r[2]);
+    r[0].clear_blossom_parent();
+    ASSERT_EQ(ds[0].wrapped_radius_cached, -1);
+    ASSERT_EQ(ds[1].wrapped_radius_cached, 4 - 2);
+}
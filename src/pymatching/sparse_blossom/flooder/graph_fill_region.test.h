@@ -28,7 +28,7 @@ struct GraphFillTestData {
     };
     RegionEdge b(int loc_from, int loc_to, std::vector<RegionEdge> edges, bool root = false) {
         auto r = arena.alloc_default_constructed();
-        r->blossom_children = std::move(edges);
+        r->blossom_children.assign(edges.begin(), edges.end());
         for (auto c : r->blossom_children) {
             c.region->wrap_into_blossom(r);
         }
@@ -14,6 +14,9 @@
 
 #include "pymatching/sparse_blossom/flooder/graph_flooder.h"
 
+#include <algorithm>
+
+#include "pymatching/sparse_blossom/flooder/collision_scan.h"
 #include "pymatching/sparse_blossom/flooder/graph.h"
 #include "pymatching/sparse_blossom/flooder/graph_fill_region.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/varying.h"
@@ -21,62 +24,110 @@
 
 using namespace pm;
 
-GraphFlooder::GraphFlooder(MatchingGraph graph)
-    : graph(std::move(graph)), negative_weight_obs_mask(0), negative_weight_sum(0) {
+namespace {
+
+/// The number of levels of blossoms nested inside `region', i.e. 0 for a region that is not a blossom.
+size_t blossom_depth(const GraphFillRegion &region) {
+    size_t depth = 0;
+    for (auto &child : region.blossom_children)
+        depth = std::max(depth, blossom_depth(*child.region) + 1);
+    return depth;
+}
+
+inline void prefetch_for_read(const void *address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
 }
 
-GraphFlooder::GraphFlooder(GraphFlooder &&flooder) noexcept
+/// Prefetches the node or region that `event' (a pointer to, or an optional copy of, the event, which may be empty)
+/// will look at.
+template <typename PeekedEvent>
+inline void prefetch_event_target(const PeekedEvent &event) {
+    if (!event)
+        return;
+    if (event->tentative_event_type == LOOK_AT_NODE) {
+        prefetch_for_read(event->data_look_at_node);
+    } else if (event->tentative_event_type == LOOK_AT_SHRINKING_REGION) {
+        prefetch_for_read(event->data_look_at_shrinking_region);
+    }
+}
+
+}  // namespace
+
+template <typename Queue>
+BasicGraphFlooder<Queue>::BasicGraphFlooder(MatchingGraph graph)
+    : graph(std::move(graph)),
+      negative_weight_obs_mask(0),
+      negative_weight_sum(0),
+      num_valid_dequeues(0),
+      num_stale_dequeues(0) {
+    bind_queue_to_graph();
+}
+
+template <typename Queue>
+BasicGraphFlooder<Queue>::BasicGraphFlooder(BasicGraphFlooder &&flooder) noexcept
     : graph(std::move(flooder.graph)),
       queue(std::move(flooder.queue)),
       region_arena(std::move(flooder.region_arena)),
       match_edges(std::move(flooder.match_edges)),
+      reached_nodes(std::move(flooder.reached_nodes)),
       negative_weight_detection_events(std::move(flooder.negative_weight_detection_events)),
+      sorted_shot_detection_events(std::move(flooder.sorted_shot_detection_events)),
+      flooded_detection_events(std::move(flooder.flooded_detection_events)),
       negative_weight_observables(std::move(flooder.negative_weight_observables)),
       negative_weight_obs_mask(flooder.negative_weight_obs_mask),
-      negative_weight_sum(flooder.negative_weight_sum) {
+      negative_weight_sum(flooder.negative_weight_sum),
+      num_valid_dequeues(flooder.num_valid_dequeues),
+      num_stale_dequeues(flooder.num_stale_dequeues),
+      stats(flooder.stats) {
+    bind_queue_to_graph();
 }
 
-void GraphFlooder::do_region_created_at_empty_detector_node(GraphFillRegion &region, DetectorNode &detector_node) {
+template <typename Queue>
+void BasicGraphFlooder<Queue>::do_region_created_at_empty_detector_node(
+    GraphFillRegion &region, DetectorNode &detector_node) {
     detector_node.reached_from_source = &detector_node;
     detector_node.radius_of_arrival = 0;
     detector_node.region_that_arrived = &region;
     detector_node.region_that_arrived_top = &region;
     detector_node.wrapped_radius_cached = 0;
     region.shell_area.push_back(&detector_node);
+    reached_nodes.push_back(&detector_node);
+    if constexpr (DECODER_STATS_ENABLED)
+        stats.num_nodes_touched++;
     reschedule_events_at_detector_node(detector_node);
 }
 
 std::pair<size_t, cumulative_time_int> find_next_event_at_node_not_occupied_by_growing_top_region(
     const DetectorNode &detector_node, VaryingCT rad1) {
-    cumulative_time_int best_time = std::numeric_limits<cumulative_time_int>::max();
+    cumulative_time_int best_time = NO_COLLISION;
     size_t best_neighbor = SIZE_MAX;
 
     size_t start = 0;
     if (!detector_node.neighbors.empty() && detector_node.neighbors[0] == nullptr)
         start++;
 
-    // Handle non-boundary neighbors.
-    for (size_t i = start; i < detector_node.neighbors.size(); i++) {
-        auto weight = detector_node.neighbor_weights[i];
-
-        auto neighbor = detector_node.neighbors[i];
-
-        auto rad2 = neighbor->local_radius();
-
-        if (rad2.is_growing()) {
+    // Handle non-boundary neighbors, which can only be collided with if they are growing.
+    scan_neighbor_collision_times(
+        start,
+        detector_node.neighbors.size(),
+        [&](size_t i) {
+            auto weight = detector_node.neighbor_weights[i];
+            auto rad2 = detector_node.neighbors[i]->local_radius();
             auto collision_time = weight - rad1.y_intercept() - rad2.y_intercept();
-            if (collision_time < best_time) {
-                best_time = collision_time;
-                best_neighbor = i;
-            }
-        }
-    }
+            return rad2.is_growing() ? collision_time : NO_COLLISION;
+        },
+        best_time,
+        best_neighbor);
     return {best_neighbor, best_time};
 }
 
 std::pair<size_t, cumulative_time_int> find_next_event_at_node_occupied_by_growing_top_region(
     const DetectorNode &detector_node, const VaryingCT &rad1) {
-    cumulative_time_int best_time = std::numeric_limits<cumulative_time_int>::max();
+    cumulative_time_int best_time = NO_COLLISION;
     size_t best_neighbor = SIZE_MAX;
     size_t start = 0;
     if (!detector_node.neighbors.empty() && detector_node.neighbors[0] == nullptr) {
@@ -90,32 +141,27 @@ std::pair<size_t, cumulative_time_int> find_next_event_at_node_occupied_by_growi
         start++;
     }
 
-    // Handle non-boundary neighbors.
-    for (size_t i = start; i < detector_node.neighbors.size(); i++) {
-        auto weight = detector_node.neighbor_weights[i];
-
-        auto neighbor = detector_node.neighbors[i];
-        if (detector_node.has_same_owner_as(*neighbor)) {
-            continue;
-        }
-        auto rad2 = neighbor->local_radius();
-        if (rad2.is_shrinking()) {
-            continue;
-        }
-
-        auto collision_time = weight - rad1.y_intercept() - rad2.y_intercept();
-        if (rad2.is_growing()) {
-            collision_time >>= 1;
-        }
-        if (collision_time < best_time) {
-            best_time = collision_time;
-            best_neighbor = i;
-        }
-    }
+    // Handle non-boundary neighbors. Those in the same region, or shrinking, can't be collided with, and the
+    // collision with a growing neighbor happens when both have covered half of the remaining distance.
+    scan_neighbor_collision_times(
+        start,
+        detector_node.neighbors.size(),
+        [&](size_t i) {
+            auto weight = detector_node.neighbor_weights[i];
+            auto neighbor = detector_node.neighbors[i];
+            auto rad2 = neighbor->local_radius();
+            auto collision_time = (weight - rad1.y_intercept() - rad2.y_intercept()) >> (rad2.is_growing() ? 1 : 0);
+            bool can_collide = !detector_node.has_same_owner_as(*neighbor) && !rad2.is_shrinking();
+            return can_collide ? collision_time : NO_COLLISION;
+        },
+        best_time,
+        best_neighbor);
     return {best_neighbor, best_time};
 }
 
-std::pair<size_t, cumulative_time_int> GraphFlooder::find_next_event_at_node_returning_neighbor_index_and_time(
+template <typename Queue>
+std::pair<size_t, cumulative_time_int>
+BasicGraphFlooder<Queue>::find_next_event_at_node_returning_neighbor_index_and_time(
     const DetectorNode &detector_node) const {
     auto rad1 = detector_node.local_radius();
 
@@ -126,10 +172,11 @@ std::pair<size_t, cumulative_time_int> GraphFlooder::find_next_event_at_node_ret
     }
 }
 
-void GraphFlooder::reschedule_events_at_detector_node(DetectorNode &detector_node) {
+template <typename Queue>
+void BasicGraphFlooder<Queue>::reschedule_events_at_detector_node(DetectorNode &detector_node) {
     auto x = find_next_event_at_node_returning_neighbor_index_and_time(detector_node);
     if (x.first == SIZE_MAX) {
-        detector_node.node_event_tracker.set_no_desired_event();
+        detector_node.node_event_tracker.set_no_desired_event(queue);
     } else {
         detector_node.node_event_tracker.set_desired_event(
             {
@@ -140,7 +187,8 @@ void GraphFlooder::reschedule_events_at_detector_node(DetectorNode &detector_nod
     }
 }
 
-void GraphFlooder::schedule_tentative_shrink_event(GraphFillRegion &region) {
+template <typename Queue>
+void BasicGraphFlooder<Queue>::schedule_tentative_shrink_event(GraphFillRegion &region) {
     cumulative_time_int t;
     if (region.shell_area.empty()) {
         t = region.radius.time_of_x_intercept_for_shrinking();
@@ -155,7 +203,8 @@ void GraphFlooder::schedule_tentative_shrink_event(GraphFillRegion &region) {
         queue);
 }
 
-void GraphFlooder::do_region_arriving_at_empty_detector_node(
+template <typename Queue>
+void BasicGraphFlooder<Queue>::do_region_arriving_at_empty_detector_node(
     GraphFillRegion &region, DetectorNode &empty_node, const DetectorNode &from_node, size_t from_to_empty_index) {
     empty_node.observables_crossed_from_source =
         (from_node.observables_crossed_from_source ^ from_node.neighbor_observables[from_to_empty_index]);
@@ -165,10 +214,14 @@ void GraphFlooder::do_region_arriving_at_empty_detector_node(
     empty_node.region_that_arrived_top = region.blossom_parent_top;
     empty_node.wrapped_radius_cached = empty_node.compute_wrapped_radius();
     region.shell_area.push_back(&empty_node);
+    reached_nodes.push_back(&empty_node);
+    if constexpr (DECODER_STATS_ENABLED)
+        stats.num_nodes_touched++;
     reschedule_events_at_detector_node(empty_node);
 }
 
-MwpmEvent GraphFlooder::do_region_shrinking(GraphFillRegion &region) {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::do_region_shrinking(GraphFillRegion &region) {
     if (region.shell_area.empty()) {
         return do_blossom_shattering(region);
     } else if (region.shell_area.size() == 1 && region.blossom_children.empty()) {
@@ -188,7 +241,9 @@ MwpmEvent GraphFlooder::do_region_shrinking(GraphFillRegion &region) {
     }
 }
 
-MwpmEvent GraphFlooder::do_neighbor_interaction(DetectorNode &src, size_t src_to_dst_index, DetectorNode &dst) {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::do_neighbor_interaction(
+    DetectorNode &src, size_t src_to_dst_index, DetectorNode &dst) {
     // First check if one region is moving into an empty location
     if (src.region_that_arrived && !dst.region_that_arrived) {
         do_region_arriving_at_empty_detector_node(*src.region_that_arrived_top, dst, src, src_to_dst_index);
@@ -210,14 +265,16 @@ MwpmEvent GraphFlooder::do_neighbor_interaction(DetectorNode &src, size_t src_to
     }
 }
 
-MwpmEvent GraphFlooder::do_region_hit_boundary_interaction(DetectorNode &node) {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::do_region_hit_boundary_interaction(DetectorNode &node) {
     return RegionHitBoundaryEventData{
         node.region_that_arrived_top,
         CompressedEdge{
             node.reached_from_source, nullptr, node.observables_crossed_from_source ^ node.neighbor_observables[0]}};
 }
 
-MwpmEvent GraphFlooder::do_degenerate_implosion(const GraphFillRegion &region) {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::do_degenerate_implosion(const GraphFillRegion &region) {
     return RegionHitRegionEventData{
         region.alt_tree_node->parent.alt_tree_node->outer_region,
         region.alt_tree_node->outer_region,
@@ -227,31 +284,38 @@ MwpmEvent GraphFlooder::do_degenerate_implosion(const GraphFillRegion &region) {
             region.alt_tree_node->inner_to_outer_edge.obs_mask ^ region.alt_tree_node->parent.edge.obs_mask}};
 }
 
-MwpmEvent GraphFlooder::do_blossom_shattering(GraphFillRegion &region) {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::do_blossom_shattering(GraphFillRegion &region) {
     return BlossomShatterEventData{
         &region,
         region.alt_tree_node->parent.edge.loc_from->heir_region_on_shatter(),
         region.alt_tree_node->inner_to_outer_edge.loc_from->heir_region_on_shatter()};
 }
 
-GraphFillRegion *GraphFlooder::create_blossom(std::vector<RegionEdge> &contained_regions) {
+template <typename Queue>
+GraphFillRegion *BasicGraphFlooder<Queue>::create_blossom(std::vector<RegionEdge> &contained_regions) {
     auto blossom_region = region_arena.alloc_default_constructed();
     blossom_region->radius = VaryingCT::growing_varying_with_zero_distance_at_time(queue.cur_time);
-    blossom_region->blossom_children = std::move(contained_regions);
+    blossom_region->blossom_children.assign(contained_regions.begin(), contained_regions.end());
     for (auto &region_edge : blossom_region->blossom_children) {
         region_edge.region->radius = region_edge.region->radius.then_frozen_at_time(queue.cur_time);
         region_edge.region->wrap_into_blossom(blossom_region);
-        region_edge.region->shrink_event_tracker.set_no_desired_event();
+        region_edge.region->shrink_event_tracker.set_no_desired_event(queue);
     }
 
     blossom_region->do_op_for_each_node_in_total_area([this](DetectorNode *n) {
         reschedule_events_at_detector_node(*n);
     });
 
+    if constexpr (DECODER_STATS_ENABLED) {
+        stats.num_blossoms_created++;
+        stats.max_blossom_depth = std::max(stats.max_blossom_depth, blossom_depth(*blossom_region));
+    }
     return blossom_region;
 }
 
-bool GraphFlooder::dequeue_decision(FloodCheckEvent ev) {
+template <typename Queue>
+bool BasicGraphFlooder<Queue>::dequeue_decision(FloodCheckEvent ev) {
     switch (ev.tentative_event_type) {
         case FloodCheckEventType::LOOK_AT_NODE: {
             auto &node = *ev.data_look_at_node;
@@ -268,20 +332,58 @@ bool GraphFlooder::dequeue_decision(FloodCheckEvent ev) {
     }
 }
 
-FloodCheckEvent GraphFlooder::dequeue_valid() {
+template <typename Queue>
+FloodCheckEvent BasicGraphFlooder<Queue>::dequeue_valid() {
     while (true) {
         FloodCheckEvent ev = queue.dequeue();
+        if constexpr (FLOOD_PREFETCH_DISTANCE > 0)
+            prefetch_upcoming_events();
+        if constexpr (DECODER_STATS_ENABLED) {
+            stats.num_queue_pops += ev.tentative_event_type != NO_FLOOD_CHECK_EVENT;
+            stats.num_queue_pushes += queue.num_pushes;
+            queue.num_pushes = 0;
+        }
         if (dequeue_decision(ev)) {
+            num_valid_dequeues += ev.tentative_event_type != NO_FLOOD_CHECK_EVENT;
+            if constexpr (DECODER_TRACE_ENABLED)
+                trace_flood_check_event(ev, false);
             return ev;
         }
+        num_stale_dequeues++;
+        if constexpr (DECODER_STATS_ENABLED)
+            stats.num_stale_dequeues++;
+        if constexpr (DECODER_TRACE_ENABLED)
+            trace_flood_check_event(ev, true);
+    }
+}
+
+template <typename Queue>
+void BasicGraphFlooder<Queue>::trace_flood_check_event(const FloodCheckEvent &ev, bool stale) {
+    DetectorNode *node;
+    TraceEventKind kind;
+    switch (ev.tentative_event_type) {
+        case LOOK_AT_NODE:
+            node = ev.data_look_at_node;
+            kind = TRACE_LOOK_AT_NODE;
+            break;
+        case LOOK_AT_SHRINKING_REGION: {
+            auto &shell = ev.data_look_at_shrinking_region->shell_area;
+            node = shell.empty() ? nullptr : shell.back();
+            kind = TRACE_LOOK_AT_SHRINKING_REGION;
+            break;
+        }
+        default:
+            return;
     }
+    trace.record(stale ? TRACE_STALE_EVENT : kind, queue.cur_time, trace_node_index(node));
 }
 
-void GraphFlooder::set_region_growing(GraphFillRegion &region) {
+template <typename Queue>
+void BasicGraphFlooder<Queue>::set_region_growing(GraphFillRegion &region) {
     region.radius = region.radius.then_growing_at_time(queue.cur_time);
 
     // No shrinking event can occur while growing.
-    region.shrink_event_tracker.set_no_desired_event();
+    region.shrink_event_tracker.set_no_desired_event(queue);
 
     // Node events can occur while growing, and events in the queue may occur sooner than
     // previously scheduled. Therefore, we must reschedule all the nodes.
@@ -290,12 +392,13 @@ void GraphFlooder::set_region_growing(GraphFillRegion &region) {
     });
 }
 
-void GraphFlooder::set_region_frozen(GraphFillRegion &region) {
+template <typename Queue>
+void BasicGraphFlooder<Queue>::set_region_frozen(GraphFillRegion &region) {
     bool was_shrinking = region.radius.is_shrinking();
     region.radius = region.radius.then_frozen_at_time(queue.cur_time);
 
     // No shrinking event can occur while frozen.
-    region.shrink_event_tracker.set_no_desired_event();
+    region.shrink_event_tracker.set_no_desired_event(queue);
 
     // Node events can occur while frozen, from other regions growing into this one.
     // However, those events can only be sooner than the currently scheduled events
@@ -307,7 +410,8 @@ void GraphFlooder::set_region_frozen(GraphFillRegion &region) {
     }
 }
 
-void GraphFlooder::set_region_shrinking(GraphFillRegion &region) {
+template <typename Queue>
+void BasicGraphFlooder<Queue>::set_region_shrinking(GraphFillRegion &region) {
     region.radius = region.radius.then_shrinking_at_time(queue.cur_time);
 
     // Shrinking events can now occur.
@@ -315,11 +419,12 @@ void GraphFlooder::set_region_shrinking(GraphFillRegion &region) {
 
     // No node events can occur while shrinking.
     region.do_op_for_each_node_in_total_area([&](DetectorNode *n) {
-        n->node_event_tracker.set_no_desired_event();
+        n->node_event_tracker.set_no_desired_event(queue);
     });
 }
 
-MwpmEvent GraphFlooder::do_look_at_node_event(DetectorNode &node) {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::do_look_at_node_event(DetectorNode &node) {
     auto next = find_next_event_at_node_returning_neighbor_index_and_time(node);
     if (next.second == queue.cur_time) {
         // Need to revisit this node immediately after the mwpm event is handled. There may be an event to handle
@@ -350,7 +455,8 @@ MwpmEvent GraphFlooder::do_look_at_node_event(DetectorNode &node) {
     return MwpmEvent::no_event();
 }
 
-MwpmEvent GraphFlooder::process_tentative_event_returning_mwpm_event(FloodCheckEvent tentative_event) {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::process_tentative_event_returning_mwpm_event(FloodCheckEvent tentative_event) {
     switch (tentative_event.tentative_event_type) {
         case LOOK_AT_NODE: {
             return do_look_at_node_event(*tentative_event.data_look_at_node);
@@ -363,7 +469,8 @@ MwpmEvent GraphFlooder::process_tentative_event_returning_mwpm_event(FloodCheckE
     }
 }
 
-MwpmEvent GraphFlooder::run_until_next_mwpm_notification() {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::run_until_next_mwpm_notification() {
     while (true) {
         FloodCheckEvent tentative_event = dequeue_valid();
         if (tentative_event.tentative_event_type == NO_FLOOD_CHECK_EVENT) {
@@ -376,7 +483,64 @@ MwpmEvent GraphFlooder::run_until_next_mwpm_notification() {
     }
 }
 
-void GraphFlooder::sync_negative_weight_observables_and_detection_events() {
+template <typename Queue>
+MwpmEvent BasicGraphFlooder<Queue>::run_until_next_mwpm_notification_before(cumulative_time_int time_bound) {
+    while (!queue.empty() && queue.next_event_time() < time_bound) {
+        FloodCheckEvent tentative_event = queue.dequeue();
+        if constexpr (FLOOD_PREFETCH_DISTANCE > 0)
+            prefetch_upcoming_events();
+        if constexpr (DECODER_STATS_ENABLED) {
+            stats.num_queue_pops++;
+            stats.num_queue_pushes += queue.num_pushes;
+            queue.num_pushes = 0;
+        }
+        if (!dequeue_decision(tentative_event)) {
+            num_stale_dequeues++;
+            if constexpr (DECODER_STATS_ENABLED)
+                stats.num_stale_dequeues++;
+            if constexpr (DECODER_TRACE_ENABLED)
+                trace_flood_check_event(tentative_event, true);
+            continue;
+        }
+        num_valid_dequeues++;
+        if constexpr (DECODER_TRACE_ENABLED)
+            trace_flood_check_event(tentative_event, false);
+        MwpmEvent notification = process_tentative_event_returning_mwpm_event(tentative_event);
+        if (notification.event_type != NO_EVENT) {
+            return notification;
+        }
+    }
+    return MwpmEvent::no_event();
+}
+
+template <typename Queue>
+void BasicGraphFlooder<Queue>::advance_time_to(cumulative_time_int time) {
+    if (time <= queue.cur_time)
+        return;
+    // The queue only moves its time forward when it dequeues, so an empty event is passed through it. It is the
+    // soonest event in the queue, so it is the one dequeued.
+    queue.enqueue(FloodCheckEvent(cyclic_time_int{time}));
+    queue.dequeue();
+}
+
+template <typename Queue>
+void BasicGraphFlooder<Queue>::prefetch_next_event() const {
+    prefetch_event_target(queue.peek_due_now());
+}
+
+template <typename Queue>
+void BasicGraphFlooder<Queue>::prefetch_upcoming_events() const {
+    prefetch_event_target(queue.peek_due_now(FLOOD_PREFETCH_DISTANCE));
+    // The node of a nearer event was prefetched a few events ago, so its edges can be found without stalling.
+    auto nearer = queue.peek_due_now(FLOOD_PREFETCH_DISTANCE / 2);
+    if (nearer && nearer->tentative_event_type == LOOK_AT_NODE) {
+        prefetch_for_read(nearer->data_look_at_node->neighbors.index_data());
+        prefetch_for_read(nearer->data_look_at_node->neighbor_weights.data());
+    }
+}
+
+template <typename Queue>
+void BasicGraphFlooder<Queue>::sync_negative_weight_observables_and_detection_events() {
     /// Move set of negative weight detection events into a sorted vector, for faster processing during decoding
     negative_weight_detection_events.clear();
     negative_weight_detection_events.reserve(graph.negative_weight_detection_events_set.size());
@@ -396,5 +560,19 @@ void GraphFlooder::sync_negative_weight_observables_and_detection_events() {
     negative_weight_sum = graph.negative_weight_sum;
 }
 
-GraphFlooder::GraphFlooder() : negative_weight_obs_mask(0), negative_weight_sum(0) {
+template <typename Queue>
+void BasicGraphFlooder<Queue>::reset_graph() {
+    for (auto *node : reached_nodes)
+        node->reset();
+    reached_nodes.clear();
 }
+
+template <typename Queue>
+BasicGraphFlooder<Queue>::BasicGraphFlooder()
+    : negative_weight_obs_mask(0), negative_weight_sum(0), num_valid_dequeues(0), num_stale_dequeues(0) {
+}
+
+template struct pm::BasicGraphFlooder<radix_heap_queue<false>>;
+template struct pm::BasicGraphFlooder<radix_heap_queue<false, true>>;
+template struct pm::BasicGraphFlooder<circular_bucket_queue<false>>;
+template struct pm::BasicGraphFlooder<compact_radix_heap_queue<false>>;
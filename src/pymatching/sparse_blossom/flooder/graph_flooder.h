@@ -18,16 +18,33 @@
 #include <queue>
 
 #include "pymatching/sparse_blossom/arena.h"
+#include "pymatching/sparse_blossom/decoder_stats.h"
+#include "pymatching/sparse_blossom/decoder_trace.h"
 #include "pymatching/sparse_blossom/flooder/graph.h"
 #include "pymatching/sparse_blossom/flooder/graph_fill_region.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/mwpm_event.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/region_edge.h"
+#include "pymatching/sparse_blossom/tracker/circular_bucket_queue.h"
+#include "pymatching/sparse_blossom/tracker/compact_radix_heap_queue.h"
 #include "pymatching/sparse_blossom/tracker/flood_check_event.h"
 #include "pymatching/sparse_blossom/tracker/radix_heap_queue.h"
 
+/// How many events ahead of the current one the flood loop prefetches the node (and, half as far ahead, the edges)
+/// that an event will look at, or 0 to not prefetch. Only events already due at the current time can be seen ahead.
+/// This is a build option (PYMATCHING_FLOOD_PREFETCH_DISTANCE in CMakeLists.txt).
+#ifndef PM_FLOOD_PREFETCH_DISTANCE
+#define PM_FLOOD_PREFETCH_DISTANCE 0
+#endif
+
 namespace pm {
 
-struct GraphFlooder {
+constexpr size_t FLOOD_PREFETCH_DISTANCE = PM_FLOOD_PREFETCH_DISTANCE;
+
+/// Floods regions over a matching graph, using a `Queue' (`default_flooder_queue' for a `GraphFlooder', or
+/// `circular_bucket_queue<false>' when the edge weights are small, or `compact_radix_heap_queue<false>') to schedule
+/// the events.
+template <typename Queue>
+struct BasicGraphFlooder {
     /// The graph of detector nodes that is being flooded.
     MatchingGraph graph;
     /// Tracks the next thing that will occur as flooding proceeds.
@@ -37,15 +54,25 @@ struct GraphFlooder {
     /// events were scheduled in this queue before the region collision was processed.
     ///
     /// Events are ordered by time; by when they will occur in a timeline.
-    radix_heap_queue<false> queue;
+    Queue queue;
 
     Arena<GraphFillRegion> region_arena;
 
     std::vector<CompressedEdge> match_edges;
 
+    /// The nodes that a region has been created at or has arrived at since the start of the current shot (see
+    /// `start_shot'), possibly more than once. Only these nodes can hold ephemeral state, so `reset_graph' resets
+    /// them rather than every node of the graph.
+    std::vector<DetectorNode*> reached_nodes;
+
     /// These are the detection events that would occur if an error occurred on every edge that has a negative weight.
     /// Stored as a sorted vector of indices of detection events.
     std::vector<uint64_t> negative_weight_detection_events;
+    /// Scratch space for a shot on a graph with negative edge weights: its detection events, sorted, and the
+    /// detection events actually flooded, which are their symmetric difference with
+    /// `negative_weight_detection_events'. Kept between shots to avoid reallocating them.
+    std::vector<uint64_t> sorted_shot_detection_events;
+    std::vector<uint64_t> flooded_detection_events;
     /// These are the observables that would be flipped if an error occurred on every edge that has a negative weight.
     /// Stored as a sorted vector of indices of observables.
     std::vector<size_t> negative_weight_observables;
@@ -55,10 +82,32 @@ struct GraphFlooder {
     /// The sum of the edge weights of all edges with negative edge weights.
     pm::total_weight_int negative_weight_sum;
 
-    GraphFlooder();
-    explicit GraphFlooder(MatchingGraph graph);
-    GraphFlooder(GraphFlooder&&) noexcept;
+    /// The number of events taken from the queue by `dequeue_valid' that were processed, and that were discarded
+    /// as stale (no longer desired), since the flooder was created.
+    size_t num_valid_dequeues;
+    size_t num_stale_dequeues;
+    /// What the flooder and the matcher using it have done since the stats were last cleared. Only counted if
+    /// DECODER_STATS_ENABLED.
+    DecoderStats stats;
+    /// The events of the current shot, for finding out why it was slow. Only recorded if DECODER_TRACE_ENABLED and
+    /// its capacity has been set, and cleared by the caller before each shot (see `DecoderTrace::begin_shot').
+    DecoderTrace trace;
+
+    BasicGraphFlooder();
+    explicit BasicGraphFlooder(MatchingGraph graph);
+    BasicGraphFlooder(BasicGraphFlooder&&) noexcept;
     MwpmEvent run_until_next_mwpm_notification();
+    /// Like `run_until_next_mwpm_notification', but leaves the events at or after `time_bound' in the queue, returning
+    /// a NO_EVENT notification when there are none before it. The current time of the queue never passes the bound,
+    /// so more detection events can be created afterwards (see `Mwpm::create_detection_event').
+    MwpmEvent run_until_next_mwpm_notification_before(cumulative_time_int time_bound);
+    /// Moves the current time of the queue forward to `time', which MUST be before every event in the queue (e.g.
+    /// after `run_until_next_mwpm_notification_before(time + 1)' has returned NO_EVENT).
+    void advance_time_to(cumulative_time_int time);
+    /// Issues a software prefetch of the node or region that the next event in the queue will look at, if that
+    /// event is already due. Used to hide memory latency when several flooders are run in turns on one thread (see
+    /// `decode_detection_events_interleaved'). Does nothing on compilers without a prefetch builtin.
+    void prefetch_next_event() const;
     void set_region_growing(pm::GraphFillRegion& region);
     void set_region_frozen(pm::GraphFillRegion& region);
     void set_region_shrinking(pm::GraphFillRegion& region);
@@ -79,11 +128,41 @@ struct GraphFlooder {
     pm::MwpmEvent do_look_at_node_event(DetectorNode& node);
 
     pm::FloodCheckEvent dequeue_valid();
+    /// The index of `node' in the graph, as recorded in `trace', or TRACE_NO_NODE if there is no node.
+    inline uint32_t trace_node_index(const DetectorNode* node) const {
+        return node == nullptr ? TRACE_NO_NODE : (uint32_t)(node - graph.nodes.data());
+    }
+    /// Records a flood check event taken from the queue in `trace', as discarded if `stale'.
+    void trace_flood_check_event(const FloodCheckEvent& ev, bool stale);
+    /// Prefetches what the events FLOOD_PREFETCH_DISTANCE (and half as many) dequeues ahead will look at.
+    void prefetch_upcoming_events() const;
     pm::MwpmEvent process_tentative_event_returning_mwpm_event(FloodCheckEvent tentative_event);
 
     void sync_negative_weight_observables_and_detection_events();
+    /// Forgets the nodes reached in the previous shot, which are reset by shattering its regions once it has been
+    /// matched. Called before the detection events of a new shot are added.
+    inline void start_shot() {
+        reached_nodes.clear();
+        bind_queue_to_graph();
+    }
+    /// Points a queue that refers to nodes by index (see `compact_radix_heap_queue') at the nodes of `graph'. Called
+    /// when the flooder is created or moved, and at the start of each shot, in case the graph has been replaced.
+    inline void bind_queue_to_graph() {
+        if constexpr (Queue::has_compact_events)
+            queue.bind_nodes(graph.nodes.data(), graph.nodes.size());
+    }
+    /// Resets the ephemeral state of every node touched in the current shot, e.g. after it failed part way. This
+    /// costs time proportional to the number of touched nodes, not to the size of the graph.
+    void reset_graph();
 };
 
+extern template struct BasicGraphFlooder<radix_heap_queue<false>>;
+extern template struct BasicGraphFlooder<radix_heap_queue<false, true>>;
+extern template struct BasicGraphFlooder<circular_bucket_queue<false>>;
+extern template struct BasicGraphFlooder<compact_radix_heap_queue<false>>;
+
+typedef BasicGraphFlooder<default_flooder_queue> GraphFlooder;
+
 }  // namespace pm
 
 #endif  // PYMATCHING2_GRAPH_FLOODER_H
@@ -56,3 +56,124 @@ TEST(GraphFlooder, PriorityQueue) {
     ASSERT_EQ(e6.data_look_at_shrinking_region, &gfr);
     ASSERT_EQ(flooder.dequeue_valid().time, 100);
 }
+
+TEST(GraphFlooder, AdvanceTimeTo) {
+    GraphFlooder flooder(MatchingGraph(10, 64));
+    auto &graph = flooder.graph;
+    graph.add_edge(0, 1, 10, {});
+    graph.nodes[0].node_event_tracker.set_desired_event({&graph.nodes[0], cyclic_time_int{9}}, flooder.queue);
+    graph.nodes[1].node_event_tracker.set_desired_event({&graph.nodes[1], cyclic_time_int{40}}, flooder.queue);
+
+    flooder.advance_time_to(1);
+    ASSERT_EQ(flooder.queue.cur_time, 1);
+    flooder.advance_time_to(8);
+    ASSERT_EQ(flooder.queue.cur_time, 8);
+    flooder.advance_time_to(3);
+    ASSERT_EQ(flooder.queue.cur_time, 8);
+    ASSERT_EQ(flooder.dequeue_valid().time, 9);
+    flooder.advance_time_to(30);
+    ASSERT_EQ(flooder.queue.cur_time, 30);
+    ASSERT_EQ(flooder.dequeue_valid().time, 40);
+    ASSERT_TRUE(flooder.queue.empty());
+}
+
+TEST(GraphFlooder, CircularBucketQueue) {
+    BasicGraphFlooder<circular_bucket_queue<false>> flooder(MatchingGraph(10, 64));
+    flooder.queue = circular_bucket_queue<false>(16);
+    auto &graph = flooder.graph;
+    graph.add_edge(0, 1, 10, {});
+    graph.add_edge(1, 2, 10, {});
+
+    auto qn = [&](int i, int t) {
+        graph.nodes[i].node_event_tracker.set_desired_event({&graph.nodes[i], cyclic_time_int{t}}, flooder.queue);
+    };
+
+    qn(0, 10);
+    qn(1, 8);
+    GraphFillRegion gfr;
+    gfr.shrink_event_tracker.set_desired_event({&gfr, cyclic_time_int{70}}, flooder.queue);
+    qn(2, 5);
+    // Rescheduling node 1 to a later time leaves its earlier event in the queue, to be discarded.
+    qn(1, 12);
+
+    auto e = flooder.dequeue_valid();
+    ASSERT_EQ(e.time, 5);
+    ASSERT_EQ(e.data_look_at_node, &graph.nodes[2]);
+    ASSERT_EQ(flooder.dequeue_valid().time, 10);
+    auto e1 = flooder.dequeue_valid();
+    ASSERT_EQ(e1.time, 12);
+    ASSERT_EQ(e1.data_look_at_node, &graph.nodes[1]);
+    auto e2 = flooder.dequeue_valid();
+    ASSERT_EQ(e2.time, 70);
+    ASSERT_EQ(e2.data_look_at_shrinking_region, &gfr);
+    ASSERT_EQ(flooder.dequeue_valid().tentative_event_type, NO_FLOOD_CHECK_EVENT);
+    ASSERT_EQ(flooder.num_valid_dequeues, 4);
+    ASSERT_EQ(flooder.num_stale_dequeues, 1);
+}
+
+TEST(GraphFlooder, CompactRadixHeapQueue) {
+    BasicGraphFlooder<compact_radix_heap_queue<false>> flooder(MatchingGraph(10, 64));
+    auto &graph = flooder.graph;
+    graph.add_edge(0, 1, 10, {});
+    graph.add_edge(1, 2, 10, {});
+
+    auto qn = [&](int i, int t) {
+        graph.nodes[i].node_event_tracker.set_desired_event({&graph.nodes[i], cyclic_time_int{t}}, flooder.queue);
+    };
+
+    qn(0, 10);
+    qn(1, 8);
+    GraphFillRegion gfr;
+    gfr.shrink_event_tracker.set_desired_event({&gfr, cyclic_time_int{70}}, flooder.queue);
+    qn(2, 5);
+    qn(1, 12);
+
+    auto e = flooder.dequeue_valid();
+    ASSERT_EQ(e.time, 5);
+    ASSERT_EQ(e.data_look_at_node, &graph.nodes[2]);
+    ASSERT_EQ(flooder.dequeue_valid().time, 10);
+    auto e1 = flooder.dequeue_valid();
+    ASSERT_EQ(e1.time, 12);
+    ASSERT_EQ(e1.data_look_at_node, &graph.nodes[1]);
+    auto e2 = flooder.dequeue_valid();
+    ASSERT_EQ(e2.time, 70);
+    ASSERT_EQ(e2.data_look_at_shrinking_region, &gfr);
+    ASSERT_EQ(flooder.dequeue_valid().tentative_event_type, NO_FLOOD_CHECK_EVENT);
+    ASSERT_EQ(flooder.num_valid_dequeues, 4);
+    ASSERT_EQ(flooder.num_stale_dequeues, 1);
+
+    // The queue follows the nodes of the graph when the flooder is moved.
+    auto moved = std::move(flooder);
+    moved.graph.nodes[1].node_event_tracker.set_desired_event(
+        {&moved.graph.nodes[1], cyclic_time_int{80}}, moved.queue);
+    ASSERT_EQ(moved.dequeue_valid().data_look_at_node, &moved.graph.nodes[1]);
+}
+
+TEST(GraphFlooder, QueueWithHandlesHasNoStaleEvents) {
+    BasicGraphFlooder<radix_heap_queue<false, true>> flooder(MatchingGraph(10, 64));
+    auto &graph = flooder.graph;
+    graph.add_edge(0, 1, 10, {});
+    graph.add_edge(1, 2, 10, {});
+
+    auto qn = [&](int i, int t) {
+        graph.nodes[i].node_event_tracker.set_desired_event({&graph.nodes[i], cyclic_time_int{t}}, flooder.queue);
+    };
+
+    qn(0, 10);
+    qn(1, 8);
+    qn(2, 5);
+    qn(1, 12);
+    qn(0, 4);
+    graph.nodes[2].node_event_tracker.set_no_desired_event(flooder.queue);
+    ASSERT_EQ(flooder.queue.size(), 2);
+
+    auto e = flooder.dequeue_valid();
+    ASSERT_EQ(e.time, 4);
+    ASSERT_EQ(e.data_look_at_node, &graph.nodes[0]);
+    e = flooder.dequeue_valid();
+    ASSERT_EQ(e.time, 12);
+    ASSERT_EQ(e.data_look_at_node, &graph.nodes[1]);
+    ASSERT_EQ(flooder.dequeue_valid().tentative_event_type, NO_FLOOD_CHECK_EVENT);
+    ASSERT_EQ(flooder.num_valid_dequeues, 2);
+    ASSERT_EQ(flooder.num_stale_dequeues, 0);
+}
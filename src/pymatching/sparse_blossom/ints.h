@@ -19,15 +19,51 @@
 #include <cstdint>
 
 #include "pymatching/sparse_blossom/tracker/cyclic.h"
+#include "pymatching/sparse_blossom/wide_obs_int.h"
+
+/// The number of 64-bit words in an `obs_int'. Graphs with at most 64 * PM_OBS_INT_WORDS observables have their
+/// observables tracked bit packed during matching. Graphs with more observables fall back to reconstructing the
+/// observables crossed by each matched path with the SearchFlooder, which is much slower. Wider masks make every
+/// edge and node larger, so this is a build option (PYMATCHING_MAX_BIT_PACKED_OBSERVABLES in CMakeLists.txt)
+/// rather than the default.
+#ifndef PM_OBS_INT_WORDS
+#define PM_OBS_INT_WORDS 1
+#endif
+
+/// If set, edge weights are 16-bit and times and distances within the blossom algorithm are 32-bit, which makes
+/// the edges, nodes and regions of the graph smaller. Weights are then discretized to fewer distinct values, and the
+/// graphs that can be decoded are limited in size (see `MAX_COMPACT_PATH_LENGTH'), so this is a build option
+/// (PYMATCHING_COMPACT_WEIGHTS in CMakeLists.txt) rather than the default.
+#ifndef PM_COMPACT_WEIGHTS
+#define PM_COMPACT_WEIGHTS 0
+#endif
 
 namespace pm {
 
 /// This type is used to store observable masks. An observable mask is a bit packed value where the
 /// bit 1<<K is set IFF the observable with index K is flipped.
+#if PM_OBS_INT_WORDS == 1
 typedef uint64_t obs_int;
+#else
+typedef wide_obs_int<PM_OBS_INT_WORDS> obs_int;
+#endif
+
+/// Returns true if the observable with index `k' is flipped in `obs_mask'.
+inline bool obs_int_bit(const obs_int& obs_mask, size_t k) {
+    return (bool)((obs_mask >> k) & (obs_int)1);
+}
 
 /// This type is used to store the weight of an edge.
+#if PM_COMPACT_WEIGHTS
+typedef uint16_t weight_int;
+#else
 typedef uint32_t weight_int;
+#endif
+
+/// This type is used to store the node indices of the edges of a graph. 32 bits halves the size of the adjacency
+/// arrays, and is enough for any graph that fits in memory, but the largest value is reserved for the boundary, so
+/// graphs can have at most 2^32 - 1 nodes.
+typedef uint32_t node_index_int;
 
 /// This type is used to store the potentially-negative weight of an edge.
 /// It is used when loading graphs in order to support negative edge weights.
@@ -40,7 +76,16 @@ typedef int32_t signed_weight_int;
 /// It is important that it be signed because, for example, it's possible to compute potential
 /// collision times that are in the past while considering whether a collision will occur in the
 /// future or not.
+#if PM_COMPACT_WEIGHTS
+typedef int32_t cumulative_time_int;
+#else
 typedef int64_t cumulative_time_int;
+#endif
+
+/// In builds with PM_COMPACT_WEIGHTS, a bound on the length of any shortest path of a graph, such that the times of
+/// the blossom algorithm fit in a `Varying<cumulative_time_int>' (which keeps 30 bits of the time) with room to
+/// spare. Graphs whose paths could be longer than this are rejected when they are built.
+constexpr int64_t MAX_COMPACT_PATH_LENGTH = (int64_t)1 << 27;
 
 /// This type is used to represent the total weight of the MWPM solution. It is important that it
 /// is 64-bit since in general we expect the total solution weight to grow linearly with the number of
@@ -40,9 +40,26 @@ bool AltTreeEdge::operator!=(const AltTreeEdge &rhs) const {
 void AltTreeNode::add_child(const AltTreeEdge &child) {
     children.push_back(child);
     child.alt_tree_node->parent = {this, child.edge.reversed()};
+    // New nodes are added as leaves, so the walk below is only needed when an existing subtree is moved.
+    if (child.alt_tree_node->depth != depth + 1)
+        child.alt_tree_node->set_subtree_depth(depth + 1);
+}
+
+void AltTreeNode::set_subtree_depth(size_t new_depth) {
+    depth = new_depth;
+    SmallVector<AltTreeNode *, 16> stack;
+    stack.push_back(this);
+    while (!stack.empty()) {
+        AltTreeNode *node = stack.back();
+        stack.pop_back();
+        for (auto &child : node->children) {
+            child.alt_tree_node->depth = node->depth + 1;
+            stack.push_back(child.alt_tree_node);
+        }
+    }
 }
 
-AltTreeNode::AltTreeNode() : inner_region(nullptr), outer_region(nullptr), visited(false) {
+AltTreeNode::AltTreeNode() : inner_region(nullptr), outer_region(nullptr), depth(0) {
 }
 
 AltTreeNode::AltTreeNode(
@@ -55,21 +72,21 @@ AltTreeNode::AltTreeNode(
       outer_region(outer_region),
       inner_to_outer_edge(inner_to_outer_edge),
       parent(parent),
-      children(std::move(children)),
-      visited(false) {
+      depth(parent.alt_tree_node ? parent.alt_tree_node->depth + 1 : 0) {
+    this->children.assign(children.begin(), children.end());
     inner_region->alt_tree_node = this;
     outer_region->alt_tree_node = this;
 }
 
 AltTreeNode::AltTreeNode(
     GraphFillRegion *inner_region, GraphFillRegion *outer_region, const CompressedEdge &inner_to_outer_edge)
-    : inner_region(inner_region), outer_region(outer_region), inner_to_outer_edge(inner_to_outer_edge), visited(false) {
+    : inner_region(inner_region), outer_region(outer_region), inner_to_outer_edge(inner_to_outer_edge), depth(0) {
     inner_region->alt_tree_node = this;
     outer_region->alt_tree_node = this;
 }
 
 AltTreeNode::AltTreeNode(GraphFillRegion *outer_region)
-    : inner_region(nullptr), outer_region(outer_region), inner_to_outer_edge{nullptr, nullptr, 0}, visited(false) {
+    : inner_region(nullptr), outer_region(outer_region), inner_to_outer_edge{nullptr, nullptr, 0}, depth(0) {
     outer_region->alt_tree_node = this;
 }
 
@@ -82,20 +99,30 @@ const AltTreeNode *AltTreeNode::find_root() const {
 }
 
 void AltTreeNode::become_root() {
-    // Performs a tree rotation turning this node into the root of the tree/
+    // Performs a tree rotation turning this node into the root of the tree, by reversing the edges on the path
+    // from the old root down to this node, starting at the top.
     if (!parent.alt_tree_node)
         return;
-    auto old_parent = parent.alt_tree_node;
-    old_parent->become_root();
-    parent.alt_tree_node->inner_region = inner_region;
-    parent.alt_tree_node->inner_to_outer_edge = parent.edge;
-    inner_region = nullptr;
-    unstable_erase(parent.alt_tree_node->children, [&](const AltTreeEdge &x) {
-        return x.alt_tree_node == this;
-    });
-    parent = AltTreeEdge();
-    add_child(AltTreeEdge(old_parent, inner_to_outer_edge.reversed()));
-    inner_to_outer_edge = CompressedEdge{nullptr, nullptr, 0};
+    SmallVector<AltTreeNode *, 16> path;
+    for (AltTreeNode *node = this; node->parent.alt_tree_node; node = node->parent.alt_tree_node)
+        path.push_back(node);
+    for (size_t k = path.size(); k-- > 0;) {
+        AltTreeNode *node = path[k];
+        auto old_parent = node->parent.alt_tree_node;
+        old_parent->inner_region = node->inner_region;
+        old_parent->inner_to_outer_edge = node->parent.edge;
+        node->inner_region = nullptr;
+        unstable_erase(old_parent->children, [&](const AltTreeEdge &x) {
+            return x.alt_tree_node == node;
+        });
+        node->parent = AltTreeEdge();
+        node->children.push_back(AltTreeEdge(old_parent, node->inner_to_outer_edge.reversed()));
+        old_parent->parent = {node, node->inner_to_outer_edge};
+        node->inner_to_outer_edge = CompressedEdge{nullptr, nullptr, 0};
+    }
+    // Every depth may have changed. The tree is always shattered into matches right after being rotated, which
+    // takes as long as this.
+    set_subtree_depth(0);
 }
 
 bool AltTreeNode::operator==(const AltTreeNode &rhs) const {
@@ -137,58 +164,37 @@ std::vector<AltTreeNode *> AltTreeNode::all_nodes_in_tree() {
 
 AltTreeNode *AltTreeNode::most_recent_common_ancestor(AltTreeNode &other) {
     AltTreeNode *this_current = this;
-    this_current->visited = true;
     AltTreeNode *other_current = &other;
-    other_current->visited = true;
-    AltTreeNode *this_parent;
-    AltTreeNode *other_parent;
-    AltTreeNode *common_ancestor;
-    while (true) {
-        this_parent = this_current->parent.alt_tree_node;
-        other_parent = other_current->parent.alt_tree_node;
-        if (this_parent || other_parent) {
-            if (this_parent) {
-                this_current = this_parent;
-                if (this_current->visited) {
-                    common_ancestor = this_current;
-                    break;
-                }
-                this_current->visited = true;
-            }
-            if (other_parent) {
-                other_current = other_parent;
-                if (other_current->visited) {
-                    common_ancestor = other_current;
-                    break;
-                }
-                other_current->visited = true;
-            }
-        } else {
-            return nullptr;
-        }
-    }
-    // Clean up 'visited' flags for the common ancestor, and its ancestors
-    common_ancestor->visited = false;
-    this_parent = common_ancestor->parent.alt_tree_node;
-    while (this_parent && this_parent->visited) {
-        this_parent->visited = false;
-        this_parent = this_parent->parent.alt_tree_node;
+    while (this_current->depth > other_current->depth)
+        this_current = this_current->parent.alt_tree_node;
+    while (other_current->depth > this_current->depth)
+        other_current = other_current->parent.alt_tree_node;
+    // Nodes in different trees both reach nullptr above their roots at the same time.
+    while (this_current != other_current) {
+        this_current = this_current->parent.alt_tree_node;
+        other_current = other_current->parent.alt_tree_node;
     }
-    return common_ancestor;
+    return this_current;
 }
 
+AltTreePruneResult::AltTreePruneResult() = default;
+
 AltTreePruneResult::AltTreePruneResult(
     std::vector<AltTreeEdge> orphan_edges, std::vector<RegionEdge> pruned_path_region_edges)
     : orphan_edges(std::move(orphan_edges)), pruned_path_region_edges(std::move(pruned_path_region_edges)) {
 }
 
-AltTreePruneResult AltTreeNode::prune_upward_path_stopping_before(
-    Arena<AltTreeNode> &arena, AltTreeNode *prune_parent, bool back) {
-    std::vector<AltTreeEdge> orphan_edges;
-    std::vector<RegionEdge> pruned_path_region_edges;
+void AltTreePruneResult::clear() {
+    orphan_edges.clear();
+    pruned_path_region_edges.clear();
+}
+
+void AltTreeNode::prune_upward_path_stopping_before(
+    Arena<AltTreeNode> &arena, AltTreeNode *prune_parent, bool back, AltTreePruneResult &result) {
+    result.clear();
+    auto &orphan_edges = result.orphan_edges;
+    auto &pruned_path_region_edges = result.pruned_path_region_edges;
     auto current_node = this;
-    if (current_node != prune_parent)
-        pruned_path_region_edges.reserve(3);
     // Assumes prune_parent is an ancestor
     while (current_node != prune_parent) {
         move_append(current_node->children, orphan_edges);
@@ -210,5 +216,4 @@ AltTreePruneResult AltTreeNode::prune_upward_path_stopping_before(
         current_node = current_node->parent.alt_tree_node;
         arena.del(to_remove);
     }
-    return {orphan_edges, pruned_path_region_edges};
 }
@@ -19,6 +19,7 @@
 
 #include "pymatching/sparse_blossom/arena.h"
 #include "pymatching/sparse_blossom/flooder_matcher_interop/region_edge.h"
+#include "pymatching/sparse_blossom/small_vector.h"
 
 namespace pm {
 
@@ -37,11 +38,11 @@ struct AltTreeEdge {
     AltTreeEdge(AltTreeNode* alt_tree_node, const CompressedEdge& edge);
 };
 
-template <class T, class UnaryPredicate>
-bool unstable_erase(std::vector<T>& vec, UnaryPredicate pred);
+template <class Vec, class UnaryPredicate>
+bool unstable_erase(Vec& vec, UnaryPredicate pred);
 
-template <class T, class UnaryPredicate>
-inline bool unstable_erase(std::vector<T>& vec, UnaryPredicate pred) {
+template <class Vec, class UnaryPredicate>
+inline bool unstable_erase(Vec& vec, UnaryPredicate pred) {
     auto res = std::find_if(vec.begin(), vec.end(), pred);
     if (res == vec.end())
         return false;
@@ -54,22 +55,21 @@ inline bool unstable_erase(std::vector<T>& vec, UnaryPredicate pred) {
     return true;
 }
 
-template <typename T>
-void move_append(std::vector<T>& src, std::vector<T>& dst) {
-    if (dst.empty()) {
-        dst = std::move(src);
-    } else {
-        dst.reserve(dst.size() + src.size());
-        std::move(std::begin(src), std::end(src), std::back_inserter(dst));
-        src.clear();
-    }
+template <typename Src, typename T>
+void move_append(Src& src, std::vector<T>& dst) {
+    dst.insert(dst.end(), std::begin(src), std::end(src));
+    src.clear();
 }
 
+/// The output of `AltTreeNode::prune_upward_path_stopping_before'. The Mwpm keeps these between calls, so that
+/// the vectors are reused rather than reallocated.
 struct AltTreePruneResult {
     std::vector<AltTreeEdge> orphan_edges;
     std::vector<RegionEdge> pruned_path_region_edges;
 
+    AltTreePruneResult();
     AltTreePruneResult(std::vector<AltTreeEdge> orphan_edges, std::vector<pm::RegionEdge> pruned_path_region_edges);
+    void clear();
 };
 
 /// An alternating tree is a tree with 2-colored nodes where one color grows and the other shrinks.
@@ -90,10 +90,12 @@ class AltTreeNode {
     CompressedEdge inner_to_outer_edge;
     /// The edge from the shrinking region to its parent (i.e. from this double node to its parent).
     AltTreeEdge parent;
-    /// The children of the growing node (i.e. the children of this double node).
-    std::vector<AltTreeEdge> children;
-    /// Ephemeral state used during algorithms.
-    bool visited;
+    /// The children of the growing node (i.e. the children of this double node). Most nodes have few children,
+    /// so they are stored inline, and nodes can be created and deleted without allocating.
+    pm::SmallVector<AltTreeEdge, 2> children;
+    /// The number of double nodes above this one (zero for the root). Kept up to date by `add_child' and
+    /// `become_root', so that `most_recent_common_ancestor' can walk up from both nodes in step.
+    size_t depth;
 
     AltTreeNode();
     AltTreeNode(
@@ -117,21 +119,19 @@ class AltTreeNode {
     /// of the tree. The undirected edges in the underlying alternating tree do not change; only
     /// the direction of the edges (all leading away from the root) is changed.
     void become_root();
-    /// Finds the most recent common ancestor between this node and the other node.
-    ///
-    /// Would be const except it uses ephemeral state to go faster.
-    /// More specifically, breadcrumbs are left (by setting `visited=true`) as the
-    /// tree is traversed upward from `this` and `other`. These are
-    /// reset (`visited=false`) before the method completes for the
-    /// common ancestor and its ancestors, but *not* reset for nodes
-    /// on the paths from `this` and `other` stopping *before* ancestor.
-    /// This does not affect the algorithm, as these nodes are always removed
-    /// from the tree immediately after the common ancestor is found (either
-    /// a blossom is formed, or the two trees shatter into matches).
+    /// Finds the most recent common ancestor between this node and the other node, or returns nullptr if they are
+    /// in different trees. The deeper node is first walked up to the depth of the other, and then both are walked
+    /// up together until they meet, without writing to any node.
     AltTreeNode* most_recent_common_ancestor(AltTreeNode& other);
+    /// Adds `child' (and its descendants) below this node, updating their depths if they changed.
     void add_child(const AltTreeEdge& child);
-    AltTreePruneResult prune_upward_path_stopping_before(
-        Arena<AltTreeNode>& arena, AltTreeNode* prune_parent, bool back);
+    /// Sets the depth of this node to `new_depth', and the depths of its descendants to match.
+    void set_subtree_depth(size_t new_depth);
+    /// Removes the nodes on the path from this node up to, but not including, its ancestor `prune_parent'. The
+    /// children of the removed nodes that aren't on the path, and the regions along the path, are written to
+    /// `result' (replacing its contents).
+    void prune_upward_path_stopping_before(
+        Arena<AltTreeNode>& arena, AltTreeNode* prune_parent, bool back, AltTreePruneResult& result);
     const AltTreeNode* find_root() const;
 
     /// Helper method for operator==.
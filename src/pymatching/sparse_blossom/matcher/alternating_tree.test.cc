@@ -105,17 +105,17 @@ TEST(AlternatingTree, UnstableEraseInt) {
 TEST(AlternatingTree, UnstableEraseAltTreeEdge) {
     AltTreeTestData d(10);
     AltTreeEdge x = example_tree_four_children(d);
-    std::vector<AltTreeEdge> xc = x.alt_tree_node->children;
+    auto xc = x.alt_tree_node->children;
     auto xc_copy = xc;
     ASSERT_EQ(xc, x.alt_tree_node->children);
     unstable_erase(xc, [&xc_copy](AltTreeEdge y) {
         return y.alt_tree_node == xc_copy[1].alt_tree_node;
     });
-    ASSERT_EQ(xc, std::vector<AltTreeEdge>({xc_copy[0], xc_copy[3], xc_copy[2]}));
+    ASSERT_EQ(xc, decltype(xc)({xc_copy[0], xc_copy[3], xc_copy[2]}));
     unstable_erase(xc, [&xc_copy](AltTreeEdge y) {
         return y.alt_tree_node == xc_copy[0].alt_tree_node;
     });
-    ASSERT_EQ(xc, std::vector<AltTreeEdge>({xc_copy[2], xc_copy[3]}));
+    ASSERT_EQ(xc, decltype(xc)({xc_copy[2], xc_copy[3]}));
 }
 
 TEST(AlternatingTree, AllNodesInTree) {
@@ -180,22 +180,49 @@ TEST(AlternatingTree, CommonAncestor) {
                    .alt_tree_node->most_recent_common_ancestor(
                        *t.alt_tree_node->children[0].alt_tree_node->children[1].alt_tree_node);
     ASSERT_EQ(anc, t.alt_tree_node->children[0].alt_tree_node);
-    ASSERT_TRUE(t.alt_tree_node->children[0].alt_tree_node->children[0].alt_tree_node->visited);
-    ASSERT_TRUE(t.alt_tree_node->children[0].alt_tree_node->children[1].alt_tree_node->visited);
-    ASSERT_FALSE(t.alt_tree_node->children[0].alt_tree_node->visited);
-    ASSERT_FALSE(t.alt_tree_node->visited);
-    ASSERT_TRUE(
-        t.alt_tree_node->children[0].alt_tree_node->children[0].alt_tree_node->children[0].alt_tree_node->visited);
+    auto c000 = t.alt_tree_node->children[0].alt_tree_node->children[0].alt_tree_node->children[0].alt_tree_node;
+    ASSERT_EQ(c000->most_recent_common_ancestor(*c000), c000);
+    ASSERT_EQ(c000->most_recent_common_ancestor(*t.alt_tree_node), t.alt_tree_node);
 
     auto t2 = d.t({d.t({}, 12, 13, false)}, -1, 11, true);
     auto t3 = d.t({d.t({}, 15, 16, false)}, -1, 14, true);
     auto anc2 = t3.alt_tree_node->children[0].alt_tree_node->most_recent_common_ancestor(
         *t2.alt_tree_node->children[0].alt_tree_node);
     ASSERT_EQ(anc2, nullptr);
-    ASSERT_TRUE(t2.alt_tree_node->visited);
-    ASSERT_TRUE(t2.alt_tree_node->children[0].alt_tree_node->visited);
-    ASSERT_TRUE(t3.alt_tree_node->visited);
-    ASSERT_TRUE(t3.alt_tree_node->children[0].alt_tree_node->visited);
+    ASSERT_EQ(t2.alt_tree_node->most_recent_common_ancestor(*t3.alt_tree_node->children[0].alt_tree_node), nullptr);
+}
+
+void expect_depths_are_distances_from_root(AltTreeNode* root) {
+    for (auto node : root->all_nodes_in_tree()) {
+        size_t distance = 0;
+        for (auto n = node; n->parent.alt_tree_node; n = n->parent.alt_tree_node)
+            distance++;
+        EXPECT_EQ(node->depth, distance);
+    }
+}
+
+TEST(AlternatingTree, DepthsFollowTreeChanges) {
+    AltTreeTestData d(30);
+    auto x =
+        d.t({d.t({d.t({}, 10, 11), d.t({}, 8, 9), d.t({d.t({}, 6, 7)}, 12, 13)}, 4, 5), d.t({}, 2, 3)}, -1, 1, true);
+    expect_depths_are_distances_from_root(x.alt_tree_node);
+    auto c0 = x.alt_tree_node->children[0].alt_tree_node;
+    auto c020 = c0->children[2].alt_tree_node->children[0].alt_tree_node;
+    ASSERT_EQ(c020->depth, 3);
+
+    // Moving a subtree up updates the depths of all of its nodes.
+    auto moved = c0->children[2];
+    unstable_erase(c0->children, [&](const AltTreeEdge& e) {
+        return e.alt_tree_node == moved.alt_tree_node;
+    });
+    x.alt_tree_node->add_child(moved);
+    expect_depths_are_distances_from_root(x.alt_tree_node);
+    ASSERT_EQ(c020->depth, 2);
+
+    c020->become_root();
+    expect_depths_are_distances_from_root(c020);
+    ASSERT_EQ(c020->depth, 0);
+    ASSERT_EQ(c0->depth, 3);
 }
 
 TEST(AlternatingTree, PrunedUpwardPathStoppingBefore) {
@@ -210,7 +237,8 @@ TEST(AlternatingTree, PrunedUpwardPathStoppingBefore) {
         RegionEdge{c02->inner_region, c02->parent.edge},
         RegionEdge{c0->outer_region, c0->inner_to_outer_edge.reversed()},
         RegionEdge{c0->inner_region, c0->parent.edge}};
-    auto res = c02->prune_upward_path_stopping_before(d.arena, tree.alt_tree_node, false);
+    AltTreePruneResult res({c0->children[0]}, {});
+    c02->prune_upward_path_stopping_before(d.arena, tree.alt_tree_node, false, res);
     ASSERT_EQ(res.orphan_edges, orphans_expected);
     ASSERT_EQ(res.pruned_path_region_edges, pruned_region_edges_expected);
 }
@@ -227,7 +255,8 @@ TEST(AlternatingTree, PrunedUpwardBackEdgePathStoppingBefore) {
         RegionEdge{c0->outer_region, c02->parent.edge.reversed()},
         RegionEdge{c0->inner_region, c0->inner_to_outer_edge},
         RegionEdge{tree.alt_tree_node->outer_region, c0->parent.edge.reversed()}};
-    auto res = c02->prune_upward_path_stopping_before(d.arena, tree.alt_tree_node, true);
+    AltTreePruneResult res({c0->children[0]}, {});
+    c02->prune_upward_path_stopping_before(d.arena, tree.alt_tree_node, true, res);
     ASSERT_EQ(res.orphan_edges, orphans_expected);
     ASSERT_EQ(res.pruned_path_region_edges, pruned_region_edges_expected);
 }
@@ -14,18 +14,25 @@
 
 #include "pymatching/sparse_blossom/matcher/mwpm.h"
 
+#include <algorithm>
+#include <exception>
 #include <set>
+#include <thread>
 
 #include "pymatching/sparse_blossom/flooder/graph_fill_region.h"
 #include "pymatching/sparse_blossom/matcher/alternating_tree.h"
+#include "pymatching/sparse_blossom/memory_bytes.h"
 
 using namespace pm;
 
-Mwpm::Mwpm(GraphFlooder flooder) : flooder(std::move(flooder)) {
+Mwpm::Mwpm(GraphFlooder flooder)
+    : flooder(std::move(flooder)), small_syndrome_cache(this->flooder.graph.nodes.size()) {
 }
 
 Mwpm::Mwpm(GraphFlooder flooder, SearchFlooder search_flooder)
-    : flooder(std::move(flooder)), search_flooder(std::move(search_flooder)) {
+    : flooder(std::move(flooder)),
+      search_flooder(std::move(search_flooder)),
+      small_syndrome_cache(this->flooder.graph.nodes.size()) {
 }
 
 Mwpm &Mwpm::operator=(Mwpm &&other) noexcept {
@@ -39,7 +46,18 @@ Mwpm &Mwpm::operator=(Mwpm &&other) noexcept {
 Mwpm::Mwpm(Mwpm &&other) noexcept
     : flooder(std::move(other.flooder)),
       node_arena(std::move(other.node_arena)),
-      search_flooder(std::move(other.search_flooder)) {
+      search_flooder(std::move(other.search_flooder)),
+      small_syndrome_cache(std::move(other.small_syndrome_cache)),
+      syndrome_cache(std::move(other.syndrome_cache)),
+      predecoder(std::move(other.predecoder)),
+      shatter_stack(std::move(other.shatter_stack)),
+      prune_result_1(std::move(other.prune_result_1)),
+      prune_result_2(std::move(other.prune_result_2)),
+      path_workers(std::move(other.path_workers)),
+      union_find(std::move(other.union_find)),
+      work_budget(other.work_budget),
+      degraded_shot_decoder(std::move(other.degraded_shot_decoder)),
+      num_degraded_shots(other.num_degraded_shots) {
 }
 
 void Mwpm::shatter_descendants_into_matches_and_freeze(AltTreeNode &alt_tree_node) {
@@ -132,11 +150,11 @@ void Mwpm::handle_tree_hitting_match(
 void Mwpm::handle_tree_hitting_self(const RegionHitRegionEventData &event, AltTreeNode *common_ancestor) {
     auto alt_node_1 = event.region1->alt_tree_node;
     auto alt_node_2 = event.region2->alt_tree_node;
-    auto prune_result_1 = alt_node_1->prune_upward_path_stopping_before(node_arena, common_ancestor, true);
-    auto prune_result_2 = alt_node_2->prune_upward_path_stopping_before(node_arena, common_ancestor, false);
+    alt_node_1->prune_upward_path_stopping_before(node_arena, common_ancestor, true, prune_result_1);
+    alt_node_2->prune_upward_path_stopping_before(node_arena, common_ancestor, false, prune_result_2);
 
     // Construct blossom region cycle
-    auto blossom_cycle = std::move(prune_result_2.pruned_path_region_edges);
+    auto &blossom_cycle = prune_result_2.pruned_path_region_edges;
     auto p1s = prune_result_1.pruned_path_region_edges.size();
     blossom_cycle.reserve(blossom_cycle.size() + p1s + 1);
     for (size_t i = 0; i < p1s; i++)
@@ -284,12 +302,32 @@ void Mwpm::handle_region_hit_region(const MwpmEvent event) {
 void Mwpm::process_event(const MwpmEvent &event) {
     switch (event.event_type) {
         case REGION_HIT_REGION:
+            if constexpr (DECODER_STATS_ENABLED)
+                flooder.stats.num_region_hit_region_events++;
+            if constexpr (DECODER_TRACE_ENABLED)
+                flooder.trace.record(
+                    TRACE_REGION_HIT_REGION,
+                    flooder.queue.cur_time,
+                    flooder.trace_node_index(event.region_hit_region_event_data.edge.loc_from),
+                    flooder.trace_node_index(event.region_hit_region_event_data.edge.loc_to));
             handle_region_hit_region(event);
             break;
         case REGION_HIT_BOUNDARY:
+            if constexpr (DECODER_STATS_ENABLED)
+                flooder.stats.num_region_hit_boundary_events++;
+            if constexpr (DECODER_TRACE_ENABLED)
+                flooder.trace.record(
+                    TRACE_REGION_HIT_BOUNDARY,
+                    flooder.queue.cur_time,
+                    flooder.trace_node_index(event.region_hit_boundary_event_data.edge.loc_from),
+                    flooder.trace_node_index(event.region_hit_boundary_event_data.edge.loc_to));
             handle_tree_hitting_boundary(event.region_hit_boundary_event_data);
             break;
         case BLOSSOM_SHATTER:
+            if constexpr (DECODER_STATS_ENABLED)
+                flooder.stats.num_blossom_shatter_events++;
+            if constexpr (DECODER_TRACE_ENABLED)
+                flooder.trace.record(TRACE_BLOSSOM_SHATTER, flooder.queue.cur_time, TRACE_NO_NODE);
             handle_blossom_shattering(event.blossom_shatter_event_data);
             break;
         case NO_EVENT:
@@ -298,6 +336,14 @@ void Mwpm::process_event(const MwpmEvent &event) {
         default:
             throw std::invalid_argument("Unrecognized event type");
     }
+    if constexpr (DECODER_STATS_ENABLED)
+        record_arena_usage();
+}
+
+void Mwpm::record_arena_usage() {
+    auto &stats = flooder.stats;
+    stats.max_regions_in_use = std::max(stats.max_regions_in_use, flooder.region_arena.size());
+    stats.max_alt_tree_nodes_in_use = std::max(stats.max_alt_tree_nodes_in_use, node_arena.size());
 }
 
 GraphFillRegion *Mwpm::pair_and_shatter_subblossoms_and_extract_matches(GraphFillRegion *region, MatchingResult &res) {
@@ -319,47 +365,58 @@ GraphFillRegion *Mwpm::pair_and_shatter_subblossoms_and_extract_matches(GraphFil
         auto &re1 = region->blossom_children[(index + i + 1) % num_children];
         auto &re2 = region->blossom_children[(index + i + 2) % num_children];
         re1.region->add_match(re2.region, re1.edge);
-        res += shatter_blossom_and_extract_matches(re1.region);
+        shatter_stack.push_back(re1.region);
     }
     flooder.region_arena.del(region);
     return subblossom;
 }
 
 MatchingResult Mwpm::shatter_blossom_and_extract_matches(GraphFillRegion *region) {
-    region->cleanup_shell_area();
-
-    // First handle base cases (no subblossoms)
-    if (region->match.region) {
-        region->match.region->cleanup_shell_area();
-        if (region->blossom_children.empty() && region->match.region->blossom_children.empty()) {
-            // Neither region nor matched region have blossom children
-            // No shattering required, so just return MatchingResult from this match.
-            MatchingResult res = {
-                region->match.edge.obs_mask, region->radius.y_intercept() + region->match.region->radius.y_intercept()};
-            flooder.region_arena.del(region->match.region);
+    // Blossoms can be nested deeply at high error rates, so instead of recursing, the regions still to be shattered
+    // are kept on `shatter_stack', and are popped in the order the recursion would visit them.
+    MatchingResult res{0, 0};
+    size_t base = shatter_stack.size();
+    shatter_stack.push_back(region);
+    while (shatter_stack.size() > base) {
+        region = shatter_stack.back();
+        shatter_stack.pop_back();
+        region->cleanup_shell_area();
+
+        // First handle base cases (no subblossoms)
+        if (region->match.region) {
+            region->match.region->cleanup_shell_area();
+            if (region->blossom_children.empty() && region->match.region->blossom_children.empty()) {
+                // Neither region nor matched region have blossom children
+                // No shattering required, so just add the MatchingResult from this match.
+                res += {region->match.edge.obs_mask,
+                        region->radius.y_intercept() + region->match.region->radius.y_intercept()};
+                flooder.region_arena.del(region->match.region);
+                flooder.region_arena.del(region);
+                continue;
+            }
+        } else if (region->blossom_children.empty()) {
+            // Region with no blossom children matched to boundary
+            // No shattering required, so just add the MatchingResult from this match.
+            res += {region->match.edge.obs_mask, region->radius.y_intercept()};
             flooder.region_arena.del(region);
-            return res;
+            continue;
         }
-    } else if (region->blossom_children.empty()) {
-        // Region with no blossom children matched to boundary
-        // No shattering required, so just return MatchingResult from this match.
-        MatchingResult res = {region->match.edge.obs_mask, region->radius.y_intercept()};
-        flooder.region_arena.del(region);
-        return res;
-    }
 
-    // Pair up and shatter subblossoms into matches
-    MatchingResult res{0, 0};
-    if (!region->blossom_children.empty())
-        region = pair_and_shatter_subblossoms_and_extract_matches(region, res);
-    if (region->match.region && !region->match.region->blossom_children.empty())
-        pair_and_shatter_subblossoms_and_extract_matches(region->match.region, res);
-    res += shatter_blossom_and_extract_matches(region);
+        // Pair up and shatter subblossoms into matches, then shatter the subblossom left matched to the match of
+        // the region after them.
+        size_t first = shatter_stack.size();
+        if (!region->blossom_children.empty())
+            region = pair_and_shatter_subblossoms_and_extract_matches(region, res);
+        if (region->match.region && !region->match.region->blossom_children.empty())
+            pair_and_shatter_subblossoms_and_extract_matches(region->match.region, res);
+        shatter_stack.push_back(region);
+        std::reverse(shatter_stack.begin() + first, shatter_stack.end());
+    }
     return res;
 }
 
 GraphFillRegion *Mwpm::pair_and_shatter_subblossoms_and_extract_match_edges(
-    GraphFillRegion *region, std::vector<CompressedEdge> &match_edges) {
+    GraphFillRegion *region, std::vector<CompressedEdge> &match_edges, MatchingResult &res) {
     for (auto &r : region->blossom_children) {
         r.region->clear_blossom_parent_ignoring_wrapped_radius();
     }
@@ -367,6 +424,7 @@ GraphFillRegion *Mwpm::pair_and_shatter_subblossoms_and_extract_match_edges(
     subblossom->match = region->match;
     if (subblossom->match.region)
         subblossom->match.region->match.region = subblossom;
+    res.weight += region->radius.y_intercept();
     auto iter = std::find_if(
         region->blossom_children.begin(), region->blossom_children.end(), [&subblossom](const RegionEdge &e) {
             return e.region == subblossom;
@@ -377,13 +435,15 @@ GraphFillRegion *Mwpm::pair_and_shatter_subblossoms_and_extract_match_edges(
         auto &re1 = region->blossom_children[(index + i + 1) % num_children];
         auto &re2 = region->blossom_children[(index + i + 2) % num_children];
         re1.region->add_match(re2.region, re1.edge);
-        shatter_blossom_and_extract_match_edges(re1.region, match_edges);
+        res += shatter_blossom_and_extract_match_edges(re1.region, match_edges);
     }
     flooder.region_arena.del(region);
     return subblossom;
 }
 
-void Mwpm::shatter_blossom_and_extract_match_edges(GraphFillRegion *region, std::vector<CompressedEdge> &match_edges) {
+MatchingResult Mwpm::shatter_blossom_and_extract_match_edges(
+    GraphFillRegion *region, std::vector<CompressedEdge> &match_edges) {
+    MatchingResult res{0, 0};
     region->cleanup_shell_area();
 
     // First handle base cases (no subblossoms)
@@ -393,33 +453,39 @@ void Mwpm::shatter_blossom_and_extract_match_edges(GraphFillRegion *region, std:
             // Neither region nor matched region have blossom children
             // No shattering required, so just return MatchingResult from this match.
             match_edges.push_back(region->match.edge);
+            res += {region->match.edge.obs_mask,
+                    region->radius.y_intercept() + region->match.region->radius.y_intercept()};
             flooder.region_arena.del(region->match.region);
             flooder.region_arena.del(region);
-            return;
+            return res;
         }
     } else if (region->blossom_children.empty()) {
         // Region with no blossom children matched to boundary
         // No shattering required, so just return MatchingResult from this match.
         match_edges.push_back(region->match.edge);
+        res += {region->match.edge.obs_mask, region->radius.y_intercept()};
         flooder.region_arena.del(region);
-        return;
+        return res;
     }
 
     // Pair up and shatter subblossoms into matches
     if (!region->blossom_children.empty())
-        region = pair_and_shatter_subblossoms_and_extract_match_edges(region, match_edges);
+        region = pair_and_shatter_subblossoms_and_extract_match_edges(region, match_edges, res);
     if (region->match.region && !region->match.region->blossom_children.empty())
-        pair_and_shatter_subblossoms_and_extract_match_edges(region->match.region, match_edges);
-    shatter_blossom_and_extract_match_edges(region, match_edges);
-    return;
+        pair_and_shatter_subblossoms_and_extract_match_edges(region->match.region, match_edges, res);
+    res += shatter_blossom_and_extract_match_edges(region, match_edges);
+    return res;
 }
 
 void Mwpm::create_detection_event(DetectorNode *node) {
     auto region = flooder.region_arena.alloc_default_constructed();
+    region->radius = VaryingCT::growing_varying_with_zero_distance_at_time(flooder.queue.cur_time);
     auto alt_tree_node = node_arena.alloc_unconstructed();
     new (alt_tree_node) AltTreeNode(region);
     region->alt_tree_node = alt_tree_node;
     flooder.do_region_created_at_empty_detector_node(*region, *node);
+    if constexpr (DECODER_STATS_ENABLED)
+        record_arena_usage();
 }
 
 MatchingResult &MatchingResult::operator+=(const MatchingResult &rhs) {
@@ -453,13 +519,52 @@ void Mwpm::verify_invariants() const {
 
 void Mwpm::extract_paths_from_match_edges(
     const std::vector<CompressedEdge> &match_edges, uint8_t *obs_begin_ptr, total_weight_int &weight) {
+    size_t num_workers = num_path_workers_for(match_edges.size());
+    if (num_workers > 1) {
+        size_t num_observables = flooder.graph.num_observables;
+        run_path_workers(
+            num_workers,
+            match_edges.size(),
+            [&](PathSearchWorker &worker, SearchFlooder &worker_search_flooder, size_t begin, size_t end) {
+                worker.obs_parity.assign(num_observables, 0);
+                worker.weight = 0;
+                for (size_t k = begin; k < end; k++) {
+                    auto &edge = match_edges[k];
+                    size_t loc_from_idx = edge.loc_from - &flooder.graph.nodes[0];
+                    size_t loc_to_idx = edge.loc_to ? edge.loc_to - &flooder.graph.nodes[0] : SIZE_MAX;
+                    worker_search_flooder.iter_edges_on_shortest_path_from_middle(
+                        loc_from_idx, loc_to_idx, [&](const pm::SearchGraphEdge &e) {
+                            worker_search_flooder.graph.iter_observables_of_edge(e, [&](size_t i) {
+                                worker.obs_parity[i] ^= 1;
+                            });
+                            worker.weight += e.detector_node->neighbor_weights[e.neighbor_index];
+                        });
+                }
+            });
+        for (size_t w = 0; w < num_workers; w++) {
+            auto &worker = path_workers[w];
+            for (size_t i = 0; i < num_observables; i++)
+                obs_begin_ptr[i] ^= worker.obs_parity[i];
+            weight += worker.weight;
+        }
+        return;
+    }
     for (auto &edge : match_edges) {
+        size_t loc_from_idx = edge.loc_from - &flooder.graph.nodes[0];
         size_t loc_to_idx = edge.loc_to ? edge.loc_to - &flooder.graph.nodes[0] : SIZE_MAX;
+        if (search_flooder.path_cache.capacity()) {
+            // Cached paths already store the parity of the observables crossed and the total weight.
+            auto &path = search_flooder.find_shortest_path_from_middle(loc_from_idx, loc_to_idx);
+            for (auto i : path.crossed_observables)
+                *(obs_begin_ptr + i) ^= 1;
+            weight += path.weight;
+            continue;
+        }
         search_flooder.iter_edges_on_shortest_path_from_middle(
-            edge.loc_from - &flooder.graph.nodes[0], loc_to_idx, [&](const pm::SearchGraphEdge &e) {
-                auto &obs = e.detector_node->neighbor_observable_indices[e.neighbor_index];
-                for (auto i : obs)
+            loc_from_idx, loc_to_idx, [&](const pm::SearchGraphEdge &e) {
+                search_flooder.graph.iter_observables_of_edge(e, [&](size_t i) {
                     *(obs_begin_ptr + i) ^= 1;
+                });
                 weight += e.detector_node->neighbor_weights[e.neighbor_index];
             });
     }
@@ -468,12 +573,246 @@ void Mwpm::extract_paths_from_match_edges(
 Mwpm::Mwpm() {
 }
 
+void Mwpm::set_num_path_threads(size_t num_threads) {
+    path_workers.clear();
+    if (num_threads <= 1)
+        return;
+    path_workers.resize(num_threads);
+    for (size_t w = 1; w < num_threads; w++)
+        path_workers[w].search_flooder =
+            std::make_unique<SearchFlooder>(search_flooder.graph.clone_sharing_topology());
+}
+
+size_t Mwpm::num_path_threads() const {
+    return std::max(path_workers.size(), (size_t)1);
+}
+
+void Mwpm::set_decoder_engine(DecoderEngine engine) {
+    if (engine == UNION_FIND) {
+        if (union_find == nullptr)
+            union_find = std::make_unique<UnionFindDecoder>();
+    } else {
+        union_find.reset();
+    }
+}
+
+DecoderEngine Mwpm::decoder_engine() const {
+    return union_find != nullptr ? UNION_FIND : SPARSE_BLOSSOM;
+}
+
+size_t Mwpm::num_path_workers_for(size_t num_match_edges) const {
+    // Starting a thread costs about as much as finding a few short paths, so each thread is given many of them.
+    constexpr size_t MIN_MATCH_EDGES_PER_WORKER = 16;
+    return std::max(std::min(path_workers.size(), num_match_edges / MIN_MATCH_EDGES_PER_WORKER), (size_t)1);
+}
+
+void Mwpm::run_path_workers(
+    size_t num_workers,
+    size_t num_match_edges,
+    const std::function<void(PathSearchWorker &worker, SearchFlooder &search_flooder, size_t begin, size_t end)>
+        &find_paths) {
+    for (size_t w = 1; w < num_workers; w++) {
+        auto &worker_flooder = path_workers[w].search_flooder;
+        if (worker_flooder->graph.topology != search_flooder.graph.topology ||
+            worker_flooder->graph.nodes.size() != search_flooder.graph.nodes.size())
+            worker_flooder = std::make_unique<SearchFlooder>(search_flooder.graph.clone_sharing_topology());
+        worker_flooder->graph.edge_ids = search_flooder.graph.edge_ids;
+        worker_flooder->landmarks = search_flooder.landmarks;
+    }
+
+    std::vector<std::exception_ptr> errors(num_workers);
+    std::vector<std::thread> threads;
+    threads.reserve(num_workers - 1);
+    for (size_t w = 1; w < num_workers; w++) {
+        threads.emplace_back([&, w]() {
+            try {
+                find_paths(
+                    path_workers[w],
+                    *path_workers[w].search_flooder,
+                    num_match_edges * w / num_workers,
+                    num_match_edges * (w + 1) / num_workers);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        });
+    }
+    try {
+        find_paths(path_workers[0], search_flooder, 0, num_match_edges / num_workers);
+    } catch (...) {
+        errors[0] = std::current_exception();
+    }
+    for (auto &thread : threads)
+        thread.join();
+    for (auto &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
 void Mwpm::reset() {
-    for (auto &n : flooder.graph.nodes)
-        n.reset();
-    for (auto &m : search_flooder.graph.nodes)
-        m.reset();
+    flooder.reset_graph();
+    search_flooder.reset_graph();
     flooder.queue.clear();
-    node_arena.~Arena();
-    flooder.region_arena.~Arena();
+    node_arena.clear();
+    flooder.region_arena.clear();
+    shatter_stack.clear();
+}
+
+void Mwpm::reserve(size_t expected_detection_events) {
+    size_t n = expected_detection_events;
+    // Each detection event has a region, and each blossom (of which there are fewer than the detection events) has
+    // another. Each region reaches a few nodes at typical error rates, which `UserGraph::warm_up' measures
+    // more precisely.
+    size_t num_nodes = flooder.graph.nodes.size();
+    flooder.region_arena.reserve(2 * n);
+    node_arena.reserve(n);
+    flooder.queue.reserve(n);
+    flooder.match_edges.reserve(n);
+    flooder.reached_nodes.reserve(std::min(num_nodes, 8 * n));
+    shatter_stack.reserve(n);
+    prune_result_1.orphan_edges.reserve(n);
+    prune_result_1.pruned_path_region_edges.reserve(n);
+    prune_result_2.orphan_edges.reserve(n);
+    prune_result_2.pruned_path_region_edges.reserve(n);
+}
+
+MwpmCapacity Mwpm::capacity() const {
+    MwpmCapacity result;
+    result.regions = flooder.region_arena.capacity();
+    result.alt_tree_nodes = node_arena.capacity();
+    result.queue_events = flooder.queue.capacity();
+    result.match_edges = flooder.match_edges.capacity();
+    result.reached_nodes = flooder.reached_nodes.capacity();
+    result.shatter_stack = shatter_stack.capacity();
+    return result;
+}
+
+bool WorkBudget::operator==(const WorkBudget &other) const {
+    return max_flood_check_events == other.max_flood_check_events && max_nanoseconds == other.max_nanoseconds;
+}
+
+void MwpmCapacity::include(const MwpmCapacity &other) {
+    regions = std::max(regions, other.regions);
+    alt_tree_nodes = std::max(alt_tree_nodes, other.alt_tree_nodes);
+    queue_events = std::max(queue_events, other.queue_events);
+    match_edges = std::max(match_edges, other.match_edges);
+    reached_nodes = std::max(reached_nodes, other.reached_nodes);
+    shatter_stack = std::max(shatter_stack, other.shatter_stack);
+}
+
+bool MwpmCapacity::operator==(const MwpmCapacity &other) const {
+    return regions == other.regions && alt_tree_nodes == other.alt_tree_nodes &&
+           queue_events == other.queue_events && match_edges == other.match_edges &&
+           reached_nodes == other.reached_nodes && shatter_stack == other.shatter_stack;
+}
+
+size_t MwpmMemoryUsage::total() const {
+    return shared_graph + matching_graph + search_graph + decoder_state + auxiliary;
+}
+
+MwpmMemoryUsage &MwpmMemoryUsage::operator+=(const MwpmMemoryUsage &other) {
+    shared_graph += other.shared_graph;
+    mapped_graph += other.mapped_graph;
+    matching_graph += other.matching_graph;
+    search_graph += other.search_graph;
+    decoder_state += other.decoder_state;
+    auxiliary += other.auxiliary;
+    return *this;
+}
+
+namespace {
+
+/// Adds the memory of the shared structure `shared' to `usage' unless it is null or has already been counted.
+template <typename T, typename Bytes>
+void count_shared(
+    const std::shared_ptr<T> &shared,
+    std::unordered_set<const void *> &counted_shared,
+    size_t &usage,
+    const Bytes &bytes_of) {
+    if (shared != nullptr && counted_shared.insert(shared.get()).second)
+        usage += bytes_of(*shared);
+}
+
+/// The per-decoder state of a search flooder, other than its path cache and shared structures.
+void add_search_flooder_state(const SearchFlooder &search_flooder, MwpmMemoryUsage &usage) {
+    usage.search_graph +=
+        memory_bytes(search_flooder.graph.nodes) + memory_bytes(search_flooder.graph.negative_weight_edges);
+    usage.decoder_state += search_flooder.queue.memory_bytes() +
+                           memory_bytes(search_flooder.reached_nodes) + memory_bytes(search_flooder.guided_queue) +
+                           memory_bytes(search_flooder.edge_flip_parity) +
+                           memory_bytes(search_flooder.touched_edge_ids);
+}
+
+}  // namespace
+
+MwpmMemoryUsage Mwpm::memory_usage(std::unordered_set<const void *> &counted_shared) const {
+    MwpmMemoryUsage usage;
+    const MatchingGraph &graph = flooder.graph;
+
+    auto count_topology = [&](const std::shared_ptr<MatchingGraphTopology> &topology) {
+        if (topology != nullptr && counted_shared.insert(topology.get()).second) {
+            usage.shared_graph += sizeof(MatchingGraphTopology) + topology->owned_bytes();
+            usage.mapped_graph += topology->viewed_bytes();
+        }
+    };
+    count_topology(graph.topology);
+    count_topology(search_flooder.graph.topology);
+    count_shared(graph.node_relabeling, counted_shared, usage.shared_graph, [](const NodeRelabeling &relabeling) {
+        return memory_bytes(relabeling.original_index) + memory_bytes(relabeling.graph_index);
+    });
+    count_shared(search_flooder.graph.edge_ids, counted_shared, usage.shared_graph, [](const SearchEdgeIds &ids) {
+        return memory_bytes(ids.offsets) + memory_bytes(ids.ids) + memory_bytes(ids.endpoints);
+    });
+    count_shared(search_flooder.landmarks, counted_shared, usage.shared_graph, [](const SearchLandmarks &landmarks) {
+        return memory_bytes(landmarks.distances) + memory_bytes(landmarks.boundary_distances);
+    });
+    count_shared(
+        small_syndrome_cache.boundary_distances,
+        counted_shared,
+        usage.shared_graph,
+        [](const BoundaryDistances &distances) {
+            return memory_bytes(distances.distances) + memory_bytes(distances.observables);
+        });
+    count_shared(
+        small_syndrome_cache.all_pairs_paths, counted_shared, usage.shared_graph, [](const AllPairsPaths &paths) {
+            return memory_bytes(paths.distances) + memory_bytes(paths.observables) + memory_bytes(paths.is_ambiguous);
+        });
+
+    usage.matching_graph += memory_bytes(graph.nodes) + memory_bytes(graph.negative_weight_detection_events_set) +
+                            memory_bytes(graph.negative_weight_observables_set) +
+                            memory_bytes(graph.is_user_graph_boundary_node);
+
+    usage.decoder_state += flooder.region_arena.memory_bytes() + node_arena.memory_bytes() +
+                           flooder.queue.memory_bytes() + memory_bytes(flooder.match_edges) +
+                           memory_bytes(flooder.reached_nodes) +
+                           memory_bytes(flooder.negative_weight_detection_events) +
+                           memory_bytes(flooder.sorted_shot_detection_events) +
+                           memory_bytes(flooder.flooded_detection_events) +
+                           memory_bytes(flooder.negative_weight_observables) + memory_bytes(shatter_stack);
+    for (const auto *prune_result : {&prune_result_1, &prune_result_2})
+        usage.decoder_state +=
+            memory_bytes(prune_result->orphan_edges) + memory_bytes(prune_result->pruned_path_region_edges);
+
+    add_search_flooder_state(search_flooder, usage);
+    usage.search_graph += search_flooder.path_cache.memory_bytes();
+    usage.decoder_state += memory_bytes(path_workers);
+    for (const auto &worker : path_workers) {
+        usage.decoder_state +=
+            memory_bytes(worker.obs_parity) + memory_bytes(worker.edge_ids) + memory_bytes(worker.edge_nodes);
+        if (worker.search_flooder != nullptr) {
+            add_search_flooder_state(*worker.search_flooder, usage);
+            usage.search_graph += worker.search_flooder->path_cache.memory_bytes();
+        }
+    }
+
+    usage.auxiliary += small_syndrome_cache.memory_bytes() + syndrome_cache.memory_bytes() + predecoder.memory_bytes();
+    for (const auto *decoder : {union_find.get(), degraded_shot_decoder.get()})
+        if (decoder != nullptr)
+            usage.auxiliary += sizeof(UnionFindDecoder) + decoder->memory_bytes();
+    return usage;
+}
+
+MwpmMemoryUsage Mwpm::memory_usage() const {
+    std::unordered_set<const void *> counted_shared;
+    return memory_usage(counted_shared);
 }
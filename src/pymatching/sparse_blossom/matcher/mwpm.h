@@ -15,8 +15,16 @@
 #ifndef PYMATCHING2_MWPM_H
 #define PYMATCHING2_MWPM_H
 
+#include <functional>
+#include <memory>
+#include <unordered_set>
+
 #include "pymatching/sparse_blossom/flooder/graph_flooder.h"
 #include "pymatching/sparse_blossom/matcher/alternating_tree.h"
+#include "pymatching/sparse_blossom/matcher/predecoder.h"
+#include "pymatching/sparse_blossom/matcher/small_syndrome_cache.h"
+#include "pymatching/sparse_blossom/matcher/syndrome_cache.h"
+#include "pymatching/sparse_blossom/matcher/union_find_decoder.h"
 #include "pymatching/sparse_blossom/search/search_flooder.h"
 
 namespace pm {
@@ -38,10 +46,111 @@ struct MatchingResult {
     MatchingResult operator+(const MatchingResult& rhs) const;
 };
 
+/// How many objects of each kind a `Mwpm' holds memory for, so that decoding a shot needing no more of them doesn't
+/// allocate memory (see `Mwpm::capacity' and `Mwpm::reserve').
+struct MwpmCapacity {
+    size_t regions = 0;
+    size_t alt_tree_nodes = 0;
+    /// The total number of events the buckets of the flooder's queue hold memory for.
+    size_t queue_events = 0;
+    size_t match_edges = 0;
+    size_t reached_nodes = 0;
+    size_t shatter_stack = 0;
+
+    /// Raises each count to at least the corresponding count of `other'.
+    void include(const MwpmCapacity& other);
+    bool operator==(const MwpmCapacity& other) const;
+};
+
+/// The memory held by one or more `Mwpm' objects, in bytes (see `Mwpm::memory_usage'). Containers are counted by
+/// their capacity, so this is the memory actually allocated, but the overheads of the allocator and of the nodes of
+/// node-based containers are estimates.
+struct MwpmMemoryUsage {
+    /// The topology of the graph (shared by the MatchingGraph and SearchGraph of a Mwpm, and by the Mwpm objects of
+    /// the same graph), the relabeling of its nodes, and the precomputed structures shared in the same way (the edge
+    /// ids and landmarks of the search graph and the boundary distances and all-pairs paths of the small syndrome
+    /// cache).
+    size_t shared_graph = 0;
+    /// The memory of a topology that is a view of a mapped graph file (see `attach_mwpm_to_graph_file'). It is held
+    /// by the operating system's page cache, shared by every process that maps the file, so isn't in `total'.
+    size_t mapped_graph = 0;
+    /// The per-decoder state of each node of the MatchingGraph, and the negative weight edges.
+    size_t matching_graph = 0;
+    /// The per-decoder state of each node of the SearchGraph of the Mwpm and of its path workers, the negative
+    /// weight edges, and the cached paths.
+    size_t search_graph = 0;
+    /// The state of the blossom algorithm kept between shots: the region and alternating tree node arenas, the queues
+    /// and the scratch buffers. They only grow, so this is their high-water mark (see `Mwpm::capacity').
+    size_t decoder_state = 0;
+    /// The syndrome caches, the predecoder and the Union-Find decoders.
+    size_t auxiliary = 0;
+
+    size_t total() const;
+    MwpmMemoryUsage& operator+=(const MwpmMemoryUsage& other);
+};
+
+/// A limit on the work the blossom algorithm may do to decode a shot, so that shots can be decoded with a bounded
+/// latency. A limit of zero is no limit.
+struct WorkBudget {
+    /// The most flood check events (valid or stale) that may be taken from the flooder's queue.
+    size_t max_flood_check_events = 0;
+    /// The most time that may be spent flooding, in nanoseconds.
+    uint64_t max_nanoseconds = 0;
+
+    inline bool is_limited() const {
+        return max_flood_check_events != 0 || max_nanoseconds != 0;
+    }
+    bool operator==(const WorkBudget& other) const;
+};
+
+/// The state of one of the threads finding the shortest paths of the match edges of a shot in parallel (see
+/// `Mwpm::set_num_path_threads').
+struct PathSearchWorker {
+    /// Searches the graph of the Mwpm's own `search_flooder', sharing its topology. Null for the first worker, which
+    /// is the calling thread and uses the Mwpm's `search_flooder'.
+    std::unique_ptr<SearchFlooder> search_flooder;
+    /// The parity of each observable crossed by the paths found by the worker, and their total weight.
+    std::vector<uint8_t> obs_parity;
+    total_weight_int weight = 0;
+    /// The id (see `SearchEdgeIds') and the two nodes (-1 for the boundary) of each edge on the paths found by the
+    /// worker, in the order they were found.
+    std::vector<size_t> edge_ids;
+    std::vector<int64_t> edge_nodes;
+};
+
 struct Mwpm {
     GraphFlooder flooder;
     Arena<AltTreeNode> node_arena;
     SearchFlooder search_flooder;
+    /// Solutions for lone detection events, used to decode very small syndromes without the blossom algorithm.
+    SmallSyndromeCache small_syndrome_cache;
+    /// Solutions of recently decoded syndromes, used to skip the blossom algorithm for repeated syndromes. Disabled
+    /// (with a capacity of zero) unless enabled by the user.
+    SyndromeCache syndrome_cache;
+    /// Matches pairs of adjacent detection events before the blossom algorithm, leaving it only the others. Off
+    /// (matching no pairs) unless enabled by the user.
+    Predecoder predecoder;
+    /// Scratch space for `shatter_blossom_and_extract_matches', holding the regions still to be shattered. Kept
+    /// between calls to avoid reallocating it.
+    std::vector<GraphFillRegion*> shatter_stack;
+    /// Scratch space for `handle_tree_hitting_self', holding the paths pruned from the alternating tree.
+    AltTreePruneResult prune_result_1;
+    AltTreePruneResult prune_result_2;
+    /// The workers used to find the shortest paths of the match edges of a shot in parallel, or empty if they are
+    /// found by the calling thread alone (the default).
+    std::vector<PathSearchWorker> path_workers;
+    /// The Union-Find decoder used to decode shots instead of the blossom algorithm, over the same graph as
+    /// `flooder', or null if shots are decoded by the blossom algorithm (the default).
+    std::unique_ptr<UnionFindDecoder> union_find;
+    /// The most work the blossom algorithm may do on a shot (unlimited by default). A shot that runs out of budget is
+    /// abandoned and decoded instead by `degraded_shot_decoder', a Union-Find decoder created when first needed,
+    /// which takes time almost linear in the number of detection events but doesn't always find a minimum weight
+    /// correction. Only `decode_detection_events' and `decode_detection_events_for_up_to_64_observables' have a
+    /// budget.
+    WorkBudget work_budget;
+    std::unique_ptr<UnionFindDecoder> degraded_shot_decoder;
+    /// The number of shots that ran out of budget (which are also counted in `flooder.stats').
+    uint64_t num_degraded_shots = 0;
 
     Mwpm();
     explicit Mwpm(GraphFlooder flooder);
@@ -70,19 +179,70 @@ struct Mwpm {
         const CompressedEdge& unmatched_to_matched_edge);
     void handle_tree_hitting_self(const RegionHitRegionEventData& event, AltTreeNode* common_ancestor);
     void handle_tree_hitting_other_tree(const RegionHitRegionEventData& event);
+    /// Matches up the blossom children of `region', except the one matched to the region `region' is matched to,
+    /// which is returned. The regions of the new matches are pushed onto `shatter_stack' to be shattered.
     GraphFillRegion* pair_and_shatter_subblossoms_and_extract_matches(GraphFillRegion* region, MatchingResult& res);
+    /// Shatters the matched `region', its match, and all the blossoms within them into matches between regions
+    /// without blossom children, deleting the regions and returning the total solution of the matches.
     MatchingResult shatter_blossom_and_extract_matches(GraphFillRegion* region);
 
     GraphFillRegion* pair_and_shatter_subblossoms_and_extract_match_edges(
+        GraphFillRegion* region, std::vector<CompressedEdge>& match_edges, MatchingResult& res);
+    /// Like `shatter_blossom_and_extract_matches', but also appends the edge of each match to `match_edges'. The
+    /// returned solution is the same, so it doesn't need to be found again from the paths of the match edges.
+    MatchingResult shatter_blossom_and_extract_match_edges(
         GraphFillRegion* region, std::vector<CompressedEdge>& match_edges);
-    void shatter_blossom_and_extract_match_edges(GraphFillRegion* region, std::vector<CompressedEdge>& match_edges);
     void extract_paths_from_match_edges(
         const std::vector<CompressedEdge>& match_edges, uint8_t* obs_begin_ptr, pm::total_weight_int& weight);
+    /// Finds the shortest paths of the match edges with `num_threads' threads (including the calling thread) in
+    /// `extract_paths_from_match_edges' and `decode_detection_events_to_edges', when a shot has enough match edges to
+    /// be worth it. The paths are independent Dijkstra searches, so each extra thread searches with its own
+    /// SearchFlooder, sharing the topology of `search_flooder' but without a path cache, and the parities of the
+    /// edges and observables found by the threads are combined afterwards. The result doesn't depend on the number
+    /// of threads.
+    void set_num_path_threads(size_t num_threads);
+    size_t num_path_threads() const;
+    /// Sets the algorithm `decode_detection_events' and `decode_detection_events_for_up_to_64_observables' use to
+    /// decode a shot. With UNION_FIND, shots are decoded by `union_find', which is faster but doesn't always find a
+    /// minimum weight correction. Decoding to match edges or to edges (as in the first round of correlated decoding)
+    /// always uses the blossom algorithm.
+    void set_decoder_engine(DecoderEngine engine);
+    DecoderEngine decoder_engine() const;
+    /// The number of workers `run_path_workers' should use for a shot with `num_match_edges' match edges: 1 (in
+    /// which case the paths should be found by the calling thread alone) unless there are enough match edges for
+    /// each of several threads.
+    size_t num_path_workers_for(size_t num_match_edges) const;
+    /// Splits match edges [0, num_match_edges) into a contiguous range for each of the first `num_workers' path
+    /// workers, and calls `find_paths(worker, search_flooder, begin, end)' for each of them in parallel, the first on
+    /// the calling thread with `search_flooder'. The other workers are first brought up to date with
+    /// `search_flooder', e.g. after its graph has been given a new topology.
+    void run_path_workers(
+        size_t num_workers,
+        size_t num_match_edges,
+        const std::function<void(PathSearchWorker& worker, SearchFlooder& search_flooder, size_t begin, size_t end)>&
+            find_paths);
 
     void verify_invariants() const;
 
+    /// Creates a region at `node', which must not have been reached by any region, that starts growing from radius 0 at
+    /// the current time of the queue. Usually that is time 0, but detection events may also be added part way through
+    /// flooding (see `StreamingDecoder').
     void create_detection_event(DetectorNode* node);
+    /// Updates the high-water marks of the arenas in `flooder.stats'. Sampled after each detection event is added
+    /// and after each event is processed, so allocations made and released within one event are not seen.
+    void record_arena_usage();
     void reset();
+    /// Preallocates enough regions, alternating tree nodes, queue buckets and scratch buffers for shots with about
+    /// `expected_detection_events' detection events, so that the first such shots don't spend their time growing
+    /// them. The memory is kept by later shots, so this only needs calling once.
+    void reserve(size_t expected_detection_events);
+    /// The memory currently held, which after decoding some shots is the high-water mark they reached.
+    MwpmCapacity capacity() const;
+    /// The memory currently held, in bytes. Structures that may be shared with other Mwpm objects are only counted in
+    /// `shared_graph' (or `mapped_graph') if they aren't already in `counted_shared', to which they are then added,
+    /// so that the memory of several Mwpm objects can be added up without counting what they share more than once.
+    MwpmMemoryUsage memory_usage(std::unordered_set<const void*>& counted_shared) const;
+    MwpmMemoryUsage memory_usage() const;
 };
 }  // namespace pm
 
@@ -159,6 +159,188 @@ TEST(Mwpm, BlossomCreatedThenShattered) {
     ASSERT_EQ(ns[5].region_that_arrived->match, (Match{nullptr, {&ns[5], nullptr, 8}}));
 }
 
+TEST(Mwpm, DecoderStats) {
+    auto mwpm = Mwpm(GraphFlooder(MatchingGraph(10, 64)));
+    auto& g = mwpm.flooder.graph;
+    g.add_edge(0, 1, 10, {0});
+    g.add_edge(1, 4, 20, {1});
+    g.add_edge(4, 3, 20, {0, 1});
+    g.add_edge(3, 2, 12, {2});
+    g.add_edge(0, 2, 16, {0, 2});
+    g.add_edge(4, 5, 50, {1, 2});
+    g.add_edge(2, 6, 100, {0, 1, 2});
+    g.add_boundary_edge(5, 36, {3});
+    for (size_t i = 0; i < 7; i++) {
+        mwpm.create_detection_event(&mwpm.flooder.graph.nodes[i]);
+    }
+    while (true) {
+        auto ev = mwpm.flooder.run_until_next_mwpm_notification();
+        if (ev.event_type == NO_EVENT)
+            break;
+        mwpm.process_event(ev);
+    }
+
+    auto& stats = mwpm.flooder.stats;
+    if (!DECODER_STATS_ENABLED) {
+        ASSERT_EQ(stats, DecoderStats());
+        return;
+    }
+    // The same events as in BlossomCreatedThenShattered.
+    ASSERT_EQ(stats.num_region_hit_region_events, 7);
+    ASSERT_EQ(stats.num_region_hit_boundary_events, 1);
+    ASSERT_EQ(stats.num_blossom_shatter_events, 1);
+    ASSERT_EQ(stats.num_blossoms_created, 1);
+    ASSERT_EQ(stats.max_blossom_depth, 1);
+    ASSERT_EQ(stats.max_regions_in_use, 8);
+    ASSERT_EQ(stats.max_alt_tree_nodes_in_use, 7);
+    ASSERT_EQ(stats.num_nodes_touched, mwpm.flooder.reached_nodes.size());
+    ASSERT_EQ(mwpm.flooder.queue.num_pushes, 0);
+    ASSERT_GT(stats.num_queue_pushes, 0);
+    ASSERT_LE(stats.num_queue_pops, stats.num_queue_pushes);
+    ASSERT_EQ(stats.num_stale_dequeues, mwpm.flooder.num_stale_dequeues);
+    ASSERT_EQ(stats.num_queue_pops, mwpm.flooder.num_valid_dequeues + mwpm.flooder.num_stale_dequeues);
+
+    stats.clear();
+    ASSERT_EQ(stats, DecoderStats());
+}
+
+TEST(Mwpm, ReserveAvoidsGrowingOnTheFirstShot) {
+    auto make_mwpm = []() {
+        auto mwpm = Mwpm(GraphFlooder(MatchingGraph(10, 64)));
+        auto& g = mwpm.flooder.graph;
+        g.add_edge(0, 1, 10, {0});
+        g.add_edge(1, 4, 20, {1});
+        g.add_edge(4, 3, 20, {0, 1});
+        g.add_edge(3, 2, 12, {2});
+        g.add_edge(0, 2, 16, {0, 2});
+        g.add_edge(4, 5, 50, {1, 2});
+        g.add_edge(2, 6, 100, {0, 1, 2});
+        g.add_boundary_edge(5, 36, {3});
+        return mwpm;
+    };
+    auto decode = [](Mwpm& mwpm) {
+        for (size_t i = 0; i < 7; i++)
+            mwpm.create_detection_event(&mwpm.flooder.graph.nodes[i]);
+        while (true) {
+            auto ev = mwpm.flooder.run_until_next_mwpm_notification();
+            if (ev.event_type == NO_EVENT)
+                break;
+            mwpm.process_event(ev);
+        }
+    };
+
+    auto mwpm = make_mwpm();
+    ASSERT_EQ(mwpm.capacity(), MwpmCapacity());
+    mwpm.reserve(16);
+    auto reserved = mwpm.capacity();
+    ASSERT_GE(reserved.regions, 32);
+    ASSERT_GE(reserved.alt_tree_nodes, 16);
+    ASSERT_GE(reserved.queue_events, 16);
+    ASSERT_GE(reserved.match_edges, 16);
+    ASSERT_EQ(reserved.reached_nodes, 10);
+    ASSERT_GE(reserved.shatter_stack, 16);
+
+    // The shot needs no more than was reserved, so nothing grows.
+    decode(mwpm);
+    ASSERT_EQ(mwpm.capacity(), reserved);
+
+    // Without reserving, the high-water marks are those of the shot.
+    auto unreserved = make_mwpm();
+    decode(unreserved);
+    auto reached = unreserved.capacity();
+    ASSERT_GE(reached.regions, 8);
+    ASSERT_GE(reached.alt_tree_nodes, 7);
+    ASSERT_GE(reached.reached_nodes, 7);
+    MwpmCapacity combined = reached;
+    combined.include(reserved);
+    ASSERT_EQ(combined, reserved);
+}
+
+TEST(Mwpm, MemoryUsage) {
+    auto mwpm = Mwpm(GraphFlooder(MatchingGraph(10, 64)));
+    auto& g = mwpm.flooder.graph;
+    g.add_edge(0, 1, 10, {0});
+    g.add_edge(1, 4, 20, {1});
+    g.add_edge(4, 3, 20, {0, 1});
+    g.add_edge(3, 2, 12, {2});
+    g.add_boundary_edge(5, 36, {3});
+    g.compact_topology();
+
+    auto before = mwpm.memory_usage();
+    ASSERT_GT(before.shared_graph, 0);
+    ASSERT_EQ(before.mapped_graph, 0);
+    ASSERT_GE(before.matching_graph, 10 * sizeof(DetectorNode));
+    ASSERT_EQ(
+        before.total(),
+        before.shared_graph + before.matching_graph + before.search_graph + before.decoder_state + before.auxiliary);
+
+    // Reserved memory is decoder state.
+    mwpm.reserve(16);
+    auto reserved = mwpm.memory_usage();
+    ASSERT_GE(reserved.decoder_state, before.decoder_state + 32 * sizeof(GraphFillRegion) + 16 * sizeof(AltTreeNode));
+    ASSERT_EQ(reserved.shared_graph, before.shared_graph);
+    ASSERT_EQ(reserved.matching_graph, before.matching_graph);
+
+    // A topology shared with another Mwpm is only counted once.
+    auto other = Mwpm(GraphFlooder(g.clone_sharing_topology()));
+    auto other_alone = other.memory_usage();
+    std::unordered_set<const void*> counted_shared;
+    auto total = mwpm.memory_usage(counted_shared);
+    total += other.memory_usage(counted_shared);
+    size_t topology_bytes = sizeof(MatchingGraphTopology) + g.topology->owned_bytes();
+    ASSERT_EQ(total.shared_graph, before.shared_graph + other_alone.shared_graph - topology_bytes);
+    ASSERT_EQ(total.matching_graph, 2 * before.matching_graph);
+}
+
+TEST(Mwpm, DecoderTrace) {
+    auto mwpm = Mwpm(GraphFlooder(MatchingGraph(10, 64)));
+    auto& g = mwpm.flooder.graph;
+    g.add_edge(0, 1, 10, {0});
+    g.add_edge(1, 4, 20, {1});
+    g.add_edge(4, 3, 20, {0, 1});
+    g.add_edge(3, 2, 12, {2});
+    g.add_edge(0, 2, 16, {0, 2});
+    g.add_edge(4, 5, 50, {1, 2});
+    g.add_edge(2, 6, 100, {0, 1, 2});
+    g.add_boundary_edge(5, 36, {3});
+    mwpm.flooder.trace.set_capacity(1000);
+    mwpm.flooder.trace.begin_shot();
+    for (size_t i = 0; i < 7; i++) {
+        mwpm.create_detection_event(&mwpm.flooder.graph.nodes[i]);
+    }
+    while (true) {
+        auto ev = mwpm.flooder.run_until_next_mwpm_notification();
+        if (ev.event_type == NO_EVENT)
+            break;
+        mwpm.process_event(ev);
+    }
+
+    auto records = mwpm.flooder.trace.kept_records();
+    if (!DECODER_TRACE_ENABLED) {
+        ASSERT_TRUE(records.empty());
+        return;
+    }
+    std::array<size_t, NUM_TRACE_EVENT_KINDS> counts{};
+    for (size_t k = 0; k < records.size(); k++) {
+        counts[records[k].kind]++;
+        if (k > 0) {
+            ASSERT_GE(records[k].flood_time, records[k - 1].flood_time);
+        }
+        if (records[k].kind == TRACE_REGION_HIT_BOUNDARY) {
+            ASSERT_EQ(records[k].node1, 5);
+            ASSERT_EQ(records[k].node2, TRACE_NO_NODE);
+        }
+    }
+    // The same events as in BlossomCreatedThenShattered.
+    ASSERT_EQ(counts[TRACE_REGION_HIT_REGION], 7);
+    ASSERT_EQ(counts[TRACE_REGION_HIT_BOUNDARY], 1);
+    ASSERT_EQ(counts[TRACE_BLOSSOM_SHATTER], 1);
+    ASSERT_EQ(counts[TRACE_STALE_EVENT], mwpm.flooder.num_stale_dequeues);
+    ASSERT_EQ(
+        counts[TRACE_LOOK_AT_NODE] + counts[TRACE_LOOK_AT_SHRINKING_REGION], mwpm.flooder.num_valid_dequeues);
+    ASSERT_EQ(records.size(), mwpm.flooder.trace.num_recorded());
+}
+
 TEST(Mwpm, BlossomShatterDrivenWithoutFlooder) {
     size_t n = 10;
     auto mwpm = Mwpm(GraphFlooder(MatchingGraph(n + 3, 64)));
@@ -227,7 +409,7 @@ TEST(Mwpm, BranchingTreeFormsBlossomThenHitsBoundaryMatch) {
             .alt_tree_node;
     auto actual_tree = ns[0].region_that_arrived->alt_tree_node;
     ASSERT_EQ(*expected_tree, *actual_tree);
-    std::vector<AltTreeEdge> expected_blossom_tree_children = {
+    decltype(expected_tree->children) expected_blossom_tree_children = {
         expected_tree->children[0].alt_tree_node->children[0], expected_tree->children[1].alt_tree_node->children[1]};
     // Form blossom
     mwpm.process_event(rhr(ns, 10, 11));
@@ -0,0 +1,153 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/matcher/predecoder.h"
+
+#include <stdexcept>
+
+#include "pymatching/sparse_blossom/memory_bytes.h"
+
+using namespace pm;
+
+namespace {
+
+/// The index of the other end of the `k'th edge of node `u', or SIZE_MAX for a boundary edge.
+inline size_t neighbor_of(const MatchingGraph& graph, size_t u, size_t k) {
+    DetectorNode* neighbor = graph.nodes[u].neighbors[k];
+    return neighbor == nullptr ? SIZE_MAX : (size_t)(neighbor - graph.nodes.data());
+}
+
+}  // namespace
+
+PredecoderMode pm::predecoder_mode_from_string(const std::string& name) {
+    if (name == "off")
+        return PREDECODER_OFF;
+    if (name == "exact")
+        return PREDECODER_EXACT;
+    if (name == "approximate")
+        return PREDECODER_APPROXIMATE;
+    throw std::invalid_argument(
+        "Predecoder mode \"" + name + "\" not recognised. Expected \"off\", \"exact\" or \"approximate\".");
+}
+
+std::string pm::predecoder_mode_name(PredecoderMode mode) {
+    switch (mode) {
+        case PREDECODER_EXACT:
+            return "exact";
+        case PREDECODER_APPROXIMATE:
+            return "approximate";
+        default:
+            return "off";
+    }
+}
+
+Predecoder::Predecoder() : mode(PREDECODER_OFF), obs_mask(0), weight(0) {
+}
+
+size_t Predecoder::memory_bytes() const {
+    return pm::memory_bytes(residual_detection_events) + pm::memory_bytes(event_counts);
+}
+
+/// Whether every edge of `u' other than its `k'th edge (to `v') is longer, by more than the weight of that edge,
+/// than an edge from `v' to the same node or to the boundary.
+bool Predecoder::is_dominated_by(const MatchingGraph& graph, size_t u, size_t k, size_t v) const {
+    const auto& node_u = graph.nodes[u];
+    const auto& node_v = graph.nodes[v];
+    weight_int w = node_u.neighbor_weights[k];
+    for (size_t i = 0; i < node_u.neighbors.size(); i++) {
+        if (i == k)
+            continue;
+        size_t n = neighbor_of(graph, u, i);
+        total_weight_int longest_dominating_weight = (total_weight_int)node_u.neighbor_weights[i] - w - 1;
+        bool dominated = false;
+        for (size_t j = 0; j < node_v.neighbors.size() && !dominated; j++) {
+            dominated = neighbor_of(graph, v, j) == n &&
+                        (total_weight_int)node_v.neighbor_weights[j] <= longest_dominating_weight;
+        }
+        if (!dominated)
+            return false;
+    }
+    return true;
+}
+
+/// Whether the `k'th edge of `u' (to `v') is a lightest edge of both `u' and `v', and neither of them has another
+/// neighbour with a detection event in the current shot.
+bool Predecoder::is_isolated_pair(const MatchingGraph& graph, size_t u, size_t k, size_t v) const {
+    weight_int w = graph.nodes[u].neighbor_weights[k];
+    for (size_t a : {u, v}) {
+        const auto& node = graph.nodes[a];
+        for (size_t i = 0; i < node.neighbors.size(); i++) {
+            size_t n = neighbor_of(graph, a, i);
+            if (n == u || n == v)
+                continue;
+            if (node.neighbor_weights[i] < w || (n != SIZE_MAX && event_counts[n] != 0))
+                return false;
+        }
+    }
+    return true;
+}
+
+void Predecoder::predecode(const MatchingGraph& graph, std::span<const uint64_t> detection_events) {
+    obs_mask = 0;
+    weight = 0;
+    residual_detection_events.clear();
+    if (event_counts.size() != graph.nodes.size())
+        event_counts.assign(graph.nodes.size(), 0);
+
+    for (uint64_t detection : detection_events) {
+        if (detection < event_counts.size() && event_counts[detection] < 2)
+            event_counts[detection]++;
+    }
+    for (uint64_t detection : detection_events) {
+        if (detection >= event_counts.size() || event_counts[detection] != 1 ||
+            (detection < graph.is_user_graph_boundary_node.size() && graph.is_user_graph_boundary_node[detection]))
+            continue;
+        size_t u = detection;
+        const auto& node = graph.nodes[u];
+        for (size_t k = 0; k < node.neighbors.size(); k++) {
+            size_t v = neighbor_of(graph, u, k);
+            if (v == SIZE_MAX || v == u || event_counts[v] != 1 ||
+                (v < graph.is_user_graph_boundary_node.size() && graph.is_user_graph_boundary_node[v]))
+                continue;
+            bool matched = is_dominated_by(graph, u, k, v);
+            if (!matched) {
+                const auto& node_v = graph.nodes[v];
+                for (size_t j = 0; j < node_v.neighbors.size(); j++) {
+                    if (neighbor_of(graph, v, j) == u) {
+                        matched = is_dominated_by(graph, v, j, u);
+                        break;
+                    }
+                }
+            }
+            if (!matched && mode == PREDECODER_APPROXIMATE)
+                matched = is_isolated_pair(graph, u, k, v);
+            if (matched) {
+                obs_mask ^= node.neighbor_observables[k];
+                weight += node.neighbor_weights[k];
+                event_counts[u] = 0;
+                event_counts[v] = 0;
+                break;
+            }
+        }
+    }
+
+    for (uint64_t detection : detection_events) {
+        if (detection >= event_counts.size() || event_counts[detection] != 0)
+            residual_detection_events.push_back(detection);
+    }
+    for (uint64_t detection : detection_events) {
+        if (detection < event_counts.size())
+            event_counts[detection] = 0;
+    }
+}
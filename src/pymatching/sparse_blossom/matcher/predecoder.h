@@ -0,0 +1,87 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_PREDECODER_H
+#define PYMATCHING2_PREDECODER_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "pymatching/sparse_blossom/flooder/graph.h"
+
+namespace pm {
+
+/// Which pairs of adjacent detection events a `Predecoder' matches before the blossom algorithm is run.
+enum PredecoderMode : uint8_t {
+    /// No pairs are matched (the default).
+    PREDECODER_OFF = 0,
+    /// Only pairs that are in every minimum weight perfect matching.
+    PREDECODER_EXACT = 1,
+    /// Also isolated pairs joined by their lightest edge, which are usually, but not always, in a minimum weight
+    /// perfect matching.
+    PREDECODER_APPROXIMATE = 2,
+};
+
+/// Parses "off", "exact" or "approximate". Throws std::invalid_argument for any other name.
+PredecoderMode predecoder_mode_from_string(const std::string& name);
+std::string predecoder_mode_name(PredecoderMode mode);
+
+/// Per-decoder state of a greedy pass over the detection events of a shot, which matches pairs of detection events
+/// joined by an edge of the MatchingGraph and leaves only the others to the blossom algorithm. At low error rates,
+/// most detection events come in such pairs.
+///
+/// In PREDECODER_EXACT mode, detection events u and v joined by an edge of weight w are matched if every other edge
+/// of u (to a node n, or to the boundary) is longer, by more than w, than an edge from v to the same node (or to the
+/// boundary). Any path leaving u then has a strictly shorter counterpart leaving v, so swapping the partners of u
+/// and v in a matching that doesn't pair them would make it lighter: every minimum weight perfect matching pairs u
+/// with v, whatever the other detection events. This always holds for a node whose only edge is to v.
+///
+/// In PREDECODER_APPROXIMATE mode, u and v are also matched if their edge is a lightest edge of both of them, and
+/// neither has another neighbour with a detection event, so that no other detection event (or the boundary) is
+/// closer to either of them than they are to each other. A matching can still be lighter with u and v matched to
+/// other detection events further away, so this trades some accuracy for speed.
+class Predecoder {
+   public:
+    PredecoderMode mode;
+    /// The detection events of the last shot that were not matched, in the order they were given.
+    std::vector<uint64_t> residual_detection_events;
+    /// The observables crossed by the edges of the pairs matched in the last shot, and their total weight.
+    obs_int obs_mask;
+    total_weight_int weight;
+
+    Predecoder();
+
+    /// Matches the pairs of `detection_events' (indices of nodes of `graph') allowed by `mode', setting `obs_mask',
+    /// `weight' and `residual_detection_events'. Detection events that are repeated, that are on boundary nodes of
+    /// the UserGraph the graph was built from, or that are not nodes of the graph are left in
+    /// `residual_detection_events', to be handled by the full algorithm. The topology of `graph' must not
+    /// `has_observable_indices', and it must have no negative weight edges.
+    void predecode(const MatchingGraph& graph, std::span<const uint64_t> detection_events);
+    /// The memory held by the predecoder, in bytes.
+    size_t memory_bytes() const;
+
+   private:
+    /// For each node, the number of times it appears in the current shot's detection events (saturating at 2), or
+    /// zero once it has been matched. Only the nodes of the current shot are set, and they are cleared afterwards.
+    std::vector<uint8_t> event_counts;
+
+    bool is_dominated_by(const MatchingGraph& graph, size_t u, size_t k, size_t v) const;
+    bool is_isolated_pair(const MatchingGraph& graph, size_t u, size_t k, size_t v) const;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_PREDECODER_H
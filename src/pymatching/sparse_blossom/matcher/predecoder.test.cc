@@ -0,0 +1,90 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/matcher/predecoder.h"
+
+#include <gtest/gtest.h>
+
+#include "pymatching/sparse_blossom/flooder/graph.h"
+
+using namespace pm;
+
+TEST(Predecoder, ModeNames) {
+    ASSERT_EQ(predecoder_mode_from_string("off"), PREDECODER_OFF);
+    ASSERT_EQ(predecoder_mode_from_string("exact"), PREDECODER_EXACT);
+    ASSERT_EQ(predecoder_mode_from_string("approximate"), PREDECODER_APPROXIMATE);
+    ASSERT_THROW(predecoder_mode_from_string("greedy"), std::invalid_argument);
+    ASSERT_EQ(predecoder_mode_name(PREDECODER_APPROXIMATE), "approximate");
+}
+
+TEST(Predecoder, ExactModeMatchesDominatedPairs) {
+    // 0 is a leaf hanging from 1, and 3's edges are each longer by more than 1 than the same edges of 2.
+    MatchingGraph g(6, 7);
+    g.add_edge(0, 1, 5, {0});
+    g.add_edge(1, 2, 4, {1});
+    g.add_edge(2, 3, 1, {2});
+    g.add_edge(2, 4, 2, {3});
+    g.add_edge(3, 4, 4, {4});
+    g.add_boundary_edge(2, 2, {5});
+    g.add_boundary_edge(3, 4, {6});
+    g.add_edge(4, 5, 2, {5});
+    Predecoder p;
+    p.mode = PREDECODER_EXACT;
+
+    p.predecode(g, std::vector<uint64_t>{0, 1, 2, 3});
+    ASSERT_TRUE(p.residual_detection_events.empty());
+    ASSERT_EQ(p.obs_mask, (obs_int)0b101);
+    ASSERT_EQ(p.weight, 6);
+
+    // 1 and 2 are adjacent, but neither dominates the other.
+    p.predecode(g, std::vector<uint64_t>{1, 2});
+    ASSERT_EQ(p.residual_detection_events, std::vector<uint64_t>({1, 2}));
+    ASSERT_EQ(p.obs_mask, 0);
+    ASSERT_EQ(p.weight, 0);
+
+    // Repeated detection events and those not in the graph are left to the full algorithm.
+    p.predecode(g, std::vector<uint64_t>{3, 2, 2, 9});
+    ASSERT_EQ(p.residual_detection_events, std::vector<uint64_t>({3, 2, 2, 9}));
+    p.predecode(g, std::vector<uint64_t>{3, 2});
+    ASSERT_TRUE(p.residual_detection_events.empty());
+}
+
+TEST(Predecoder, ApproximateModeMatchesIsolatedPairs) {
+    // A line 0 - 1 - ... - 9 with a boundary edge at each end.
+    MatchingGraph g(10, 11);
+    g.add_boundary_edge(0, 2, {0});
+    for (size_t i = 0; i < 9; i++)
+        g.add_edge(i, i + 1, 2, {i + 1});
+    g.add_boundary_edge(9, 2, {10});
+    Predecoder p;
+
+    p.mode = PREDECODER_EXACT;
+    p.predecode(g, std::vector<uint64_t>{3, 4});
+    ASSERT_EQ(p.residual_detection_events, std::vector<uint64_t>({3, 4}));
+
+    p.mode = PREDECODER_APPROXIMATE;
+    p.predecode(g, std::vector<uint64_t>{1, 2, 6, 7});
+    ASSERT_TRUE(p.residual_detection_events.empty());
+    ASSERT_EQ(p.obs_mask, (obs_int)1 << 2 | (obs_int)1 << 7);
+    ASSERT_EQ(p.weight, 4);
+
+    // 3 has two neighbours with detection events, so no pair is isolated.
+    p.predecode(g, std::vector<uint64_t>{2, 3, 4});
+    ASSERT_EQ(p.residual_detection_events, std::vector<uint64_t>({2, 3, 4}));
+
+    // A lighter edge elsewhere could give a lighter matching.
+    g.add_edge(4, 6, 1, {0});
+    p.predecode(g, std::vector<uint64_t>{4, 5});
+    ASSERT_EQ(p.residual_detection_events, std::vector<uint64_t>({4, 5}));
+}
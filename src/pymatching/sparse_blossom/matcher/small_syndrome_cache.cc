@@ -0,0 +1,185 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/matcher/small_syndrome_cache.h"
+
+#include <algorithm>
+#include <bit>
+#include <functional>
+#include <limits>
+
+#include "pymatching/sparse_blossom/memory_bytes.h"
+
+using namespace pm;
+
+SmallSyndromeCache::SmallSyndromeCache(size_t num_nodes)
+    : boundary_match_states(num_nodes, BOUNDARY_MATCH_UNKNOWN),
+      boundary_match_obs_masks(num_nodes, 0),
+      boundary_match_weights(num_nodes, 0) {
+}
+
+void SmallSyndromeCache::set_boundary_match(size_t node_index, obs_int obs_mask, total_weight_int weight) {
+    boundary_match_states[node_index] = BOUNDARY_MATCH_KNOWN;
+    boundary_match_obs_masks[node_index] = obs_mask;
+    boundary_match_weights[node_index] = weight;
+}
+
+void SmallSyndromeCache::set_boundary_unreachable(size_t node_index) {
+    boundary_match_states[node_index] = BOUNDARY_MATCH_UNREACHABLE;
+}
+
+void SmallSyndromeCache::clear() {
+    std::fill(boundary_match_states.begin(), boundary_match_states.end(), BOUNDARY_MATCH_UNKNOWN);
+    boundary_distances = nullptr;
+    all_pairs_paths = nullptr;
+}
+
+size_t SmallSyndromeCache::memory_bytes() const {
+    return pm::memory_bytes(boundary_match_states) + pm::memory_bytes(boundary_match_obs_masks) +
+           pm::memory_bytes(boundary_match_weights) + pm::memory_bytes(distances) + pm::memory_bytes(touched_nodes) +
+           pm::memory_bytes(heap) + pm::memory_bytes(subset_weights) + pm::memory_bytes(subset_obs_masks) +
+           pm::memory_bytes(subset_is_ambiguous);
+}
+
+void SmallSyndromeCache::reset(size_t num_nodes) {
+    boundary_match_states.assign(num_nodes, BOUNDARY_MATCH_UNKNOWN);
+    boundary_match_obs_masks.assign(num_nodes, 0);
+    boundary_match_weights.assign(num_nodes, 0);
+    boundary_distances = nullptr;
+    all_pairs_paths = nullptr;
+}
+
+const BoundaryDistances& SmallSyndromeCache::precompute_boundary_distances(const MatchingGraph& graph) {
+    if (boundary_distances == nullptr || boundary_distances->distances.size() != graph.nodes.size())
+        boundary_distances = std::make_shared<const BoundaryDistances>(graph);
+    return *boundary_distances;
+}
+
+const AllPairsPaths* SmallSyndromeCache::precompute_all_pairs_paths(const MatchingGraph& graph) {
+    if (graph.nodes.size() > AllPairsPaths::MAX_NODES || graph.num_observables > sizeof(obs_int) * 8)
+        return nullptr;
+    if (all_pairs_paths == nullptr || all_pairs_paths->num_nodes != graph.nodes.size())
+        all_pairs_paths = std::make_shared<const AllPairsPaths>(graph);
+    return all_pairs_paths.get();
+}
+
+bool SmallSyndromeCache::match_with_all_pairs_paths(
+    const size_t* events, size_t num_events, obs_int& obs_mask, total_weight_int& weight) {
+    if (num_events > MAX_LOOKUP_DETECTION_EVENTS)
+        return false;
+    for (size_t i = 0; i < num_events; i++) {
+        for (size_t j = i + 1; j < num_events; j++) {
+            if (events[i] == events[j])
+                return false;
+        }
+    }
+    const AllPairsPaths& paths = *all_pairs_paths;
+    size_t num_subsets = (size_t)1 << num_events;
+    subset_weights.resize(num_subsets);
+    subset_obs_masks.resize(num_subsets);
+    subset_is_ambiguous.resize(num_subsets);
+    subset_weights[0] = 0;
+    subset_obs_masks[0] = 0;
+    subset_is_ambiguous[0] = 0;
+
+    // The lowest detection event of each subset is either matched to the boundary or to another event of the
+    // subset, so each matching of the subset is found exactly once. A subset is ambiguous if its minimum weight
+    // matchings can cross different observables.
+    for (size_t subset = 1; subset < num_subsets; subset++) {
+        size_t i = std::countr_zero(subset);
+        size_t rest = subset ^ ((size_t)1 << i);
+        total_weight_int best_weight = AllPairsPaths::UNREACHABLE;
+        obs_int best_obs_mask = 0;
+        bool is_ambiguous = false;
+        auto consider = [&](size_t path_index, size_t remaining) {
+            total_weight_int path_weight = paths.distances[path_index];
+            if (path_weight == AllPairsPaths::UNREACHABLE || subset_weights[remaining] == AllPairsPaths::UNREACHABLE)
+                return;
+            total_weight_int w = path_weight + subset_weights[remaining];
+            obs_int m = paths.observables[path_index] ^ subset_obs_masks[remaining];
+            bool ambiguous = paths.is_ambiguous[path_index] || subset_is_ambiguous[remaining];
+            if (w < best_weight) {
+                best_weight = w;
+                best_obs_mask = m;
+                is_ambiguous = ambiguous;
+            } else if (w == best_weight) {
+                is_ambiguous = is_ambiguous || ambiguous || m != best_obs_mask;
+            }
+        };
+        consider(paths.index_of(events[i], SIZE_MAX), rest);
+        for (size_t others = rest; others; others &= others - 1) {
+            size_t j = std::countr_zero(others);
+            consider(paths.index_of(events[i], events[j]), rest ^ ((size_t)1 << j));
+        }
+        subset_weights[subset] = best_weight;
+        subset_obs_masks[subset] = best_obs_mask;
+        subset_is_ambiguous[subset] = is_ambiguous;
+    }
+
+    size_t all = num_subsets - 1;
+    if (subset_weights[all] == AllPairsPaths::UNREACHABLE || subset_is_ambiguous[all])
+        return false;
+    obs_mask = subset_obs_masks[all];
+    weight = subset_weights[all];
+    return true;
+}
+
+bool SmallSyndromeCache::is_within_distance(
+    const MatchingGraph& graph, size_t u, size_t v, total_weight_int max_distance) {
+    if (u == v)
+        return true;
+    if (distances.size() != graph.nodes.size())
+        distances.assign(graph.nodes.size(), std::numeric_limits<total_weight_int>::max());
+
+    const DetectorNode* first_node = graph.nodes.data();
+    auto later = std::greater<std::pair<total_weight_int, size_t>>();
+    bool found = false;
+    distances[u] = 0;
+    touched_nodes.push_back(u);
+    heap.emplace_back(0, u);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        auto [dist, node_index] = heap.back();
+        heap.pop_back();
+        if (dist != distances[node_index])
+            continue;
+        if (node_index == v) {
+            found = true;
+            break;
+        }
+        const DetectorNode& node = graph.nodes[node_index];
+        for (size_t i = 0; i < node.neighbors.size(); i++) {
+            const DetectorNode* neighbor = node.neighbors[i];
+            if (neighbor == nullptr)
+                continue;
+            total_weight_int neighbor_dist = dist + node.neighbor_weights[i];
+            if (neighbor_dist > max_distance)
+                continue;
+            size_t neighbor_index = neighbor - first_node;
+            if (neighbor_dist < distances[neighbor_index]) {
+                if (distances[neighbor_index] == std::numeric_limits<total_weight_int>::max())
+                    touched_nodes.push_back(neighbor_index);
+                distances[neighbor_index] = neighbor_dist;
+                heap.emplace_back(neighbor_dist, neighbor_index);
+                std::push_heap(heap.begin(), heap.end(), later);
+            }
+        }
+    }
+
+    for (size_t node_index : touched_nodes)
+        distances[node_index] = std::numeric_limits<total_weight_int>::max();
+    touched_nodes.clear();
+    heap.clear();
+    return found;
+}
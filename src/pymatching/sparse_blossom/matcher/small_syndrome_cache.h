@@ -0,0 +1,114 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SMALL_SYNDROME_CACHE_H
+#define PYMATCHING2_SMALL_SYNDROME_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "pymatching/sparse_blossom/flooder/all_pairs_paths.h"
+#include "pymatching/sparse_blossom/flooder/boundary_distances.h"
+#include "pymatching/sparse_blossom/flooder/graph.h"
+
+namespace pm {
+
+enum BoundaryMatchState : uint8_t {
+    BOUNDARY_MATCH_UNKNOWN = 0,
+    BOUNDARY_MATCH_KNOWN = 1,
+    /// A lone detection event at the node cannot be matched, since there is no path to the boundary.
+    BOUNDARY_MATCH_UNREACHABLE = 2,
+};
+
+/// Per-decoder state used to decode syndromes with at most two detection events without running the blossom
+/// algorithm.
+///
+/// For each node, the cache holds the solution found when a lone detection event at that node is decoded (a
+/// shortest path to the boundary). These are filled lazily with the results of the full algorithm, so they
+/// include its choice between equally good paths. Two detection events u and v whose boundary distances b(u)
+/// and b(v) satisfy b(u) + b(v) < d(u, v) grow regions that never touch before both reach the boundary, so the
+/// full algorithm would match each of them to the boundary independently.
+///
+/// Optionally, the boundary distances of all nodes can be precomputed up front (see `precompute_boundary_distances').
+/// They allow syndromes that need the full algorithm to be recognised before any lone solutions are computed.
+///
+/// For small graphs, the shortest paths between all pairs of nodes can also be precomputed (see
+/// `precompute_all_pairs_paths'). Syndromes with up to `MAX_LOOKUP_DETECTION_EVENTS' detection events are then
+/// matched exactly over the complete graph of their detection events, as long as every minimum weight matching
+/// crosses the same observables (and so the full algorithm's choice between them can't matter).
+class SmallSyndromeCache {
+   public:
+    /// The most detection events matched using `all_pairs_paths'. The matching takes time exponential in this.
+    static constexpr size_t MAX_LOOKUP_DETECTION_EVENTS = 10;
+
+    std::vector<BoundaryMatchState> boundary_match_states;
+    std::vector<obs_int> boundary_match_obs_masks;
+    std::vector<total_weight_int> boundary_match_weights;
+    /// If false, every syndrome is decoded with the full algorithm.
+    bool enabled = true;
+    /// Precomputed boundary distances, or nullptr if they have not been computed. Can be shared by decoders
+    /// using the same graph.
+    std::shared_ptr<const BoundaryDistances> boundary_distances;
+    /// Precomputed shortest paths between all pairs of nodes, or nullptr if they have not been computed (or the
+    /// graph is too large). Can be shared by decoders using the same graph.
+    std::shared_ptr<const AllPairsPaths> all_pairs_paths;
+
+    SmallSyndromeCache() = default;
+    explicit SmallSyndromeCache(size_t num_nodes);
+
+    inline BoundaryMatchState state(size_t node_index) const {
+        return boundary_match_states[node_index];
+    }
+    void set_boundary_match(size_t node_index, obs_int obs_mask, total_weight_int weight);
+    void set_boundary_unreachable(size_t node_index);
+    /// Forgets all cached solutions and precomputed distances, e.g. after edge weights of the graph have changed.
+    void clear();
+    /// Forgets all cached solutions and precomputed distances, and resizes the cache for a graph with `num_nodes'
+    /// nodes.
+    void reset(size_t num_nodes);
+    /// Computes the boundary distance of every node of `graph', if they have not already been computed.
+    const BoundaryDistances& precompute_boundary_distances(const MatchingGraph& graph);
+    /// Computes the shortest paths between all pairs of nodes of `graph', if they have not already been computed
+    /// and the graph has at most AllPairsPaths::MAX_NODES nodes and at most 64 observables. Returns the paths, or
+    /// nullptr if the graph is too large.
+    const AllPairsPaths* precompute_all_pairs_paths(const MatchingGraph& graph);
+    /// Finds a minimum weight matching of the `num_events' distinct detection events at the nodes `events' (each
+    /// matched to another or to the boundary) using `all_pairs_paths', which must have been computed. Returns false
+    /// if there is no such matching, or if minimum weight matchings crossing different observables exist.
+    bool match_with_all_pairs_paths(
+        const size_t* events, size_t num_events, obs_int& obs_mask, total_weight_int& weight);
+
+    /// Returns true if the distance between nodes `u' and `v' of the graph is at most `max_distance'.
+    /// Only the part of the graph within `max_distance' of `u' is explored.
+    bool is_within_distance(const MatchingGraph& graph, size_t u, size_t v, total_weight_int max_distance);
+
+    /// The memory held by the cache, in bytes, not counting `boundary_distances' and `all_pairs_paths', which may
+    /// be shared.
+    size_t memory_bytes() const;
+
+   private:
+    /// Scratch space for `is_within_distance', kept between calls to avoid reallocating it.
+    std::vector<total_weight_int> distances;
+    std::vector<size_t> touched_nodes;
+    std::vector<std::pair<total_weight_int, size_t>> heap;
+    /// Scratch space for `match_with_all_pairs_paths', holding the solution for each subset of the detection events.
+    std::vector<total_weight_int> subset_weights;
+    std::vector<obs_int> subset_obs_masks;
+    std::vector<uint8_t> subset_is_ambiguous;
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SMALL_SYNDROME_CACHE_H
@@ -0,0 +1,110 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/matcher/syndrome_cache.h"
+
+#include <algorithm>
+
+#include "pymatching/sparse_blossom/memory_bytes.h"
+
+using namespace pm;
+
+namespace {
+
+inline uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+}  // namespace
+
+SyndromeCache::SyndromeCache(size_t capacity)
+    : num_hits(0), num_misses(0), num_occupied(0), key_hash(0), key_valid(false) {
+    set_capacity(capacity);
+}
+
+bool SyndromeCache::find(std::span<const uint64_t> detection_events, obs_int& obs_mask, total_weight_int& weight) {
+    key_valid = false;
+    if (slots.empty() || detection_events.size() > MAX_DETECTION_EVENTS)
+        return false;
+    key.assign(detection_events.begin(), detection_events.end());
+    if (!std::is_sorted(key.begin(), key.end()))
+        std::sort(key.begin(), key.end());
+    key_hash = key.size();
+    for (auto d : key)
+        key_hash = mix(key_hash ^ d) + 0x9E3779B97F4A7C15ULL;
+    key_valid = true;
+
+    auto& slot = slots[key_hash & (slots.size() - 1)];
+    if (slot.occupied && slot.hash == key_hash && slot.detection_events == key) {
+        obs_mask = slot.obs_mask;
+        weight = slot.weight;
+        num_hits++;
+        return true;
+    }
+    num_misses++;
+    return false;
+}
+
+void SyndromeCache::insert_last_found(obs_int obs_mask, total_weight_int weight) {
+    if (!key_valid)
+        return;
+    auto& slot = slots[key_hash & (slots.size() - 1)];
+    if (!slot.occupied) {
+        slot.occupied = true;
+        num_occupied++;
+    }
+    slot.hash = key_hash;
+    slot.detection_events.assign(key.begin(), key.end());
+    slot.obs_mask = obs_mask;
+    slot.weight = weight;
+    key_valid = false;
+}
+
+void SyndromeCache::set_capacity(size_t new_capacity) {
+    size_t num_slots = 0;
+    if (new_capacity > 0) {
+        num_slots = 1;
+        while (num_slots < new_capacity)
+            num_slots <<= 1;
+    }
+    slots.clear();
+    slots.shrink_to_fit();
+    slots.resize(num_slots);
+    num_occupied = 0;
+    key_valid = false;
+}
+
+void SyndromeCache::clear() {
+    for (auto& slot : slots)
+        slot.occupied = false;
+    num_occupied = 0;
+    key_valid = false;
+}
+
+void SyndromeCache::reset_counts() {
+    num_hits = 0;
+    num_misses = 0;
+}
+
+size_t SyndromeCache::memory_bytes() const {
+    size_t total = pm::memory_bytes(slots) + pm::memory_bytes(key);
+    for (const auto& slot : slots)
+        total += pm::memory_bytes(slot.detection_events);
+    return total;
+}
@@ -0,0 +1,100 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SYNDROME_CACHE_H
+#define PYMATCHING2_SYNDROME_CACHE_H
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "pymatching/sparse_blossom/ints.h"
+
+namespace pm {
+
+/// A bounded cache of the solutions of whole syndromes, keyed on their sorted detection events.
+///
+/// At low physical error rates, the same few syndromes (e.g. adjacent pairs of detection events) recur in a large
+/// fraction of the shots, so remembering their solutions skips most runs of the blossom algorithm. The cache is
+/// direct-mapped: each syndrome has a single slot, chosen by its hash, and storing a syndrome simply overwrites
+/// whatever was in its slot, so eviction costs nothing. A cache belongs to a single decoder, so decoders used by
+/// different threads each have their own cache and need no locking. The solutions depend on the edge weights, so
+/// the cache must be cleared whenever the graph is modified.
+class SyndromeCache {
+   public:
+    /// Syndromes with more detection events than this are rarely repeated, so are never cached.
+    static constexpr size_t MAX_DETECTION_EVENTS = 16;
+
+    /// The number of lookups that found, and didn't find, a cached solution.
+    uint64_t num_hits;
+    uint64_t num_misses;
+
+    /// Creates a cache holding up to `capacity' syndromes (rounded up to a power of two). A capacity of zero
+    /// disables the cache.
+    explicit SyndromeCache(size_t capacity = 0);
+
+    /// Looks up the solution of the syndrome with detection events `detection_events' (in any order), setting
+    /// `obs_mask' and `weight' and returning true if it is cached. Counts a hit or a miss, unless the cache is
+    /// disabled or the syndrome is too large to be cached.
+    bool find(std::span<const uint64_t> detection_events, obs_int& obs_mask, total_weight_int& weight);
+    bool find(const std::vector<uint64_t>& detection_events, obs_int& obs_mask, total_weight_int& weight);
+    /// Stores the solution of the syndrome most recently given to `find', if it could be cached.
+    void insert_last_found(obs_int obs_mask, total_weight_int weight);
+
+    /// Sets the maximum number of syndromes stored (rounded up to a power of two), forgetting all cached solutions.
+    /// A capacity of zero disables the cache.
+    void set_capacity(size_t new_capacity);
+    size_t capacity() const;
+    /// The number of syndromes currently cached.
+    size_t size() const;
+    /// Forgets all cached solutions, keeping the hit and miss counts.
+    void clear();
+    void reset_counts();
+    /// The memory held by the cache, in bytes.
+    size_t memory_bytes() const;
+
+   private:
+    struct Slot {
+        uint64_t hash = 0;
+        bool occupied = false;
+        std::vector<uint64_t> detection_events;
+        obs_int obs_mask = 0;
+        total_weight_int weight = 0;
+    };
+
+    std::vector<Slot> slots;
+    size_t num_occupied;
+    /// The sorted detection events and hash of the syndrome most recently given to `find', and whether it can be
+    /// cached. Kept between calls to avoid reallocating it.
+    std::vector<uint64_t> key;
+    uint64_t key_hash;
+    bool key_valid;
+};
+
+inline bool SyndromeCache::find(
+    const std::vector<uint64_t>& detection_events, obs_int& obs_mask, total_weight_int& weight) {
+    return find(std::span<const uint64_t>(detection_events), obs_mask, weight);
+}
+
+inline size_t SyndromeCache::capacity() const {
+    return slots.size();
+}
+
+inline size_t SyndromeCache::size() const {
+    return num_occupied;
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SYNDROME_CACHE_H
@@ -0,0 +1,71 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/matcher/syndrome_cache.h"
+
+#include "gtest/gtest.h"
+
+TEST(SyndromeCache, FindsInsertedSyndromesInAnyOrder) {
+    pm::SyndromeCache cache(100);
+    ASSERT_EQ(cache.capacity(), 128);
+    pm::obs_int obs_mask = 0;
+    pm::total_weight_int weight = 0;
+    ASSERT_FALSE(cache.find({3, 1, 2}, obs_mask, weight));
+    cache.insert_last_found(5, 40);
+    ASSERT_EQ(cache.size(), 1);
+    ASSERT_TRUE(cache.find({1, 2, 3}, obs_mask, weight));
+    ASSERT_EQ(obs_mask, 5);
+    ASSERT_EQ(weight, 40);
+    ASSERT_FALSE(cache.find({1, 2}, obs_mask, weight));
+    ASSERT_FALSE(cache.find({1, 2, 3, 3}, obs_mask, weight));
+    ASSERT_EQ(cache.num_hits, 1);
+    ASSERT_EQ(cache.num_misses, 3);
+
+    // Syndromes that are too large are neither looked up nor stored.
+    std::vector<uint64_t> large_syndrome;
+    for (size_t k = 0; k <= pm::SyndromeCache::MAX_DETECTION_EVENTS; k++)
+        large_syndrome.push_back(k);
+    ASSERT_FALSE(cache.find(large_syndrome, obs_mask, weight));
+    cache.insert_last_found(1, 1);
+    ASSERT_EQ(cache.size(), 1);
+    ASSERT_EQ(cache.num_misses, 3);
+
+    cache.clear();
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_FALSE(cache.find({1, 2, 3}, obs_mask, weight));
+    cache.reset_counts();
+    ASSERT_EQ(cache.num_hits, 0);
+    ASSERT_EQ(cache.num_misses, 0);
+}
+
+TEST(SyndromeCache, OverwritesSlotsWhenFull) {
+    pm::SyndromeCache cache(1);
+    pm::obs_int obs_mask = 0;
+    pm::total_weight_int weight = 0;
+    ASSERT_FALSE(cache.find({0, 1}, obs_mask, weight));
+    cache.insert_last_found(1, 10);
+    ASSERT_FALSE(cache.find({4, 7}, obs_mask, weight));
+    cache.insert_last_found(2, 20);
+    ASSERT_EQ(cache.size(), 1);
+    ASSERT_FALSE(cache.find({0, 1}, obs_mask, weight));
+    ASSERT_TRUE(cache.find({4, 7}, obs_mask, weight));
+    ASSERT_EQ(weight, 20);
+
+    pm::SyndromeCache disabled;
+    ASSERT_EQ(disabled.capacity(), 0);
+    ASSERT_FALSE(disabled.find({0, 1}, obs_mask, weight));
+    disabled.insert_last_found(1, 10);
+    ASSERT_EQ(disabled.size(), 0);
+    ASSERT_EQ(disabled.num_misses, 0);
+}
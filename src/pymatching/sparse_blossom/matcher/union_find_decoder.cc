@@ -0,0 +1,346 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/matcher/union_find_decoder.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "pymatching/sparse_blossom/memory_bytes.h"
+
+using namespace pm;
+
+namespace {
+
+/// The index of the other end of the `k'th edge of node `u', or BOUNDARY_NEIGHBOR_INDEX for a boundary edge.
+inline uint32_t neighbor_of(const MatchingGraph& graph, uint32_t u, size_t k) {
+    DetectorNode* neighbor = graph.nodes[u].neighbors[k];
+    return neighbor == nullptr ? BOUNDARY_NEIGHBOR_INDEX : (uint32_t)(neighbor - graph.nodes.data());
+}
+
+void throw_no_perfect_matching() {
+    throw std::invalid_argument(
+        "No perfect matching could be found. This likely means that the syndrome has odd "
+        "parity in the support of a connected component without a boundary.");
+}
+
+}  // namespace
+
+DecoderEngine pm::decoder_engine_from_string(const std::string& name) {
+    if (name == "sparse_blossom")
+        return SPARSE_BLOSSOM;
+    if (name == "union_find" || name == "uf")
+        return UNION_FIND;
+    throw std::invalid_argument(
+        "Decoder \"" + name + "\" not recognised. Expected \"sparse_blossom\" or \"union_find\" (\"uf\").");
+}
+
+std::string pm::decoder_engine_name(DecoderEngine engine) {
+    return engine == UNION_FIND ? "union_find" : "sparse_blossom";
+}
+
+UnionFindDecoder::UnionFindDecoder() : correction_weight(0), num_clusters(0) {
+}
+
+size_t UnionFindDecoder::memory_bytes() const {
+    size_t total = pm::memory_bytes(correction) + pm::memory_bytes(edge_offsets) + pm::memory_bytes(reverse_edge) +
+                   pm::memory_bytes(growth) + pm::memory_bytes(nodes) + pm::memory_bytes(clusters) +
+                   pm::memory_bytes(touched_nodes) + pm::memory_bytes(active_clusters) +
+                   pm::memory_bytes(fully_grown_edges) + pm::memory_bytes(peel_order);
+    for (const auto& cluster : clusters)
+        total += pm::memory_bytes(cluster.frontier);
+    return total;
+}
+
+void UnionFindDecoder::bind(const MatchingGraph& graph) {
+    if (bound_topology == graph.topology && nodes.size() == graph.nodes.size())
+        return;
+    size_t num_nodes = graph.nodes.size();
+    edge_offsets.assign(num_nodes + 1, 0);
+    for (size_t u = 0; u < num_nodes; u++)
+        edge_offsets[u + 1] = edge_offsets[u] + graph.nodes[u].neighbors.size();
+    reverse_edge.assign(edge_offsets[num_nodes], SIZE_MAX);
+    for (size_t u = 0; u < num_nodes; u++) {
+        const auto& neighbors = graph.nodes[u].neighbors;
+        for (size_t k = 0; k < neighbors.size(); k++) {
+            uint32_t v = neighbor_of(graph, (uint32_t)u, k);
+            if (v == BOUNDARY_NEIGHBOR_INDEX)
+                continue;
+            const auto& back = graph.nodes[v].neighbors;
+            for (size_t j = 0; j < back.size(); j++) {
+                if (neighbor_of(graph, v, j) == u) {
+                    reverse_edge[edge_offsets[u] + k] = edge_offsets[v] + j;
+                    break;
+                }
+            }
+        }
+    }
+    growth.assign(edge_offsets[num_nodes], 0);
+    nodes.assign(num_nodes, Node());
+    touched_nodes.clear();
+    // The frontiers of the previous shot hold nodes of the previous graph.
+    for (auto& cluster : clusters)
+        cluster.frontier.clear();
+    num_clusters = 0;
+    bound_topology = graph.topology;
+}
+
+uint32_t UnionFindDecoder::find(uint32_t node) {
+    while (nodes[node].parent != node) {
+        nodes[node].parent = nodes[nodes[node].parent].parent;
+        node = nodes[node].parent;
+    }
+    return node;
+}
+
+void UnionFindDecoder::add_to_cluster(uint32_t node, uint32_t root) {
+    nodes[node].parent = root;
+    touched_nodes.push_back(node);
+    clusters[nodes[root].cluster].frontier.push_back(node);
+}
+
+void UnionFindDecoder::merge(uint32_t root1, uint32_t root2) {
+    if (root1 == root2)
+        return;
+    Cluster* c1 = &clusters[nodes[root1].cluster];
+    Cluster* c2 = &clusters[nodes[root2].cluster];
+    // The cluster with the smaller frontier joins the other, so each node is copied to a new frontier O(log n) times.
+    if (c1->frontier.size() < c2->frontier.size()) {
+        std::swap(root1, root2);
+        std::swap(c1, c2);
+    }
+    nodes[root2].parent = root1;
+    c1->frontier.insert(c1->frontier.end(), c2->frontier.begin(), c2->frontier.end());
+    c2->frontier.clear();
+    c1->odd ^= c2->odd;
+    c1->has_boundary |= c2->has_boundary;
+}
+
+void UnionFindDecoder::grow(const MatchingGraph& graph) {
+    // The distance left to grow along edge e (the k'th edge of node u) before it is fully grown.
+    auto remaining = [&](uint32_t u, size_t k, size_t e) {
+        uint64_t grown = growth[e];
+        if (reverse_edge[e] != SIZE_MAX)
+            grown += growth[reverse_edge[e]];
+        weight_int w = graph.nodes[u].neighbor_weights[k];
+        return grown >= w ? (weight_int)0 : (weight_int)(w - grown);
+    };
+    // Whether an edge from a node of the cluster rooted at `root' to `v' still needs growing. Edges to the boundary
+    // are only grown by clusters that haven't reached it yet, so they always do.
+    auto leaves_cluster = [&](uint32_t root, uint32_t v) {
+        return v == BOUNDARY_NEIGHBOR_INDEX || nodes[v].parent == NONE || find(v) != root;
+    };
+
+    while (true) {
+        active_clusters.clear();
+        for (uint32_t c = 0; c < num_clusters; c++) {
+            Cluster& cluster = clusters[c];
+            cluster.active = nodes[cluster.root].parent == cluster.root && cluster.odd && !cluster.has_boundary;
+            if (cluster.active)
+                active_clusters.push_back(c);
+        }
+        if (active_clusters.empty())
+            return;
+
+        // Find how far the active clusters can grow before the next edge is fully grown. An edge between two active
+        // clusters is grown from both ends at once. Nodes with no edges left to grow are dropped from the frontiers.
+        uint64_t delta = UINT64_MAX;
+        for (uint32_t c : active_clusters) {
+            Cluster& cluster = clusters[c];
+            size_t num_kept = 0;
+            for (uint32_t u : cluster.frontier) {
+                bool has_edges_to_grow = false;
+                size_t num_edges = graph.nodes[u].neighbors.size();
+                for (size_t k = 0; k < num_edges; k++) {
+                    uint32_t v = neighbor_of(graph, u, k);
+                    if (!leaves_cluster(cluster.root, v))
+                        continue;
+                    has_edges_to_grow = true;
+                    uint64_t rate = 1;
+                    if (v != BOUNDARY_NEIGHBOR_INDEX && nodes[v].parent != NONE &&
+                        clusters[nodes[find(v)].cluster].active)
+                        rate = 2;
+                    uint64_t left = remaining(u, k, edge_offsets[u] + k);
+                    delta = std::min(delta, (left + rate - 1) / rate);
+                }
+                if (has_edges_to_grow)
+                    cluster.frontier[num_kept++] = u;
+            }
+            cluster.frontier.resize(num_kept);
+        }
+        if (delta == UINT64_MAX)
+            throw_no_perfect_matching();
+
+        for (uint32_t c : active_clusters) {
+            Cluster& cluster = clusters[c];
+            for (uint32_t u : cluster.frontier) {
+                size_t num_edges = graph.nodes[u].neighbors.size();
+                for (size_t k = 0; k < num_edges; k++) {
+                    uint32_t v = neighbor_of(graph, u, k);
+                    if (!leaves_cluster(cluster.root, v))
+                        continue;
+                    size_t e = edge_offsets[u] + k;
+                    weight_int left = remaining(u, k, e);
+                    weight_int step = (weight_int)std::min<uint64_t>(delta, left);
+                    growth[e] += step;
+                    if (step == left)
+                        fully_grown_edges.push_back({u, (uint32_t)k});
+                }
+            }
+        }
+
+        for (auto [u, k] : fully_grown_edges) {
+            uint32_t v = neighbor_of(graph, u, k);
+            uint32_t root = find(u);
+            if (v == BOUNDARY_NEIGHBOR_INDEX) {
+                clusters[nodes[root].cluster].has_boundary = true;
+            } else if (nodes[v].parent == NONE) {
+                add_to_cluster(v, root);
+            } else {
+                merge(root, find(v));
+            }
+        }
+        fully_grown_edges.clear();
+    }
+}
+
+void UnionFindDecoder::peel(const MatchingGraph& graph) {
+    auto is_fully_grown = [&](uint32_t u, size_t k) {
+        size_t e = edge_offsets[u] + k;
+        uint64_t grown = growth[e];
+        if (reverse_edge[e] != SIZE_MAX)
+            grown += growth[reverse_edge[e]];
+        return grown >= graph.nodes[u].neighbor_weights[k];
+    };
+
+    // Build a spanning forest of the fully grown edges, breadth first. The trees of clusters that reached the
+    // boundary hang from their fully grown boundary edges, and those of the other (even) clusters from any node.
+    peel_order.clear();
+    for (uint32_t u : touched_nodes) {
+        size_t num_edges = graph.nodes[u].neighbors.size();
+        for (size_t k = 0; k < num_edges; k++) {
+            if (neighbor_of(graph, u, k) == BOUNDARY_NEIGHBOR_INDEX && is_fully_grown(u, k)) {
+                nodes[u].visited = true;
+                nodes[u].from_boundary = true;
+                nodes[u].tree_edge = {u, (uint32_t)k};
+                peel_order.push_back(u);
+                break;
+            }
+        }
+    }
+    size_t next_root = 0;
+    size_t head = 0;
+    while (true) {
+        while (head < peel_order.size()) {
+            uint32_t u = peel_order[head++];
+            size_t num_edges = graph.nodes[u].neighbors.size();
+            for (size_t k = 0; k < num_edges; k++) {
+                uint32_t v = neighbor_of(graph, u, k);
+                if (v == BOUNDARY_NEIGHBOR_INDEX || nodes[v].parent == NONE || nodes[v].visited ||
+                    !is_fully_grown(u, k))
+                    continue;
+                nodes[v].visited = true;
+                nodes[v].tree_parent = u;
+                nodes[v].tree_edge = {u, (uint32_t)k};
+                peel_order.push_back(v);
+            }
+        }
+        while (next_root < touched_nodes.size() && nodes[touched_nodes[next_root]].visited)
+            next_root++;
+        if (next_root == touched_nodes.size())
+            break;
+        nodes[touched_nodes[next_root]].visited = true;
+        peel_order.push_back(touched_nodes[next_root]);
+    }
+
+    // Peel the forest from the leaves inwards, flipping the edge from each node with a detection event to its parent.
+    for (size_t i = peel_order.size(); i-- > 0;) {
+        Node& node = nodes[peel_order[i]];
+        if (!node.defect)
+            continue;
+        if (!node.from_boundary && node.tree_parent == NONE)
+            throw_no_perfect_matching();
+        correction.push_back(node.tree_edge);
+        correction_weight += graph.nodes[node.tree_edge.node].neighbor_weights[node.tree_edge.k];
+        node.defect = false;
+        if (!node.from_boundary)
+            nodes[node.tree_parent].defect ^= true;
+    }
+}
+
+void UnionFindDecoder::reset() {
+    for (uint32_t u : touched_nodes) {
+        nodes[u] = Node();
+        std::fill(growth.begin() + edge_offsets[u], growth.begin() + edge_offsets[u + 1], 0);
+    }
+    touched_nodes.clear();
+    for (size_t c = 0; c < num_clusters; c++)
+        clusters[c].frontier.clear();
+    num_clusters = 0;
+}
+
+void UnionFindDecoder::decode(const MatchingGraph& graph, std::span<const uint64_t> detection_events) {
+    bind(graph);
+    // The state of the previous shot is only cleared now, so that it is also cleared after a shot that failed.
+    reset();
+    correction.clear();
+    correction_weight = 0;
+    for (uint64_t detection : detection_events) {
+        if (detection >= nodes.size())
+            throw std::invalid_argument(
+                "The detection event with index " + std::to_string(detection) +
+                " does not correspond to a node in the graph, which only has " + std::to_string(nodes.size()) +
+                " nodes.");
+        if (detection < graph.is_user_graph_boundary_node.size() && graph.is_user_graph_boundary_node[detection])
+            continue;
+        uint32_t u = (uint32_t)detection;
+        if (nodes[u].parent == NONE) {
+            if (num_clusters == clusters.size())
+                clusters.emplace_back();
+            Cluster& cluster = clusters[num_clusters];
+            cluster.root = u;
+            cluster.odd = false;
+            cluster.has_boundary = false;
+            cluster.active = false;
+            nodes[u].cluster = (uint32_t)num_clusters++;
+            nodes[u].parent = u;
+            touched_nodes.push_back(u);
+            cluster.frontier.push_back(u);
+        }
+        nodes[u].defect ^= true;
+        clusters[nodes[u].cluster].odd ^= true;
+    }
+    grow(graph);
+    peel(graph);
+}
+
+obs_int UnionFindDecoder::correction_obs_mask(const MatchingGraph& graph) const {
+    obs_int obs_mask = 0;
+    for (auto [u, k] : correction)
+        obs_mask ^= graph.nodes[u].neighbor_observables[k];
+    return obs_mask;
+}
+
+void UnionFindDecoder::xor_correction_observables(const MatchingGraph& graph, uint8_t* obs_begin_ptr) const {
+    if (graph.topology->has_observable_indices) {
+        for (auto [u, k] : correction) {
+            for (size_t obs : graph.topology->observable_indices_of(u, k))
+                obs_begin_ptr[obs] ^= 1;
+        }
+        return;
+    }
+    obs_int obs_mask = correction_obs_mask(graph);
+    for (size_t i = 0; i < graph.num_observables; i++)
+        obs_begin_ptr[i] ^= obs_int_bit(obs_mask, i);
+}
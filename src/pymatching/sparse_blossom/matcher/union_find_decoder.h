@@ -0,0 +1,146 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_UNION_FIND_DECODER_H
+#define PYMATCHING2_UNION_FIND_DECODER_H
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "pymatching/sparse_blossom/flooder/graph.h"
+
+namespace pm {
+
+/// The algorithm a Mwpm uses to decode a shot (see `Mwpm::set_decoder_engine').
+enum DecoderEngine : uint8_t {
+    /// Exact minimum weight perfect matching, with the sparse blossom algorithm.
+    SPARSE_BLOSSOM = 0,
+    /// The weighted Union-Find decoder (see `UnionFindDecoder'), which is faster but less accurate.
+    UNION_FIND = 1,
+};
+
+/// Parses "sparse_blossom", or "union_find" (or "uf"). Throws std::invalid_argument for any other name.
+DecoderEngine decoder_engine_from_string(const std::string& name);
+std::string decoder_engine_name(DecoderEngine engine);
+
+/// An edge of a MatchingGraph: the `k'th edge of node `node' (so its other end is `graph.nodes[node].neighbors[k]').
+struct UnionFindEdge {
+    node_index_int node;
+    uint32_t k;
+};
+
+/// Per-decoder state of the weighted Union-Find decoder of Delfosse and Nickerson, run over the edges of a
+/// MatchingGraph (its `neighbor_weights' and `neighbor_observables').
+///
+/// Each detection event starts a cluster. Clusters with an odd number of detection events that haven't reached the
+/// boundary grow along every edge leaving them, all at the same rate, and an edge that has been grown along its whole
+/// weight (from one or both ends) joins the clusters at its ends, or joins a cluster to the boundary. Rather than
+/// growing in unit steps, each round grows the clusters by the distance to the next edge to be fully grown. Once
+/// every cluster is even or touches the boundary, a spanning forest of the fully grown edges of each cluster is
+/// peeled from the leaves inwards, flipping the edge from each node with a detection event to its parent. The
+/// clusters are merged with a union-find forest (the smaller frontier into the larger, with path halving), so a shot
+/// costs time almost linear in the size of the clusters, which unlike in the blossom algorithm are never revisited
+/// once grown. The correction is not always of minimum weight.
+///
+/// Only the nodes reached by a shot are visited, and reset once it has been decoded, so the cost of a shot doesn't
+/// depend on the size of the graph. The state is bound to the topology of the graph it last decoded, and is rebuilt
+/// (in time linear in the number of edges) if a shot is decoded on a graph with a different topology.
+class UnionFindDecoder {
+   public:
+    /// The edges of the correction found for the last shot decoded, and their total weight.
+    std::vector<UnionFindEdge> correction;
+    total_weight_int correction_weight;
+
+    UnionFindDecoder();
+
+    /// Finds a correction for `detection_events' (indices of nodes of `graph', in any order) and stores it in
+    /// `correction'. Detection events on boundary nodes of the UserGraph the graph was built from are ignored, and a
+    /// repeated detection event cancels itself out. The negative weight edges of the graph are not accounted for, so
+    /// the caller should merge the detection events with those of the negative weight edges first, as for the blossom
+    /// algorithm. Throws std::invalid_argument if a detection event isn't a node of the graph, or if some cluster
+    /// can't be made even (a connected component without a boundary has an odd number of detection events), in which
+    /// case the decoder can still be used for other shots.
+    void decode(const MatchingGraph& graph, std::span<const uint64_t> detection_events);
+    /// The observables crossed by the edges of `correction', as a bit mask. The topology of `graph' must not
+    /// `has_observable_indices'.
+    obs_int correction_obs_mask(const MatchingGraph& graph) const;
+    /// XORs the observables crossed by the edges of `correction' into `obs_begin_ptr', which has an element for each
+    /// observable of `graph'.
+    void xor_correction_observables(const MatchingGraph& graph, uint8_t* obs_begin_ptr) const;
+    /// The memory held by the decoder, in bytes.
+    size_t memory_bytes() const;
+
+   private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Node {
+        /// The parent of the node in the union-find forest, itself for the root of a cluster, or NONE if the node
+        /// isn't in a cluster.
+        uint32_t parent = NONE;
+        /// For the root of a cluster, its index in `clusters'.
+        uint32_t cluster = NONE;
+        /// Whether the node has a detection event that hasn't yet been peeled.
+        bool defect = false;
+        bool visited = false;
+        /// Whether the node hangs from the boundary in the spanning forest. Otherwise, the node it hangs from (or
+        /// NONE for the root of a tree).
+        bool from_boundary = false;
+        uint32_t tree_parent = NONE;
+        /// The edge from the node (or its parent) that the node hangs from.
+        UnionFindEdge tree_edge{0, 0};
+    };
+    struct Cluster {
+        /// The nodes of the cluster that may still have edges to grow.
+        std::vector<uint32_t> frontier;
+        uint32_t root;
+        bool odd;
+        bool has_boundary;
+        bool active;
+    };
+
+    /// The topology the edge indices below were built for, kept alive so that it can't be confused with another.
+    std::shared_ptr<MatchingGraphTopology> bound_topology;
+    /// The edges of node i are [edge_offsets[i], edge_offsets[i + 1]) in `growth' and `reverse_edge'.
+    std::vector<size_t> edge_offsets;
+    /// The index of the same edge seen from its other node, or SIZE_MAX for a boundary edge.
+    std::vector<size_t> reverse_edge;
+    /// How far each edge has been grown from its node. An edge is fully grown once the growth from both of its
+    /// nodes adds up to its weight.
+    std::vector<weight_int> growth;
+    std::vector<Node> nodes;
+    /// The clusters of the current shot. Those merged into another are left with an empty frontier, and are recycled
+    /// (keeping their memory) by later shots.
+    std::vector<Cluster> clusters;
+    size_t num_clusters;
+    /// Scratch space, kept between shots to avoid reallocating it.
+    std::vector<uint32_t> touched_nodes;
+    std::vector<uint32_t> active_clusters;
+    std::vector<UnionFindEdge> fully_grown_edges;
+    std::vector<uint32_t> peel_order;
+
+    void bind(const MatchingGraph& graph);
+    uint32_t find(uint32_t node);
+    void add_to_cluster(uint32_t node, uint32_t root);
+    void merge(uint32_t root1, uint32_t root2);
+    void grow(const MatchingGraph& graph);
+    void peel(const MatchingGraph& graph);
+    void reset();
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_UNION_FIND_DECODER_H
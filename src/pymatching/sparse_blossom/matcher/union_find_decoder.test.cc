@@ -0,0 +1,114 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/matcher/union_find_decoder.h"
+
+#include <gtest/gtest.h>
+
+#include "pymatching/sparse_blossom/flooder/graph.h"
+
+using namespace pm;
+
+namespace {
+
+/// A repetition code: a line of `num_nodes' nodes, with a boundary edge at each end. Edge i crosses observable i.
+MatchingGraph line_graph(size_t num_nodes, signed_weight_int weight) {
+    MatchingGraph g(num_nodes, num_nodes + 1);
+    g.add_boundary_edge(0, weight, {0});
+    for (size_t i = 0; i + 1 < num_nodes; i++)
+        g.add_edge(i, i + 1, weight, {i + 1});
+    g.add_boundary_edge(num_nodes - 1, weight, {num_nodes});
+    return g;
+}
+
+}  // namespace
+
+TEST(UnionFindDecoder, DecoderEngineNames) {
+    ASSERT_EQ(decoder_engine_from_string("sparse_blossom"), SPARSE_BLOSSOM);
+    ASSERT_EQ(decoder_engine_from_string("union_find"), UNION_FIND);
+    ASSERT_EQ(decoder_engine_from_string("uf"), UNION_FIND);
+    ASSERT_THROW(decoder_engine_from_string("blossom"), std::invalid_argument);
+    ASSERT_EQ(decoder_engine_name(SPARSE_BLOSSOM), "sparse_blossom");
+    ASSERT_EQ(decoder_engine_name(UNION_FIND), "union_find");
+}
+
+TEST(UnionFindDecoder, MatchesPairsAndBoundaryOnLine) {
+    auto g = line_graph(10, 2);
+    UnionFindDecoder uf;
+
+    uf.decode(g, std::vector<uint64_t>{});
+    ASSERT_TRUE(uf.correction.empty());
+    ASSERT_EQ(uf.correction_weight, 0);
+
+    uf.decode(g, std::vector<uint64_t>{3, 4});
+    ASSERT_EQ(uf.correction_obs_mask(g), (obs_int)1 << 4);
+    ASSERT_EQ(uf.correction_weight, 2);
+
+    uf.decode(g, std::vector<uint64_t>{0});
+    ASSERT_EQ(uf.correction_obs_mask(g), (obs_int)1);
+    ASSERT_EQ(uf.correction_weight, 2);
+
+    uf.decode(g, std::vector<uint64_t>{8, 9});
+    ASSERT_EQ(uf.correction_obs_mask(g), (obs_int)1 << 9);
+
+    uf.decode(g, std::vector<uint64_t>{1, 8});
+    ASSERT_EQ(uf.correction_obs_mask(g), (obs_int)1 << 0 ^ (obs_int)1 << 1 ^ (obs_int)1 << 9 ^ (obs_int)1 << 10);
+    ASSERT_EQ(uf.correction_weight, 8);
+
+    std::vector<uint8_t> obs(11, 0);
+    uf.xor_correction_observables(g, obs.data());
+    ASSERT_EQ(obs, std::vector<uint8_t>({1, 1, 0, 0, 0, 0, 0, 0, 0, 1, 1}));
+}
+
+TEST(UnionFindDecoder, RepeatedDetectionEventCancels) {
+    auto g = line_graph(6, 2);
+    UnionFindDecoder uf;
+    uf.decode(g, std::vector<uint64_t>{2, 2});
+    ASSERT_TRUE(uf.correction.empty());
+    uf.decode(g, std::vector<uint64_t>{2, 3, 2});
+    ASSERT_EQ(uf.correction_obs_mask(g), (obs_int)1 << 4 ^ (obs_int)1 << 5 ^ (obs_int)1 << 6);
+}
+
+TEST(UnionFindDecoder, UsableAfterFailedDecode) {
+    size_t num_nodes = 5;
+    MatchingGraph g(num_nodes, num_nodes);
+    for (size_t i = 0; i < num_nodes; i++)
+        g.add_edge(i, (i + 1) % num_nodes, 2, {i});
+    UnionFindDecoder uf;
+
+    uf.decode(g, std::vector<uint64_t>{0, 2});
+    auto expected = uf.correction_obs_mask(g);
+    ASSERT_EQ(expected, (obs_int)0b11);
+
+    // No perfect matching.
+    EXPECT_THROW(uf.decode(g, std::vector<uint64_t>{0, 2, 3}), std::invalid_argument);
+    uf.decode(g, std::vector<uint64_t>{0, 2});
+    ASSERT_EQ(uf.correction_obs_mask(g), expected);
+    // A detection event that is not in the graph.
+    EXPECT_THROW(uf.decode(g, std::vector<uint64_t>{0, 2, 7}), std::invalid_argument);
+    uf.decode(g, std::vector<uint64_t>{0, 2});
+    ASSERT_EQ(uf.correction_obs_mask(g), expected);
+}
+
+TEST(UnionFindDecoder, RebindsToNewGraph) {
+    auto g1 = line_graph(4, 2);
+    auto g2 = line_graph(12, 2);
+    UnionFindDecoder uf;
+    uf.decode(g1, std::vector<uint64_t>{1, 2});
+    ASSERT_EQ(uf.correction_obs_mask(g1), (obs_int)1 << 2);
+    uf.decode(g2, std::vector<uint64_t>{10, 11});
+    ASSERT_EQ(uf.correction_obs_mask(g2), (obs_int)1 << 11);
+    uf.decode(g1, std::vector<uint64_t>{3});
+    ASSERT_EQ(uf.correction_obs_mask(g1), (obs_int)1 << 4);
+}
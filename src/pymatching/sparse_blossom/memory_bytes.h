@@ -0,0 +1,53 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_MEMORY_BYTES_H
+#define PYMATCHING2_MEMORY_BYTES_H
+
+#include <cstddef>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace pm {
+
+/// Estimates of the heap memory held by standard containers, for reporting memory usage (see `Mwpm::memory_usage').
+/// They count the memory allocated for the elements themselves, and not memory that the elements own in turn.
+
+template <typename T, typename Allocator>
+inline size_t memory_bytes(const std::vector<T, Allocator>& values) {
+    return values.capacity() * sizeof(T);
+}
+
+inline size_t memory_bytes(const std::vector<bool>& values) {
+    return values.capacity() / 8;
+}
+
+/// A node of a red-black tree holds its value, three pointers and its color.
+template <typename T>
+inline size_t memory_bytes(const std::set<T>& values) {
+    return values.size() * (sizeof(T) + 4 * sizeof(void*));
+}
+
+/// A hash table has a pointer per bucket, and a node per value holding it, a link and its hash.
+template <typename Key, typename T, typename Hash, typename Equal, typename Allocator>
+inline size_t memory_bytes(const std::unordered_map<Key, T, Hash, Equal, Allocator>& values) {
+    return values.bucket_count() * sizeof(void*) +
+           values.size() * (sizeof(typename std::unordered_map<Key, T, Hash, Equal, Allocator>::value_type) +
+                            2 * sizeof(void*));
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_MEMORY_BYTES_H
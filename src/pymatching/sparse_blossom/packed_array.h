@@ -0,0 +1,168 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_PACKED_ARRAY_H
+#define PYMATCHING2_PACKED_ARRAY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+
+#include "pymatching/sparse_blossom/page_allocator.h"
+
+namespace pm {
+
+/// A read-mostly array of trivially copyable values, which either owns its storage (a PagedVector) or is a read-only
+/// view of memory owned by something else, such as a graph file mapped into memory by several processes at once.
+///
+/// Reading is the same in both cases, and only ever gives const access, so that reading a view never copies it.
+/// The methods that modify the array first copy a view into storage of its own ("copy on write"), leaving the memory
+/// it viewed untouched.
+template <typename T>
+class PackedArray {
+   public:
+    typedef T value_type;
+    typedef const T* const_iterator;
+    typedef const T* iterator;
+
+    PackedArray() : view_data(nullptr), view_size(0) {
+    }
+    explicit PackedArray(HugePagePolicy huge_pages)
+        : owned(PageAllocator<T>(huge_pages)), view_data(nullptr), view_size(0) {
+    }
+    PackedArray(std::initializer_list<T> values) : owned(values), view_data(nullptr), view_size(0) {
+    }
+
+    /// A view of the `size' values at `data', which are kept alive (and must not change) for as long as `owner' is.
+    static PackedArray view(const T* data, size_t size, std::shared_ptr<const void> owner) {
+        PackedArray result;
+        result.view_data = data;
+        result.view_size = size;
+        result.view_owner = std::move(owner);
+        return result;
+    }
+
+    inline bool is_view() const {
+        return view_owner != nullptr;
+    }
+    /// The policy of the owned storage, or NONE for a view.
+    inline HugePagePolicy huge_page_policy() const {
+        return owned.get_allocator().policy;
+    }
+
+    /// The memory allocated for the values of an owned array, in bytes, or zero for a view.
+    inline size_t owned_bytes() const {
+        return is_view() ? 0 : owned.capacity() * sizeof(T);
+    }
+    /// The size of the memory viewed by a view, in bytes, or zero for an owned array.
+    inline size_t viewed_bytes() const {
+        return is_view() ? view_size * sizeof(T) : 0;
+    }
+
+    inline const T* data() const {
+        return is_view() ? view_data : owned.data();
+    }
+    inline size_t size() const {
+        return is_view() ? view_size : owned.size();
+    }
+    inline bool empty() const {
+        return size() == 0;
+    }
+    inline const T& operator[](size_t k) const {
+        return data()[k];
+    }
+    inline const T* begin() const {
+        return data();
+    }
+    inline const T* end() const {
+        return data() + size();
+    }
+    inline const T& front() const {
+        return data()[0];
+    }
+    inline const T& back() const {
+        return data()[size() - 1];
+    }
+
+    /// The values, for writing in place. Copies a view first.
+    T* mutable_data() {
+        make_owned();
+        return owned.data();
+    }
+    void push_back(const T& value) {
+        make_owned();
+        owned.push_back(value);
+    }
+    void reserve(size_t n) {
+        make_owned();
+        owned.reserve(n);
+    }
+    void resize(size_t n) {
+        make_owned();
+        owned.resize(n);
+    }
+    void clear() {
+        make_owned();
+        owned.clear();
+    }
+    void assign(size_t n, const T& value) {
+        make_owned();
+        owned.assign(n, value);
+    }
+    template <typename Iterator>
+    void assign(Iterator first, Iterator last) {
+        // The source may be this array itself, if it is a view.
+        PagedVector<T> values(first, last, owned.get_allocator());
+        view_owner.reset();
+        owned = std::move(values);
+    }
+    void insert(const T* position, const T& value) {
+        size_t k = position - begin();
+        make_owned();
+        owned.insert(owned.begin() + k, value);
+    }
+    template <typename Iterator>
+    void insert(const T* position, Iterator first, Iterator last) {
+        size_t k = position - begin();
+        make_owned();
+        owned.insert(owned.begin() + k, first, last);
+    }
+
+    bool operator==(const PackedArray& other) const {
+        return std::equal(begin(), end(), other.begin(), other.end());
+    }
+    bool operator!=(const PackedArray& other) const {
+        return !(*this == other);
+    }
+
+   private:
+    PagedVector<T> owned;
+    const T* view_data;
+    size_t view_size;
+    std::shared_ptr<const void> view_owner;
+
+    void make_owned() {
+        if (!is_view())
+            return;
+        owned.assign(view_data, view_data + view_size);
+        view_owner.reset();
+        view_data = nullptr;
+        view_size = 0;
+    }
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_PACKED_ARRAY_H
@@ -0,0 +1,68 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/packed_array.h"
+
+#include <gtest/gtest.h>
+#include <vector>
+
+TEST(PackedArray, OwnedArrayBehavesLikeAVector) {
+    pm::PackedArray<int> a(pm::HugePagePolicy::TRANSPARENT);
+    ASSERT_TRUE(a.empty());
+    a.assign(3, 7);
+    a.push_back(1);
+    a.insert(a.begin() + 1, 2);
+    int more[] = {5, 6};
+    a.insert(a.end(), more, more + 2);
+    a.mutable_data()[0] = 4;
+    ASSERT_FALSE(a.is_view());
+    ASSERT_EQ(a, (pm::PackedArray<int>{4, 2, 7, 7, 1, 5, 6}));
+    ASSERT_EQ(a.front(), 4);
+    ASSERT_EQ(a.back(), 6);
+    ASSERT_EQ(a.huge_page_policy(), pm::HugePagePolicy::TRANSPARENT);
+    pm::PackedArray<int> b = a;
+    ASSERT_EQ(b.huge_page_policy(), pm::HugePagePolicy::TRANSPARENT);
+    b.resize(2);
+    ASSERT_EQ(b, (pm::PackedArray<int>{4, 2}));
+    ASSERT_EQ(a.size(), 7);
+}
+
+TEST(PackedArray, ViewIsCopiedBeforeItIsModified) {
+    auto owner = std::make_shared<std::vector<int>>(std::vector<int>{1, 2, 3});
+    auto view = pm::PackedArray<int>::view(owner->data(), owner->size(), owner);
+    ASSERT_TRUE(view.is_view());
+    ASSERT_EQ(view.data(), owner->data());
+    ASSERT_EQ(view, (pm::PackedArray<int>{1, 2, 3}));
+
+    // A copy of a view views the same memory, and keeps it alive.
+    auto copy = view;
+    ASSERT_EQ(copy.data(), owner->data());
+    std::weak_ptr<std::vector<int>> weak_owner = owner;
+    owner.reset();
+    view = pm::PackedArray<int>();
+    ASSERT_FALSE(weak_owner.expired());
+
+    copy.mutable_data()[1] = 5;
+    ASSERT_FALSE(copy.is_view());
+    ASSERT_EQ(copy, (pm::PackedArray<int>{1, 5, 3}));
+    ASSERT_TRUE(weak_owner.expired());
+
+    // Assigning a view its own values makes them owned.
+    auto values = std::make_shared<std::vector<int>>(std::vector<int>{8, 9});
+    auto other = pm::PackedArray<int>::view(values->data(), values->size(), values);
+    other.assign(other.begin(), other.end());
+    ASSERT_FALSE(other.is_view());
+    ASSERT_NE(other.data(), values->data());
+    ASSERT_EQ(other, (pm::PackedArray<int>{8, 9}));
+}
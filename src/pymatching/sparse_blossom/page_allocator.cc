@@ -0,0 +1,124 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/page_allocator.h"
+
+#include <new>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+inline uintptr_t round_up_to_huge_page(uintptr_t n) {
+    return (n + pm::HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(pm::HUGE_PAGE_SIZE - 1);
+}
+
+/// Maps `num_bytes' (a multiple of HUGE_PAGE_SIZE) bytes of anonymous memory aligned to HUGE_PAGE_SIZE, so that
+/// all of it can be backed by transparent huge pages.
+void* map_aligned_pages(size_t num_bytes) {
+    // Over-allocate by a huge page, and unmap the unaligned ends.
+    size_t num_mapped_bytes = num_bytes + pm::HUGE_PAGE_SIZE;
+    void* mapped = mmap(nullptr, num_mapped_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        throw std::bad_alloc();
+    uintptr_t begin = (uintptr_t)mapped;
+    uintptr_t aligned_begin = round_up_to_huge_page(begin);
+    size_t head = aligned_begin - begin;
+    size_t tail = num_mapped_bytes - head - num_bytes;
+    if (head != 0)
+        munmap(mapped, head);
+    if (tail != 0)
+        munmap((void*)(aligned_begin + num_bytes), tail);
+    // This fails if transparent huge pages are disabled, in which case the memory is still usable.
+    madvise((void*)aligned_begin, num_bytes, MADV_HUGEPAGE);
+    return (void*)aligned_begin;
+}
+#endif
+
+inline bool uses_pages(size_t num_bytes, pm::HugePagePolicy policy) {
+#ifdef __linux__
+    return policy != pm::HugePagePolicy::NONE && num_bytes >= pm::MIN_HUGE_PAGE_ALLOCATION;
+#else
+    (void)num_bytes;
+    (void)policy;
+    return false;
+#endif
+}
+
+}  // namespace
+
+pm::HugePagePolicy pm::huge_page_policy_from_name(const std::string& name) {
+    if (name == "none")
+        return HugePagePolicy::NONE;
+    if (name == "transparent")
+        return HugePagePolicy::TRANSPARENT;
+    if (name == "explicit")
+        return HugePagePolicy::EXPLICIT;
+    throw std::invalid_argument(
+        "Unknown huge page policy '" + name + "'. Expected 'none', 'transparent' or 'explicit'.");
+}
+
+const char* pm::huge_page_policy_name(HugePagePolicy policy) {
+    switch (policy) {
+        case HugePagePolicy::TRANSPARENT:
+            return "transparent";
+        case HugePagePolicy::EXPLICIT:
+            return "explicit";
+        default:
+            return "none";
+    }
+}
+
+void* pm::allocate_pages(size_t num_bytes, HugePagePolicy policy) {
+    if (!uses_pages(num_bytes, policy))
+        return ::operator new(num_bytes);
+#ifdef __linux__
+    size_t num_page_bytes = round_up_to_huge_page(num_bytes);
+    if (policy == HugePagePolicy::EXPLICIT) {
+        void* mapped = mmap(
+            nullptr, num_page_bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mapped != MAP_FAILED)
+            return mapped;
+    }
+    return map_aligned_pages(num_page_bytes);
+#else
+    return nullptr;
+#endif
+}
+
+void pm::free_pages(void* data, size_t num_bytes, HugePagePolicy policy) {
+    if (!uses_pages(num_bytes, policy)) {
+        ::operator delete(data);
+        return;
+    }
+#ifdef __linux__
+    munmap(data, round_up_to_huge_page(num_bytes));
+#endif
+}
+
+void pm::advise_huge_pages(const void* data, size_t num_bytes) {
+#ifdef __linux__
+    uintptr_t begin = round_up_to_huge_page((uintptr_t)data);
+    uintptr_t end = ((uintptr_t)data + num_bytes) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    if (begin < end)
+        madvise((void*)begin, end - begin, MADV_HUGEPAGE);
+#else
+    (void)data;
+    (void)num_bytes;
+#endif
+}
@@ -0,0 +1,103 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_PAGE_ALLOCATOR_H
+#define PYMATCHING2_PAGE_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace pm {
+
+/// How large arrays (such as the edges of a graph with millions of nodes) are backed by memory pages. Huge pages
+/// cover far more memory per TLB entry, so that random accesses to a large graph miss the TLB much less often.
+enum class HugePagePolicy : uint8_t {
+    /// Ordinary allocation with operator new.
+    NONE,
+    /// Anonymous memory aligned to HUGE_PAGE_SIZE and marked with madvise(MADV_HUGEPAGE), so that the kernel backs it
+    /// with transparent huge pages when it can.
+    TRANSPARENT,
+    /// Memory mapped with MAP_HUGETLB from the pool of explicitly reserved huge pages (see /proc/sys/vm/nr_hugepages),
+    /// falling back to TRANSPARENT if the pool doesn't have enough free pages.
+    EXPLICIT,
+};
+
+/// The size of a (default) huge page on x86-64 and aarch64 Linux.
+constexpr size_t HUGE_PAGE_SIZE = size_t{1} << 21;
+/// Allocations smaller than this are always made with operator new, whatever the policy, since they would waste most
+/// of a huge page.
+constexpr size_t MIN_HUGE_PAGE_ALLOCATION = HUGE_PAGE_SIZE / 2;
+
+/// Parses "none", "transparent" or "explicit", throwing std::invalid_argument otherwise.
+HugePagePolicy huge_page_policy_from_name(const std::string& name);
+const char* huge_page_policy_name(HugePagePolicy policy);
+
+/// Allocates `num_bytes' bytes according to `policy', throwing std::bad_alloc on failure. On platforms other than
+/// Linux every policy behaves like NONE.
+void* allocate_pages(size_t num_bytes, HugePagePolicy policy);
+/// Frees memory returned by `allocate_pages' with the same `num_bytes' and `policy'.
+void free_pages(void* data, size_t num_bytes, HugePagePolicy policy);
+/// Asks the kernel to back the whole huge pages within [data, data + num_bytes) with transparent huge pages. Memory
+/// that has already been touched is collapsed into huge pages in the background by khugepaged. Does nothing on
+/// platforms other than Linux, or for ranges too small to contain a whole huge page.
+void advise_huge_pages(const void* data, size_t num_bytes);
+
+/// A std::allocator replacement that allocates with `allocate_pages'. The policy is part of the state of the
+/// allocator, so it is carried along when a container using it is copied, and a default-constructed allocator
+/// behaves like std::allocator.
+template <typename T>
+struct PageAllocator {
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+    typedef std::false_type is_always_equal;
+
+    HugePagePolicy policy;
+
+    PageAllocator() noexcept : policy(HugePagePolicy::NONE) {
+    }
+    explicit PageAllocator(HugePagePolicy policy) noexcept : policy(policy) {
+    }
+    template <typename U>
+    PageAllocator(const PageAllocator<U>& other) noexcept : policy(other.policy) {
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(allocate_pages(n * sizeof(T), policy));
+    }
+    void deallocate(T* data, size_t n) noexcept {
+        free_pages(data, n * sizeof(T), policy);
+    }
+
+    template <typename U>
+    bool operator==(const PageAllocator<U>& other) const noexcept {
+        return policy == other.policy;
+    }
+    template <typename U>
+    bool operator!=(const PageAllocator<U>& other) const noexcept {
+        return policy != other.policy;
+    }
+};
+
+/// A vector whose storage is allocated according to a HugePagePolicy.
+template <typename T>
+using PagedVector = std::vector<T, PageAllocator<T>>;
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_PAGE_ALLOCATOR_H
@@ -0,0 +1,68 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/page_allocator.h"
+
+#include <gtest/gtest.h>
+
+TEST(PageAllocator, AllocatesUsableMemoryWithEveryPolicy) {
+    for (auto policy : {pm::HugePagePolicy::NONE, pm::HugePagePolicy::TRANSPARENT, pm::HugePagePolicy::EXPLICIT}) {
+        for (size_t n : {0, 1, 1000, 1 << 20, 3 << 20}) {
+            pm::PagedVector<uint32_t> v(n, 7, pm::PageAllocator<uint32_t>(policy));
+            for (size_t k = 0; k < n; k += 4096)
+                v[k] = (uint32_t)k;
+            v.push_back(5);
+            ASSERT_EQ(v.size(), n + 1);
+            ASSERT_EQ(v.back(), 5);
+            ASSERT_EQ(v.get_allocator().policy, policy);
+        }
+    }
+}
+
+TEST(PageAllocator, LargeAllocationsAreAlignedToHugePages) {
+#ifdef __linux__
+    size_t n = pm::HUGE_PAGE_SIZE + 12345;
+    void* data = pm::allocate_pages(n, pm::HugePagePolicy::TRANSPARENT);
+    ASSERT_EQ((uintptr_t)data % pm::HUGE_PAGE_SIZE, 0);
+    static_cast<char*>(data)[n - 1] = 1;
+    pm::free_pages(data, n, pm::HugePagePolicy::TRANSPARENT);
+#endif
+}
+
+TEST(PageAllocator, CopiesKeepThePolicy) {
+    pm::PagedVector<int> a(10, 1, pm::PageAllocator<int>(pm::HugePagePolicy::TRANSPARENT));
+    pm::PagedVector<int> b(a);
+    ASSERT_EQ(b.get_allocator().policy, pm::HugePagePolicy::TRANSPARENT);
+    pm::PagedVector<int> c;
+    c = a;
+    ASSERT_EQ(c.get_allocator().policy, pm::HugePagePolicy::TRANSPARENT);
+    ASSERT_EQ(c, a);
+    pm::PagedVector<int> d;
+    d = std::move(c);
+    ASSERT_EQ(d.get_allocator().policy, pm::HugePagePolicy::TRANSPARENT);
+}
+
+TEST(PageAllocator, PolicyNames) {
+    for (auto policy : {pm::HugePagePolicy::NONE, pm::HugePagePolicy::TRANSPARENT, pm::HugePagePolicy::EXPLICIT})
+        ASSERT_EQ(pm::huge_page_policy_from_name(pm::huge_page_policy_name(policy)), policy);
+    ASSERT_THROW(pm::huge_page_policy_from_name("huge"), std::invalid_argument);
+}
+
+TEST(PageAllocator, AdviseHugePagesAcceptsAnyRange) {
+    std::vector<char> small(100);
+    pm::advise_huge_pages(small.data(), small.size());
+    std::vector<char> large(3 * pm::HUGE_PAGE_SIZE);
+    pm::advise_huge_pages(large.data(), large.size());
+    large.back() = 1;
+}
@@ -15,13 +15,11 @@
 #ifndef PYMATCHING2_SEARCH_DETECTOR_NODE_H
 #define PYMATCHING2_SEARCH_DETECTOR_NODE_H
 
+#include "pymatching/sparse_blossom/flooder/detector_node.h"
 #include "pymatching/sparse_blossom/tracker/queued_event_tracker.h"
 
 namespace pm {
 
-const uint8_t FLIPPED = 1;
-const uint8_t WEIGHT_SIGN = 2;
-
 class SearchDetectorNode {
    public:
     SearchDetectorNode() : reached_from_source(nullptr), index_of_predecessor(SIZE_MAX), distance_from_source(0) {
@@ -41,13 +39,14 @@ class SearchDetectorNode {
     QueuedEventTracker node_event_tracker;
 
     /// == Permanent fields used to define the structure of the graph. ==
-    std::vector<SearchDetectorNode *> neighbors;  /// The node's neighbors.
-    std::vector<weight_int> neighbor_weights;     /// Distance crossed by the edge to each neighbor.
-    std::vector<std::vector<size_t>>
-        neighbor_observable_indices;        /// Indices of observables crossed by the edge to each neighbor.
-    std::vector<uint8_t> neighbor_markers;  /// Used to mark edges as "seen" when decoding to an edge list.
-
-    size_t index_of_neighbor(SearchDetectorNode *target) const;
+    /// These are views into the MatchingGraphTopology of the owning SearchGraph, which is usually shared with the
+    /// MatchingGraph of the same Mwpm. The observable indices of an edge are looked up with
+    /// `SearchGraph::iter_observables_of_edge'.
+    BasicNeighborList<SearchDetectorNode> neighbors;  /// The node's neighbors.
+    EdgeValues<weight_int> neighbor_weights;          /// Distance crossed by the edge to each neighbor.
+    EdgeValues<obs_int> neighbor_observables;         /// Observables crossed by the edge to each neighbor.
+
+    size_t index_of_neighbor(const SearchDetectorNode *target) const;
 
     void reset();
 };
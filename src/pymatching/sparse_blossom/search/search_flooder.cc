@@ -14,17 +14,28 @@
 
 #include "search_flooder.h"
 
+#include <algorithm>
+#include <functional>
 #include <limits>
 
-pm::SearchFlooder::SearchFlooder() : target_type(NO_TARGET) {
+#include "pymatching/sparse_blossom/flooder/collision_scan.h"
+
+template <typename Queue>
+pm::BasicSearchFlooder<Queue>::BasicSearchFlooder() : target_type(NO_TARGET) {
+    bind_queue_to_graph();
 }
 
-pm::SearchFlooder::SearchFlooder(pm::SearchGraph graph) : graph(std::move(graph)), target_type(NO_TARGET) {
+template <typename Queue>
+pm::BasicSearchFlooder<Queue>::BasicSearchFlooder(pm::SearchGraph graph)
+    : graph(std::move(graph)), target_type(NO_TARGET) {
+    bind_queue_to_graph();
 }
 
-std::pair<size_t, pm::cumulative_time_int> pm::SearchFlooder::find_next_event_at_node_returning_neighbor_index_and_time(
+template <typename Queue>
+std::pair<size_t, pm::cumulative_time_int>
+pm::BasicSearchFlooder<Queue>::find_next_event_at_node_returning_neighbor_index_and_time(
     const pm::SearchDetectorNode &detector_node) const {
-    pm::cumulative_time_int best_time = std::numeric_limits<cumulative_time_int>::max();
+    pm::cumulative_time_int best_time = NO_COLLISION;
     size_t best_neighbor = SIZE_MAX;
 
     size_t start = 0;
@@ -40,43 +51,39 @@ std::pair<size_t, pm::cumulative_time_int> pm::SearchFlooder::find_next_event_at
         start++;
     }
 
-    // Handle non-boundary neighbors.
-    for (size_t i = start; i < detector_node.neighbors.size(); i++) {
-        auto weight = detector_node.neighbor_weights[i];
-        auto neighbor = detector_node.neighbors[i];
-
-        pm::cumulative_time_int collision_time;
-
-        if (neighbor->reached_from_source == detector_node.reached_from_source) {
-            continue;
-        } else if (!neighbor->reached_from_source) {
-            collision_time = queue.cur_time + weight - (queue.cur_time - detector_node.distance_from_source);
-        } else {
-            // neighbor->reached_from_source != detector_node.reached_from_source
-            auto covered_from_this_node = queue.cur_time - detector_node.distance_from_source;
+    // Handle non-boundary neighbors. A neighbor reached from the same source can't be collided with, an unreached
+    // neighbor is reached once the edge has been covered, and the search from another source is met halfway.
+    auto covered_from_this_node = queue.cur_time - detector_node.distance_from_source;
+    scan_neighbor_collision_times(
+        start,
+        detector_node.neighbors.size(),
+        [&](size_t i) {
+            auto weight = detector_node.neighbor_weights[i];
+            auto neighbor = detector_node.neighbors[i];
             auto covered_from_neighbor = queue.cur_time - neighbor->distance_from_source;
-            collision_time = queue.cur_time + (weight - covered_from_this_node - covered_from_neighbor) / 2;
-        }
-
-        if (collision_time < best_time) {
-            best_time = collision_time;
-            best_neighbor = i;
-        }
-    }
+            auto reach_time = queue.cur_time + weight - covered_from_this_node;
+            auto meet_time = queue.cur_time + (weight - covered_from_this_node - covered_from_neighbor) / 2;
+            auto collision_time = neighbor->reached_from_source ? meet_time : reach_time;
+            return neighbor->reached_from_source == detector_node.reached_from_source ? NO_COLLISION : collision_time;
+        },
+        best_time,
+        best_neighbor);
 
     return {best_neighbor, best_time};
 }
 
-void pm::SearchFlooder::reschedule_events_at_search_detector_node(pm::SearchDetectorNode &detector_node) {
+template <typename Queue>
+void pm::BasicSearchFlooder<Queue>::reschedule_events_at_search_detector_node(pm::SearchDetectorNode &detector_node) {
     auto x = find_next_event_at_node_returning_neighbor_index_and_time(detector_node);
     if (x.first == SIZE_MAX) {
-        detector_node.node_event_tracker.set_no_desired_event();
+        detector_node.node_event_tracker.set_no_desired_event(queue);
     } else {
         detector_node.node_event_tracker.set_desired_event({&detector_node, cyclic_time_int{x.second}}, queue);
     }
 }
 
-void pm::SearchFlooder::do_search_starting_at_empty_search_detector_node(pm::SearchDetectorNode *src) {
+template <typename Queue>
+void pm::BasicSearchFlooder<Queue>::do_search_starting_at_empty_search_detector_node(pm::SearchDetectorNode *src) {
     src->reached_from_source = src;
     src->index_of_predecessor = SIZE_MAX;
     src->distance_from_source = 0;
@@ -84,7 +91,8 @@ void pm::SearchFlooder::do_search_starting_at_empty_search_detector_node(pm::Sea
     reschedule_events_at_search_detector_node(*src);
 }
 
-void pm::SearchFlooder::do_search_exploring_empty_detector_node(
+template <typename Queue>
+void pm::BasicSearchFlooder<Queue>::do_search_exploring_empty_detector_node(
     pm::SearchDetectorNode &empty_node, size_t empty_to_from_index) {
     auto from_node = empty_node.neighbors[empty_to_from_index];
     empty_node.reached_from_source = from_node->reached_from_source;
@@ -95,7 +103,8 @@ void pm::SearchFlooder::do_search_exploring_empty_detector_node(
     reschedule_events_at_search_detector_node(empty_node);
 }
 
-pm::SearchGraphEdge pm::SearchFlooder::do_look_at_node_event(pm::SearchDetectorNode &node) {
+template <typename Queue>
+pm::SearchGraphEdge pm::BasicSearchFlooder<Queue>::do_look_at_node_event(pm::SearchDetectorNode &node) {
     auto next = find_next_event_at_node_returning_neighbor_index_and_time(node);
     if (next.second == queue.cur_time) {
         auto dst = node.neighbors[next.first];
@@ -128,7 +137,10 @@ pm::SearchGraphEdge pm::SearchFlooder::do_look_at_node_event(pm::SearchDetectorN
     return {nullptr, SIZE_MAX};
 }
 
-pm::SearchGraphEdge pm::SearchFlooder::run_until_collision(pm::SearchDetectorNode *src, pm::SearchDetectorNode *dst) {
+template <typename Queue>
+pm::SearchGraphEdge pm::BasicSearchFlooder<Queue>::run_until_collision(
+    pm::SearchDetectorNode *src, pm::SearchDetectorNode *dst) {
+    bind_queue_to_graph();
     if (!dst) {
         target_type = BOUNDARY;
     } else {
@@ -149,20 +161,144 @@ pm::SearchGraphEdge pm::SearchFlooder::run_until_collision(pm::SearchDetectorNod
     return {nullptr, SIZE_MAX};
 }
 
-void pm::SearchFlooder::reset_graph() {
+template <typename Queue>
+pm::SearchGraphEdge pm::BasicSearchFlooder<Queue>::run_guided_search(
+    pm::SearchDetectorNode *src, pm::SearchDetectorNode *dst) {
+    target_type = dst ? DETECTOR_NODE : BOUNDARY;
+    const SearchDetectorNode *first_node = graph.nodes.data();
+    const cumulative_time_int *target_distances = dst ? landmarks->distances_to_node(dst - first_node) : nullptr;
+
+    guided_queue.clear();
+    auto reach = [&](SearchDetectorNode *node, size_t index_of_predecessor, cumulative_time_int distance) {
+        if (!node->reached_from_source)
+            reached_nodes.push_back(node);
+        node->reached_from_source = src;
+        node->index_of_predecessor = index_of_predecessor;
+        node->distance_from_source = distance;
+        cumulative_time_int estimate = distance + (dst ? landmarks->lower_bound(node - first_node, target_distances)
+                                                        : landmarks->lower_bound_to_boundary(node - first_node));
+        guided_queue.push_back({estimate, distance, node});
+        std::push_heap(guided_queue.begin(), guided_queue.end(), std::greater<>());
+    };
+    reach(src, SIZE_MAX, 0);
+
+    SearchGraphEdge boundary_edge = {nullptr, SIZE_MAX};
+    cumulative_time_int boundary_distance = SearchLandmarks::UNREACHABLE;
+    while (!guided_queue.empty()) {
+        std::pop_heap(guided_queue.begin(), guided_queue.end(), std::greater<>());
+        GuidedSearchEntry entry = guided_queue.back();
+        guided_queue.pop_back();
+        if (entry.estimate >= boundary_distance)
+            return boundary_edge;
+        SearchDetectorNode *node = entry.node;
+        if (entry.distance != node->distance_from_source)
+            continue;
+        if (node == dst) {
+            // Return the edge into dst, and make dst the end of the path traced back from it.
+            SearchDetectorNode *predecessor = node->neighbors[node->index_of_predecessor];
+            node->index_of_predecessor = SIZE_MAX;
+            return {predecessor, predecessor->index_of_neighbor(node)};
+        }
+        for (size_t i = 0; i < node->neighbors.size(); i++) {
+            SearchDetectorNode *neighbor = node->neighbors[i];
+            cumulative_time_int distance = entry.distance + node->neighbor_weights[i];
+            if (!neighbor) {
+                if (target_type == BOUNDARY && distance < boundary_distance) {
+                    boundary_distance = distance;
+                    boundary_edge = {node, i};
+                }
+            } else if (!neighbor->reached_from_source || distance < neighbor->distance_from_source) {
+                reach(neighbor, neighbor->index_of_neighbor(node), distance);
+            }
+        }
+    }
+    return boundary_edge;
+}
+
+template <typename Queue>
+pm::SearchGraphEdge pm::BasicSearchFlooder<Queue>::find_collision_edge(
+    pm::SearchDetectorNode *src, pm::SearchDetectorNode *dst) {
+    if (landmarks)
+        return run_guided_search(src, dst);
+    return run_until_collision(src, dst);
+}
+
+template <typename Queue>
+void pm::BasicSearchFlooder<Queue>::enable_guided_search(size_t num_landmarks) {
+    landmarks = std::make_shared<const SearchLandmarks>(graph, num_landmarks);
+    path_cache.clear();
+}
+
+template <typename Queue>
+const pm::CachedSearchPath &pm::BasicSearchFlooder<Queue>::find_shortest_path_from_middle(size_t src, size_t dst) {
+    auto cached = path_cache.find(src, dst);
+    if (cached)
+        return *cached;
+
+    CachedSearchPath path;
+    SearchDetectorNode *loc_to_ptr = dst == SIZE_MAX ? nullptr : &graph.nodes[dst];
+    auto collision_edge = find_collision_edge(&graph.nodes[src], loc_to_ptr);
+    iter_edges_tracing_back_from_collision_edge(collision_edge, [&](const SearchGraphEdge &e) {
+        path.edges.push_back(e);
+        path.weight += e.detector_node->neighbor_weights[e.neighbor_index];
+        graph.iter_observables_of_edge(e, [&](size_t obs) {
+            path.crossed_observables.push_back(obs);
+        });
+    });
+    reset();
+
+    // Only keep the observables crossed an odd number of times.
+    auto &crossed = path.crossed_observables;
+    std::sort(crossed.begin(), crossed.end());
+    size_t num_kept = 0;
+    for (size_t i = 0; i < crossed.size();) {
+        size_t j = i;
+        while (j < crossed.size() && crossed[j] == crossed[i])
+            j++;
+        if ((j - i) & 1)
+            crossed[num_kept++] = crossed[i];
+        i = j;
+    }
+    crossed.resize(num_kept);
+
+    return path_cache.insert(src, dst, std::move(path));
+}
+
+template <typename Queue>
+void pm::BasicSearchFlooder<Queue>::handle_graph_weights_changed() {
+    path_cache.clear();
+    if (landmarks)
+        enable_guided_search(landmarks->num_landmarks);
+}
+
+template <typename Queue>
+void pm::BasicSearchFlooder<Queue>::reset_graph() {
     for (auto &detector_node : reached_nodes)
         detector_node->reset();
     reached_nodes.clear();
 }
 
-void pm::SearchFlooder::reset() {
+template <typename Queue>
+void pm::BasicSearchFlooder<Queue>::reset() {
     reset_graph();
     queue.reset();
 }
 
-pm::SearchFlooder::SearchFlooder(pm::SearchFlooder &&other) noexcept
+template <typename Queue>
+pm::BasicSearchFlooder<Queue>::BasicSearchFlooder(pm::BasicSearchFlooder<Queue> &&other) noexcept
     : graph(std::move(other.graph)),
       queue(std::move(other.queue)),
       reached_nodes(std::move(other.reached_nodes)),
-      target_type(other.target_type) {
+      target_type(other.target_type),
+      path_cache(std::move(other.path_cache)),
+      landmarks(std::move(other.landmarks)),
+      guided_queue(std::move(other.guided_queue)),
+      edge_flip_parity(std::move(other.edge_flip_parity)),
+      touched_edge_ids(std::move(other.touched_edge_ids)) {
+    bind_queue_to_graph();
 }
+
+template class pm::BasicSearchFlooder<pm::radix_heap_queue<false>>;
+template class pm::BasicSearchFlooder<pm::radix_heap_queue<false, true>>;
+template class pm::BasicSearchFlooder<pm::circular_bucket_queue<false>>;
+template class pm::BasicSearchFlooder<pm::compact_radix_heap_queue<false>>;
@@ -15,24 +15,60 @@
 #ifndef PYMATCHING2_SEARCH_FLOODER_H
 #define PYMATCHING2_SEARCH_FLOODER_H
 
+#include <memory>
+
 #include "pymatching/sparse_blossom/search/search_graph.h"
+#include "pymatching/sparse_blossom/search/search_landmarks.h"
+#include "pymatching/sparse_blossom/search/search_path_cache.h"
+#include "pymatching/sparse_blossom/tracker/circular_bucket_queue.h"
+#include "pymatching/sparse_blossom/tracker/compact_radix_heap_queue.h"
 #include "pymatching/sparse_blossom/tracker/radix_heap_queue.h"
 
 namespace pm {
 
 enum TargetType : uint8_t { DETECTOR_NODE, BOUNDARY, NO_TARGET };
 
-class SearchFlooder {
+/// An entry in the priority queue of an A*-guided search.
+struct GuidedSearchEntry {
+    /// The distance from the source plus the lower bound on the remaining distance to the target.
+    cumulative_time_int estimate;
+    cumulative_time_int distance;
+    SearchDetectorNode* node;
+
+    /// Orders entries by estimate, preferring entries further from the source when the estimates are equal.
+    inline bool operator>(const GuidedSearchEntry& other) const {
+        return estimate > other.estimate || (estimate == other.estimate && distance < other.distance);
+    }
+};
+
+/// Finds shortest paths in a search graph, using a `Queue' (`default_flooder_queue' for a `SearchFlooder', or
+/// `circular_bucket_queue<false>' when the edge weights are small, or `compact_radix_heap_queue<false>') to schedule
+/// the events of the search regions.
+template <typename Queue>
+class BasicSearchFlooder {
    public:
-    SearchFlooder();
-    explicit SearchFlooder(SearchGraph graph);
-    SearchFlooder(SearchFlooder&& other) noexcept;
+    BasicSearchFlooder();
+    explicit BasicSearchFlooder(SearchGraph graph);
+    BasicSearchFlooder(BasicSearchFlooder&& other) noexcept;
     SearchGraph graph;
-    pm::radix_heap_queue<false> queue;
+    Queue queue;
     /// The reached_nodes are the nodes that need to be reset after each search completes
     std::vector<SearchDetectorNode*> reached_nodes;
     /// The type of target for the search from a detection event, either another detection event or the boundary.
     TargetType target_type;
+    /// Recently found shortest paths, reused by `iter_edges_on_shortest_path_from_middle'. Must be cleared if the
+    /// graph is modified.
+    SearchPathCache path_cache;
+    /// If set, shortest paths are found with an A* search guided by these landmark distances, instead of by
+    /// growing search regions from both ends of the path. See `enable_guided_search'.
+    std::shared_ptr<const SearchLandmarks> landmarks;
+    /// The priority queue used by the guided search.
+    std::vector<GuidedSearchEntry> guided_queue;
+    /// The parity of the number of times each edge of the graph (by its id in `graph.edge_ids') has been flipped by
+    /// `decode_detection_events_to_edges' in the current shot, which is all zeros between shots.
+    std::vector<uint8_t> edge_flip_parity;
+    /// The ids of the edges flipped by `decode_detection_events_to_edges' in the current shot, in order.
+    std::vector<size_t> touched_edge_ids;
     void reschedule_events_at_search_detector_node(SearchDetectorNode& detector_node);
     std::pair<size_t, cumulative_time_int> find_next_event_at_node_returning_neighbor_index_and_time(
         const SearchDetectorNode& detector_node) const;
@@ -40,6 +76,19 @@ class SearchFlooder {
     void do_search_exploring_empty_detector_node(SearchDetectorNode& empty_node, size_t empty_to_from_index);
     SearchGraphEdge do_look_at_node_event(SearchDetectorNode& node);
     SearchGraphEdge run_until_collision(SearchDetectorNode* src, SearchDetectorNode* dst);
+    /// Finds a shortest path from src to dst (or to the boundary if dst is nullptr) with an A* search guided by
+    /// `landmarks', which must be set. Returns the last edge on the path, which, like the collision edge returned by
+    /// `run_until_collision', can be traced back to both ends of the path.
+    SearchGraphEdge run_guided_search(SearchDetectorNode* src, SearchDetectorNode* dst);
+    /// Uses `run_guided_search' if guided search is enabled, and `run_until_collision' otherwise.
+    SearchGraphEdge find_collision_edge(SearchDetectorNode* src, SearchDetectorNode* dst);
+    /// Enables guided search, computing landmark distances for the current graph. Guided search explores far
+    /// fewer nodes than the default bidirectional search for distant nodes in large graphs, at the cost of
+    /// `num_landmarks' distances stored per node. The landmarks must be recomputed if the graph is modified.
+    void enable_guided_search(size_t num_landmarks = 4);
+    /// Discards the cached paths, and recomputes the guided search landmarks if guided search is enabled. Must be
+    /// called whenever the weights of the graph are changed.
+    void handle_graph_weights_changed();
     template <typename Callable>
     void iter_edges_on_path_traced_back_from_node(SearchDetectorNode* detector_node, Callable handle_edge);
     template <typename Callable>
@@ -49,6 +98,10 @@ class SearchFlooder {
     // the collision point of the two search regions to src and dst.
     template <typename Callable>
     void iter_edges_on_shortest_path_from_middle(size_t src, size_t dst, Callable handle_edge);
+    // Returns the shortest path between src and dst (or the boundary if dst is SIZE_MAX), searching for it only if
+    // it is not already in the path cache. The path cache must have a nonzero capacity. The edges of the path are
+    // in the same order as they are visited by iter_edges_on_shortest_path_from_middle.
+    const CachedSearchPath& find_shortest_path_from_middle(size_t src, size_t dst);
     template <typename Callable>
     void reverse_path_and_handle_edges(const std::vector<SearchGraphEdge>& edges, Callable handle_edge);
     // Visits the edges on the shortest path from src to dst, calling handle_edge on each SearchGraphEdge.
@@ -58,10 +111,25 @@ class SearchFlooder {
     void iter_edges_on_shortest_path_from_source(size_t src, size_t dst, Callable handle_edge);
     void reset_graph();
     void reset();
+    /// Points a queue that refers to nodes by index (see `compact_radix_heap_queue') at the nodes of `graph'. Called
+    /// when the flooder is created or moved, and at the start of each search, in case the graph has been replaced.
+    inline void bind_queue_to_graph() {
+        if constexpr (Queue::has_compact_events)
+            queue.bind_search_nodes(graph.nodes.data(), graph.nodes.size());
+    }
 };
 
+extern template class BasicSearchFlooder<radix_heap_queue<false>>;
+extern template class BasicSearchFlooder<radix_heap_queue<false, true>>;
+extern template class BasicSearchFlooder<circular_bucket_queue<false>>;
+extern template class BasicSearchFlooder<compact_radix_heap_queue<false>>;
+
+typedef BasicSearchFlooder<default_flooder_queue> SearchFlooder;
+
+template <typename Queue>
 template <typename Callable>
-void SearchFlooder::iter_edges_on_path_traced_back_from_node(SearchDetectorNode* detector_node, Callable handle_edge) {
+void BasicSearchFlooder<Queue>::iter_edges_on_path_traced_back_from_node(
+    SearchDetectorNode* detector_node, Callable handle_edge) {
     auto current_node = detector_node;
     while (current_node->index_of_predecessor != SIZE_MAX) {
         auto pred_idx = current_node->index_of_predecessor;
@@ -71,8 +139,9 @@ void SearchFlooder::iter_edges_on_path_traced_back_from_node(SearchDetectorNode*
     }
 }
 
+template <typename Queue>
 template <typename Callable>
-void SearchFlooder::iter_edges_tracing_back_from_collision_edge(
+void BasicSearchFlooder<Queue>::iter_edges_tracing_back_from_collision_edge(
     const SearchGraphEdge& collision_edge, Callable handle_edge) {
     iter_edges_on_path_traced_back_from_node(collision_edge.detector_node, handle_edge);
     auto other_node = collision_edge.detector_node->neighbors[collision_edge.neighbor_index];
@@ -81,16 +150,24 @@ void SearchFlooder::iter_edges_tracing_back_from_collision_edge(
     handle_edge(collision_edge);
 }
 
+template <typename Queue>
 template <typename Callable>
-void SearchFlooder::iter_edges_on_shortest_path_from_middle(size_t src, size_t dst, Callable handle_edge) {
+void BasicSearchFlooder<Queue>::iter_edges_on_shortest_path_from_middle(size_t src, size_t dst, Callable handle_edge) {
+    if (path_cache.capacity()) {
+        for (const auto& edge : find_shortest_path_from_middle(src, dst).edges)
+            handle_edge(edge);
+        return;
+    }
     SearchDetectorNode* loc_to_ptr = dst == SIZE_MAX ? nullptr : &graph.nodes[dst];
-    auto collision_edge = run_until_collision(&graph.nodes[src], loc_to_ptr);
+    auto collision_edge = find_collision_edge(&graph.nodes[src], loc_to_ptr);
     iter_edges_tracing_back_from_collision_edge(collision_edge, handle_edge);
     reset();
 }
 
+template <typename Queue>
 template <typename Callable>
-void SearchFlooder::reverse_path_and_handle_edges(const std::vector<SearchGraphEdge>& edges, Callable handle_edge) {
+void BasicSearchFlooder<Queue>::reverse_path_and_handle_edges(
+    const std::vector<SearchGraphEdge>& edges, Callable handle_edge) {
     size_t n = edges.size();
     for (size_t i = 0; i < n; i++) {
         auto e = edges[n - 1 - i];
@@ -100,11 +177,12 @@ void SearchFlooder::reverse_path_and_handle_edges(const std::vector<SearchGraphE
     }
 }
 
+template <typename Queue>
 template <typename Callable>
-void SearchFlooder::iter_edges_on_shortest_path_from_source(size_t src, size_t dst, Callable handle_edge) {
+void BasicSearchFlooder<Queue>::iter_edges_on_shortest_path_from_source(size_t src, size_t dst, Callable handle_edge) {
     SearchDetectorNode* loc_from_ptr = &graph.nodes[src];
     SearchDetectorNode* loc_to_ptr = dst == SIZE_MAX ? nullptr : &graph.nodes[dst];
-    auto collision_edge = run_until_collision(loc_from_ptr, loc_to_ptr);
+    auto collision_edge = find_collision_edge(loc_from_ptr, loc_to_ptr);
 
     std::vector<SearchGraphEdge> path_edges_1;
     iter_edges_on_path_traced_back_from_node(
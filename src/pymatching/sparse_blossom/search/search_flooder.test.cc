@@ -31,9 +31,9 @@ TEST(SearchFlooder, RepCodeDetectorSearch) {
     std::vector<uint8_t> observables(num_nodes, 0);
     pm::total_weight_int weight = 0;
     flooder.iter_edges_tracing_back_from_collision_edge(collision_edge, [&](const pm::SearchGraphEdge& e) {
-        auto& obs = e.detector_node->neighbor_observable_indices[e.neighbor_index];
-        for (auto i : obs)
+        g.iter_observables_of_edge(e, [&](size_t i) {
             *(observables.data() + i) ^= 1;
+        });
         weight += e.detector_node->neighbor_weights[e.neighbor_index];
     });
     std::vector<uint8_t> expected_obs(num_nodes, 0);
@@ -69,9 +69,9 @@ TEST(SearchFlooder, RepCodeBoundarySearch) {
     std::vector<uint8_t> observables(num_nodes, 0);
     pm::total_weight_int weight = 0;
     flooder.iter_edges_tracing_back_from_collision_edge(collision_edge, [&](const pm::SearchGraphEdge& e) {
-        auto& obs = e.detector_node->neighbor_observable_indices[e.neighbor_index];
-        for (auto i : obs)
+        g.iter_observables_of_edge(e, [&](size_t i) {
             *(observables.data() + i) ^= 1;
+        });
         weight += e.detector_node->neighbor_weights[e.neighbor_index];
     });
     std::vector<uint8_t> expected_obs(num_nodes, 0);
@@ -120,3 +120,147 @@ TEST(SearchFlooder, RepCodeSourceToDestPath) {
     std::vector<size_t> expected_node_indices = {4, 3, 2, 1, 0};
     ASSERT_EQ(node_indices, expected_node_indices);
 }
+
+TEST(SearchFlooder, CachedPathsMatchUncachedPaths) {
+    size_t num_nodes = 30;
+    auto cached_flooder = pm::SearchFlooder(pm::SearchGraph(num_nodes));
+    auto uncached_flooder = pm::SearchFlooder(pm::SearchGraph(num_nodes));
+    uncached_flooder.path_cache.set_capacity(0);
+    for (auto g : {&cached_flooder.graph, &uncached_flooder.graph}) {
+        g->add_boundary_edge(0, 2, {0});
+        for (size_t i = 0; i < num_nodes - 1; i++)
+            g->add_edge(i, i + 1, 2, {i % 3, 3});
+    }
+
+    std::vector<std::pair<size_t, size_t>> queries = {{3, 9}, {12, SIZE_MAX}, {9, 3}, {3, 9}, {12, SIZE_MAX}};
+    for (auto& q : queries) {
+        std::vector<std::pair<size_t, size_t>> cached_edges, uncached_edges;
+        cached_flooder.iter_edges_on_shortest_path_from_middle(q.first, q.second, [&](const pm::SearchGraphEdge& e) {
+            cached_edges.push_back({e.detector_node - &cached_flooder.graph.nodes[0], e.neighbor_index});
+        });
+        std::vector<uint8_t> expected_obs(4, 0);
+        pm::total_weight_int expected_weight = 0;
+        uncached_flooder.iter_edges_on_shortest_path_from_middle(
+            q.first, q.second, [&](const pm::SearchGraphEdge& e) {
+                uncached_edges.push_back({e.detector_node - &uncached_flooder.graph.nodes[0], e.neighbor_index});
+                uncached_flooder.graph.iter_observables_of_edge(e, [&](size_t i) {
+                    expected_obs[i] ^= 1;
+                });
+                expected_weight += e.detector_node->neighbor_weights[e.neighbor_index];
+            });
+        ASSERT_EQ(cached_edges, uncached_edges);
+
+        auto& path = cached_flooder.find_shortest_path_from_middle(q.first, q.second);
+        std::vector<uint8_t> obs(4, 0);
+        for (auto i : path.crossed_observables)
+            obs[i] ^= 1;
+        ASSERT_EQ(obs, expected_obs);
+        ASSERT_EQ(path.weight, expected_weight);
+    }
+    ASSERT_EQ(cached_flooder.path_cache.size(), 3);
+    ASSERT_EQ(uncached_flooder.path_cache.size(), 0);
+    ASSERT_TRUE(cached_flooder.reached_nodes.empty());
+}
+
+pm::SearchGraph weighted_grid_graph(size_t width, size_t height) {
+    pm::SearchGraph g(width * height);
+    for (size_t y = 0; y < height; y++) {
+        g.add_boundary_edge(y * width, 10 + 4 * (y % 3), {0});
+        for (size_t x = 0; x < width; x++) {
+            size_t i = y * width + x;
+            if (x + 1 < width)
+                g.add_edge(i, i + 1, 2 + 2 * ((x * 7 + y * 3) % 5), {1 + (x % 2)});
+            if (y + 1 < height)
+                g.add_edge(i, i + width, 2 + 2 * ((x * 5 + y * 11) % 4), {3});
+        }
+    }
+    return g;
+}
+
+TEST(SearchFlooder, GuidedSearchFindsShortestPaths) {
+    size_t width = 9, height = 7;
+    auto guided = pm::SearchFlooder(weighted_grid_graph(width, height));
+    auto unguided = pm::SearchFlooder(weighted_grid_graph(width, height));
+    guided.enable_guided_search();
+    guided.path_cache.set_capacity(0);
+    unguided.path_cache.set_capacity(0);
+    ASSERT_NE(guided.landmarks, nullptr);
+
+    auto path_weight = [](pm::SearchFlooder& flooder, size_t src, size_t dst) {
+        pm::total_weight_int weight = 0;
+        flooder.iter_edges_on_shortest_path_from_middle(src, dst, [&](const pm::SearchGraphEdge& e) {
+            weight += e.detector_node->neighbor_weights[e.neighbor_index];
+        });
+        return weight;
+    };
+    size_t n = width * height;
+    for (size_t src = 0; src < n; src++) {
+        ASSERT_EQ(path_weight(guided, src, SIZE_MAX), path_weight(unguided, src, SIZE_MAX));
+        for (size_t dst = src + 1; dst < n; dst += 5)
+            ASSERT_EQ(path_weight(guided, src, dst), path_weight(unguided, src, dst));
+        ASSERT_TRUE(guided.reached_nodes.empty());
+    }
+
+    // Paths from the source are visited in order, from src to dst.
+    for (size_t dst : {(size_t)40, SIZE_MAX}) {
+        std::vector<pm::SearchGraphEdge> edges;
+        guided.iter_edges_on_shortest_path_from_source(3, dst, [&](const pm::SearchGraphEdge& e) {
+            edges.push_back(e);
+        });
+        ASSERT_EQ(edges.front().detector_node, &guided.graph.nodes[3]);
+        for (size_t i = 0; i + 1 < edges.size(); i++)
+            ASSERT_EQ(edges[i].detector_node->neighbors[edges[i].neighbor_index], edges[i + 1].detector_node);
+        auto last = edges.back().detector_node->neighbors[edges.back().neighbor_index];
+        ASSERT_EQ(last, dst == SIZE_MAX ? nullptr : &guided.graph.nodes[dst]);
+    }
+}
+
+TEST(SearchFlooder, CircularBucketQueueFindsShortestPaths) {
+    size_t width = 9, height = 7;
+    auto radix = pm::SearchFlooder(weighted_grid_graph(width, height));
+    auto circular = pm::BasicSearchFlooder<pm::circular_bucket_queue<false>>(weighted_grid_graph(width, height));
+    // Fewer buckets than the largest edge weight, so that some events overflow.
+    circular.queue = pm::circular_bucket_queue<false>(8);
+    radix.path_cache.set_capacity(0);
+    circular.path_cache.set_capacity(0);
+
+    auto path_weight = [](auto& flooder, size_t src, size_t dst) {
+        pm::total_weight_int weight = 0;
+        flooder.iter_edges_on_shortest_path_from_middle(src, dst, [&](const pm::SearchGraphEdge& e) {
+            weight += e.detector_node->neighbor_weights[e.neighbor_index];
+        });
+        return weight;
+    };
+    size_t n = width * height;
+    for (size_t src = 0; src < n; src++) {
+        ASSERT_EQ(path_weight(circular, src, SIZE_MAX), path_weight(radix, src, SIZE_MAX));
+        for (size_t dst = src + 1; dst < n; dst += 5)
+            ASSERT_EQ(path_weight(circular, src, dst), path_weight(radix, src, dst));
+        ASSERT_TRUE(circular.reached_nodes.empty());
+        ASSERT_TRUE(circular.queue.empty());
+    }
+}
+
+TEST(SearchFlooder, CompactRadixHeapQueueFindsShortestPaths) {
+    size_t width = 9, height = 7;
+    auto radix = pm::SearchFlooder(weighted_grid_graph(width, height));
+    auto compact = pm::BasicSearchFlooder<pm::compact_radix_heap_queue<false>>(weighted_grid_graph(width, height));
+    radix.path_cache.set_capacity(0);
+    compact.path_cache.set_capacity(0);
+
+    auto path_weight = [](auto& flooder, size_t src, size_t dst) {
+        pm::total_weight_int weight = 0;
+        flooder.iter_edges_on_shortest_path_from_middle(src, dst, [&](const pm::SearchGraphEdge& e) {
+            weight += e.detector_node->neighbor_weights[e.neighbor_index];
+        });
+        return weight;
+    };
+    size_t n = width * height;
+    for (size_t src = 0; src < n; src++) {
+        ASSERT_EQ(path_weight(compact, src, SIZE_MAX), path_weight(radix, src, SIZE_MAX));
+        for (size_t dst = src + 1; dst < n; dst += 5)
+            ASSERT_EQ(path_weight(compact, src, dst), path_weight(radix, src, dst));
+        ASSERT_TRUE(compact.reached_nodes.empty());
+        ASSERT_TRUE(compact.queue.empty());
+    }
+}
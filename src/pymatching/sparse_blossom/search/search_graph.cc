@@ -14,17 +14,47 @@
 
 #include "search_graph.h"
 
-pm::SearchGraph::SearchGraph() : num_nodes(0) {
+#include <algorithm>
+
+namespace {
+
+/// The mask of `observables' stored alongside them in `topology', which is zero if it stores observable indices.
+pm::obs_int obs_mask_for_topology(const pm::MatchingGraphTopology &topology, const std::vector<size_t> &observables) {
+    pm::obs_int obs_mask = 0;
+    if (!topology.has_observable_indices) {
+        for (auto obs : observables)
+            obs_mask ^= (pm::obs_int)1 << obs;
+    }
+    return obs_mask;
+}
+
+}  // namespace
+
+pm::SearchGraph::SearchGraph() : topology(std::make_shared<MatchingGraphTopology>()), num_nodes(0) {
 }
 
-pm::SearchGraph::SearchGraph(size_t num_nodes) : num_nodes(num_nodes) {
+pm::SearchGraph::SearchGraph(size_t num_nodes)
+    : topology(std::make_shared<MatchingGraphTopology>()), num_nodes(num_nodes) {
     nodes.resize(num_nodes);
+    topology->nodes.resize(num_nodes);
+    topology->has_observable_indices = true;
+}
+
+pm::SearchGraph::SearchGraph(
+    const MatchingGraph &matching_graph, std::vector<std::pair<size_t, size_t>> negative_weight_edges)
+    : topology(matching_graph.topology),
+      num_nodes(matching_graph.nodes.size()),
+      negative_weight_edges(std::move(negative_weight_edges)) {
+    nodes.resize(num_nodes);
+    bind_all_nodes_to_topology();
 }
 
 pm::SearchGraph::SearchGraph(pm::SearchGraph &&graph) noexcept
     : nodes(std::move(graph.nodes)),
+      topology(std::move(graph.topology)),
       num_nodes(graph.num_nodes),
-      negative_weight_edges(std::move(graph.negative_weight_edges)) {
+      negative_weight_edges(std::move(graph.negative_weight_edges)),
+      edge_ids(std::move(graph.edge_ids)) {
 }
 
 void pm::SearchGraph::add_edge(size_t u, size_t v, signed_weight_int weight, const std::vector<size_t> &observables) {
@@ -42,21 +72,16 @@ void pm::SearchGraph::add_edge(size_t u, size_t v, signed_weight_int weight, con
     if (u == v)
         return;
 
-    uint8_t weight_sign = 0;
-    if (weight < 0) {
+    if (weight < 0)
         negative_weight_edges.push_back({u, v});
-        weight_sign = pm::WEIGHT_SIGN;
-    }
-
-    nodes[u].neighbors.push_back(&(nodes[v]));
-    nodes[u].neighbor_weights.push_back(std::abs(weight));
-    nodes[u].neighbor_observable_indices.push_back(observables);
-    nodes[u].neighbor_markers.push_back(weight_sign);
 
-    nodes[v].neighbors.push_back(&(nodes[u]));
-    nodes[v].neighbor_weights.push_back(std::abs(weight));
-    nodes[v].neighbor_observable_indices.push_back(observables);
-    nodes[v].neighbor_markers.push_back(weight_sign);
+    edge_ids.reset();
+    ensure_topology_is_editable();
+    auto obs_mask = obs_mask_for_topology(*topology, observables);
+    topology->add_half_edge(u, (node_index_int)v, std::abs(weight), obs_mask, observables);
+    topology->add_half_edge(v, (node_index_int)u, std::abs(weight), obs_mask, observables);
+    bind_node_to_topology(u);
+    bind_node_to_topology(v);
 }
 
 void pm::SearchGraph::add_boundary_edge(size_t u, signed_weight_int weight, const std::vector<size_t> &observables) {
@@ -68,14 +93,140 @@ void pm::SearchGraph::add_boundary_edge(size_t u, signed_weight_int weight, cons
             std::to_string(num_nodes) + ")");
     }
 
-    uint8_t weight_sign = 0;
-    if (weight < 0) {
+    if (weight < 0)
         negative_weight_edges.push_back({u, SIZE_MAX});
-        weight_sign = pm::WEIGHT_SIGN;
+
+    edge_ids.reset();
+    ensure_topology_is_editable();
+    topology->add_half_edge(
+        u, BOUNDARY_NEIGHBOR_INDEX, std::abs(weight), obs_mask_for_topology(*topology, observables), observables);
+    bind_node_to_topology(u);
+}
+
+void pm::SearchGraph::update_edge(
+    size_t u, size_t v, signed_weight_int weight, const std::vector<size_t> &observables) {
+    if (u >= nodes.size() || (v != SIZE_MAX && v >= nodes.size())) {
+        throw std::invalid_argument(
+            "Node " + std::to_string(v != SIZE_MAX ? std::max(u, v) : u) + " exceeds number of nodes in graph (" +
+            std::to_string(num_nodes) + ")");
     }
+    if (u == v)
+        return;
 
-    nodes[u].neighbors.insert(nodes[u].neighbors.begin(), 1, nullptr);
-    nodes[u].neighbor_weights.insert(nodes[u].neighbor_weights.begin(), 1, std::abs(weight));
-    nodes[u].neighbor_observable_indices.insert(nodes[u].neighbor_observable_indices.begin(), 1, observables);
-    nodes[u].neighbor_markers.insert(nodes[u].neighbor_markers.begin(), 1, weight_sign);
+    if (topology->is_periodic() || topology.use_count() > 1) {
+        set_topology(std::make_shared<MatchingGraphTopology>(
+            topology->is_periodic() ? topology->expanded() : MatchingGraphTopology(*topology)));
+    }
+    auto obs_mask = obs_mask_for_topology(*topology, observables);
+    topology->set_half_edge(
+        u, v == SIZE_MAX ? BOUNDARY_NEIGHBOR_INDEX : (node_index_int)v, std::abs(weight), obs_mask, observables);
+    if (v != SIZE_MAX)
+        topology->set_half_edge(v, (node_index_int)u, std::abs(weight), obs_mask, observables);
+    update_negative_weight_edge(u, v, weight);
+}
+
+void pm::SearchGraph::update_shared_edge(
+    size_t u,
+    size_t v,
+    signed_weight_int weight,
+    const std::shared_ptr<MatchingGraphTopology> &matching_graph_topology) {
+    if (u == v)
+        return;
+    if (topology != matching_graph_topology)
+        set_topology(matching_graph_topology);
+    update_negative_weight_edge(u, v, weight);
+}
+
+void pm::SearchGraph::update_negative_weight_edge(size_t u, size_t v, signed_weight_int weight) {
+    auto is_this_edge = [&](const std::pair<size_t, size_t> &e) {
+        return (e.first == u && e.second == v) || (e.first == v && e.second == u);
+    };
+    negative_weight_edges.erase(
+        std::remove_if(negative_weight_edges.begin(), negative_weight_edges.end(), is_this_edge),
+        negative_weight_edges.end());
+    if (weight < 0)
+        negative_weight_edges.push_back({u, v});
+}
+
+pm::SearchGraph pm::SearchGraph::clone_sharing_topology() const {
+    SearchGraph clone;
+    clone.nodes.resize(nodes.size());
+    clone.topology = topology;
+    clone.num_nodes = num_nodes;
+    clone.negative_weight_edges = negative_weight_edges;
+    clone.edge_ids = edge_ids;
+    clone.bind_all_nodes_to_topology();
+    return clone;
+}
+
+void pm::SearchGraph::set_topology(std::shared_ptr<MatchingGraphTopology> new_topology) {
+    topology = std::move(new_topology);
+    edge_ids.reset();
+    bind_all_nodes_to_topology();
+}
+
+const pm::SearchEdgeIds &pm::SearchGraph::get_edge_ids() {
+    if (!edge_ids)
+        edge_ids = std::make_shared<const SearchEdgeIds>(*this);
+    return *edge_ids;
+}
+
+pm::SearchEdgeIds::SearchEdgeIds(const SearchGraph &graph) {
+    auto &nodes = graph.nodes;
+    offsets.reserve(nodes.size() + 1);
+    offsets.push_back(0);
+    for (auto &n : nodes)
+        offsets.push_back(offsets.back() + n.neighbors.size());
+    ids.assign(offsets.back(), SIZE_MAX);
+    for (size_t i = 0; i < nodes.size(); i++) {
+        auto &n = nodes[i];
+        for (size_t k = 0; k < n.neighbors.size(); k++) {
+            if (ids[offsets[i] + k] != SIZE_MAX)
+                continue;
+            size_t id = endpoints.size() / 2;
+            ids[offsets[i] + k] = id;
+            auto neighbor = n.neighbors[k];
+            if (neighbor == nullptr) {
+                endpoints.push_back(i);
+                endpoints.push_back(SIZE_MAX);
+                continue;
+            }
+            // The edge is first seen from its node with the smaller index, so the other end is found only once.
+            size_t j = neighbor - nodes.data();
+            endpoints.push_back(i);
+            endpoints.push_back(j);
+            ids[offsets[j] + neighbor->index_of_neighbor(&n)] = id;
+        }
+    }
+}
+
+void pm::SearchGraph::bind_node_to_topology(size_t node_id) {
+    auto &n = nodes[node_id];
+    if (topology->is_compact()) {
+        // As for a MatchingGraph, shifting the node array by the offset of a periodic node's edges resolves its unit
+        // cell neighbors.
+        auto edges = topology->compact_edges_of(node_id);
+        n.neighbors = BasicNeighborList<SearchDetectorNode>(
+            nodes.data() + edges.shift, topology->neighbors.data() + edges.begin, edges.end - edges.begin);
+        n.neighbor_weights = EdgeValues<weight_int>(topology->neighbor_weights.data() + edges.begin);
+        n.neighbor_observables = EdgeValues<obs_int>(topology->neighbor_observables.data() + edges.begin);
+    } else {
+        auto &t = topology->nodes[node_id];
+        n.neighbors = BasicNeighborList<SearchDetectorNode>(nodes.data(), t.neighbors.data(), t.neighbors.size());
+        n.neighbor_weights = EdgeValues<weight_int>(t.neighbor_weights.data());
+        n.neighbor_observables = EdgeValues<obs_int>(t.neighbor_observables.data());
+    }
+}
+
+void pm::SearchGraph::bind_all_nodes_to_topology() {
+    for (size_t i = 0; i < nodes.size(); i++)
+        bind_node_to_topology(i);
+}
+
+void pm::SearchGraph::ensure_topology_is_editable() {
+    if (topology->is_compact()) {
+        set_topology(std::make_shared<MatchingGraphTopology>(topology->unpacked()));
+    } else if (topology.use_count() > 1) {
+        set_topology(std::make_shared<MatchingGraphTopology>(*topology));
+    }
 }
@@ -15,6 +15,9 @@
 #ifndef PYMATCHING2_SEARCH_GRAPH_H
 #define PYMATCHING2_SEARCH_GRAPH_H
 
+#include <memory>
+
+#include "pymatching/sparse_blossom/flooder/graph.h"
 #include "pymatching/sparse_blossom/search/search_detector_node.h"
 #include "pymatching/sparse_blossom/tracker/queued_event_tracker.h"
 
@@ -26,18 +29,103 @@ struct SearchGraphEdge {
     size_t neighbor_index;
 };
 
+class SearchGraph;
+
+/// A numbering of the undirected edges of a SearchGraph, so that sets of edges can be held in flat arrays. Edge k of
+/// node i (in the order of its neighbors) has the id `ids[offsets[i] + k]', which is shared by the same edge seen
+/// from its other node. The edges are numbered in order of their first appearance from the node with the smaller
+/// index, so that the boundary edge of a node comes first.
+struct SearchEdgeIds {
+    std::vector<size_t> offsets;
+    std::vector<size_t> ids;
+    /// The two nodes of each edge, smaller index first, with SIZE_MAX as the second node of a boundary edge.
+    std::vector<size_t> endpoints;
+
+    SearchEdgeIds() = default;
+    explicit SearchEdgeIds(const SearchGraph& graph);
+    inline size_t num_edges() const {
+        return endpoints.size() / 2;
+    }
+};
+
+/// The graph searched by a SearchFlooder. Its edges are held in a MatchingGraphTopology, which is usually the
+/// topology of the MatchingGraph of the same Mwpm (see `SearchGraph(const MatchingGraph&, ...)'), so that the
+/// adjacency is only stored once and each SearchDetectorNode only holds the state of the search.
 class SearchGraph {
    public:
     std::vector<SearchDetectorNode> nodes;
+    /// The structure of the graph. If it is shared with a MatchingGraph, the MatchingGraph owns any changes to it,
+    /// after which `update_shared_edge' must be called.
+    std::shared_ptr<MatchingGraphTopology> topology;
     size_t num_nodes;
+    /// The edges with a negative weight, as (u, v) pairs with v equal to SIZE_MAX for a boundary edge. The weights
+    /// in `topology' are the absolute values of the edge weights.
     std::vector<std::pair<size_t, size_t>> negative_weight_edges;
+    /// The ids of the edges, built by `get_edge_ids' when first needed and discarded whenever edges are added or the
+    /// topology is replaced. Shared by clones of the graph, since it only depends on the structure of the graph.
+    std::shared_ptr<const SearchEdgeIds> edge_ids;
 
     SearchGraph();
+    /// Creates a search graph with `num_nodes' nodes and no edges, which has its own topology built by `add_edge'
+    /// and `add_boundary_edge'. The observables of its edges are stored as indices, so there may be any number.
     explicit SearchGraph(size_t num_nodes);
+    /// Creates a search graph sharing the topology of `matching_graph', whose edges in `negative_weight_edges' have
+    /// negative weights.
+    SearchGraph(const MatchingGraph& matching_graph, std::vector<std::pair<size_t, size_t>> negative_weight_edges);
     SearchGraph(SearchGraph&& graph) noexcept;
     void add_edge(size_t u, size_t v, signed_weight_int weight, const std::vector<size_t>& observables);
     void add_boundary_edge(size_t u, signed_weight_int weight, const std::vector<size_t>& observables);
+    /// Changes the weight and observables of the existing edge (u, v) in place, or of the boundary edge of u if
+    /// v is SIZE_MAX. The topology is first copied if it is shared.
+    void update_edge(size_t u, size_t v, signed_weight_int weight, const std::vector<size_t>& observables);
+    /// Records that the edge (u, v) (or the boundary edge of u if v is SIZE_MAX) of the MatchingGraph whose topology
+    /// this graph shares has been changed to weight `weight' by `MatchingGraph::update_edge', and points the nodes at
+    /// `matching_graph_topology' if the change gave the MatchingGraph a new topology.
+    void update_shared_edge(
+        size_t u,
+        size_t v,
+        signed_weight_int weight,
+        const std::shared_ptr<MatchingGraphTopology>& matching_graph_topology);
+    /// Creates a new SearchGraph with fresh ephemeral state but sharing this graph's topology.
+    SearchGraph clone_sharing_topology() const;
+    /// Replaces the topology of the graph, which must have `num_nodes' nodes, and points the nodes at it.
+    void set_topology(std::shared_ptr<MatchingGraphTopology> new_topology);
+    /// The ids of the edges of the graph, which are built if they have not been already.
+    const SearchEdgeIds& get_edge_ids();
+    /// The id of `edge', which must have been built by `get_edge_ids'.
+    inline size_t edge_id(const SearchGraphEdge& edge) const {
+        return edge_ids->ids[edge_ids->offsets[edge.detector_node - nodes.data()] + edge.neighbor_index];
+    }
+    /// Calls `handle_observable' with the index of each observable crossed by `edge'.
+    template <typename Callable>
+    void iter_observables_of_edge(const SearchGraphEdge& edge, Callable handle_observable) const;
+
+   private:
+    /// Points the permanent fields of `nodes[node_id]' at its edges stored in `topology'.
+    void bind_node_to_topology(size_t node_id);
+    void bind_all_nodes_to_topology();
+    /// Makes sure that `topology' is not shared and is in the per-node layout, so that edges can be added to it.
+    void ensure_topology_is_editable();
+    /// Removes (u, v) from `negative_weight_edges', and adds it back if `weight' is negative.
+    void update_negative_weight_edge(size_t u, size_t v, signed_weight_int weight);
 };
+
+template <typename Callable>
+inline void SearchGraph::iter_observables_of_edge(const SearchGraphEdge& edge, Callable handle_observable) const {
+    if (topology->has_observable_indices) {
+        for (auto obs : topology->observable_indices_of(edge.detector_node - nodes.data(), edge.neighbor_index))
+            handle_observable(obs);
+        return;
+    }
+    obs_int obs_mask = edge.detector_node->neighbor_observables[edge.neighbor_index];
+    for (size_t k = 0; (bool)obs_mask; k++) {
+        if (obs_int_bit(obs_mask, k)) {
+            handle_observable(k);
+            obs_mask ^= (obs_int)1 << k;
+        }
+    }
+}
+
 }  // namespace pm
 
 #endif  // PYMATCHING2_SEARCH_GRAPH_H
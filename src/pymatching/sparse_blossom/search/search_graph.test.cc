@@ -17,6 +17,15 @@
 #include <gtest/gtest.h>
 #include <vector>
 
+namespace {
+
+std::vector<size_t> observables_of(const pm::SearchGraph& g, size_t node, size_t k) {
+    auto obs = g.topology->observable_indices_of(node, k);
+    return {obs.begin(), obs.end()};
+}
+
+}  // namespace
+
 TEST(SearchGraph, AddEdge) {
     pm::SearchGraph g(4);
     g.add_edge(0, 1, 2, {0});
@@ -29,9 +38,9 @@ TEST(SearchGraph, AddEdge) {
     ASSERT_EQ(g.nodes[0].neighbor_weights[0], 2);
     ASSERT_EQ(g.nodes[0].neighbor_weights[1], 10);
     std::vector<size_t> v1 = {0};
-    ASSERT_EQ(g.nodes[1].neighbor_observable_indices[0], v1);
+    ASSERT_EQ(observables_of(g, 1, 0), v1);
     std::vector<size_t> v2 = {1, 3};
-    ASSERT_EQ(g.nodes[3].neighbor_observable_indices[0], v2);
+    ASSERT_EQ(observables_of(g, 3, 0), v2);
 }
 
 TEST(SearchGraph, AddBoundaryEdge) {
@@ -43,6 +52,61 @@ TEST(SearchGraph, AddBoundaryEdge) {
     ASSERT_EQ(g.nodes[0].neighbors[1], &g.nodes[1]);
     ASSERT_EQ(g.nodes[5].neighbors[0], nullptr);
     std::vector<size_t> v1 = {2};
-    ASSERT_EQ(g.nodes[0].neighbor_observable_indices[0], v1);
+    ASSERT_EQ(observables_of(g, 0, 0), v1);
     ASSERT_EQ(g.nodes[0].neighbor_weights[0], 7);
 }
+
+TEST(SearchGraph, SharesTopologyOfMatchingGraph) {
+    pm::MatchingGraph mg(3, 100);
+    mg.add_edge(0, 1, 4, {70});
+    mg.add_edge(1, 2, -6, {1, 99});
+    mg.add_boundary_edge(2, 8, {});
+    mg.compact_topology();
+    pm::SearchGraph g(mg, {{1, 2}});
+    ASSERT_EQ(g.topology, mg.topology);
+    ASSERT_EQ(g.nodes[1].neighbors[1], &g.nodes[2]);
+    ASSERT_EQ(g.nodes[2].neighbors[0], nullptr);
+    ASSERT_EQ(g.nodes[1].neighbor_weights[1], 6);
+    std::vector<size_t> v1 = {1, 99};
+    ASSERT_EQ(observables_of(g, 2, 1), v1);
+
+    // The search graph follows a change made to the shared topology by the matching graph.
+    mg.update_edge(1, 2, -6, {1, 99}, 10, {5}, false);
+    g.update_shared_edge(1, 2, 10, mg.topology);
+    ASSERT_EQ(g.nodes[1].neighbor_weights[1], 10);
+    std::vector<size_t> v2 = {5};
+    ASSERT_EQ(observables_of(g, 1, 1), v2);
+    ASSERT_TRUE(g.negative_weight_edges.empty());
+
+    // A search graph updating its own edges stops sharing the topology.
+    g.update_edge(0, 1, 2, {3});
+    ASSERT_NE(g.topology, mg.topology);
+    ASSERT_EQ(g.nodes[0].neighbor_weights[0], 2);
+    ASSERT_EQ(mg.nodes[0].neighbor_weights[0], 4);
+}
+
+TEST(SearchGraph, EdgeIds) {
+    pm::SearchGraph g(4);
+    g.add_edge(0, 1, 2, {});
+    g.add_edge(1, 2, 3, {});
+    g.add_edge(0, 3, 10, {});
+    g.add_boundary_edge(2, 7, {});
+    auto& ids = g.get_edge_ids();
+    ASSERT_EQ(ids.num_edges(), 4);
+    std::vector<size_t> expected_endpoints = {0, 1, 0, 3, 1, 2, 2, SIZE_MAX};
+    ASSERT_EQ(ids.endpoints, expected_endpoints);
+    for (size_t i = 0; i < g.nodes.size(); i++) {
+        for (size_t k = 0; k < g.nodes[i].neighbors.size(); k++) {
+            size_t id = g.edge_id({&g.nodes[i], k});
+            auto neighbor = g.nodes[i].neighbors[k];
+            size_t j = neighbor ? neighbor - g.nodes.data() : SIZE_MAX;
+            ASSERT_EQ(ids.endpoints[2 * id], std::min(i, j));
+            ASSERT_EQ(ids.endpoints[2 * id + 1], std::max(i, j));
+        }
+    }
+
+    // Adding an edge discards the ids, since they no longer cover every edge.
+    g.add_edge(2, 3, 1, {});
+    ASSERT_EQ(g.edge_ids, nullptr);
+    ASSERT_EQ(g.get_edge_ids().num_edges(), 5);
+}
@@ -0,0 +1,120 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/search/search_landmarks.h"
+
+#include <functional>
+#include <queue>
+
+using namespace pm;
+
+namespace {
+
+/// Multi-source Dijkstra over `graph', starting from the given (node index, initial distance) sources.
+std::vector<cumulative_time_int> distances_from_sources(
+    const SearchGraph& graph, const std::vector<std::pair<size_t, cumulative_time_int>>& sources) {
+    std::vector<cumulative_time_int> distances(graph.nodes.size(), SearchLandmarks::UNREACHABLE);
+    typedef std::pair<cumulative_time_int, size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+    for (auto [node_index, dist] : sources) {
+        if (dist < distances[node_index]) {
+            distances[node_index] = dist;
+            queue.emplace(dist, node_index);
+        }
+    }
+
+    const SearchDetectorNode* first_node = graph.nodes.data();
+    while (!queue.empty()) {
+        auto [dist, node_index] = queue.top();
+        queue.pop();
+        if (dist != distances[node_index])
+            continue;
+        const SearchDetectorNode& node = graph.nodes[node_index];
+        for (size_t k = 0; k < node.neighbors.size(); k++) {
+            const SearchDetectorNode* neighbor = node.neighbors[k];
+            if (neighbor == nullptr)
+                continue;
+            size_t neighbor_index = neighbor - first_node;
+            cumulative_time_int neighbor_dist = dist + node.neighbor_weights[k];
+            if (neighbor_dist < distances[neighbor_index]) {
+                distances[neighbor_index] = neighbor_dist;
+                queue.emplace(neighbor_dist, neighbor_index);
+            }
+        }
+    }
+    return distances;
+}
+
+cumulative_time_int distance_to_boundary(const SearchGraph& graph, const std::vector<cumulative_time_int>& distances) {
+    cumulative_time_int best = SearchLandmarks::UNREACHABLE;
+    for (size_t i = 0; i < graph.nodes.size(); i++) {
+        const SearchDetectorNode& node = graph.nodes[i];
+        if (distances[i] != SearchLandmarks::UNREACHABLE && !node.neighbors.empty() && node.neighbors[0] == nullptr)
+            best = std::min(best, distances[i] + (cumulative_time_int)node.neighbor_weights[0]);
+    }
+    return best;
+}
+
+}  // namespace
+
+SearchLandmarks::SearchLandmarks(const SearchGraph& graph, size_t max_landmarks)
+    : num_nodes(graph.nodes.size()), num_landmarks(0), has_boundary_landmark(false) {
+    std::vector<std::vector<cumulative_time_int>> landmark_distances;
+    std::vector<cumulative_time_int> min_landmark_distance(num_nodes, UNREACHABLE);
+    auto add_landmark = [&](std::vector<cumulative_time_int> dists, cumulative_time_int boundary_dist) {
+        for (size_t i = 0; i < num_nodes; i++)
+            min_landmark_distance[i] = std::min(min_landmark_distance[i], dists[i]);
+        landmark_distances.push_back(std::move(dists));
+        boundary_distances.push_back(boundary_dist);
+    };
+
+    std::vector<std::pair<size_t, cumulative_time_int>> boundary_sources;
+    for (size_t i = 0; i < num_nodes; i++) {
+        const SearchDetectorNode& node = graph.nodes[i];
+        if (!node.neighbors.empty() && node.neighbors[0] == nullptr)
+            boundary_sources.push_back({i, node.neighbor_weights[0]});
+    }
+    if (max_landmarks > 0 && !boundary_sources.empty()) {
+        add_landmark(distances_from_sources(graph, boundary_sources), 0);
+        has_boundary_landmark = true;
+    }
+
+    // Farthest-point selection: the next landmark is the node farthest from all existing landmarks. Nodes not
+    // reachable from any landmark (for example in another connected component) are preferred.
+    size_t next = 0;
+    while (landmark_distances.size() < max_landmarks && num_nodes > 0) {
+        if (!landmark_distances.empty()) {
+            next = SIZE_MAX;
+            cumulative_time_int farthest = 0;
+            for (size_t i = 0; i < num_nodes; i++) {
+                if (min_landmark_distance[i] > farthest) {
+                    farthest = min_landmark_distance[i];
+                    next = i;
+                }
+            }
+            if (next == SIZE_MAX)
+                break;
+        }
+        auto dists = distances_from_sources(graph, {{next, 0}});
+        cumulative_time_int boundary_dist = distance_to_boundary(graph, dists);
+        add_landmark(std::move(dists), boundary_dist);
+    }
+
+    num_landmarks = landmark_distances.size();
+    distances.resize(num_nodes * num_landmarks);
+    for (size_t l = 0; l < num_landmarks; l++) {
+        for (size_t i = 0; i < num_nodes; i++)
+            distances[i * num_landmarks + l] = landmark_distances[l][i];
+    }
+}
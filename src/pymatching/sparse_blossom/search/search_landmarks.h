@@ -0,0 +1,89 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SEARCH_LANDMARKS_H
+#define PYMATCHING2_SEARCH_LANDMARKS_H
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "pymatching/sparse_blossom/search/search_graph.h"
+
+namespace pm {
+
+/// Shortest path distances from a few "landmarks" to every node of a SearchGraph, used as an admissible and
+/// consistent heuristic for A*-guided shortest path searches (the ALT technique). By the triangle inequality, for any
+/// landmark L the distance from v to t is at least |d(L, v) - d(L, t)|.
+///
+/// If the graph has a boundary, the boundary is always the first landmark, which makes the heuristic exact for
+/// searches to the boundary. The other landmarks are nodes chosen by farthest-point selection.
+///
+/// Shortest paths between two nodes never pass through the boundary, so the distance from a landmark to a node
+/// can exceed its distance to the boundary plus the distance from the boundary to the node. Bounds on the distance
+/// to the boundary therefore only use the one-sided inequality d(v, boundary) >= d(L, boundary) - d(L, v).
+struct SearchLandmarks {
+    static constexpr cumulative_time_int UNREACHABLE = std::numeric_limits<cumulative_time_int>::max();
+
+    size_t num_nodes;
+    size_t num_landmarks;
+    /// Whether the first landmark is the boundary.
+    bool has_boundary_landmark;
+    /// `distances[v * num_landmarks + l]' is the distance from landmark `l' to node `v', or UNREACHABLE.
+    std::vector<cumulative_time_int> distances;
+    /// `boundary_distances[l]' is the distance from landmark `l' to the boundary, or UNREACHABLE.
+    std::vector<cumulative_time_int> boundary_distances;
+
+    /// Chooses (at most) `max_landmarks' landmarks and computes their distances to every node in `graph'.
+    SearchLandmarks(const SearchGraph& graph, size_t max_landmarks);
+
+    /// The landmark distances to node `node_index', to be passed as `target_distances' to `lower_bound'.
+    inline const cumulative_time_int* distances_to_node(size_t node_index) const {
+        return distances.data() + node_index * num_landmarks;
+    }
+
+    /// A lower bound on the distance from node `node_index' to the target with the given landmark distances.
+    inline cumulative_time_int lower_bound(size_t node_index, const cumulative_time_int* target_distances) const {
+        cumulative_time_int best = 0;
+        const cumulative_time_int* node_distances = distances_to_node(node_index);
+        for (size_t l = 0; l < num_landmarks; l++) {
+            cumulative_time_int a = node_distances[l];
+            cumulative_time_int b = target_distances[l];
+            if (a == UNREACHABLE || b == UNREACHABLE)
+                continue;
+            cumulative_time_int d = a > b ? a - b : b - a;
+            if (d > best)
+                best = d;
+        }
+        return best;
+    }
+
+    /// A lower bound on the distance from node `node_index' to the boundary.
+    inline cumulative_time_int lower_bound_to_boundary(size_t node_index) const {
+        const cumulative_time_int* node_distances = distances_to_node(node_index);
+        if (has_boundary_landmark)
+            return node_distances[0] == UNREACHABLE ? 0 : node_distances[0];
+        cumulative_time_int best = 0;
+        for (size_t l = 0; l < num_landmarks; l++) {
+            if (node_distances[l] == UNREACHABLE || boundary_distances[l] == UNREACHABLE)
+                continue;
+            best = std::max(best, boundary_distances[l] - node_distances[l]);
+        }
+        return best;
+    }
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SEARCH_LANDMARKS_H
@@ -0,0 +1,78 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/search/search_landmarks.h"
+
+#include "gtest/gtest.h"
+
+TEST(SearchLandmarks, RepCodeLowerBounds) {
+    size_t num_nodes = 10;
+    pm::SearchGraph g(num_nodes);
+    g.add_boundary_edge(0, 4, {0});
+    for (size_t i = 0; i < num_nodes - 1; i++)
+        g.add_edge(i, i + 1, 2, {});
+
+    pm::SearchLandmarks landmarks(g, 2);
+    ASSERT_EQ(landmarks.num_landmarks, 2);
+    ASSERT_TRUE(landmarks.has_boundary_landmark);
+    // The boundary is the first landmark, and the node farthest from it is the second.
+    for (size_t i = 0; i < num_nodes; i++) {
+        ASSERT_EQ(landmarks.distances_to_node(i)[0], 4 + 2 * (pm::cumulative_time_int)i);
+        ASSERT_EQ(landmarks.distances_to_node(i)[1], 2 * (pm::cumulative_time_int)(num_nodes - 1 - i));
+    }
+    ASSERT_EQ(landmarks.boundary_distances[0], 0);
+    ASSERT_EQ(landmarks.boundary_distances[1], 22);
+
+    // Exact on a line, both to nodes and to the boundary.
+    for (size_t i = 0; i < num_nodes; i++) {
+        ASSERT_EQ(landmarks.lower_bound_to_boundary(i), 4 + 2 * (pm::cumulative_time_int)i);
+        for (size_t j = 0; j < num_nodes; j++) {
+            pm::cumulative_time_int d = 2 * (i > j ? i - j : j - i);
+            ASSERT_EQ(landmarks.lower_bound(i, landmarks.distances_to_node(j)), d);
+        }
+    }
+}
+
+TEST(SearchLandmarks, DisconnectedComponents) {
+    pm::SearchGraph g(4);
+    g.add_edge(0, 1, 2, {});
+    g.add_edge(2, 3, 6, {});
+    pm::SearchLandmarks landmarks(g, 3);
+    ASSERT_EQ(landmarks.num_landmarks, 3);
+    ASSERT_FALSE(landmarks.has_boundary_landmark);
+    ASSERT_EQ(landmarks.boundary_distances[0], pm::SearchLandmarks::UNREACHABLE);
+    ASSERT_EQ(landmarks.lower_bound_to_boundary(0), 0);
+    ASSERT_EQ(landmarks.lower_bound(0, landmarks.distances_to_node(1)), 2);
+    ASSERT_EQ(landmarks.lower_bound(2, landmarks.distances_to_node(3)), 6);
+    // No landmark reaches both components, so there is no useful bound between them.
+    ASSERT_EQ(landmarks.lower_bound(0, landmarks.distances_to_node(3)), 0);
+}
+
+TEST(SearchLandmarks, BoundaryBoundsWithoutBoundaryLandmark) {
+    // A line 0 - 1 - 2 - 3 with a boundary edge at node 3 only.
+    pm::SearchGraph g(4);
+    for (size_t i = 0; i < 3; i++)
+        g.add_edge(i, i + 1, 2, {});
+    g.add_boundary_edge(3, 6, {});
+    pm::SearchLandmarks landmarks(g, 3);
+    ASSERT_TRUE(landmarks.has_boundary_landmark);
+    // Drop the boundary landmark, leaving only node landmarks.
+    pm::SearchLandmarks node_landmarks = landmarks;
+    node_landmarks.has_boundary_landmark = false;
+    for (size_t i = 0; i < 4; i++) {
+        pm::cumulative_time_int exact = 6 + 2 * (3 - (pm::cumulative_time_int)i);
+        ASSERT_EQ(landmarks.lower_bound_to_boundary(i), exact);
+        ASSERT_LE(node_landmarks.lower_bound_to_boundary(i), exact);
+    }
+}
@@ -0,0 +1,71 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/search/search_path_cache.h"
+
+#include "pymatching/sparse_blossom/memory_bytes.h"
+
+pm::CachedSearchPath::CachedSearchPath() : weight(0) {
+}
+
+pm::SearchPathCache::SearchPathCache(size_t capacity) : max_size(capacity) {
+}
+
+const pm::CachedSearchPath* pm::SearchPathCache::find(size_t src, size_t dst) {
+    auto it = index.find({src, dst});
+    if (it == index.end())
+        return nullptr;
+    if (it->second != lru.begin())
+        lru.splice(lru.begin(), lru, it->second);
+    return &it->second->second;
+}
+
+const pm::CachedSearchPath& pm::SearchPathCache::insert(size_t src, size_t dst, pm::CachedSearchPath path) {
+    Key key{src, dst};
+    auto it = index.find(key);
+    if (it != index.end()) {
+        it->second->second = std::move(path);
+        lru.splice(lru.begin(), lru, it->second);
+        return lru.front().second;
+    }
+    evict_down_to(max_size - 1);
+    lru.emplace_front(key, std::move(path));
+    index.emplace(key, lru.begin());
+    return lru.front().second;
+}
+
+void pm::SearchPathCache::evict_down_to(size_t num_paths) {
+    while (lru.size() > num_paths) {
+        index.erase(lru.back().first);
+        lru.pop_back();
+    }
+}
+
+void pm::SearchPathCache::set_capacity(size_t new_capacity) {
+    max_size = new_capacity;
+    evict_down_to(max_size);
+}
+
+void pm::SearchPathCache::clear() {
+    lru.clear();
+    index.clear();
+}
+
+size_t pm::SearchPathCache::memory_bytes() const {
+    // Each node of the list also holds two links.
+    size_t total = lru.size() * (sizeof(LruList::value_type) + 2 * sizeof(void*)) + pm::memory_bytes(index);
+    for (const auto& entry : lru)
+        total += pm::memory_bytes(entry.second.edges) + pm::memory_bytes(entry.second.crossed_observables);
+    return total;
+}
@@ -0,0 +1,105 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SEARCH_PATH_CACHE_H
+#define PYMATCHING2_SEARCH_PATH_CACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "pymatching/sparse_blossom/search/search_graph.h"
+
+namespace pm {
+
+/// A shortest path found by the SearchFlooder, stored so that it does not have to be searched for again.
+struct CachedSearchPath {
+    /// The edges on the path, in the order they are visited by
+    /// `SearchFlooder::iter_edges_on_shortest_path_from_middle'.
+    std::vector<SearchGraphEdge> edges;
+    /// The (sorted) indices of the observables crossed an odd number of times by the path.
+    std::vector<size_t> crossed_observables;
+    /// The total weight of the edges on the path.
+    total_weight_int weight;
+
+    CachedSearchPath();
+};
+
+/// A bounded least-recently-used cache of shortest paths in a SearchGraph, keyed on the (src, dst) node indices
+/// given to the search. A `dst' of SIZE_MAX denotes a path to the boundary.
+///
+/// The same pairs of detection events (and short paths to the boundary) tend to be matched over and over again
+/// across shots, so caching their paths avoids most of the Dijkstra searches when decoding to edges or when
+/// decoding with more observables than fit in an `obs_int'. The cached edges point into the graph's nodes, so the
+/// cache must be cleared whenever the graph is modified.
+class SearchPathCache {
+   public:
+    /// The default maximum number of paths stored.
+    static constexpr size_t DEFAULT_CAPACITY = 8192;
+
+    explicit SearchPathCache(size_t capacity = DEFAULT_CAPACITY);
+
+    /// Returns the cached path from `src' to `dst', marking it as the most recently used, or nullptr if it is
+    /// not cached.
+    const CachedSearchPath* find(size_t src, size_t dst);
+
+    /// Stores `path' as the path from `src' to `dst', evicting the least recently used path if the cache is
+    /// full. Returns a reference to the stored path, which remains valid until the next call to `insert',
+    /// `set_capacity' or `clear'. Must not be called when the capacity is zero.
+    const CachedSearchPath& insert(size_t src, size_t dst, CachedSearchPath path);
+
+    /// Sets the maximum number of paths stored, evicting the least recently used paths if necessary. A capacity
+    /// of zero disables the cache.
+    void set_capacity(size_t new_capacity);
+    size_t capacity() const;
+    size_t size() const;
+    void clear();
+    /// The memory held by the cached paths and their index, in bytes (an estimate, since it depends on the standard
+    /// library).
+    size_t memory_bytes() const;
+
+   private:
+    struct Key {
+        size_t src;
+        size_t dst;
+        bool operator==(const Key& other) const {
+            return src == other.src && dst == other.dst;
+        }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<size_t>{}(key.src * 0x9E3779B97F4A7C15ULL ^ key.dst);
+        }
+    };
+    typedef std::list<std::pair<Key, CachedSearchPath>> LruList;
+
+    size_t max_size;
+    /// The cached paths, from most to least recently used.
+    LruList lru;
+    std::unordered_map<Key, LruList::iterator, KeyHash> index;
+
+    void evict_down_to(size_t num_paths);
+};
+
+inline size_t SearchPathCache::capacity() const {
+    return max_size;
+}
+
+inline size_t SearchPathCache::size() const {
+    return index.size();
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SEARCH_PATH_CACHE_H
@@ -0,0 +1,59 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/search/search_path_cache.h"
+
+#include "gtest/gtest.h"
+
+pm::CachedSearchPath path_with_weight(pm::total_weight_int weight) {
+    pm::CachedSearchPath path;
+    path.weight = weight;
+    return path;
+}
+
+TEST(SearchPathCache, EvictsLeastRecentlyUsedPath) {
+    pm::SearchPathCache cache(2);
+    ASSERT_EQ(cache.find(0, 1), nullptr);
+    cache.insert(0, 1, path_with_weight(10));
+    cache.insert(2, SIZE_MAX, path_with_weight(20));
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.find(1, 0), nullptr);
+
+    // Using (0, 1) makes (2, boundary) the least recently used path.
+    ASSERT_EQ(cache.find(0, 1)->weight, 10);
+    cache.insert(3, 4, path_with_weight(30));
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.find(2, SIZE_MAX), nullptr);
+    ASSERT_EQ(cache.find(0, 1)->weight, 10);
+    ASSERT_EQ(cache.find(3, 4)->weight, 30);
+
+    // Replacing an existing path does not evict anything.
+    ASSERT_EQ(cache.insert(0, 1, path_with_weight(11)).weight, 11);
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.find(3, 4)->weight, 30);
+}
+
+TEST(SearchPathCache, SetCapacityAndClear) {
+    pm::SearchPathCache cache(4);
+    for (size_t i = 0; i < 4; i++)
+        cache.insert(i, i + 1, path_with_weight(i));
+    cache.set_capacity(2);
+    ASSERT_EQ(cache.capacity(), 2);
+    ASSERT_EQ(cache.size(), 2);
+    ASSERT_EQ(cache.find(1, 2), nullptr);
+    ASSERT_EQ(cache.find(3, 4)->weight, 3);
+    cache.clear();
+    ASSERT_EQ(cache.size(), 0);
+    ASSERT_EQ(cache.find(3, 4), nullptr);
+}
@@ -0,0 +1,146 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/search/search_shortest_paths.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <string>
+
+using namespace pm;
+
+SearchShortestPathTree::SearchShortestPathTree(const SearchGraph& graph)
+    : graph(graph),
+      source(SIZE_MAX),
+      distances(graph.nodes.size(), UNREACHABLE),
+      predecessors(graph.nodes.size(), SIZE_MAX),
+      is_pending_target(graph.nodes.size(), 0),
+      boundary_distance(UNREACHABLE),
+      boundary_predecessor(SIZE_MAX) {
+}
+
+void SearchShortestPathTree::reset() {
+    for (auto n : reached_nodes) {
+        distances[n] = UNREACHABLE;
+        predecessors[n] = SIZE_MAX;
+    }
+    reached_nodes.clear();
+    boundary_distance = UNREACHABLE;
+    boundary_predecessor = SIZE_MAX;
+    queue.clear();
+}
+
+void SearchShortestPathTree::reach(size_t node, cumulative_time_int distance, size_t predecessor) {
+    if (distances[node] == UNREACHABLE)
+        reached_nodes.push_back(node);
+    distances[node] = distance;
+    predecessors[node] = predecessor;
+    queue.push_back({distance, node});
+    std::push_heap(queue.begin(), queue.end(), std::greater<>());
+}
+
+void SearchShortestPathTree::grow(size_t new_source, const std::vector<size_t>& targets) {
+    if (new_source != SIZE_MAX && new_source >= graph.nodes.size())
+        throw std::invalid_argument("node " + std::to_string(new_source) + " is not in the graph");
+    size_t num_pending_targets = 0;
+    bool wants_boundary = false;
+    for (auto t : targets) {
+        if (t == SIZE_MAX) {
+            wants_boundary = true;
+        } else if (t >= graph.nodes.size()) {
+            throw std::invalid_argument("node " + std::to_string(t) + " is not in the graph");
+        } else if (!is_pending_target[t]) {
+            is_pending_target[t] = 1;
+            num_pending_targets++;
+        }
+    }
+    sweep(new_source, num_pending_targets, wants_boundary);
+    for (auto t : targets) {
+        if (t != SIZE_MAX)
+            is_pending_target[t] = 0;
+    }
+}
+
+void SearchShortestPathTree::grow_to_all(size_t new_source) {
+    if (new_source != SIZE_MAX && new_source >= graph.nodes.size())
+        throw std::invalid_argument("node " + std::to_string(new_source) + " is not in the graph");
+    sweep(new_source, SIZE_MAX, true);
+}
+
+void SearchShortestPathTree::sweep(size_t new_source, size_t num_pending_targets, bool wants_boundary) {
+    reset();
+    source = new_source;
+    const SearchDetectorNode* first_node = graph.nodes.data();
+    if (source == SIZE_MAX) {
+        // Paths from the boundary start at each node with a boundary edge.
+        for (size_t i = 0; i < graph.nodes.size(); i++) {
+            auto& node = graph.nodes[i];
+            if (!node.neighbors.empty() && node.neighbors[0] == nullptr &&
+                (cumulative_time_int)node.neighbor_weights[0] < distances[i])
+                reach(i, node.neighbor_weights[0], SIZE_MAX);
+        }
+    } else {
+        reach(source, 0, SIZE_MAX);
+    }
+
+    while (!queue.empty()) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater<>());
+        auto [dist, node_index] = queue.back();
+        queue.pop_back();
+        if (dist != distances[node_index])
+            continue;
+        // Every node still to be settled is at least as far away, so the boundary can't be reached more cheaply.
+        if (wants_boundary && dist >= boundary_distance)
+            wants_boundary = false;
+        if (is_pending_target[node_index]) {
+            is_pending_target[node_index] = 0;
+            num_pending_targets--;
+        }
+        if (num_pending_targets == 0 && !wants_boundary)
+            break;
+
+        const SearchDetectorNode& node = graph.nodes[node_index];
+        for (size_t k = 0; k < node.neighbors.size(); k++) {
+            cumulative_time_int neighbor_dist = dist + node.neighbor_weights[k];
+            const SearchDetectorNode* neighbor = node.neighbors[k];
+            if (neighbor == nullptr) {
+                // A path can't both start and end at the boundary.
+                if (source != SIZE_MAX && neighbor_dist < boundary_distance) {
+                    boundary_distance = neighbor_dist;
+                    boundary_predecessor = node_index;
+                }
+                continue;
+            }
+            size_t neighbor_index = neighbor - first_node;
+            if (neighbor_dist < distances[neighbor_index])
+                reach(neighbor_index, neighbor_dist, node_index);
+        }
+    }
+}
+
+cumulative_time_int SearchShortestPathTree::distance_to(size_t target) const {
+    return target == SIZE_MAX ? boundary_distance : distances[target];
+}
+
+void SearchShortestPathTree::append_path_to(size_t target, std::vector<size_t>& out_nodes) const {
+    if (distance_to(target) == UNREACHABLE)
+        throw std::invalid_argument(
+            "There is no path to " + (target == SIZE_MAX ? std::string("the boundary") : std::to_string(target)) +
+            ".");
+    size_t begin = out_nodes.size();
+    for (size_t n = target == SIZE_MAX ? boundary_predecessor : target; n != SIZE_MAX; n = predecessors[n])
+        out_nodes.push_back(n);
+    std::reverse(out_nodes.begin() + begin, out_nodes.end());
+}
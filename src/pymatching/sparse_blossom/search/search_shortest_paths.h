@@ -0,0 +1,76 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SEARCH_SHORTEST_PATHS_H
+#define PYMATCHING2_SEARCH_SHORTEST_PATHS_H
+
+#include <limits>
+#include <vector>
+
+#include "pymatching/sparse_blossom/search/search_graph.h"
+
+namespace pm {
+
+/// The shortest paths from a single source (a node, or the boundary) of a SearchGraph, found by one sweep of
+/// Dijkstra's algorithm. A SearchFlooder searches from both ends of one path at a time, so this is much cheaper when
+/// many paths share a source. The sweep stops once every requested target has been reached, and its state is reset
+/// in time proportional to the number of nodes it reached, so that the same tree can be regrown from many sources.
+///
+/// The tree only reads the graph, so trees over the same graph can be grown concurrently on different threads.
+class SearchShortestPathTree {
+   public:
+    static constexpr cumulative_time_int UNREACHABLE = std::numeric_limits<cumulative_time_int>::max();
+
+    explicit SearchShortestPathTree(const SearchGraph& graph);
+
+    /// Finds the shortest paths from `source' (or from the boundary if it is SIZE_MAX) to each node in `targets'
+    /// (where SIZE_MAX is the boundary), replacing the paths found from the previous source. Paths to other nodes
+    /// may also be found, but only those to `targets' are guaranteed to be complete.
+    void grow(size_t source, const std::vector<size_t>& targets);
+    /// Finds the shortest paths from `source' (or from the boundary if it is SIZE_MAX) to every node and to the
+    /// boundary.
+    void grow_to_all(size_t source);
+
+    /// The length of the shortest path from the source to `target' (SIZE_MAX for the boundary), or UNREACHABLE.
+    /// The distance from the boundary to itself is UNREACHABLE, since a path can't start and end at the boundary.
+    cumulative_time_int distance_to(size_t target) const;
+    /// Appends the nodes on the shortest path from the source to `target', which must be reachable, from the
+    /// source to `target'. The boundary (as the source or target) is not included.
+    void append_path_to(size_t target, std::vector<size_t>& out_nodes) const;
+
+   private:
+    const SearchGraph& graph;
+    size_t source;
+    /// The distance to each node, or UNREACHABLE for nodes not yet reached.
+    std::vector<cumulative_time_int> distances;
+    /// The node preceding each reached node on its path, or SIZE_MAX if the path starts at it (at the source, or
+    /// from the boundary).
+    std::vector<size_t> predecessors;
+    /// The nodes whose distance has been set, to be reset before the next sweep.
+    std::vector<size_t> reached_nodes;
+    /// Whether each node is a target that hasn't yet been reached.
+    std::vector<uint8_t> is_pending_target;
+    cumulative_time_int boundary_distance;
+    /// The last node on the shortest path to the boundary.
+    size_t boundary_predecessor;
+    std::vector<std::pair<cumulative_time_int, size_t>> queue;
+
+    void reset();
+    void reach(size_t node, cumulative_time_int distance, size_t predecessor);
+    void sweep(size_t source, size_t num_pending_targets, bool wants_boundary);
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SEARCH_SHORTEST_PATHS_H
@@ -0,0 +1,71 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/search/search_shortest_paths.h"
+
+#include "gtest/gtest.h"
+
+TEST(SearchShortestPaths, RepCodeFromNodeAndBoundary) {
+    // A line 0 - 1 - ... - 5 with boundary edges at both ends, and a separate edge 6 - 7.
+    pm::SearchGraph g(8);
+    g.add_boundary_edge(0, 4, {});
+    for (size_t i = 0; i < 5; i++)
+        g.add_edge(i, i + 1, 2, {});
+    g.add_boundary_edge(5, 2, {});
+    g.add_edge(6, 7, 2, {});
+
+    pm::SearchShortestPathTree tree(g);
+    tree.grow_to_all(1);
+    for (size_t i = 0; i < 6; i++)
+        ASSERT_EQ(tree.distance_to(i), (pm::cumulative_time_int)(2 * (i > 1 ? i - 1 : 1 - i)));
+    ASSERT_EQ(tree.distance_to(6), pm::SearchShortestPathTree::UNREACHABLE);
+    ASSERT_EQ(tree.distance_to(SIZE_MAX), 6);
+    std::vector<size_t> path;
+    tree.append_path_to(4, path);
+    ASSERT_EQ(path, std::vector<size_t>({1, 2, 3, 4}));
+    path.clear();
+    tree.append_path_to(SIZE_MAX, path);
+    ASSERT_EQ(path, std::vector<size_t>({1, 0}));
+    ASSERT_THROW(tree.append_path_to(7, path), std::invalid_argument);
+
+    // Regrowing from the boundary replaces the previous tree.
+    tree.grow(SIZE_MAX, {3, 0});
+    ASSERT_EQ(tree.distance_to(3), 6);
+    ASSERT_EQ(tree.distance_to(0), 4);
+    ASSERT_EQ(tree.distance_to(SIZE_MAX), pm::SearchShortestPathTree::UNREACHABLE);
+    path.clear();
+    tree.append_path_to(3, path);
+    ASSERT_EQ(path, std::vector<size_t>({5, 4, 3}));
+    path.clear();
+    tree.append_path_to(0, path);
+    ASSERT_EQ(path, std::vector<size_t>({0}));
+}
+
+TEST(SearchShortestPaths, StopsOnceTargetsAreReached) {
+    pm::SearchGraph g(10);
+    for (size_t i = 0; i < 9; i++)
+        g.add_edge(i, i + 1, 2, {});
+    pm::SearchShortestPathTree tree(g);
+    tree.grow(0, {2});
+    ASSERT_EQ(tree.distance_to(2), 4);
+    // Nodes beyond the target are never settled, so at most the next one is reached.
+    ASSERT_EQ(tree.distance_to(9), pm::SearchShortestPathTree::UNREACHABLE);
+
+    tree.grow(9, {9, 7});
+    ASSERT_EQ(tree.distance_to(9), 0);
+    ASSERT_EQ(tree.distance_to(7), 4);
+    ASSERT_EQ(tree.distance_to(0), pm::SearchShortestPathTree::UNREACHABLE);
+    ASSERT_THROW(tree.grow(10, {}), std::invalid_argument);
+    ASSERT_THROW(tree.grow(0, {10}), std::invalid_argument);
+}
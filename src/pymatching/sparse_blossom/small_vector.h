@@ -0,0 +1,208 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_SMALL_VECTOR_H
+#define PYMATCHING2_SMALL_VECTOR_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace pm {
+
+/// A vector of trivially copyable values that stores up to `N` of them inline, and only allocates heap memory if
+/// it grows beyond that. Used for per-region lists that are usually very short, so that creating and destroying
+/// regions does not churn the allocator.
+template <typename T, size_t N>
+class SmallVector {
+    static_assert(std::is_trivially_copyable_v<T>, "SmallVector only supports trivially copyable types.");
+    static_assert(N > 0, "SmallVector needs some inline capacity.");
+
+   public:
+    typedef T value_type;
+    typedef T* iterator;
+    typedef const T* const_iterator;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+
+    SmallVector() : _data(inline_data()), _size(0), _capacity(N) {
+    }
+    SmallVector(std::initializer_list<T> values) : SmallVector() {
+        assign(values.begin(), values.end());
+    }
+    SmallVector(const SmallVector& other) : SmallVector() {
+        assign(other.begin(), other.end());
+    }
+    SmallVector(SmallVector&& other) noexcept : SmallVector() {
+        steal(other);
+    }
+    SmallVector& operator=(const SmallVector& other) {
+        if (this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            release_heap();
+            _data = inline_data();
+            _capacity = N;
+            _size = 0;
+            steal(other);
+        }
+        return *this;
+    }
+    ~SmallVector() {
+        release_heap();
+    }
+
+    template <typename It>
+    void assign(It first, It last) {
+        _size = 0;
+        reserve((size_t)std::distance(first, last));
+        for (; first != last; ++first)
+            _data[_size++] = *first;
+    }
+
+    inline void push_back(const T& value) {
+        if (_size == _capacity)
+            reserve(_capacity * 2);
+        _data[_size++] = value;
+    }
+    inline void pop_back() {
+        _size--;
+    }
+    inline void clear() {
+        _size = 0;
+    }
+    void reserve(size_t new_capacity) {
+        if (new_capacity <= _capacity)
+            return;
+        T* new_data = (T*)malloc(new_capacity * sizeof(T));
+        if (new_data == nullptr)
+            throw std::bad_alloc();
+        if (_size)
+            memcpy((void*)new_data, (const void*)_data, _size * sizeof(T));
+        release_heap();
+        _data = new_data;
+        _capacity = new_capacity;
+    }
+
+    inline T& operator[](size_t k) {
+        return _data[k];
+    }
+    inline const T& operator[](size_t k) const {
+        return _data[k];
+    }
+    inline T& back() {
+        return _data[_size - 1];
+    }
+    inline const T& back() const {
+        return _data[_size - 1];
+    }
+    inline T* data() {
+        return _data;
+    }
+    inline const T* data() const {
+        return _data;
+    }
+    inline T* begin() {
+        return _data;
+    }
+    inline T* end() {
+        return _data + _size;
+    }
+    inline const T* begin() const {
+        return _data;
+    }
+    inline const T* end() const {
+        return _data + _size;
+    }
+    inline size_t size() const {
+        return _size;
+    }
+    inline bool empty() const {
+        return _size == 0;
+    }
+    inline size_t capacity() const {
+        return _capacity;
+    }
+    /// True if the values are stored inside the SmallVector itself, rather than on the heap.
+    inline bool is_inline() const {
+        return _data == inline_data();
+    }
+
+    bool operator==(const SmallVector& other) const {
+        return equal_to(other.begin(), other.size());
+    }
+    bool operator!=(const SmallVector& other) const {
+        return !(*this == other);
+    }
+    bool operator==(const std::vector<T>& other) const {
+        return equal_to(other.data(), other.size());
+    }
+    bool operator!=(const std::vector<T>& other) const {
+        return !(*this == other);
+    }
+
+   private:
+    T* _data;
+    size_t _size;
+    size_t _capacity;
+    alignas(T) unsigned char _inline_storage[N * sizeof(T)];
+
+    inline T* inline_data() {
+        return reinterpret_cast<T*>(_inline_storage);
+    }
+    inline const T* inline_data() const {
+        return reinterpret_cast<const T*>(_inline_storage);
+    }
+    inline void release_heap() {
+        if (!is_inline())
+            free(_data);
+    }
+    /// Takes the values of `other' (which must be distinct from this, and which this assumes holds no heap memory),
+    /// leaving `other' empty.
+    void steal(SmallVector& other) {
+        if (other.is_inline()) {
+            memcpy((void*)inline_data(), (const void*)other.inline_data(), other._size * sizeof(T));
+            _size = other._size;
+        } else {
+            _data = other._data;
+            _size = other._size;
+            _capacity = other._capacity;
+            other._data = other.inline_data();
+            other._capacity = N;
+        }
+        other._size = 0;
+    }
+    bool equal_to(const T* other_data, size_t other_size) const {
+        if (_size != other_size)
+            return false;
+        for (size_t k = 0; k < _size; k++) {
+            if (!(_data[k] == other_data[k]))
+                return false;
+        }
+        return true;
+    }
+};
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_SMALL_VECTOR_H
@@ -0,0 +1,79 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/small_vector.h"
+
+#include <gtest/gtest.h>
+
+using namespace pm;
+
+TEST(SmallVector, PushBackPastInlineCapacity) {
+    SmallVector<int, 4> v;
+    ASSERT_TRUE(v.empty());
+    ASSERT_TRUE(v.is_inline());
+    for (int k = 0; k < 4; k++)
+        v.push_back(k);
+    ASSERT_TRUE(v.is_inline());
+    ASSERT_EQ(v.back(), 3);
+    v.push_back(4);
+    ASSERT_FALSE(v.is_inline());
+    for (int k = 5; k < 100; k++)
+        v.push_back(k);
+    ASSERT_EQ(v.size(), 100);
+    for (int k = 0; k < 100; k++)
+        ASSERT_EQ(v[k], k);
+    v.pop_back();
+    ASSERT_EQ(v.back(), 98);
+    v.clear();
+    ASSERT_TRUE(v.empty());
+}
+
+TEST(SmallVector, CopyAndMove) {
+    for (size_t n : {2, 10}) {
+        SmallVector<int, 4> v;
+        std::vector<int> expected;
+        for (size_t k = 0; k < n; k++) {
+            v.push_back((int)k);
+            expected.push_back((int)k);
+        }
+        SmallVector<int, 4> copy = v;
+        ASSERT_EQ(copy, expected);
+        ASSERT_EQ(copy, v);
+
+        SmallVector<int, 4> moved = std::move(v);
+        ASSERT_EQ(moved, expected);
+        ASSERT_TRUE(v.empty());
+        ASSERT_TRUE(v.is_inline());
+        v.push_back(7);
+        ASSERT_EQ(v, std::vector<int>({7}));
+
+        copy = {1, 2, 3};
+        ASSERT_EQ(copy, std::vector<int>({1, 2, 3}));
+        copy = std::move(moved);
+        ASSERT_EQ(copy, expected);
+        ASSERT_NE(copy, v);
+    }
+}
+
+TEST(SmallVector, Assign) {
+    std::vector<int> values = {5, 6, 7, 8, 9, 10};
+    SmallVector<int, 2> v;
+    v.assign(values.begin(), values.begin() + 2);
+    ASSERT_TRUE(v.is_inline());
+    ASSERT_EQ(v, std::vector<int>({5, 6}));
+    v.assign(values.begin(), values.end());
+    ASSERT_FALSE(v.is_inline());
+    ASSERT_EQ(v, values);
+    ASSERT_EQ(std::vector<int>(v.begin(), v.end()), values);
+}
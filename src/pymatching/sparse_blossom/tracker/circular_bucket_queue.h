@@ -0,0 +1,288 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_CIRCULAR_BUCKET_QUEUE_H
+#define PYMATCHING2_CIRCULAR_BUCKET_QUEUE_H
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+#include "pymatching/sparse_blossom/decoder_stats.h"
+#include "pymatching/sparse_blossom/ints.h"
+#include "pymatching/sparse_blossom/tracker/cyclic.h"
+#include "pymatching/sparse_blossom/tracker/flood_check_event.h"
+
+namespace pm {
+
+/// A monotonic priority queue for TentativeEvents, specialized for events that are scheduled a short time
+/// into the future.
+///
+/// Has the same interface and the same monotonicity requirement as `radix_heap_queue', and can be used in its
+/// place (e.g. as the queue of a `BasicGraphFlooder' or `BasicSearchFlooder'). The queue keeps a circular
+/// array of `num_buckets' buckets (a power of two), with bucket `t % num_buckets' holding the events at time
+/// t for each t in [cur_time, cur_time + num_buckets). Enqueueing such an event is a single push, and
+/// dequeueing scans forward from the current time to the next non-empty bucket, without ever redistributing
+/// events between buckets.
+///
+/// The flooder schedules most events less than one edge weight into the future, so this is fast when the
+/// edge weights are small compared to the number of buckets. Events further into the future (e.g. the
+/// shrinking of a blossom with a large radius) are held in an overflow binary heap, and are moved into the
+/// circular array once the current time gets close enough to them.
+template <bool use_validation>
+struct circular_bucket_queue {
+    static constexpr bool has_handles = false;
+    static constexpr bool has_compact_events = false;
+    std::vector<std::vector<FloodCheckEvent>> buckets;
+    size_t bucket_mask;
+    pm::cumulative_time_int cur_time;
+    size_t _num_enqueued;
+    /// The number of events enqueued since this was last reset by the user of the queue (a flooder moves it into
+    /// its `DecoderStats' whenever it dequeues). Only counted if DECODER_STATS_ENABLED.
+    size_t num_pushes;
+    /// Events that were at least `buckets.size()' after the current time when they were enqueued, as a binary
+    /// heap with the earliest event at the front.
+    std::vector<FloodCheckEvent> overflow;
+
+    explicit circular_bucket_queue(size_t num_buckets = 1024)
+        : buckets(std::bit_ceil(std::max(num_buckets, (size_t)1))),
+          bucket_mask(buckets.size() - 1),
+          cur_time{0},
+          _num_enqueued(0),
+          num_pushes(0) {
+    }
+
+    size_t size() const {
+        return _num_enqueued;
+    }
+
+    bool empty() const {
+        return _num_enqueued == 0;
+    }
+
+    /// Makes room for `num_events' events in the overflow heap, and for a share of them in each bucket, since events
+    /// enqueued at once are spread over about one edge weight of time. A bucket may still grow if many events fall
+    /// on the same time.
+    void reserve(size_t num_events) {
+        overflow.reserve(num_events);
+        size_t per_bucket = num_events / 16 + 1;
+        for (auto &bucket : buckets)
+            bucket.reserve(per_bucket);
+    }
+
+    /// The total number of events that fit in the memory currently owned by the buckets and the overflow heap.
+    size_t capacity() const {
+        size_t total = overflow.capacity();
+        for (const auto &bucket : buckets)
+            total += bucket.capacity();
+        return total;
+    }
+
+    /// The number of bytes of memory owned by the queue.
+    size_t memory_bytes() const {
+        return capacity() * sizeof(FloodCheckEvent) + buckets.capacity() * sizeof(std::vector<FloodCheckEvent>);
+    }
+
+    /// Adds an event to the priority queue.
+    ///
+    /// The event MUST NOT be cycle-before the current time.
+    void enqueue(FloodCheckEvent event) {
+        if (use_validation) {
+            if (event.time < cyclic_time_int{cur_time}) {
+                std::stringstream ss;
+                ss << "Attempted to schedule an event cycle-before the present.\n";
+                ss << "    current time: " << cur_time << "\n";
+                ss << "    tentative event: " << event << "\n";
+                throw std::invalid_argument(ss.str());
+            }
+        }
+        auto t = event.time.widen_from_nearby_reference(cur_time);
+        if ((size_t)(t - cur_time) < buckets.size()) {
+            buckets[t & bucket_mask].push_back(event);
+        } else {
+            overflow.push_back(event);
+            std::push_heap(overflow.begin(), overflow.end(), later_than);
+        }
+        _num_enqueued++;
+        if constexpr (DECODER_STATS_ENABLED)
+            num_pushes++;
+    }
+
+    static inline bool later_than(const FloodCheckEvent &e1, const FloodCheckEvent &e2) {
+        return e1.time > e2.time;
+    }
+
+    /// Whether the earliest overflow event is now less than `buckets.size()' after the current time.
+    inline bool overflow_is_due() const {
+        return !overflow.empty() && (size_t)(overflow[0].time - cyclic_time_int{cur_time}).value < buckets.size();
+    }
+
+    /// Moves the overflow events that are now less than `buckets.size()' after the current time into the
+    /// circular array.
+    void take_from_overflow() {
+        while (overflow_is_due()) {
+            std::pop_heap(overflow.begin(), overflow.end(), later_than);
+            auto t = overflow.back().time.widen_from_nearby_reference(cur_time);
+            buckets[t & bucket_mask].push_back(overflow.back());
+            overflow.pop_back();
+        }
+    }
+
+    /// Checks if all events are in the correct bucket.
+    bool satisfies_invariants() const {
+        for (size_t b = 0; b < buckets.size(); b++) {
+            for (const auto &e : buckets[b]) {
+                auto t = e.time.widen_from_nearby_reference(cur_time);
+                if (t < cur_time || (size_t)(t - cur_time) >= buckets.size() || (size_t)(t & bucket_mask) != b) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /// The time of the event that `dequeue' would return next, without dequeuing it or advancing the current time.
+    ///
+    /// The queue MUST NOT be empty.
+    cumulative_time_int next_event_time() const {
+        // The earliest overflow event may be due sooner than some events of the circular array.
+        cumulative_time_int best = std::numeric_limits<cumulative_time_int>::max();
+        if (!overflow.empty())
+            best = overflow[0].time.widen_from_nearby_reference(cur_time);
+        if (_num_enqueued != overflow.size()) {
+            for (cumulative_time_int t = cur_time; t < best; t++) {
+                if (!buckets[t & bucket_mask].empty())
+                    return t;
+            }
+        }
+        return best;
+    }
+
+    /// The event that `dequeue' will most likely return `ahead' dequeues from now (0 for the next one; overflow
+    /// events are not considered), if it is due at the current time, or else nullptr. Unlike `next_event_time', this
+    /// never scans the buckets.
+    const FloodCheckEvent *peek_due_now(size_t ahead = 0) const {
+        auto &bucket = buckets[cur_time & bucket_mask];
+        return ahead < bucket.size() ? &bucket[bucket.size() - 1 - ahead] : nullptr;
+    }
+
+    /// Dequeues the next event.
+    ///
+    /// If the queue is empty, a tentative event with type NO_TENTATIVE_EVENT is returned.
+    FloodCheckEvent dequeue() {
+        if (_num_enqueued == 0)
+            return FloodCheckEvent(cyclic_time_int{0});
+        while (true) {
+            take_from_overflow();
+            auto &bucket = buckets[cur_time & bucket_mask];
+            if (!bucket.empty()) {
+                _num_enqueued--;
+                FloodCheckEvent result = bucket.back();
+                bucket.pop_back();
+                return result;
+            }
+            if (_num_enqueued == overflow.size()) {
+                // The circular array is empty, so skip ahead to the earliest overflow event.
+                cur_time = overflow[0].time.widen_from_nearby_reference(cur_time);
+            } else {
+                cur_time++;
+            }
+        }
+    }
+
+    /// Lists the sorted events in the queue.
+    ///
+    /// This method mostly exacts to facilitate testing. It doesn't really make sense to use it
+    /// during normal operation.
+    std::vector<FloodCheckEvent> to_vector() const {
+        std::vector<FloodCheckEvent> result = overflow;
+        for (const auto &bucket : buckets) {
+            result.insert(result.end(), bucket.begin(), bucket.end());
+        }
+        auto reference = cur_time;
+        std::sort(result.begin(), result.end(), [&](const FloodCheckEvent &e1, const FloodCheckEvent &e2) {
+            return e1.time.widen_from_nearby_reference(reference) < e2.time.widen_from_nearby_reference(reference);
+        });
+        return result;
+    }
+
+    std::string str() const;
+
+    /// Clear all remaining events from the queue
+    void clear();
+
+    /// Clear the queue and set cur_time = 0
+    void reset();
+};
+
+template <bool use_validation>
+std::ostream &operator<<(std::ostream &out, const circular_bucket_queue<use_validation> &q) {
+    out << "circular_bucket_queue {\n";
+    out << "    cur_time=" << q.cur_time << "\n";
+    for (size_t k = 0; k < q.buckets.size(); k++) {
+        const auto &bucket = q.buckets[(q.cur_time + k) & q.bucket_mask];
+        if (!bucket.empty()) {
+            out << "    bucket[" << ((q.cur_time + k) & q.bucket_mask) << "] {\n";
+            for (auto &e : bucket) {
+                out << "        " << e << ",\n";
+            }
+            out << "    }\n";
+        }
+    }
+    if (!q.overflow.empty()) {
+        auto copy = q.overflow;
+        std::sort(copy.begin(), copy.end(), [](const FloodCheckEvent &e1, const FloodCheckEvent &e2) {
+            return e1.time < e2.time;
+        });
+        out << "    overflow {\n";
+        for (auto &e : copy) {
+            out << "        " << e << ",\n";
+        }
+        out << "    }\n";
+    }
+    out << "}";
+    return out;
+}
+
+template <bool use_validation>
+std::string circular_bucket_queue<use_validation>::str() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+}
+
+template <bool use_validation>
+void circular_bucket_queue<use_validation>::clear() {
+    size_t k = 0;
+    while (_num_enqueued > overflow.size()) {
+        auto &bucket = buckets[(cur_time + k) & bucket_mask];
+        _num_enqueued -= bucket.size();
+        bucket.clear();
+        k++;
+    }
+    _num_enqueued = 0;
+    overflow.clear();
+}
+
+template <bool use_validation>
+void circular_bucket_queue<use_validation>::reset() {
+    clear();
+    cur_time = 0;
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_CIRCULAR_BUCKET_QUEUE_H
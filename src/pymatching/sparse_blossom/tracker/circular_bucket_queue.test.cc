@@ -0,0 +1,138 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/tracker/circular_bucket_queue.h"
+
+#include <gtest/gtest.h>
+#include <random>
+
+#include "pymatching/sparse_blossom/tracker/radix_heap_queue.h"
+
+using namespace pm;
+
+TEST(circular_bucket_queue, basic_usage) {
+    circular_bucket_queue<true> q(16);
+    ASSERT_EQ(q.buckets.size(), 16);
+    ASSERT_EQ(q.size(), 0);
+    ASSERT_EQ(q.cur_time, 0);
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+
+    q.enqueue(FloodCheckEvent(cyclic_time_int{9}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.size(), 2);
+    ASSERT_EQ(q.cur_time, 0);
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{9}));
+    ASSERT_EQ(q.size(), 0);
+    ASSERT_EQ(q.cur_time, 9);
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+}
+
+TEST(circular_bucket_queue, num_buckets_rounded_up_to_power_of_two) {
+    ASSERT_EQ(circular_bucket_queue<true>(0).buckets.size(), 1);
+    ASSERT_EQ(circular_bucket_queue<true>(5).buckets.size(), 8);
+    ASSERT_EQ(circular_bucket_queue<true>(64).buckets.size(), 64);
+}
+
+TEST(circular_bucket_queue, overflow) {
+    circular_bucket_queue<true> q(8);
+    q.enqueue(FloodCheckEvent(cyclic_time_int{20}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{2}));
+    ASSERT_EQ(q.overflow.size(), 1);
+    ASSERT_EQ(
+        q.to_vector(),
+        (std::vector<FloodCheckEvent>{FloodCheckEvent(cyclic_time_int{2}), FloodCheckEvent(cyclic_time_int{20})}));
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{2}));
+    // Fits in the circular array now, but is still later than the overflowing event.
+    q.enqueue(FloodCheckEvent(cyclic_time_int{21}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{8}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{8}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{20}));
+    ASSERT_EQ(q.overflow.size(), 0);
+    ASSERT_TRUE(q.satisfies_invariants());
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{21}));
+    ASSERT_TRUE(q.empty());
+}
+
+TEST(circular_bucket_queue, sorts_fuzz) {
+    for (size_t num_buckets : {1, 64, 1 << 16}) {
+        circular_bucket_queue<true> q(num_buckets);
+        std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+
+        std::vector<cyclic_time_int> s;
+        for (size_t k = 0; k < 1000; k++) {
+            auto v = cyclic_time_int{rng() & 0x00007FFF};
+            s.push_back(v);
+            q.enqueue(FloodCheckEvent(v));
+        }
+        std::sort(s.begin(), s.end());
+        ASSERT_TRUE(q.satisfies_invariants());
+
+        for (size_t k = 0; k < s.size(); k++) {
+            auto t = q.dequeue().time;
+            ASSERT_EQ(t, s[k]) << k;
+        }
+
+        ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+    }
+}
+
+TEST(circular_bucket_queue, matches_radix_heap_queue_when_streaming) {
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+    circular_bucket_queue<true> q(32);
+    radix_heap_queue<true> r;
+    for (size_t k = 0; k < 10000; k++) {
+        if (q.empty() || rng() % 3) {
+            // Mostly near future events, and occasionally far future ones.
+            auto delay = rng() % 8 == 0 ? rng() % 1000 : rng() % 40;
+            auto t = cyclic_time_int{q.cur_time + delay};
+            q.enqueue(FloodCheckEvent(t));
+            r.enqueue(FloodCheckEvent(t));
+        } else {
+            auto next_time = q.next_event_time();
+            ASSERT_EQ(next_time, r.next_event_time()) << k;
+            ASSERT_EQ(q.dequeue().time, r.dequeue().time) << k;
+            ASSERT_EQ(q.cur_time, r.cur_time);
+            ASSERT_EQ(q.cur_time, next_time);
+        }
+        ASSERT_EQ(q.size(), r.size());
+    }
+}
+
+TEST(circular_bucket_queue, clear_and_reset) {
+    circular_bucket_queue<true> q(4);
+    q.enqueue(FloodCheckEvent(cyclic_time_int{1}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{100}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{1}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{2}));
+    q.clear();
+    ASSERT_TRUE(q.empty());
+    ASSERT_EQ(q.cur_time, 1);
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+
+    q.enqueue(FloodCheckEvent(cyclic_time_int{50}));
+    q.reset();
+    ASSERT_EQ(q.cur_time, 0);
+    ASSERT_TRUE(q.empty());
+
+    // The overflow queue follows the current time after it has been reset.
+    q.enqueue(FloodCheckEvent(cyclic_time_int{10}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{10}));
+}
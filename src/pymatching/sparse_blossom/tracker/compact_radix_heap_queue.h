@@ -0,0 +1,464 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_COMPACT_RADIX_HEAP_QUEUE_H
+#define PYMATCHING2_COMPACT_RADIX_HEAP_QUEUE_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "pymatching/sparse_blossom/decoder_stats.h"
+#include "pymatching/sparse_blossom/ints.h"
+#include "pymatching/sparse_blossom/search/search_detector_node.h"
+#include "pymatching/sparse_blossom/tracker/cyclic.h"
+#include "pymatching/sparse_blossom/tracker/flood_check_event.h"
+#include "pymatching/sparse_blossom/tracker/radix_heap_queue.h"
+
+namespace pm {
+
+/// A FloodCheckEvent packed into 8 bytes: the index of what the event looks at, shifted left by two bits and tagged
+/// with the event type in the low two bits, next to the time of the event.
+struct CompactFloodCheckEvent {
+    uint32_t target = 0;
+    cyclic_time_int time{0};
+};
+
+/// The part of the pool of a `compact_radix_heap_queue' holding the events of a bucket: `size' events starting at
+/// `begin', with room for `capacity' events.
+struct BucketSegment {
+    size_t begin = 0;
+    size_t size = 0;
+    size_t capacity = 0;
+};
+
+/// The largest number of nodes, or of queued region events, that a `compact_radix_heap_queue' can refer to.
+constexpr size_t COMPACT_QUEUE_MAX_TARGETS = (size_t)1 << 30;
+
+/// A `radix_heap_queue' that stores its events compactly, for better cache use when many events are queued.
+///
+/// The events of all the buckets are kept in one pooled buffer, with a segment of it for each bucket, instead of in
+/// a separate vector per bucket. Refilling bucket 0 from bucket 1 swaps their segments, and redistributing a bucket
+/// moves events within the buffer. A bucket whose segment is full is given a larger segment by laying out the buffer
+/// again, which rarely happens once the queue has been used for a few shots, since the segments are kept when the
+/// queue is cleared.
+///
+/// Each event is stored as a `CompactFloodCheckEvent' of 8 bytes rather than a FloodCheckEvent of 16 bytes, by
+/// referring to its detector node or search detector node by its index in the nodes bound with `bind_nodes' or
+/// `bind_search_nodes' (which the flooders do whenever their graph may have moved, see
+/// `BasicGraphFlooder::bind_queue_to_graph'). The regions of shrinking region events are not stored contiguously, so
+/// they are instead kept in a table of slots, and the event refers to the region's slot, which is freed when the
+/// event is dequeued.
+///
+/// Has the same interface as `radix_heap_queue' without handles, except that `peek_due_now' returns a copy of the
+/// event, since events are not stored as FloodCheckEvents.
+template <bool use_validation>
+struct compact_radix_heap_queue {
+    static constexpr bool has_handles = false;
+    static constexpr bool has_compact_events = true;
+    static constexpr size_t NUM_BUCKETS = sizeof(pm::cyclic_time_int) * 8 + 1;
+
+    /// The events of every bucket, in the segment of the pool of each bucket.
+    std::vector<CompactFloodCheckEvent> pool;
+    std::array<BucketSegment, NUM_BUCKETS> segments;
+    pm::cumulative_time_int cur_time;
+    size_t _num_enqueued;
+    /// The number of events enqueued since this was last reset by the user of the queue (a flooder moves it into
+    /// its `DecoderStats' whenever it dequeues). Only counted if DECODER_STATS_ENABLED.
+    size_t num_pushes;
+
+    /// The nodes that events refer to by index.
+    DetectorNode *nodes;
+    size_t num_nodes;
+    SearchDetectorNode *search_nodes;
+    size_t num_search_nodes;
+    /// The region of each queued shrinking region event, by slot, and the slots that are free.
+    std::vector<GraphFillRegion *> region_slots;
+    std::vector<uint32_t> free_region_slots;
+
+    compact_radix_heap_queue()
+        : segments{},
+          cur_time{0},
+          _num_enqueued(0),
+          num_pushes(0),
+          nodes(nullptr),
+          num_nodes(0),
+          search_nodes(nullptr),
+          num_search_nodes(0) {
+    }
+
+    size_t size() const {
+        return _num_enqueued;
+    }
+
+    bool empty() const {
+        return _num_enqueued == 0;
+    }
+
+    /// Sets the detector nodes that LOOK_AT_NODE events refer to by index. Must be called again if they move, and
+    /// the queue must not hold any LOOK_AT_NODE events when it is.
+    void bind_nodes(DetectorNode *first_node, size_t count) {
+        if (count > COMPACT_QUEUE_MAX_TARGETS)
+            throw std::invalid_argument("A compact_radix_heap_queue can't refer to more than 2^30 nodes.");
+        nodes = first_node;
+        num_nodes = count;
+    }
+
+    /// Sets the search detector nodes that LOOK_AT_SEARCH_NODE events refer to by index. Must be called again if
+    /// they move, and the queue must not hold any LOOK_AT_SEARCH_NODE events when it is.
+    void bind_search_nodes(SearchDetectorNode *first_node, size_t count) {
+        if (count > COMPACT_QUEUE_MAX_TARGETS)
+            throw std::invalid_argument("A compact_radix_heap_queue can't refer to more than 2^30 nodes.");
+        search_nodes = first_node;
+        num_search_nodes = count;
+    }
+
+    /// Makes room for `num_events' events in each bucket, so that that many events can be enqueued at once without
+    /// allocating memory, however they are spread over the buckets.
+    void reserve(size_t num_events) {
+        std::array<size_t, NUM_BUCKETS> new_capacity;
+        bool enough = true;
+        for (size_t b = 0; b < NUM_BUCKETS; b++) {
+            new_capacity[b] = std::max(segments[b].capacity, num_events);
+            enough &= segments[b].capacity >= num_events;
+        }
+        if (!enough)
+            lay_out_pool(new_capacity);
+        region_slots.reserve(num_events);
+        free_region_slots.reserve(num_events);
+    }
+
+    /// The total number of events that fit in the memory currently owned by the buckets.
+    size_t capacity() const {
+        return pool.size();
+    }
+
+    /// The number of bytes of memory owned by the queue.
+    size_t memory_bytes() const {
+        return pool.capacity() * sizeof(CompactFloodCheckEvent) + region_slots.capacity() * sizeof(GraphFillRegion *) +
+               free_region_slots.capacity() * sizeof(uint32_t);
+    }
+
+    /// Determines which bucket an event with the given time should go into.
+    inline size_t cur_bit_bucket_for(cyclic_time_int time) const {
+        return std::bit_width((uint64_t)(time.value ^ cyclic_time_int{cur_time}.value));
+    }
+
+    inline void validate(const FloodCheckEvent &event) const {
+        if (use_validation) {
+            if (event.time < cyclic_time_int{cur_time}) {
+                std::stringstream ss;
+                ss << "Attempted to schedule an event cycle-before the present.\n";
+                ss << "    current time: " << cur_time << "\n";
+                ss << "    tentative event: " << event << "\n";
+                throw std::invalid_argument(ss.str());
+            }
+            bool in_bounds = true;
+            if (event.tentative_event_type == LOOK_AT_NODE) {
+                in_bounds = event.data_look_at_node >= nodes && event.data_look_at_node < nodes + num_nodes;
+            } else if (event.tentative_event_type == LOOK_AT_SEARCH_NODE) {
+                in_bounds = event.data_look_at_search_node >= search_nodes &&
+                            event.data_look_at_search_node < search_nodes + num_search_nodes;
+            }
+            if (!in_bounds) {
+                std::stringstream ss;
+                ss << "Attempted to schedule an event at a node that isn't bound to the queue.\n";
+                ss << "    tentative event: " << event << "\n";
+                throw std::invalid_argument(ss.str());
+            }
+        }
+    }
+
+    /// Packs an event, taking a region slot for a shrinking region event.
+    inline CompactFloodCheckEvent encode(const FloodCheckEvent &event) {
+        size_t index = 0;
+        switch (event.tentative_event_type) {
+            case LOOK_AT_NODE:
+                index = event.data_look_at_node - nodes;
+                break;
+            case LOOK_AT_SEARCH_NODE:
+                index = event.data_look_at_search_node - search_nodes;
+                break;
+            case LOOK_AT_SHRINKING_REGION:
+                if (free_region_slots.empty()) {
+                    index = region_slots.size();
+                    region_slots.push_back(event.data_look_at_shrinking_region);
+                } else {
+                    index = free_region_slots.back();
+                    free_region_slots.pop_back();
+                    region_slots[index] = event.data_look_at_shrinking_region;
+                }
+                break;
+            case NO_FLOOD_CHECK_EVENT:
+                break;
+        }
+        return {(uint32_t)(index << 2) | (uint32_t)event.tentative_event_type, event.time};
+    }
+
+    /// Unpacks an event, without freeing its region slot.
+    inline FloodCheckEvent decode(CompactFloodCheckEvent event) const {
+        size_t index = event.target >> 2;
+        switch ((FloodCheckEventType)(event.target & 3)) {
+            case LOOK_AT_NODE:
+                return {nodes + index, event.time};
+            case LOOK_AT_SEARCH_NODE:
+                return {search_nodes + index, event.time};
+            case LOOK_AT_SHRINKING_REGION:
+                return {region_slots[index], event.time};
+            default:
+                return FloodCheckEvent(event.time);
+        }
+    }
+
+    /// Gives bucket b a larger segment of the pool, with room for at least `min_capacity' events.
+    void grow_bucket(size_t b, size_t min_capacity) {
+        std::array<size_t, NUM_BUCKETS> new_capacity;
+        for (size_t b2 = 0; b2 < NUM_BUCKETS; b2++)
+            new_capacity[b2] = segments[b2].capacity;
+        new_capacity[b] = std::max({min_capacity, 2 * segments[b].capacity, (size_t)8});
+        lay_out_pool(new_capacity);
+    }
+
+    /// Moves the segments of the buckets into a new pool, where they have the given capacities.
+    void lay_out_pool(const std::array<size_t, NUM_BUCKETS> &new_capacity) {
+        size_t total = 0;
+        for (auto c : new_capacity)
+            total += c;
+        std::vector<CompactFloodCheckEvent> new_pool(total);
+        size_t begin = 0;
+        for (size_t b = 0; b < NUM_BUCKETS; b++) {
+            auto &segment = segments[b];
+            std::copy_n(pool.begin() + segment.begin, segment.size, new_pool.begin() + begin);
+            segment.begin = begin;
+            segment.capacity = new_capacity[b];
+            begin += new_capacity[b];
+        }
+        pool.swap(new_pool);
+    }
+
+    inline void push_to_bucket(size_t b, CompactFloodCheckEvent event) {
+        auto &segment = segments[b];
+        if (segment.size == segment.capacity) {
+            grow_bucket(b, segment.size + 1);
+        }
+        pool[segment.begin + segment.size] = event;
+        segment.size++;
+    }
+
+    /// Moves the events of bucket b, after the current time has advanced, into the lower buckets.
+    void redistribute_bucket(size_t b) {
+        const CompactFloodCheckEvent *source = pool.data() + segments[b].begin;
+        size_t n = segments[b].size;
+        for (size_t k = 0; k < n; k++) {
+            auto e = source[k];
+            auto &target = segments[cur_bit_bucket_for(e.time)];
+            if (target.size == target.capacity) {
+                // Laying out the pool again moves the source bucket, whose events are all still in it.
+                grow_bucket(&target - segments.data(), target.size + 1);
+                source = pool.data() + segments[b].begin;
+            }
+            pool[target.begin + target.size] = e;
+            target.size++;
+        }
+        segments[b].size = 0;
+    }
+
+    /// Adds an event to the priority queue.
+    ///
+    /// The event MUST NOT be cycle-before the current time.
+    void enqueue(FloodCheckEvent event) {
+        validate(event);
+        push_to_bucket(cur_bit_bucket_for(event.time), encode(event));
+        _num_enqueued++;
+        if constexpr (DECODER_STATS_ENABLED)
+            num_pushes++;
+    }
+
+    /// Checks if all events are in the correct bucket, and the segments of the buckets don't overlap.
+    bool satisfies_invariants() const {
+        for (size_t b = 0; b < NUM_BUCKETS; b++) {
+            const auto &segment = segments[b];
+            if (segment.size > segment.capacity || segment.begin + segment.capacity > pool.size()) {
+                return false;
+            }
+            for (size_t b2 = b + 1; b2 < NUM_BUCKETS; b2++) {
+                if (segment.begin < segments[b2].begin + segments[b2].capacity &&
+                    segments[b2].begin < segment.begin + segment.capacity) {
+                    return false;
+                }
+            }
+            if (b == NUM_BUCKETS - 1) {
+                continue;
+            }
+            for (size_t k = 0; k < segment.size; k++) {
+                if (cur_bit_bucket_for(pool[segment.begin + k].time) != b) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    /// The time of the event that `dequeue' would return next, without dequeuing it or advancing the current time.
+    ///
+    /// The queue MUST NOT be empty.
+    cumulative_time_int next_event_time() const {
+        if (segments[0].size)
+            return cur_time;
+        size_t b = 1;
+        while (!segments[b].size) {
+            b++;
+        }
+        auto first = pool.begin() + segments[b].begin;
+        decltype(cyclic_time_int::value) min_time = first->time.value;
+        for (auto e = first; e != first + segments[b].size; ++e) {
+            min_time = std::min(min_time, e->time.value);
+        }
+        return cyclic_time_int{min_time}.widen_from_nearby_reference(cur_time);
+    }
+
+    /// The event that `dequeue' will return `ahead' dequeues from now (0 for the next one), if it is due at the
+    /// current time and no sooner events are enqueued first. See `radix_heap_queue::peek_due_now'.
+    std::optional<FloodCheckEvent> peek_due_now(size_t ahead = 0) const {
+        if (ahead >= segments[0].size)
+            return std::nullopt;
+        return decode(pool[segments[0].begin + segments[0].size - 1 - ahead]);
+    }
+
+    /// Dequeues the next event.
+    ///
+    /// If the queue is empty, a tentative event with type NO_TENTATIVE_EVENT is returned.
+    FloodCheckEvent dequeue() {
+        if (_num_enqueued == 0)
+            return FloodCheckEvent(cyclic_time_int{0});
+        if (!segments[0].size) {
+            // Need to refill bucket 0, so we can dequeue from it.
+
+            // Find first non-empty bucket. It has the soonest event.
+            size_t b = 1;
+            while (!segments[b].size) {
+                b++;
+            }
+
+            if (b == 1) {
+                // Special case: the events of bucket 1 are all at the next time, so its segment becomes bucket 0's.
+                std::swap(segments[0], segments[1]);
+                cur_time++;
+            } else {
+                // Advance time to the minimum time in the bucket.
+                auto first = pool.begin() + segments[b].begin;
+                decltype(cyclic_time_int::value) min_time = first->time.value;
+                for (auto e = first; e != first + segments[b].size; ++e) {
+                    min_time = std::min(min_time, e->time.value);
+                }
+                cur_time = cyclic_time_int{min_time}.widen_from_nearby_reference(cur_time);
+                redistribute_bucket(b);
+            }
+        }
+
+        _num_enqueued--;
+        segments[0].size--;
+        auto packed = pool[segments[0].begin + segments[0].size];
+        FloodCheckEvent result = decode(packed);
+        if (result.tentative_event_type == LOOK_AT_SHRINKING_REGION) {
+            free_region_slots.push_back(packed.target >> 2);
+        }
+        return result;
+    }
+
+    /// Lists the sorted events in the queue.
+    ///
+    /// This method mostly exacts to facilitate testing. It doesn't really make sense to use it
+    /// during normal operation.
+    std::vector<FloodCheckEvent> to_vector() const {
+        std::vector<FloodCheckEvent> result;
+        for (size_t b = 0; b < NUM_BUCKETS - 1; b++) {
+            for (size_t k = 0; k < segments[b].size; k++) {
+                result.push_back(decode(pool[segments[b].begin + k]));
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const FloodCheckEvent &e1, const FloodCheckEvent &e2) {
+            return e1.time < e2.time;
+        });
+        return result;
+    }
+
+    std::string str() const;
+
+    /// Clear all remaining events from the queue
+    void clear();
+
+    /// Clear the queue and set cur_time = 0
+    void reset();
+};
+
+template <bool use_validation>
+std::ostream &operator<<(std::ostream &out, const compact_radix_heap_queue<use_validation> &q) {
+    out << "compact_radix_heap_queue {\n";
+    out << "    cur_time=" << q.cur_time << "\n";
+    for (size_t b = 0; b < q.NUM_BUCKETS - 1; b++) {
+        if (q.segments[b].size) {
+            std::vector<FloodCheckEvent> copy;
+            for (size_t k = 0; k < q.segments[b].size; k++) {
+                copy.push_back(q.decode(q.pool[q.segments[b].begin + k]));
+            }
+            std::sort(copy.begin(), copy.end(), [](const FloodCheckEvent &e1, const FloodCheckEvent &e2) {
+                return e1.time < e2.time;
+            });
+            out << "    bucket[" << b << "] {\n";
+            for (auto &e : copy) {
+                out << "        " << e << ",\n";
+            }
+            out << "    }\n";
+        }
+    }
+    out << "}";
+    return out;
+}
+
+template <bool use_validation>
+std::string compact_radix_heap_queue<use_validation>::str() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+}
+
+template <bool use_validation>
+void compact_radix_heap_queue<use_validation>::clear() {
+    for (auto &segment : segments)
+        segment.size = 0;
+    _num_enqueued = 0;
+    region_slots.clear();
+    free_region_slots.clear();
+}
+
+template <bool use_validation>
+void compact_radix_heap_queue<use_validation>::reset() {
+    clear();
+    cur_time = 0;
+}
+
+#if PM_COMPACT_QUEUE
+/// The queue of the decoder's GraphFlooder and SearchFlooder.
+typedef compact_radix_heap_queue<false> default_flooder_queue;
+#endif
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_COMPACT_RADIX_HEAP_QUEUE_H
@@ -0,0 +1,186 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/tracker/compact_radix_heap_queue.h"
+
+#include <gtest/gtest.h>
+#include <random>
+
+using namespace pm;
+
+TEST(compact_radix_heap_queue, basic_usage) {
+    compact_radix_heap_queue<true> q;
+    ASSERT_EQ(sizeof(CompactFloodCheckEvent), 8);
+    ASSERT_EQ(q.size(), 0);
+    ASSERT_EQ(q.cur_time, 0);
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+
+    q.enqueue(FloodCheckEvent(cyclic_time_int{9}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.size(), 2);
+    ASSERT_EQ(q.cur_time, 0);
+    ASSERT_TRUE(q.satisfies_invariants());
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{9}));
+    ASSERT_EQ(q.size(), 0);
+    ASSERT_EQ(q.cur_time, 9);
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+}
+
+TEST(compact_radix_heap_queue, encodes_targets) {
+    std::vector<DetectorNode> nodes(5);
+    std::vector<SearchDetectorNode> search_nodes(3);
+    GraphFillRegion r1, r2;
+    compact_radix_heap_queue<true> q;
+    q.bind_nodes(nodes.data(), nodes.size());
+    q.bind_search_nodes(search_nodes.data(), search_nodes.size());
+
+    q.enqueue(FloodCheckEvent(&nodes[4], cyclic_time_int{5}));
+    q.enqueue(FloodCheckEvent(&r1, cyclic_time_int{2}));
+    q.enqueue(FloodCheckEvent(&search_nodes[2], cyclic_time_int{7}));
+    q.enqueue(FloodCheckEvent(&r2, cyclic_time_int{6}));
+    ASSERT_EQ(q.region_slots.size(), 2);
+    ASSERT_EQ(
+        q.to_vector(),
+        (std::vector<FloodCheckEvent>{
+            FloodCheckEvent(&r1, cyclic_time_int{2}),
+            FloodCheckEvent(&nodes[4], cyclic_time_int{5}),
+            FloodCheckEvent(&r2, cyclic_time_int{6}),
+            FloodCheckEvent(&search_nodes[2], cyclic_time_int{7}),
+        }));
+    ASSERT_THROW({ q.enqueue(FloodCheckEvent(&nodes[0] + 5, cyclic_time_int{8})); }, std::invalid_argument);
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(&r1, cyclic_time_int{2}));
+    ASSERT_FALSE(q.peek_due_now().has_value());
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(&nodes[4], cyclic_time_int{5}));
+
+    // The slot of a dequeued region event is reused.
+    q.enqueue(FloodCheckEvent(&r1, cyclic_time_int{6}));
+    ASSERT_EQ(q.region_slots.size(), 2);
+    auto e1 = q.dequeue();
+    auto next = q.peek_due_now();
+    auto e2 = q.dequeue();
+    ASSERT_EQ(next, e2);
+    ASSERT_EQ(e1.data_look_at_shrinking_region == &r1 ? e2 : e1, FloodCheckEvent(&r2, cyclic_time_int{6}));
+    ASSERT_EQ(e1.data_look_at_shrinking_region == &r1 ? e1 : e2, FloodCheckEvent(&r1, cyclic_time_int{6}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(&search_nodes[2], cyclic_time_int{7}));
+    ASSERT_TRUE(q.empty());
+}
+
+TEST(compact_radix_heap_queue, sorts_fuzz) {
+    compact_radix_heap_queue<true> q;
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+
+    std::vector<cyclic_time_int> s;
+    for (size_t k = 0; k < 1000; k++) {
+        auto v = cyclic_time_int{rng() & 0x00007FFF};
+        s.push_back(v);
+        q.enqueue(FloodCheckEvent(v));
+    }
+    std::sort(s.begin(), s.end());
+    ASSERT_TRUE(q.satisfies_invariants());
+
+    for (size_t k = 0; k < s.size(); k++) {
+        auto t = q.dequeue().time;
+        ASSERT_EQ(t, s[k]) << k;
+        if (k % 100 == 0) {
+            ASSERT_TRUE(q.satisfies_invariants()) << k;
+        }
+    }
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+}
+
+TEST(compact_radix_heap_queue, matches_radix_heap_queue_when_streaming) {
+    std::vector<DetectorNode> nodes(100);
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+    compact_radix_heap_queue<true> q;
+    q.bind_nodes(nodes.data(), nodes.size());
+    radix_heap_queue<true> r;
+    for (size_t k = 0; k < 20000; k++) {
+        if (q.empty() || rng() % 3) {
+            auto delay = rng() % 8 == 0 ? rng() % 100000 : rng() % 40;
+            auto t = cyclic_time_int{q.cur_time + delay};
+            // Each time has its own node, so that the events can be compared however events at the same time are
+            // ordered.
+            auto e = FloodCheckEvent(&nodes[t.value % nodes.size()], t);
+            q.enqueue(e);
+            r.enqueue(e);
+        } else {
+            auto next_time = q.next_event_time();
+            ASSERT_EQ(next_time, r.next_event_time()) << k;
+            auto peeked = r.peek_due_now();
+            ASSERT_EQ(q.peek_due_now().has_value(), peeked != nullptr) << k;
+            if (peeked != nullptr) {
+                ASSERT_EQ(*q.peek_due_now(), *peeked) << k;
+            }
+            ASSERT_EQ(q.dequeue(), r.dequeue()) << k;
+            ASSERT_EQ(q.cur_time, r.cur_time);
+        }
+        ASSERT_EQ(q.size(), r.size());
+    }
+    ASSERT_TRUE(q.satisfies_invariants());
+}
+
+TEST(compact_radix_heap_queue, wraparound_all_the_way_around) {
+    std::priority_queue<int64_t> reference_queue;
+    compact_radix_heap_queue<true> actual_queue;
+    for (size_t k = 0; k < 100; k++) {
+        actual_queue.enqueue(FloodCheckEvent{cyclic_time_int{k}});
+        reference_queue.push(-(int64_t)k);
+    }
+
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+    size_t n = 0;
+    while (!reference_queue.empty()) {
+        auto actual = (size_t)-reference_queue.top();
+        auto t = (size_t)actual_queue.dequeue().time.widen_from_nearby_reference(actual_queue.cur_time);
+        ASSERT_EQ(t, actual) << n;
+        reference_queue.pop();
+        n++;
+        if (n < (1 << 17)) {
+            t += rng() % 1000;
+            actual_queue.enqueue(FloodCheckEvent{cyclic_time_int{t}});
+            reference_queue.push(-(int64_t)t);
+        }
+    }
+}
+
+TEST(compact_radix_heap_queue, clear_and_reserve) {
+    compact_radix_heap_queue<true> q;
+    q.reserve(10);
+    ASSERT_EQ(q.capacity(), 10 * q.NUM_BUCKETS);
+    ASSERT_TRUE(q.satisfies_invariants());
+
+    GraphFillRegion r;
+    q.enqueue(FloodCheckEvent(cyclic_time_int{9}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{3}));
+    q.enqueue(FloodCheckEvent(&r, cyclic_time_int{1000}));
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.cur_time, 3);
+
+    q.clear();
+    ASSERT_EQ(q.size(), 0);
+    ASSERT_EQ(q.cur_time, 3);
+    ASSERT_TRUE(q.region_slots.empty());
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{0}));
+    // The segments of the buckets are kept.
+    ASSERT_EQ(q.capacity(), 10 * q.NUM_BUCKETS);
+
+    q.reset();
+    ASSERT_EQ(q.cur_time, 0);
+}
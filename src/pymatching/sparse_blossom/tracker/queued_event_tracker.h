@@ -26,9 +26,18 @@ namespace pm {
 /// If an object is already going to be looked at at time T, and it wants to be looked at at time
 /// T+2, the look-event for time T+2 will not be enqueued right away. Instead, as part of processing
 /// the time T event, the tracker will take care of enqueueing the time T+2 event.
+///
+/// With a queue that has handles (see `radix_heap_queue'), the tracker instead moves its queued event to the
+/// desired time, or removes it, in place. Then dequeued events are only discarded if the tracker was cleared
+/// while its event was queued.
 struct QueuedEventTracker {
     cyclic_time_int desired_time{0};
-    cyclic_time_int queued_time{0};
+    union {
+        /// The time of the queued event, with a queue without handles.
+        cyclic_time_int queued_time{0};
+        /// The handle of the queued event, with a queue with handles.
+        queue_handle queued_handle;
+    };
     bool has_desired_time{false};
     bool has_queued_time{false};
 
@@ -41,12 +50,19 @@ struct QueuedEventTracker {
     }
 
     /// Tells the tracker a desired look-at-me event. The tracker will handle inserting an event
-    /// into the event queue, if necessary.
-    template <bool use_validation>
-    inline void set_desired_event(FloodCheckEvent ev, radix_heap_queue<use_validation> &queue) {
+    /// into the event queue (a `radix_heap_queue' or `circular_bucket_queue'), if necessary.
+    template <typename Queue>
+    inline void set_desired_event(FloodCheckEvent ev, Queue &queue) {
         has_desired_time = true;
         desired_time = ev.time;
-        if (!has_queued_time || queued_time > ev.time) {
+        if constexpr (Queue::has_handles) {
+            if (has_queued_time) {
+                queue.reschedule(queued_handle, ev.time);
+            } else {
+                queued_handle = queue.enqueue_with_handle(ev);
+                has_queued_time = true;
+            }
+        } else if (!has_queued_time || queued_time > ev.time) {
             queued_time = ev.time;
             has_queued_time = true;
             queue.enqueue(ev);
@@ -58,13 +74,39 @@ struct QueuedEventTracker {
         has_desired_time = false;
     }
 
+    /// Indicates that it's no longer necessary to look at the object at a later time, also removing the queued
+    /// event from a queue with handles.
+    template <typename Queue>
+    inline void set_no_desired_event(Queue &queue) {
+        has_desired_time = false;
+        if constexpr (Queue::has_handles) {
+            if (has_queued_time) {
+                queue.cancel(queued_handle);
+                has_queued_time = false;
+            }
+        }
+    }
+
     /// Notifies the tracker that a relevant look-at-me event has been dequeued from the event
     /// queue. The result of this method is whether or not to discard the event (due to it being
     /// no longer desired) instead of continuing processing it. Returning false means discard,
     /// returning true means keep. This method also handles requeueing another look-at-me event
     /// if doing so was deferred while the earlier event was in the queue.
-    template <bool use_validation>
-    inline bool dequeue_decision(FloodCheckEvent ev, radix_heap_queue<use_validation> &queue) {
+    template <typename Queue>
+    inline bool dequeue_decision(FloodCheckEvent ev, Queue &queue) {
+        if constexpr (Queue::has_handles) {
+            // The queued event is always at the desired time, unless the tracker was cleared while it was queued.
+            if (!has_queued_time || queue.last_dequeued_handle != queued_handle) {
+                return false;
+            }
+            has_queued_time = false;
+            if (!has_desired_time) {
+                return false;
+            }
+            has_desired_time = false;
+            return true;
+        }
+
         // Only the most recent event this tracker put into the queue is valid. Older events
         // are forgotten and must not be processed, because otherwise an event storm can be
         // created as stale events trigger redundant enqueues.
@@ -170,3 +170,44 @@ TEST(QueuedEventTracker, basic_usage) {
     ASSERT_EQ(tracker.queued_time, cyclic_time_int{11});
     ASSERT_EQ(tracker.desired_time, cyclic_time_int{12});
 }
+
+TEST(QueuedEventTracker, with_handles) {
+    auto ev = [](int x) {
+        return FloodCheckEvent{cyclic_time_int{x}};
+    };
+    radix_heap_queue<true, true> queue;
+    QueuedEventTracker tracker;
+
+    tracker.set_desired_event(ev(5), queue);
+    ASSERT_EQ(queue.size(), 1);
+    ASSERT_EQ(tracker.has_queued_time, true);
+
+    // The queued event is moved, both earlier and later, rather than a new one being queued.
+    tracker.set_desired_event(ev(3), queue);
+    tracker.set_desired_event(ev(6), queue);
+    ASSERT_EQ(queue.size(), 1);
+    ASSERT_EQ(queue.to_vector()[0].time, cyclic_time_int{6});
+
+    auto deq = queue.dequeue();
+    ASSERT_EQ(deq, ev(6));
+    ASSERT_TRUE(tracker.dequeue_decision(deq, queue));
+    ASSERT_EQ(tracker.has_queued_time, false);
+    ASSERT_EQ(tracker.has_desired_time, false);
+
+    tracker.set_desired_event(ev(8), queue);
+    tracker.set_no_desired_event(queue);
+    ASSERT_TRUE(queue.empty());
+    ASSERT_EQ(tracker.has_queued_time, false);
+    ASSERT_EQ(tracker.has_desired_time, false);
+
+    // An event queued before the tracker was cleared is discarded.
+    tracker.set_desired_event(ev(9), queue);
+    tracker.clear();
+    tracker.set_desired_event(ev(10), queue);
+    deq = queue.dequeue();
+    ASSERT_EQ(deq, ev(9));
+    ASSERT_FALSE(tracker.dequeue_decision(deq, queue));
+    deq = queue.dequeue();
+    ASSERT_EQ(deq, ev(10));
+    ASSERT_TRUE(tracker.dequeue_decision(deq, queue));
+}
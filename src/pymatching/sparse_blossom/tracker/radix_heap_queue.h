@@ -22,12 +22,35 @@
 #include <queue>
 #include <vector>
 
+#include "pymatching/sparse_blossom/decoder_stats.h"
 #include "pymatching/sparse_blossom/ints.h"
 #include "pymatching/sparse_blossom/tracker/cyclic.h"
 #include "pymatching/sparse_blossom/tracker/flood_check_event.h"
 
+/// Whether the queues of the decoder's flooders identify their events by handles (see `radix_heap_queue'), so
+/// that events are rescheduled or cancelled in place rather than left in the queue to be discarded as stale when
+/// they are dequeued. This is a build option (PYMATCHING_QUEUE_HANDLES in CMakeLists.txt).
+#ifndef PM_QUEUE_HANDLES
+#define PM_QUEUE_HANDLES 0
+#endif
+
+/// Whether the queues of the decoder's flooders are `compact_radix_heap_queue's, which store their events in 8 bytes
+/// each in one pooled buffer. This is a build option (PYMATCHING_COMPACT_QUEUE in CMakeLists.txt), and can't be
+/// combined with PYMATCHING_QUEUE_HANDLES.
+#ifndef PM_COMPACT_QUEUE
+#define PM_COMPACT_QUEUE 0
+#endif
+
+#if PM_COMPACT_QUEUE && PM_QUEUE_HANDLES
+#error "PM_COMPACT_QUEUE and PM_QUEUE_HANDLES can't both be set, since a compact_radix_heap_queue has no handles."
+#endif
+
 namespace pm {
 
+/// Identifies an event in a `radix_heap_queue' with handles.
+typedef uint32_t queue_handle;
+constexpr queue_handle NO_QUEUE_HANDLE = UINT32_MAX;
+
 /// A monotonic priority queue for TentativeEvents.
 ///
 /// The priority queue assumes that times increase monotonically. The caller must not enqueue a
@@ -65,13 +88,31 @@ namespace pm {
 /// - Get redistributed to a slightly lower bucket.
 /// - Repeatedly wait and get redistributed to lower and lower buckets until in bucket 0.
 /// - Get dequeued out of bucket 0 and yielded as a result.
-template <bool use_validation>
+///
+/// If `use_handles' is set, events enqueued with `enqueue_with_handle' can later be moved to another time with
+/// `reschedule', or removed with `cancel', in constant time. The queue then keeps the handle of each event next to
+/// it, and the location of the event with each handle, which it updates whenever an event is moved.
+template <bool use_validation, bool use_handles = false>
 struct radix_heap_queue {
+    static constexpr bool has_handles = use_handles;
+    static constexpr bool has_compact_events = false;
     std::array<std::vector<FloodCheckEvent>, sizeof(pm::cyclic_time_int) * 8 + 1> bit_buckets;
     pm::cumulative_time_int cur_time;
     size_t _num_enqueued;
+    /// The number of events enqueued since this was last reset by the user of the queue (a flooder moves it into
+    /// its `DecoderStats' whenever it dequeues). Only counted if DECODER_STATS_ENABLED.
+    size_t num_pushes;
+
+    /// == Only used with handles. ==
+    /// The handle of each event (or NO_QUEUE_HANDLE), at the same position as the event in `bit_buckets'.
+    std::array<std::vector<queue_handle>, sizeof(pm::cyclic_time_int) * 8 + 1> bucket_handles;
+    /// The bucket, and the position in the bucket, of the event with each handle that is in use.
+    std::vector<std::pair<uint32_t, uint32_t>> handle_locations;
+    std::vector<queue_handle> free_handles;
+    /// The handle of the event last returned by `dequeue'. It is free again once the event has been dequeued.
+    queue_handle last_dequeued_handle;
 
-    radix_heap_queue() : cur_time{0}, _num_enqueued(0) {
+    radix_heap_queue() : cur_time{0}, _num_enqueued(0), num_pushes(0), last_dequeued_handle(NO_QUEUE_HANDLE) {
     }
 
     size_t size() const {
@@ -82,15 +123,45 @@ struct radix_heap_queue {
         return _num_enqueued == 0;
     }
 
+    /// Makes room for `num_events' events in each bucket, so that that many events can be enqueued at once without
+    /// allocating memory, however they are spread over the buckets.
+    void reserve(size_t num_events) {
+        for (auto &bucket : bit_buckets)
+            bucket.reserve(num_events);
+        if constexpr (use_handles) {
+            for (auto &handles : bucket_handles)
+                handles.reserve(num_events);
+            handle_locations.reserve(num_events);
+            free_handles.reserve(num_events);
+        }
+    }
+
+    /// The total number of events that fit in the memory currently owned by the buckets.
+    size_t capacity() const {
+        size_t total = 0;
+        for (const auto &bucket : bit_buckets)
+            total += bucket.capacity();
+        return total;
+    }
+
+    /// The number of bytes of memory owned by the queue.
+    size_t memory_bytes() const {
+        size_t total = capacity() * sizeof(FloodCheckEvent);
+        if constexpr (use_handles) {
+            for (const auto &handles : bucket_handles)
+                total += handles.capacity() * sizeof(queue_handle);
+            total += handle_locations.capacity() * sizeof(std::pair<uint32_t, uint32_t>) +
+                     free_handles.capacity() * sizeof(queue_handle);
+        }
+        return total;
+    }
+
     /// Determines which bucket an event with the given time should go into.
     inline size_t cur_bit_bucket_for(cyclic_time_int time) const {
         return std::bit_width((uint64_t)(time.value ^ cyclic_time_int{cur_time}.value));
     }
 
-    /// Adds an event to the priority queue.
-    ///
-    /// The event MUST NOT be cycle-before the current time.
-    void enqueue(FloodCheckEvent event) {
+    inline void validate(const FloodCheckEvent &event) const {
         if (use_validation) {
             if (event.time < cyclic_time_int{cur_time}) {
                 std::stringstream ss;
@@ -100,9 +171,85 @@ struct radix_heap_queue {
                 throw std::invalid_argument(ss.str());
             }
         }
-        auto target_bucket = cur_bit_bucket_for(event.time);
-        bit_buckets[target_bucket].push_back(event);
+    }
+
+    inline void push_to_bucket(size_t b, FloodCheckEvent event, queue_handle handle) {
+        bit_buckets[b].push_back(event);
+        if constexpr (use_handles) {
+            bucket_handles[b].push_back(handle);
+            if (handle != NO_QUEUE_HANDLE) {
+                handle_locations[handle] = {(uint32_t)b, (uint32_t)(bit_buckets[b].size() - 1)};
+            }
+        }
+    }
+
+    /// Removes the event at position k of bucket b, by moving the last event of the bucket into its place.
+    inline void remove_from_bucket(size_t b, size_t k) {
+        auto &bucket = bit_buckets[b];
+        auto &handles = bucket_handles[b];
+        bucket[k] = bucket.back();
+        bucket.pop_back();
+        handles[k] = handles.back();
+        handles.pop_back();
+        if (k < handles.size() && handles[k] != NO_QUEUE_HANDLE) {
+            handle_locations[handles[k]].second = (uint32_t)k;
+        }
+    }
+
+    /// Adds an event to the priority queue.
+    ///
+    /// The event MUST NOT be cycle-before the current time.
+    void enqueue(FloodCheckEvent event) {
+        validate(event);
+        push_to_bucket(cur_bit_bucket_for(event.time), event, NO_QUEUE_HANDLE);
+        _num_enqueued++;
+        if constexpr (DECODER_STATS_ENABLED)
+            num_pushes++;
+    }
+
+    /// Adds an event to the priority queue, returning a handle that identifies it until it is dequeued or
+    /// cancelled. Only available with handles.
+    ///
+    /// The event MUST NOT be cycle-before the current time.
+    queue_handle enqueue_with_handle(FloodCheckEvent event) {
+        static_assert(use_handles, "enqueue_with_handle requires a radix_heap_queue with handles");
+        validate(event);
+        queue_handle handle;
+        if (free_handles.empty()) {
+            handle = (queue_handle)handle_locations.size();
+            handle_locations.emplace_back();
+        } else {
+            handle = free_handles.back();
+            free_handles.pop_back();
+        }
+        push_to_bucket(cur_bit_bucket_for(event.time), event, handle);
         _num_enqueued++;
+        if constexpr (DECODER_STATS_ENABLED)
+            num_pushes++;
+        return handle;
+    }
+
+    /// Moves the event with the given handle to the given time, which MUST NOT be cycle-before the current time.
+    void reschedule(queue_handle handle, cyclic_time_int time) {
+        static_assert(use_handles, "reschedule requires a radix_heap_queue with handles");
+        auto [b, k] = handle_locations[handle];
+        FloodCheckEvent event = bit_buckets[b][k];
+        if (event.time == time) {
+            return;
+        }
+        event.time = time;
+        validate(event);
+        remove_from_bucket(b, k);
+        push_to_bucket(cur_bit_bucket_for(time), event, handle);
+    }
+
+    /// Removes the event with the given handle from the queue, and frees the handle.
+    void cancel(queue_handle handle) {
+        static_assert(use_handles, "cancel requires a radix_heap_queue with handles");
+        auto [b, k] = handle_locations[handle];
+        remove_from_bucket(b, k);
+        free_handles.push_back(handle);
+        _num_enqueued--;
     }
 
     /// Checks if all events are in the correct bucket.
@@ -112,11 +259,43 @@ struct radix_heap_queue {
                 if (cur_bit_bucket_for(bit_buckets[b][k].time) != b) {
                     return false;
                 }
+                if (use_handles) {
+                    auto h = bucket_handles[b][k];
+                    if (h != NO_QUEUE_HANDLE && handle_locations[h] != std::make_pair((uint32_t)b, (uint32_t)k)) {
+                        return false;
+                    }
+                }
             }
         }
         return true;
     }
 
+    /// The time of the event that `dequeue' would return next, without dequeuing it or advancing the current time.
+    ///
+    /// The queue MUST NOT be empty.
+    cumulative_time_int next_event_time() const {
+        if (!bit_buckets[0].empty())
+            return cur_time;
+        size_t b = 1;
+        while (bit_buckets[b].empty()) {
+            b++;
+        }
+        decltype(cyclic_time_int::value) min_time = bit_buckets[b][0].time.value;
+        for (const auto &e : bit_buckets[b]) {
+            min_time = std::min(min_time, e.time.value);
+        }
+        return cyclic_time_int{min_time}.widen_from_nearby_reference(cur_time);
+    }
+
+    /// The event that `dequeue' will return `ahead' dequeues from now (0 for the next one), if it is due at the
+    /// current time and no sooner events are enqueued first, or else nullptr. Unlike `next_event_time', this never
+    /// scans the buckets, so it is cheap enough to call after every event (e.g. to prefetch what upcoming events
+    /// will touch).
+    const FloodCheckEvent *peek_due_now(size_t ahead = 0) const {
+        auto &bucket = bit_buckets[0];
+        return ahead < bucket.size() ? &bucket[bucket.size() - 1 - ahead] : nullptr;
+    }
+
     /// Dequeues the next event.
     ///
     /// If the queue is empty, a tentative event with type NO_TENTATIVE_EVENT is returned.
@@ -135,6 +314,14 @@ struct radix_heap_queue {
             if (b == 1) {
                 // Special case:
                 std::swap(bit_buckets[0], bit_buckets[1]);
+                if constexpr (use_handles) {
+                    std::swap(bucket_handles[0], bucket_handles[1]);
+                    for (auto h : bucket_handles[0]) {
+                        if (h != NO_QUEUE_HANDLE) {
+                            handle_locations[h].first = 0;
+                        }
+                    }
+                }
                 cur_time++;
             } else {
                 auto &source_bucket = bit_buckets[b];
@@ -147,17 +334,26 @@ struct radix_heap_queue {
                 cur_time = cyclic_time_int{min_time}.widen_from_nearby_reference(cur_time);
 
                 // Redistribute the contents of the bucket.
-                for (auto &e : source_bucket) {
+                for (size_t k = 0; k < source_bucket.size(); k++) {
+                    auto &e = source_bucket[k];
                     auto target_bucket = cur_bit_bucket_for(e.time);
-                    bit_buckets[target_bucket].push_back(e);
+                    push_to_bucket(target_bucket, e, use_handles ? bucket_handles[b][k] : NO_QUEUE_HANDLE);
                 }
                 source_bucket.clear();
+                bucket_handles[b].clear();
             }
         }
 
         _num_enqueued--;
         FloodCheckEvent result = bit_buckets[0].back();
         bit_buckets[0].pop_back();
+        if constexpr (use_handles) {
+            last_dequeued_handle = bucket_handles[0].back();
+            bucket_handles[0].pop_back();
+            if (last_dequeued_handle != NO_QUEUE_HANDLE) {
+                free_handles.push_back(last_dequeued_handle);
+            }
+        }
         return result;
     }
 
@@ -185,8 +381,8 @@ struct radix_heap_queue {
     void reset();
 };
 
-template <bool use_validation>
-std::ostream &operator<<(std::ostream &out, radix_heap_queue<use_validation> q) {
+template <bool use_validation, bool use_handles>
+std::ostream &operator<<(std::ostream &out, radix_heap_queue<use_validation, use_handles> q) {
     out << "bit_bucket_queue {\n";
     out << "    cur_time=" << q.cur_time << "\n";
     for (size_t b = 0; b < q.bit_buckets.size() - 1; b++) {
@@ -206,29 +402,37 @@ std::ostream &operator<<(std::ostream &out, radix_heap_queue<use_validation> q)
     return out;
 }
 
-template <bool use_validation>
-std::string radix_heap_queue<use_validation>::str() const {
+template <bool use_validation, bool use_handles>
+std::string radix_heap_queue<use_validation, use_handles>::str() const {
     std::stringstream ss;
     ss << *this;
     return ss.str();
 }
 
-template <bool use_validation>
-void radix_heap_queue<use_validation>::clear() {
+template <bool use_validation, bool use_handles>
+void radix_heap_queue<use_validation, use_handles>::clear() {
     size_t b = 0;
     while (!empty()) {
         _num_enqueued -= bit_buckets[b].size();
         bit_buckets[b].clear();
+        bucket_handles[b].clear();
         b++;
     }
+    handle_locations.clear();
+    free_handles.clear();
 }
 
-template <bool use_validation>
-void radix_heap_queue<use_validation>::reset() {
+template <bool use_validation, bool use_handles>
+void radix_heap_queue<use_validation, use_handles>::reset() {
     clear();
     cur_time = 0;
 }
 
+#if !PM_COMPACT_QUEUE
+/// The queue of the decoder's GraphFlooder and SearchFlooder (see also `compact_radix_heap_queue').
+typedef radix_heap_queue<false, (bool)PM_QUEUE_HANDLES> default_flooder_queue;
+#endif
+
 }  // namespace pm
 
 #endif  // PYMATCHING2_BUCKET_QUEUE_H
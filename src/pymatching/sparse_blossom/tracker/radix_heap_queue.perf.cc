@@ -18,6 +18,8 @@
 #include <random>
 
 #include "pymatching/perf/util.perf.h"
+#include "pymatching/sparse_blossom/tracker/circular_bucket_queue.h"
+#include "pymatching/sparse_blossom/tracker/compact_radix_heap_queue.h"
 
 using namespace pm;
 
@@ -73,3 +75,105 @@ BENCHMARK(bucket_queue_stream) {
         std::cerr << "data dependence";
     }
 }
+
+BENCHMARK(compact_bucket_queue_sort) {
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+
+    std::vector<cyclic_time_int> v;
+    for (size_t k = 0; k < 1000; k++) {
+        v.push_back((cyclic_time_int)(rng() & 0x7FFF));
+    }
+
+    bool dependence = false;
+    // The queue is kept between runs, as a flooder keeps it between shots, so the segments of its buckets are only
+    // laid out in the first runs.
+    compact_radix_heap_queue<false> q;
+    benchmark_go([&]() {
+        q.reset();
+        for (auto t : v) {
+            q.enqueue(FloodCheckEvent(t));
+        }
+        while (true) {
+            FloodCheckEvent out = q.dequeue();
+            if (out.tentative_event_type == NO_FLOOD_CHECK_EVENT) {
+                break;
+            }
+            if (out.time == 0) {
+                dependence = true;
+            }
+        }
+    })
+        .goal_micros(4.9)
+        .show_rate("EnqueueDequeues", (double)v.size());
+    if (dependence) {
+        std::cerr << "data dependence";
+    }
+}
+
+BENCHMARK(compact_bucket_queue_stream) {
+    size_t n = 10000;
+
+    bool dependence = false;
+    compact_radix_heap_queue<false> q;
+    benchmark_go([&]() {
+        q.reset();
+        for (size_t k = 0; k < 10; k++) {
+            for (size_t r = 0; r < k; r++) {
+                q.enqueue(FloodCheckEvent(cyclic_time_int{k}));
+            }
+        }
+        for (size_t k = 0; k < n; k++) {
+            q.enqueue(FloodCheckEvent(q.dequeue().time + cyclic_time_int{100}));
+        }
+    })
+        .goal_micros(99)
+        .show_rate("EnqueueDequeues", (double)n);
+    if (dependence) {
+        std::cerr << "data dependence";
+    }
+}
+
+BENCHMARK(circular_bucket_queue_stream) {
+    size_t n = 10000;
+
+    bool dependence = false;
+    benchmark_go([&]() {
+        circular_bucket_queue<false> q(128);
+        for (size_t k = 0; k < 10; k++) {
+            for (size_t r = 0; r < k; r++) {
+                q.enqueue(FloodCheckEvent(cyclic_time_int{k}));
+            }
+        }
+        for (size_t k = 0; k < n; k++) {
+            q.enqueue(FloodCheckEvent(q.dequeue().time + cyclic_time_int{100}));
+        }
+    })
+        .goal_micros(43)
+        .show_rate("EnqueueDequeues", (double)n);
+    if (dependence) {
+        std::cerr << "data dependence";
+    }
+}
+
+BENCHMARK(circular_bucket_queue_stream_overflowing) {
+    size_t n = 10000;
+
+    bool dependence = false;
+    benchmark_go([&]() {
+        // Every event is scheduled beyond the circular array, and goes through the overflow heap.
+        circular_bucket_queue<false> q(64);
+        for (size_t k = 0; k < 10; k++) {
+            for (size_t r = 0; r < k; r++) {
+                q.enqueue(FloodCheckEvent(cyclic_time_int{k}));
+            }
+        }
+        for (size_t k = 0; k < n; k++) {
+            q.enqueue(FloodCheckEvent(q.dequeue().time + cyclic_time_int{100}));
+        }
+    })
+        .goal_micros(180)
+        .show_rate("EnqueueDequeues", (double)n);
+    if (dependence) {
+        std::cerr << "data dependence";
+    }
+}
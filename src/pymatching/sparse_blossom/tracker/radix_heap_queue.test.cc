@@ -133,4 +133,75 @@ TEST(radix_heap_queue, clear) {
 
     q.reset();
     ASSERT_EQ(q.cur_time, 0);
-}
\ No newline at end of file
+}
+TEST(radix_heap_queue, handles) {
+    radix_heap_queue<true, true> q;
+    auto h5 = q.enqueue_with_handle(FloodCheckEvent(cyclic_time_int{5}));
+    auto h9 = q.enqueue_with_handle(FloodCheckEvent(cyclic_time_int{9}));
+    auto h7 = q.enqueue_with_handle(FloodCheckEvent(cyclic_time_int{7}));
+    q.enqueue(FloodCheckEvent(cyclic_time_int{8}));
+    ASSERT_TRUE(q.satisfies_invariants());
+
+    q.reschedule(h5, cyclic_time_int{20});
+    q.reschedule(h9, cyclic_time_int{2});
+    q.cancel(h7);
+    ASSERT_EQ(q.size(), 3);
+    ASSERT_TRUE(q.satisfies_invariants());
+
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{2}));
+    ASSERT_EQ(q.last_dequeued_handle, h9);
+    ASSERT_TRUE(q.satisfies_invariants());
+    ASSERT_THROW({ q.reschedule(h5, cyclic_time_int{1}); }, std::invalid_argument);
+
+    // Handles are reused once their event has been dequeued or cancelled.
+    auto h = q.enqueue_with_handle(FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_TRUE(h == h7 || h == h9);
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{3}));
+    ASSERT_EQ(q.last_dequeued_handle, h);
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{8}));
+    ASSERT_EQ(q.last_dequeued_handle, NO_QUEUE_HANDLE);
+    ASSERT_EQ(q.dequeue(), FloodCheckEvent(cyclic_time_int{20}));
+    ASSERT_EQ(q.last_dequeued_handle, h5);
+    ASSERT_TRUE(q.empty());
+}
+
+TEST(radix_heap_queue, handles_fuzz) {
+    radix_heap_queue<true, true> q;
+    std::mt19937 rng(0);  // NOLINT(cert-msc51-cpp)
+
+    // The time of the event with each handle, or -1 if the handle is free.
+    std::vector<int64_t> times;
+    for (size_t k = 0; k < 20000; k++) {
+        auto r = rng() % 4;
+        auto t = cyclic_time_int{q.cur_time + rng() % 300};
+        std::vector<queue_handle> live;
+        for (size_t h = 0; h < times.size(); h++) {
+            if (times[h] >= 0) {
+                live.push_back(h);
+            }
+        }
+        if (r == 0 || live.empty()) {
+            auto h = q.enqueue_with_handle(FloodCheckEvent(t));
+            times.resize(std::max(times.size(), (size_t)h + 1), -1);
+            times[h] = t.value;
+        } else if (r == 1) {
+            auto h = live[rng() % live.size()];
+            q.reschedule(h, t);
+            times[h] = t.value;
+        } else if (r == 2) {
+            auto h = live[rng() % live.size()];
+            q.cancel(h);
+            times[h] = -1;
+        } else {
+            int64_t min_time = INT64_MAX;
+            for (auto h : live) {
+                min_time = std::min(min_time, times[h]);
+            }
+            auto e = q.dequeue();
+            ASSERT_EQ(e.time.value, min_time);
+            ASSERT_EQ(times[q.last_dequeued_handle], min_time);
+            times[q.last_dequeued_handle] = -1;
+        }
+        ASSERT_TRUE(q.satisfies_invariants());
+    }
+}
@@ -0,0 +1,122 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef PYMATCHING2_WIDE_OBS_INT_H
+#define PYMATCHING2_WIDE_OBS_INT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+
+namespace pm {
+
+/// A bit packed observable mask of `NUM_WORDS' 64-bit words, with the subset of unsigned integer operations
+/// that the matcher applies to observable masks. Used as `obs_int' when PyMatching is built to track more than
+/// 64 observables in the flooder (see PM_OBS_INT_WORDS in ints.h).
+///
+/// Like a plain integer, it is trivially constructible, so that it can be used inside unions. A value-initialised
+/// (or default-initialised static) mask is zero.
+template <size_t NUM_WORDS>
+struct wide_obs_int {
+    static_assert(NUM_WORDS > 0, "wide_obs_int needs at least one word.");
+    uint64_t words[NUM_WORDS];
+
+    wide_obs_int() = default;
+    constexpr wide_obs_int(uint64_t low_word) : words{low_word} {  // NOLINT(google-explicit-constructor)
+    }
+
+    inline wide_obs_int& operator^=(const wide_obs_int& other) {
+        for (size_t k = 0; k < NUM_WORDS; k++)
+            words[k] ^= other.words[k];
+        return *this;
+    }
+    inline wide_obs_int& operator&=(const wide_obs_int& other) {
+        for (size_t k = 0; k < NUM_WORDS; k++)
+            words[k] &= other.words[k];
+        return *this;
+    }
+    inline wide_obs_int& operator|=(const wide_obs_int& other) {
+        for (size_t k = 0; k < NUM_WORDS; k++)
+            words[k] |= other.words[k];
+        return *this;
+    }
+    friend inline wide_obs_int operator^(wide_obs_int a, const wide_obs_int& b) {
+        return a ^= b;
+    }
+    friend inline wide_obs_int operator&(wide_obs_int a, const wide_obs_int& b) {
+        return a &= b;
+    }
+    friend inline wide_obs_int operator|(wide_obs_int a, const wide_obs_int& b) {
+        return a |= b;
+    }
+    friend inline bool operator==(const wide_obs_int& a, const wide_obs_int& b) {
+        for (size_t k = 0; k < NUM_WORDS; k++) {
+            if (a.words[k] != b.words[k])
+                return false;
+        }
+        return true;
+    }
+    friend inline bool operator!=(const wide_obs_int& a, const wide_obs_int& b) {
+        return !(a == b);
+    }
+
+    inline wide_obs_int operator<<(size_t shift) const {
+        wide_obs_int result(0);
+        size_t word_shift = shift / 64;
+        size_t bit_shift = shift % 64;
+        for (size_t k = NUM_WORDS; k-- > word_shift;) {
+            result.words[k] = words[k - word_shift] << bit_shift;
+            if (bit_shift && k > word_shift)
+                result.words[k] |= words[k - word_shift - 1] >> (64 - bit_shift);
+        }
+        return result;
+    }
+    inline wide_obs_int operator>>(size_t shift) const {
+        wide_obs_int result(0);
+        size_t word_shift = shift / 64;
+        size_t bit_shift = shift % 64;
+        for (size_t k = 0; k + word_shift < NUM_WORDS; k++) {
+            result.words[k] = words[k + word_shift] >> bit_shift;
+            if (bit_shift && k + word_shift + 1 < NUM_WORDS)
+                result.words[k] |= words[k + word_shift + 1] << (64 - bit_shift);
+        }
+        return result;
+    }
+
+    inline bool bit(size_t k) const {
+        return (words[k / 64] >> (k % 64)) & 1;
+    }
+    inline explicit operator bool() const {
+        for (size_t k = 0; k < NUM_WORDS; k++) {
+            if (words[k])
+                return true;
+        }
+        return false;
+    }
+};
+
+template <size_t NUM_WORDS>
+std::ostream& operator<<(std::ostream& out, const wide_obs_int<NUM_WORDS>& value) {
+    std::ios_base::fmtflags flags = out.flags();
+    out << "0x" << std::hex;
+    for (size_t k = NUM_WORDS; k--;)
+        out << std::setw(16) << std::setfill('0') << value.words[k];
+    out.flags(flags);
+    return out;
+}
+
+}  // namespace pm
+
+#endif  // PYMATCHING2_WIDE_OBS_INT_H
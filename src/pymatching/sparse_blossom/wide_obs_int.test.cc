@@ -0,0 +1,72 @@
+// Copyright 2022 PyMatching Contributors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "pymatching/sparse_blossom/wide_obs_int.h"
+
+#include <gtest/gtest.h>
+#include <sstream>
+
+#include "pymatching/sparse_blossom/driver/mwpm_decoding.h"
+#include "pymatching/sparse_blossom/ints.h"
+
+using namespace pm;
+
+TEST(WideObsInt, ShiftAcrossWords) {
+    wide_obs_int<3> one(1);
+    for (size_t k = 0; k < 192; k++) {
+        wide_obs_int<3> v = one << k;
+        for (size_t j = 0; j < 192; j++)
+            ASSERT_EQ(v.bit(j), j == k);
+        ASSERT_EQ(v >> k, one);
+    }
+    ASSERT_FALSE((bool)(one << 192));
+
+    wide_obs_int<3> v(0xF000000000000001ULL);
+    wide_obs_int<3> shifted = v << 4;
+    ASSERT_EQ(shifted.words[0], 0x10ULL);
+    ASSERT_EQ(shifted.words[1], 0xFULL);
+    ASSERT_EQ(shifted.words[2], 0ULL);
+    ASSERT_EQ(shifted >> 4, v);
+}
+
+TEST(WideObsInt, BitwiseOperations) {
+    wide_obs_int<2> a = (wide_obs_int<2>(1) << 70) | wide_obs_int<2>(5);
+    wide_obs_int<2> b = (wide_obs_int<2>(1) << 70) | wide_obs_int<2>(3);
+    ASSERT_EQ(a ^ b, wide_obs_int<2>(6));
+    ASSERT_EQ(a & b, (wide_obs_int<2>(1) << 70) | wide_obs_int<2>(1));
+    ASSERT_NE(a, b);
+    ASSERT_TRUE((bool)(a ^ b));
+    ASSERT_FALSE((bool)(a ^ a));
+    ASSERT_EQ(wide_obs_int<2>(7), 7ULL);
+}
+
+TEST(WideObsInt, Print) {
+    std::stringstream ss;
+    ss << (wide_obs_int<2>(1) << 64 | wide_obs_int<2>(0xab));
+    ASSERT_EQ(ss.str(), "0x000000000000000100000000000000ab");
+}
+
+TEST(WideObsInt, ObsIntBitVectorRoundTrip) {
+    size_t num_observables = sizeof(pm::obs_int) * 8;
+    std::vector<uint8_t> bits(num_observables, 0);
+    for (size_t k = 0; k < num_observables; k += 3)
+        bits[k] = 1;
+    bits[num_observables - 1] = 1;
+    pm::obs_int mask = pm::bit_vector_to_obs_mask(bits);
+    for (size_t k = 0; k < num_observables; k++)
+        ASSERT_EQ(pm::obs_int_bit(mask, k), (bool)bits[k]);
+    std::vector<uint8_t> round_trip(num_observables, 0);
+    pm::fill_bit_vector_from_obs_mask(mask, round_trip.data(), num_observables);
+    ASSERT_EQ(round_trip, bits);
+}
@@ -13,6 +13,7 @@
 # limitations under the License.
 
 import numpy as np
+import pytest
 import networkx as nx
 from pymatching import Matching
 
@@ -48,3 +49,45 @@ def test_add_noise_with_boundary():
         syndrome,
         np.array([1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0])
     )
+
+
+def test_add_noise_batch():
+    p = 0.1
+    N = 1000
+    num_shots = 20
+    std = (p * (1 - p) / N) ** 0.5
+    g = nx.Graph()
+    for i in range(N):
+        g.add_edge(i, i + 1, fault_ids=i, weight=-np.log(p), error_probability=p)
+    m = Matching(g)
+    syndromes, noise = m.add_noise_batch(num_shots, seed=3)
+    assert syndromes.shape == (num_shots, (N + 1 + 7) // 8)
+    assert noise.shape == (num_shots, (N + 7) // 8)
+    syndromes = np.unpackbits(syndromes, axis=1, count=N + 1, bitorder='little')
+    noise = np.unpackbits(noise, axis=1, count=N, bitorder='little')
+    for k in range(num_shots):
+        assert (p - 5 * std) * N < np.sum(noise[k]) < (p + 5 * std) * N
+        assert np.array_equal(syndromes[k, 1:N], (noise[k, :-1] + noise[k, 1:]) % 2)
+    syndromes2, noise2 = m.add_noise_batch(num_shots, seed=3)
+    assert np.array_equal(np.unpackbits(noise2, axis=1, count=N, bitorder='little'), noise)
+
+    m = Matching()
+    m.add_edge(0, 1)
+    with pytest.raises(ValueError):
+        m.add_noise_batch(1)
+
+
+def test_add_noise_batch_with_boundary():
+    g = nx.Graph()
+    for i in range(11):
+        g.add_edge(i, i + 1, fault_ids=i, error_probability=(i + 1) % 2)
+    for i in range(5, 12):
+        g.nodes()[i]['is_boundary'] = True
+    m = Matching(g)
+    syndromes, noise = m.add_noise_batch(3)
+    for k in range(3):
+        assert np.array_equal(np.unpackbits(noise[k], count=11, bitorder='little'), (np.arange(11) + 1) % 2)
+        assert np.array_equal(
+            np.unpackbits(syndromes[k], count=12, bitorder='little'),
+            np.array([1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0])
+        )
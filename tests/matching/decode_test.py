@@ -16,7 +16,7 @@ import os
 from pathlib import Path
 
 import numpy as np
-from scipy.sparse import csc_matrix
+from scipy.sparse import csc_matrix, csr_matrix
 import pytest
 import networkx as nx
 
@@ -193,6 +193,75 @@ def test_surface_code_solution_weights(data_dir: Path):
     assert np.array_equal(bitpacked_batch_predictions_from_bitpacked, expected_observables_arr)
     assert np.allclose(bitpacked_batch_weights, expected_weights, rtol=1e-8)
 
+    for num_threads in [2, 3, 8]:
+        threaded_predictions, threaded_weights = m.decode_batch(bitpacked_shots,
+                                                                return_weights=True,
+                                                                bit_packed_shots=True,
+                                                                num_threads=num_threads)
+        assert np.array_equal(threaded_predictions, expected_observables_arr)
+        assert np.array_equal(threaded_weights, bitpacked_batch_weights)
+
+
+def test_decode_batch_multiple_threads_matches_single_thread():
+    m = pymatching.Matching()
+    m.add_edge(0, 1, fault_ids={0})
+    m.add_edge(1, 2, fault_ids={10})
+    m.add_edge(2, 3, fault_ids={3, 5})
+    m.add_edge(3, 4, fault_ids={20, 16})
+    rng = np.random.default_rng(0)
+    shots = (rng.random((101, 5)) < 0.4).astype(np.uint8)
+    expected_predictions, expected_weights = m.decode_batch(shots, return_weights=True)
+    for num_threads in [1, 2, 4, 200]:
+        predictions, weights = m.decode_batch(shots, return_weights=True, num_threads=num_threads)
+        assert np.array_equal(predictions, expected_predictions)
+        assert np.array_equal(weights, expected_weights)
+        predictions = m.decode_batch(shots, bit_packed_predictions=True, num_threads=num_threads)
+        assert np.array_equal(predictions, m.decode_batch(shots, bit_packed_predictions=True))
+        predictions, weights = m.decode_batch(
+            shots, return_weights=True, num_threads=num_threads, largest_shots_first=True)
+        assert np.array_equal(predictions, expected_predictions)
+        assert np.array_equal(weights, expected_weights)
+    with pytest.raises(ValueError):
+        m.decode_batch(np.array([[0, 0, 0, 0, 0], [0, 0, 0, 0, 0], [0, 0, 1, 0, 0]], dtype=np.uint8), num_threads=3)
+
+
+def test_decode_batch_return_stats():
+    m = pymatching.Matching()
+    m.add_boundary_edge(0)
+    for i in range(9):
+        m.add_edge(i, i + 1, fault_ids={0})
+    shots = np.zeros((3, 10), dtype=np.uint8)
+    shots[1, [2, 5]] = 1
+    shots[2, [1, 3, 4, 8]] = 1
+    if not pymatching._cpp_pymatching.decoder_stats_enabled:
+        with pytest.raises(ValueError):
+            m.decode_batch(shots, return_stats=True)
+        return
+    for num_threads in [1, 2]:
+        predictions, weights, stats = m.decode_batch(
+            shots, return_weights=True, return_stats=True, num_threads=num_threads)
+        assert np.array_equal(predictions, m.decode_batch(shots))
+        assert set(stats.keys()) == set(pymatching._cpp_pymatching.decoder_stats_field_names)
+        assert all(v.shape == (3,) for v in stats.values())
+        assert stats["nodes_touched"][0] == 0
+        assert np.all(stats["queue_pops"] <= stats["queue_pushes"])
+
+
+def test_decode_batch_return_latencies():
+    m = pymatching.Matching()
+    m.add_boundary_edge(0)
+    for i in range(9):
+        m.add_edge(i, i + 1, fault_ids={0})
+    rng = np.random.default_rng(0)
+    shots = (rng.random((50, 10)) < 0.3).astype(np.uint8)
+    for num_threads in [1, 3]:
+        predictions, latencies = m.decode_batch(shots, return_latencies=True, num_threads=num_threads)
+        assert np.array_equal(predictions, m.decode_batch(shots))
+        assert set(latencies.keys()) == {"total", "syndrome_extraction", "flooding", "result_extraction"}
+        assert all(v.shape == (50,) and v.dtype == np.uint64 for v in latencies.values())
+        phases = latencies["syndrome_extraction"] + latencies["flooding"] + latencies["result_extraction"]
+        assert np.all(phases <= latencies["total"])
+
 
 def test_decode_batch_to_bitpacked_predictions():
     m = pymatching.Matching()
@@ -212,6 +281,86 @@ def test_decode_batch_to_bitpacked_predictions():
         m.decode_batch(np.array([[]], dtype=np.uint8))
 
 
+def test_decode_batch_transposed_matches_decode_batch():
+    m = Matching()
+    for i in range(20):
+        m.add_edge(i, i + 1, fault_ids={i % 3}, weight=1 + i % 4)
+    m.add_boundary_edge(0, fault_ids={2}, weight=2)
+    rng = np.random.default_rng(0)
+    shots = (rng.random((100, 21)) < 0.2).astype(np.uint8)
+    expected_predictions, expected_weights = m.decode_batch(shots, return_weights=True)
+    transposed_shots = np.packbits(shots.T, axis=1, bitorder='little')
+    assert transposed_shots.shape == (21, 13)
+    for num_threads in [1, 3]:
+        predictions, weights = m.decode_batch(transposed_shots, bit_packed_shots=True, bit_packed_predictions=True,
+                                              transposed=True, return_weights=True, num_threads=num_threads)
+        assert predictions.shape == (3, 13)
+        unpacked = np.unpackbits(predictions, axis=1, bitorder='little', count=100).T
+        assert np.array_equal(unpacked, expected_predictions)
+        assert np.array_equal(weights[:100], expected_weights)
+        assert np.all(weights[100:] == 0)
+        assert np.all(np.unpackbits(predictions, axis=1, bitorder='little')[:, 100:] == 0)
+    with pytest.raises(ValueError):
+        m.decode_batch(shots, transposed=True)
+    with pytest.raises(ValueError):
+        m.decode_batch(transposed_shots, bit_packed_shots=True, bit_packed_predictions=True, transposed=True,
+                       return_stats=True)
+
+
+def test_decode_batch_sparse_matches_decode_batch():
+    m = Matching()
+    for i in range(20):
+        m.add_edge(i, i + 1, fault_ids={i % 10}, weight=1 + i % 4)
+    m.add_boundary_edge(0, fault_ids={9}, weight=2)
+    rng = np.random.default_rng(1)
+    shots = (rng.random((100, 21)) < 0.1).astype(np.uint8)
+    expected_predictions, expected_weights = m.decode_batch(shots, return_weights=True)
+    sparse_shots = csr_matrix(shots)
+    for dtype in [np.uint32, np.uint64, np.int32]:
+        for num_threads in [1, 3]:
+            predictions, weights = m.decode_batch_sparse(sparse_shots.indptr, sparse_shots.indices.astype(dtype),
+                                                         return_weights=True, num_threads=num_threads)
+            assert np.array_equal(predictions, expected_predictions)
+            assert np.array_equal(weights, expected_weights)
+    packed = m.decode_batch_sparse(sparse_shots.indptr, sparse_shots.indices, bit_packed_predictions=True)
+    assert np.array_equal(packed, np.packbits(expected_predictions, axis=1, bitorder='little'))
+    with pytest.raises(ValueError):
+        m.decode_batch_sparse(np.array([0, 2, 1]), np.array([1, 2], dtype=np.uint64))
+    with pytest.raises(ValueError):
+        m.decode_batch_sparse(np.array([0, 1]), np.array([21], dtype=np.uint64))
+
+
+def test_count_logical_errors_matches_decode_batch():
+    m = Matching()
+    for i in range(20):
+        m.add_edge(i, i + 1, fault_ids={i % 10}, weight=1 + i % 4)
+    m.add_boundary_edge(0, fault_ids={9}, weight=2)
+    rng = np.random.default_rng(1)
+    shots = (rng.random((200, 21)) < 0.2).astype(np.uint8)
+    actual_observables = (rng.random((200, 10)) < 0.1).astype(np.uint8)
+    predictions = m.decode_batch(shots)
+    assert m.decode_batch(shots, return_weights=False) is not None
+    wrong = predictions != actual_observables
+    for num_threads in [1, 3]:
+        num_errors, errors_per_fault_id = m.count_logical_errors(shots, actual_observables, num_threads=num_threads)
+        assert num_errors == np.sum(np.any(wrong, axis=1))
+        assert errors_per_fault_id.dtype == np.uint64
+        assert np.array_equal(errors_per_fault_id, np.sum(wrong, axis=0))
+        packed = m.count_logical_errors(
+            np.packbits(shots, axis=1, bitorder='little'),
+            np.packbits(actual_observables, axis=1, bitorder='little'),
+            bit_packed_shots=True,
+            bit_packed_observables=True,
+            num_threads=num_threads,
+        )
+        assert packed[0] == num_errors
+        assert np.array_equal(packed[1], errors_per_fault_id)
+    with pytest.raises(ValueError):
+        m.count_logical_errors(shots, actual_observables[:, :9])
+    with pytest.raises(ValueError):
+        m.count_logical_errors(shots, actual_observables[:100])
+
+
 def test_detection_event_too_large_raises_value_error():
     m = pymatching.Matching()
     m.add_edge(0, 1)
@@ -221,6 +370,25 @@ def test_detection_event_too_large_raises_value_error():
         m.decode_batch([[8]], bit_packed_shots=True)
 
 
+def test_decode_with_out_buffer():
+    m = Matching()
+    m.add_edge(0, 1, fault_ids={0}, weight=4)
+    m.add_edge(1, 2, fault_ids={1}, weight=9)
+    m.add_boundary_edge(2, fault_ids={2}, weight=1)
+    out = np.ones(3, dtype=np.uint8)
+    correction = m.decode(np.array([1, 1, 0], dtype=np.uint8), out=out)
+    assert correction is out
+    assert np.array_equal(out, np.array([1, 0, 0], dtype=np.uint8))
+    correction, weight = m.decode(np.array([0, 0, 1], dtype=np.uint8), out=out, return_weight=True)
+    assert correction is out
+    assert np.array_equal(out, np.array([0, 0, 1], dtype=np.uint8))
+    assert weight == 1
+    with pytest.raises(ValueError):
+        m.decode(np.array([1, 1, 0], dtype=np.uint8), out=np.zeros(2, dtype=np.uint8))
+    with pytest.raises(ValueError):
+        m.decode(np.array([1, 1, 0], dtype=np.uint8), out=np.zeros(3, dtype=np.int64))
+
+
 def test_deprecated_position_arguments_raise_deprecation_warning():
     m = Matching()
     m.add_edge(0, 1, fault_ids={0}, weight=4)
@@ -280,6 +448,220 @@ def test_decode_to_edges():
     assert np.array_equal(edges, np.array([[9, 8], [5, 6], [4, 3], [5, 4], [0, 1], [0, -1]], dtype=np.int64))
 
 
+def test_decode_batch_to_edges_and_matched_dets_arrays_match_single_shot_methods():
+    m = Matching()
+    m.add_boundary_edge(0)
+    for i in range(10):
+        m.add_edge(i, i + 1)
+    rng = np.random.default_rng(0)
+    shots = (rng.random((50, m.num_detectors)) < 0.2).astype(np.uint8)
+    shots[3, :] = 0
+
+    for bit_packed_shots in (False, True):
+        batch = np.packbits(shots, bitorder='little', axis=1) if bit_packed_shots else shots
+        edge_offsets, edges = m.decode_batch_to_edges_array(batch, bit_packed_shots=bit_packed_shots)
+        pair_offsets, pairs = m.decode_batch_to_matched_dets_array(batch, bit_packed_shots=bit_packed_shots)
+        assert edge_offsets.shape == (shots.shape[0] + 1,)
+        assert pair_offsets.shape == (shots.shape[0] + 1,)
+        assert edges.shape == (edge_offsets[-1], 2)
+        assert pairs.shape == (pair_offsets[-1], 2)
+        for i in range(shots.shape[0]):
+            expected_edges = m.decode_to_edges_array(shots[i])
+            expected_pairs = m.decode_to_matched_dets_array(shots[i])
+            assert np.array_equal(edges[edge_offsets[i]:edge_offsets[i + 1]], expected_edges.reshape(-1, 2))
+            assert np.array_equal(pairs[pair_offsets[i]:pair_offsets[i + 1]], expected_pairs.reshape(-1, 2))
+        assert edge_offsets[4] == edge_offsets[3]
+
+
+def test_decode_to_outputs_match_separate_methods():
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={0}, weight=1.5)
+    for i in range(10):
+        m.add_edge(i, i + 1, fault_ids={i % 3 + 1}, weight=1 + (i % 4) * 0.5)
+    rng = np.random.default_rng(1)
+    shots = (rng.random((30, m.num_detectors)) < 0.2).astype(np.uint8)
+
+    for i in range(shots.shape[0]):
+        outputs = m.decode_to_outputs(shots[i], weight=True, matched_dets=True, edges=True)
+        expected_prediction, expected_weight = m.decode(shots[i], return_weight=True)
+        assert np.array_equal(outputs["prediction"], expected_prediction)
+        assert outputs["weight"] == pytest.approx(expected_weight)
+        assert np.array_equal(outputs["matched_dets"], m.decode_to_matched_dets_array(shots[i]).reshape(-1, 2))
+        assert np.array_equal(outputs["edges"], m.decode_to_edges_array(shots[i]).reshape(-1, 2))
+    assert set(m.decode_to_outputs(shots[0], prediction=False, edges=True)) == {"edges"}
+
+    outputs = m.decode_batch_to_outputs(shots, weight=True, matched_dets=True, edges=True)
+    expected_predictions, expected_weights = m.decode_batch(shots, return_weights=True)
+    assert np.array_equal(outputs["predictions"], expected_predictions)
+    assert np.allclose(outputs["weights"], expected_weights)
+    for key, method in (("matched_dets", m.decode_batch_to_matched_dets_array),
+                        ("edges", m.decode_batch_to_edges_array)):
+        offsets, pairs = outputs[key]
+        expected_offsets, expected_pairs = method(shots)
+        assert np.array_equal(offsets, expected_offsets)
+        assert np.array_equal(pairs, expected_pairs)
+    assert set(m.decode_batch_to_outputs(shots, prediction=False, weight=True)) == {"weights"}
+
+
+def test_decode_batch_to_matched_dets_array_with_negative_weights_raises_value_error():
+    m = Matching()
+    m.add_edge(0, 1, weight=-1)
+    with pytest.raises(ValueError):
+        m.decode_batch_to_matched_dets_array(np.zeros((2, 2), dtype=np.uint8))
+
+
+def test_decode_with_weight_overrides_matches_reweighted_graph():
+    weights = [1.5, 1.0, 2.5, 1.25, 0.75, 3.0]
+    overrides = {(0, -1): 0.5, (2, 3): 2.75, (4, -1): -0.25}
+
+    def build(edge_weights):
+        m = Matching()
+        m.add_boundary_edge(0, fault_ids={0}, weight=edge_weights[(0, -1)])
+        for i in range(4):
+            m.add_edge(i, i + 1, fault_ids={i + 1}, weight=edge_weights[(i, i + 1)])
+        m.add_boundary_edge(4, fault_ids={5}, weight=edge_weights[(4, -1)])
+        return m
+
+    original_weights = dict(zip([(0, -1), (0, 1), (1, 2), (2, 3), (3, 4), (4, -1)], weights))
+    m = build(original_weights)
+    reweighted = build({**original_weights, **overrides})
+    original = build(original_weights)
+    rng = np.random.default_rng(0)
+    for _ in range(30):
+        syndrome = (rng.random(5) < 0.4).astype(np.uint8)
+        correction, weight = m.decode_with_weight_overrides(
+            syndrome, list(overrides.keys()), list(overrides.values()), return_weight=True)
+        expected_correction, expected_weight = reweighted.decode(syndrome, return_weight=True)
+        assert np.array_equal(correction, expected_correction)
+        assert weight == pytest.approx(expected_weight)
+        assert np.array_equal(m.decode(syndrome), original.decode(syndrome))
+
+    with pytest.raises(ValueError):
+        m.decode_with_weight_overrides([1, 0, 0, 0, 0], [(0, 2)], [1.0])
+    with pytest.raises(ValueError):
+        m.decode_with_weight_overrides([1, 0, 0, 0, 0], [(0, 1)], [4.0])
+
+
+def test_decode_with_correlations():
+    stim = pytest.importorskip("stim")
+    dem = stim.DetectorErrorModel("""
+        error(0.1) D0 D1 ^ D2 D3 L0
+        error(0.3) D2
+        error(0.3) D3
+    """)
+    m = Matching.from_detector_error_model(dem, enable_correlations=True)
+    syndrome = np.array([1, 1, 1, 1], dtype=np.uint8)
+    assert np.array_equal(m.decode(syndrome), np.array([0], dtype=np.uint8))
+    correction, weight = m.decode(syndrome, enable_correlations=True, return_weight=True)
+    assert np.array_equal(correction, np.array([1], dtype=np.uint8))
+    assert weight == pytest.approx(np.log(0.9 / 0.1), abs=1e-3)
+    assert np.array_equal(m.decode(syndrome), np.array([0], dtype=np.uint8))
+
+    shots = np.array([[1, 1, 1, 1], [0, 0, 1, 1], [1, 1, 0, 0]], dtype=np.uint8)
+    predictions = m.decode_batch(shots, enable_correlations=True, num_threads=2)
+    assert np.array_equal(predictions, np.array([[1], [0], [0]], dtype=np.uint8))
+
+    with pytest.raises(ValueError):
+        Matching.from_detector_error_model(dem).decode(syndrome, enable_correlations=True)
+
+
+def test_decode_with_erasures_matches_graph_with_zero_weights():
+    keys = [(0, -1), (0, 1), (1, 2), (2, 3), (3, 4), (4, -1)]
+    weights = [1.5, 1.0, 2.5, 1.25, 0.75, 3.0]
+
+    def build(edge_weights):
+        m = Matching()
+        m.add_boundary_edge(0, fault_ids={0}, weight=edge_weights[0])
+        for i in range(4):
+            m.add_edge(i, i + 1, fault_ids={i + 1}, weight=edge_weights[i + 1])
+        m.add_boundary_edge(4, fault_ids={5}, weight=edge_weights[5])
+        return m
+
+    m = build(weights)
+    original = build(weights)
+    assert [(u, -1 if v is None else v) for u, v, _ in m.edges()] == keys
+    rng = np.random.default_rng(0)
+    shots = (rng.random((40, 5)) < 0.4).astype(np.uint8)
+    # The heaviest edge is never erased, so that the weights are discretized identically.
+    erasures = [list(np.nonzero(rng.random(5) < 0.3)[0]) for _ in range(40)]
+    predictions, batch_weights = m.decode_batch_with_erasures(shots, erasures, return_weights=True)
+    mask = np.zeros((40, 6), dtype=bool)
+    for k, erased in enumerate(erasures):
+        mask[k, erased] = True
+        erased_weights = [0 if e in erased else w for e, w in enumerate(weights)]
+        expected_correction, expected_weight = build(erased_weights).decode(shots[k], return_weight=True)
+        correction, weight = m.decode_with_erasures(shots[k], erased, return_weight=True)
+        assert np.array_equal(correction, expected_correction)
+        assert weight == pytest.approx(expected_weight)
+        assert np.array_equal(predictions[k], expected_correction)
+        assert batch_weights[k] == pytest.approx(expected_weight)
+        assert np.array_equal(m.decode(shots[k]), original.decode(shots[k]))
+    assert np.array_equal(m.decode_batch_with_erasures(shots, mask), predictions)
+    assert np.array_equal(
+        m.decode_batch_with_erasures(np.packbits(shots, axis=1, bitorder='little'), erasures, bit_packed_shots=True),
+        predictions)
+
+    with pytest.raises(ValueError):
+        m.decode_with_erasures([1, 0, 0, 0, 0], [6])
+    with pytest.raises(ValueError):
+        m.decode_batch_with_erasures(shots, erasures[:-1])
+    with pytest.raises(ValueError):
+        m.decode_batch_with_erasures(shots, mask[:-1])
+
+
+def test_decode_batch_with_edge_probabilities():
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={0}, weight=2.2)
+    m.add_edge(0, 1, weight=1.4)
+    m.add_boundary_edge(1, fault_ids={1}, weight=2.2)
+    shots = np.array([[1, 1], [1, 1], [1, 0]], dtype=np.uint8)
+    probabilities = np.array([[0.1, 0.2, 0.1], [0.4, 0.01, 0.4], [0.4, 0.01, 0.4]])
+    predictions, weights = m.decode_batch_with_edge_probabilities(shots, probabilities, return_weights=True)
+    assert np.array_equal(predictions, np.array([[0, 0], [1, 1], [1, 0]], dtype=np.uint8))
+    assert weights == pytest.approx([np.log(4), 2 * np.log(1.5), np.log(1.5)], abs=1e-3)
+    # The weights given when the graph was constructed are restored after decoding.
+    assert np.array_equal(m.decode([1, 1]), np.array([0, 0], dtype=np.uint8))
+
+    with pytest.raises(ValueError):
+        m.decode_batch_with_edge_probabilities(shots, probabilities[:2])
+    with pytest.raises(ValueError):
+        m.decode_batch_with_edge_probabilities(shots, probabilities + 1)
+
+
+def test_frozen_matching_decodes_concurrently():
+    from concurrent.futures import ThreadPoolExecutor
+
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={0}, weight=1.5)
+    m.add_edge(0, 1, fault_ids={1}, weight=1.0)
+    m.add_edge(1, 2, fault_ids={2}, weight=2.0)
+    m.add_boundary_edge(2, fault_ids={3}, weight=0.5)
+    assert not m.frozen
+    m.freeze()
+    assert m.frozen
+
+    syndromes = [np.array([1, 0, 1], dtype=np.uint8), np.array([1, 1, 0], dtype=np.uint8)] * 50
+    expected = [m.decode(z) for z in syndromes]
+    with ThreadPoolExecutor(max_workers=4) as pool:
+        corrections = list(pool.map(m.decode, syndromes))
+        predictions = list(pool.map(lambda k: m.decode_batch(np.array(syndromes[k:k + 10]), num_threads=2),
+                                    range(0, len(syndromes), 10)))
+    for correction, expected_correction in zip(corrections, expected):
+        assert np.array_equal(correction, expected_correction)
+    assert np.array_equal(np.concatenate(predictions), np.array(expected))
+    assert sorted(map(tuple, m.decode_to_edges_array([1, 0, 1]).tolist())) == [(0, -1), (2, -1)]
+
+    with pytest.raises(ValueError):
+        m.add_edge(0, 2)
+    with pytest.raises(ValueError):
+        m.set_boundary_nodes({2})
+    with pytest.raises(ValueError):
+        m.load_from_check_matrix([[1, 1]])
+    with pytest.raises(ValueError):
+        m.decode_with_weight_overrides([1, 0, 1], edges=[(0, 1)], weights=[0.1])
+    assert m.num_edges == 4
+
+
 def test_parallel_boundary_edges_decoding():
     m = Matching()
     m.set_boundary_nodes({0, 2})
@@ -299,3 +681,218 @@ def test_parallel_boundary_edges_decoding():
     assert np.array_equal(m.decode([1, 0, 0, 0, 0]), np.array([0, 0, 1, 0, 0], dtype=np.uint8))
     m.set_boundary_nodes({1, 2, 3, 4})
     assert np.array_equal(m.decode([1, 0, 0, 0, 0]), np.array([0, 0, 0, 1, 0], dtype=np.uint8))
+
+
+def test_syndrome_cache_matches_uncached_decoding():
+    def make_matching():
+        m = pymatching.Matching()
+        m.add_boundary_edge(0, fault_ids={0}, weight=2)
+        for i in range(19):
+            m.add_edge(i, i + 1, fault_ids={i % 4}, weight=1 + (i % 3) * 0.5)
+        m.add_boundary_edge(19, fault_ids={1}, weight=2)
+        return m
+
+    m = make_matching()
+    uncached = make_matching()
+    m.set_syndrome_cache_capacity(256)
+    rng = np.random.default_rng(1)
+    shots = (rng.random((20, 20)) < 0.1).astype(np.uint8)
+    shots = np.concatenate([shots] * 5)
+    expected_predictions, expected_weights = uncached.decode_batch(shots, return_weights=True)
+    for num_threads in [1, 2]:
+        predictions, weights = m.decode_batch(shots, return_weights=True, num_threads=num_threads)
+        assert np.array_equal(predictions, expected_predictions)
+        assert np.array_equal(weights, expected_weights)
+    stats = m.syndrome_cache_stats
+    assert stats["hits"] > 0
+    assert stats["misses"] > 0
+    assert uncached.syndrome_cache_stats == {"hits": 0, "misses": 0}
+    with pytest.raises(ValueError):
+        m.set_syndrome_cache_capacity(-1)
+    m.freeze()
+    with pytest.raises(ValueError):
+        m.set_syndrome_cache_capacity(0)
+
+
+def test_warm_up_reserves_memory_without_changing_decoding():
+    def make_matching():
+        m = pymatching.Matching()
+        m.add_boundary_edge(0, fault_ids={0}, error_probability=0.1)
+        for i in range(29):
+            m.add_edge(i, i + 1, fault_ids={i + 1}, error_probability=0.1)
+        m.add_boundary_edge(29, fault_ids={30}, error_probability=0.1)
+        return m
+
+    m = make_matching()
+    cold = make_matching()
+    reserved = m.warm_up(0, expected_detection_events=10)
+    assert set(reserved) == {"regions", "alt_tree_nodes", "queue_events", "match_edges", "reached_nodes",
+                             "shatter_stack"}
+    assert reserved["regions"] >= 20
+    assert reserved["reached_nodes"] == 30
+    sampled = m.warm_up(200, expected_detection_events=10, num_threads=2, seed=1)
+    assert all(sampled[k] >= reserved[k] for k in reserved)
+    assert m.syndrome_cache_stats == {"hits": 0, "misses": 0}
+
+    shots, _ = m.add_noise_batch(50, seed=2)
+    shots = np.unpackbits(shots, axis=1, count=30, bitorder="little")
+    assert np.array_equal(m.decode_batch(shots, num_threads=2), cold.decode_batch(shots))
+
+    m.freeze()
+    assert m.warm_up(10, num_threads=3, seed=3)["regions"] > 0
+    with pytest.raises(ValueError):
+        m.warm_up(-1)
+    with pytest.raises(ValueError):
+        m.warm_up(1, num_threads=0)
+    no_probabilities = pymatching.Matching()
+    no_probabilities.add_edge(0, 1)
+    with pytest.raises(ValueError):
+        no_probabilities.warm_up(1)
+    assert no_probabilities.warm_up(0, expected_detection_events=4)["alt_tree_nodes"] >= 4
+
+
+def test_memory_usage():
+    m = pymatching.Matching()
+    m.add_boundary_edge(0, fault_ids={0}, error_probability=0.1)
+    for i in range(99):
+        m.add_edge(i, i + 1, fault_ids={i + 1}, error_probability=0.1)
+    unbuilt = m.memory_usage()
+    assert unbuilt["num_decoders"] == 0
+    assert unbuilt["user_graph"] > 0
+    assert unbuilt["total"] == unbuilt["user_graph"]
+
+    m.decode(np.zeros(100, dtype=np.uint8))
+    one = m.memory_usage()
+    assert one["num_decoders"] == 1
+    assert one["shared_graph"] > 0 and one["matching_graph"] > 0
+    assert one["mapped_graph"] == 0
+    parts = ["user_graph", "shared_graph", "matching_graph", "search_graph", "decoder_state", "auxiliary"]
+    assert one["total"] == sum(one[k] for k in parts)
+
+    # The decoders of the threads share the edges of the graph, and warming them up grows their state.
+    m.warm_up(0, expected_detection_events=50, num_threads=3)
+    three = m.memory_usage()
+    assert three["num_decoders"] == 3
+    assert three["matching_graph"] == 3 * one["matching_graph"]
+    assert three["shared_graph"] < 2 * one["shared_graph"]
+    assert three["decoder_state"] > 3 * one["decoder_state"]
+    assert three["max_alt_tree_nodes"] >= 50
+
+
+def test_path_threads_give_same_solutions():
+    def make_matching():
+        m = pymatching.Matching()
+        width = 30
+        fault_id = 0
+        for r in range(width):
+            for c in range(width):
+                n = r * width + c
+                if c + 1 < width:
+                    m.add_edge(n, n + 1, fault_ids={fault_id}, weight=1 + (n % 7) * 0.1)
+                    fault_id += 1
+                if r + 1 < width:
+                    m.add_edge(n, n + width, fault_ids={fault_id}, weight=1 + (n % 5) * 0.1)
+                    fault_id += 1
+                if c == 0:
+                    m.add_boundary_edge(n, fault_ids={fault_id}, weight=1.5)
+                    fault_id += 1
+        return m
+
+    sequential = make_matching()
+    parallel = make_matching()
+    assert parallel.path_threads == 1
+    parallel.set_path_threads(3)
+    assert parallel.path_threads == 3
+    rng = np.random.default_rng(0)
+    shots = (rng.random((10, 900)) < 0.15).astype(np.uint8)
+    assert np.array_equal(parallel.decode_batch(shots), sequential.decode_batch(shots))
+    for shot in shots[:3]:
+        assert np.array_equal(parallel.decode_to_edges_array(shot), sequential.decode_to_edges_array(shot))
+    with pytest.raises(ValueError):
+        parallel.set_path_threads(0)
+    parallel.freeze()
+    with pytest.raises(ValueError):
+        parallel.set_path_threads(2)
+
+
+def test_union_find_decoder():
+    m = Matching()
+    assert m.decoder == "sparse_blossom"
+    m.add_boundary_edge(0, fault_ids={0})
+    for i in range(9):
+        m.add_edge(i, i + 1, fault_ids={i + 1})
+    m.add_boundary_edge(9, fault_ids={10})
+    m.set_decoder("uf")
+    assert m.decoder == "union_find"
+    # Well separated pairs of detection events are matched as by sparse blossom.
+    shots = np.zeros((3, 10), dtype=np.uint8)
+    shots[0, [0]] = 1
+    shots[1, [4, 5]] = 1
+    shots[2, [0, 5, 6, 9]] = 1
+    expected = np.zeros((3, 11), dtype=np.uint8)
+    expected[0, [0]] = 1
+    expected[1, [5]] = 1
+    expected[2, [0, 6, 10]] = 1
+    assert np.array_equal(m.decode_batch(shots), expected)
+    assert np.array_equal(m.decode(shots[2]), expected[2])
+    with pytest.raises(ValueError):
+        m.set_decoder("blossom")
+    m.set_decoder("sparse_blossom")
+    assert m.decoder == "sparse_blossom"
+    m.freeze()
+    with pytest.raises(ValueError):
+        m.set_decoder("uf")
+
+
+def test_predecoder():
+    def make_matching():
+        m = Matching()
+        m.add_boundary_edge(0, fault_ids={0}, weight=2)
+        for i in range(9):
+            m.add_edge(i, i + 1, fault_ids={i + 1}, weight=1 + (i % 3) * 0.5)
+            m.add_edge(i, 10 + i, fault_ids={10 + i}, weight=1 + (i % 2) * 0.5)
+        m.add_boundary_edge(9, fault_ids={19}, weight=2)
+        return m
+
+    m = make_matching()
+    exact = make_matching()
+    approximate = make_matching()
+    assert exact.predecoder == "off"
+    exact.set_predecoder("exact")
+    approximate.set_predecoder("approximate")
+    assert exact.predecoder == "exact"
+    assert approximate.predecoder == "approximate"
+    rng = np.random.default_rng(2)
+    shots = (rng.random((100, 19)) < 0.2).astype(np.uint8)
+    _, weights = m.decode_batch(shots, return_weights=True)
+    _, exact_weights = exact.decode_batch(shots, return_weights=True)
+    _, approximate_weights = approximate.decode_batch(shots, return_weights=True)
+    assert np.allclose(exact_weights, weights)
+    assert np.all(approximate_weights >= weights - 1e-9)
+    with pytest.raises(ValueError):
+        m.set_predecoder("greedy")
+    exact.freeze()
+    with pytest.raises(ValueError):
+        exact.set_predecoder("off")
+
+
+def test_work_budget():
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={0}, weight=2)
+    for i in range(39):
+        m.add_edge(i, i + 1, fault_ids={i % 6}, weight=1 + (i % 3) * 0.5)
+    m.add_boundary_edge(39, fault_ids={1}, weight=2)
+    rng = np.random.default_rng(4)
+    shots = (rng.random((20, 40)) < 0.4).astype(np.uint8)
+    expected = m.decode_batch(shots)
+    m.set_decoder("uf")
+    union_find_predictions = m.decode_batch(shots)
+    m.set_decoder("sparse_blossom")
+    assert m.num_degraded_shots == 0
+    m.set_work_budget(max_flood_check_events=1)
+    assert np.array_equal(m.decode_batch(shots), union_find_predictions)
+    assert m.num_degraded_shots == np.sum(np.sum(shots, axis=1) > 10)
+    m.set_work_budget(max_flood_check_events=10**9, max_microseconds=10**9)
+    assert np.array_equal(m.decode_batch(shots), expected)
+    with pytest.raises(ValueError):
+        m.set_work_budget(max_flood_check_events=-1)
@@ -0,0 +1,90 @@
+# Copyright 2022 PyMatching Contributors
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#      http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+from concurrent.futures import Future, ThreadPoolExecutor
+
+import numpy as np
+import pytest
+
+from pymatching import DecoderService
+from pymatching.matching import Matching
+
+
+def repetition_code_matching(n: int) -> Matching:
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={0}, weight=1.5)
+    for i in range(n - 1):
+        m.add_edge(i, i + 1, fault_ids={i + 1}, weight=1.0 + 0.1 * i)
+    m.add_boundary_edge(n - 1, fault_ids={n}, weight=1.5)
+    return m
+
+
+def test_decoder_service_matches_decode():
+    m = repetition_code_matching(10)
+    rng = np.random.default_rng(0)
+    syndromes = rng.integers(0, 2, size=(200, 10), dtype=np.uint8)
+    expected = [m.decode(z, return_weight=True) for z in syndromes]
+    with m.decoder_service(num_workers=3) as service:
+        assert isinstance(service, DecoderService)
+        assert service.num_workers == 3
+        assert m.frozen
+        futures = [service.submit(z, return_weight=True) for z in syndromes]
+        assert all(isinstance(f, Future) for f in futures)
+        for future, (correction, weight) in zip(futures, expected):
+            result_correction, result_weight = future.result(timeout=10)
+            assert np.array_equal(result_correction, correction)
+            assert result_weight == pytest.approx(weight)
+        # Syndromes can also be submitted from several Python threads at once.
+        with ThreadPoolExecutor(max_workers=4) as pool:
+            corrections = list(pool.map(lambda z: service.submit(z).result(timeout=10), syndromes))
+        for correction, (expected_correction, _) in zip(corrections, expected):
+            assert np.array_equal(correction, expected_correction)
+    assert service.closed
+    assert service.num_workers == 0
+    with pytest.raises(ValueError):
+        service.submit(syndromes[0])
+
+
+def test_decoder_service_errors():
+    m = repetition_code_matching(3)
+    service = m.decoder_service()
+    with pytest.raises(ValueError):
+        service.submit([1, 1])
+    future = service._service.submit(np.array([0, 7], dtype=np.uint64))
+    with pytest.raises(ValueError):
+        future.result(timeout=10)
+    with pytest.raises(ValueError):
+        m.add_edge(0, 2)
+    service.close()
+    service.close()
+    with pytest.raises(ValueError):
+        m.decoder_service(num_workers=0)
+
+
+@pytest.mark.parametrize("huge_pages,replicate_per_numa_node", [
+    ("transparent", False),
+    ("explicit", True),
+    ("none", True),
+])
+def test_decoder_service_memory_placement(huge_pages, replicate_per_numa_node):
+    m = repetition_code_matching(10)
+    rng = np.random.default_rng(1)
+    syndromes = rng.integers(0, 2, size=(50, 10), dtype=np.uint8)
+    expected = [m.decode(z) for z in syndromes]
+    with m.decoder_service(num_workers=2, huge_pages=huge_pages,
+                           replicate_per_numa_node=replicate_per_numa_node) as service:
+        for z, correction in zip(syndromes, expected):
+            assert np.array_equal(service.submit(z).result(timeout=10), correction)
+    with pytest.raises(ValueError):
+        m.decoder_service(huge_pages="huge")
@@ -26,3 +26,7 @@ def test_matching_docstrings():
 
 def test_cpp_pymatching_docstrings():
     doctest.testmod(pymatching._cpp_pymatching, raise_on_error=True)
+
+
+def test_multi_matching_docstrings():
+    doctest.testmod(pymatching.multi_matching, raise_on_error=True)
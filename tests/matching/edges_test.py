@@ -153,3 +153,23 @@ def test_add_self_loop():
         (3, 4, {"fault_ids": set(), "weight": 14.0, "error_probability": -1.0}),
         (4, 4, {"fault_ids": set(), "weight": 10.0, "error_probability": -1.0})
     ]
+
+
+def test_add_edges():
+    m = Matching()
+    m.add_edges([0, 1, 2, 1], [1, 2, -1, 0], fault_ids=[[0, -1], [1, 2], [-1, -1], [3, -1]],
+                weights=[1.0, 2.0, 3.0, 4.0], error_probabilities=0.1, merge_strategy="keep-original")
+    assert m.edges() == [
+        (0, 1, {"fault_ids": {0}, "weight": 1.0, "error_probability": 0.1}),
+        (1, 2, {"fault_ids": {1, 2}, "weight": 2.0, "error_probability": 0.1}),
+        (2, None, {"fault_ids": set(), "weight": 3.0, "error_probability": 0.1})
+    ]
+    assert m.has_edge(1, 0)
+    assert m.has_boundary_edge(2)
+    assert m.num_fault_ids == 3
+    with pytest.raises(ValueError):
+        m.add_edges([2], [1])
+    with pytest.warns(UserWarning):
+        m.add_edges([3, 4], [4, 5], fault_ids=[3, 4], weights=[1.0, 9999999999])
+    assert m.num_edges == 4
+    assert m.get_edge_data(3, 4) == {"fault_ids": {3}, "weight": 1.0, "error_probability": -1.0}
@@ -0,0 +1,135 @@
+# Copyright 2022 PyMatching Contributors
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#      http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import os
+
+import numpy as np
+import pytest
+
+from pymatching import Matching
+
+
+def test_graph_file_round_trip_from_dem(tmp_path):
+    stim = pytest.importorskip("stim")
+    circuit = stim.Circuit.generated("surface_code:rotated_memory_x", distance=5, rounds=5,
+                                     after_clifford_depolarization=0.01)
+    m = Matching.from_stim_circuit(circuit)
+    path = str(tmp_path / "graph.pmg")
+    m.save_graph(path)
+    m2 = Matching.from_graph_file(path)
+    assert m2.num_nodes == m.num_nodes
+    assert m2.num_fault_ids == m.num_fault_ids
+    assert m2.boundary == m.boundary
+    assert m2.edges() == m.edges()
+    shots = circuit.compile_detector_sampler(seed=1).sample(200)
+    predictions, weights = m.decode_batch(shots, return_weights=True)
+    predictions2, weights2 = m2.decode_batch(shots, return_weights=True)
+    assert np.array_equal(predictions, predictions2)
+    assert np.array_equal(weights, weights2)
+
+
+def test_graph_file_round_trip_with_negative_weights_and_boundary(tmp_path):
+    m = Matching()
+    m.add_edge(0, 1, fault_ids={0}, weight=2)
+    m.add_edge(1, 2, fault_ids={1}, weight=-1)
+    m.add_edge(2, 3, fault_ids={2}, weight=1.5)
+    m.set_boundary_nodes({3})
+    path = str(tmp_path / "graph.pmg")
+    m.save_graph(path)
+    m2 = Matching.from_graph_file(path)
+    assert m2.boundary == {3}
+    assert m2.edges() == m.edges()
+    for z in ([1, 0, 0, 0], [0, 1, 1, 0], [1, 1, 1, 0]):
+        assert np.array_equal(m2.decode(z), m.decode(z))
+    m2.add_edge(0, 3, fault_ids={3}, weight=0.5)
+    assert np.array_equal(m2.decode([1, 0, 0, 0]), np.array([0, 0, 0, 1], dtype=np.uint8))
+
+
+def test_load_invalid_graph_file_raises_value_error(tmp_path):
+    path = str(tmp_path / "graph.pmg")
+    with open(path, "wb") as f:
+        f.write(b"not a graph file")
+    with pytest.raises(ValueError):
+        Matching.from_graph_file(path)
+    with pytest.raises(ValueError):
+        Matching.from_graph_file(str(tmp_path / "missing.pmg"))
+
+
+def test_attach_graph_file(tmp_path):
+    m = Matching()
+    m.add_edge(0, 1, fault_ids={0}, weight=2, error_probability=0.1)
+    m.add_edge(1, 2, fault_ids={1}, weight=-1, error_probability=0.2)
+    m.add_edge(2, 3, fault_ids={2}, weight=1.5, error_probability=0.1)
+    m.set_boundary_nodes({3})
+    path = str(tmp_path / "graph.pmg")
+    m.save_graph(path)
+    m2 = Matching.attach_graph_file(path)
+    assert m2.frozen
+    assert m2.num_nodes == m.num_nodes
+    assert m2.num_edges == m.num_edges
+    assert m2.boundary == {3}
+    for z in ([1, 0, 0, 0], [0, 1, 1, 0], [1, 1, 1, 0]):
+        assert np.array_equal(m2.decode(z), m.decode(z))
+    with pytest.raises(ValueError):
+        m2.edges()
+    with pytest.raises(ValueError):
+        m2.add_noise()
+    with pytest.raises(ValueError):
+        m2.add_edge(0, 3)
+
+
+def test_attach_shared_memory():
+    if os.name == "nt":
+        pytest.skip("Shared memory graphs are not supported on Windows")
+    stim = pytest.importorskip("stim")
+    circuit = stim.Circuit.generated("surface_code:rotated_memory_x", distance=5, rounds=5,
+                                     after_clifford_depolarization=0.01)
+    m = Matching.from_stim_circuit(circuit)
+    name = f"pymatching_graph_file_test_{os.getpid()}"
+    m.save_to_shared_memory(name)
+    try:
+        m2 = Matching.attach_shared_memory(name)
+    finally:
+        assert Matching.remove_shared_memory(name)
+    assert not Matching.remove_shared_memory(name)
+    with pytest.raises(ValueError):
+        Matching.attach_shared_memory(name)
+    shots = circuit.compile_detector_sampler(seed=1).sample(200)
+    predictions, weights = m.decode_batch(shots, return_weights=True)
+    predictions2, weights2 = m2.decode_batch(shots, return_weights=True)
+    assert np.array_equal(predictions, predictions2)
+    assert np.array_equal(weights, weights2)
+
+
+def test_graph_cache_dir(tmp_path):
+    stim = pytest.importorskip("stim")
+    circuit = stim.Circuit.generated("surface_code:rotated_memory_x", distance=3, rounds=3,
+                                     after_clifford_depolarization=0.01)
+    circuit_path = str(tmp_path / "circuit.stim")
+    dem_path = str(tmp_path / "model.dem")
+    circuit.to_file(circuit_path)
+    circuit.detector_error_model(decompose_errors=True).to_file(dem_path)
+    cache_dir = str(tmp_path / "cache")
+    m = Matching.from_stim_circuit_file(circuit_path)
+    built = Matching.from_stim_circuit_file(circuit_path, cache_dir=cache_dir)
+    cached = Matching.from_stim_circuit_file(circuit_path, cache_dir=cache_dir)
+    from_dem = Matching.from_detector_error_model_file(dem_path, cache_dir=cache_dir)
+    assert len(os.listdir(cache_dir)) == 2
+    shots = circuit.compile_detector_sampler(seed=2).sample(200)
+    expected = m.decode_batch(shots)
+    for m2 in (built, cached, from_dem, Matching.from_detector_error_model_file(dem_path, cache_dir=cache_dir)):
+        assert m2.edges() == m.edges()
+        assert np.array_equal(m2.decode_batch(shots), expected)
+    with pytest.raises(ValueError):
+        Matching.from_stim_circuit_file(circuit_path, enable_correlations=True, cache_dir=cache_dir)
@@ -0,0 +1,83 @@
+# Copyright 2022 PyMatching Contributors
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#      http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import numpy as np
+import pytest
+
+from pymatching import MultiMatching
+from pymatching.matching import Matching
+
+
+def repetition_code_matching(n: int, weight_step: float) -> Matching:
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={0}, weight=1.5)
+    for i in range(n - 1):
+        m.add_edge(i, i + 1, fault_ids={i + 1}, weight=1.0 + weight_step * i)
+    m.add_boundary_edge(n - 1, fault_ids={n}, weight=1.5)
+    return m
+
+
+@pytest.mark.parametrize("num_threads", [1, 3])
+def test_multi_matching_matches_decode_batch(num_threads):
+    matchings = [repetition_code_matching(5, 0.1), repetition_code_matching(9, 0.2), repetition_code_matching(5, 0.3)]
+    multi = MultiMatching(matchings, num_threads=num_threads)
+    assert all(m.frozen for m in matchings)
+    assert multi.detector_offsets == [0, 5, 14]
+    assert multi.fault_id_offsets == [0, 6, 16]
+    assert multi.num_detectors == 19
+    assert multi.num_fault_ids == 22
+    assert multi.num_threads == num_threads
+
+    rng = np.random.default_rng(0)
+    shots = rng.integers(0, 2, size=(150, 19), dtype=np.uint8)
+    expected = []
+    expected_weights = np.zeros(150)
+    for m, offset in zip(matchings, multi.detector_offsets):
+        predictions, weights = m.decode_batch(shots[:, offset:offset + m.num_detectors], return_weights=True)
+        expected.append(predictions)
+        expected_weights += weights
+    expected = np.concatenate(expected, axis=1)
+
+    predictions, weights = multi.decode_batch(shots, return_weights=True)
+    assert np.array_equal(predictions, expected)
+    assert np.allclose(weights, expected_weights)
+
+    packed_predictions = multi.decode_batch(
+        np.packbits(shots, bitorder="little", axis=1), bit_packed_shots=True, bit_packed_predictions=True
+    )
+    assert np.array_equal(packed_predictions, np.packbits(expected, bitorder="little", axis=1))
+
+
+def test_multi_matching_detector_offsets():
+    m = repetition_code_matching(4, 0.1)
+    # The same matching decodes two overlapping ranges of the shots.
+    multi = MultiMatching([m, m], detector_offsets=[0, 2])
+    assert multi.num_detectors == 6
+    shots = np.array([[1, 0, 0, 1, 1, 0], [0, 1, 1, 0, 0, 0]], dtype=np.uint8)
+    predictions = multi.decode_batch(shots)
+    expected = np.concatenate([m.decode_batch(shots[:, 0:4]), m.decode_batch(shots[:, 2:6])], axis=1)
+    assert np.array_equal(predictions, expected)
+
+
+def test_multi_matching_errors():
+    m = repetition_code_matching(3, 0.1)
+    with pytest.raises(ValueError):
+        MultiMatching([])
+    with pytest.raises(ValueError):
+        MultiMatching([m], detector_offsets=[0, 3])
+    multi = MultiMatching([m, m])
+    with pytest.raises(ValueError):
+        multi.decode_batch(np.zeros((2, 5), dtype=np.uint8))
+    with pytest.raises(ValueError):
+        multi.decode_batch(np.zeros(6, dtype=np.uint8))
@@ -13,6 +13,7 @@
 # limitations under the License.
 
 import networkx as nx
+import numpy as np
 import pytest
 
 from pymatching.matching import Matching
@@ -64,3 +65,54 @@ def test_set_min_num_fault_ids_rustworkx():
     m.load_from_rustworkx(g, min_num_fault_ids=2)
     assert m.num_fault_ids == 4
     assert m.decode([1, 1]).shape[0] == 4
+
+
+def test_get_boundary_distances():
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={0}, weight=1)
+    m.add_edge(0, 1, weight=2.5)
+    m.add_edge(1, 2, weight=1)
+    m.add_boundary_edge(2, fault_ids={1}, weight=3)
+    m.add_edge(3, 4, weight=1)
+    distances, fault_ids = m.get_boundary_distances(return_fault_ids=True)
+    assert distances.shape == (5,)
+    assert distances[:3] == pytest.approx([1, 3.5, 3])
+    assert np.all(np.isinf(distances[3:]))
+    assert fault_ids.tolist() == [[1, 0], [1, 0], [0, 1], [0, 0], [0, 0]]
+
+    m.set_boundary_nodes({4})
+    distances = m.get_boundary_distances()
+    assert distances[3:].tolist() == [1, 0]
+    # A lone detection event one edge away from a boundary node is matched to it
+    assert m.decode([0, 0, 0, 1, 0], return_weight=True)[1] == pytest.approx(1)
+
+
+def test_shortest_paths_and_distances_from():
+    m = Matching()
+    m.add_boundary_edge(0, weight=1)
+    for i in range(4):
+        m.add_edge(i, i + 1, weight=1.5)
+    m.add_edge(4, 5, weight=2)
+    m.add_edge(6, 7, weight=1)
+    m.set_boundary_nodes({5})
+    for num_threads in [1, 2]:
+        offsets, nodes, distances = m.shortest_paths([4, 1, -1, 0, 3], [0, -1, 2, 7, 3], num_threads=num_threads)
+        assert offsets.tolist() == [0, 5, 7, 10, 10, 11]
+        assert nodes.tolist() == [4, 3, 2, 1, 0, 1, 0, 0, 1, 2, 3]
+        assert distances[:3] == pytest.approx([6, 2.5, 4])
+        assert np.isinf(distances[3])
+        assert distances[4] == 0
+    with pytest.raises(ValueError):
+        m.shortest_paths([5], [-1])
+    distances = m.distances_from(1)
+    assert distances[:6] == pytest.approx([1.5, 0, 1.5, 3, 4.5, 2.5])
+    assert np.all(np.isinf(distances[6:]))
+    assert m.distances_from(-1)[:6] == pytest.approx([1, 2.5, 4, 3.5, 2, 0])
+
+
+def test_get_boundary_distances_too_many_fault_ids_raises_value_error():
+    m = Matching()
+    m.add_boundary_edge(0, fault_ids={100})
+    assert m.get_boundary_distances().tolist() == [1]
+    with pytest.raises(ValueError):
+        m.get_boundary_distances(return_fault_ids=True)
@@ -0,0 +1,86 @@
+# Copyright 2022 PyMatching Contributors
+
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+
+#      http://www.apache.org/licenses/LICENSE-2.0
+
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+import numpy as np
+import pytest
+
+from pymatching import Matching, SinterDecoder
+
+
+def surface_code_dem_and_shots(num_shots: int):
+    stim = pytest.importorskip("stim")
+    circuit = stim.Circuit.generated("surface_code:rotated_memory_x", distance=5, rounds=5,
+                                     after_clifford_depolarization=0.01)
+    dem = circuit.detector_error_model(decompose_errors=True)
+    dets, _ = circuit.compile_detector_sampler(seed=3).sample(num_shots, separate_observables=True, bit_packed=True)
+    return dem, dets
+
+
+def test_decode_batch_bit_packed_matches_unpacked():
+    m = Matching()
+    for i in range(20):
+        m.add_edge(i, i + 1, fault_ids={i % 11}, weight=1 + i % 4)
+    m.add_boundary_edge(0, fault_ids={10}, weight=2)
+    rng = np.random.default_rng(0)
+    shots = (rng.random((200, 21)) < 0.2).astype(np.uint8)
+    expected = np.packbits(m.decode_batch(shots), bitorder="little", axis=1)
+    packed = np.packbits(shots, bitorder="little", axis=1)
+    for num_threads in [1, 3]:
+        predictions = m.decode_batch(packed, bit_packed_shots=True, bit_packed_predictions=True,
+                                     num_threads=num_threads)
+        assert predictions.shape == (200, 2)
+        assert np.array_equal(predictions, expected)
+    # Rows that aren't contiguous are copied first.
+    wide = np.zeros((200, 6), dtype=np.uint8)
+    wide[:, ::2] = packed
+    predictions = m.decode_batch(wide[:, ::2], bit_packed_shots=True, bit_packed_predictions=True)
+    assert np.array_equal(predictions, expected)
+
+
+def test_sinter_compiled_decoder_matches_decode_batch():
+    dem, dets = surface_code_dem_and_shots(500)
+    expected = Matching.from_detector_error_model(dem).decode_batch(
+        dets, bit_packed_shots=True, bit_packed_predictions=True, return_weights=True)[0]
+    for num_threads in [1, 2]:
+        compiled = SinterDecoder(num_threads=num_threads).compile_decoder_for_dem(dem=dem)
+        predictions = compiled.decode_shots_bit_packed(bit_packed_detection_event_data=dets)
+        assert predictions.dtype == np.uint8
+        assert predictions.shape == (500, (dem.num_observables + 7) // 8)
+        assert np.array_equal(predictions, expected)
+
+
+def test_sinter_decoder_decode_via_files(tmp_path):
+    dem, dets = surface_code_dem_and_shots(300)
+    expected = Matching.from_detector_error_model(dem).decode_batch(
+        dets, bit_packed_shots=True, bit_packed_predictions=True, return_weights=True)[0]
+    dem_path = tmp_path / "model.dem"
+    dem.to_file(dem_path)
+    dets_path = tmp_path / "dets.b8"
+    dets.tofile(dets_path)
+    obs_path = tmp_path / "obs.b8"
+    for decoder in [SinterDecoder(), SinterDecoder(num_threads=3, cache_dir=str(tmp_path / "cache"))]:
+        decoder.decode_via_files(num_shots=300, num_dets=dem.num_detectors, num_obs=dem.num_observables,
+                                 dem_path=dem_path, dets_b8_in_path=dets_path, obs_predictions_b8_out_path=obs_path,
+                                 tmp_dir=tmp_path)
+        predictions = np.fromfile(obs_path, dtype=np.uint8).reshape(300, -1)
+        assert np.array_equal(predictions, expected)
+    with pytest.raises(ValueError):
+        SinterDecoder().decode_via_files(num_shots=299, num_dets=dem.num_detectors, num_obs=dem.num_observables,
+                                         dem_path=dem_path, dets_b8_in_path=dets_path,
+                                         obs_predictions_b8_out_path=obs_path, tmp_dir=tmp_path)
+
+
+def test_sinter_decoder_rejects_bad_num_threads():
+    with pytest.raises(ValueError):
+        SinterDecoder(num_threads=0)